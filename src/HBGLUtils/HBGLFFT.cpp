@@ -0,0 +1,179 @@
+#include "HBGLFFT.h"
+
+#include <cmath>
+#include <iostream>
+
+#if defined(_M_IX86) || defined(_M_X64) || defined(__SSE__)
+#define HBGLFFT_USE_SSE 1
+#include <xmmintrin.h>
+#endif
+
+using namespace HBGLUtils;
+
+static const double c_TwoPi = 6.283185307179586;
+
+//-----------------------------------------------------------------------------
+
+HBGLFFT::HBGLFFT(unsigned int size) : m_size(size)
+{
+    if (size < 2 || (size & (size - 1)) != 0) {
+        std::cerr << "CODING ERROR: HBGLFFT size must be a power of two, got " << size << std::endl;
+        m_size = 0;
+        return;
+    }
+
+    unsigned int log2Size = 0;
+    while ((1u << log2Size) < m_size) {
+        log2Size++;
+    }
+
+    m_bitReverse.resize(m_size);
+    for (unsigned int idx = 0; idx < m_size; idx++) {
+        unsigned int reversed = 0;
+        for (unsigned int bit = 0; bit < log2Size; bit++) {
+            reversed |= ((idx >> bit) & 1u) << (log2Size - 1 - bit);
+        }
+        m_bitReverse[idx] = reversed;
+    }
+
+    m_twiddleReal.resize(m_size - 1);
+    m_twiddleImag.resize(m_size - 1);
+    for (unsigned int halfWidth = 1; halfWidth < m_size; halfWidth <<= 1) {
+        for (unsigned int k = 0; k < halfWidth; k++) {
+            double angle = -c_TwoPi * double(k) / double(2 * halfWidth);
+            m_twiddleReal[halfWidth - 1 + k] = static_cast<float>(cos(angle));
+            m_twiddleImag[halfWidth - 1 + k] = static_cast<float>(sin(angle));
+        }
+    }
+}
+
+//-----------------------------------------------------------------------------
+
+HBGLFFT::~HBGLFFT()
+{
+}
+
+//-----------------------------------------------------------------------------
+
+unsigned int
+HBGLFFT::GetSize() const
+{
+    return m_size;
+}
+
+//-----------------------------------------------------------------------------
+
+void
+HBGLFFT::Forward(float* real, float* imag) const
+{
+    for (unsigned int idx = 0; idx < m_size; idx++) {
+        unsigned int swapIdx = m_bitReverse[idx];
+        if (swapIdx > idx) {
+            float tmpReal = real[idx]; real[idx] = real[swapIdx]; real[swapIdx] = tmpReal;
+            float tmpImag = imag[idx]; imag[idx] = imag[swapIdx]; imag[swapIdx] = tmpImag;
+        }
+    }
+
+    for (unsigned int halfWidth = 1; halfWidth < m_size; halfWidth <<= 1)
+    {
+        const float* twiddleReal = &m_twiddleReal[halfWidth - 1];
+        const float* twiddleImag = &m_twiddleImag[halfWidth - 1];
+
+        for (unsigned int start = 0; start < m_size; start += 2 * halfWidth)
+        {
+            float* aReal = real + start;
+            float* aImag = imag + start;
+            float* bReal = aReal + halfWidth;
+            float* bImag = aImag + halfWidth;
+
+            unsigned int k = 0;
+
+#if defined(HBGLFFT_USE_SSE)
+            for (; k + 4 <= halfWidth; k += 4)
+            {
+                __m128 wr = _mm_loadu_ps(twiddleReal + k);
+                __m128 wi = _mm_loadu_ps(twiddleImag + k);
+                __m128 br = _mm_loadu_ps(bReal + k);
+                __m128 bi = _mm_loadu_ps(bImag + k);
+                __m128 ar = _mm_loadu_ps(aReal + k);
+                __m128 ai = _mm_loadu_ps(aImag + k);
+
+                __m128 tr = _mm_sub_ps(_mm_mul_ps(br, wr), _mm_mul_ps(bi, wi));
+                __m128 ti = _mm_add_ps(_mm_mul_ps(br, wi), _mm_mul_ps(bi, wr));
+
+                _mm_storeu_ps(aReal + k, _mm_add_ps(ar, tr));
+                _mm_storeu_ps(aImag + k, _mm_add_ps(ai, ti));
+                _mm_storeu_ps(bReal + k, _mm_sub_ps(ar, tr));
+                _mm_storeu_ps(bImag + k, _mm_sub_ps(ai, ti));
+            }
+#endif
+
+            for (; k < halfWidth; k++)
+            {
+                float tr = bReal[k] * twiddleReal[k] - bImag[k] * twiddleImag[k];
+                float ti = bReal[k] * twiddleImag[k] + bImag[k] * twiddleReal[k];
+
+                bReal[k] = aReal[k] - tr;
+                bImag[k] = aImag[k] - ti;
+                aReal[k] += tr;
+                aImag[k] += ti;
+            }
+        }
+    }
+}
+
+//-----------------------------------------------------------------------------
+
+void
+HBGLFFT::Multiply(const float* a, const float* b, float* out, unsigned int count)
+{
+    unsigned int idx = 0;
+
+#if defined(HBGLFFT_USE_SSE)
+    for (; idx + 4 <= count; idx += 4) {
+        _mm_storeu_ps(out + idx, _mm_mul_ps(_mm_loadu_ps(a + idx), _mm_loadu_ps(b + idx)));
+    }
+#endif
+
+    for (; idx < count; idx++) {
+        out[idx] = a[idx] * b[idx];
+    }
+}
+
+//-----------------------------------------------------------------------------
+
+void
+HBGLFFT::Magnitude(const float* real, const float* imag, float* out, unsigned int count, float scale)
+{
+    unsigned int idx = 0;
+
+#if defined(HBGLFFT_USE_SSE)
+    __m128 scale4 = _mm_set1_ps(scale);
+    for (; idx + 4 <= count; idx += 4) {
+        __m128 re = _mm_loadu_ps(real + idx);
+        __m128 im = _mm_loadu_ps(imag + idx);
+        __m128 len = _mm_sqrt_ps(_mm_add_ps(_mm_mul_ps(re, re), _mm_mul_ps(im, im)));
+        _mm_storeu_ps(out + idx, _mm_mul_ps(len, scale4));
+    }
+#endif
+
+    for (; idx < count; idx++) {
+        out[idx] = scale * sqrtf(real[idx] * real[idx] + imag[idx] * imag[idx]);
+    }
+}
+
+//-----------------------------------------------------------------------------
+
+void
+HBGLFFT::BlackmanWindow(float* window, unsigned int count)
+{
+    const double alpha = 0.16;
+    const double a0 = 0.5 * (1.0 - alpha);
+    const double a1 = 0.5;
+    const double a2 = 0.5 * alpha;
+
+    for (unsigned int idx = 0; idx < count; idx++) {
+        double x = double(idx) / double(count);
+        window[idx] = static_cast<float>(a0 - a1 * cos(c_TwoPi * x) + a2 * cos(2.0 * c_TwoPi * x));
+    }
+}
@@ -0,0 +1,55 @@
+#pragma once
+
+#include <vector>
+
+namespace HBGLUtils
+{
+    //-----------------------------------------------------------------------------
+    // Radix-2 complex FFT on split real/imaginary arrays.  The twiddle factors
+    // and bit reversal table are built once in the constructor, so Forward
+    // does no allocation and can run every audio block.  Stages wide enough
+    // to fill a vector register run four butterflies at a time with SSE when
+    // the compiler targets it.
+
+    class HBGLFFT
+    {
+    public:
+
+        // - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+        // CONSTRO/DESTRO
+
+        // size must be a power of two
+        HBGLFFT(unsigned int size);
+        ~HBGLFFT();
+
+        // - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+        // ACCESSORS
+
+        unsigned int GetSize() const;
+
+        // - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+        // TRANSFORMS
+
+        // In place forward transform of GetSize() complex values.
+        void Forward(float* real, float* imag) const;
+
+        // out[i] = a[i] * b[i]
+        static void Multiply(const float* a, const float* b, float* out, unsigned int count);
+
+        // out[i] = scale * |real[i] + i imag[i]|
+        static void Magnitude(const float* real, const float* imag, float* out, unsigned int count, float scale);
+
+        // Fill window with a Blackman window of the given length (the window
+        // Web Audio analysers apply before their FFT).
+        static void BlackmanWindow(float* window, unsigned int count);
+
+    private:
+
+        unsigned int                m_size;
+        std::vector<unsigned int>   m_bitReverse;
+
+        // twiddles for the stage with half width h start at index h - 1
+        std::vector<float>          m_twiddleReal;
+        std::vector<float>          m_twiddleImag;
+    };
+}
@@ -0,0 +1,336 @@
+#include "HBGLFileWatcher.h"
+#include "HBGLUtils.h"
+
+#include <iostream>
+
+#if defined(_WIN32)
+#include <Windows.h>
+#else
+#include <sys/stat.h>
+#endif
+
+#if defined(__linux__)
+#include <sys/inotify.h>
+#include <poll.h>
+#include <unistd.h>
+#endif
+
+using namespace HBGLUtils;
+
+// how long the watch thread sleeps between looks at the file system
+static const int c_WatchIntervalMillisecs = 10;
+static const int c_PollIntervalMillisecs = 25;
+
+//-----------------------------------------------------------------------------
+
+HBGLFileWatcher::HBGLFileWatcher(unsigned int debounceMillisecs) :
+#if defined(__linux__)
+m_inotifyDescriptor(-1),
+#endif
+m_debounceInterval(debounceMillisecs),
+m_watchListChanged(false)
+{
+    m_hasChanges.store(false);
+    m_stopWatching.store(false);
+}
+
+//-----------------------------------------------------------------------------
+
+HBGLFileWatcher::~HBGLFileWatcher()
+{
+    Stop();
+}
+
+//-----------------------------------------------------------------------------
+
+bool
+HBGLFileWatcher::Start()
+{
+    if (m_watchThread.joinable()) {
+        return true;
+    }
+
+#if defined(__linux__)
+    m_inotifyDescriptor = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (m_inotifyDescriptor < 0) {
+        std::cerr << "HBGLFileWatcher ERROR: inotify is not available, file changes will not be seen" << std::endl;
+        return false;
+    }
+#endif
+
+    m_stopWatching.store(false);
+    m_watchThread = std::thread(&HBGLFileWatcher::WatchLoop, this);
+
+    return true;
+}
+
+//-----------------------------------------------------------------------------
+
+void
+HBGLFileWatcher::Stop()
+{
+    m_stopWatching.store(true);
+    if (m_watchThread.joinable()) {
+        m_watchThread.join();
+    }
+
+#if defined(__linux__)
+    if (m_inotifyDescriptor >= 0) {
+        close(m_inotifyDescriptor);
+        m_inotifyDescriptor = -1;
+    }
+    m_directoryWatches.clear();
+#endif
+}
+
+//-----------------------------------------------------------------------------
+
+bool
+HBGLFileWatcher::HasChanges() const
+{
+    return m_hasChanges.load(std::memory_order_acquire);
+}
+
+//-----------------------------------------------------------------------------
+
+void
+HBGLFileWatcher::SetWatchedFiles(const std::vector<std::string>& filePaths)
+{
+    std::vector<WatchedFile> watchedFiles;
+
+    for (size_t pathIdx = 0; pathIdx < filePaths.size(); pathIdx++)
+    {
+        WatchedFile watchedFile;
+        watchedFile.filePath = filePaths[pathIdx];
+        watchedFile.modifiedTime = 0;
+        watchedFile.fileSize = 0;
+        GetFileStamp(watchedFile.filePath.c_str(), watchedFile.modifiedTime, watchedFile.fileSize);
+
+        // A directory (an image sequence, say) is watched directly.  A file
+        // is watched through its parent, which survives the file being
+        // replaced.
+        std::string trimmedPath = watchedFile.filePath;
+        while (trimmedPath.size() > 1 && (trimmedPath.back() == '/' || trimmedPath.back() == '\\')) {
+            trimmedPath.pop_back();
+        }
+
+#if defined(_WIN32)
+        DWORD attributes = GetFileAttributesA(trimmedPath.c_str());
+        watchedFile.isDirectory = (attributes != INVALID_FILE_ATTRIBUTES) && (attributes & FILE_ATTRIBUTE_DIRECTORY);
+#else
+        struct stat pathStat;
+        watchedFile.isDirectory = (stat(trimmedPath.c_str(), &pathStat) == 0) && S_ISDIR(pathStat.st_mode);
+#endif
+
+        size_t separatorPos = trimmedPath.find_last_of("/\\");
+        if (watchedFile.isDirectory) {
+            watchedFile.watchDirectory = trimmedPath;
+        }
+        else if (separatorPos == std::string::npos) {
+            watchedFile.watchDirectory = ".";
+            watchedFile.fileName = trimmedPath;
+        }
+        else {
+            watchedFile.watchDirectory = trimmedPath.substr(0, separatorPos);
+            watchedFile.fileName = trimmedPath.substr(separatorPos + 1);
+        }
+
+        watchedFiles.push_back(watchedFile);
+    }
+
+    std::lock_guard<std::mutex> lock(m_watchMutex);
+    m_watchedFiles.swap(watchedFiles);
+    m_watchListChanged = true;
+}
+
+//-----------------------------------------------------------------------------
+
+bool
+HBGLFileWatcher::TakeChanges(std::vector<std::string>& changedFiles)
+{
+    changedFiles.clear();
+
+    if (!m_hasChanges.load(std::memory_order_acquire)) {
+        return false;
+    }
+
+    std::lock_guard<std::mutex> lock(m_watchMutex);
+    changedFiles.swap(m_settledChanges);
+    m_hasChanges.store(false);
+
+    return !changedFiles.empty();
+}
+
+//-----------------------------------------------------------------------------
+
+void
+HBGLFileWatcher::NoteChanged(const std::string& filePath, WatchClock::time_point now)
+{
+    // every new event restarts the quiet period for that file
+    m_pendingChanges[filePath] = now;
+}
+
+//-----------------------------------------------------------------------------
+
+void
+HBGLFileWatcher::FlushSettledChanges(WatchClock::time_point now)
+{
+    std::map<std::string, WatchClock::time_point>::iterator pendingIter = m_pendingChanges.begin();
+    while (pendingIter != m_pendingChanges.end())
+    {
+        if (now - pendingIter->second < m_debounceInterval) {
+            ++pendingIter;
+            continue;
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(m_watchMutex);
+            m_settledChanges.push_back(pendingIter->first);
+            m_hasChanges.store(true, std::memory_order_release);
+        }
+        m_pendingChanges.erase(pendingIter++);
+    }
+}
+
+//-----------------------------------------------------------------------------
+
+void
+HBGLFileWatcher::WatchLoop()
+{
+    while (!m_stopWatching.load())
+    {
+#if defined(__linux__)
+
+        SyncDirectoryWatches();
+
+        pollfd inotifyPoll;
+        inotifyPoll.fd = m_inotifyDescriptor;
+        inotifyPoll.events = POLLIN;
+        inotifyPoll.revents = 0;
+
+        // the timeout bounds how late a debounced change can be reported
+        int pollResult = poll(&inotifyPoll, 1, c_WatchIntervalMillisecs);
+        WatchClock::time_point now = WatchClock::now();
+
+        if (pollResult > 0 && (inotifyPoll.revents & POLLIN)) {
+            ReadDirectoryEvents(now);
+        }
+
+#else
+
+        std::this_thread::sleep_for(std::chrono::milliseconds(c_PollIntervalMillisecs));
+        WatchClock::time_point now = WatchClock::now();
+        PollWatchedFiles(now);
+
+#endif
+
+        FlushSettledChanges(now);
+    }
+}
+
+#if defined(__linux__)
+
+//-----------------------------------------------------------------------------
+
+void
+HBGLFileWatcher::SyncDirectoryWatches()
+{
+    std::lock_guard<std::mutex> lock(m_watchMutex);
+    if (!m_watchListChanged) {
+        return;
+    }
+    m_watchListChanged = false;
+
+    for (std::map<int, std::string>::const_iterator watchIter = m_directoryWatches.begin();
+        watchIter != m_directoryWatches.end();
+        watchIter++)
+    {
+        inotify_rm_watch(m_inotifyDescriptor, watchIter->first);
+    }
+    m_directoryWatches.clear();
+
+    const uint32_t watchMask = IN_CLOSE_WRITE | IN_MODIFY | IN_MOVED_TO | IN_CREATE | IN_DELETE;
+
+    for (size_t fileIdx = 0; fileIdx < m_watchedFiles.size(); fileIdx++)
+    {
+        const std::string& watchDirectory = m_watchedFiles[fileIdx].watchDirectory;
+        int watchDescriptor = inotify_add_watch(m_inotifyDescriptor, watchDirectory.c_str(), watchMask);
+        if (watchDescriptor < 0) {
+            std::cerr << "HBGLFileWatcher ERROR: could not watch [ " << watchDirectory << " ] " << std::endl;
+            continue;
+        }
+
+        // the same directory always maps to the same descriptor
+        m_directoryWatches[watchDescriptor] = watchDirectory;
+    }
+}
+
+//-----------------------------------------------------------------------------
+
+void
+HBGLFileWatcher::ReadDirectoryEvents(WatchClock::time_point now)
+{
+    char eventBuffer[4096] __attribute__((aligned(__alignof__(struct inotify_event))));
+
+    for (;;)
+    {
+        ssize_t bytesRead = read(m_inotifyDescriptor, eventBuffer, sizeof(eventBuffer));
+        if (bytesRead <= 0) {
+            break;
+        }
+
+        std::lock_guard<std::mutex> lock(m_watchMutex);
+
+        for (char* eventPtr = eventBuffer; eventPtr < eventBuffer + bytesRead;)
+        {
+            const inotify_event* event = reinterpret_cast<const inotify_event*>(eventPtr);
+            eventPtr += sizeof(inotify_event) + event->len;
+
+            std::map<int, std::string>::const_iterator watchIter = m_directoryWatches.find(event->wd);
+            if (watchIter == m_directoryWatches.end()) {
+                continue;
+            }
+
+            for (size_t fileIdx = 0; fileIdx < m_watchedFiles.size(); fileIdx++)
+            {
+                const WatchedFile& watchedFile = m_watchedFiles[fileIdx];
+                if (watchedFile.watchDirectory != watchIter->second) {
+                    continue;
+                }
+
+                if (watchedFile.isDirectory || (event->len > 0 && watchedFile.fileName == event->name)) {
+                    NoteChanged(watchedFile.filePath, now);
+                }
+            }
+        }
+    }
+}
+
+#else
+
+//-----------------------------------------------------------------------------
+
+void
+HBGLFileWatcher::PollWatchedFiles(WatchClock::time_point now)
+{
+    std::lock_guard<std::mutex> lock(m_watchMutex);
+    m_watchListChanged = false;
+
+    for (size_t fileIdx = 0; fileIdx < m_watchedFiles.size(); fileIdx++)
+    {
+        WatchedFile& watchedFile = m_watchedFiles[fileIdx];
+
+        long long modifiedTime = 0;
+        long long fileSize = 0;
+        GetFileStamp(watchedFile.filePath.c_str(), modifiedTime, fileSize);
+
+        if (modifiedTime != watchedFile.modifiedTime || fileSize != watchedFile.fileSize)
+        {
+            watchedFile.modifiedTime = modifiedTime;
+            watchedFile.fileSize = fileSize;
+            NoteChanged(watchedFile.filePath, now);
+        }
+    }
+}
+
+#endif
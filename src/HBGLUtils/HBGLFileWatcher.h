@@ -0,0 +1,97 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace HBGLUtils
+{
+    //-----------------------------------------------------------------------------
+    // Watches a set of files (or directories) on a background thread and
+    // reports the ones that changed.  On Linux the thread sleeps on inotify
+    // events for the parent directories, so editors that save by writing a
+    // new file and renaming it over the old one are still caught.  Everywhere
+    // else it polls the modification time and size of each file.
+    //
+    // Editors tend to save in bursts of writes, so a file is only reported
+    // once it has been quiet for the debounce interval.  HasChanges is a
+    // single atomic load, which lets the render thread check every frame
+    // without touching the file system.
+
+    class HBGLFileWatcher
+    {
+    public:
+
+        // - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+        // CONSTRO/DESTRO
+
+        HBGLFileWatcher(unsigned int debounceMillisecs = 50);
+        ~HBGLFileWatcher();
+
+        bool Start();
+        void Stop();
+
+        // - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+        // ACCESSORS
+
+        bool HasChanges() const;
+
+        // - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+        // MODIFIERS
+
+        // Replace the set of watched paths.  Changes are reported with the
+        // path exactly as it was given here.
+        void SetWatchedFiles(const std::vector<std::string>& filePaths);
+
+        // Move every path that changed since the last call into changedFiles.
+        // Returns false if nothing changed.
+        bool TakeChanges(std::vector<std::string>& changedFiles);
+
+    private:
+
+        typedef std::chrono::steady_clock WatchClock;
+
+        struct WatchedFile {
+            std::string         filePath;
+            std::string         watchDirectory;
+            std::string         fileName;
+            bool                isDirectory;
+            long long           modifiedTime;
+            long long           fileSize;
+        };
+
+        void WatchLoop();
+        void NoteChanged(const std::string& filePath, WatchClock::time_point now);
+        void FlushSettledChanges(WatchClock::time_point now);
+
+#if defined(__linux__)
+        void SyncDirectoryWatches();
+        void ReadDirectoryEvents(WatchClock::time_point now);
+
+        int                                 m_inotifyDescriptor;
+        std::map<int, std::string>          m_directoryWatches;
+#else
+        void PollWatchedFiles(WatchClock::time_point now);
+#endif
+
+        std::chrono::milliseconds           m_debounceInterval;
+
+        std::mutex                          m_watchMutex;
+        std::vector<WatchedFile>            m_watchedFiles;
+        bool                                m_watchListChanged;
+
+        std::map<std::string, WatchClock::time_point> m_pendingChanges;
+        std::vector<std::string>            m_settledChanges;
+        std::atomic<bool>                   m_hasChanges;
+
+        std::atomic<bool>                   m_stopWatching;
+        std::thread                         m_watchThread;
+    };
+
+    typedef std::shared_ptr<HBGLFileWatcher> HBGLFileWatcherPtr;
+}
@@ -0,0 +1,107 @@
+#include "HBGLFrameArena.h"
+
+#include <cstdarg>
+#include <cstdio>
+
+using namespace HBGLUtils;
+
+//-----------------------------------------------------------------------------
+
+HBGLFrameArena::HBGLFrameArena(size_t capacity) :
+m_block(capacity > 0 ? capacity : 1),
+m_usedSize(0),
+m_highWaterSize(0),
+m_overflowCount(0)
+{
+}
+
+//-----------------------------------------------------------------------------
+
+HBGLFrameArena::~HBGLFrameArena()
+{
+}
+
+//-----------------------------------------------------------------------------
+
+size_t
+HBGLFrameArena::GetCapacity() const
+{
+    return m_block.size();
+}
+
+//-----------------------------------------------------------------------------
+
+size_t
+HBGLFrameArena::GetUsedSize() const
+{
+    return m_usedSize;
+}
+
+//-----------------------------------------------------------------------------
+
+size_t
+HBGLFrameArena::GetHighWaterSize() const
+{
+    return (m_usedSize > m_highWaterSize) ? m_usedSize : m_highWaterSize;
+}
+
+//-----------------------------------------------------------------------------
+
+unsigned long long
+HBGLFrameArena::GetOverflowCount() const
+{
+    return m_overflowCount;
+}
+
+//-----------------------------------------------------------------------------
+
+void*
+HBGLFrameArena::Alloc(size_t size, size_t align)
+{
+    // aligned relative to the block's address, not its start
+    size_t blockAddress = size_t(&m_block[0]);
+    size_t offset = ((blockAddress + m_usedSize + align - 1) & ~(align - 1)) - blockAddress;
+
+    if (offset > m_block.size() || size > m_block.size() - offset) {
+        m_overflowCount++;
+        return NULL;
+    }
+
+    m_usedSize = offset + size;
+    return &m_block[offset];
+}
+
+//-----------------------------------------------------------------------------
+
+const char*
+HBGLFrameArena::Format(const char* format, ...)
+{
+    size_t availableSize = m_block.size() - m_usedSize;
+    char* text = &m_block[0] + m_usedSize;
+
+    va_list args;
+    va_start(args, format);
+    int textLength = vsnprintf(text, availableSize, format, args);
+    va_end(args);
+
+    // vsnprintf reports the length it wanted, which the terminator has to
+    // fit after as well
+    if (textLength < 0 || size_t(textLength) >= availableSize) {
+        m_overflowCount++;
+        return NULL;
+    }
+
+    m_usedSize += size_t(textLength) + 1;
+    return text;
+}
+
+//-----------------------------------------------------------------------------
+
+void
+HBGLFrameArena::Reset()
+{
+    if (m_usedSize > m_highWaterSize) {
+        m_highWaterSize = m_usedSize;
+    }
+    m_usedSize = 0;
+}
@@ -0,0 +1,61 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+namespace HBGLUtils
+{
+    //-----------------------------------------------------------------------------
+    // Scratch memory that lives for one frame.  Allocating bumps an offset into
+    // one block made up front, and Reset hands the whole block back at once,
+    // so transient per-frame data (overlay text and the like) never touches
+    // the heap.  Nothing is destructed on Reset; only put plain data here.
+    // When a frame asks for more than the block holds, Alloc returns NULL and
+    // the miss is counted so the capacity can be raised.  Render thread only.
+
+    class HBGLFrameArena
+    {
+    public:
+
+        // - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+        // CONSTRO/DESTRO
+
+        explicit HBGLFrameArena(size_t capacity);
+        ~HBGLFrameArena();
+
+        // - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+        // ACCESSORS
+
+        size_t GetCapacity() const;
+        size_t GetUsedSize() const;
+
+        // Most any frame has used since the arena was made.
+        size_t GetHighWaterSize() const;
+
+        // Allocations that didn't fit, over the arena's life.
+        unsigned long long GetOverflowCount() const;
+
+        // - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+        // MODIFIERS
+
+        // align must be a power of two.  NULL if the frame has run out.
+        void* Alloc(size_t size, size_t align = sizeof(void*));
+
+        // printf into the arena.  NULL if the text doesn't fit.
+        const char* Format(const char* format, ...);
+
+        // Start the next frame; everything handed out so far is invalid.
+        void Reset();
+
+    private:
+
+        // not copyable, what it hands out points into its block
+        HBGLFrameArena(const HBGLFrameArena&);
+        HBGLFrameArena& operator=(const HBGLFrameArena&);
+
+        std::vector<char>       m_block;
+        size_t                  m_usedSize;
+        size_t                  m_highWaterSize;
+        unsigned long long      m_overflowCount;
+    };
+}
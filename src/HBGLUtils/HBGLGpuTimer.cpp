@@ -0,0 +1,121 @@
+#include "HBGLGpuTimer.h"
+#include "HBGLUtils.h"
+
+using namespace HBGLUtils;
+
+//-----------------------------------------------------------------------------
+
+HBGLGpuTimer::HBGLGpuTimer(unsigned int queryCount) :
+m_queryCount(queryCount < 2 ? 2 : queryCount),
+m_oldestPending(0),
+m_pendingCount(0),
+m_timing(false)
+{
+}
+
+//-----------------------------------------------------------------------------
+
+HBGLGpuTimer::~HBGLGpuTimer()
+{
+    Release();
+}
+
+//-----------------------------------------------------------------------------
+
+void
+HBGLGpuTimer::Release()
+{
+    if (!m_queries.empty()) {
+        glDeleteQueries(GLsizei(m_queries.size()), &m_queries[0]);
+        m_queries.clear();
+    }
+
+    m_queryTags.clear();
+    m_oldestPending = 0;
+    m_pendingCount = 0;
+    m_timing = false;
+}
+
+//-----------------------------------------------------------------------------
+
+bool
+HBGLGpuTimer::IsSupported() const
+{
+    return (GLEW_VERSION_3_3 || GLEW_ARB_timer_query) ? true : false;
+}
+
+//-----------------------------------------------------------------------------
+
+bool
+HBGLGpuTimer::Begin(unsigned long long tag)
+{
+    if (m_timing || !IsSupported()) {
+        return false;
+    }
+
+    // the queries are made on first use, when a context is sure to be current
+    if (m_queries.empty()) {
+        m_queries.resize(m_queryCount);
+        m_queryTags.resize(m_queryCount);
+        glGenQueries(GLsizei(m_queryCount), &m_queries[0]);
+        HB_CHECK_GL_ERROR();
+    }
+
+    if (m_pendingCount == m_queryCount) {
+        return false;
+    }
+
+    unsigned int queryIdx = (m_oldestPending + m_pendingCount) % m_queryCount;
+    m_queryTags[queryIdx] = tag;
+    glBeginQuery(GL_TIME_ELAPSED, m_queries[queryIdx]);
+
+    m_timing = true;
+    return true;
+}
+
+//-----------------------------------------------------------------------------
+
+void
+HBGLGpuTimer::End()
+{
+    if (!m_timing) {
+        return;
+    }
+
+    glEndQuery(GL_TIME_ELAPSED);
+    HB_CHECK_GL_ERROR();
+
+    m_pendingCount++;
+    m_timing = false;
+}
+
+//-----------------------------------------------------------------------------
+
+bool
+HBGLGpuTimer::TakeResult(unsigned long long& tag, double& millisecs)
+{
+    if (m_pendingCount == 0) {
+        return false;
+    }
+
+    // queries finish in the order they were issued, so only the oldest one
+    // needs to be asked
+    GLuint query = m_queries[m_oldestPending];
+    GLint available = 0;
+    glGetQueryObjectiv(query, GL_QUERY_RESULT_AVAILABLE, &available);
+    if (!available) {
+        return false;
+    }
+
+    GLuint64 elapsedNanosecs = 0;
+    glGetQueryObjectui64v(query, GL_QUERY_RESULT, &elapsedNanosecs);
+    HB_CHECK_GL_ERROR();
+
+    tag = m_queryTags[m_oldestPending];
+    millisecs = double(elapsedNanosecs) * 1e-6;
+
+    m_oldestPending = (m_oldestPending + 1) % m_queryCount;
+    m_pendingCount--;
+
+    return true;
+}
@@ -0,0 +1,64 @@
+#pragma once
+
+#include <memory>
+#include <vector>
+
+#include <GL/glew.h>
+
+namespace HBGLUtils
+{
+    //-----------------------------------------------------------------------------
+    // Measures how long the GPU spends on a span of GL commands with
+    // GL_TIME_ELAPSED queries.  Results arrive a few frames after the commands
+    // were issued, so the timer keeps a small ring of queries in flight and
+    // only ever reads the ones the driver reports as available; it never
+    // stalls the pipeline waiting for a result.  Each span carries a tag so
+    // callers can tell which draw (or which program) a late result belongs
+    // to.  Spans cannot nest.
+
+    class HBGLGpuTimer
+    {
+    public:
+
+        // - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+        // CONSTRO/DESTRO
+
+        HBGLGpuTimer(unsigned int queryCount = 8);
+        ~HBGLGpuTimer();
+
+        // Delete the query objects.  Call with the context that issued them
+        // still current.
+        void Release();
+
+        // - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+        // ACCESSORS
+
+        bool IsSupported() const;
+
+        // - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+        // MODIFIERS
+
+        // Returns false (and times nothing) when timer queries are not
+        // supported or every query is still waiting on the GPU.
+        bool Begin(unsigned long long tag);
+        void End();
+
+        // Oldest finished span, if any.  Call until it returns false.
+        bool TakeResult(unsigned long long& tag, double& millisecs);
+
+    private:
+
+        // not copyable, the query objects are owned by exactly one timer
+        HBGLGpuTimer(const HBGLGpuTimer&);
+        HBGLGpuTimer& operator=(const HBGLGpuTimer&);
+
+        std::vector<GLuint>                 m_queries;
+        std::vector<unsigned long long>     m_queryTags;
+        unsigned int                        m_queryCount;
+        unsigned int                        m_oldestPending;
+        unsigned int                        m_pendingCount;
+        bool                                m_timing;
+    };
+
+    typedef std::shared_ptr<HBGLGpuTimer> HBGLGpuTimerPtr;
+}
@@ -0,0 +1,187 @@
+#include "HBGLMappedFile.h"
+
+#include <iostream>
+
+#if defined(_WIN32)
+#include <Windows.h>
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+using namespace HBGLUtils;
+
+//-----------------------------------------------------------------------------
+
+HBGLMappedFile::HBGLMappedFile() :
+m_filePath(""),
+m_data(NULL),
+m_size(0),
+#if defined(_WIN32)
+m_fileHandle(INVALID_HANDLE_VALUE),
+m_mappingHandle(NULL)
+#else
+m_fileDescriptor(-1)
+#endif
+{
+}
+
+//-----------------------------------------------------------------------------
+
+HBGLMappedFile::~HBGLMappedFile()
+{
+    Close();
+}
+
+//-----------------------------------------------------------------------------
+
+const char*
+HBGLMappedFile::GetData() const
+{
+    return m_data;
+}
+
+//-----------------------------------------------------------------------------
+
+size_t
+HBGLMappedFile::GetSize() const
+{
+    return m_size;
+}
+
+//-----------------------------------------------------------------------------
+
+bool
+HBGLMappedFile::IsOpen() const
+{
+#if defined(_WIN32)
+    return m_fileHandle != INVALID_HANDLE_VALUE;
+#else
+    return m_fileDescriptor >= 0;
+#endif
+}
+
+//-----------------------------------------------------------------------------
+
+const std::string&
+HBGLMappedFile::GetFilePath() const
+{
+    return m_filePath;
+}
+
+//-----------------------------------------------------------------------------
+
+bool
+HBGLMappedFile::Open(const std::string& filePath)
+{
+    Close();
+
+#if defined(_WIN32)
+
+    m_fileHandle = CreateFileA(filePath.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE,
+        NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+
+    if (m_fileHandle == INVALID_HANDLE_VALUE) {
+        std::cerr << "HBGLMappedFile ERROR: Could not open file [ " << filePath << " ] " << std::endl;
+        return false;
+    }
+
+    LARGE_INTEGER fileSize;
+    if (!GetFileSizeEx(m_fileHandle, &fileSize)) {
+        std::cerr << "HBGLMappedFile ERROR: Could not query the size of [ " << filePath << " ] " << std::endl;
+        Close();
+        return false;
+    }
+
+    m_size = static_cast<size_t>(fileSize.QuadPart);
+    m_filePath = filePath;
+
+    if (m_size == 0) {
+        return true;
+    }
+
+    m_mappingHandle = CreateFileMappingA(m_fileHandle, NULL, PAGE_READONLY, 0, 0, NULL);
+    if (m_mappingHandle == NULL) {
+        std::cerr << "HBGLMappedFile ERROR: Could not create a mapping for [ " << filePath << " ] " << std::endl;
+        Close();
+        return false;
+    }
+
+    m_data = static_cast<const char*>(MapViewOfFile(m_mappingHandle, FILE_MAP_READ, 0, 0, 0));
+
+#else
+
+    m_fileDescriptor = open(filePath.c_str(), O_RDONLY);
+    if (m_fileDescriptor < 0) {
+        std::cerr << "HBGLMappedFile ERROR: Could not open file [ " << filePath << " ] " << std::endl;
+        return false;
+    }
+
+    struct stat fileStat;
+    if (fstat(m_fileDescriptor, &fileStat) != 0) {
+        std::cerr << "HBGLMappedFile ERROR: Could not query the size of [ " << filePath << " ] " << std::endl;
+        Close();
+        return false;
+    }
+
+    m_size = static_cast<size_t>(fileStat.st_size);
+    m_filePath = filePath;
+
+    if (m_size == 0) {
+        return true;
+    }
+
+    void* mapping = mmap(NULL, m_size, PROT_READ, MAP_PRIVATE, m_fileDescriptor, 0);
+    m_data = (mapping == MAP_FAILED) ? NULL : static_cast<const char*>(mapping);
+
+#endif
+
+    if (m_data == NULL) {
+        std::cerr << "HBGLMappedFile ERROR: Could not map the contents of [ " << filePath << " ] " << std::endl;
+        Close();
+        return false;
+    }
+
+    return true;
+}
+
+//-----------------------------------------------------------------------------
+
+void
+HBGLMappedFile::Close()
+{
+#if defined(_WIN32)
+
+    if (m_data != NULL) {
+        UnmapViewOfFile(m_data);
+    }
+
+    if (m_mappingHandle != NULL) {
+        CloseHandle(m_mappingHandle);
+        m_mappingHandle = NULL;
+    }
+
+    if (m_fileHandle != INVALID_HANDLE_VALUE) {
+        CloseHandle(m_fileHandle);
+        m_fileHandle = INVALID_HANDLE_VALUE;
+    }
+
+#else
+
+    if (m_data != NULL) {
+        munmap(const_cast<char*>(m_data), m_size);
+    }
+
+    if (m_fileDescriptor >= 0) {
+        close(m_fileDescriptor);
+        m_fileDescriptor = -1;
+    }
+
+#endif
+
+    m_data = NULL;
+    m_size = 0;
+    m_filePath.clear();
+}
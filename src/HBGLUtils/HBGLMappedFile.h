@@ -0,0 +1,57 @@
+#pragma once
+
+#include <string>
+#include <memory>
+
+namespace HBGLUtils
+{
+    //-----------------------------------------------------------------------------
+    // Read-only memory mapping of a file.  The whole file is mapped into the
+    // address space on Open and stays valid until Close (or destruction), so
+    // callers can hand out raw pointers into the file without copying it.
+    // Zero length files open successfully but have a NULL data pointer.
+
+    class HBGLMappedFile
+    {
+    public:
+
+        // - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+        // CONSTRO/DESTRO
+
+        HBGLMappedFile();
+        ~HBGLMappedFile();
+
+        // - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+        // ACCESSORS
+
+        const char* GetData() const;
+        size_t GetSize() const;
+        bool IsOpen() const;
+        const std::string& GetFilePath() const;
+
+        // - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+        // MODIFIERS
+
+        bool Open(const std::string& filePath);
+        void Close();
+
+    private:
+
+        // not copyable, the mapping is owned by exactly one object
+        HBGLMappedFile(const HBGLMappedFile&);
+        HBGLMappedFile& operator=(const HBGLMappedFile&);
+
+        std::string     m_filePath;
+        const char*     m_data;
+        size_t          m_size;
+
+#if defined(_WIN32)
+        void*           m_fileHandle;
+        void*           m_mappingHandle;
+#else
+        int             m_fileDescriptor;
+#endif
+    };
+
+    typedef std::shared_ptr<HBGLMappedFile> HBGLMappedFilePtr;
+}
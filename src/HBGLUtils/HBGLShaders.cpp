@@ -1,11 +1,14 @@
 
 #include "HBGLShaders.h"
 #include "HBGLUtils.h"
+#include "HBGLMappedFile.h"
 
+#include <algorithm>
 #include <fstream>
 #include <string>
 #include <cstdlib>
 #include <cstdio>
+#include <cstring>
 
 using namespace HBGLUtils;
 
@@ -15,6 +18,50 @@ using namespace HBGLUtils;
 // STATIC FUNCTIONS
 // ,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,
 
+// Orders bound values by name against each other and against a bare name;
+// debug builds of the standard library check the order both ways round.
+struct BoundValueLess
+{
+    bool operator()(const HBGLBoundValuesMap::value_type& lhs, const HBGLBoundValuesMap::value_type& rhs) const
+    {
+        return lhs.first < rhs.first;
+    }
+
+    bool operator()(const HBGLBoundValuesMap::value_type& lhs, const char* rhs) const
+    {
+        return strcmp(lhs.first.c_str(), rhs) < 0;
+    }
+
+    bool operator()(const char* lhs, const HBGLBoundValuesMap::value_type& rhs) const
+    {
+        return strcmp(lhs, rhs.first.c_str()) < 0;
+    }
+};
+
+// ---------------------------------------------------------------
+
+// NULL if name isn't bound.
+static const GLint*
+FindBoundValue(const HBGLBoundValuesMap& boundValues, const char* name)
+{
+    HBGLBoundValuesMap::const_iterator bvIter = std::lower_bound(boundValues.begin(), boundValues.end(), name, BoundValueLess());
+    if (bvIter == boundValues.end() || strcmp(bvIter->first.c_str(), name) != 0) {
+        return NULL;
+    }
+    return &bvIter->second;
+}
+
+// ---------------------------------------------------------------
+
+static void
+InsertBoundValue(HBGLBoundValuesMap& boundValues, const char* name, GLint value)
+{
+    HBGLBoundValuesMap::iterator bvIter = std::lower_bound(boundValues.begin(), boundValues.end(), name, BoundValueLess());
+    boundValues.insert(bvIter, HBGLBoundValuesMap::value_type(name, value));
+}
+
+// ---------------------------------------------------------------
+
 unsigned long
 HBGLShader::GetFileEndPosition(FILE * file)
 {
@@ -37,8 +84,7 @@ HBGLShader::GetFileEndPosition(FILE * file)
 HBGLShaderProgram::HBGLShaderProgram(const char* name) :
 m_programIndex(0),
 m_programName(name),
-m_attributeIndex(1),
-m_programLog(NULL)
+m_attributeIndex(1)
 {
     m_programIndex = glCreateProgram();
     HB_CHECK_GL_ERROR();
@@ -48,10 +94,6 @@ m_programLog(NULL)
 
 HBGLShaderProgram::~HBGLShaderProgram()
 {
-    if (m_programLog != 0) {
-        free(m_programLog);
-    }
-
     if (m_programIndex != 0) {
         glDeleteProgram(m_programIndex);
         HB_CHECK_GL_ERROR();
@@ -119,11 +161,30 @@ HBGLShaderProgram::_BindAttribLocations()
 // ---------------------------------------------------------------
 
 bool
-HBGLShaderProgram::LoadAndCompileShaders(const std::string& vshFilePath, 
-                                         const std::string& fshFilePath)
+HBGLShaderProgram::_CompileShaders()
 {
-    m_vertShader = HBGLShaderPtr(new HBGLVertexShader(vshFilePath));
-    m_fragShader = HBGLShaderPtr(new HBGLFragmentShader(fshFilePath));
+    // With a binary cache, compiling is left to LinkShaders so a cache hit
+    // never touches the compiler.  Only make sure there is something to build.
+    if (!m_binaryCacheDirectory.empty())
+    {
+        const GLchar* vertSource = m_vertShader->GetSource();
+        const GLchar* fragSource = m_fragShader->GetSource();
+
+        bool result = true;
+        if (vertSource == NULL || vertSource[0] == 0)
+        {
+            std::cerr << "HBGLShaderProgram ERROR [ " << this->GetName() << " ]: no source for vertex shader [ " << m_vertShader->GetName() << " ] " << std::endl;
+            result &= false;
+        }
+
+        if (fragSource == NULL || fragSource[0] == 0)
+        {
+            std::cerr << "HBGLShaderProgram ERROR [ " << this->GetName() << " ]: no source for frag shader [ " << m_fragShader->GetName() << " ] " << std::endl;
+            result &= false;
+        }
+
+        return result;
+    }
 
     bool result = true;
     if (!m_vertShader->CompileShader())
@@ -143,6 +204,18 @@ HBGLShaderProgram::LoadAndCompileShaders(const std::string& vshFilePath,
 
 // ---------------------------------------------------------------
 
+bool
+HBGLShaderProgram::LoadAndCompileShaders(const std::string& vshFilePath, 
+                                         const std::string& fshFilePath)
+{
+    m_vertShader = HBGLShaderPtr(new HBGLVertexShader(vshFilePath));
+    m_fragShader = HBGLShaderPtr(new HBGLFragmentShader(fshFilePath));
+
+    return _CompileShaders();
+}
+
+// ---------------------------------------------------------------
+
 bool
 HBGLShaderProgram::LoadAndCompileShaders(HBGLShaderPtr& vertShaderPtr,
                                          HBGLShaderPtr& fragShaderPtr)
@@ -156,20 +229,7 @@ HBGLShaderProgram::LoadAndCompileShaders(HBGLShaderPtr& vertShaderPtr,
     m_vertShader = vertShaderPtr;
     m_fragShader = fragShaderPtr;
 
-    bool result = true;
-    if (!m_vertShader->CompileShader())
-    {
-        std::cerr << "HBGLShaderProgram ERROR [ " << this->GetName() << " ]: Could not compile vertex shader [ " << m_vertShader->GetName() << " ] " << std::endl;
-        result &= false;
-    }
-
-    if (!m_fragShader->CompileShader())
-    {
-        std::cerr << "HBGLShaderProgram ERROR [ " << this->GetName() << " ]: Could not compile frag shader [ " << m_fragShader->GetName() << " ] " << std::endl;
-        result &= false;
-    }
-
-    return result;
+    return _CompileShaders();
 }
 
 
@@ -185,6 +245,26 @@ HBGLShaderProgram::LinkShaders()
         return false;
     }
 
+    // locations from a previous link may not survive this one
+    m_boundUniformsMap.clear();
+
+    bool useBinaryCache = _IsBinaryCacheSupported();
+    unsigned long long cacheKey = 0;
+
+    if (useBinaryCache)
+    {
+        cacheKey = _ComputeBinaryCacheKey();
+        if (_LoadProgramBinary(cacheKey))
+        {
+            m_vertShader->SetLinked(true);
+            m_fragShader->SetLinked(true);
+            return true;
+        }
+
+        glProgramParameteri(m_programIndex, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+        HB_CHECK_GL_ERROR();
+    }
+
     bool result = true;
 
     result &= _AttachShader(m_vertShader);
@@ -210,6 +290,11 @@ HBGLShaderProgram::LinkShaders()
         m_fragShader->SetLinked(true);
         glDetachShader(m_programIndex, m_fragShader->GetShaderIndex());
         HB_CHECK_GL_ERROR();
+
+        if (useBinaryCache)
+        {
+            _SaveProgramBinary(cacheKey);
+        }
         
 	} else {
         
@@ -235,6 +320,212 @@ HBGLShaderProgram::LinkShaders()
 
 // ---------------------------------------------------------------
 
+// Every cache file starts with this header, followed by binaryLength bytes
+// of the driver's program binary.
+struct HBGLProgramBinaryHeader
+{
+    char                magic[8];
+    unsigned long long  cacheKey;
+    GLenum              binaryFormat;
+    GLint               binaryLength;
+};
+
+static const char c_ProgramBinaryMagic[8] = { 'H', 'B', 'G', 'L', 'P', 'B', 'I', '1' };
+
+// ---------------------------------------------------------------
+
+void
+HBGLShaderProgram::SetBinaryCacheDirectory(const std::string& cacheDirectory)
+{
+    m_binaryCacheDirectory = cacheDirectory;
+}
+
+// ---------------------------------------------------------------
+
+const std::string&
+HBGLShaderProgram::GetBinaryCacheDirectory() const
+{
+    return m_binaryCacheDirectory;
+}
+
+// ---------------------------------------------------------------
+
+bool
+HBGLShaderProgram::_IsBinaryCacheSupported() const
+{
+    if (m_binaryCacheDirectory.empty() || m_programIndex == 0) {
+        return false;
+    }
+
+    if (!GLEW_VERSION_4_1 && !GLEW_ARB_get_program_binary) {
+        return false;
+    }
+
+    // some drivers expose the entry points but no formats to save in
+    GLint numFormats = 0;
+    glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &numFormats);
+    HB_CHECK_GL_ERROR();
+
+    return numFormats > 0;
+}
+
+// ---------------------------------------------------------------
+
+unsigned long long
+HBGLShaderProgram::_ComputeBinaryCacheKey() const
+{
+    // A binary is only valid for the exact sources it was built from, the
+    // attribute locations bound at link time, and the driver that built it.
+    unsigned long long cacheKey = c_FNV1aOffsetBasis;
+
+    const GLchar* sources[2] = { m_vertShader->GetSource(), m_fragShader->GetSource() };
+    for (int sourceIdx = 0; sourceIdx < 2; sourceIdx++)
+    {
+        const GLchar* source = sources[sourceIdx] ? sources[sourceIdx] : "";
+        cacheKey = HashFNV1a(source, strlen(source) + 1, cacheKey);
+    }
+
+    for (HBGLBoundValuesMap::const_iterator iter = m_boundAttributesMap.begin();
+        iter != m_boundAttributesMap.end();
+        iter++)
+    {
+        cacheKey = HashFNV1a(iter->first.c_str(), iter->first.length() + 1, cacheKey);
+        cacheKey = HashFNV1a(&iter->second, sizeof(iter->second), cacheKey);
+    }
+
+    const GLenum driverStrings[3] = { GL_VENDOR, GL_RENDERER, GL_VERSION };
+    for (int stringIdx = 0; stringIdx < 3; stringIdx++)
+    {
+        const char* driverString = reinterpret_cast<const char*>(glGetString(driverStrings[stringIdx]));
+        if (driverString) {
+            cacheKey = HashFNV1a(driverString, strlen(driverString) + 1, cacheKey);
+        }
+    }
+
+    return cacheKey;
+}
+
+// ---------------------------------------------------------------
+
+std::string
+HBGLShaderProgram::_GetBinaryCachePath(unsigned long long cacheKey) const
+{
+    char fileName[32];
+    sprintf(fileName, "/%016llx.glbin", cacheKey);
+
+    return m_binaryCacheDirectory + fileName;
+}
+
+// ---------------------------------------------------------------
+
+bool
+HBGLShaderProgram::_LoadProgramBinary(unsigned long long cacheKey)
+{
+    std::string cachePath = _GetBinaryCachePath(cacheKey);
+
+    FILE* cacheFile = fopen(cachePath.c_str(), "rb");
+    if (!cacheFile) {
+        return false;
+    }
+
+    HBGLProgramBinaryHeader header;
+    bool headerValid = (fread(&header, sizeof(header), 1, cacheFile) == 1) &&
+        (memcmp(header.magic, c_ProgramBinaryMagic, sizeof(c_ProgramBinaryMagic)) == 0) &&
+        (header.cacheKey == cacheKey) &&
+        (header.binaryLength > 0);
+
+    std::vector<char> binary;
+    if (headerValid) {
+        binary.resize(header.binaryLength);
+        headerValid = (fread(&binary[0], 1, binary.size(), cacheFile) == binary.size());
+    }
+    fclose(cacheFile);
+
+    if (!headerValid) {
+        std::cerr << "HBGLShaderProgram WARNING [ " << this->GetName() << " ]: ignoring damaged program binary [ " << cachePath << " ] " << std::endl;
+        return false;
+    }
+
+    // handing the driver a format it does not know is an error, so check first
+    GLint numFormats = 0;
+    glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &numFormats);
+    std::vector<GLint> formats(numFormats > 0 ? numFormats : 1, 0);
+    glGetIntegerv(GL_PROGRAM_BINARY_FORMATS, &formats[0]);
+    HB_CHECK_GL_ERROR();
+
+    if (std::find(formats.begin(), formats.end(), GLint(header.binaryFormat)) == formats.end()) {
+        return false;
+    }
+
+    glProgramBinary(m_programIndex, header.binaryFormat, &binary[0], header.binaryLength);
+    HB_CHECK_GL_ERROR();
+
+    // a driver update can reject a binary it built itself, which is not an error
+    GLint linkingStatus = GL_FALSE;
+    glGetProgramiv(m_programIndex, GL_LINK_STATUS, &linkingStatus);
+    HB_CHECK_GL_ERROR();
+
+    if (linkingStatus != GL_TRUE) {
+        std::cout << "HBGLShaderProgram [ " << this->GetName() << " ]: stale program binary, recompiling." << std::endl;
+        return false;
+    }
+
+    std::cout << "HBGLShaderProgram [ " << this->GetName() << " ]: loaded program binary [ " << cachePath << " ] " << std::endl;
+    return true;
+}
+
+// ---------------------------------------------------------------
+
+bool
+HBGLShaderProgram::_SaveProgramBinary(unsigned long long cacheKey) const
+{
+    GLint binaryLength = 0;
+    glGetProgramiv(m_programIndex, GL_PROGRAM_BINARY_LENGTH, &binaryLength);
+    HB_CHECK_GL_ERROR();
+
+    if (binaryLength <= 0) {
+        return false;
+    }
+
+    HBGLProgramBinaryHeader header;
+    memcpy(header.magic, c_ProgramBinaryMagic, sizeof(c_ProgramBinaryMagic));
+    header.cacheKey = cacheKey;
+
+    std::vector<char> binary(binaryLength);
+    glGetProgramBinary(m_programIndex, binaryLength, &header.binaryLength, &header.binaryFormat, &binary[0]);
+    HB_CHECK_GL_ERROR();
+
+    if (header.binaryLength <= 0 || !MakeDirectory(m_binaryCacheDirectory.c_str())) {
+        return false;
+    }
+
+    // Write next to the final name and then swap it in, so a kiosk losing
+    // power mid write never leaves a truncated binary behind.
+    std::string cachePath = _GetBinaryCachePath(cacheKey);
+    std::string tempPath = cachePath + ".tmp";
+
+    FILE* cacheFile = fopen(tempPath.c_str(), "wb");
+    if (!cacheFile) {
+        std::cerr << "HBGLShaderProgram ERROR [ " << this->GetName() << " ]: could not write program binary [ " << tempPath << " ] " << std::endl;
+        return false;
+    }
+
+    bool written = (fwrite(&header, sizeof(header), 1, cacheFile) == 1) &&
+        (fwrite(&binary[0], 1, header.binaryLength, cacheFile) == size_t(header.binaryLength));
+    written &= (fclose(cacheFile) == 0);
+
+    remove(cachePath.c_str());
+    if (!written || rename(tempPath.c_str(), cachePath.c_str()) != 0) {
+        std::cerr << "HBGLShaderProgram ERROR [ " << this->GetName() << " ]: could not write program binary [ " << cachePath << " ] " << std::endl;
+        remove(tempPath.c_str());
+        return false;
+    }
+
+    return true;
+}
+
+// ---------------------------------------------------------------
+
 bool
 HBGLShaderProgram::GetProgramLog(std::string* log)
 {
@@ -254,24 +545,16 @@ HBGLShaderProgram::GetProgramLog(std::string* log)
     glGetProgramiv(m_programIndex, GL_INFO_LOG_LENGTH, &logLength);
 	HB_CHECK_GL_ERROR();
 
+    // read straight into the kept log, which only grows when a longer one
+    // comes along
     if (logLength > 1) {
-        if (m_programLog!=0) {
-			free(m_programLog);
-			m_programLog = 0;
-        }
-
-        if ((m_programLog = (GLchar*) malloc(logLength)) == NULL)
-		{
-            *log = "HBGLShaderProgram::LinkerLog ERROR: Out of memory";
-            return false;
-        }
-
-        glGetProgramInfoLog(m_programIndex, logLength, &logLength, m_programLog);
+        m_programLog.resize(logLength);
+        glGetProgramInfoLog(m_programIndex, logLength, &logLength, &m_programLog[0]);
         HB_CHECK_GL_ERROR();
-
+        m_programLog.resize(logLength);
 	}
     
-    if (m_programLog!=0) {
+    if (!m_programLog.empty()) {
         *log = m_programLog;
     }
 
@@ -657,14 +940,14 @@ HBGLShaderProgram::EnableVertexAttrib(const char* varname,
         return false;
     }
      
-    HBGLBoundValuesMap::const_iterator bvIter = m_boundAttributesMap.find(varname);
+    const GLint* boundIndex = FindBoundValue(m_boundAttributesMap, varname);
 
-    if (bvIter == m_boundAttributesMap.end()) {
+    if (!boundIndex) {
         std::cerr << "Unable to enable [ " << varname << " ] since it wasn't bound before linking the shader [ " << m_programName << " ] " << std::endl;
         return false;
     }
 
-    GLint attribIndex = bvIter->second;
+    GLint attribIndex = *boundIndex;
     glEnableVertexAttribArray(attribIndex);
     glVertexAttribPointer(attribIndex, size, type, normalized, stride, pointer);
     HB_CHECK_GL_ERROR();
@@ -681,14 +964,14 @@ HBGLShaderProgram::DisableVertexAttrib(const char* varname) const
         return false;
     }
 
-    HBGLBoundValuesMap::const_iterator bvIter = m_boundAttributesMap.find(varname);
+    const GLint* boundIndex = FindBoundValue(m_boundAttributesMap, varname);
 
-    if (bvIter == m_boundAttributesMap.end()) {
+    if (!boundIndex) {
         std::cerr << "Unable to disable [ " << varname << " ] since it wasn't bound before linking the shader [ " << m_programName << " ] " << std::endl;
         return false;
     }
 
-    GLint attribIndex = bvIter->second;
+    GLint attribIndex = *boundIndex;
     glDisableVertexAttribArray(attribIndex);
     HB_CHECK_GL_ERROR();
 
@@ -724,19 +1007,19 @@ HBGLShaderProgram::_GetAttribLocation(const GLchar* varname,
         return false;
     }
 
-    HBGLBoundValuesMap::const_iterator bvIter = m_boundAttributesMap.find(varname);
+    const GLint* boundIndex = FindBoundValue(m_boundAttributesMap, varname);
 
-    if (bvIter == m_boundAttributesMap.end()) {
+    if (!boundIndex) {
 
-        m_boundAttributesMap[varname] = m_attributeIndex++;
-        *index = (GLint)m_boundAttributesMap[varname];
+        *index = (GLint)m_attributeIndex++;
+        InsertBoundValue(m_boundAttributesMap, varname, *index);
         return true;
 
     }
     else 
     {
 
-        *index = (GLint)bvIter->second;
+        *index = *boundIndex;
         return true;
     }
 }
@@ -760,16 +1043,16 @@ HBGLShaderProgram::_GetUniformLocation(const GLchar* varname,
         return false;
     }
 
-    HBGLBoundValuesMap::const_iterator bvIter = m_boundUniformsMap.find(varname);
+    const GLint* boundIndex = FindBoundValue(m_boundUniformsMap, varname);
 
-    if (bvIter == m_boundUniformsMap.end()) {
+    if (!boundIndex) {
 
-        m_boundUniformsMap[varname] = glGetUniformLocation(m_programIndex, varname);
-        *index = (GLint) m_boundUniformsMap[varname];
+        *index = glGetUniformLocation(m_programIndex, varname);
+        InsertBoundValue(m_boundUniformsMap, varname, *index);
 
     } else {
 
-        *index = (GLint) bvIter->second;
+        *index = *boundIndex;
     }
     if (*index >= 0)
     {
@@ -843,11 +1126,9 @@ HBGLShader::LoadFile(const std::string& filePath)
     m_shaderName = filePath;
     std::string realFilePath = HBGLUtils::GetRealFilePath(filePath.c_str());
 
-    FILE * shaderFile;
-    shaderFile = fopen(realFilePath.c_str(), "r");
-
-    if (!shaderFile) {
-        std::cerr << "STVRFragmentShader ERROR [ " << this->GetName() << " ]: Could not load file [ " << filePath << " ] " << std::endl;
+    HBGLMappedFile shaderFile;
+    if (realFilePath.empty() || !shaderFile.Open(realFilePath)) {
+        std::cerr << "HBGLShader ERROR [ " << this->GetName() << " ]: Could not load file [ " << filePath << " ] " << std::endl;
         return false;
     }
 
@@ -856,39 +1137,18 @@ HBGLShader::LoadFile(const std::string& filePath)
         delete[] m_shaderSource;
     }
 
-    unsigned long bufferSize = HBGLShader::GetFileEndPosition(shaderFile);
-
-    // We are allocating more space then we will need based on overall file length
+    // the whole file in one copy, the mapping closes when shaderFile goes
+    size_t bufferSize = shaderFile.GetSize();
     m_shaderSource = (GLchar*) new char[bufferSize + 1];
-
-    if (m_shaderSource == 0) {
-        std::cerr << "HBGLShader ERROR [ " << this->GetName() << " ]: Unable to allocate memory to keep shader source in memory [ " << realFilePath << " ] " << std::endl;
-        return false;
-    }
-
-    int fileError = 0;
-    unsigned long shaderCharIdx = 0;
-    while (!feof(shaderFile) && !(fileError = ferror(shaderFile)))
-    {
-        char currChar = fgetc(shaderFile);
-        if (currChar != EOF) {
-            m_shaderSource[shaderCharIdx++] = currChar;
-        }
+    if (bufferSize > 0) {
+        memcpy(m_shaderSource, shaderFile.GetData(), bufferSize);
     }
 
     // 0 terminate the shader source
-    m_shaderSource[shaderCharIdx] = 0;
-
-    if (fileError > 0) {
-        std::cerr << "HBGLShader ERROR [ " << this->GetName() << " ]: parsing ShaderToy fragment shader [ " << realFilePath << " ] Error: " << fileError << std::endl;
-        // the shader was invalid, make it an empty string
-        m_shaderSource[0] = 0;
-        return false;
-    }
-
-    fclose(shaderFile);
+    m_shaderSource[bufferSize] = 0;
 
     m_shaderFilePath = realFilePath;
+    m_sourceStringNames.assign(1, realFilePath);
 
 	return true;
 }
@@ -971,6 +1231,20 @@ HBGLShader::GetShaderIndex() const {
 
 // ---------------------------------------------------------------
 
+const GLchar*
+HBGLShader::GetSource() const {
+    return m_shaderSource;
+}
+
+// ---------------------------------------------------------------
+
+const std::vector<std::string>&
+HBGLShader::GetSourceStringNames() const {
+    return m_sourceStringNames;
+}
+
+// ---------------------------------------------------------------
+
 bool
 HBGLShader::GetShaderLog(std::string* log)
 {
@@ -989,24 +1263,16 @@ HBGLShader::GetShaderLog(std::string* log)
     glGetShaderiv(m_shaderIndex, GL_INFO_LOG_LENGTH, &logLength);
 	HB_CHECK_GL_ERROR();
 
-    GLchar* shaderLog = NULL;
+    // read straight into the kept log, which only grows when a longer one
+    // comes along
     if (logLength > 1)
 	{
-        if ((shaderLog = (GLchar*)malloc(logLength)) == NULL)
-		{
-
-			*log = "HBGLShader ERROR: Out of memory";
-            return false;
-        }
-
-        glGetShaderInfoLog(m_shaderIndex, logLength, &logLength, shaderLog);
+        m_shaderLog.resize(logLength);
+        glGetShaderInfoLog(m_shaderIndex, logLength, &logLength, &m_shaderLog[0]);
 		HB_CHECK_GL_ERROR();
-	}
-
-    if (shaderLog) {
-        m_shaderLog = std::string(shaderLog);
+        m_shaderLog.resize(logLength);
         *log = m_shaderLog;
-    }
+	}
     
     return true;
 }
@@ -1044,6 +1310,13 @@ HBGLShader::CompileShader(void)
 
     } else {
         std::cerr << "HBGLShader ERROR [ " << this->GetName() << " : " << this->m_shaderFilePath << " : " << compileStatus << " ]:\n" << shaderLog << std::endl;
+
+        // the log only gives source string numbers, say which file each is
+        if (m_sourceStringNames.size() > 1) {
+            for (size_t stringIdx = 0; stringIdx < m_sourceStringNames.size(); stringIdx++) {
+                std::cerr << "    source string " << stringIdx << " is [ " << m_sourceStringNames[stringIdx] << " ]" << std::endl;
+            }
+        }
         glDeleteShader(m_shaderIndex);
         return false;
     }
@@ -1058,8 +1331,11 @@ HBGLShader::CompileShader(void)
 HBGLVertexShader::HBGLVertexShader(const std::string& filePath) : HBGLShader(filePath)
 {
 
-    m_shaderIndex = glCreateShader(GL_VERTEX_SHADER);
-    HB_CHECK_GL_ERROR();
+    // toys are also parsed with no GL context at all (the CPU renderer)
+    if (glCreateShader) {
+        m_shaderIndex = glCreateShader(GL_VERTEX_SHADER);
+        HB_CHECK_GL_ERROR();
+    }
 }
 
 // ----------------------------------------------------------------------------
@@ -1072,8 +1348,11 @@ HBGLVertexShader::~HBGLVertexShader()
 
 HBGLFragmentShader::HBGLFragmentShader(const std::string& filePath) : HBGLShader(filePath)
 {
-    m_shaderIndex = glCreateShader(GL_FRAGMENT_SHADER);
-    HB_CHECK_GL_ERROR();
+    // same as the vertex shader, no index without a context
+    if (glCreateShader) {
+        m_shaderIndex = glCreateShader(GL_FRAGMENT_SHADER);
+        HB_CHECK_GL_ERROR();
+    }
 }
 
 // ----------------------------------------------------------------------------
@@ -2,6 +2,8 @@
 
 #include <memory>
 #include <map>
+#include <string>
+#include <utility>
 #include <vector>
 #include <iostream>
 
@@ -10,7 +12,10 @@
 namespace HBGLUtils
 {
 
-    typedef std::map<std::string, GLint> HBGLBoundValuesMap;
+    // Locations by name, sorted by name.  Uniforms are set by name every
+    // frame, and a sorted vector can be searched with the caller's C string
+    // where a std::map keyed on std::string needs a key built for each find.
+    typedef std::vector<std::pair<std::string, GLint> > HBGLBoundValuesMap;
 
     //-----------------------------------------------------------------------------
     // Shader class that defines a generic GL shader.  Subclasses include a vertex
@@ -40,6 +45,15 @@ namespace HBGLUtils
         bool IsLinked(void) const;
         GLuint GetShaderIndex(void) const;
 
+        // The final source handed to the compiler (for subclasses that
+        // assemble their source, this includes anything they prepend).
+        const GLchar* GetSource(void) const;
+
+        // The file behind each source string number of GetSource, as used
+        // by #line directives.  [0] is the shader's own file; any others
+        // are files it included.
+        const std::vector<std::string>& GetSourceStringNames(void) const;
+
         // - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - 
         // CACHED ACCESSORS
 
@@ -61,6 +75,7 @@ namespace HBGLUtils
         std::string         m_shaderName;
         std::string         m_shaderFilePath;
         GLchar*             m_shaderSource;
+        std::vector<std::string> m_sourceStringNames;
 
         GLuint              m_shaderIndex;
 
@@ -112,6 +127,8 @@ namespace HBGLUtils
         HBGLShaderPtr GetVertexShader() const;
         HBGLShaderPtr GetFragmentShader() const;
 
+        const std::string& GetBinaryCacheDirectory() const;
+
         // - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - 
         // CACHED ACCESSORS
 
@@ -144,6 +161,14 @@ namespace HBGLUtils
         bool LinkShaders();
         bool ReloadLinkedShaders();
 
+        // When set, LinkShaders first looks in cacheDirectory for a program
+        // binary built from the same sources, attribute bindings and GL
+        // driver.  On a hit the shaders are never compiled; on a miss they are
+        // compiled and linked as usual and the result is written back.  With
+        // a cache directory set, LoadAndCompileShaders defers compilation to
+        // LinkShaders, so check the result of LinkShaders for errors.
+        void SetBinaryCacheDirectory(const std::string& cacheDirectory);
+
         bool ClearShaders();
 
         // - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - 
@@ -231,18 +256,27 @@ namespace HBGLUtils
 
         bool _BindAttribLocations();
 
+        bool _CompileShaders();
+        bool _IsBinaryCacheSupported() const;
+        unsigned long long _ComputeBinaryCacheKey() const;
+        std::string _GetBinaryCachePath(unsigned long long cacheKey) const;
+        bool _LoadProgramBinary(unsigned long long cacheKey);
+        bool _SaveProgramBinary(unsigned long long cacheKey) const;
+
         typedef std::map<std::string, GLint> HBShaderValueIndexMap;
 
         GLuint                            m_programIndex;
         std::string                       m_programName;
         GLuint                            m_attributeIndex;
 
-        GLchar*                           m_programLog;
+        std::string                       m_programLog;
         HBGLShaderPtr                     m_vertShader;
         HBGLShaderPtr                     m_fragShader;
         HBGLBoundValuesMap                m_boundAttributesMap;
         HBGLBoundValuesMap                m_boundUniformsMap;
 
+        std::string                       m_binaryCacheDirectory;
+
     };
 
     typedef std::shared_ptr<HBGLShaderProgram> HBGLShaderProgramPtr;
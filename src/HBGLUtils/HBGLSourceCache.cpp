@@ -0,0 +1,212 @@
+#include "HBGLSourceCache.h"
+#include "HBGLMappedFile.h"
+#include "HBGLUtils.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+
+using namespace HBGLUtils;
+
+HBGLSourceCache HBGLSourceCache::s_sourceCache;
+
+//-----------------------------------------------------------------------------
+
+HBGLSourceCache::HBGLSourceCache()
+{
+}
+
+//-----------------------------------------------------------------------------
+
+HBGLSourceCache&
+HBGLSourceCache::Get()
+{
+    return s_sourceCache;
+}
+
+//-----------------------------------------------------------------------------
+
+HBGLSourceFilePtr
+HBGLSourceCache::Load(const std::string& filePath)
+{
+    long long modifiedTime = 0;
+    long long fileSize = 0;
+    if (!GetFileStamp(filePath.c_str(), modifiedTime, fileSize)) {
+        return HBGLSourceFilePtr();
+    }
+
+    std::lock_guard<std::mutex> filesLock(m_filesMutex);
+
+    SourceFileMap::const_iterator fileIter = m_files.find(filePath);
+    if (fileIter != m_files.end() &&
+        fileIter->second->modifiedTime == modifiedTime &&
+        fileIter->second->fileSize == fileSize)
+    {
+        return fileIter->second;
+    }
+
+    HBGLMappedFile mappedFile;
+    if (!mappedFile.Open(filePath)) {
+        return HBGLSourceFilePtr();
+    }
+
+    std::shared_ptr<HBGLSourceFile> sourceFile(new HBGLSourceFile());
+    sourceFile->filePath = filePath;
+    if (mappedFile.GetData()) {
+        sourceFile->text.assign(mappedFile.GetData(), mappedFile.GetSize());
+    }
+    sourceFile->hash = HashFNV1a(sourceFile->text.data(), sourceFile->text.size());
+
+    // if the file changes while it is read the stamp will not match next
+    // time, and it is simply read again
+    sourceFile->modifiedTime = modifiedTime;
+    sourceFile->fileSize = fileSize;
+
+    m_files[filePath] = sourceFile;
+    return sourceFile;
+}
+
+//-----------------------------------------------------------------------------
+
+void
+HBGLSourceCache::Clear()
+{
+    std::lock_guard<std::mutex> filesLock(m_filesMutex);
+    m_files.clear();
+}
+
+//-----------------------------------------------------------------------------
+
+void
+HBGLSourceCache::AppendLineDirective(std::string& source, unsigned int nextLine, size_t sourceStringNum)
+{
+    char lineDirective[48];
+    snprintf(lineDirective, sizeof(lineDirective), "#line %u %u\n", nextLine - 1, (unsigned int) sourceStringNum);
+    source += lineDirective;
+}
+
+//-----------------------------------------------------------------------------
+
+bool
+HBGLSourceCache::ExpandIncludes(const char* source,
+    size_t sourceLength,
+    const std::string& sourcePath,
+    unsigned int firstLine,
+    std::string& expandedSource,
+    std::vector<std::string>& sourceStringNames)
+{
+    if (sourceStringNames.empty()) {
+        sourceStringNames.push_back(sourcePath);
+    }
+
+    expandedSource.reserve(expandedSource.size() + sourceLength);
+    return _ExpandIncludes(source, sourceLength, sourcePath, 0, firstLine, expandedSource, sourceStringNames);
+}
+
+//-----------------------------------------------------------------------------
+
+bool
+HBGLSourceCache::_ExpandIncludes(const char* source,
+    size_t sourceLength,
+    const std::string& sourcePath,
+    size_t sourceStringNum,
+    unsigned int firstLine,
+    std::string& expandedSource,
+    std::vector<std::string>& sourceStringNames)
+{
+    const char* sourceEnd = source + sourceLength;
+
+    // lines without an include are copied over in one go
+    const char* copyStart = source;
+    const char* lineStart = source;
+    unsigned int lineNumber = firstLine;
+
+    while (lineStart < sourceEnd)
+    {
+        const char* nextLine;
+        const char* lineEnd = FindLineEnd(lineStart, sourceEnd, nextLine);
+
+        const char* lineChar = lineStart;
+        while (lineChar < lineEnd && (*lineChar == ' ' || *lineChar == '\t')) { lineChar++; }
+
+        if (lineChar == lineEnd || *lineChar != '#') {
+            lineStart = nextLine;
+            lineNumber++;
+            continue;
+        }
+
+        lineChar++;
+        while (lineChar < lineEnd && (*lineChar == ' ' || *lineChar == '\t')) { lineChar++; }
+
+        const char* includeKeyword = "include";
+        const size_t includeKeywordLength = 7;
+        if (size_t(lineEnd - lineChar) <= includeKeywordLength || strncmp(lineChar, includeKeyword, includeKeywordLength) != 0) {
+            lineStart = nextLine;
+            lineNumber++;
+            continue;
+        }
+
+        lineChar += includeKeywordLength;
+        while (lineChar < lineEnd && (*lineChar == ' ' || *lineChar == '\t')) { lineChar++; }
+
+        // anything malformed is left in for the compiler to complain about
+        const char* nameEnd = NULL;
+        if (lineChar < lineEnd && *lineChar == '"') {
+            lineChar++;
+            nameEnd = static_cast<const char*>(memchr(lineChar, '"', lineEnd - lineChar));
+        }
+
+        if (!nameEnd || nameEnd == lineChar) {
+            lineStart = nextLine;
+            lineNumber++;
+            continue;
+        }
+
+        expandedSource.append(copyStart, lineStart - copyStart);
+
+        // relative to the including file, not the working directory
+        std::string includePath(lineChar, nameEnd);
+        size_t separatorPos = sourcePath.find_last_of("/\\");
+        if (separatorPos != std::string::npos) {
+            includePath = sourcePath.substr(0, separatorPos + 1) + includePath;
+        }
+
+        std::string realIncludePath = GetRealFilePath(includePath.c_str());
+        if (!realIncludePath.empty()) {
+            includePath = realIncludePath;
+        }
+
+        if (std::find(sourceStringNames.begin(), sourceStringNames.end(), includePath) == sourceStringNames.end())
+        {
+            HBGLSourceFilePtr includeFile = Load(includePath);
+            if (!includeFile) {
+                std::cerr << "HBGLSourceCache ERROR [ " << sourcePath << " : " << lineNumber << " ]: Could not load include [ " << includePath << " ] " << std::endl;
+                return false;
+            }
+
+            size_t includeStringNum = sourceStringNames.size();
+            sourceStringNames.push_back(includePath);
+
+            AppendLineDirective(expandedSource, 1, includeStringNum);
+            if (!_ExpandIncludes(includeFile->text.data(), includeFile->text.size(), includePath,
+                includeStringNum, 1, expandedSource, sourceStringNames))
+            {
+                return false;
+            }
+
+            if (!expandedSource.empty() && expandedSource[expandedSource.size() - 1] != '\n') {
+                expandedSource += '\n';
+            }
+        }
+
+        AppendLineDirective(expandedSource, lineNumber + 1, sourceStringNum);
+
+        copyStart = nextLine;
+        lineStart = nextLine;
+        lineNumber++;
+    }
+
+    expandedSource.append(copyStart, sourceEnd - copyStart);
+    return true;
+}
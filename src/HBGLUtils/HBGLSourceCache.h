@@ -0,0 +1,105 @@
+#pragma once
+
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace HBGLUtils
+{
+    //-----------------------------------------------------------------------------
+    // One file as the source cache read it.
+
+    struct HBGLSourceFile
+    {
+        std::string         filePath;
+        std::string         text;
+
+        // FNV-1a of text, for keying anything derived from the contents
+        unsigned long long  hash;
+
+        // GetFileStamp values at the time the file was read
+        long long           modifiedTime;
+        long long           fileSize;
+    };
+
+    typedef std::shared_ptr<const HBGLSourceFile> HBGLSourceFilePtr;
+
+    //-----------------------------------------------------------------------------
+    // Process wide cache of shader source files, so a library that many
+    // shaders #include is read (and hashed) once instead of once per shader.
+    // A cached file is checked against its modification time and size on
+    // every Load and read again when it changed on disk.  Safe to use from
+    // any thread.
+    //
+    // Files are read through a mapping that is closed again straight away;
+    // keeping it open would stop editors on Windows from saving over it.
+
+    class HBGLSourceCache
+    {
+    public:
+
+        static HBGLSourceCache& Get();
+
+        // - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+        // MODIFIERS
+
+        // The contents of filePath (a full path), NULL if it cannot be read.
+        HBGLSourceFilePtr Load(const std::string& filePath);
+
+        // Append source (loaded from sourcePath, starting at line firstLine of
+        // that file) to expandedSource with every line of the form
+        //
+        //     #include "lib.glsl"
+        //
+        // replaced by the contents of the file, found relative to the file
+        // that includes it.  Included files get their own source string
+        // number, which is their index in sourceStringNames, and #line
+        // directives around each include keep compile errors pointing at the
+        // right file and line.  sourceStringNames[0] should already hold
+        // sourcePath.  A file is only included once per expansion, so
+        // libraries can include each other freely.  Returns false if an
+        // included file could not be read.
+        bool ExpandIncludes(const char* source,
+            size_t sourceLength,
+            const std::string& sourcePath,
+            unsigned int firstLine,
+            std::string& expandedSource,
+            std::vector<std::string>& sourceStringNames);
+
+        // Drop every cached file.
+        void Clear();
+
+        // Append a #line directive that makes the next line of source count
+        // as line nextLine of source string sourceStringNum.  Written for the
+        // #version 130 rule, where the line after the directive is line + 1.
+        static void AppendLineDirective(std::string& source, unsigned int nextLine, size_t sourceStringNum);
+
+    private:
+
+        HBGLSourceCache();
+
+        // a copy would read and hash every library a second time
+        HBGLSourceCache(const HBGLSourceCache&);
+        HBGLSourceCache& operator=(const HBGLSourceCache&);
+
+        bool _ExpandIncludes(const char* source,
+            size_t sourceLength,
+            const std::string& sourcePath,
+            size_t sourceStringNum,
+            unsigned int firstLine,
+            std::string& expandedSource,
+            std::vector<std::string>& sourceStringNames);
+
+        typedef std::map<std::string, HBGLSourceFilePtr> SourceFileMap;
+
+        // The reloader thread can be the first to include a library, so the
+        // cache has to exist before any thread asks for it.  VS2013 does not
+        // guard the construction of function statics.
+        static HBGLSourceCache  s_sourceCache;
+
+        std::mutex              m_filesMutex;
+        SourceFileMap           m_files;
+    };
+}
@@ -0,0 +1,129 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <vector>
+
+namespace HBGLUtils
+{
+    //-----------------------------------------------------------------------------
+    // Fixed size queue from exactly one producer thread to exactly one
+    // consumer thread, without locks.  The producer is the only writer of the
+    // head and the consumer the only writer of the tail; each publishes with
+    // a release store and reads the other's with an acquire load, so an
+    // element is completely written before the consumer can see it.  A full
+    // ring makes Push fail instead of wait, so a producer with a frame to get
+    // out never stalls on a slow consumer.
+
+    template <typename T>
+    class HBGLSpscRing
+    {
+    public:
+
+        // - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+        // CONSTRO/DESTRO
+
+        // capacity is rounded up to a power of two
+        explicit HBGLSpscRing(size_t capacity);
+        ~HBGLSpscRing();
+
+        // - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+        // ACCESSORS
+
+        size_t GetCapacity() const;
+
+        // - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+        // MODIFIERS
+
+        // Producer only.  Returns false, dropping element, if the ring is full.
+        bool Push(const T& element);
+
+        // Consumer only.  Moves up to maxCount of the oldest elements into
+        // elements and returns how many there were.
+        size_t Pop(T* elements, size_t maxCount);
+
+    private:
+
+        // not copyable, the two threads hold on to it
+        HBGLSpscRing(const HBGLSpscRing&);
+        HBGLSpscRing& operator=(const HBGLSpscRing&);
+
+        std::vector<T>          m_elements;
+        size_t                  m_mask;
+
+        // kept on cache lines of their own so the threads don't fight over them
+        char                    m_headPadding[64];
+        std::atomic<size_t>     m_head;
+        char                    m_tailPadding[64];
+        std::atomic<size_t>     m_tail;
+        char                    m_endPadding[64];
+    };
+
+    // ----------------------------------------------------------------------------
+
+    template <typename T>
+    HBGLSpscRing<T>::HBGLSpscRing(size_t capacity) :
+    m_mask(0)
+    {
+        size_t roundedCapacity = 1;
+        while (roundedCapacity < capacity) {
+            roundedCapacity <<= 1;
+        }
+        m_elements.resize(roundedCapacity);
+        m_mask = roundedCapacity - 1;
+
+        m_head.store(0);
+        m_tail.store(0);
+    }
+
+    // ----------------------------------------------------------------------------
+
+    template <typename T>
+    HBGLSpscRing<T>::~HBGLSpscRing()
+    {
+
+    }
+
+    // ----------------------------------------------------------------------------
+
+    template <typename T>
+    size_t
+    HBGLSpscRing<T>::GetCapacity() const
+    {
+        return m_elements.size();
+    }
+
+    // ----------------------------------------------------------------------------
+
+    template <typename T>
+    bool
+    HBGLSpscRing<T>::Push(const T& element)
+    {
+        size_t head = m_head.load(std::memory_order_relaxed);
+        if (head - m_tail.load(std::memory_order_acquire) >= m_elements.size()) {
+            return false;
+        }
+
+        m_elements[head & m_mask] = element;
+        m_head.store(head + 1, std::memory_order_release);
+        return true;
+    }
+
+    // ----------------------------------------------------------------------------
+
+    template <typename T>
+    size_t
+    HBGLSpscRing<T>::Pop(T* elements, size_t maxCount)
+    {
+        size_t tail = m_tail.load(std::memory_order_relaxed);
+        size_t available = m_head.load(std::memory_order_acquire) - tail;
+        size_t count = (available < maxCount) ? available : maxCount;
+
+        for (size_t elementIdx = 0; elementIdx < count; elementIdx++) {
+            elements[elementIdx] = m_elements[(tail + elementIdx) & m_mask];
+        }
+
+        m_tail.store(tail + count, std::memory_order_release);
+        return count;
+    }
+}
@@ -4,7 +4,7 @@
 #define GLFW_INCLUDE_GLU
 #include <GLFW/glfw3.h>
 
-#include <sstream>
+#include <cstring>
 
 using namespace HBGLUtils;
 
@@ -39,20 +39,24 @@ HBGLOverlayStats::AddDataKey(const std::string &key,
 }
 
 bool
-HBGLOverlayStats::UpdateData(const std::string &key, float value)
+HBGLOverlayStats::UpdateData(const char* key, float value)
 {
-    OverlayStatsMap::const_iterator dataIter = _dataMap.find(key);
+    // only a handful of keys, so walking them beats building a key to find
+    for (OverlayStatsMap::iterator dataIter = _dataMap.begin();
+         dataIter != _dataMap.end();
+         dataIter++) {
 
-    if (dataIter != _dataMap.end()) {
-        _dataMap[key] = value;
-        return true;
+        if (strcmp(dataIter->first.c_str(), key) == 0) {
+            dataIter->second = value;
+            return true;
+        }
     }
 
     return false;
 }
 
 void
-HBGLOverlayStats::DrawOverlay(GLsizei width, GLsizei height)
+HBGLOverlayStats::DrawOverlay(GLsizei width, GLsizei height, HBGLFrameArena& frameArena)
 {
 
 	_SetOrthographicProjection(width, height);
@@ -67,20 +71,19 @@ HBGLOverlayStats::DrawOverlay(GLsizei width, GLsizei height)
          dataIter != _dataMap.end();
          dataIter++) {
 
-        std::stringstream sstr;
         OverlayStatsPrecisionMap::const_iterator dataPrecIter = \
         _dataPrecisionMap.find(dataIter->first);
 
-        if (dataPrecIter->second > 0) {
-            sstr.precision(dataPrecIter->second);
+        // six significant digits unless the key asked for its own
+        int precision = (dataPrecIter->second > 0) ? dataPrecIter->second : 6;
+        const char* line = frameArena.Format("%s: %.*g", dataIter->first.c_str(), precision, dataIter->second);
+        if (!line) {
+            continue;
         }
 
-        sstr << dataIter->first << ": " << dataIter->second;
-
-        _RenderBitmapString(10.0f, vertOffset,sstr.str());
+        _RenderBitmapString(10.0f, vertOffset, line);
         vertOffset += 15.f;
-        std::cout << "\r" << sstr.str();
-        sstr.clear();
+        std::cout << "\r" << line;
     }
 
 	glPopMatrix();
@@ -118,7 +121,7 @@ HBGLOverlayStats::_SetOrthographicProjection(GLsizei width, GLsizei height)
 void
 HBGLOverlayStats::_RenderBitmapString(float x,
                                       float y,
-                                      const std::string& str,
+                                      const char* str,
                                       float spacing)
 {
     // TODO: Write a simple monospace texture based printing system
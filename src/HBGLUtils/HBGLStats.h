@@ -13,6 +13,8 @@
 
 #include <GL/glew.h>
 
+#include "HBGLFrameArena.h"
+
 namespace HBGLUtils
 {
 
@@ -30,10 +32,14 @@ namespace HBGLUtils
             float defValue,
             int precision = -1);
 
-        bool UpdateData(const std::string& key,
+        // Called every frame, so it finds key without making a std::string
+        // of it.
+        bool UpdateData(const char* key,
             float value);
 
-        void DrawOverlay(GLsizei width, GLsizei height);
+        // Each line's text is formatted into frameArena and stays there
+        // until the arena is reset.
+        void DrawOverlay(GLsizei width, GLsizei height, HBGLFrameArena& frameArena);
 
     private:
 
@@ -41,7 +47,7 @@ namespace HBGLUtils
 
         void _RenderBitmapString(float x,
             float y,
-            const std::string& str,
+            const char* str,
             float spacing = 0);
 
         void _ResetPerspectiveProjection();
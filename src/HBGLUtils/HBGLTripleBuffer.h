@@ -0,0 +1,206 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+
+namespace HBGLUtils
+{
+    //-----------------------------------------------------------------------------
+    // Hands the latest state of something (a head pose, input, a block of
+    // uniforms) from one producer thread to one consumer thread, where only
+    // the newest value matters and older ones may be skipped.
+    //
+    // There are three slots: the producer always owns one, the consumer owns
+    // another, and the third is exchanged atomically between them along with
+    // a flag saying whether it holds something the consumer hasn't seen.
+    // Publishing and consuming are each a single atomic exchange, so neither
+    // side ever waits or retries however often the other runs, and the
+    // consumer can read its slot for as long as it likes.  A seqlock such as
+    // OVR::LocklessUpdater instead copies out of a slot the producer may be
+    // writing and tries again when it was, which a busy producer can keep
+    // doing.  Slots are written and read in place, so T only needs to be
+    // default constructible and assignable.
+    //
+    // Each slot and index lives on its own cache lines, so the two threads
+    // don't slow each other down through false sharing.
+
+    template <typename T>
+    class HBGLTripleBuffer
+    {
+    public:
+
+        // - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+        // CONSTRO/DESTRO
+
+        HBGLTripleBuffer();
+
+        // all three slots start out as initialState
+        explicit HBGLTripleBuffer(const T& initialState);
+
+        ~HBGLTripleBuffer();
+
+        // - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+        // PRODUCER
+
+        // The producer's slot, to fill in place before Publish.  It holds
+        // whatever was last in it, not necessarily the last published state.
+        T& GetWriteState();
+
+        // Make the producer's slot the newest state and take another.
+        void Publish();
+        void Publish(const T& state);
+
+        // - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+        // CONSUMER
+
+        // true if something was published since the last Consume
+        bool HasFresh() const;
+
+        // Swap the newest published state into the consumer's slot.  Returns
+        // false, leaving the slot as it was, if nothing new was published.
+        bool Consume();
+
+        // Consume into state; state is left alone if there was nothing new.
+        bool Consume(T& state);
+
+        // The consumer's slot, valid until the next Consume.
+        const T& GetReadState() const;
+
+    private:
+
+        enum {
+            CACHE_LINE_SIZE = 64,
+            SHARED_FRESH = 4,
+            SHARED_SLOT_MASK = 3
+        };
+
+        struct Slot
+        {
+            T       state;
+            char    padding[CACHE_LINE_SIZE];
+        };
+
+        // not copyable, the two threads hold on to it
+        HBGLTripleBuffer(const HBGLTripleBuffer&);
+        HBGLTripleBuffer& operator=(const HBGLTripleBuffer&);
+
+        Slot                    m_slots[3];
+
+        char                    m_sharedPadding[CACHE_LINE_SIZE];
+        std::atomic<int>        m_sharedSlot;
+        char                    m_writePadding[CACHE_LINE_SIZE];
+        int                     m_writeSlot;
+        char                    m_readPadding[CACHE_LINE_SIZE];
+        int                     m_readSlot;
+        char                    m_endPadding[CACHE_LINE_SIZE];
+    };
+
+    // ----------------------------------------------------------------------------
+
+    template <typename T>
+    HBGLTripleBuffer<T>::HBGLTripleBuffer() :
+    m_writeSlot(0),
+    m_readSlot(1)
+    {
+        m_sharedSlot.store(2);
+    }
+
+    // ----------------------------------------------------------------------------
+
+    template <typename T>
+    HBGLTripleBuffer<T>::HBGLTripleBuffer(const T& initialState) :
+    m_writeSlot(0),
+    m_readSlot(1)
+    {
+        for (int slotIdx = 0; slotIdx < 3; slotIdx++) {
+            m_slots[slotIdx].state = initialState;
+        }
+        m_sharedSlot.store(2);
+    }
+
+    // ----------------------------------------------------------------------------
+
+    template <typename T>
+    HBGLTripleBuffer<T>::~HBGLTripleBuffer()
+    {
+
+    }
+
+    // ----------------------------------------------------------------------------
+
+    template <typename T>
+    T&
+    HBGLTripleBuffer<T>::GetWriteState()
+    {
+        return m_slots[m_writeSlot].state;
+    }
+
+    // ----------------------------------------------------------------------------
+
+    template <typename T>
+    void
+    HBGLTripleBuffer<T>::Publish()
+    {
+        // hand over the finished slot and take back whichever one was shared
+        int previousSlot = m_sharedSlot.exchange(m_writeSlot | SHARED_FRESH, std::memory_order_acq_rel);
+        m_writeSlot = previousSlot & SHARED_SLOT_MASK;
+    }
+
+    // ----------------------------------------------------------------------------
+
+    template <typename T>
+    void
+    HBGLTripleBuffer<T>::Publish(const T& state)
+    {
+        m_slots[m_writeSlot].state = state;
+        Publish();
+    }
+
+    // ----------------------------------------------------------------------------
+
+    template <typename T>
+    bool
+    HBGLTripleBuffer<T>::HasFresh() const
+    {
+        return (m_sharedSlot.load(std::memory_order_acquire) & SHARED_FRESH) != 0;
+    }
+
+    // ----------------------------------------------------------------------------
+
+    template <typename T>
+    bool
+    HBGLTripleBuffer<T>::Consume()
+    {
+        // cheap check first, so an idle producer costs the consumer one load
+        if (!HasFresh()) {
+            return false;
+        }
+
+        int previousSlot = m_sharedSlot.exchange(m_readSlot, std::memory_order_acq_rel);
+        m_readSlot = previousSlot & SHARED_SLOT_MASK;
+        return true;
+    }
+
+    // ----------------------------------------------------------------------------
+
+    template <typename T>
+    bool
+    HBGLTripleBuffer<T>::Consume(T& state)
+    {
+        if (!Consume()) {
+            return false;
+        }
+
+        state = m_slots[m_readSlot].state;
+        return true;
+    }
+
+    // ----------------------------------------------------------------------------
+
+    template <typename T>
+    const T&
+    HBGLTripleBuffer<T>::GetReadState() const
+    {
+        return m_slots[m_readSlot].state;
+    }
+}
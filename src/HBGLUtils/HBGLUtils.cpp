@@ -1,10 +1,18 @@
 #include "HBGLUtils.h"
 
 #include <iostream>
+#include <algorithm>
+#include <cstring>
 
 #if defined(_WIN32)
 #include <Windows.h>
 #include <WinBase.h>
+#else
+#include <dirent.h>
+#include <errno.h>
+#include <limits.h>
+#include <stdlib.h>
+#include <sys/stat.h>
 #endif
 
 //-----------------------------------------------------------------------------
@@ -66,11 +74,192 @@ HBGLUtils::GetRealFilePath(const char *shortFilePath)
 
 #else
 	// Mac & Linux implementation
-	char realfilename[1024];
-    realpath(shortFilePath, fullPath);
-    return std::string(fullPath);
+	char fullPath[PATH_MAX];
+    if (realpath(shortFilePath, fullPath) != NULL)
+    {
+        return std::string(fullPath);
+    }
+    else
+    {
+        return "";
+    }
+
+#endif
+}
+
+//-----------------------------------------------------------------------------
+
+bool
+HBGLUtils::ListDirectory(const char* dirPath, std::vector<std::string>& files)
+{
+    files.clear();
+
+#if defined(_WIN32)
+
+    std::string searchPattern = std::string(dirPath) + "\\*";
+
+    WIN32_FIND_DATA findData;
+    HANDLE findHandle = FindFirstFile(searchPattern.c_str(), &findData);
+    if (findHandle == INVALID_HANDLE_VALUE)
+    {
+        return false;
+    }
+
+    do
+    {
+        if ((findData.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) == 0)
+        {
+            files.push_back(std::string(findData.cFileName));
+        }
+    } while (FindNextFile(findHandle, &findData));
+
+    FindClose(findHandle);
+
+#else
+
+    DIR* dir = opendir(dirPath);
+    if (dir == NULL)
+    {
+        return false;
+    }
+
+    struct dirent* entry;
+    while ((entry = readdir(dir)) != NULL)
+    {
+        std::string entryPath = std::string(dirPath) + "/" + entry->d_name;
+        struct stat entryStat;
+        if (stat(entryPath.c_str(), &entryStat) == 0 && S_ISREG(entryStat.st_mode))
+        {
+            files.push_back(std::string(entry->d_name));
+        }
+    }
+
+    closedir(dir);
+
+#endif
+
+    std::sort(files.begin(), files.end());
+    return true;
+}
+
+//-----------------------------------------------------------------------------
+
+bool
+HBGLUtils::MakeDirectory(const char* dirPath)
+{
+#if defined(_WIN32)
+
+    if (CreateDirectory(dirPath, NULL) || GetLastError() == ERROR_ALREADY_EXISTS)
+    {
+        return true;
+    }
+
+#else
+
+    if (mkdir(dirPath, 0755) == 0 || errno == EEXIST)
+    {
+        return true;
+    }
 
 #endif
+
+    std::cerr << "HBGLUtils ERROR: could not create directory [ " << dirPath << " ] " << std::endl;
+    return false;
 }
 
 //-----------------------------------------------------------------------------
+
+bool
+HBGLUtils::GetFileStamp(const char* filePath, long long& modifiedTime, long long& fileSize)
+{
+#if defined(_WIN32)
+
+    // the attribute times have 100ns resolution, unlike _stat
+    WIN32_FILE_ATTRIBUTE_DATA attributes;
+    if (!GetFileAttributesExA(filePath, GetFileExInfoStandard, &attributes)) {
+        return false;
+    }
+
+    modifiedTime = (static_cast<long long>(attributes.ftLastWriteTime.dwHighDateTime) << 32) | attributes.ftLastWriteTime.dwLowDateTime;
+    fileSize = (static_cast<long long>(attributes.nFileSizeHigh) << 32) | attributes.nFileSizeLow;
+
+#else
+
+    struct stat fileStat;
+    if (stat(filePath, &fileStat) != 0) {
+        return false;
+    }
+
+    // nanoseconds, so two saves within the same second still differ
+#if defined(__APPLE__)
+    modifiedTime = static_cast<long long>(fileStat.st_mtimespec.tv_sec) * 1000000000LL + fileStat.st_mtimespec.tv_nsec;
+#else
+    modifiedTime = static_cast<long long>(fileStat.st_mtim.tv_sec) * 1000000000LL + fileStat.st_mtim.tv_nsec;
+#endif
+    fileSize = static_cast<long long>(fileStat.st_size);
+
+#endif
+
+    return true;
+}
+
+//-----------------------------------------------------------------------------
+
+unsigned long long
+HBGLUtils::HashFNV1a(const void* data, size_t size, unsigned long long seed)
+{
+    const unsigned char* bytes = static_cast<const unsigned char*>(data);
+    unsigned long long hash = seed;
+
+    for (size_t byteIdx = 0; byteIdx < size; byteIdx++)
+    {
+        hash ^= bytes[byteIdx];
+        hash *= 1099511628211ULL;
+    }
+
+    return hash;
+}
+
+//-----------------------------------------------------------------------------
+
+const char*
+HBGLUtils::FindLineEnd(const char* lineStart, const char* textEnd, const char*& nextLine)
+{
+    const char* lineEnd = static_cast<const char*>(memchr(lineStart, '\n', textEnd - lineStart));
+    if (!lineEnd) {
+        nextLine = textEnd;
+        return textEnd;
+    }
+
+    nextLine = lineEnd + 1;
+    return lineEnd;
+}
+
+//-----------------------------------------------------------------------------
+
+const char*
+HBGLUtils::FindLineComment(const char* lineStart, const char* lineEnd)
+{
+    const char* commentStart = lineStart;
+    while (commentStart < lineEnd && !(commentStart[0] == '/' && commentStart + 1 < lineEnd && commentStart[1] == '/')) {
+        commentStart++;
+    }
+
+    return commentStart;
+}
+
+//-----------------------------------------------------------------------------
+
+std::string
+HBGLUtils::TrimToken(const char* begin, const char* end, const char* trimChars)
+{
+    while (begin < end && strchr(trimChars, *begin)) {
+        begin++;
+    }
+
+    while (end > begin && strchr(trimChars, end[-1])) {
+        end--;
+    }
+
+    return std::string(begin, end);
+}
@@ -1,6 +1,7 @@
 #pragma once
 
 #include <string>
+#include <vector>
 
 #include <GL/glew.h>
 
@@ -10,6 +11,12 @@
 #define HB_CHECK_GL_ERROR()
 #endif 
 
+// VS2013 has no snprintf.  Its _snprintf only differs in leaving a string
+// that did not fit unterminated, and every buffer here is sized for its text.
+#if defined(_MSC_VER) && _MSC_VER < 1900
+#define snprintf _snprintf
+#endif
+
 namespace HBGLUtils
 {
     // Helper function for giving words to those pesky enums.
@@ -28,4 +35,44 @@ namespace HBGLUtils
     // on the native OS to resolve relative paths in the way it sees fit.
 	std::string
 	GetRealFilePath(const char* shortFilePath);
+
+    // Fill files with the names (not paths) of the regular files found in
+    // dirPath, sorted alphabetically.  Returns false if the directory could
+    // not be read.
+    bool
+    ListDirectory(const char* dirPath, std::vector<std::string>& files);
+
+    // Last write time (in the OS's own units) and size of filePath, enough to
+    // tell whether the file changed since it was last looked at.  Returns
+    // false if the file does not exist.
+    bool
+    GetFileStamp(const char* filePath, long long& modifiedTime, long long& fileSize);
+
+    // Create dirPath if it does not exist yet.  Only the last component is
+    // created, its parent must already exist.
+    bool
+    MakeDirectory(const char* dirPath);
+
+    // 64 bit FNV-1a hash of size bytes at data.  Chain calls by passing the
+    // previous result as the seed.
+    static const unsigned long long c_FNV1aOffsetBasis = 14695981039346656037ULL;
+
+    unsigned long long
+    HashFNV1a(const void* data, size_t size, unsigned long long seed = c_FNV1aOffsetBasis);
+
+    // End of the line that starts at lineStart in text ending at textEnd,
+    // without its newline.  nextLine is where the line after it starts, or
+    // textEnd after the last line.
+    const char*
+    FindLineEnd(const char* lineStart, const char* textEnd, const char*& nextLine);
+
+    // Start of the // comment in [lineStart, lineEnd), lineEnd if there is
+    // none.  A lone slash (e.g. in a path) does not start one.
+    const char*
+    FindLineComment(const char* lineStart, const char* lineEnd);
+
+    // Copy of [begin, end) without any of the characters in trimChars
+    // around it.
+    std::string
+    TrimToken(const char* begin, const char* end, const char* trimChars = " \t\r");
 }
\ No newline at end of file
@@ -0,0 +1,377 @@
+#include "STVRAssets.h"
+#include "HBGLMappedFile.h"
+#include "HBGLUtils.h"
+
+#include "SOIL.h"
+
+#include <cstring>
+#include <iostream>
+#include <sstream>
+
+// ''''''''''''''''''''''''''''''''''''''''''''''''''''''''''''''''''''''''''''
+// STATIC FUNCTIONS
+// ,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,
+
+struct STVRAssetKeyword
+{
+    const char*     keyword;
+    unsigned int    value;
+};
+
+static const STVRAssetKeyword STVRAssetFormats[] = {
+    { "auto", SOIL_LOAD_AUTO },
+    { "l", SOIL_LOAD_L },
+    { "la", SOIL_LOAD_LA },
+    { "rgb", SOIL_LOAD_RGB },
+    { "rgba", SOIL_LOAD_RGBA }
+};
+
+static const STVRAssetKeyword STVRAssetFlags[] = {
+    { "power_of_two", SOIL_FLAG_POWER_OF_TWO },
+    { "mipmaps", SOIL_FLAG_MIPMAPS },
+    { "repeat", SOIL_FLAG_TEXTURE_REPEATS },
+    { "invert_y", SOIL_FLAG_INVERT_Y },
+    { "multiply_alpha", SOIL_FLAG_MULTIPLY_ALPHA },
+    { "compress", SOIL_FLAG_COMPRESS_TO_DXT }
+};
+
+static const unsigned int STVRAssetDefaultFlags = SOIL_FLAG_POWER_OF_TWO | SOIL_FLAG_MIPMAPS | SOIL_FLAG_TEXTURE_REPEATS;
+
+static bool
+FindAssetKeyword(const STVRAssetKeyword* keywords, size_t keywordCount, const std::string& keyword, unsigned int& value)
+{
+    for (size_t keywordIdx = 0; keywordIdx < keywordCount; keywordIdx++)
+    {
+        if (keyword == keywords[keywordIdx].keyword) {
+            value = keywords[keywordIdx].value;
+            return true;
+        }
+    }
+
+    return false;
+}
+
+// ''''''''''''''''''''''''''''''''''''''''''''''''''''''''''''''''''''''''''''
+// STVRAssetRegistry
+// ,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,
+
+STVRAssetRegistry STVRAssetRegistry::s_assetRegistry;
+
+// ----------------------------------------------------------------------------
+
+STVRAssetRegistry::STVRAssetRegistry()
+{
+}
+
+// ----------------------------------------------------------------------------
+
+STVRAssetRegistry&
+STVRAssetRegistry::Get()
+{
+    return s_assetRegistry;
+}
+
+// ----------------------------------------------------------------------------
+
+const STVRAsset*
+STVRAssetRegistry::Find(const std::string& assetName) const
+{
+    AssetMap::const_iterator assetIter = m_assets.find(assetName);
+    if (assetIter == m_assets.end()) {
+        return NULL;
+    }
+
+    return &assetIter->second;
+}
+
+// ----------------------------------------------------------------------------
+
+size_t
+STVRAssetRegistry::GetTextureBytes(const std::string& assetName) const
+{
+    std::lock_guard<std::mutex> textureLock(m_textureMutex);
+    SharedTextureMap::const_iterator sharedIter = m_textures.find(assetName);
+    if (sharedIter == m_textures.end() || sharedIter->second.texture.expired()) {
+        return 0;
+    }
+
+    return sharedIter->second.gpuBytes;
+}
+
+// ----------------------------------------------------------------------------
+
+bool
+STVRAssetRegistry::LoadManifest(const std::string& manifestPath)
+{
+    std::string realManifestPath = HBGLUtils::GetRealFilePath(manifestPath.c_str());
+
+    HBGLMappedFile manifestFile;
+    if (realManifestPath.empty() || !manifestFile.Open(realManifestPath)) {
+        std::cerr << "STVRAssetRegistry ERROR: Could not load manifest [ " << manifestPath << " ] " << std::endl;
+        return false;
+    }
+
+    // asset files are relative to the manifest
+    std::string manifestDirectory;
+    size_t separatorPos = realManifestPath.find_last_of("/\\");
+    if (separatorPos != std::string::npos) {
+        manifestDirectory = realManifestPath.substr(0, separatorPos + 1);
+    }
+
+    const char* manifestData = manifestFile.GetData();
+    const char* manifestEnd = manifestData + manifestFile.GetSize();
+    const char* lineStart = manifestData;
+    unsigned int lineNumber = 1;
+    bool result = true;
+
+    while (lineStart < manifestEnd)
+    {
+        const char* nextLine;
+        const char* lineEnd = HBGLUtils::FindLineEnd(lineStart, manifestEnd, nextLine);
+
+        const char* commentStart = HBGLUtils::FindLineComment(lineStart, lineEnd);
+
+        std::string assetLine = HBGLUtils::TrimToken(lineStart, commentStart);
+        if (!assetLine.empty())
+        {
+            size_t equalsPos = assetLine.find('=');
+            std::string assetName = HBGLUtils::TrimToken(assetLine.c_str(), assetLine.c_str() + (equalsPos == std::string::npos ? 0 : equalsPos));
+            std::string assetValue = (equalsPos == std::string::npos) ? std::string() : assetLine.substr(equalsPos + 1);
+
+            STVRAsset asset;
+            if (assetName.empty() || !_ParseAsset(manifestDirectory, assetName, assetValue, asset)) {
+                std::cerr << "STVRAssetRegistry ERROR: skipping line " << lineNumber << " of [ " << realManifestPath << " ] " << std::endl;
+                result = false;
+            }
+            else {
+                m_assets[assetName] = asset;
+            }
+        }
+
+        lineStart = nextLine;
+        lineNumber++;
+    }
+
+    std::cout << "STVRAssetRegistry: " << m_assets.size() << " assets in [ " << realManifestPath << " ] " << std::endl;
+    return result;
+}
+
+// ----------------------------------------------------------------------------
+
+bool
+STVRAssetRegistry::_ParseAsset(const std::string& manifestDirectory,
+    const std::string& assetName,
+    const std::string& assetValue,
+    STVRAsset& asset) const
+{
+    std::istringstream valueTokens(assetValue);
+
+    std::string typeName;
+    std::string formatName;
+    if (!(valueTokens >> typeName >> formatName)) {
+        std::cerr << "STVRAssetRegistry ERROR [ " << assetName << " ]: expected a type and a format" << std::endl;
+        return false;
+    }
+
+    if (typeName == "image") {
+        asset.type = SHADERTOYVR_IMAGE_TEX;
+    }
+    else if (typeName == "cubemap") {
+        asset.type = SHADERTOYVR_CUBEMAP_TEX;
+    }
+    else {
+        std::cerr << "STVRAssetRegistry ERROR [ " << assetName << " ]: unknown type [ " << typeName << " ] " << std::endl;
+        return false;
+    }
+
+    unsigned int forceChannels = SOIL_LOAD_AUTO;
+    if (!FindAssetKeyword(STVRAssetFormats, sizeof(STVRAssetFormats) / sizeof(STVRAssetFormats[0]), formatName, forceChannels)) {
+        std::cerr << "STVRAssetRegistry ERROR [ " << assetName << " ]: unknown format [ " << formatName << " ] " << std::endl;
+        return false;
+    }
+
+    asset.name = assetName;
+    asset.forceChannels = int(forceChannels);
+    asset.loadFlags = 0;
+    asset.filePaths.clear();
+
+    // whatever is not a flag is a file
+    std::string valueToken;
+    while (valueTokens >> valueToken)
+    {
+        unsigned int loadFlag = 0;
+        if (FindAssetKeyword(STVRAssetFlags, sizeof(STVRAssetFlags) / sizeof(STVRAssetFlags[0]), valueToken, loadFlag)) {
+            asset.loadFlags |= loadFlag;
+        }
+        else if (valueToken[0] == '/' || valueToken.find(':') != std::string::npos) {
+            asset.filePaths.push_back(valueToken);
+        }
+        else {
+            asset.filePaths.push_back(manifestDirectory + valueToken);
+        }
+    }
+
+    if (asset.loadFlags == 0) {
+        asset.loadFlags = STVRAssetDefaultFlags;
+    }
+
+    size_t expectedFileCount = (asset.type == SHADERTOYVR_CUBEMAP_TEX) ? 6 : 1;
+    if (asset.filePaths.size() != expectedFileCount) {
+        std::cerr << "STVRAssetRegistry ERROR [ " << assetName << " ]: expected " << expectedFileCount << " files, found " << asset.filePaths.size() << std::endl;
+        return false;
+    }
+
+    return true;
+}
+
+// ----------------------------------------------------------------------------
+
+bool
+STVRAssetRegistry::AcquireTexture(const std::string& assetName,
+    HBGLTextureResourcePtr& texture,
+    GLfloat resolution[3])
+{
+    if (_FindSharedTexture(assetName, texture, resolution)) {
+        return true;
+    }
+
+    const STVRAsset* asset = Find(assetName);
+    if (!asset) {
+        std::cerr << "STVRAssetRegistry ERROR [ " << assetName << " ]: no such asset" << std::endl;
+        return false;
+    }
+
+    std::lock_guard<std::mutex> uploadLock(m_uploadMutex);
+
+    // the other thread may have uploaded it while this one waited
+    if (_FindSharedTexture(assetName, texture, resolution)) {
+        return true;
+    }
+
+    HBGLTextureResourcePtr uploadedTexture(new HBGLTextureResource());
+    GLfloat uploadedResolution[3] = { 0.f, 0.f, 0.f };
+    if (!_UploadTexture(*asset, uploadedTexture, uploadedResolution)) {
+        return false;
+    }
+
+    // the upload has to have happened before the other context can draw
+    // with the texture
+    glFinish();
+
+    std::lock_guard<std::mutex> textureLock(m_textureMutex);
+    SharedTexture& sharedTexture = m_textures[assetName];
+    sharedTexture.texture = uploadedTexture;
+    memcpy(sharedTexture.resolution, uploadedResolution, sizeof(uploadedResolution));
+
+    // drivers pad to four bytes a texel whatever SOIL asked for
+    size_t gpuBytes = size_t(uploadedResolution[0]) * size_t(uploadedResolution[1]) * 4;
+    if (asset->loadFlags & SOIL_FLAG_MIPMAPS) {
+        gpuBytes += gpuBytes / 3;
+    }
+    if (asset->type == SHADERTOYVR_CUBEMAP_TEX) {
+        gpuBytes *= 6;
+    }
+    sharedTexture.gpuBytes = gpuBytes;
+
+    texture = uploadedTexture;
+    memcpy(resolution, uploadedResolution, sizeof(uploadedResolution));
+
+    return true;
+}
+
+// ----------------------------------------------------------------------------
+
+void
+STVRAssetRegistry::AcquireChannelTextures(const STVRFragmentShader* fragShader,
+    HBGLTextureResourcePtr channelTextures[SHADERTOYVR_NUMCHANNELS],
+    GLfloat channelResolutions[SHADERTOYVR_NUMCHANNELS][3])
+{
+    for (int channelIdx = 0; channelIdx < SHADERTOYVR_NUMCHANNELS; channelIdx++)
+    {
+        ShaderToyVRInputChannel inputChannel = static_cast<ShaderToyVRInputChannel>(channelIdx);
+        ShaderToyVRChannelType inputType = fragShader->GetInputType(inputChannel);
+        if (inputType == SHADERTOYVR_UNKNOWN_TYPE || fragShader->IsStreamInput(inputType) || fragShader->IsBufferInput(inputType)) {
+            continue;
+        }
+
+        // channels reading the same asset get the same texture
+        AcquireTexture(fragShader->GetInputAsset(inputChannel), channelTextures[channelIdx], channelResolutions[channelIdx]);
+    }
+}
+
+// ----------------------------------------------------------------------------
+
+bool
+STVRAssetRegistry::_FindSharedTexture(const std::string& assetName,
+    HBGLTextureResourcePtr& texture,
+    GLfloat resolution[3]) const
+{
+    std::lock_guard<std::mutex> textureLock(m_textureMutex);
+
+    SharedTextureMap::const_iterator sharedIter = m_textures.find(assetName);
+    if (sharedIter == m_textures.end()) {
+        return false;
+    }
+
+    HBGLTextureResourcePtr sharedTexture = sharedIter->second.texture.lock();
+    if (!sharedTexture) {
+        return false;
+    }
+
+    texture = sharedTexture;
+    memcpy(resolution, sharedIter->second.resolution, sizeof(sharedIter->second.resolution));
+    return true;
+}
+
+// ----------------------------------------------------------------------------
+
+bool
+STVRAssetRegistry::_UploadTexture(const STVRAsset& asset,
+    HBGLTextureResourcePtr& texture,
+    GLfloat resolution[3]) const
+{
+    texture->Generate();
+    GLuint texID = texture->GetIndex();
+
+    bool isCubemap = (asset.type == SHADERTOYVR_CUBEMAP_TEX);
+    if (isCubemap)
+    {
+        texID = SOIL_load_OGL_cubemap(
+            asset.filePaths[0].c_str(),
+            asset.filePaths[1].c_str(),
+            asset.filePaths[2].c_str(),
+            asset.filePaths[3].c_str(),
+            asset.filePaths[4].c_str(),
+            asset.filePaths[5].c_str(),
+            asset.forceChannels, texID, asset.loadFlags);
+    }
+    else
+    {
+        texID = SOIL_load_OGL_texture(asset.filePaths[0].c_str(), asset.forceChannels, texID, asset.loadFlags);
+    }
+
+    if (texID == 0)
+    {
+        std::cerr << "STVRAssetRegistry ERROR [ " << asset.name << " ]: failed to read in texture" << std::endl;
+        std::cerr << "Possible texture read error: " << SOIL_last_result() << std::endl;
+        return false;
+    }
+
+    std::cout << "STVRAssetRegistry: uploaded [ " << asset.name << " ] " << SOIL_last_result() << std::endl;
+
+    GLenum bindTarget = isCubemap ? GL_TEXTURE_CUBE_MAP : GL_TEXTURE_2D;
+    GLenum levelTarget = isCubemap ? GL_TEXTURE_CUBE_MAP_POSITIVE_X : GL_TEXTURE_2D;
+
+    GLint width = 0, height = 0;
+    glBindTexture(bindTarget, texID);
+    glGetTexLevelParameteriv(levelTarget, 0, GL_TEXTURE_WIDTH, &width);
+    glGetTexLevelParameteriv(levelTarget, 0, GL_TEXTURE_HEIGHT, &height);
+    glBindTexture(bindTarget, 0);
+    HB_CHECK_GL_ERROR();
+
+    resolution[0] = (GLfloat) width;
+    resolution[1] = (GLfloat) height;
+    resolution[2] = 0.f;
+
+    return true;
+}
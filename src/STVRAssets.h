@@ -0,0 +1,125 @@
+#pragma once
+
+#include "STVRShaders.h"
+#include "HBGLResourceWrappers.h"
+
+#include <GL/glew.h>
+
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+using namespace HBGLUtils;
+
+//-----------------------------------------------------------------------------
+// A texture a toy can put in a channel by name.
+
+struct STVRAsset
+{
+    std::string                 name;
+
+    // SHADERTOYVR_IMAGE_TEX or SHADERTOYVR_CUBEMAP_TEX
+    ShaderToyVRChannelType      type;
+
+    // one image, or the six cubemap faces in +x -x +y -y +z -z order
+    std::vector<std::string>    filePaths;
+
+    // SOIL_LOAD_* and SOIL_FLAG_* values
+    int                         forceChannels;
+    unsigned int                loadFlags;
+};
+
+//-----------------------------------------------------------------------------
+// Every channel texture ShaderToyVR knows about, read from a manifest so new
+// textures need no code changes (see resources/assets.manifest for the
+// format).  Toys look their iChannel# values up here while they are parsed,
+// which can happen on the reloader thread, so the manifest is loaded once at
+// startup and never changes after.
+//
+// Textures are shared.  Each asset is uploaded once and handed out to every
+// channel, pass and toy that asks for it for as long as any of them holds on
+// to it; the registry itself only keeps a weak reference, so a texture nobody
+// uses any more is freed.  The render thread and the reloader thread both
+// acquire textures, the one that comes first uploads.
+
+class STVRAssetRegistry
+{
+public:
+
+    static STVRAssetRegistry& Get();
+
+    // - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+    // ACCESSORS
+
+    // NULL if no asset has this name.
+    const STVRAsset* Find(const std::string& assetName) const;
+
+    // Estimated size of assetName's texture (mip chain and cubemap faces
+    // included), 0 if it is not uploaded right now.
+    size_t GetTextureBytes(const std::string& assetName) const;
+
+    // - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+    // MODIFIERS
+
+    // Read every asset in manifestPath.  Returns false if the manifest could
+    // not be read or a line in it is malformed (the good lines still load).
+    bool LoadManifest(const std::string& manifestPath);
+
+    // The texture for assetName and its size, uploading it if no one holds
+    // it right now.  Call on a thread whose context shares with the render
+    // thread's.
+    bool AcquireTexture(const std::string& assetName,
+        HBGLTextureResourcePtr& texture,
+        GLfloat resolution[3]);
+
+    // AcquireTexture for every image and cubemap channel of fragShader.
+    // Stream and buffer channels are left as they are.
+    void AcquireChannelTextures(const STVRFragmentShader* fragShader,
+        HBGLTextureResourcePtr channelTextures[SHADERTOYVR_NUMCHANNELS],
+        GLfloat channelResolutions[SHADERTOYVR_NUMCHANNELS][3]);
+
+private:
+
+    STVRAssetRegistry();
+
+    // toys hold asset names, never registries, so nothing needs a copy
+    STVRAssetRegistry(const STVRAssetRegistry&);
+    STVRAssetRegistry& operator=(const STVRAssetRegistry&);
+
+    bool _ParseAsset(const std::string& manifestDirectory,
+        const std::string& assetName,
+        const std::string& assetValue,
+        STVRAsset& asset) const;
+
+    bool _FindSharedTexture(const std::string& assetName,
+        HBGLTextureResourcePtr& texture,
+        GLfloat resolution[3]) const;
+
+    bool _UploadTexture(const STVRAsset& asset,
+        HBGLTextureResourcePtr& texture,
+        GLfloat resolution[3]) const;
+
+    struct SharedTexture {
+        std::weak_ptr<HBGLTextureResource>  texture;
+        GLfloat                             resolution[3];
+        size_t                              gpuBytes;
+    };
+
+    typedef std::unordered_map<std::string, STVRAsset> AssetMap;
+    typedef std::unordered_map<std::string, SharedTexture> SharedTextureMap;
+
+    // constructed with the other globals, main() fills it from the manifest
+    // before the reloader thread starts looking names up
+    static STVRAssetRegistry    s_assetRegistry;
+
+    AssetMap                    m_assets;
+
+    // m_textureMutex guards the map and is never held while reading a file;
+    // m_uploadMutex keeps SOIL, which reports errors through a global, to
+    // one upload at a time
+    SharedTextureMap            m_textures;
+    mutable std::mutex          m_textureMutex;
+    std::mutex                  m_uploadMutex;
+};
@@ -0,0 +1,485 @@
+#include "STVRAudioStream.h"
+#include "HBGLUtils.h"
+
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <iostream>
+
+// Web Audio analyser defaults, which is what shadertoy's sound texture uses
+static const float c_AnalyserMinDecibels = -100.f;
+static const float c_AnalyserMaxDecibels = -30.f;
+static const float c_AnalyserSmoothing = 0.8f;
+
+// the worker analyses the most recent window once per block of this many samples
+static const unsigned int c_AudioBlockSize = 512;
+
+static const unsigned int c_CaptureStandInSampleRate = 44100;
+static const double c_TwoPi = 6.283185307179586;
+
+// ''''''''''''''''''''''''''''''''''''''''''''''''''''''''''''''''''''''''''''
+// STVRAudioSource
+// ,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,
+
+STVRAudioSource::STVRAudioSource() :
+m_sampleRate(0),
+m_sampleCount(0)
+{
+
+}
+
+// ----------------------------------------------------------------------------
+
+STVRAudioSource::~STVRAudioSource()
+{
+
+}
+
+// ----------------------------------------------------------------------------
+
+unsigned int
+STVRAudioSource::GetSampleRate() const
+{
+    return m_sampleRate;
+}
+
+// ----------------------------------------------------------------------------
+
+unsigned long long
+STVRAudioSource::GetSampleCount() const
+{
+    return m_sampleCount;
+}
+
+// ''''''''''''''''''''''''''''''''''''''''''''''''''''''''''''''''''''''''''''
+// STVRWavAudioSource
+// ,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,
+
+static unsigned int
+ReadLittleEndian16(const unsigned char* bytes)
+{
+    return (unsigned int)(bytes[0]) | ((unsigned int)(bytes[1]) << 8);
+}
+
+static unsigned int
+ReadLittleEndian32(const unsigned char* bytes)
+{
+    return (unsigned int)(bytes[0]) | ((unsigned int)(bytes[1]) << 8) |
+        ((unsigned int)(bytes[2]) << 16) | ((unsigned int)(bytes[3]) << 24);
+}
+
+static const unsigned int c_WavFormatPCM = 0x0001;
+static const unsigned int c_WavFormatFloat = 0x0003;
+static const unsigned int c_WavFormatExtensible = 0xFFFE;
+
+// ----------------------------------------------------------------------------
+
+STVRWavAudioSource::STVRWavAudioSource() :
+m_sampleData(NULL),
+m_channels(0),
+m_bytesPerSample(0),
+m_floatSamples(false)
+{
+
+}
+
+// ----------------------------------------------------------------------------
+
+STVRWavAudioSource::~STVRWavAudioSource()
+{
+
+}
+
+// ----------------------------------------------------------------------------
+
+bool
+STVRWavAudioSource::Open(const std::string& sourcePath)
+{
+    if (!m_wavFile.Open(sourcePath)) {
+        std::cerr << "STVRWavAudioSource ERROR: could not open [ " << sourcePath << " ] " << std::endl;
+        return false;
+    }
+
+    const unsigned char* wavData = reinterpret_cast<const unsigned char*>(m_wavFile.GetData());
+    size_t wavSize = m_wavFile.GetSize();
+
+    if (wavSize < 12 || memcmp(wavData, "RIFF", 4) != 0 || memcmp(wavData + 8, "WAVE", 4) != 0) {
+        std::cerr << "STVRWavAudioSource ERROR: [ " << sourcePath << " ] is not a RIFF WAVE file" << std::endl;
+        return false;
+    }
+
+    unsigned int formatTag = 0;
+    unsigned int bitsPerSample = 0;
+    size_t dataOffset = 0;
+    size_t dataSize = 0;
+    bool foundFormat = false;
+    bool foundData = false;
+
+    size_t chunkPos = 12;
+    while (chunkPos + 8 <= wavSize)
+    {
+        const unsigned char* chunk = wavData + chunkPos;
+        size_t chunkBody = chunkPos + 8;
+        size_t chunkSize = ReadLittleEndian32(chunk + 4);
+
+        // files cut short while recording often claim more data than they hold
+        if (chunkSize > wavSize - chunkBody) {
+            chunkSize = wavSize - chunkBody;
+        }
+
+        if (memcmp(chunk, "fmt ", 4) == 0 && chunkSize >= 16)
+        {
+            const unsigned char* format = wavData + chunkBody;
+            formatTag = ReadLittleEndian16(format);
+            m_channels = ReadLittleEndian16(format + 2);
+            m_sampleRate = ReadLittleEndian32(format + 4);
+            bitsPerSample = ReadLittleEndian16(format + 14);
+
+            // the real format of an extensible file is the start of its sub format GUID
+            if (formatTag == c_WavFormatExtensible && chunkSize >= 26) {
+                formatTag = ReadLittleEndian16(format + 24);
+            }
+            foundFormat = true;
+        }
+        else if (memcmp(chunk, "data", 4) == 0)
+        {
+            dataOffset = chunkBody;
+            dataSize = chunkSize;
+            foundData = true;
+        }
+
+        // chunks are padded to an even size
+        chunkPos = chunkBody + chunkSize + (chunkSize & 1);
+    }
+
+    if (!foundFormat || !foundData) {
+        std::cerr << "STVRWavAudioSource ERROR: [ " << sourcePath << " ] is missing its fmt or data chunk" << std::endl;
+        return false;
+    }
+
+    bool supportedPCM = (formatTag == c_WavFormatPCM &&
+        (bitsPerSample == 8 || bitsPerSample == 16 || bitsPerSample == 24 || bitsPerSample == 32));
+    bool supportedFloat = (formatTag == c_WavFormatFloat && bitsPerSample == 32);
+
+    if ((!supportedPCM && !supportedFloat) || m_channels == 0 || m_sampleRate == 0) {
+        std::cerr << "STVRWavAudioSource ERROR: [ " << sourcePath << " ] has an unsupported format (tag " << formatTag << \
+            ", " << bitsPerSample << " bits, " << m_channels << " channels)" << std::endl;
+        return false;
+    }
+
+    m_floatSamples = supportedFloat;
+    m_bytesPerSample = bitsPerSample / 8;
+    m_sampleData = m_wavFile.GetData() + dataOffset;
+    m_sampleCount = dataSize / (m_channels * m_bytesPerSample);
+
+    if (m_sampleCount == 0) {
+        std::cerr << "STVRWavAudioSource ERROR: [ " << sourcePath << " ] holds no samples" << std::endl;
+        return false;
+    }
+
+    return true;
+}
+
+// ----------------------------------------------------------------------------
+
+float
+STVRWavAudioSource::DecodeSample(const unsigned char* sampleData) const
+{
+    if (m_floatSamples) {
+        float sample;
+        memcpy(&sample, sampleData, sizeof(float));
+        return sample;
+    }
+
+    switch (m_bytesPerSample)
+    {
+    case 1:
+        return (float(sampleData[0]) - 128.f) / 128.f;
+    case 2:
+        return float(short(ReadLittleEndian16(sampleData))) / 32768.f;
+    case 3:
+        // place the 24 bits at the top of an int so the shift back down sign extends
+        return float(int(((unsigned int)(sampleData[0]) << 8) | ((unsigned int)(sampleData[1]) << 16) |
+            ((unsigned int)(sampleData[2]) << 24)) >> 8) / 8388608.f;
+    default:
+        return float(int(ReadLittleEndian32(sampleData))) / 2147483648.f;
+    }
+}
+
+// ----------------------------------------------------------------------------
+
+void
+STVRWavAudioSource::ReadSamples(long long firstSample, unsigned int sampleCount, float* samples) const
+{
+    const unsigned char* sampleData = reinterpret_cast<const unsigned char*>(m_sampleData);
+    size_t frameSize = m_channels * m_bytesPerSample;
+    float channelScale = 1.f / float(m_channels);
+
+    for (unsigned int sampleIdx = 0; sampleIdx < sampleCount; sampleIdx++)
+    {
+        long long absoluteIdx = firstSample + sampleIdx;
+        if (absoluteIdx < 0) {
+            samples[sampleIdx] = 0.f;
+            continue;
+        }
+
+        const unsigned char* frame = sampleData + frameSize * size_t(absoluteIdx % m_sampleCount);
+
+        float mix = 0.f;
+        for (unsigned int channelIdx = 0; channelIdx < m_channels; channelIdx++) {
+            mix += DecodeSample(frame + channelIdx * m_bytesPerSample);
+        }
+        samples[sampleIdx] = mix * channelScale;
+    }
+}
+
+// ''''''''''''''''''''''''''''''''''''''''''''''''''''''''''''''''''''''''''''
+// STVRCaptureStandInSource
+// ,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,
+
+STVRCaptureStandInSource::STVRCaptureStandInSource()
+{
+    m_sampleRate = c_CaptureStandInSampleRate;
+    m_sampleCount = 0;
+}
+
+// ----------------------------------------------------------------------------
+
+STVRCaptureStandInSource::~STVRCaptureStandInSource()
+{
+
+}
+
+// ----------------------------------------------------------------------------
+
+bool
+STVRCaptureStandInSource::Open(const std::string& /*sourcePath*/)
+{
+    return true;
+}
+
+// ----------------------------------------------------------------------------
+
+void
+STVRCaptureStandInSource::ReadSamples(long long firstSample, unsigned int sampleCount, float* samples) const
+{
+    static const double chordRoots[4] = { 220.0, 174.61, 261.63, 196.0 };
+    static const double beatLength = 0.5;
+
+    for (unsigned int sampleIdx = 0; sampleIdx < sampleCount; sampleIdx++)
+    {
+        long long absoluteIdx = firstSample + sampleIdx;
+        if (absoluteIdx < 0) {
+            samples[sampleIdx] = 0.f;
+            continue;
+        }
+
+        double t = double(absoluteIdx) / double(m_sampleRate);
+
+        // kick with a falling pitch at the start of every beat
+        double beatTime = fmod(t, beatLength);
+        double kick = sin(c_TwoPi * (45.0 * beatTime + 2.0 * (1.0 - exp(-beatTime * 25.0)))) * exp(-beatTime * 9.0);
+
+        // off beat hat from a hashed noise source
+        unsigned int noiseHash = static_cast<unsigned int>(absoluteIdx) * 747796405u + 2891336453u;
+        noiseHash = ((noiseHash >> ((noiseHash >> 28) + 4)) ^ noiseHash) * 277803737u;
+        double noise = double((noiseHash >> 22) ^ noiseHash) / 4294967295.0 * 2.0 - 1.0;
+        double hat = noise * exp(-fmod(t + 0.5 * beatLength, beatLength) * 60.0);
+
+        // triad that changes every two bars
+        double root = chordRoots[static_cast<long long>(t / (8.0 * beatLength)) % 4];
+        double pad = sin(c_TwoPi * root * t) + sin(c_TwoPi * root * 1.26 * t) + sin(c_TwoPi * root * 1.5 * t);
+        pad *= 0.5 + 0.5 * sin(c_TwoPi * 0.25 * t);
+
+        double mix = 0.6 * kick + 0.15 * hat + 0.1 * pad;
+        samples[sampleIdx] = static_cast<float>(mix > 1.0 ? 1.0 : (mix < -1.0 ? -1.0 : mix));
+    }
+}
+
+// ''''''''''''''''''''''''''''''''''''''''''''''''''''''''''''''''''''''''''''
+// STVRAudioStream
+// ,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,
+
+STVRAudioStream::STVRAudioStream(const std::string& name, STVRAudioSource* audioSource) :
+STVRChannelStream(name),
+m_audioSource(audioSource),
+m_fft(FFT_SIZE),
+m_texels(Texels())
+{
+    m_streamTime.store(0.f);
+    m_stopWorker.store(false);
+    m_analysedBlockCount.store(0);
+}
+
+// ----------------------------------------------------------------------------
+
+STVRAudioStream::~STVRAudioStream()
+{
+    StopWorker();
+}
+
+// ----------------------------------------------------------------------------
+
+unsigned int
+STVRAudioStream::GetAnalysedBlockCount() const
+{
+    return m_analysedBlockCount.load();
+}
+
+// ----------------------------------------------------------------------------
+
+bool
+STVRAudioStream::Open(const std::string& sourcePath)
+{
+    if (!m_audioSource || !m_audioSource->Open(sourcePath)) {
+        std::cerr << "STVRAudioStream ERROR [ " << m_streamName << " ]: could not open audio source [ " << sourcePath << " ] " << std::endl;
+        return false;
+    }
+
+    m_sampleRate = static_cast<float>(m_audioSource->GetSampleRate());
+
+    // all of the analysis memory is allocated here so the worker never allocates
+    m_window.resize(FFT_SIZE);
+    m_samples.resize(FFT_SIZE);
+    m_fftReal.resize(FFT_SIZE);
+    m_fftImag.resize(FFT_SIZE);
+    m_magnitudes.resize(TEXTURE_WIDTH);
+    m_smoothedMagnitudes.assign(TEXTURE_WIDTH, 0.f);
+    HBGLFFT::BlackmanWindow(&m_window[0], FFT_SIZE);
+
+    // The sound texture is single channel.  Shadertoy samples it as luminance,
+    // so swizzle red across rgb to read the same in a core profile.
+    m_texture = HBGLTextureResourcePtr(new HBGLTextureResource());
+    m_texture->Generate();
+    glBindTexture(GL_TEXTURE_2D, m_texture->GetIndex());
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_SWIZZLE_G, GL_RED);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_SWIZZLE_B, GL_RED);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_R8, TEXTURE_WIDTH, TEXTURE_HEIGHT, 0, GL_RED, GL_UNSIGNED_BYTE, m_texels.GetReadState().values);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+    glBindTexture(GL_TEXTURE_2D, 0);
+    HB_CHECK_GL_ERROR();
+
+    m_resolution[0] = static_cast<GLfloat>(TEXTURE_WIDTH);
+    m_resolution[1] = static_cast<GLfloat>(TEXTURE_HEIGHT);
+    m_resolution[2] = 1.f;
+
+    m_stopWorker.store(false);
+    m_worker = std::thread(&STVRAudioStream::WorkerLoop, this);
+
+    std::cout << "STVRAudioStream [ " << m_streamName << " ]: " << m_audioSource->GetSampleRate() << " Hz, ";
+    if (m_audioSource->GetSampleCount() > 0) {
+        std::cout << double(m_audioSource->GetSampleCount()) / m_sampleRate << " secs" << std::endl;
+    }
+    else {
+        std::cout << "endless" << std::endl;
+    }
+
+    return true;
+}
+
+// ----------------------------------------------------------------------------
+
+void
+STVRAudioStream::StopWorker()
+{
+    m_stopWorker.store(true);
+    if (m_worker.joinable()) {
+        m_worker.join();
+    }
+}
+
+// ----------------------------------------------------------------------------
+
+void
+STVRAudioStream::WorkerLoop()
+{
+    unsigned int sampleRate = m_audioSource->GetSampleRate();
+
+    // poll a few times per block so a new block is picked up promptly
+    std::chrono::microseconds pollInterval(1000000LL * c_AudioBlockSize / (4 * sampleRate));
+    long long analysedBlock = -1;
+
+    while (!m_stopWorker.load())
+    {
+        long long endSample = static_cast<long long>(double(m_streamTime.load()) * sampleRate);
+        long long currentBlock = endSample / c_AudioBlockSize;
+
+        if (currentBlock != analysedBlock)
+        {
+            analysedBlock = currentBlock;
+            AnalyseBlock(endSample, m_texels.GetWriteState().values);
+            m_texels.Publish();
+            m_analysedBlockCount++;
+        }
+
+        std::this_thread::sleep_for(pollInterval);
+    }
+}
+
+// ----------------------------------------------------------------------------
+
+void
+STVRAudioStream::AnalyseBlock(long long endSample, unsigned char* texels)
+{
+    m_audioSource->ReadSamples(endSample - FFT_SIZE, FFT_SIZE, &m_samples[0]);
+
+    // spectrum row
+    HBGLFFT::Multiply(&m_samples[0], &m_window[0], &m_fftReal[0], FFT_SIZE);
+    memset(&m_fftImag[0], 0, FFT_SIZE * sizeof(float));
+    m_fft.Forward(&m_fftReal[0], &m_fftImag[0]);
+    HBGLFFT::Magnitude(&m_fftReal[0], &m_fftImag[0], &m_magnitudes[0], TEXTURE_WIDTH, 1.f / float(FFT_SIZE));
+
+    const float decibelScale = 255.f / (c_AnalyserMaxDecibels - c_AnalyserMinDecibels);
+    for (unsigned int binIdx = 0; binIdx < TEXTURE_WIDTH; binIdx++)
+    {
+        float smoothed = c_AnalyserSmoothing * m_smoothedMagnitudes[binIdx] + (1.f - c_AnalyserSmoothing) * m_magnitudes[binIdx];
+        m_smoothedMagnitudes[binIdx] = smoothed;
+
+        float decibels = (smoothed > 0.f) ? 20.f * log10f(smoothed) : c_AnalyserMinDecibels;
+        float texel = (decibels - c_AnalyserMinDecibels) * decibelScale;
+        texels[binIdx] = static_cast<unsigned char>(texel < 0.f ? 0.f : (texel > 255.f ? 255.f : texel));
+    }
+
+    // waveform row, the newest samples of the window
+    const float* waveform = &m_samples[FFT_SIZE - TEXTURE_WIDTH];
+    for (unsigned int sampleIdx = 0; sampleIdx < TEXTURE_WIDTH; sampleIdx++)
+    {
+        float texel = 128.f * (waveform[sampleIdx] + 1.f);
+        texels[TEXTURE_WIDTH + sampleIdx] = static_cast<unsigned char>(texel < 0.f ? 0.f : (texel > 255.f ? 255.f : texel));
+    }
+}
+
+// ----------------------------------------------------------------------------
+
+void
+STVRAudioStream::Update(float playbackTimeInSecs)
+{
+    if (!m_texture) {
+        return;
+    }
+
+    // files loop, the stand in capture just keeps running
+    m_channelTime = (playbackTimeInSecs > 0.f) ? playbackTimeInSecs : 0.f;
+    unsigned long long sampleCount = m_audioSource->GetSampleCount();
+    if (sampleCount > 0) {
+        m_channelTime = fmodf(m_channelTime, static_cast<float>(double(sampleCount) / m_sampleRate));
+    }
+    m_streamTime.store(m_channelTime);
+
+    // nothing new from the worker, keep the texture we have
+    if (!m_texels.Consume()) {
+        return;
+    }
+
+    glBindTexture(GL_TEXTURE_2D, m_texture->GetIndex());
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, TEXTURE_WIDTH, TEXTURE_HEIGHT, GL_RED, GL_UNSIGNED_BYTE, m_texels.GetReadState().values);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+    glBindTexture(GL_TEXTURE_2D, 0);
+    HB_CHECK_GL_ERROR();
+}
@@ -0,0 +1,153 @@
+#pragma once
+
+#include "STVRChannelStreams.h"
+#include "HBGLFFT.h"
+#include "HBGLMappedFile.h"
+#include "HBGLTripleBuffer.h"
+
+#include <atomic>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace HBGLUtils;
+
+//-----------------------------------------------------------------------------
+// Audio sources hand out mono samples in [-1, 1] by absolute sample index.
+// Indices before the start of the source read as silence, and sources with a
+// fixed length loop.  ReadSamples is only ever called from the analysis
+// worker of the owning stream.
+
+class STVRAudioSource
+{
+public:
+
+    STVRAudioSource();
+    virtual ~STVRAudioSource();
+
+    virtual bool Open(const std::string& sourcePath) = 0;
+    virtual void ReadSamples(long long firstSample, unsigned int sampleCount, float* samples) const = 0;
+
+    unsigned int GetSampleRate() const;
+
+    // 0 for sources that never end
+    unsigned long long GetSampleCount() const;
+
+protected:
+
+    unsigned int        m_sampleRate;
+    unsigned long long  m_sampleCount;
+};
+
+//-----------------------------------------------------------------------------
+// Plays a memory mapped WAV file.  Integer PCM of 8, 16, 24 or 32 bits and
+// 32 bit float data are supported, with any number of channels mixed down
+// to mono.
+
+class STVRWavAudioSource : public STVRAudioSource
+{
+public:
+
+    STVRWavAudioSource();
+    ~STVRWavAudioSource();
+
+    bool Open(const std::string& sourcePath) override;
+    void ReadSamples(long long firstSample, unsigned int sampleCount, float* samples) const override;
+
+private:
+
+    float DecodeSample(const unsigned char* sampleData) const;
+
+    HBGLMappedFile  m_wavFile;
+    const char*     m_sampleData;
+    unsigned int    m_channels;
+    unsigned int    m_bytesPerSample;
+    bool            m_floatSamples;
+};
+
+//-----------------------------------------------------------------------------
+// Stands in for a live capture device: a synthesized loop with a kick on
+// every beat over a slowly moving chord, so audio reactive toys can be
+// developed without a line in.  The source path is ignored.
+
+class STVRCaptureStandInSource : public STVRAudioSource
+{
+public:
+
+    STVRCaptureStandInSource();
+    ~STVRCaptureStandInSource();
+
+    bool Open(const std::string& sourcePath) override;
+    void ReadSamples(long long firstSample, unsigned int sampleCount, float* samples) const override;
+};
+
+//-----------------------------------------------------------------------------
+// Produces shadertoy's 512 x 2 sound texture from an audio source.  Row 0
+// holds the spectrum (the first 512 bins of a 2048 point FFT, in decibels
+// mapped to [0, 1] the same way a Web Audio analyser does) and row 1 holds
+// the most recent 512 samples of the waveform.
+//
+// A worker thread analyses one block of audio at a time and publishes each
+// finished texture through an HBGLTripleBuffer.  Update just swaps in the
+// newest texture if there is one and uploads it, so the render thread never
+// waits on the analysis.
+
+class STVRAudioStream : public STVRChannelStream
+{
+public:
+
+    // - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+    // CONSTRO/DESTRO
+
+    // Takes ownership of audioSource.
+    STVRAudioStream(const std::string& name, STVRAudioSource* audioSource);
+    ~STVRAudioStream();
+
+    // - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+    // MODIFIERS
+
+    bool Open(const std::string& sourcePath) override;
+    void Update(float playbackTimeInSecs) override;
+
+    // - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+    // ACCESSORS
+
+    unsigned int GetAnalysedBlockCount() const;
+
+private:
+
+    enum {
+        TEXTURE_WIDTH = 512,
+        TEXTURE_HEIGHT = 2,
+        TEXTURE_SIZE = TEXTURE_WIDTH * TEXTURE_HEIGHT,
+        FFT_SIZE = 2048
+    };
+
+    struct Texels
+    {
+        unsigned char   values[TEXTURE_SIZE];
+    };
+
+    void WorkerLoop();
+    void StopWorker();
+    void AnalyseBlock(long long endSample, unsigned char* texels);
+
+    std::unique_ptr<STVRAudioSource>    m_audioSource;
+    HBGLFFT                             m_fft;
+
+    // analysis scratch, only touched by the worker
+    std::vector<float>                  m_window;
+    std::vector<float>                  m_samples;
+    std::vector<float>                  m_fftReal;
+    std::vector<float>                  m_fftImag;
+    std::vector<float>                  m_magnitudes;
+    std::vector<float>                  m_smoothedMagnitudes;
+
+    HBGLTripleBuffer<Texels>            m_texels;
+
+    std::atomic<float>                  m_streamTime;
+    std::atomic<bool>                   m_stopWorker;
+    std::atomic<unsigned int>           m_analysedBlockCount;
+    std::thread                         m_worker;
+};
@@ -0,0 +1,147 @@
+#include "STVRBench.h"
+
+// ''''''''''''''''''''''''''''''''''''''''''''''''''''''''''''''''''''''''''''
+// STVRBench
+// ,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,
+
+double
+STVRBench::GetNanosecsSince(STVRBenchClock::time_point startTime)
+{
+    return std::chrono::duration<double, std::nano>(STVRBenchClock::now() - startTime).count();
+}
+
+// ----------------------------------------------------------------------------
+
+STVRBench::STVRBench(const std::string& benchName) :
+m_benchName(benchName),
+m_passed(true)
+{
+
+}
+
+// ----------------------------------------------------------------------------
+
+STVRBench::~STVRBench()
+{
+
+}
+
+// ----------------------------------------------------------------------------
+
+bool
+STVRBench::Run(std::ostream& out)
+{
+    m_passed = true;
+    _RunCases(out);
+    return m_passed;
+}
+
+// ----------------------------------------------------------------------------
+
+std::ostream&
+STVRBench::_BeginLine(std::ostream& out, const std::string& caseName) const
+{
+    out << m_benchName;
+    if (!caseName.empty()) {
+        out << " [ " << caseName << " ]";
+    }
+    return out << ": ";
+}
+
+// ----------------------------------------------------------------------------
+
+void
+STVRBench::_Fail(const std::string& caseName, const std::string& reason)
+{
+    std::cerr << m_benchName << " ERROR [ " << caseName << " ]: " << reason << std::endl;
+    m_passed = false;
+}
+
+// ''''''''''''''''''''''''''''''''''''''''''''''''''''''''''''''''''''''''''''
+// STVRBenchSpans
+// ,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,
+
+STVRBenchSpans::STVRBenchSpans() :
+m_count(0),
+m_totalNanosecs(0.),
+m_worstNanosecs(0.),
+m_lapTime(STVRBenchClock::now())
+{
+
+}
+
+// ----------------------------------------------------------------------------
+
+STVRBenchSpans::~STVRBenchSpans()
+{
+
+}
+
+// ----------------------------------------------------------------------------
+
+unsigned long long
+STVRBenchSpans::GetCount() const
+{
+    return m_count;
+}
+
+// ----------------------------------------------------------------------------
+
+double
+STVRBenchSpans::GetMeanNanosecs() const
+{
+    return m_count ? m_totalNanosecs / double(m_count) : 0.;
+}
+
+// ----------------------------------------------------------------------------
+
+double
+STVRBenchSpans::GetWorstNanosecs() const
+{
+    return m_worstNanosecs;
+}
+
+// ----------------------------------------------------------------------------
+
+STVRBenchClock::time_point
+STVRBenchSpans::GetLapTime() const
+{
+    return m_lapTime;
+}
+
+// ----------------------------------------------------------------------------
+
+void
+STVRBenchSpans::Start()
+{
+    m_lapTime = STVRBenchClock::now();
+}
+
+// ----------------------------------------------------------------------------
+
+double
+STVRBenchSpans::Lap()
+{
+    STVRBenchClock::time_point lapTime = STVRBenchClock::now();
+    double spanNanosecs = std::chrono::duration<double, std::nano>(lapTime - m_lapTime).count();
+    m_lapTime = lapTime;
+
+    m_count++;
+    m_totalNanosecs += spanNanosecs;
+    if (spanNanosecs > m_worstNanosecs) {
+        m_worstNanosecs = spanNanosecs;
+    }
+    return spanNanosecs;
+}
+
+// ----------------------------------------------------------------------------
+
+void
+STVRBenchSpans::Add(const STVRBenchSpans& otherSpans)
+{
+    m_count += otherSpans.m_count;
+    m_totalNanosecs += otherSpans.m_totalNanosecs;
+    if (otherSpans.m_worstNanosecs > m_worstNanosecs) {
+        m_worstNanosecs = otherSpans.m_worstNanosecs;
+    }
+}
@@ -0,0 +1,121 @@
+#pragma once
+
+#include <chrono>
+#include <iostream>
+#include <string>
+
+typedef std::chrono::steady_clock STVRBenchClock;
+
+//-----------------------------------------------------------------------------
+// What the --bench benchmarks share.  Each one derives from STVRBench and
+// runs its cases in _RunCases, printing a line per case that _BeginLine
+// starts with the benchmark's name and the case's, and reporting a case that
+// went wrong (a torn read, a lost command, two parsers disagreeing) with
+// _Fail.  Run returns false if any case failed.
+//
+// The things a case compares are usually small classes with a static
+// GetName() for the line, timed with TimeNanosecs or STVRBenchSpans.
+
+class STVRBench
+{
+public:
+
+    // - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+    // PUBLIC STATIC
+
+    static double GetNanosecsSince(STVRBenchClock::time_point startTime);
+
+    // The mean time of a call to timed, over repeatCount calls.  What timed
+    // returns is summed, so the calls can't be optimized away.
+    template <typename Timed>
+    static double TimeNanosecs(int repeatCount, Timed timed);
+
+    // - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+    // CONSTRO/DESTRO
+
+    explicit STVRBench(const std::string& benchName);
+    virtual ~STVRBench();
+
+    // - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+    // MODIFIERS
+
+    bool Run(std::ostream& out);
+
+protected:
+
+    virtual void _RunCases(std::ostream& out) = 0;
+
+    // "Name [ caseName ]: ", or "Name: " without a case, for the rest of
+    // the line to follow.
+    std::ostream& _BeginLine(std::ostream& out, const std::string& caseName = std::string()) const;
+
+    // Prints the reason as the case's error and fails the run.
+    void _Fail(const std::string& caseName, const std::string& reason);
+
+private:
+
+    std::string     m_benchName;
+    bool            m_passed;
+};
+
+//-----------------------------------------------------------------------------
+// Times a run of spans back to back, one ending where the next begins (a
+// reader reading as fast as it can, a producer pushing), keeping their
+// count, total and worst.  One per thread.
+
+class STVRBenchSpans
+{
+public:
+
+    // - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+    // CONSTRO/DESTRO
+
+    STVRBenchSpans();
+    ~STVRBenchSpans();
+
+    // - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+    // ACCESSORS
+
+    unsigned long long GetCount() const;
+    double GetMeanNanosecs() const;
+    double GetWorstNanosecs() const;
+
+    // When the last span ended.
+    STVRBenchClock::time_point GetLapTime() const;
+
+    // - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+    // MODIFIERS
+
+    // Begins the first span.
+    void Start();
+
+    // Ends a span and begins the next, returning how long it took.
+    double Lap();
+
+    // Counts another thread's spans in with these.
+    void Add(const STVRBenchSpans& otherSpans);
+
+private:
+
+    unsigned long long              m_count;
+    double                          m_totalNanosecs;
+    double                          m_worstNanosecs;
+    STVRBenchClock::time_point      m_lapTime;
+};
+
+// ''''''''''''''''''''''''''''''''''''''''''''''''''''''''''''''''''''''''''''
+// STVRBench
+// ,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,
+
+template <typename Timed>
+double
+STVRBench::TimeNanosecs(int repeatCount, Timed timed)
+{
+    volatile double sink = 0.;
+
+    STVRBenchClock::time_point startTime = STVRBenchClock::now();
+    for (int repeatIdx = 0; repeatIdx < repeatCount; repeatIdx++) {
+        sink = sink + double(timed());
+    }
+    return GetNanosecsSince(startTime) / (repeatCount > 0 ? repeatCount : 1);
+}
@@ -0,0 +1,561 @@
+#include "STVRBufferPasses.h"
+#include "STVRAssets.h"
+#include "HBGLUtils.h"
+
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+
+// float targets so feedback passes can store state, same as shadertoy.com
+static const GLenum c_PassTargetFormat = GL_RGBA32F;
+
+static const GLuint c_PassChannelTextures[4] = { GL_TEXTURE0, GL_TEXTURE1, GL_TEXTURE2, GL_TEXTURE3 };
+
+// ''''''''''''''''''''''''''''''''''''''''''''''''''''''''''''''''''''''''''''
+// STVRBufferPasses
+// ,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,
+
+STVRBufferPasses::STVRBufferPasses()
+{
+    Clear();
+}
+
+// ----------------------------------------------------------------------------
+
+STVRBufferPasses::~STVRBufferPasses()
+{
+}
+
+// ----------------------------------------------------------------------------
+
+void
+STVRBufferPasses::Clear()
+{
+    for (int passIdx = 0; passIdx < SHADERTOYVR_NUMBUFFERPASSES; passIdx++)
+    {
+        BufferPass& pass = m_passes[passIdx];
+        pass.fragShader.reset();
+        pass.program.reset();
+        pass.live = false;
+        pass.renderOnce = false;
+        pass.scale = 1.f;
+
+        for (int channelIdx = 0; channelIdx < SHADERTOYVR_NUMCHANNELS; channelIdx++)
+        {
+            pass.channelTextures[channelIdx].reset();
+            pass.channelResolutions[channelIdx][0] = 0.f;
+            pass.channelResolutions[channelIdx][1] = 0.f;
+            pass.channelResolutions[channelIdx][2] = 0.f;
+        }
+
+        for (int eye = 0; eye < c_NumEyes; eye++)
+        {
+            PassTarget& target = pass.targets[eye];
+            target.textures[0].reset();
+            target.textures[1].reset();
+            target.frameBuffers[0].reset();
+            target.frameBuffers[1].reset();
+            target.width = 0;
+            target.height = 0;
+            target.front = 0;
+            target.rendered = false;
+        }
+    }
+
+    m_passOrder.clear();
+    m_sourceFiles.clear();
+    m_quadBuffer.reset();
+}
+
+// ----------------------------------------------------------------------------
+
+bool
+STVRBufferPasses::Load(const STVRFragmentShader* imageShader, const std::string& binaryCacheDirectory)
+{
+    Clear();
+
+    // parse every declared pass first, liveness depends on what they read
+    for (int passIdx = 0; passIdx < SHADERTOYVR_NUMBUFFERPASSES; passIdx++)
+    {
+        ShaderToyVRBufferPass bufferPass = static_cast<ShaderToyVRBufferPass>(passIdx);
+        const std::string& passSource = imageShader->GetBufferPassSource(bufferPass);
+        if (passSource.empty()) {
+            continue;
+        }
+
+        BufferPass& pass = m_passes[passIdx];
+        pass.fragShader = HBGLShaderPtr(new STVRFragmentShader(passSource));
+        pass.renderOnce = imageShader->IsBufferPassRenderedOnce(bufferPass);
+        pass.scale = imageShader->GetBufferPassScale(bufferPass);
+        m_sourceFiles.push_back(passSource);
+    }
+
+    _MarkLivePasses(imageShader);
+
+    bool result = true;
+    for (int passIdx = 0; passIdx < SHADERTOYVR_NUMBUFFERPASSES; passIdx++)
+    {
+        BufferPass& pass = m_passes[passIdx];
+        if (!pass.fragShader) {
+            continue;
+        }
+
+        if (!pass.live) {
+            std::cout << "STVRBufferPasses: nothing reads [ " << pass.fragShader->GetName() << " ], skipping it" << std::endl;
+            continue;
+        }
+
+        pass.program = HBGLShaderProgramPtr(new HBGLShaderProgram("ShaderToyVR Buffer Pass Shader Program"));
+        pass.program->SetBinaryCacheDirectory(binaryCacheDirectory);
+
+        HBGLShaderPtr vertShader(new STVRVertexShader());
+
+        GLint reservedIndex;
+        bool passResult = pass.program->LoadAndCompileShaders(vertShader, pass.fragShader);
+        pass.program->ReserveAttribLocation("position", &reservedIndex);
+        pass.program->ReserveAttribLocation("texcoord", &reservedIndex);
+        passResult = passResult && pass.program->LinkShaders();
+
+        if (!passResult) {
+            std::cerr << "STVRBufferPasses ERROR: [ " << pass.fragShader->GetName() << " ] did not build (see above), it will read as black" << std::endl;
+            pass.program.reset();
+            pass.live = false;
+            result = false;
+        }
+    }
+
+    _OrderPasses();
+
+    if (m_passOrder.empty()) {
+        return result;
+    }
+
+    GLfloat quadVertices[6][4] =
+    {
+        { -1.0f, 1.0f, 0.0f, 1.0f },
+        { 1.0f, 1.0f, 1.0f, 1.0f },
+        { 1.0f, -1.0f, 1.0f, 0.0f },
+
+        { 1.0f, -1.0f, 1.0f, 0.0f },
+        { -1.0f, -1.0f, 0.0f, 0.0f },
+        { -1.0f, 1.0f, 0.0f, 1.0f }
+    };
+
+    m_quadBuffer = HBGLBufferResourcePtr(new HBGLBufferResource());
+    m_quadBuffer->Generate();
+    glBindBuffer(GL_ARRAY_BUFFER, m_quadBuffer->GetIndex());
+    glBufferData(GL_ARRAY_BUFFER, sizeof(quadVertices), &quadVertices[0], GL_STATIC_DRAW);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    HB_CHECK_GL_ERROR();
+
+    return result;
+}
+
+// ----------------------------------------------------------------------------
+
+void
+STVRBufferPasses::AcquireChannelTextures()
+{
+    for (int passIdx = 0; passIdx < SHADERTOYVR_NUMBUFFERPASSES; passIdx++)
+    {
+        BufferPass& pass = m_passes[passIdx];
+        if (!pass.live) {
+            continue;
+        }
+
+        const STVRFragmentShader* passShader = static_cast<const STVRFragmentShader*>(&*pass.fragShader);
+        for (int channelIdx = 0; channelIdx < SHADERTOYVR_NUMCHANNELS; channelIdx++)
+        {
+            ShaderToyVRInputChannel inputChannel = static_cast<ShaderToyVRInputChannel>(channelIdx);
+            ShaderToyVRChannelType inputType = passShader->GetInputType(inputChannel);
+            if (inputType == SHADERTOYVR_UNKNOWN_TYPE || passShader->IsBufferInput(inputType)) {
+                continue;
+            }
+
+            if (passShader->IsStreamInput(inputType)) {
+                std::cerr << "STVRBufferPasses ERROR: [ " << passShader->GetName() << " ] video and audio channels only work in the image pass" << std::endl;
+                continue;
+            }
+
+            // shared with the image pass and the other passes when they
+            // read the same asset
+            STVRAssetRegistry::Get().AcquireTexture(passShader->GetInputAsset(inputChannel),
+                pass.channelTextures[channelIdx],
+                pass.channelResolutions[channelIdx]);
+        }
+    }
+}
+
+// ----------------------------------------------------------------------------
+
+bool
+STVRBufferPasses::HasPasses() const
+{
+    return !m_passOrder.empty();
+}
+
+// ----------------------------------------------------------------------------
+
+size_t
+STVRBufferPasses::GetGpuBytes() const
+{
+    // two RGBA32F textures per eye and pass
+    size_t gpuBytes = 0;
+    for (int passIdx = 0; passIdx < SHADERTOYVR_NUMBUFFERPASSES; passIdx++)
+    {
+        for (int eye = 0; eye < c_NumEyes; eye++)
+        {
+            const PassTarget& target = m_passes[passIdx].targets[eye];
+            gpuBytes += 2 * size_t(target.width) * size_t(target.height) * 4 * sizeof(GLfloat);
+        }
+    }
+
+    return gpuBytes;
+}
+
+// ----------------------------------------------------------------------------
+
+const STVRFragmentShader*
+STVRBufferPasses::GetPassShader(ShaderToyVRBufferPass bufferPass) const
+{
+    const BufferPass& pass = m_passes[bufferPass];
+    if (!pass.live) {
+        return NULL;
+    }
+
+    return static_cast<const STVRFragmentShader*>(&*pass.fragShader);
+}
+
+// ----------------------------------------------------------------------------
+
+HBGLShaderProgramPtr
+STVRBufferPasses::GetPassProgram(ShaderToyVRBufferPass bufferPass) const
+{
+    const BufferPass& pass = m_passes[bufferPass];
+    if (!pass.live) {
+        return HBGLShaderProgramPtr();
+    }
+
+    return pass.program;
+}
+
+// ----------------------------------------------------------------------------
+
+void
+STVRBufferPasses::GetSourceFiles(std::vector<std::string>& filePaths) const
+{
+    filePaths.insert(filePaths.end(), m_sourceFiles.begin(), m_sourceFiles.end());
+
+    // and whatever the passes #include
+    for (int passIdx = 0; passIdx < SHADERTOYVR_NUMBUFFERPASSES; passIdx++)
+    {
+        const BufferPass& pass = m_passes[passIdx];
+        if (pass.fragShader) {
+            const std::vector<std::string>& sourceStringNames = pass.fragShader->GetSourceStringNames();
+            if (sourceStringNames.size() > 1) {
+                filePaths.insert(filePaths.end(), sourceStringNames.begin() + 1, sourceStringNames.end());
+            }
+        }
+    }
+}
+
+// ----------------------------------------------------------------------------
+
+GLuint
+STVRBufferPasses::GetOutputTexture(int eye, ShaderToyVRBufferPass bufferPass) const
+{
+    const BufferPass& pass = m_passes[bufferPass];
+    const PassTarget& target = pass.targets[eye];
+    if (!pass.live || !target.textures[target.front]) {
+        return 0;
+    }
+
+    return target.textures[target.front]->GetIndex();
+}
+
+// ----------------------------------------------------------------------------
+
+void
+STVRBufferPasses::GetOutputSize(int eye, ShaderToyVRBufferPass bufferPass, GLfloat resolution[3]) const
+{
+    const PassTarget& target = m_passes[bufferPass].targets[eye];
+    resolution[0] = (GLfloat) target.width;
+    resolution[1] = (GLfloat) target.height;
+    resolution[2] = 1.f;
+}
+
+// ----------------------------------------------------------------------------
+
+void
+STVRBufferPasses::Execute(int eye, GLsizei eyeWidth, GLsizei eyeHeight, const STVRPassInputs& inputs)
+{
+    if (m_passOrder.empty()) {
+        return;
+    }
+
+    // Size every target first, so a pass reading one that runs later in the
+    // frame still sees a texture of the right size.
+    for (size_t orderIdx = 0; orderIdx < m_passOrder.size(); orderIdx++)
+    {
+        BufferPass& pass = m_passes[m_passOrder[orderIdx]];
+        GLsizei passWidth = GLsizei(eyeWidth * pass.scale + .5f);
+        GLsizei passHeight = GLsizei(eyeHeight * pass.scale + .5f);
+        _ResizeTarget(pass.targets[eye], passWidth < 1 ? 1 : passWidth, passHeight < 1 ? 1 : passHeight);
+    }
+
+    glDisable(GL_DEPTH_TEST);
+    glDisable(GL_BLEND);
+
+    glBindBuffer(GL_ARRAY_BUFFER, m_quadBuffer->GetIndex());
+
+    for (size_t orderIdx = 0; orderIdx < m_passOrder.size(); orderIdx++)
+    {
+        ShaderToyVRBufferPass bufferPass = m_passOrder[orderIdx];
+        BufferPass& pass = m_passes[bufferPass];
+        PassTarget& target = pass.targets[eye];
+
+        if (pass.renderOnce && target.rendered) {
+            continue;
+        }
+
+        _DrawPass(eye, bufferPass, inputs);
+
+        // what was just drawn is what every later read sees
+        target.front = 1 - target.front;
+        target.rendered = true;
+    }
+
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    glActiveTexture(GL_TEXTURE0);
+    HB_CHECK_GL_ERROR();
+}
+
+// ----------------------------------------------------------------------------
+
+void
+STVRBufferPasses::_MarkLivePasses(const STVRFragmentShader* readingShader)
+{
+    for (int channelIdx = 0; channelIdx < SHADERTOYVR_NUMCHANNELS; channelIdx++)
+    {
+        ShaderToyVRChannelType inputType = readingShader->GetInputType(static_cast<ShaderToyVRInputChannel>(channelIdx));
+        if (!readingShader->IsBufferInput(inputType)) {
+            continue;
+        }
+
+        ShaderToyVRBufferPass bufferPass = readingShader->GetInputBufferPass(inputType);
+        BufferPass& pass = m_passes[bufferPass];
+
+        if (!pass.fragShader) {
+            std::cerr << "STVRBufferPasses ERROR: [ " << readingShader->GetName() << " ] reads buffer "
+                << char('a' + bufferPass) << " but the toy does not declare it" << std::endl;
+            continue;
+        }
+
+        // already visited, which also stops feedback loops
+        if (pass.live) {
+            continue;
+        }
+
+        pass.live = true;
+        _MarkLivePasses(static_cast<const STVRFragmentShader*>(&*pass.fragShader));
+    }
+}
+
+// ----------------------------------------------------------------------------
+
+void
+STVRBufferPasses::_OrderPasses()
+{
+    // reads[p][q]: live pass p reads the output of another live pass q
+    bool reads[SHADERTOYVR_NUMBUFFERPASSES][SHADERTOYVR_NUMBUFFERPASSES];
+    memset(reads, 0, sizeof(reads));
+
+    bool scheduled[SHADERTOYVR_NUMBUFFERPASSES];
+    int liveCount = 0;
+
+    for (int passIdx = 0; passIdx < SHADERTOYVR_NUMBUFFERPASSES; passIdx++)
+    {
+        const BufferPass& pass = m_passes[passIdx];
+        scheduled[passIdx] = !pass.live;
+        if (!pass.live) {
+            continue;
+        }
+
+        liveCount++;
+
+        const STVRFragmentShader* passShader = static_cast<const STVRFragmentShader*>(&*pass.fragShader);
+        for (int channelIdx = 0; channelIdx < SHADERTOYVR_NUMCHANNELS; channelIdx++)
+        {
+            ShaderToyVRChannelType inputType = passShader->GetInputType(static_cast<ShaderToyVRInputChannel>(channelIdx));
+            if (passShader->IsBufferInput(inputType))
+            {
+                int readPassIdx = passShader->GetInputBufferPass(inputType);
+                if (readPassIdx != passIdx && m_passes[readPassIdx].live) {
+                    reads[passIdx][readPassIdx] = true;
+                }
+            }
+        }
+    }
+
+    // Kahn's algorithm, taking the lowest letter whenever there is a choice.
+    // When every remaining pass waits on another (a cycle), the lowest
+    // letter runs anyway and reads last frame's output of the others.
+    m_passOrder.clear();
+    while (int(m_passOrder.size()) < liveCount)
+    {
+        int nextPassIdx = -1;
+        int firstRemainingIdx = -1;
+
+        for (int passIdx = 0; passIdx < SHADERTOYVR_NUMBUFFERPASSES && nextPassIdx < 0; passIdx++)
+        {
+            if (scheduled[passIdx]) {
+                continue;
+            }
+
+            if (firstRemainingIdx < 0) {
+                firstRemainingIdx = passIdx;
+            }
+
+            bool ready = true;
+            for (int readPassIdx = 0; readPassIdx < SHADERTOYVR_NUMBUFFERPASSES; readPassIdx++)
+            {
+                if (reads[passIdx][readPassIdx] && !scheduled[readPassIdx]) {
+                    ready = false;
+                }
+            }
+
+            if (ready) {
+                nextPassIdx = passIdx;
+            }
+        }
+
+        if (nextPassIdx < 0) {
+            nextPassIdx = firstRemainingIdx;
+        }
+
+        scheduled[nextPassIdx] = true;
+        m_passOrder.push_back(static_cast<ShaderToyVRBufferPass>(nextPassIdx));
+    }
+
+    if (!m_passOrder.empty())
+    {
+        std::cout << "STVRBufferPasses: pass order";
+        for (size_t orderIdx = 0; orderIdx < m_passOrder.size(); orderIdx++) {
+            std::cout << " " << char('A' + m_passOrder[orderIdx]);
+        }
+        std::cout << " Image" << std::endl;
+    }
+}
+
+// ----------------------------------------------------------------------------
+
+void
+STVRBufferPasses::_ResizeTarget(PassTarget& target, GLsizei width, GLsizei height)
+{
+    if (target.textures[0] && target.width == width && target.height == height) {
+        return;
+    }
+
+    for (int bufferIdx = 0; bufferIdx < 2; bufferIdx++)
+    {
+        target.textures[bufferIdx] = HBGLTextureResourcePtr(new HBGLTextureResource());
+        target.textures[bufferIdx]->Generate();
+
+        glBindTexture(GL_TEXTURE_2D, target.textures[bufferIdx]->GetIndex());
+        glTexImage2D(GL_TEXTURE_2D, 0, c_PassTargetFormat, width, height, 0, GL_RGBA, GL_FLOAT, NULL);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+        glBindTexture(GL_TEXTURE_2D, 0);
+
+        target.frameBuffers[bufferIdx] = HBGLFrameBufferResourcePtr(new HBGLFrameBufferResource());
+        target.frameBuffers[bufferIdx]->Generate();
+
+        glBindFramebuffer(GL_FRAMEBUFFER, target.frameBuffers[bufferIdx]->GetIndex());
+        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, target.textures[bufferIdx]->GetIndex(), 0);
+
+        if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+            std::cerr << "STVRBufferPasses ERROR: a " << width << "x" << height << " float target is not renderable on this GPU" << std::endl;
+        }
+
+        // feedback passes start from black, not from whatever was in memory
+        glClearColor(0.f, 0.f, 0.f, 0.f);
+        glClear(GL_COLOR_BUFFER_BIT);
+    }
+
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    HB_CHECK_GL_ERROR();
+
+    target.width = width;
+    target.height = height;
+    target.front = 0;
+    target.rendered = false;
+}
+
+// ----------------------------------------------------------------------------
+
+void
+STVRBufferPasses::_DrawPass(int eye, ShaderToyVRBufferPass bufferPass, const STVRPassInputs& inputs)
+{
+    BufferPass& pass = m_passes[bufferPass];
+    PassTarget& target = pass.targets[eye];
+    const STVRFragmentShader* passShader = static_cast<const STVRFragmentShader*>(&*pass.fragShader);
+    HBGLShaderProgram& program = *pass.program;
+
+    glBindFramebuffer(GL_FRAMEBUFFER, target.frameBuffers[1 - target.front]->GetIndex());
+    glViewport(0, 0, target.width, target.height);
+
+    program.EnableVertexAttrib("position", 2, GL_FLOAT, GL_FALSE, 4 * sizeof(GLfloat), 0);
+    program.EnableVertexAttrib("texcoord", 2, GL_FLOAT, GL_FALSE, 4 * sizeof(GLfloat), (void*)(2 * sizeof(GLfloat)));
+    program.ShadersBegin();
+
+    GLfloat channelResolutions[SHADERTOYVR_NUMCHANNELS][3];
+    memcpy(channelResolutions, pass.channelResolutions, sizeof(channelResolutions));
+
+    for (int channelIdx = 0; channelIdx < SHADERTOYVR_NUMCHANNELS; channelIdx++)
+    {
+        ShaderToyVRChannelType inputType = passShader->GetInputType(static_cast<ShaderToyVRInputChannel>(channelIdx));
+        if (inputType == SHADERTOYVR_UNKNOWN_TYPE) {
+            continue;
+        }
+
+        GLuint texID = 0;
+        if (passShader->IsBufferInput(inputType))
+        {
+            ShaderToyVRBufferPass readPass = passShader->GetInputBufferPass(inputType);
+            texID = GetOutputTexture(eye, readPass);
+            GetOutputSize(eye, readPass, channelResolutions[channelIdx]);
+        }
+        else if (pass.channelTextures[channelIdx])
+        {
+            texID = pass.channelTextures[channelIdx]->GetIndex();
+        }
+
+        glActiveTexture(c_PassChannelTextures[channelIdx]);
+        glBindTexture(passShader->Is2DTexInput(inputType) ? GL_TEXTURE_2D : GL_TEXTURE_CUBE_MAP, texID);
+
+        char channelBuffer[10];
+        sprintf(channelBuffer, "iChannel%i", channelIdx);
+        program.SetUniform1i(channelBuffer, channelIdx);
+    }
+
+    GLfloat channelTimes[SHADERTOYVR_NUMCHANNELS] = { inputs.globalTime, inputs.globalTime, inputs.globalTime, inputs.globalTime };
+
+    program.SetUniform1f("iGlobalTime", inputs.globalTime);
+    program.SetUniform2f("iResolution", (GLfloat) target.width, (GLfloat) target.height);
+    program.SetUniform3fv("iChannelResolution", SHADERTOYVR_NUMCHANNELS, &channelResolutions[0][0]);
+    program.SetUniform4f("iDate", inputs.date[0], inputs.date[1], inputs.date[2], inputs.date[3]);
+    program.SetUniform1fv("iChannelTime", SHADERTOYVR_NUMCHANNELS, &channelTimes[0]);
+    program.SetUniform2f("iMouse", 0.f, 0.f);
+    program.SetUniform1f("iSampleRate", inputs.sampleRate);
+    program.SetUniformMatrix4fv("iCameraTransform", 1, GL_FALSE, inputs.cameraTransform);
+    program.SetUniform1f("iFocalLength", inputs.focalLength);
+
+    glDrawArrays(GL_TRIANGLES, 0, 6);
+
+    program.ShadersEnd();
+    program.DisableVertexAttrib("position");
+    program.DisableVertexAttrib("texcoord");
+}
@@ -0,0 +1,132 @@
+#pragma once
+
+#include "STVRShaders.h"
+#include "HBGLResourceWrappers.h"
+
+#include <GL/glew.h>
+
+#include <memory>
+#include <string>
+#include <vector>
+
+using namespace HBGLUtils;
+
+//-----------------------------------------------------------------------------
+// Per frame values every buffer pass sees, in the same units as the image
+// pass uniforms of the same name.
+
+struct STVRPassInputs
+{
+    GLfloat     globalTime;
+    GLfloat     date[4];
+    GLfloat     sampleRate;
+    GLfloat     cameraTransform[16];
+    GLfloat     focalLength;
+};
+
+//-----------------------------------------------------------------------------
+// Runs the buffer passes (Buffer A - D) of a multipass toy.  Each pass is a
+// toy file of its own, drawn into a float render target that any pass,
+// including the image pass, can read through a buffer_a .. buffer_d channel.
+//
+// Every eye has its own pair of targets per pass.  A pass draws into the back
+// target and then flips it to the front, so a pass that reads itself (or a
+// pass that has not run yet this frame) sees the previous frame, and a pass
+// that reads one that already ran sees this frame's output.  Passes run in
+// dependency order; when passes read each other in a cycle the lowest lettered
+// one goes first.  Passes that nothing (directly or indirectly) feeds into the
+// image pass are never built, allocated or drawn.
+
+class STVRBufferPasses
+{
+public:
+
+    // - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+    // CONSTRO/DESTRO
+
+    STVRBufferPasses();
+    ~STVRBufferPasses();
+
+    // Build every live buffer pass declared by imageShader and work out the
+    // order they run in.  Returns false if a live pass failed to build; it
+    // is left out and reads of it come back black.  Runs on any thread with
+    // a context that shares with the render thread's, render targets are
+    // only made in Execute.
+    bool Load(const STVRFragmentShader* imageShader, const std::string& binaryCacheDirectory);
+
+    // Get the image and cubemap textures the live passes read from the
+    // STVRAssetRegistry.
+    void AcquireChannelTextures();
+
+    // Release every program and render target.  Call with the context still
+    // current.
+    void Clear();
+
+    // - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+    // ACCESSORS
+
+    bool HasPasses() const;
+
+    // Bytes held by the render targets allocated so far (not counting the
+    // channel textures, which are shared).
+    size_t GetGpuBytes() const;
+
+    // The parsed toy of a live pass, NULL otherwise.
+    const STVRFragmentShader* GetPassShader(ShaderToyVRBufferPass bufferPass) const;
+
+    // The linked program of a live pass, null otherwise.
+    HBGLShaderProgramPtr GetPassProgram(ShaderToyVRBufferPass bufferPass) const;
+
+    // Files the passes were loaded from, and the files they include, for
+    // watching.
+    void GetSourceFiles(std::vector<std::string>& filePaths) const;
+
+    // The texture a read of bufferPass sees right now, 0 if the pass is not
+    // live or has not run yet.
+    GLuint GetOutputTexture(int eye, ShaderToyVRBufferPass bufferPass) const;
+    void GetOutputSize(int eye, ShaderToyVRBufferPass bufferPass, GLfloat resolution[3]) const;
+
+    // - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+    // MODIFIERS
+
+    // Draw the passes for eye, whose image is eyeWidth x eyeHeight.  Targets
+    // are (re)allocated here when the eye size changes.  Leaves the default
+    // frame buffer bound.
+    void Execute(int eye, GLsizei eyeWidth, GLsizei eyeHeight, const STVRPassInputs& inputs);
+
+private:
+
+    static const int c_NumEyes = 2;
+
+    struct PassTarget {
+        HBGLTextureResourcePtr      textures[2];
+        HBGLFrameBufferResourcePtr  frameBuffers[2];
+        GLsizei                     width;
+        GLsizei                     height;
+        unsigned int                front;
+        bool                        rendered;
+    };
+
+    struct BufferPass {
+        HBGLShaderPtr               fragShader;
+        HBGLShaderProgramPtr        program;
+        bool                        live;
+        bool                        renderOnce;
+        float                       scale;
+        HBGLTextureResourcePtr      channelTextures[SHADERTOYVR_NUMCHANNELS];
+        GLfloat                     channelResolutions[SHADERTOYVR_NUMCHANNELS][3];
+        PassTarget                  targets[c_NumEyes];
+    };
+
+    void _MarkLivePasses(const STVRFragmentShader* readingShader);
+    void _OrderPasses();
+    void _ResizeTarget(PassTarget& target, GLsizei width, GLsizei height);
+    void _DrawPass(int eye, ShaderToyVRBufferPass bufferPass, const STVRPassInputs& inputs);
+
+    BufferPass                          m_passes[SHADERTOYVR_NUMBUFFERPASSES];
+    std::vector<ShaderToyVRBufferPass>  m_passOrder;
+    std::vector<std::string>            m_sourceFiles;
+    HBGLBufferResourcePtr               m_quadBuffer;
+};
+
+typedef std::shared_ptr<STVRBufferPasses> STVRBufferPassesPtr;
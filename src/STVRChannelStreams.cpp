@@ -0,0 +1,687 @@
+#include "STVRChannelStreams.h"
+#include "HBGLUtils.h"
+
+#include "SOIL.h"
+
+#include <cmath>
+#include <cstring>
+#include <iostream>
+
+// ''''''''''''''''''''''''''''''''''''''''''''''''''''''''''''''''''''''''''''
+// STVRChannelStream
+// ,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,
+
+STVRChannelStream::STVRChannelStream(const std::string& name) :
+m_streamName(name),
+m_channelTime(0.f),
+m_sampleRate(0.f)
+{
+    m_resolution[0] = 0.f;
+    m_resolution[1] = 0.f;
+    m_resolution[2] = 0.f;
+}
+
+// ----------------------------------------------------------------------------
+
+STVRChannelStream::~STVRChannelStream()
+{
+
+}
+
+// ----------------------------------------------------------------------------
+
+const std::string&
+STVRChannelStream::GetName() const
+{
+    return m_streamName;
+}
+
+// ----------------------------------------------------------------------------
+
+HBGLTextureResourcePtr
+STVRChannelStream::GetTexture() const
+{
+    return m_texture;
+}
+
+// ----------------------------------------------------------------------------
+
+float
+STVRChannelStream::GetChannelTime() const
+{
+    return m_channelTime;
+}
+
+// ----------------------------------------------------------------------------
+
+const GLfloat*
+STVRChannelStream::GetResolution() const
+{
+    return m_resolution;
+}
+
+// ----------------------------------------------------------------------------
+
+float
+STVRChannelStream::GetSampleRate() const
+{
+    return m_sampleRate;
+}
+
+// ''''''''''''''''''''''''''''''''''''''''''''''''''''''''''''''''''''''''''''
+// STVRVideoFrameSource
+// ,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,
+
+STVRVideoFrameSource::STVRVideoFrameSource() :
+m_width(0),
+m_height(0),
+m_channels(0),
+m_frameCount(0),
+m_frameRate(0.f)
+{
+
+}
+
+// ----------------------------------------------------------------------------
+
+STVRVideoFrameSource::~STVRVideoFrameSource()
+{
+
+}
+
+// ----------------------------------------------------------------------------
+
+unsigned int
+STVRVideoFrameSource::GetWidth() const
+{
+    return m_width;
+}
+
+// ----------------------------------------------------------------------------
+
+unsigned int
+STVRVideoFrameSource::GetHeight() const
+{
+    return m_height;
+}
+
+// ----------------------------------------------------------------------------
+
+unsigned int
+STVRVideoFrameSource::GetChannels() const
+{
+    return m_channels;
+}
+
+// ----------------------------------------------------------------------------
+
+unsigned int
+STVRVideoFrameSource::GetFrameCount() const
+{
+    return m_frameCount;
+}
+
+// ----------------------------------------------------------------------------
+
+float
+STVRVideoFrameSource::GetFrameRate() const
+{
+    return m_frameRate;
+}
+
+// ----------------------------------------------------------------------------
+
+size_t
+STVRVideoFrameSource::GetFrameSize() const
+{
+    return size_t(m_width) * size_t(m_height) * size_t(m_channels);
+}
+
+// ''''''''''''''''''''''''''''''''''''''''''''''''''''''''''''''''''''''''''''
+// STVRImageSequenceSource
+// ,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,
+
+static bool
+IsImageSequenceFrame(const std::string& fileName)
+{
+    static const char* imageExtensions[] = { ".png", ".jpg", ".jpeg", ".tga", ".bmp" };
+
+    size_t extensionPos = fileName.find_last_of('.');
+    if (extensionPos == std::string::npos) {
+        return false;
+    }
+
+    std::string extension = fileName.substr(extensionPos);
+    for (size_t charIdx = 0; charIdx < extension.size(); charIdx++) {
+        extension[charIdx] = static_cast<char>(tolower(extension[charIdx]));
+    }
+
+    for (size_t extIdx = 0; extIdx < sizeof(imageExtensions) / sizeof(imageExtensions[0]); extIdx++) {
+        if (extension == imageExtensions[extIdx]) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+// ----------------------------------------------------------------------------
+
+STVRImageSequenceSource::STVRImageSequenceSource() : STVRVideoFrameSource()
+{
+
+}
+
+// ----------------------------------------------------------------------------
+
+STVRImageSequenceSource::~STVRImageSequenceSource()
+{
+
+}
+
+// ----------------------------------------------------------------------------
+
+bool
+STVRImageSequenceSource::Open(const std::string& sourcePath)
+{
+    std::vector<std::string> fileNames;
+    if (!HBGLUtils::ListDirectory(sourcePath.c_str(), fileNames)) {
+        std::cerr << "STVRImageSequenceSource ERROR: could not read the frame directory [ " << sourcePath << " ] " << std::endl;
+        return false;
+    }
+
+    m_framePaths.clear();
+    for (size_t fileIdx = 0; fileIdx < fileNames.size(); fileIdx++) {
+        if (IsImageSequenceFrame(fileNames[fileIdx])) {
+            m_framePaths.push_back(sourcePath + "/" + fileNames[fileIdx]);
+        }
+    }
+
+    if (m_framePaths.empty()) {
+        std::cerr << "STVRImageSequenceSource ERROR: no frames found in [ " << sourcePath << " ] " << std::endl;
+        return false;
+    }
+
+    // the first frame defines the size of the whole sequence
+    int width = 0, height = 0, channels = 0;
+    unsigned char* firstFrame = SOIL_load_image(m_framePaths[0].c_str(), &width, &height, &channels, SOIL_LOAD_RGBA);
+    if (firstFrame == NULL) {
+        std::cerr << "STVRImageSequenceSource ERROR: could not read [ " << m_framePaths[0] << " ]: " << SOIL_last_result() << std::endl;
+        return false;
+    }
+    SOIL_free_image_data(firstFrame);
+
+    m_width = static_cast<unsigned int>(width);
+    m_height = static_cast<unsigned int>(height);
+    m_channels = 4;
+    m_frameCount = static_cast<unsigned int>(m_framePaths.size());
+    m_frameRate = 0.f;
+
+    return true;
+}
+
+// ----------------------------------------------------------------------------
+
+bool
+STVRImageSequenceSource::DecodeFrame(unsigned int frameIndex, unsigned char* pixels) const
+{
+    if (frameIndex >= m_framePaths.size()) {
+        return false;
+    }
+
+    int width = 0, height = 0, channels = 0;
+    unsigned char* frame = SOIL_load_image(m_framePaths[frameIndex].c_str(), &width, &height, &channels, SOIL_LOAD_RGBA);
+    if (frame == NULL) {
+        std::cerr << "STVRImageSequenceSource ERROR: could not read frame [ " << m_framePaths[frameIndex] << " ] " << std::endl;
+        return false;
+    }
+
+    bool sizeMatches = (static_cast<unsigned int>(width) == m_width && static_cast<unsigned int>(height) == m_height);
+    if (sizeMatches) {
+        memcpy(pixels, frame, GetFrameSize());
+    }
+    else {
+        std::cerr << "STVRImageSequenceSource ERROR: frame [ " << m_framePaths[frameIndex] << " ] is " << width << " x " << height << \
+            " but the sequence is " << m_width << " x " << m_height << std::endl;
+    }
+
+    SOIL_free_image_data(frame);
+    return sizeMatches;
+}
+
+// ''''''''''''''''''''''''''''''''''''''''''''''''''''''''''''''''''''''''''''
+// STVRRawVideoSource
+// ,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,
+
+static const char*   c_RawVideoMagic = "STVRRAW1";
+static const size_t  c_RawVideoHeaderSize = 32;
+
+STVRRawVideoSource::STVRRawVideoSource() : STVRVideoFrameSource(),
+m_dataOffset(0)
+{
+
+}
+
+// ----------------------------------------------------------------------------
+
+STVRRawVideoSource::~STVRRawVideoSource()
+{
+
+}
+
+// ----------------------------------------------------------------------------
+
+bool
+STVRRawVideoSource::Open(const std::string& sourcePath)
+{
+    if (!m_container.Open(sourcePath)) {
+        return false;
+    }
+
+    const char* data = m_container.GetData();
+    if (m_container.GetSize() < c_RawVideoHeaderSize || memcmp(data, c_RawVideoMagic, 8) != 0) {
+        std::cerr << "STVRRawVideoSource ERROR: [ " << sourcePath << " ] is not a raw video container" << std::endl;
+        m_container.Close();
+        return false;
+    }
+
+    unsigned int header[6];
+    memcpy(header, data + 8, sizeof(header));
+
+    m_width = header[0];
+    m_height = header[1];
+    m_channels = header[2];
+    m_frameCount = header[3];
+    memcpy(&m_frameRate, &header[4], sizeof(float));
+    m_dataOffset = header[5];
+
+    // Checked by dividing what the file holds, since multiplying the
+    // header's sizes can overflow size_t on a 32-bit build.
+    size_t fileSize = m_container.GetSize();
+    bool validHeader = (m_channels == 3 || m_channels == 4) &&
+        m_width != 0 && m_height != 0 && m_frameCount != 0 &&
+        m_dataOffset >= c_RawVideoHeaderSize && m_dataOffset <= fileSize &&
+        m_width <= (fileSize - m_dataOffset) / m_height / m_channels;
+    if (!validHeader || m_frameCount > (fileSize - m_dataOffset) / GetFrameSize())
+    {
+        std::cerr << "STVRRawVideoSource ERROR: [ " << sourcePath << " ] has an invalid header or is truncated" << std::endl;
+        m_container.Close();
+        return false;
+    }
+
+    return true;
+}
+
+// ----------------------------------------------------------------------------
+
+bool
+STVRRawVideoSource::DecodeFrame(unsigned int frameIndex, unsigned char* pixels) const
+{
+    if (frameIndex >= m_frameCount) {
+        return false;
+    }
+
+    size_t frameSize = GetFrameSize();
+    memcpy(pixels, m_container.GetData() + m_dataOffset + frameSize * frameIndex, frameSize);
+    return true;
+}
+
+// ''''''''''''''''''''''''''''''''''''''''''''''''''''''''''''''''''''''''''''
+// STVRVideoStream
+// ,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,
+
+static const float c_DefaultVideoFrameRate = 30.f;
+
+STVRVideoStream::STVRVideoStream(const std::string& name,
+    STVRVideoFrameSource* frameSource,
+    unsigned int ringDepth,
+    float frameRate) :
+STVRChannelStream(name),
+m_frameSource(frameSource),
+m_ringDepth(ringDepth < 2 ? 2 : ringDepth),
+m_frameRate(frameRate),
+m_pixelFormat(GL_RGBA),
+m_uploadedFrame(0),
+m_uploadedFrameCount(0),
+m_lateFrameCount(0),
+m_lastLateFrame(0),
+m_stopWorkers(false)
+{
+
+}
+
+// ----------------------------------------------------------------------------
+
+STVRVideoStream::~STVRVideoStream()
+{
+    StopWorkers();
+
+    // the workers are gone, so any mapped slot can be released here on the
+    // render thread before the buffers themselves are deleted.
+    for (size_t slotIdx = 0; slotIdx < m_ringSlots.size(); slotIdx++)
+    {
+        RingSlot& slot = *m_ringSlots[slotIdx];
+        if (slot.pixels != NULL) {
+            glBindBuffer(GL_PIXEL_UNPACK_BUFFER, slot.pixelBuffer->GetIndex());
+            glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+            slot.pixels = NULL;
+        }
+    }
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+}
+
+// ----------------------------------------------------------------------------
+
+unsigned int
+STVRVideoStream::GetUploadedFrameCount() const
+{
+    return m_uploadedFrameCount;
+}
+
+// ----------------------------------------------------------------------------
+
+unsigned int
+STVRVideoStream::GetLateFrameCount() const
+{
+    return m_lateFrameCount;
+}
+
+// ----------------------------------------------------------------------------
+
+bool
+STVRVideoStream::Open(const std::string& sourcePath)
+{
+    if (!m_frameSource || !m_frameSource->Open(sourcePath)) {
+        std::cerr << "STVRVideoStream ERROR [ " << m_streamName << " ]: could not open video source [ " << sourcePath << " ] " << std::endl;
+        return false;
+    }
+
+    if (m_frameRate <= 0.f) {
+        m_frameRate = m_frameSource->GetFrameRate();
+    }
+    if (m_frameRate <= 0.f) {
+        m_frameRate = c_DefaultVideoFrameRate;
+    }
+
+    GLsizei width = static_cast<GLsizei>(m_frameSource->GetWidth());
+    GLsizei height = static_cast<GLsizei>(m_frameSource->GetHeight());
+    m_pixelFormat = (m_frameSource->GetChannels() == 4) ? GL_RGBA : GL_RGB;
+
+    // Video frames are replaced every few frames, so skip the mip chain and
+    // allocate the storage once up front.
+    m_texture = HBGLTextureResourcePtr(new HBGLTextureResource());
+    m_texture->Generate();
+    glBindTexture(GL_TEXTURE_2D, m_texture->GetIndex());
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glTexImage2D(GL_TEXTURE_2D, 0, (m_pixelFormat == GL_RGBA) ? GL_RGBA8 : GL_RGB8,
+        width, height, 0, m_pixelFormat, GL_UNSIGNED_BYTE, NULL);
+    glBindTexture(GL_TEXTURE_2D, 0);
+    HB_CHECK_GL_ERROR();
+
+    m_resolution[0] = static_cast<GLfloat>(width);
+    m_resolution[1] = static_cast<GLfloat>(height);
+    m_resolution[2] = 1.f;
+
+    // a ring deeper than the clip would only hold duplicate frames
+    unsigned int frameCount = m_frameSource->GetFrameCount();
+    unsigned int ringDepth = (m_ringDepth < frameCount) ? m_ringDepth : frameCount;
+
+    GLsizeiptr frameSize = static_cast<GLsizeiptr>(m_frameSource->GetFrameSize());
+    m_ringSlots.clear();
+    for (unsigned int slotIdx = 0; slotIdx < ringDepth; slotIdx++)
+    {
+        RingSlotPtr slot(new RingSlot());
+        slot->pixelBuffer = HBGLBufferResourcePtr(new HBGLBufferResource());
+        slot->pixelBuffer->Generate();
+        slot->pixels = NULL;
+        slot->frameIndex = 0;
+        slot->state.store(RING_SLOT_UNMAPPED);
+
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, slot->pixelBuffer->GetIndex());
+        glBufferData(GL_PIXEL_UNPACK_BUFFER, frameSize, NULL, GL_STREAM_DRAW);
+        m_ringSlots.push_back(slot);
+    }
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+    HB_CHECK_GL_ERROR();
+
+    // nothing has been uploaded yet, frameCount is never a valid frame
+    m_uploadedFrame = frameCount;
+    m_lastLateFrame = frameCount;
+
+    // leave a couple of cores for the render thread and the driver
+    unsigned int numCores = std::thread::hardware_concurrency();
+    unsigned int numWorkers = (numCores > 2) ? numCores - 2 : 1;
+    if (numWorkers > ringDepth) {
+        numWorkers = ringDepth;
+    }
+
+    m_stopWorkers = false;
+    for (unsigned int workerIdx = 0; workerIdx < numWorkers; workerIdx++) {
+        m_workers.push_back(std::thread(&STVRVideoStream::WorkerLoop, this));
+    }
+
+    std::cout << "STVRVideoStream [ " << m_streamName << " ]: " << width << " x " << height << " @ " << m_frameRate << \
+        " fps, " << frameCount << " frames, " << ringDepth << " ring slots, " << numWorkers << " decode threads" << std::endl;
+
+    return true;
+}
+
+// ----------------------------------------------------------------------------
+
+void
+STVRVideoStream::StopWorkers()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_decodeQueueMutex);
+        m_stopWorkers = true;
+        m_decodeQueue.clear();
+    }
+    m_decodeQueueCondition.notify_all();
+
+    for (size_t workerIdx = 0; workerIdx < m_workers.size(); workerIdx++) {
+        m_workers[workerIdx].join();
+    }
+    m_workers.clear();
+}
+
+// ----------------------------------------------------------------------------
+
+void
+STVRVideoStream::WorkerLoop()
+{
+    for (;;)
+    {
+        RingSlot* slot = NULL;
+        {
+            std::unique_lock<std::mutex> lock(m_decodeQueueMutex);
+            while (!m_stopWorkers && m_decodeQueue.empty()) {
+                m_decodeQueueCondition.wait(lock);
+            }
+
+            if (m_stopWorkers) {
+                return;
+            }
+
+            slot = m_decodeQueue.front();
+            m_decodeQueue.pop_front();
+        }
+
+        bool decoded = m_frameSource->DecodeFrame(slot->frameIndex, slot->pixels);
+
+        // publishing the state is what hands the pixels back to the render thread
+        slot->state.store(decoded ? RING_SLOT_READY : RING_SLOT_FAILED, std::memory_order_release);
+    }
+}
+
+// ----------------------------------------------------------------------------
+
+bool
+STVRVideoStream::MapSlot(RingSlot& slot)
+{
+    // Invalidating the whole buffer lets the driver hand back fresh storage
+    // instead of waiting for a pending upload from this buffer to finish.
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, slot.pixelBuffer->GetIndex());
+    slot.pixels = static_cast<unsigned char*>(glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0,
+        static_cast<GLsizeiptr>(m_frameSource->GetFrameSize()),
+        GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT));
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+    HB_CHECK_GL_ERROR();
+
+    return slot.pixels != NULL;
+}
+
+// ----------------------------------------------------------------------------
+
+void
+STVRVideoStream::UploadSlot(RingSlot& slot)
+{
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, slot.pixelBuffer->GetIndex());
+    GLboolean unmapped = glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+    slot.pixels = NULL;
+    slot.state.store(RING_SLOT_UNMAPPED, std::memory_order_relaxed);
+
+    // the buffer contents are undefined if unmapping failed, skip the frame
+    if (unmapped == GL_TRUE)
+    {
+        glBindTexture(GL_TEXTURE_2D, m_texture->GetIndex());
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+        glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0,
+            static_cast<GLsizei>(m_frameSource->GetWidth()),
+            static_cast<GLsizei>(m_frameSource->GetHeight()),
+            m_pixelFormat, GL_UNSIGNED_BYTE, 0);
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+        glBindTexture(GL_TEXTURE_2D, 0);
+        m_uploadedFrameCount++;
+    }
+
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+    HB_CHECK_GL_ERROR();
+
+    m_uploadedFrame = slot.frameIndex;
+}
+
+// ----------------------------------------------------------------------------
+
+void
+STVRVideoStream::QueueSlot(RingSlot& slot, unsigned int frameIndex)
+{
+    if (slot.pixels == NULL && !MapSlot(slot)) {
+        return;
+    }
+
+    slot.frameIndex = frameIndex;
+    slot.state.store(RING_SLOT_DECODING, std::memory_order_relaxed);
+
+    {
+        std::lock_guard<std::mutex> lock(m_decodeQueueMutex);
+        m_decodeQueue.push_back(&slot);
+    }
+    m_decodeQueueCondition.notify_one();
+}
+
+// ----------------------------------------------------------------------------
+
+unsigned int
+STVRVideoStream::FramesAhead(unsigned int frameIndex, unsigned int targetFrame) const
+{
+    unsigned int frameCount = m_frameSource->GetFrameCount();
+    return (frameIndex + frameCount - targetFrame) % frameCount;
+}
+
+// ----------------------------------------------------------------------------
+
+void
+STVRVideoStream::Update(float playbackTimeInSecs)
+{
+    if (m_ringSlots.empty()) {
+        return;
+    }
+
+    unsigned int frameCount = m_frameSource->GetFrameCount();
+    float clipDuration = static_cast<float>(frameCount) / m_frameRate;
+
+    // videos loop, so the channel time wraps at the end of the clip
+    m_channelTime = fmodf(playbackTimeInSecs > 0.f ? playbackTimeInSecs : 0.f, clipDuration);
+    unsigned int targetFrame = static_cast<unsigned int>(m_channelTime * m_frameRate);
+    if (targetFrame >= frameCount) {
+        targetFrame = frameCount - 1;
+    }
+
+    // Present: upload the target frame if a worker has finished it.  A frame
+    // that failed to decode is skipped and the previous frame stays up.
+    bool targetPresented = (targetFrame == m_uploadedFrame);
+    for (size_t slotIdx = 0; slotIdx < m_ringSlots.size() && !targetPresented; slotIdx++)
+    {
+        RingSlot& slot = *m_ringSlots[slotIdx];
+        int state = slot.state.load(std::memory_order_acquire);
+        if (slot.frameIndex != targetFrame) {
+            continue;
+        }
+
+        if (state == RING_SLOT_READY) {
+            UploadSlot(slot);
+            targetPresented = true;
+        }
+        else if (state == RING_SLOT_FAILED) {
+            m_uploadedFrame = targetFrame;
+            targetPresented = true;
+        }
+    }
+
+    if (!targetPresented && m_lastLateFrame != targetFrame) {
+        m_lastLateFrame = targetFrame;
+        m_lateFrameCount++;
+    }
+
+    // Prefetch: keep every slot busy with the frames that come next.  Slots
+    // holding frames that playback has already passed are recycled while
+    // still mapped; slots that were uploaded get remapped.
+    unsigned int ringDepth = static_cast<unsigned int>(m_ringSlots.size());
+    for (size_t slotIdx = 0; slotIdx < m_ringSlots.size(); slotIdx++)
+    {
+        RingSlot& slot = *m_ringSlots[slotIdx];
+        int state = slot.state.load(std::memory_order_acquire);
+
+        if (state == RING_SLOT_DECODING) {
+            continue;
+        }
+
+        bool recycle = (state == RING_SLOT_UNMAPPED || state == RING_SLOT_FAILED);
+        if (state == RING_SLOT_READY) {
+            recycle = (FramesAhead(slot.frameIndex, targetFrame) >= ringDepth);
+        }
+
+        if (!recycle) {
+            continue;
+        }
+
+        // find the nearest upcoming frame nobody is holding yet
+        for (unsigned int aheadIdx = 0; aheadIdx < ringDepth; aheadIdx++)
+        {
+            unsigned int frameIndex = (targetFrame + aheadIdx) % frameCount;
+            if (frameIndex == m_uploadedFrame) {
+                continue;
+            }
+
+            bool frameInFlight = false;
+            for (size_t otherIdx = 0; otherIdx < m_ringSlots.size(); otherIdx++) {
+                const RingSlot& other = *m_ringSlots[otherIdx];
+                int otherState = other.state.load(std::memory_order_acquire);
+                if ((otherState == RING_SLOT_DECODING || otherState == RING_SLOT_READY) &&
+                    other.frameIndex == frameIndex)
+                {
+                    frameInFlight = true;
+                    break;
+                }
+            }
+
+            if (!frameInFlight) {
+                QueueSlot(slot, frameIndex);
+                break;
+            }
+        }
+    }
+}
@@ -0,0 +1,226 @@
+#pragma once
+
+#include "HBGLResourceWrappers.h"
+#include "HBGLMappedFile.h"
+
+#include <GL/glew.h>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace HBGLUtils;
+
+//-----------------------------------------------------------------------------
+// A channel stream is a shadertoy input whose texture changes over time.
+// Streams own their texture and their own clock, which is what the toy sees
+// as iChannelTime for that channel.  Update is called once per frame on the
+// render thread (with the GL context current) and must never wait on
+// whatever is producing the stream's data.
+
+class STVRChannelStream
+{
+public:
+
+    // - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+    // CONSTRO/DESTRO
+
+    STVRChannelStream(const std::string& name);
+    virtual ~STVRChannelStream();
+
+    // - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+    // ACCESSORS
+
+    const std::string& GetName() const;
+    HBGLTextureResourcePtr GetTexture() const;
+    float GetChannelTime() const;
+    const GLfloat* GetResolution() const;
+
+    // 0 for streams that carry no audio
+    float GetSampleRate() const;
+
+    // - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+    // MODIFIERS
+
+    virtual bool Open(const std::string& sourcePath) = 0;
+    virtual void Update(float playbackTimeInSecs) = 0;
+
+protected:
+
+    std::string             m_streamName;
+    HBGLTextureResourcePtr  m_texture;
+    float                   m_channelTime;
+    GLfloat                 m_resolution[3];
+    float                   m_sampleRate;
+};
+
+typedef std::shared_ptr<STVRChannelStream> STVRChannelStreamPtr;
+
+//-----------------------------------------------------------------------------
+// Frame sources decode single frames of a video into caller provided memory
+// of GetFrameSize() bytes.  Rows are kept in file order, so the first row
+// lands at t = 0 just like the static channel textures loaded by SOIL.
+// DecodeFrame is called concurrently from the stream worker threads, so
+// implementations must not touch GL and must be safe to call in parallel.
+
+class STVRVideoFrameSource
+{
+public:
+
+    STVRVideoFrameSource();
+    virtual ~STVRVideoFrameSource();
+
+    virtual bool Open(const std::string& sourcePath) = 0;
+    virtual bool DecodeFrame(unsigned int frameIndex, unsigned char* pixels) const = 0;
+
+    unsigned int GetWidth() const;
+    unsigned int GetHeight() const;
+    unsigned int GetChannels() const;
+    unsigned int GetFrameCount() const;
+    float GetFrameRate() const;
+    size_t GetFrameSize() const;
+
+protected:
+
+    unsigned int    m_width;
+    unsigned int    m_height;
+    unsigned int    m_channels;
+    unsigned int    m_frameCount;
+    float           m_frameRate;
+};
+
+//-----------------------------------------------------------------------------
+// Plays a directory of images (anything SOIL can read), one image per frame,
+// in alphabetical order.  All frames must match the size of the first one.
+// Image sequences carry no timing, so they play at 30 fps unless the toy
+// specifies iChannel#FrameRate.
+
+class STVRImageSequenceSource : public STVRVideoFrameSource
+{
+public:
+
+    STVRImageSequenceSource();
+    ~STVRImageSequenceSource();
+
+    bool Open(const std::string& sourcePath) override;
+    bool DecodeFrame(unsigned int frameIndex, unsigned char* pixels) const override;
+
+private:
+
+    std::vector<std::string> m_framePaths;
+};
+
+//-----------------------------------------------------------------------------
+// Plays a single memory mapped container of uncompressed frames.  Decoding
+// a frame is a copy out of the mapping, so this is the source to use when
+// 1080p60 has to keep up.  The container is a 32 byte header followed by
+// the frames stored back to back, each one tightly packed:
+//
+//   char     magic[8]      "STVRRAW1"
+//   uint32   width
+//   uint32   height
+//   uint32   channels      3 (RGB) or 4 (RGBA)
+//   uint32   frameCount
+//   float32  frameRate
+//   uint32   dataOffset    byte offset of the first frame
+
+class STVRRawVideoSource : public STVRVideoFrameSource
+{
+public:
+
+    STVRRawVideoSource();
+    ~STVRRawVideoSource();
+
+    bool Open(const std::string& sourcePath) override;
+    bool DecodeFrame(unsigned int frameIndex, unsigned char* pixels) const override;
+
+private:
+
+    HBGLMappedFile  m_container;
+    size_t          m_dataOffset;
+};
+
+//-----------------------------------------------------------------------------
+// Streams a video source into a texture through a ring of pixel unpack
+// buffers.  The render thread maps free ring slots and hands them to a small
+// pool of worker threads, which decode the upcoming frames straight into the
+// mapped memory.  Once the playback clock reaches a decoded frame, the render
+// thread unmaps that slot and issues a glTexSubImage2D sourced from the
+// buffer, so the copy to the texture is an asynchronous DMA and no decode or
+// upload ever stalls the frame.  If a frame is not ready in time the previous
+// one stays on screen.
+
+class STVRVideoStream : public STVRChannelStream
+{
+public:
+
+    // - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+    // CONSTRO/DESTRO
+
+    // Takes ownership of frameSource.  A frameRate of 0 uses the rate from
+    // the source.
+    STVRVideoStream(const std::string& name,
+        STVRVideoFrameSource* frameSource,
+        unsigned int ringDepth,
+        float frameRate);
+    ~STVRVideoStream();
+
+    // - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+    // MODIFIERS
+
+    bool Open(const std::string& sourcePath) override;
+    void Update(float playbackTimeInSecs) override;
+
+    // - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+    // ACCESSORS
+
+    unsigned int GetUploadedFrameCount() const;
+    unsigned int GetLateFrameCount() const;
+
+private:
+
+    enum RingSlotState {
+        RING_SLOT_UNMAPPED = 0,
+        RING_SLOT_DECODING,
+        RING_SLOT_READY,
+        RING_SLOT_FAILED
+    };
+
+    struct RingSlot {
+        HBGLBufferResourcePtr   pixelBuffer;
+        unsigned char*          pixels;
+        unsigned int            frameIndex;
+        std::atomic<int>        state;
+    };
+
+    typedef std::shared_ptr<RingSlot> RingSlotPtr;
+
+    void WorkerLoop();
+    void StopWorkers();
+
+    bool MapSlot(RingSlot& slot);
+    void UploadSlot(RingSlot& slot);
+    void QueueSlot(RingSlot& slot, unsigned int frameIndex);
+    unsigned int FramesAhead(unsigned int frameIndex, unsigned int targetFrame) const;
+
+    std::unique_ptr<STVRVideoFrameSource>   m_frameSource;
+    unsigned int                            m_ringDepth;
+    float                                   m_frameRate;
+    GLenum                                  m_pixelFormat;
+
+    std::vector<RingSlotPtr>                m_ringSlots;
+    unsigned int                            m_uploadedFrame;
+    unsigned int                            m_uploadedFrameCount;
+    unsigned int                            m_lateFrameCount;
+    unsigned int                            m_lastLateFrame;
+
+    std::vector<std::thread>                m_workers;
+    std::deque<RingSlot*>                   m_decodeQueue;
+    std::mutex                              m_decodeQueueMutex;
+    std::condition_variable                 m_decodeQueueCondition;
+    bool                                    m_stopWorkers;
+};
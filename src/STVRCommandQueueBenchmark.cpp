@@ -0,0 +1,247 @@
+#include "STVRCommandQueueBenchmark.h"
+
+#include "Kernel/OVR_ThreadCommandQueue.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <thread>
+#include <vector>
+
+// ''''''''''''''''''''''''''''''''''''''''''''''''''''''''''''''''''''''''''''
+// STATIC FUNCTIONS
+// ,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,
+
+static const int c_ProducerCounts[] = { 1, 2, 4, 8 };
+
+// What the commands call on the consumer thread.
+class BenchSink
+{
+public:
+
+    BenchSink() :
+    m_sum(0)
+    {
+
+    }
+
+    // not void: ThreadCommandQueue's commands assign the result, and only
+    // some compilers let that slide for void
+    int Add(int value)
+    {
+        m_sum += (unsigned long long)value;
+        return 0;
+    }
+
+    unsigned long long GetSum() const { return m_sum; }
+
+private:
+
+    unsigned long long  m_sum;
+};
+
+// ----------------------------------------------------------------------------
+
+class ThreadCommandQueueCase
+{
+public:
+
+    static const char* GetName() { return "OVR::ThreadCommandQueue"; }
+
+    void Push(int value)
+    {
+        m_queue.PushCall(&m_sink, &BenchSink::Add, value);
+    }
+
+    // producers are done
+    void Close()
+    {
+        m_queue.PushExitCommand(false);
+    }
+
+    void Consume()
+    {
+        OVR::ThreadCommand::PopBuffer command;
+        while (!m_queue.IsExiting())
+        {
+            if (m_queue.PopCommand(&command)) {
+                command.Execute();
+            }
+            else {
+                m_queue.WaitForCommand();
+            }
+        }
+    }
+
+    unsigned long long GetSum() const { return m_sink.GetSum(); }
+
+private:
+
+    OVR::ThreadCommandQueue     m_queue;
+    BenchSink                   m_sink;
+};
+
+// ----------------------------------------------------------------------------
+
+class MutexQueueCase
+{
+public:
+
+    static const char* GetName() { return "std::mutex queue"; }
+
+    MutexQueueCase() :
+    m_closed(false)
+    {
+
+    }
+
+    void Push(int value)
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        bool wasEmpty = m_values.empty();
+        m_values.push_back(value);
+        if (wasEmpty) {
+            m_wake.notify_one();
+        }
+    }
+
+    void Close()
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_closed = true;
+        m_wake.notify_one();
+    }
+
+    void Consume()
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        for (;;)
+        {
+            while (m_values.empty() && !m_closed) {
+                m_wake.wait(lock);
+            }
+            if (m_values.empty()) {
+                return;
+            }
+
+            int value = m_values.front();
+            m_values.pop_front();
+
+            lock.unlock();
+            m_sink.Add(value);
+            lock.lock();
+        }
+    }
+
+    unsigned long long GetSum() const { return m_sink.GetSum(); }
+
+private:
+
+    std::mutex                  m_mutex;
+    std::condition_variable     m_wake;
+    std::deque<int>             m_values;
+    bool                        m_closed;
+    BenchSink                   m_sink;
+};
+
+// ''''''''''''''''''''''''''''''''''''''''''''''''''''''''''''''''''''''''''''
+// STVRCommandQueueBenchmark
+// ,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,
+
+STVRCommandQueueBenchmark::STVRCommandQueueBenchmark(int commandCount) :
+STVRBench("STVRCommandQueueBenchmark"),
+m_commandCount(commandCount > 0 ? commandCount : 1)
+{
+
+}
+
+// ----------------------------------------------------------------------------
+
+STVRCommandQueueBenchmark::~STVRCommandQueueBenchmark()
+{
+
+}
+
+// ----------------------------------------------------------------------------
+
+void
+STVRCommandQueueBenchmark::_RunCases(std::ostream& out)
+{
+    _BeginLine(out) << m_commandCount << " commands per case" << std::endl;
+
+    for (size_t countIdx = 0; countIdx < sizeof(c_ProducerCounts) / sizeof(c_ProducerCounts[0]); countIdx++)
+    {
+        _RunCase<ThreadCommandQueueCase>(out, c_ProducerCounts[countIdx]);
+        _RunCase<MutexQueueCase>(out, c_ProducerCounts[countIdx]);
+    }
+}
+
+// ----------------------------------------------------------------------------
+
+template <typename Queue>
+void
+STVRCommandQueueBenchmark::_RunCase(std::ostream& out, int producerCount)
+{
+    std::unique_ptr<Queue> queue(new Queue());
+    std::vector<STVRBenchSpans> pushTimes(producerCount);
+    int commandsPerProducer = (m_commandCount + producerCount - 1) / producerCount;
+
+    // producers wait for each other so they all start pushing at once
+    std::atomic<int> readyCount(0);
+
+    STVRBenchClock::time_point startTime = STVRBenchClock::now();
+    std::thread consumer([&]() { queue->Consume(); });
+
+    std::vector<std::thread> producers;
+    for (int producerIdx = 0; producerIdx < producerCount; producerIdx++)
+    {
+        producers.push_back(std::thread([&, producerIdx]() {
+            STVRBenchSpans& pushes = pushTimes[producerIdx];
+
+            readyCount.fetch_add(1);
+            while (readyCount.load() < producerCount) {
+                std::this_thread::yield();
+            }
+
+            pushes.Start();
+            for (int commandIdx = 0; commandIdx < commandsPerProducer; commandIdx++)
+            {
+                queue->Push(commandIdx & 0xff);
+                pushes.Lap();
+            }
+        }));
+    }
+
+    for (size_t producerIdx = 0; producerIdx < producers.size(); producerIdx++) {
+        producers[producerIdx].join();
+    }
+    queue->Close();
+    consumer.join();
+    double elapsedSecs = STVRBench::GetNanosecsSince(startTime) / 1e9;
+
+    unsigned long long commandCount = (unsigned long long)commandsPerProducer * producerCount;
+    STVRBenchSpans pushes;
+    for (int producerIdx = 0; producerIdx < producerCount; producerIdx++) {
+        pushes.Add(pushTimes[producerIdx]);
+    }
+
+    // every producer pushes the same run of values
+    unsigned long long expectedSum = 0;
+    for (int commandIdx = 0; commandIdx < commandsPerProducer; commandIdx++) {
+        expectedSum += (unsigned long long)(commandIdx & 0xff);
+    }
+    expectedSum *= (unsigned long long)producerCount;
+
+    std::ostringstream caseName;
+    caseName << Queue::GetName() << ", " << producerCount << " producers";
+
+    _BeginLine(out, caseName.str()) << double(commandCount) / elapsedSecs << " commands/s, push mean " <<
+        pushes.GetMeanNanosecs() << " ns, worst " << pushes.GetWorstNanosecs() / 1000. << " us" << std::endl;
+
+    if (queue->GetSum() != expectedSum) {
+        _Fail(caseName.str(), "commands were lost or run twice");
+    }
+}
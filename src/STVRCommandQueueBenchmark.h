@@ -0,0 +1,37 @@
+#pragma once
+
+#include "STVRBench.h"
+
+//-----------------------------------------------------------------------------
+// Producer scaling benchmark for OVR::ThreadCommandQueue, the queue loader,
+// telemetry and reload messages are meant to reach the render thread
+// through.  With 1, 2, 4 and 8 producer threads each pushing its share of
+// the commands as fast as it can, a consumer thread pops and runs them,
+// waiting in WaitForCommand whenever the queue runs dry.  The same load goes
+// through a std::mutex and std::deque queue as a reference.
+//
+// For each case it reports commands per second and the mean and worst time
+// a push took, and checks every command ran exactly once by summing what
+// they carried; a lost or repeated command fails the run.
+
+class STVRCommandQueueBenchmark : public STVRBench
+{
+public:
+
+    // - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+    // CONSTRO/DESTRO
+
+    explicit STVRCommandQueueBenchmark(int commandCount);
+    ~STVRCommandQueueBenchmark();
+
+protected:
+
+    void _RunCases(std::ostream& out) override;
+
+private:
+
+    template <typename Queue>
+    void _RunCase(std::ostream& out, int producerCount);
+
+    int     m_commandCount;
+};
@@ -0,0 +1,4785 @@
+#include "STVRCpuCompiler.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <set>
+
+// ''''''''''''''''''''''''''''''''''''''''''''''''''''''''''''''''''''''''''''
+// STATIC FUNCTIONS
+// ,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,
+
+enum CpuTokenKind
+{
+    CPU_TOKEN_IDENTIFIER,
+    CPU_TOKEN_NUMBER,
+    CPU_TOKEN_PUNCTUATION,
+    CPU_TOKEN_END
+};
+
+struct CpuToken
+{
+    CpuTokenKind    kind;
+    std::string     text;
+    double          number;
+    bool            isFloat;
+    bool            spaceBefore;
+    int             sourceString;
+    int             line;
+};
+
+typedef std::vector<CpuToken> CpuTokenList;
+
+// ----------------------------------------------------------------------------
+
+static bool
+IsIdentifierStart(char c)
+{
+    return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || c == '_';
+}
+
+static bool
+IsDigit(char c)
+{
+    return c >= '0' && c <= '9';
+}
+
+static bool
+IsIdentifierChar(char c)
+{
+    return IsIdentifierStart(c) || IsDigit(c);
+}
+
+// ----------------------------------------------------------------------------
+
+static float
+BitsToFloat(unsigned int bits)
+{
+    float value;
+    memcpy(&value, &bits, sizeof(value));
+    return value;
+}
+
+static unsigned int
+FloatToBits(float value)
+{
+    unsigned int bits;
+    memcpy(&bits, &value, sizeof(bits));
+    return bits;
+}
+
+// ----------------------------------------------------------------------------
+
+static std::string
+DescribeLocation(const std::string& shaderName, const std::vector<std::string>& sourceStringNames,
+    int sourceString, int line)
+{
+    std::string fileName = shaderName;
+    if (sourceString >= 0 && size_t(sourceString) < sourceStringNames.size()) {
+        fileName = sourceStringNames[sourceString];
+    }
+
+    char lineText[32];
+    sprintf(lineText, " : %d", line);
+    return fileName + lineText;
+}
+
+// ''''''''''''''''''''''''''''''''''''''''''''''''''''''''''''''''''''''''''''
+// CpuPreprocessor
+// ,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,
+
+// Turns the shader source into tokens with the directives applied and the
+// macros expanded.
+class CpuPreprocessor
+{
+public:
+
+    CpuPreprocessor(const std::string& shaderName, const std::vector<std::string>& sourceStringNames) :
+    m_shaderName(shaderName),
+    m_sourceStringNames(sourceStringNames),
+    m_failed(false)
+    {
+    }
+
+    bool Run(const std::string& source, CpuTokenList& tokens);
+
+private:
+
+    struct Macro
+    {
+        bool                        functionLike;
+        std::vector<std::string>    parameters;
+        CpuTokenList                body;
+    };
+
+    struct Conditional
+    {
+        bool    parentActive;
+        bool    active;
+        bool    taken;
+    };
+
+    typedef std::map<std::string, Macro> MacroMap;
+
+    void _Error(int sourceString, int line, const std::string& message);
+    void _Tokenize(const std::string& text, int sourceString, int line, CpuTokenList& tokens);
+    void _Directive(const CpuTokenList& directive, int sourceString, int line, int& nextLine, int& nextSourceString);
+    bool _IsActive() const;
+    void _Expand(const CpuTokenList& input, std::set<std::string>& expanding, CpuTokenList& output);
+    bool _EvaluateCondition(const CpuTokenList& directive, int sourceString, int line);
+    long _EvaluateExpression(const CpuTokenList& expression, size_t& tokenIdx, int precedence);
+
+    std::string                 m_shaderName;
+    std::vector<std::string>    m_sourceStringNames;
+    MacroMap                    m_macros;
+    std::vector<Conditional>    m_conditionals;
+    bool                        m_failed;
+};
+
+// ----------------------------------------------------------------------------
+
+void
+CpuPreprocessor::_Error(int sourceString, int line, const std::string& message)
+{
+    std::cerr << "STVRCpuCompiler ERROR [ " << DescribeLocation(m_shaderName, m_sourceStringNames, sourceString, line) <<
+        " ]: " << message << std::endl;
+    m_failed = true;
+}
+
+// ----------------------------------------------------------------------------
+
+bool
+CpuPreprocessor::Run(const std::string& source, CpuTokenList& tokens)
+{
+    // Strip comments and join continued lines.  Every newline is kept, the
+    // ones inside a joined line move to its end, so line numbers hold.
+    std::string text;
+    text.reserve(source.size());
+    int pendingNewlines = 0;
+
+    for (size_t charIdx = 0; charIdx < source.size(); charIdx++)
+    {
+        char c = source[charIdx];
+        char next = (charIdx + 1 < source.size()) ? source[charIdx + 1] : 0;
+
+        if (c == '/' && next == '/') {
+            while (charIdx + 1 < source.size() && source[charIdx + 1] != '\n') {
+                charIdx++;
+            }
+        }
+        else if (c == '/' && next == '*') {
+            text += ' ';
+            charIdx += 2;
+            while (charIdx < source.size() && !(source[charIdx] == '*' && charIdx + 1 < source.size() && source[charIdx + 1] == '/')) {
+                if (source[charIdx] == '\n') {
+                    pendingNewlines++;
+                }
+                charIdx++;
+            }
+            charIdx++;
+        }
+        else if (c == '\\' && (next == '\n' || (next == '\r' && charIdx + 2 < source.size() && source[charIdx + 2] == '\n'))) {
+            charIdx += (next == '\r') ? 2 : 1;
+            pendingNewlines++;
+        }
+        else if (c == '\n') {
+            text.append(size_t(pendingNewlines) + 1, '\n');
+            pendingNewlines = 0;
+        }
+        else if (c != '\r') {
+            text += c;
+        }
+    }
+
+    // Then go a line at a time.  Active lines gather up and are expanded
+    // before each directive, so a macro applies from its #define on and a
+    // macro call can still span lines.
+    CpuTokenList rawTokens;
+    std::set<std::string> expanding;
+    int sourceString = 0;
+    int line = 1;
+    size_t lineStart = 0;
+
+    while (lineStart < text.size() && !m_failed)
+    {
+        size_t lineEnd = text.find('\n', lineStart);
+        if (lineEnd == std::string::npos) {
+            lineEnd = text.size();
+        }
+
+        CpuTokenList lineTokens;
+        _Tokenize(text.substr(lineStart, lineEnd - lineStart), sourceString, line, lineTokens);
+
+        int nextLine = line + 1;
+        int nextSourceString = sourceString;
+        if (!lineTokens.empty() && lineTokens[0].text == "#") {
+            _Expand(rawTokens, expanding, tokens);
+            rawTokens.clear();
+            _Directive(lineTokens, sourceString, line, nextLine, nextSourceString);
+        }
+        else if (_IsActive()) {
+            rawTokens.insert(rawTokens.end(), lineTokens.begin(), lineTokens.end());
+        }
+
+        line = nextLine;
+        sourceString = nextSourceString;
+        lineStart = lineEnd + 1;
+    }
+
+    if (!m_failed && !m_conditionals.empty()) {
+        _Error(sourceString, line, "#if without #endif");
+    }
+
+    _Expand(rawTokens, expanding, tokens);
+
+    CpuToken endToken;
+    endToken.kind = CPU_TOKEN_END;
+    endToken.number = 0.;
+    endToken.isFloat = false;
+    endToken.spaceBefore = true;
+    endToken.sourceString = sourceString;
+    endToken.line = line;
+    tokens.push_back(endToken);
+
+    return !m_failed;
+}
+
+// ----------------------------------------------------------------------------
+
+void
+CpuPreprocessor::_Tokenize(const std::string& text, int sourceString, int line, CpuTokenList& tokens)
+{
+    static const char* multiCharPunctuation[] = {
+        "++", "--", "+=", "-=", "*=", "/=", "%=", "==", "!=", "<=", ">=",
+        "&&", "||", "^^", "<<", ">>", "##", NULL
+    };
+
+    size_t charIdx = 0;
+    bool spaceBefore = true;
+    while (charIdx < text.size())
+    {
+        char c = text[charIdx];
+        if (c == ' ' || c == '\t' || c == '\f' || c == '\v') {
+            spaceBefore = true;
+            charIdx++;
+            continue;
+        }
+
+        CpuToken token;
+        token.number = 0.;
+        token.isFloat = false;
+        token.spaceBefore = spaceBefore;
+        spaceBefore = false;
+        token.sourceString = sourceString;
+        token.line = line;
+
+        size_t tokenStart = charIdx;
+        if (IsIdentifierStart(c)) {
+            while (charIdx < text.size() && IsIdentifierChar(text[charIdx])) {
+                charIdx++;
+            }
+            token.kind = CPU_TOKEN_IDENTIFIER;
+        }
+        else if (IsDigit(c) || (c == '.' && charIdx + 1 < text.size() && IsDigit(text[charIdx + 1]))) {
+            token.kind = CPU_TOKEN_NUMBER;
+            if (c == '0' && charIdx + 1 < text.size() && (text[charIdx + 1] == 'x' || text[charIdx + 1] == 'X')) {
+                charIdx += 2;
+                while (charIdx < text.size() && isxdigit((unsigned char) text[charIdx])) {
+                    charIdx++;
+                }
+                token.number = double(strtoul(text.c_str() + tokenStart, NULL, 16));
+            }
+            else {
+                while (charIdx < text.size() && IsDigit(text[charIdx])) {
+                    charIdx++;
+                }
+                if (charIdx < text.size() && text[charIdx] == '.') {
+                    token.isFloat = true;
+                    charIdx++;
+                    while (charIdx < text.size() && IsDigit(text[charIdx])) {
+                        charIdx++;
+                    }
+                }
+                if (charIdx < text.size() && (text[charIdx] == 'e' || text[charIdx] == 'E')) {
+                    size_t exponentIdx = charIdx + 1;
+                    if (exponentIdx < text.size() && (text[exponentIdx] == '+' || text[exponentIdx] == '-')) {
+                        exponentIdx++;
+                    }
+                    if (exponentIdx < text.size() && IsDigit(text[exponentIdx])) {
+                        token.isFloat = true;
+                        charIdx = exponentIdx;
+                        while (charIdx < text.size() && IsDigit(text[charIdx])) {
+                            charIdx++;
+                        }
+                    }
+                }
+                token.number = strtod(text.substr(tokenStart, charIdx - tokenStart).c_str(), NULL);
+            }
+
+            // suffixes
+            if (charIdx < text.size() && (text[charIdx] == 'f' || text[charIdx] == 'F')) {
+                token.isFloat = true;
+                charIdx++;
+            }
+            else if (charIdx < text.size() && (text[charIdx] == 'u' || text[charIdx] == 'U')) {
+                charIdx++;
+            }
+        }
+        else {
+            token.kind = CPU_TOKEN_PUNCTUATION;
+            charIdx++;
+            for (int punctuationIdx = 0; multiCharPunctuation[punctuationIdx]; punctuationIdx++)
+            {
+                const char* punctuation = multiCharPunctuation[punctuationIdx];
+                if (c == punctuation[0] && charIdx < text.size() && text[charIdx] == punctuation[1]) {
+                    charIdx++;
+                    break;
+                }
+            }
+        }
+
+        token.text = text.substr(tokenStart, charIdx - tokenStart);
+        tokens.push_back(token);
+    }
+}
+
+// ----------------------------------------------------------------------------
+
+bool
+CpuPreprocessor::_IsActive() const
+{
+    return m_conditionals.empty() || m_conditionals.back().active;
+}
+
+// ----------------------------------------------------------------------------
+
+void
+CpuPreprocessor::_Directive(const CpuTokenList& directive, int sourceString, int line, int& nextLine, int& nextSourceString)
+{
+    if (directive.size() < 2) {
+        return;
+    }
+
+    const std::string& name = directive[1].text;
+
+    if (name == "ifdef" || name == "ifndef" || name == "if") {
+        Conditional conditional;
+        conditional.parentActive = _IsActive();
+        conditional.taken = false;
+        conditional.active = false;
+
+        if (conditional.parentActive) {
+            bool condition = false;
+            if (name == "if") {
+                condition = _EvaluateCondition(directive, sourceString, line);
+            }
+            else if (directive.size() < 3) {
+                _Error(sourceString, line, "#" + name + " needs a macro name");
+            }
+            else {
+                condition = (m_macros.find(directive[2].text) != m_macros.end()) == (name == "ifdef");
+            }
+            conditional.active = condition;
+            conditional.taken = condition;
+        }
+
+        m_conditionals.push_back(conditional);
+        return;
+    }
+
+    if (name == "elif" || name == "else" || name == "endif") {
+        if (m_conditionals.empty()) {
+            _Error(sourceString, line, "#" + name + " without #if");
+            return;
+        }
+
+        Conditional& conditional = m_conditionals.back();
+        if (name == "endif") {
+            m_conditionals.pop_back();
+        }
+        else if (!conditional.parentActive || conditional.taken) {
+            conditional.active = false;
+        }
+        else if (name == "else") {
+            conditional.active = true;
+            conditional.taken = true;
+        }
+        else {
+            conditional.active = _EvaluateCondition(directive, sourceString, line);
+            conditional.taken = conditional.active;
+        }
+        return;
+    }
+
+    if (!_IsActive()) {
+        return;
+    }
+
+    if (name == "define") {
+        if (directive.size() < 3 || directive[2].kind != CPU_TOKEN_IDENTIFIER) {
+            _Error(sourceString, line, "#define needs a macro name");
+            return;
+        }
+
+        Macro macro;
+        macro.functionLike = false;
+        size_t bodyStart = 3;
+
+        // a function-like macro has its ( right after the name
+        if (directive.size() > 3 && directive[3].text == "(" && !directive[3].spaceBefore) {
+            macro.functionLike = true;
+            bodyStart = 4;
+            while (bodyStart < directive.size() && directive[bodyStart].text != ")") {
+                if (directive[bodyStart].kind == CPU_TOKEN_IDENTIFIER) {
+                    macro.parameters.push_back(directive[bodyStart].text);
+                }
+                bodyStart++;
+            }
+            bodyStart++;
+        }
+
+        if (bodyStart < directive.size()) {
+            macro.body.assign(directive.begin() + bodyStart, directive.end());
+        }
+        m_macros[directive[2].text] = macro;
+    }
+    else if (name == "undef") {
+        if (directive.size() > 2) {
+            m_macros.erase(directive[2].text);
+        }
+    }
+    else if (name == "line") {
+        if (directive.size() > 2 && directive[2].kind == CPU_TOKEN_NUMBER) {
+            // GLSL 1.30: the line after the directive is number + 1
+            nextLine = int(directive[2].number) + 1;
+        }
+        if (directive.size() > 3 && directive[3].kind == CPU_TOKEN_NUMBER) {
+            nextSourceString = int(directive[3].number);
+        }
+    }
+    else if (name == "error") {
+        _Error(sourceString, line, "#error");
+    }
+
+    // #version, #extension and #pragma change nothing here
+}
+
+// ----------------------------------------------------------------------------
+
+// #if and #elif: defined() is resolved first, then the rest is expanded and
+// evaluated as an integer expression.  Names left after expansion are 0.
+bool
+CpuPreprocessor::_EvaluateCondition(const CpuTokenList& directive, int sourceString, int line)
+{
+    CpuTokenList resolved;
+    for (size_t rawIdx = 2; rawIdx < directive.size(); rawIdx++)
+    {
+        if (directive[rawIdx].text != "defined") {
+            resolved.push_back(directive[rawIdx]);
+            continue;
+        }
+
+        bool parenthesized = rawIdx + 1 < directive.size() && directive[rawIdx + 1].text == "(";
+        size_t nameIdx = rawIdx + (parenthesized ? 2 : 1);
+        if (nameIdx >= directive.size()) {
+            _Error(sourceString, line, "defined needs a macro name");
+            return false;
+        }
+
+        CpuToken value = directive[rawIdx];
+        value.kind = CPU_TOKEN_NUMBER;
+        value.number = (m_macros.find(directive[nameIdx].text) != m_macros.end()) ? 1. : 0.;
+        value.text = (value.number != 0.) ? "1" : "0";
+        resolved.push_back(value);
+        rawIdx = nameIdx + (parenthesized ? 1 : 0);
+    }
+
+    std::set<std::string> expanding;
+    CpuTokenList expanded;
+    _Expand(resolved, expanding, expanded);
+
+    size_t tokenIdx = 0;
+    return _EvaluateExpression(expanded, tokenIdx, 0) != 0;
+}
+
+// ----------------------------------------------------------------------------
+
+long
+CpuPreprocessor::_EvaluateExpression(const CpuTokenList& expression, size_t& tokenIdx, int precedence)
+{
+    static const char* binaryOperators[][4] = {
+        { "||", NULL },
+        { "&&", NULL },
+        { "|", NULL },
+        { "^", NULL },
+        { "&", NULL },
+        { "==", "!=", NULL },
+        { "<", ">", "<=", ">=" },
+        { "<<", ">>", NULL },
+        { "+", "-", NULL },
+        { "*", "/", "%", NULL }
+    };
+    static const int binaryLevels = sizeof(binaryOperators) / sizeof(binaryOperators[0]);
+
+    if (precedence >= binaryLevels) {
+        // unary and primary
+        if (tokenIdx >= expression.size()) {
+            return 0;
+        }
+
+        const CpuToken& token = expression[tokenIdx++];
+        if (token.text == "!") {
+            return !_EvaluateExpression(expression, tokenIdx, binaryLevels);
+        }
+        if (token.text == "-") {
+            return -_EvaluateExpression(expression, tokenIdx, binaryLevels);
+        }
+        if (token.text == "+") {
+            return _EvaluateExpression(expression, tokenIdx, binaryLevels);
+        }
+        if (token.text == "~") {
+            return ~_EvaluateExpression(expression, tokenIdx, binaryLevels);
+        }
+        if (token.text == "(") {
+            long value = _EvaluateExpression(expression, tokenIdx, 0);
+            if (tokenIdx < expression.size() && expression[tokenIdx].text == ")") {
+                tokenIdx++;
+            }
+            return value;
+        }
+        if (token.kind == CPU_TOKEN_NUMBER) {
+            return long(token.number);
+        }
+        return 0;
+    }
+
+    long value = _EvaluateExpression(expression, tokenIdx, precedence + 1);
+    while (tokenIdx < expression.size())
+    {
+        const std::string& operatorText = expression[tokenIdx].text;
+        bool matched = false;
+        for (int operatorIdx = 0; operatorIdx < 4 && binaryOperators[precedence][operatorIdx]; operatorIdx++) {
+            matched = matched || operatorText == binaryOperators[precedence][operatorIdx];
+        }
+        if (!matched) {
+            break;
+        }
+
+        tokenIdx++;
+        long rhs = _EvaluateExpression(expression, tokenIdx, precedence + 1);
+        if (operatorText == "||") value = value || rhs;
+        else if (operatorText == "&&") value = value && rhs;
+        else if (operatorText == "|") value = value | rhs;
+        else if (operatorText == "^") value = value ^ rhs;
+        else if (operatorText == "&") value = value & rhs;
+        else if (operatorText == "==") value = value == rhs;
+        else if (operatorText == "!=") value = value != rhs;
+        else if (operatorText == "<") value = value < rhs;
+        else if (operatorText == ">") value = value > rhs;
+        else if (operatorText == "<=") value = value <= rhs;
+        else if (operatorText == ">=") value = value >= rhs;
+        else if (operatorText == "<<") value = value << rhs;
+        else if (operatorText == ">>") value = value >> rhs;
+        else if (operatorText == "+") value = value + rhs;
+        else if (operatorText == "-") value = value - rhs;
+        else if (operatorText == "*") value = value * rhs;
+        else if (operatorText == "/") value = rhs ? value / rhs : 0;
+        else if (operatorText == "%") value = rhs ? value % rhs : 0;
+    }
+
+    return value;
+}
+
+// ----------------------------------------------------------------------------
+
+void
+CpuPreprocessor::_Expand(const CpuTokenList& input, std::set<std::string>& expanding, CpuTokenList& output)
+{
+    for (size_t tokenIdx = 0; tokenIdx < input.size(); tokenIdx++)
+    {
+        const CpuToken& token = input[tokenIdx];
+        MacroMap::const_iterator macroIter = m_macros.end();
+        if (token.kind == CPU_TOKEN_IDENTIFIER && expanding.find(token.text) == expanding.end()) {
+            macroIter = m_macros.find(token.text);
+        }
+
+        if (macroIter == m_macros.end()) {
+            output.push_back(token);
+            continue;
+        }
+
+        const Macro& macro = macroIter->second;
+        CpuTokenList replacement;
+
+        if (!macro.functionLike) {
+            replacement = macro.body;
+        }
+        else {
+            if (tokenIdx + 1 >= input.size() || input[tokenIdx + 1].text != "(") {
+                output.push_back(token);
+                continue;
+            }
+
+            // gather the arguments, splitting on top level commas
+            std::vector<CpuTokenList> arguments(1);
+            int depth = 0;
+            size_t argumentIdx = tokenIdx + 2;
+            for (; argumentIdx < input.size(); argumentIdx++)
+            {
+                const std::string& text = input[argumentIdx].text;
+                if (input[argumentIdx].kind == CPU_TOKEN_PUNCTUATION) {
+                    if (text == "(" || text == "[") {
+                        depth++;
+                    }
+                    else if ((text == ")" || text == "]") && depth > 0) {
+                        depth--;
+                    }
+                    else if (text == ")") {
+                        break;
+                    }
+                    else if (text == "," && depth == 0) {
+                        arguments.push_back(CpuTokenList());
+                        continue;
+                    }
+                }
+                arguments.back().push_back(input[argumentIdx]);
+            }
+
+            if (argumentIdx >= input.size()) {
+                _Error(token.sourceString, token.line, "unterminated call of macro " + token.text);
+                return;
+            }
+            if (macro.parameters.empty() && arguments.size() == 1 && arguments[0].empty()) {
+                arguments.clear();
+            }
+            if (arguments.size() != macro.parameters.size()) {
+                _Error(token.sourceString, token.line, "wrong number of arguments to macro " + token.text);
+                return;
+            }
+
+            // arguments are expanded on their own before they go in
+            for (size_t expandIdx = 0; expandIdx < arguments.size(); expandIdx++)
+            {
+                CpuTokenList expanded;
+                _Expand(arguments[expandIdx], expanding, expanded);
+                arguments[expandIdx].swap(expanded);
+            }
+
+            for (size_t bodyIdx = 0; bodyIdx < macro.body.size(); bodyIdx++)
+            {
+                const CpuToken& bodyToken = macro.body[bodyIdx];
+                size_t parameterIdx = 0;
+                while (parameterIdx < macro.parameters.size() && macro.parameters[parameterIdx] != bodyToken.text) {
+                    parameterIdx++;
+                }
+
+                if (bodyToken.kind == CPU_TOKEN_IDENTIFIER && parameterIdx < macro.parameters.size()) {
+                    replacement.insert(replacement.end(), arguments[parameterIdx].begin(), arguments[parameterIdx].end());
+                }
+                else {
+                    replacement.push_back(bodyToken);
+                }
+            }
+
+            tokenIdx = argumentIdx;
+        }
+
+        // ## pastes its neighbours together
+        for (size_t pasteIdx = 1; pasteIdx + 1 < replacement.size(); pasteIdx++)
+        {
+            if (replacement[pasteIdx].text != "##") {
+                continue;
+            }
+
+            CpuTokenList pasted;
+            std::string pastedText = replacement[pasteIdx - 1].text + replacement[pasteIdx + 1].text;
+            _Tokenize(pastedText, token.sourceString, token.line, pasted);
+            replacement.erase(replacement.begin() + pasteIdx - 1, replacement.begin() + pasteIdx + 2);
+            replacement.insert(replacement.begin() + pasteIdx - 1, pasted.begin(), pasted.end());
+            pasteIdx--;
+        }
+
+        // errors in the expansion point at the line using the macro
+        for (size_t replacementIdx = 0; replacementIdx < replacement.size(); replacementIdx++)
+        {
+            replacement[replacementIdx].sourceString = token.sourceString;
+            replacement[replacementIdx].line = token.line;
+        }
+
+        expanding.insert(token.text);
+        _Expand(replacement, expanding, output);
+        expanding.erase(token.text);
+    }
+}
+
+// ''''''''''''''''''''''''''''''''''''''''''''''''''''''''''''''''''''''''''''
+// CpuProgram
+// ,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,
+
+enum CpuBaseType
+{
+    CPU_TYPE_VOID,
+    CPU_TYPE_FLOAT,
+    CPU_TYPE_INT,
+    CPU_TYPE_BOOL,
+    CPU_TYPE_STRUCT,
+    CPU_TYPE_SAMPLER_2D,
+    CPU_TYPE_SAMPLER_CUBE
+};
+
+// columns > 1 is a matrix, arraySize > 0 an array of the rest (-1 while
+// the size still has to come from an initializer)
+struct CpuType
+{
+    CpuBaseType     base;
+    int             rows;
+    int             columns;
+    int             structIdx;
+    int             arraySize;
+};
+
+static CpuType
+MakeType(CpuBaseType base, int rows = 1, int columns = 1)
+{
+    CpuType type;
+    type.base = base;
+    type.rows = rows;
+    type.columns = columns;
+    type.structIdx = -1;
+    type.arraySize = 0;
+    return type;
+}
+
+static bool
+operator==(const CpuType& lhs, const CpuType& rhs)
+{
+    return lhs.base == rhs.base && lhs.rows == rhs.rows && lhs.columns == rhs.columns &&
+        lhs.structIdx == rhs.structIdx && lhs.arraySize == rhs.arraySize;
+}
+
+static bool
+operator!=(const CpuType& lhs, const CpuType& rhs)
+{
+    return !(lhs == rhs);
+}
+
+static bool
+IsNumericBase(CpuBaseType base)
+{
+    return base == CPU_TYPE_FLOAT || base == CPU_TYPE_INT || base == CPU_TYPE_BOOL;
+}
+
+static bool
+IsSampler(const CpuType& type)
+{
+    return type.base == CPU_TYPE_SAMPLER_2D || type.base == CPU_TYPE_SAMPLER_CUBE;
+}
+
+// scalars, vectors and matrices
+static bool
+IsBasic(const CpuType& type)
+{
+    return IsNumericBase(type.base) && type.arraySize == 0;
+}
+
+static bool
+IsScalar(const CpuType& type)
+{
+    return IsBasic(type) && type.rows == 1 && type.columns == 1;
+}
+
+static bool
+IsVector(const CpuType& type)
+{
+    return IsBasic(type) && type.rows > 1 && type.columns == 1;
+}
+
+static bool
+IsMatrix(const CpuType& type)
+{
+    return IsBasic(type) && type.columns > 1;
+}
+
+static CpuType
+ElementType(const CpuType& type)
+{
+    CpuType elementType = type;
+    elementType.arraySize = 0;
+    return elementType;
+}
+
+// ----------------------------------------------------------------------------
+
+struct CpuStructField
+{
+    std::string     name;
+    CpuType         type;
+};
+
+struct CpuStruct
+{
+    std::string                 name;
+    std::vector<CpuStructField> fields;
+};
+
+// registers a value of the type takes
+static int
+TypeSlots(const CpuType& type, const std::vector<CpuStruct>& structs)
+{
+    int elementSlots = 0;
+    if (type.base == CPU_TYPE_STRUCT) {
+        const CpuStruct& structDef = structs[type.structIdx];
+        for (size_t fieldIdx = 0; fieldIdx < structDef.fields.size(); fieldIdx++) {
+            elementSlots += TypeSlots(structDef.fields[fieldIdx].type, structs);
+        }
+    }
+    else if (IsNumericBase(type.base)) {
+        elementSlots = type.rows * type.columns;
+    }
+
+    return type.arraySize > 0 ? elementSlots * type.arraySize : elementSlots;
+}
+
+static std::string
+TypeName(const CpuType& type, const std::vector<CpuStruct>& structs)
+{
+    std::string name;
+    if (type.base == CPU_TYPE_STRUCT) {
+        name = structs[type.structIdx].name;
+    }
+    else if (type.base == CPU_TYPE_VOID) {
+        name = "void";
+    }
+    else if (type.base == CPU_TYPE_SAMPLER_2D) {
+        name = "sampler2D";
+    }
+    else if (type.base == CPU_TYPE_SAMPLER_CUBE) {
+        name = "samplerCube";
+    }
+    else if (type.columns > 1) {
+        name = "mat" + std::string(1, char('0' + type.columns));
+        if (type.rows != type.columns) {
+            name += "x" + std::string(1, char('0' + type.rows));
+        }
+    }
+    else {
+        const char* scalarName = (type.base == CPU_TYPE_FLOAT) ? "float" : (type.base == CPU_TYPE_INT) ? "int" : "bool";
+        const char* vectorPrefix = (type.base == CPU_TYPE_FLOAT) ? "vec" : (type.base == CPU_TYPE_INT) ? "ivec" : "bvec";
+        name = (type.rows == 1) ? std::string(scalarName) : vectorPrefix + std::string(1, char('0' + type.rows));
+    }
+
+    if (type.arraySize != 0) {
+        char arrayText[16];
+        sprintf(arrayText, "[%d]", type.arraySize);
+        name += arrayText;
+    }
+    return name;
+}
+
+// ----------------------------------------------------------------------------
+
+static bool
+LookupTypeKeyword(const std::string& keyword, CpuType& type)
+{
+    struct TypeKeyword
+    {
+        const char*     keyword;
+        CpuBaseType     base;
+        int             rows;
+        int             columns;
+    };
+
+    static const TypeKeyword typeKeywords[] = {
+        { "void", CPU_TYPE_VOID, 1, 1 },
+        { "float", CPU_TYPE_FLOAT, 1, 1 },
+        { "vec2", CPU_TYPE_FLOAT, 2, 1 },
+        { "vec3", CPU_TYPE_FLOAT, 3, 1 },
+        { "vec4", CPU_TYPE_FLOAT, 4, 1 },
+        { "int", CPU_TYPE_INT, 1, 1 },
+        { "ivec2", CPU_TYPE_INT, 2, 1 },
+        { "ivec3", CPU_TYPE_INT, 3, 1 },
+        { "ivec4", CPU_TYPE_INT, 4, 1 },
+        { "uint", CPU_TYPE_INT, 1, 1 },
+        { "uvec2", CPU_TYPE_INT, 2, 1 },
+        { "uvec3", CPU_TYPE_INT, 3, 1 },
+        { "uvec4", CPU_TYPE_INT, 4, 1 },
+        { "bool", CPU_TYPE_BOOL, 1, 1 },
+        { "bvec2", CPU_TYPE_BOOL, 2, 1 },
+        { "bvec3", CPU_TYPE_BOOL, 3, 1 },
+        { "bvec4", CPU_TYPE_BOOL, 4, 1 },
+        { "mat2", CPU_TYPE_FLOAT, 2, 2 },
+        { "mat3", CPU_TYPE_FLOAT, 3, 3 },
+        { "mat4", CPU_TYPE_FLOAT, 4, 4 },
+        { "mat2x2", CPU_TYPE_FLOAT, 2, 2 },
+        { "mat2x3", CPU_TYPE_FLOAT, 3, 2 },
+        { "mat2x4", CPU_TYPE_FLOAT, 4, 2 },
+        { "mat3x2", CPU_TYPE_FLOAT, 2, 3 },
+        { "mat3x3", CPU_TYPE_FLOAT, 3, 3 },
+        { "mat3x4", CPU_TYPE_FLOAT, 4, 3 },
+        { "mat4x2", CPU_TYPE_FLOAT, 2, 4 },
+        { "mat4x3", CPU_TYPE_FLOAT, 3, 4 },
+        { "mat4x4", CPU_TYPE_FLOAT, 4, 4 },
+        { "sampler2D", CPU_TYPE_SAMPLER_2D, 1, 1 },
+        { "samplerCube", CPU_TYPE_SAMPLER_CUBE, 1, 1 }
+    };
+
+    for (size_t keywordIdx = 0; keywordIdx < sizeof(typeKeywords) / sizeof(typeKeywords[0]); keywordIdx++)
+    {
+        if (keyword == typeKeywords[keywordIdx].keyword) {
+            type = MakeType(typeKeywords[keywordIdx].base, typeKeywords[keywordIdx].rows, typeKeywords[keywordIdx].columns);
+            return true;
+        }
+    }
+    return false;
+}
+
+static bool
+IsQualifierKeyword(const std::string& keyword)
+{
+    static const char* qualifiers[] = {
+        "const", "uniform", "in", "out", "inout", "attribute", "varying", "highp", "mediump", "lowp",
+        "flat", "smooth", "noperspective", "centroid", "invariant", NULL
+    };
+
+    for (int qualifierIdx = 0; qualifiers[qualifierIdx]; qualifierIdx++) {
+        if (keyword == qualifiers[qualifierIdx]) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// ----------------------------------------------------------------------------
+
+enum CpuNodeKind
+{
+    // expressions
+    CPU_NODE_NUMBER,
+    CPU_NODE_BOOL,
+    CPU_NODE_IDENTIFIER,
+    CPU_NODE_UNARY,             // text is the operator, ++ and -- included
+    CPU_NODE_POSTFIX,           // ++ or --
+    CPU_NODE_BINARY,
+    CPU_NODE_ASSIGN,            // text is = or the compound operator
+    CPU_NODE_TERNARY,
+    CPU_NODE_CALL,              // text is the function
+    CPU_NODE_CONSTRUCT,         // type is what gets built
+    CPU_NODE_FIELD,             // text is the field or swizzle
+    CPU_NODE_INDEX,
+    CPU_NODE_SEQUENCE,
+
+    // statements
+    CPU_NODE_BLOCK,
+    CPU_NODE_DECLARATION,       // children are declarators
+    CPU_NODE_DECLARATOR,        // text and type of one variable, its initializer if any
+    CPU_NODE_EXPRESSION,
+    CPU_NODE_IF,                // condition, then, else or NULL
+    CPU_NODE_FOR,               // init or NULL, condition or NULL, step or NULL, body
+    CPU_NODE_WHILE,             // condition, body
+    CPU_NODE_DO,                // body, condition
+    CPU_NODE_RETURN,
+    CPU_NODE_BREAK,
+    CPU_NODE_CONTINUE,
+    CPU_NODE_DISCARD,
+    CPU_NODE_EMPTY
+};
+
+struct CpuNode
+{
+    CpuNodeKind             kind;
+    std::string             text;
+    double                  number;
+    bool                    isFloat;
+    CpuType                 type;
+    bool                    isConst;
+    bool                    isUniform;
+    bool                    isOutput;
+    std::vector<CpuNode*>   children;
+    int                     sourceString;
+    int                     line;
+};
+
+struct CpuParameter
+{
+    std::string     name;
+    CpuType         type;
+    bool            isConst;
+    bool            copiesIn;
+    bool            copiesOut;
+};
+
+struct CpuFunction
+{
+    std::string                 name;
+    CpuType                     returnType;
+    std::vector<CpuParameter>   parameters;
+    CpuNode*                    body;
+    int                         sourceString;
+    int                         line;
+};
+
+// The parsed toy.  Owns every node.
+struct CpuProgram
+{
+    std::vector<CpuStruct>                          structs;
+    std::vector<std::shared_ptr<CpuFunction> >      functions;
+    std::vector<CpuNode*>                           globals;
+    std::vector<std::shared_ptr<CpuNode> >          nodes;
+};
+
+// ''''''''''''''''''''''''''''''''''''''''''''''''''''''''''''''''''''''''''''
+// CpuParser
+// ,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,
+
+// Recursive descent over the preprocessed tokens.  Struct names are known as
+// soon as they are declared, which is all a GLSL parser needs to tell a
+// declaration from an expression.
+class CpuParser
+{
+public:
+
+    CpuParser(const CpuTokenList& tokens, const std::string& shaderName,
+        const std::vector<std::string>& sourceStringNames, CpuProgram& program) :
+    m_tokens(tokens),
+    m_tokenIdx(0),
+    m_shaderName(shaderName),
+    m_sourceStringNames(sourceStringNames),
+    m_program(program),
+    m_failed(false)
+    {
+    }
+
+    bool Run();
+
+private:
+
+    const CpuToken& _Peek(size_t ahead = 0) const;
+    const CpuToken& _Next();
+    bool _Accept(const char* text);
+    bool _Expect(const char* text);
+    void _Error(const CpuToken& token, const std::string& message);
+    CpuNode* _NewNode(CpuNodeKind kind, const CpuToken& token);
+
+    bool _IsTypeName(const CpuToken& token) const;
+    bool _IsDeclarationStart() const;
+    bool _ParseQualifiers(bool& isConst, bool& isUniform, bool& isIn, bool& isOut);
+    bool _ParseType(CpuType& type);
+    bool _ParseStruct(CpuType& type);
+    bool _ParseArraySize(CpuType& type);
+    bool _EvaluateConstantInt(const CpuNode* node, int& value) const;
+
+    bool _ParseExternal();
+    bool _ParseFunction(const CpuType& returnType, const CpuToken& nameToken);
+    CpuNode* _ParseDeclarators(const CpuType& type, const CpuToken& firstToken, bool isConst, bool isUniform);
+
+    CpuNode* _ParseStatement();
+    CpuNode* _ParseBlock();
+
+    CpuNode* _ParseExpression();
+    CpuNode* _ParseAssignment();
+    CpuNode* _ParseTernary();
+    CpuNode* _ParseBinary(int level);
+    CpuNode* _ParseUnary();
+    CpuNode* _ParsePostfix();
+    CpuNode* _ParsePrimary();
+    bool _ParseArguments(CpuNode* call);
+
+    const CpuTokenList&             m_tokens;
+    size_t                          m_tokenIdx;
+    std::string                     m_shaderName;
+    std::vector<std::string>        m_sourceStringNames;
+    CpuProgram&                     m_program;
+    std::map<std::string, int>      m_constantInts;
+    bool                            m_failed;
+};
+
+// ----------------------------------------------------------------------------
+
+const CpuToken&
+CpuParser::_Peek(size_t ahead) const
+{
+    size_t tokenIdx = m_tokenIdx + ahead;
+    return m_tokens[tokenIdx < m_tokens.size() ? tokenIdx : m_tokens.size() - 1];
+}
+
+// ----------------------------------------------------------------------------
+
+const CpuToken&
+CpuParser::_Next()
+{
+    const CpuToken& token = _Peek();
+    if (m_tokenIdx + 1 < m_tokens.size()) {
+        m_tokenIdx++;
+    }
+    return token;
+}
+
+// ----------------------------------------------------------------------------
+
+bool
+CpuParser::_Accept(const char* text)
+{
+    const CpuToken& token = _Peek();
+    if (token.kind != CPU_TOKEN_END && token.kind != CPU_TOKEN_NUMBER && token.text == text) {
+        _Next();
+        return true;
+    }
+    return false;
+}
+
+// ----------------------------------------------------------------------------
+
+bool
+CpuParser::_Expect(const char* text)
+{
+    if (_Accept(text)) {
+        return true;
+    }
+    _Error(_Peek(), std::string("expected '") + text + "'");
+    return false;
+}
+
+// ----------------------------------------------------------------------------
+
+void
+CpuParser::_Error(const CpuToken& token, const std::string& message)
+{
+    if (m_failed) {
+        // the first error is the one that means something
+        return;
+    }
+
+    std::string near = (token.kind == CPU_TOKEN_END) ? "end of file" : "'" + token.text + "'";
+    std::cerr << "STVRCpuCompiler ERROR [ " << DescribeLocation(m_shaderName, m_sourceStringNames, token.sourceString, token.line) <<
+        " ]: " << message << " near " << near << std::endl;
+    m_failed = true;
+}
+
+// ----------------------------------------------------------------------------
+
+CpuNode*
+CpuParser::_NewNode(CpuNodeKind kind, const CpuToken& token)
+{
+    std::shared_ptr<CpuNode> node(new CpuNode());
+    node->kind = kind;
+    node->number = 0.;
+    node->isFloat = false;
+    node->type = MakeType(CPU_TYPE_VOID);
+    node->isConst = false;
+    node->isUniform = false;
+    node->isOutput = false;
+    node->sourceString = token.sourceString;
+    node->line = token.line;
+
+    m_program.nodes.push_back(node);
+    return node.get();
+}
+
+// ----------------------------------------------------------------------------
+
+bool
+CpuParser::_IsTypeName(const CpuToken& token) const
+{
+    if (token.kind != CPU_TOKEN_IDENTIFIER) {
+        return false;
+    }
+
+    CpuType type;
+    if (LookupTypeKeyword(token.text, type) || token.text == "struct") {
+        return true;
+    }
+
+    for (size_t structIdx = 0; structIdx < m_program.structs.size(); structIdx++) {
+        if (m_program.structs[structIdx].name == token.text) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// ----------------------------------------------------------------------------
+
+bool
+CpuParser::_IsDeclarationStart() const
+{
+    const CpuToken& token = _Peek();
+    if (token.kind != CPU_TOKEN_IDENTIFIER) {
+        return false;
+    }
+    if (IsQualifierKeyword(token.text) || token.text == "struct" || token.text == "precision") {
+        return true;
+    }
+    if (!_IsTypeName(token)) {
+        return false;
+    }
+
+    // "vec3 p" declares, "vec3(...)" constructs, "float[3] a" declares and
+    // "float[3](...)" constructs
+    size_t ahead = 1;
+    if (_Peek(ahead).text == "[") {
+        while (_Peek(ahead).kind != CPU_TOKEN_END && _Peek(ahead).text != "]") {
+            ahead++;
+        }
+        ahead++;
+    }
+    return _Peek(ahead).kind == CPU_TOKEN_IDENTIFIER;
+}
+
+// ----------------------------------------------------------------------------
+
+bool
+CpuParser::_ParseQualifiers(bool& isConst, bool& isUniform, bool& isIn, bool& isOut)
+{
+    isConst = isUniform = isIn = isOut = false;
+    while (_Peek().kind == CPU_TOKEN_IDENTIFIER && IsQualifierKeyword(_Peek().text))
+    {
+        const std::string& qualifier = _Next().text;
+        if (qualifier == "const") {
+            isConst = true;
+        }
+        else if (qualifier == "uniform") {
+            isUniform = true;
+        }
+        else if (qualifier == "in") {
+            isIn = true;
+        }
+        else if (qualifier == "out") {
+            isOut = true;
+        }
+        else if (qualifier == "inout") {
+            isIn = isOut = true;
+        }
+    }
+    return true;
+}
+
+// ----------------------------------------------------------------------------
+
+bool
+CpuParser::_ParseType(CpuType& type)
+{
+    const CpuToken& token = _Peek();
+    if (token.text == "struct") {
+        return _ParseStruct(type);
+    }
+
+    if (token.kind == CPU_TOKEN_IDENTIFIER && LookupTypeKeyword(token.text, type)) {
+        _Next();
+    }
+    else {
+        bool found = false;
+        for (size_t structIdx = 0; structIdx < m_program.structs.size() && !found; structIdx++)
+        {
+            if (m_program.structs[structIdx].name == token.text) {
+                type = MakeType(CPU_TYPE_STRUCT);
+                type.structIdx = int(structIdx);
+                found = true;
+            }
+        }
+        if (!found) {
+            _Error(token, "expected a type");
+            return false;
+        }
+        _Next();
+    }
+
+    if (_Peek().text == "[") {
+        return _ParseArraySize(type);
+    }
+    return true;
+}
+
+// ----------------------------------------------------------------------------
+
+bool
+CpuParser::_ParseStruct(CpuType& type)
+{
+    _Expect("struct");
+
+    CpuStruct structDef;
+    if (_Peek().kind == CPU_TOKEN_IDENTIFIER) {
+        structDef.name = _Next().text;
+    }
+    if (!_Expect("{")) {
+        return false;
+    }
+
+    while (!m_failed && !_Accept("}"))
+    {
+        bool isConst, isUniform, isIn, isOut;
+        _ParseQualifiers(isConst, isUniform, isIn, isOut);
+
+        CpuType fieldType;
+        if (!_ParseType(fieldType)) {
+            return false;
+        }
+
+        do {
+            if (_Peek().kind != CPU_TOKEN_IDENTIFIER) {
+                _Error(_Peek(), "expected a field name");
+                return false;
+            }
+
+            CpuStructField field;
+            field.name = _Next().text;
+            field.type = fieldType;
+            if (_Peek().text == "[" && !_ParseArraySize(field.type)) {
+                return false;
+            }
+            if (field.type.arraySize < 0) {
+                _Error(_Peek(), "struct arrays need a size");
+                return false;
+            }
+            structDef.fields.push_back(field);
+        } while (_Accept(","));
+
+        if (!_Expect(";")) {
+            return false;
+        }
+    }
+
+    m_program.structs.push_back(structDef);
+    type = MakeType(CPU_TYPE_STRUCT);
+    type.structIdx = int(m_program.structs.size() - 1);
+    return !m_failed;
+}
+
+// ----------------------------------------------------------------------------
+
+bool
+CpuParser::_ParseArraySize(CpuType& type)
+{
+    const CpuToken& openToken = _Peek();
+    if (!_Expect("[")) {
+        return false;
+    }
+    if (type.arraySize != 0) {
+        _Error(openToken, "arrays of arrays are not supported");
+        return false;
+    }
+
+    if (_Accept("]")) {
+        type.arraySize = -1;
+        return true;
+    }
+
+    CpuNode* sizeNode = _ParseTernary();
+    int arraySize = 0;
+    if (!sizeNode || !_EvaluateConstantInt(sizeNode, arraySize) || arraySize <= 0) {
+        _Error(openToken, "array sizes must be positive integer constants");
+        return false;
+    }
+
+    type.arraySize = arraySize;
+    return _Expect("]");
+}
+
+// ----------------------------------------------------------------------------
+
+bool
+CpuParser::_EvaluateConstantInt(const CpuNode* node, int& value) const
+{
+    if (node->kind == CPU_NODE_NUMBER && !node->isFloat) {
+        value = int(node->number);
+        return true;
+    }
+    if (node->kind == CPU_NODE_IDENTIFIER) {
+        std::map<std::string, int>::const_iterator constantIter = m_constantInts.find(node->text);
+        if (constantIter == m_constantInts.end()) {
+            return false;
+        }
+        value = constantIter->second;
+        return true;
+    }
+    if (node->kind == CPU_NODE_UNARY && node->text == "-") {
+        if (!_EvaluateConstantInt(node->children[0], value)) {
+            return false;
+        }
+        value = -value;
+        return true;
+    }
+    if (node->kind == CPU_NODE_BINARY) {
+        int lhs, rhs;
+        if (!_EvaluateConstantInt(node->children[0], lhs) || !_EvaluateConstantInt(node->children[1], rhs)) {
+            return false;
+        }
+        if (node->text == "+") value = lhs + rhs;
+        else if (node->text == "-") value = lhs - rhs;
+        else if (node->text == "*") value = lhs * rhs;
+        else if (node->text == "/" && rhs != 0) value = lhs / rhs;
+        else return false;
+        return true;
+    }
+    return false;
+}
+
+// ----------------------------------------------------------------------------
+
+bool
+CpuParser::Run()
+{
+    while (!m_failed && _Peek().kind != CPU_TOKEN_END) {
+        _ParseExternal();
+    }
+    return !m_failed;
+}
+
+// ----------------------------------------------------------------------------
+
+bool
+CpuParser::_ParseExternal()
+{
+    const CpuToken& firstToken = _Peek();
+
+    if (_Accept(";")) {
+        return true;
+    }
+    if (_Accept("precision")) {
+        while (_Peek().kind != CPU_TOKEN_END && !_Accept(";")) {
+            _Next();
+        }
+        return true;
+    }
+
+    bool isConst, isUniform, isIn, isOut;
+    _ParseQualifiers(isConst, isUniform, isIn, isOut);
+
+    CpuType type;
+    if (!_ParseType(type)) {
+        return false;
+    }
+
+    // a lone struct declaration
+    if (_Accept(";")) {
+        return true;
+    }
+
+    if (_Peek().kind == CPU_TOKEN_IDENTIFIER && _Peek(1).text == "(") {
+        const CpuToken& nameToken = _Next();
+        return _ParseFunction(type, nameToken);
+    }
+
+    CpuNode* declaration = _ParseDeclarators(type, firstToken, isConst, isUniform);
+    if (!declaration) {
+        return false;
+    }
+
+    // "out vec4 fragColor;" is the toy's output like gl_FragColor
+    declaration->isOutput = isOut && !isIn;
+    m_program.globals.push_back(declaration);
+    return _Expect(";");
+}
+
+// ----------------------------------------------------------------------------
+
+bool
+CpuParser::_ParseFunction(const CpuType& returnType, const CpuToken& nameToken)
+{
+    std::shared_ptr<CpuFunction> function(new CpuFunction());
+    function->name = nameToken.text;
+    function->returnType = returnType;
+    function->body = NULL;
+    function->sourceString = nameToken.sourceString;
+    function->line = nameToken.line;
+
+    _Expect("(");
+    if (_Peek().text == "void" && _Peek(1).text == ")") {
+        _Next();
+    }
+
+    while (!m_failed && !_Accept(")"))
+    {
+        if (!function->parameters.empty() && !_Expect(",")) {
+            return false;
+        }
+
+        bool isConst, isUniform, isIn, isOut;
+        _ParseQualifiers(isConst, isUniform, isIn, isOut);
+
+        CpuParameter parameter;
+        parameter.isConst = isConst;
+        parameter.copiesIn = isIn || !isOut;
+        parameter.copiesOut = isOut;
+        if (!_ParseType(parameter.type)) {
+            return false;
+        }
+        if (_Peek().kind == CPU_TOKEN_IDENTIFIER) {
+            parameter.name = _Next().text;
+        }
+        if (_Peek().text == "[" && !_ParseArraySize(parameter.type)) {
+            return false;
+        }
+        function->parameters.push_back(parameter);
+    }
+
+    if (_Accept(";")) {
+        // a prototype, the definition comes later
+        return true;
+    }
+
+    function->body = _ParseBlock();
+    if (!function->body) {
+        return false;
+    }
+
+    m_program.functions.push_back(function);
+    return true;
+}
+
+// ----------------------------------------------------------------------------
+
+CpuNode*
+CpuParser::_ParseDeclarators(const CpuType& type, const CpuToken& firstToken, bool isConst, bool isUniform)
+{
+    CpuNode* declaration = _NewNode(CPU_NODE_DECLARATION, firstToken);
+    declaration->type = type;
+    declaration->isConst = isConst;
+    declaration->isUniform = isUniform;
+
+    do {
+        const CpuToken& nameToken = _Peek();
+        if (nameToken.kind != CPU_TOKEN_IDENTIFIER) {
+            _Error(nameToken, "expected a variable name");
+            return NULL;
+        }
+        _Next();
+
+        CpuNode* declarator = _NewNode(CPU_NODE_DECLARATOR, nameToken);
+        declarator->text = nameToken.text;
+        declarator->type = type;
+        declarator->isConst = isConst;
+        declarator->isUniform = isUniform;
+        if (_Peek().text == "[" && !_ParseArraySize(declarator->type)) {
+            return NULL;
+        }
+
+        if (_Accept("=")) {
+            CpuNode* initializer = _ParseAssignment();
+            if (!initializer) {
+                return NULL;
+            }
+            declarator->children.push_back(initializer);
+
+            // constant ints can size arrays
+            int constantValue;
+            if (isConst && IsScalar(declarator->type) && declarator->type.base == CPU_TYPE_INT &&
+                _EvaluateConstantInt(initializer, constantValue))
+            {
+                m_constantInts[declarator->text] = constantValue;
+            }
+        }
+        else if (declarator->type.arraySize < 0) {
+            _Error(nameToken, "unsized arrays need an initializer");
+            return NULL;
+        }
+
+        declaration->children.push_back(declarator);
+    } while (_Accept(","));
+
+    return declaration;
+}
+
+// ----------------------------------------------------------------------------
+
+CpuNode*
+CpuParser::_ParseBlock()
+{
+    const CpuToken& openToken = _Peek();
+    if (!_Expect("{")) {
+        return NULL;
+    }
+
+    CpuNode* block = _NewNode(CPU_NODE_BLOCK, openToken);
+    while (!_Accept("}"))
+    {
+        if (_Peek().kind == CPU_TOKEN_END) {
+            _Error(_Peek(), "expected '}'");
+            return NULL;
+        }
+
+        CpuNode* statement = _ParseStatement();
+        if (!statement) {
+            return NULL;
+        }
+        block->children.push_back(statement);
+    }
+    return block;
+}
+
+// ----------------------------------------------------------------------------
+
+CpuNode*
+CpuParser::_ParseStatement()
+{
+    const CpuToken& token = _Peek();
+
+    if (token.text == "{" && token.kind == CPU_TOKEN_PUNCTUATION) {
+        return _ParseBlock();
+    }
+    if (_Accept(";")) {
+        return _NewNode(CPU_NODE_EMPTY, token);
+    }
+
+    if (token.kind == CPU_TOKEN_IDENTIFIER)
+    {
+        if (_Accept("if")) {
+            CpuNode* ifNode = _NewNode(CPU_NODE_IF, token);
+            CpuNode* condition = NULL;
+            CpuNode* thenStatement = NULL;
+            if (!_Expect("(") || !(condition = _ParseExpression()) || !_Expect(")") || !(thenStatement = _ParseStatement())) {
+                return NULL;
+            }
+
+            CpuNode* elseStatement = NULL;
+            if (_Accept("else") && !(elseStatement = _ParseStatement())) {
+                return NULL;
+            }
+
+            ifNode->children.push_back(condition);
+            ifNode->children.push_back(thenStatement);
+            ifNode->children.push_back(elseStatement);
+            return ifNode;
+        }
+
+        if (_Accept("for")) {
+            CpuNode* forNode = _NewNode(CPU_NODE_FOR, token);
+            if (!_Expect("(")) {
+                return NULL;
+            }
+
+            CpuNode* init = NULL;
+            if (!_Accept(";")) {
+                if (!(init = _ParseStatement())) {
+                    return NULL;
+                }
+            }
+
+            CpuNode* condition = NULL;
+            if (!_Accept(";")) {
+                if (!(condition = _ParseExpression()) || !_Expect(";")) {
+                    return NULL;
+                }
+            }
+
+            CpuNode* step = NULL;
+            if (!_Accept(")")) {
+                if (!(step = _ParseExpression()) || !_Expect(")")) {
+                    return NULL;
+                }
+            }
+
+            CpuNode* body = _ParseStatement();
+            if (!body) {
+                return NULL;
+            }
+
+            forNode->children.push_back(init);
+            forNode->children.push_back(condition);
+            forNode->children.push_back(step);
+            forNode->children.push_back(body);
+            return forNode;
+        }
+
+        if (_Accept("while")) {
+            CpuNode* whileNode = _NewNode(CPU_NODE_WHILE, token);
+            CpuNode* condition = NULL;
+            CpuNode* body = NULL;
+            if (!_Expect("(") || !(condition = _ParseExpression()) || !_Expect(")") || !(body = _ParseStatement())) {
+                return NULL;
+            }
+            whileNode->children.push_back(condition);
+            whileNode->children.push_back(body);
+            return whileNode;
+        }
+
+        if (_Accept("do")) {
+            CpuNode* doNode = _NewNode(CPU_NODE_DO, token);
+            CpuNode* body = NULL;
+            CpuNode* condition = NULL;
+            if (!(body = _ParseStatement()) || !_Expect("while") || !_Expect("(") ||
+                !(condition = _ParseExpression()) || !_Expect(")") || !_Expect(";"))
+            {
+                return NULL;
+            }
+            doNode->children.push_back(body);
+            doNode->children.push_back(condition);
+            return doNode;
+        }
+
+        if (_Accept("return")) {
+            CpuNode* returnNode = _NewNode(CPU_NODE_RETURN, token);
+            if (!_Accept(";")) {
+                CpuNode* value = _ParseExpression();
+                if (!value || !_Expect(";")) {
+                    return NULL;
+                }
+                returnNode->children.push_back(value);
+            }
+            return returnNode;
+        }
+
+        if (_Accept("break")) {
+            return _Expect(";") ? _NewNode(CPU_NODE_BREAK, token) : NULL;
+        }
+        if (_Accept("continue")) {
+            return _Expect(";") ? _NewNode(CPU_NODE_CONTINUE, token) : NULL;
+        }
+        if (_Accept("discard")) {
+            return _Expect(";") ? _NewNode(CPU_NODE_DISCARD, token) : NULL;
+        }
+
+        if (_IsDeclarationStart()) {
+            if (_Accept("precision")) {
+                while (_Peek().kind != CPU_TOKEN_END && !_Accept(";")) {
+                    _Next();
+                }
+                return _NewNode(CPU_NODE_EMPTY, token);
+            }
+
+            bool isConst, isUniform, isIn, isOut;
+            _ParseQualifiers(isConst, isUniform, isIn, isOut);
+
+            CpuType type;
+            if (!_ParseType(type)) {
+                return NULL;
+            }
+            if (_Accept(";")) {
+                // a local struct declaration
+                return _NewNode(CPU_NODE_EMPTY, token);
+            }
+
+            CpuNode* declaration = _ParseDeclarators(type, token, isConst, false);
+            if (!declaration || !_Expect(";")) {
+                return NULL;
+            }
+            return declaration;
+        }
+    }
+
+    CpuNode* expressionNode = _NewNode(CPU_NODE_EXPRESSION, token);
+    CpuNode* expression = _ParseExpression();
+    if (!expression || !_Expect(";")) {
+        return NULL;
+    }
+    expressionNode->children.push_back(expression);
+    return expressionNode;
+}
+
+// ----------------------------------------------------------------------------
+
+CpuNode*
+CpuParser::_ParseExpression()
+{
+    const CpuToken& token = _Peek();
+    CpuNode* expression = _ParseAssignment();
+    if (!expression || _Peek().text != ",") {
+        return expression;
+    }
+
+    CpuNode* sequence = _NewNode(CPU_NODE_SEQUENCE, token);
+    sequence->children.push_back(expression);
+    while (_Accept(","))
+    {
+        CpuNode* next = _ParseAssignment();
+        if (!next) {
+            return NULL;
+        }
+        sequence->children.push_back(next);
+    }
+    return sequence;
+}
+
+// ----------------------------------------------------------------------------
+
+CpuNode*
+CpuParser::_ParseAssignment()
+{
+    static const char* assignOperators[] = { "=", "+=", "-=", "*=", "/=", "%=", NULL };
+
+    CpuNode* lhs = _ParseTernary();
+    if (!lhs) {
+        return NULL;
+    }
+
+    const CpuToken& token = _Peek();
+    if (token.kind != CPU_TOKEN_PUNCTUATION) {
+        return lhs;
+    }
+
+    for (int operatorIdx = 0; assignOperators[operatorIdx]; operatorIdx++)
+    {
+        if (token.text != assignOperators[operatorIdx]) {
+            continue;
+        }
+
+        _Next();
+        CpuNode* rhs = _ParseAssignment();
+        if (!rhs) {
+            return NULL;
+        }
+
+        CpuNode* assign = _NewNode(CPU_NODE_ASSIGN, token);
+        assign->text = token.text;
+        assign->children.push_back(lhs);
+        assign->children.push_back(rhs);
+        return assign;
+    }
+    return lhs;
+}
+
+// ----------------------------------------------------------------------------
+
+CpuNode*
+CpuParser::_ParseTernary()
+{
+    CpuNode* condition = _ParseBinary(0);
+    if (!condition) {
+        return NULL;
+    }
+
+    const CpuToken& token = _Peek();
+    if (!_Accept("?")) {
+        return condition;
+    }
+
+    CpuNode* ifTrue = _ParseExpression();
+    if (!ifTrue || !_Expect(":")) {
+        return NULL;
+    }
+    CpuNode* ifFalse = _ParseAssignment();
+    if (!ifFalse) {
+        return NULL;
+    }
+
+    CpuNode* ternary = _NewNode(CPU_NODE_TERNARY, token);
+    ternary->children.push_back(condition);
+    ternary->children.push_back(ifTrue);
+    ternary->children.push_back(ifFalse);
+    return ternary;
+}
+
+// ----------------------------------------------------------------------------
+
+CpuNode*
+CpuParser::_ParseBinary(int level)
+{
+    static const char* binaryOperators[][5] = {
+        { "||", NULL },
+        { "^^", NULL },
+        { "&&", NULL },
+        { "==", "!=", NULL },
+        { "<", ">", "<=", ">=", NULL },
+        { "+", "-", NULL },
+        { "*", "/", "%", NULL }
+    };
+    static const int binaryLevels = sizeof(binaryOperators) / sizeof(binaryOperators[0]);
+
+    if (level >= binaryLevels) {
+        return _ParseUnary();
+    }
+
+    CpuNode* lhs = _ParseBinary(level + 1);
+    while (lhs)
+    {
+        const CpuToken& token = _Peek();
+        bool matched = false;
+        for (int operatorIdx = 0; binaryOperators[level][operatorIdx] && !matched; operatorIdx++) {
+            matched = token.kind == CPU_TOKEN_PUNCTUATION && token.text == binaryOperators[level][operatorIdx];
+        }
+        if (!matched) {
+            break;
+        }
+
+        _Next();
+        CpuNode* rhs = _ParseBinary(level + 1);
+        if (!rhs) {
+            return NULL;
+        }
+
+        CpuNode* binary = _NewNode(CPU_NODE_BINARY, token);
+        binary->text = token.text;
+        binary->children.push_back(lhs);
+        binary->children.push_back(rhs);
+        lhs = binary;
+    }
+    return lhs;
+}
+
+// ----------------------------------------------------------------------------
+
+CpuNode*
+CpuParser::_ParseUnary()
+{
+    const CpuToken& token = _Peek();
+    if (token.kind == CPU_TOKEN_PUNCTUATION &&
+        (token.text == "-" || token.text == "+" || token.text == "!" || token.text == "++" || token.text == "--"))
+    {
+        _Next();
+        CpuNode* operand = _ParseUnary();
+        if (!operand) {
+            return NULL;
+        }
+
+        CpuNode* unary = _NewNode(CPU_NODE_UNARY, token);
+        unary->text = token.text;
+        unary->children.push_back(operand);
+        return unary;
+    }
+    return _ParsePostfix();
+}
+
+// ----------------------------------------------------------------------------
+
+CpuNode*
+CpuParser::_ParsePostfix()
+{
+    CpuNode* expression = _ParsePrimary();
+    while (expression)
+    {
+        const CpuToken& token = _Peek();
+        if (token.kind != CPU_TOKEN_PUNCTUATION) {
+            break;
+        }
+
+        if (_Accept(".")) {
+            if (_Peek().kind != CPU_TOKEN_IDENTIFIER) {
+                _Error(_Peek(), "expected a field name");
+                return NULL;
+            }
+
+            CpuNode* field = _NewNode(CPU_NODE_FIELD, token);
+            field->text = _Next().text;
+            field->children.push_back(expression);
+            expression = field;
+        }
+        else if (_Accept("[")) {
+            CpuNode* index = _ParseExpression();
+            if (!index || !_Expect("]")) {
+                return NULL;
+            }
+
+            CpuNode* indexNode = _NewNode(CPU_NODE_INDEX, token);
+            indexNode->children.push_back(expression);
+            indexNode->children.push_back(index);
+            expression = indexNode;
+        }
+        else if (token.text == "++" || token.text == "--") {
+            _Next();
+            CpuNode* postfix = _NewNode(CPU_NODE_POSTFIX, token);
+            postfix->text = token.text;
+            postfix->children.push_back(expression);
+            expression = postfix;
+        }
+        else {
+            break;
+        }
+    }
+    return expression;
+}
+
+// ----------------------------------------------------------------------------
+
+bool
+CpuParser::_ParseArguments(CpuNode* call)
+{
+    if (!_Expect("(")) {
+        return false;
+    }
+    if (_Peek().text == "void" && _Peek(1).text == ")") {
+        _Next();
+    }
+
+    while (!_Accept(")"))
+    {
+        if (!call->children.empty() && !_Expect(",")) {
+            return false;
+        }
+
+        CpuNode* argument = _ParseAssignment();
+        if (!argument) {
+            return false;
+        }
+        call->children.push_back(argument);
+    }
+    return true;
+}
+
+// ----------------------------------------------------------------------------
+
+CpuNode*
+CpuParser::_ParsePrimary()
+{
+    const CpuToken& token = _Peek();
+
+    if (token.kind == CPU_TOKEN_NUMBER) {
+        _Next();
+        CpuNode* number = _NewNode(CPU_NODE_NUMBER, token);
+        number->number = token.number;
+        number->isFloat = token.isFloat;
+        return number;
+    }
+
+    if (_Accept("(")) {
+        CpuNode* expression = _ParseExpression();
+        if (!expression || !_Expect(")")) {
+            return NULL;
+        }
+        return expression;
+    }
+
+    if (token.kind != CPU_TOKEN_IDENTIFIER) {
+        _Error(token, "expected an expression");
+        return NULL;
+    }
+
+    if (token.text == "true" || token.text == "false") {
+        _Next();
+        CpuNode* boolean = _NewNode(CPU_NODE_BOOL, token);
+        boolean->number = (token.text == "true") ? 1. : 0.;
+        return boolean;
+    }
+
+    if (_IsTypeName(token) && token.text != "struct") {
+        CpuType type;
+        if (!_ParseType(type)) {
+            return NULL;
+        }
+
+        CpuNode* construct = _NewNode(CPU_NODE_CONSTRUCT, token);
+        construct->type = type;
+        if (!_ParseArguments(construct)) {
+            return NULL;
+        }
+        if (type.arraySize < 0) {
+            construct->type.arraySize = int(construct->children.size());
+        }
+        return construct;
+    }
+
+    _Next();
+    if (_Peek().text == "(" && _Peek().kind == CPU_TOKEN_PUNCTUATION) {
+        CpuNode* call = _NewNode(CPU_NODE_CALL, token);
+        call->text = token.text;
+        if (!_ParseArguments(call)) {
+            return NULL;
+        }
+        return call;
+    }
+
+    CpuNode* identifier = _NewNode(CPU_NODE_IDENTIFIER, token);
+    identifier->text = token.text;
+    return identifier;
+}
+
+// ''''''''''''''''''''''''''''''''''''''''''''''''''''''''''''''''''''''''''''
+// CpuCodeGen
+// ,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,
+
+// Registers handed out during code generation are virtual: constants count
+// up from c_ConstantRegisterBase and everything else from 0.  _Finish lays
+// them out the way STVRCpuKernel wants, constants first.
+static const int c_ConstantRegisterBase = 1 << 28;
+static const int c_NoRegister = -1;
+static const unsigned int c_AllLanesBits = 0xFFFFFFFFu;
+
+struct CpuValue
+{
+    CpuType             type;
+    std::vector<int>    registers;
+    int                 samplerChannel;
+};
+
+struct CpuVariable
+{
+    CpuType             type;
+    std::vector<int>    registers;
+
+    // the mask version the variable was declared under; stores made under
+    // the same version cannot touch lanes the variable is dead in, so they
+    // need no select
+    int                 maskVersion;
+    bool                readOnly;
+    int                 samplerChannel;
+};
+
+// An assignable place.  A non constant index makes one candidate per
+// element, picked at run time by indexRegister.
+struct CpuLValue
+{
+    CpuType                         type;
+    std::vector<std::vector<int> >  candidates;
+    int                             indexRegister;
+    int                             maskVersion;
+};
+
+class CpuCodeGen
+{
+public:
+
+    CpuCodeGen(const CpuProgram& program, const std::string& shaderName, const std::vector<std::string>& sourceStringNames) :
+    m_program(program),
+    m_shaderName(shaderName),
+    m_sourceStringNames(sourceStringNames),
+    m_nextRegister(0),
+    m_registerCount(0),
+    m_mask(c_NoRegister),
+    m_maskVersion(0),
+    m_versionCount(0),
+    m_deadCode(false),
+    m_jumpCount(0),
+    m_returnCount(0),
+    m_frameStart(0),
+    m_failed(false)
+    {
+        m_fragCoordRegisters[0] = m_fragCoordRegisters[1] = m_fragCoordRegisters[2] = m_fragCoordRegisters[3] = 0;
+        m_fragColorRegisters[0] = m_fragColorRegisters[1] = m_fragColorRegisters[2] = m_fragColorRegisters[3] = 0;
+    }
+
+    bool Run(STVRCpuKernel& kernel);
+
+private:
+
+    struct FunctionContext
+    {
+        const CpuFunction*  function;
+        CpuType             returnType;
+        std::vector<int>    returnRegisters;
+        int                 returnVersion;
+
+        // lanes that have not returned yet, only when a return sits inside
+        // a branch or loop
+        int                 liveMask;
+        size_t              loopBase;
+    };
+
+    struct LoopContext
+    {
+        // lanes still looping, and those still running this iteration
+        int                 liveMask;
+        int                 continueMask;
+    };
+
+    typedef std::map<std::string, CpuVariable> Scope;
+
+    bool _Error(const CpuNode* node, const std::string& message);
+
+    // registers and instructions
+    int _AllocRegisters(int count);
+    int _Constant(float value);
+    int _ConstantBits(unsigned int bits);
+    bool _IsConstant(int reg) const;
+    unsigned int _ConstantValue(int reg) const;
+    bool _IsConstantValue(const CpuValue& value) const;
+    int _Emit(int op, int a, int b = c_NoRegister, int c = c_NoRegister);
+    void _EmitTo(int op, int dst, int a, int b = c_NoRegister, int c = c_NoRegister);
+    size_t _EmitJump(int op, int mask);
+    void _PatchJump(size_t jumpIdx);
+    int _CurrentMask();
+
+    // scopes
+    void _PushScope();
+    void _PopScope();
+    CpuVariable* _FindVariable(const std::string& name);
+    void _Declare(const std::string& name, const CpuVariable& variable);
+
+    // values
+    CpuValue _MakeValue(const CpuType& type, const std::vector<int>& registers) const;
+    CpuValue _ScalarValue(CpuBaseType base, int reg) const;
+    int _Component(const CpuValue& value, int componentIdx) const;
+    int _ConvertComponent(int reg, CpuBaseType fromBase, CpuBaseType toBase);
+    bool _Convert(const CpuNode* node, const CpuValue& value, const CpuType& type, CpuValue& converted);
+    bool _ToFloat(const CpuNode* node, CpuValue& value);
+    bool _ToBoolScalar(const CpuNode* node, const CpuValue& value, int& reg);
+    CpuValue _Copy(const CpuValue& value);
+    std::vector<int> _IndexHits(int indexRegister, size_t count);
+    int _SelectByHits(const std::vector<int>& hits, const std::vector<int>& candidates);
+
+    // statements
+    bool _GenStatement(const CpuNode* node);
+    bool _GenBlock(const CpuNode* node, bool ownScope);
+    bool _GenDeclaration(const CpuNode* node, bool isGlobal);
+    bool _GenIf(const CpuNode* node);
+    bool _GenLoop(const CpuNode* node);
+    bool _GenReturn(const CpuNode* node);
+    bool _GenBreakOrContinue(const CpuNode* node);
+    bool _GenLoopCondition(const CpuNode* condition, int liveMask, size_t& exitJump);
+    void _NarrowAfterJumps();
+
+    // expressions
+    bool _GenExpression(const CpuNode* node, CpuValue& value);
+    bool _GenLValue(const CpuNode* node, CpuLValue& lvalue);
+    bool _Load(const CpuLValue& lvalue, CpuValue& value);
+    void _Store(const CpuLValue& lvalue, const CpuValue& value);
+    void _StoreRegister(int dst, int src, int mask);
+    bool _SelectField(const CpuNode* node, const CpuType& baseType, CpuType& fieldType, std::vector<int>& slots);
+    bool _IndexedElement(const CpuNode* node, const CpuType& baseType, const CpuValue& index,
+        CpuType& elementType, int& elementCount, int& elementSlots);
+    bool _GenUnary(const CpuNode* node, CpuValue& value);
+    bool _GenBinary(const CpuNode* node, CpuValue& value);
+    bool _GenArithmetic(const CpuNode* node, const std::string& op, CpuValue lhs, CpuValue rhs, CpuValue& value);
+    bool _GenComparison(const CpuNode* node, const std::string& op, CpuValue lhs, CpuValue rhs, CpuValue& value);
+    bool _GenAssign(const CpuNode* node, CpuValue& value);
+    bool _GenTernary(const CpuNode* node, CpuValue& value);
+    bool _GenConstruct(const CpuNode* node, CpuValue& value);
+    bool _GenCall(const CpuNode* node, CpuValue& value);
+    bool _GenComponentWise(const CpuNode* node, const std::vector<CpuValue>& arguments, int op, CpuBaseType resultBase, CpuValue& value);
+    bool _GenBuiltin(const CpuNode* node, std::vector<CpuValue>& arguments, CpuValue& value, bool& found);
+    bool _GenTexture(const CpuNode* node, const std::vector<CpuValue>& arguments, bool cube, bool projective, CpuValue& value);
+    bool _InlineFunction(const CpuNode* node, const CpuFunction& function, const std::vector<CpuValue>& arguments, CpuValue& value);
+    int _Dot(const CpuValue& lhs, const CpuValue& rhs);
+
+    bool _Finish(STVRCpuKernel& kernel);
+
+    const CpuProgram&                   m_program;
+    std::string                         m_shaderName;
+    std::vector<std::string>            m_sourceStringNames;
+
+    std::vector<STVRCpuInstruction>     m_code;
+    std::vector<unsigned int>           m_constantBits;
+    std::map<unsigned int, int>         m_constantRegisters;
+    int                                 m_nextRegister;
+    int                                 m_registerCount;
+
+    // c_NoRegister while every lane runs
+    int                                 m_mask;
+    int                                 m_maskVersion;
+    int                                 m_versionCount;
+
+    // set after a jump, until the end of the enclosing branch or loop body
+    bool                                m_deadCode;
+    int                                 m_jumpCount;
+    int                                 m_returnCount;
+
+    std::vector<Scope>                  m_scopes;
+    size_t                              m_frameStart;
+    std::vector<FunctionContext>        m_functions;
+    std::vector<LoopContext>            m_loops;
+    std::set<const CpuFunction*>        m_inlining;
+
+    std::map<std::string, std::vector<int> >    m_uniforms;
+    int                                 m_fragCoordRegisters[4];
+    int                                 m_fragColorRegisters[4];
+    bool                                m_failed;
+};
+
+// ----------------------------------------------------------------------------
+
+static bool
+FoldConstant(int op, unsigned int a, unsigned int b, unsigned int c, unsigned int& result)
+{
+    float fa = BitsToFloat(a);
+    float fb = BitsToFloat(b);
+    float fc = BitsToFloat(c);
+    float value = 0.f;
+
+    switch (op)
+    {
+    case STVRCPU_OP_MOV:            result = a; return true;
+    case STVRCPU_OP_SELECT:         result = (a & b) | (~a & c); return true;
+    case STVRCPU_OP_AND:            result = a & b; return true;
+    case STVRCPU_OP_OR:             result = a | b; return true;
+    case STVRCPU_OP_XOR:            result = a ^ b; return true;
+    case STVRCPU_OP_ANDNOT:         result = ~a & b; return true;
+    case STVRCPU_OP_NOT:            result = ~a; return true;
+    case STVRCPU_OP_LT:             result = (fa < fb) ? c_AllLanesBits : 0; return true;
+    case STVRCPU_OP_LE:             result = (fa <= fb) ? c_AllLanesBits : 0; return true;
+    case STVRCPU_OP_GT:             result = (fa > fb) ? c_AllLanesBits : 0; return true;
+    case STVRCPU_OP_GE:             result = (fa >= fb) ? c_AllLanesBits : 0; return true;
+    case STVRCPU_OP_EQ:             result = (fa == fb) ? c_AllLanesBits : 0; return true;
+    case STVRCPU_OP_NE:             result = (fa != fb) ? c_AllLanesBits : 0; return true;
+    case STVRCPU_OP_ADD:            value = fa + fb; break;
+    case STVRCPU_OP_SUB:            value = fa - fb; break;
+    case STVRCPU_OP_MUL:            value = fa * fb; break;
+    case STVRCPU_OP_DIV:            value = fa / fb; break;
+    case STVRCPU_OP_MAD:            value = fa * fb + fc; break;
+    case STVRCPU_OP_MIN:            value = (fa < fb) ? fa : fb; break;
+    case STVRCPU_OP_MAX:            value = (fa > fb) ? fa : fb; break;
+    case STVRCPU_OP_NEG:            value = -fa; break;
+    case STVRCPU_OP_ABS:            value = fabsf(fa); break;
+    case STVRCPU_OP_SIGN:           value = (fa > 0.f) ? 1.f : (fa < 0.f) ? -1.f : 0.f; break;
+    case STVRCPU_OP_FLOOR:          value = floorf(fa); break;
+    case STVRCPU_OP_CEIL:           value = ceilf(fa); break;
+    case STVRCPU_OP_FRACT:          value = fa - floorf(fa); break;
+    case STVRCPU_OP_TRUNC:          value = (fa < 0.f) ? ceilf(fa) : floorf(fa); break;
+    case STVRCPU_OP_ROUND:          value = floorf(fa + .5f); break;
+    case STVRCPU_OP_MOD:            value = fa - fb * floorf(fa / fb); break;
+    case STVRCPU_OP_STEP:           value = (fb >= fa) ? 1.f : 0.f; break;
+    case STVRCPU_OP_SQRT:           value = sqrtf(fa); break;
+    case STVRCPU_OP_RSQRT:          value = 1.f / sqrtf(fa); break;
+    case STVRCPU_OP_SIN:            value = sinf(fa); break;
+    case STVRCPU_OP_COS:            value = cosf(fa); break;
+    case STVRCPU_OP_TAN:            value = tanf(fa); break;
+    case STVRCPU_OP_ASIN:           value = asinf(fa); break;
+    case STVRCPU_OP_ACOS:           value = acosf(fa); break;
+    case STVRCPU_OP_ATAN:           value = atanf(fa); break;
+    case STVRCPU_OP_ATAN2:          value = atan2f(fa, fb); break;
+    case STVRCPU_OP_POW:            value = powf(fa, fb); break;
+    case STVRCPU_OP_EXP:            value = expf(fa); break;
+    case STVRCPU_OP_LOG:            value = logf(fa); break;
+    case STVRCPU_OP_EXP2:           value = powf(2.f, fa); break;
+    case STVRCPU_OP_LOG2:           value = logf(fa) * 1.44269504f; break;
+    case STVRCPU_OP_MASK_TO_FLOAT:  value = a ? 1.f : 0.f; break;
+
+    // a constant does not change across a quad
+    case STVRCPU_OP_DFDX:
+    case STVRCPU_OP_DFDY:           value = 0.f; break;
+
+    default:
+        return false;
+    }
+
+    result = FloatToBits(value);
+    return true;
+}
+
+// ----------------------------------------------------------------------------
+
+static bool
+IsWrittenIn(const std::string& name, const CpuNode* node, const CpuProgram& program)
+{
+    if (!node) {
+        return false;
+    }
+
+    const CpuNode* target = NULL;
+    if (node->kind == CPU_NODE_ASSIGN || node->kind == CPU_NODE_POSTFIX ||
+        (node->kind == CPU_NODE_UNARY && (node->text == "++" || node->text == "--")))
+    {
+        target = node->children[0];
+    }
+
+    // any argument could be an out parameter
+    bool callWrites = false;
+    if (node->kind == CPU_NODE_CALL) {
+        for (size_t functionIdx = 0; functionIdx < program.functions.size(); functionIdx++)
+        {
+            const CpuFunction& function = *program.functions[functionIdx];
+            for (size_t parameterIdx = 0; function.name == node->text && parameterIdx < function.parameters.size(); parameterIdx++) {
+                callWrites = callWrites || function.parameters[parameterIdx].copiesOut;
+            }
+        }
+    }
+
+    for (size_t childIdx = 0; childIdx < node->children.size(); childIdx++)
+    {
+        const CpuNode* child = node->children[childIdx];
+        if (!child) {
+            continue;
+        }
+
+        if (child == target || callWrites) {
+            const CpuNode* root = child;
+            while (root->kind == CPU_NODE_FIELD || root->kind == CPU_NODE_INDEX) {
+                root = root->children[0];
+            }
+            if (root->kind == CPU_NODE_IDENTIFIER && root->text == name) {
+                return true;
+            }
+        }
+
+        if (IsWrittenIn(name, child, program)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// ----------------------------------------------------------------------------
+
+// a return inside a branch or loop, which needs a mask of returned lanes
+static bool
+HasNestedReturn(const CpuNode* node, bool nested)
+{
+    if (!node) {
+        return false;
+    }
+    if (node->kind == CPU_NODE_RETURN) {
+        return nested;
+    }
+
+    bool childNested = nested || node->kind == CPU_NODE_IF || node->kind == CPU_NODE_FOR ||
+        node->kind == CPU_NODE_WHILE || node->kind == CPU_NODE_DO;
+    for (size_t childIdx = 0; childIdx < node->children.size(); childIdx++) {
+        if (HasNestedReturn(node->children[childIdx], childNested)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// ----------------------------------------------------------------------------
+
+// assignments or calls that could store something
+static bool
+HasSideEffects(const CpuNode* node)
+{
+    if (!node) {
+        return false;
+    }
+    if (node->kind == CPU_NODE_ASSIGN || node->kind == CPU_NODE_POSTFIX || node->kind == CPU_NODE_CALL ||
+        (node->kind == CPU_NODE_UNARY && (node->text == "++" || node->text == "--")))
+    {
+        return true;
+    }
+
+    for (size_t childIdx = 0; childIdx < node->children.size(); childIdx++) {
+        if (HasSideEffects(node->children[childIdx])) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// ----------------------------------------------------------------------------
+
+bool
+CpuCodeGen::_Error(const CpuNode* node, const std::string& message)
+{
+    if (!m_failed) {
+        std::string location = node ? DescribeLocation(m_shaderName, m_sourceStringNames, node->sourceString, node->line) : m_shaderName;
+        std::cerr << "STVRCpuCompiler ERROR [ " << location << " ]: " << message << std::endl;
+    }
+    m_failed = true;
+    return false;
+}
+
+// ----------------------------------------------------------------------------
+
+int
+CpuCodeGen::_AllocRegisters(int count)
+{
+    int firstRegister = m_nextRegister;
+    m_nextRegister += count;
+    if (m_nextRegister > m_registerCount) {
+        m_registerCount = m_nextRegister;
+    }
+    return firstRegister;
+}
+
+// ----------------------------------------------------------------------------
+
+int
+CpuCodeGen::_Constant(float value)
+{
+    return _ConstantBits(FloatToBits(value));
+}
+
+// ----------------------------------------------------------------------------
+
+int
+CpuCodeGen::_ConstantBits(unsigned int bits)
+{
+    std::map<unsigned int, int>::const_iterator constantIter = m_constantRegisters.find(bits);
+    if (constantIter != m_constantRegisters.end()) {
+        return constantIter->second;
+    }
+
+    int reg = c_ConstantRegisterBase + int(m_constantBits.size());
+    m_constantBits.push_back(bits);
+    m_constantRegisters[bits] = reg;
+    return reg;
+}
+
+// ----------------------------------------------------------------------------
+
+bool
+CpuCodeGen::_IsConstant(int reg) const
+{
+    return reg >= c_ConstantRegisterBase;
+}
+
+// ----------------------------------------------------------------------------
+
+unsigned int
+CpuCodeGen::_ConstantValue(int reg) const
+{
+    return m_constantBits[reg - c_ConstantRegisterBase];
+}
+
+// ----------------------------------------------------------------------------
+
+bool
+CpuCodeGen::_IsConstantValue(const CpuValue& value) const
+{
+    for (size_t regIdx = 0; regIdx < value.registers.size(); regIdx++) {
+        if (!_IsConstant(value.registers[regIdx])) {
+            return false;
+        }
+    }
+    return !IsSampler(value.type);
+}
+
+// ----------------------------------------------------------------------------
+
+// An instruction into a new register, folded when its operands are
+// constants and skipped when it would not change its operand.
+int
+CpuCodeGen::_Emit(int op, int a, int b, int c)
+{
+    bool aConstant = (a == c_NoRegister) || _IsConstant(a);
+    bool bConstant = (b == c_NoRegister) || _IsConstant(b);
+    bool cConstant = (c == c_NoRegister) || _IsConstant(c);
+
+    unsigned int folded;
+    if (aConstant && bConstant && cConstant &&
+        FoldConstant(op, (a == c_NoRegister) ? 0 : _ConstantValue(a), (b == c_NoRegister) ? 0 : _ConstantValue(b),
+            (c == c_NoRegister) ? 0 : _ConstantValue(c), folded))
+    {
+        return _ConstantBits(folded);
+    }
+
+    const unsigned int zeroBits = FloatToBits(0.f);
+    const unsigned int oneBits = FloatToBits(1.f);
+    switch (op)
+    {
+    case STVRCPU_OP_MOV:
+        return a;
+    case STVRCPU_OP_ADD:
+        if (_IsConstant(a) && _ConstantValue(a) == zeroBits) return b;
+        if (_IsConstant(b) && _ConstantValue(b) == zeroBits) return a;
+        break;
+    case STVRCPU_OP_SUB:
+        if (_IsConstant(b) && _ConstantValue(b) == zeroBits) return a;
+        break;
+    case STVRCPU_OP_MUL:
+        if (_IsConstant(a) && _ConstantValue(a) == oneBits) return b;
+        if (_IsConstant(b) && _ConstantValue(b) == oneBits) return a;
+        break;
+    case STVRCPU_OP_DIV:
+        if (_IsConstant(b) && _ConstantValue(b) == oneBits) return a;
+        break;
+    case STVRCPU_OP_MAD:
+        if (_IsConstant(c) && _ConstantValue(c) == zeroBits) return _Emit(STVRCPU_OP_MUL, a, b);
+        if (_IsConstant(a) && _ConstantValue(a) == oneBits) return _Emit(STVRCPU_OP_ADD, b, c);
+        if (_IsConstant(b) && _ConstantValue(b) == oneBits) return _Emit(STVRCPU_OP_ADD, a, c);
+        break;
+    case STVRCPU_OP_AND:
+        if (a == b) return a;
+        if (_IsConstant(a)) return (_ConstantValue(a) == c_AllLanesBits) ? b : (_ConstantValue(a) == 0) ? a : _Emit(op, b, a);
+        if (_IsConstant(b)) {
+            if (_ConstantValue(b) == c_AllLanesBits) return a;
+            if (_ConstantValue(b) == 0) return b;
+        }
+        break;
+    case STVRCPU_OP_OR:
+        if (a == b) return a;
+        if (_IsConstant(a) && _ConstantValue(a) == 0) return b;
+        if (_IsConstant(b) && _ConstantValue(b) == 0) return a;
+        break;
+    case STVRCPU_OP_SELECT:
+        if (b == c) return b;
+        if (_IsConstant(a) && _ConstantValue(a) == c_AllLanesBits) return b;
+        if (_IsConstant(a) && _ConstantValue(a) == 0) return c;
+        break;
+    default:
+        break;
+    }
+
+    int dst = _AllocRegisters(1);
+    _EmitTo(op, dst, a, b, c);
+    return dst;
+}
+
+// ----------------------------------------------------------------------------
+
+void
+CpuCodeGen::_EmitTo(int op, int dst, int a, int b, int c)
+{
+    if (op == STVRCPU_OP_MOV && dst == a) {
+        return;
+    }
+
+    STVRCpuInstruction instruction;
+    instruction.op = op;
+    instruction.imm = 0;
+    instruction.dst = dst;
+    instruction.a = a;
+    instruction.b = b;
+    instruction.c = c;
+    m_code.push_back(instruction);
+}
+
+// ----------------------------------------------------------------------------
+
+size_t
+CpuCodeGen::_EmitJump(int op, int mask)
+{
+    STVRCpuInstruction instruction;
+    instruction.op = op;
+    instruction.imm = 0;
+    instruction.dst = c_NoRegister;
+    instruction.a = mask;
+    instruction.b = c_NoRegister;
+    instruction.c = c_NoRegister;
+    m_code.push_back(instruction);
+    return m_code.size() - 1;
+}
+
+// ----------------------------------------------------------------------------
+
+void
+CpuCodeGen::_PatchJump(size_t jumpIdx)
+{
+    m_code[jumpIdx].imm = int(m_code.size());
+}
+
+// ----------------------------------------------------------------------------
+
+int
+CpuCodeGen::_CurrentMask()
+{
+    return (m_mask == c_NoRegister) ? _ConstantBits(c_AllLanesBits) : m_mask;
+}
+
+// ----------------------------------------------------------------------------
+
+void
+CpuCodeGen::_PushScope()
+{
+    m_scopes.push_back(Scope());
+}
+
+// ----------------------------------------------------------------------------
+
+void
+CpuCodeGen::_PopScope()
+{
+    m_scopes.pop_back();
+}
+
+// ----------------------------------------------------------------------------
+
+// A function body only sees its own scopes and the globals.
+CpuVariable*
+CpuCodeGen::_FindVariable(const std::string& name)
+{
+    for (size_t scopeIdx = m_scopes.size(); scopeIdx > m_frameStart; scopeIdx--)
+    {
+        Scope::iterator variableIter = m_scopes[scopeIdx - 1].find(name);
+        if (variableIter != m_scopes[scopeIdx - 1].end()) {
+            return &variableIter->second;
+        }
+    }
+
+    Scope::iterator globalIter = m_scopes[0].find(name);
+    return (globalIter != m_scopes[0].end()) ? &globalIter->second : NULL;
+}
+
+// ----------------------------------------------------------------------------
+
+void
+CpuCodeGen::_Declare(const std::string& name, const CpuVariable& variable)
+{
+    m_scopes.back()[name] = variable;
+}
+
+// ----------------------------------------------------------------------------
+
+CpuValue
+CpuCodeGen::_MakeValue(const CpuType& type, const std::vector<int>& registers) const
+{
+    CpuValue value;
+    value.type = type;
+    value.registers = registers;
+    value.samplerChannel = -1;
+    return value;
+}
+
+// ----------------------------------------------------------------------------
+
+CpuValue
+CpuCodeGen::_ScalarValue(CpuBaseType base, int reg) const
+{
+    return _MakeValue(MakeType(base), std::vector<int>(1, reg));
+}
+
+// ----------------------------------------------------------------------------
+
+// scalars stand in for every component
+int
+CpuCodeGen::_Component(const CpuValue& value, int componentIdx) const
+{
+    return value.registers[value.registers.size() == 1 ? 0 : componentIdx];
+}
+
+// ----------------------------------------------------------------------------
+
+int
+CpuCodeGen::_ConvertComponent(int reg, CpuBaseType fromBase, CpuBaseType toBase)
+{
+    if (fromBase == toBase || (fromBase == CPU_TYPE_INT && toBase == CPU_TYPE_FLOAT)) {
+        return reg;
+    }
+    if (fromBase == CPU_TYPE_BOOL) {
+        return _Emit(STVRCPU_OP_MASK_TO_FLOAT, reg);
+    }
+    if (toBase == CPU_TYPE_BOOL) {
+        return _Emit(STVRCPU_OP_NE, reg, _Constant(0.f));
+    }
+    // float to int
+    return _Emit(STVRCPU_OP_TRUNC, reg);
+}
+
+// ----------------------------------------------------------------------------
+
+// The implicit conversions: only int to float, and only to the same shape.
+bool
+CpuCodeGen::_Convert(const CpuNode* node, const CpuValue& value, const CpuType& type, CpuValue& converted)
+{
+    if (value.type == type) {
+        converted = value;
+        return true;
+    }
+
+    CpuType intType = type;
+    intType.base = CPU_TYPE_INT;
+    if (type.base == CPU_TYPE_FLOAT && value.type == intType) {
+        converted = value;
+        converted.type = type;
+        return true;
+    }
+
+    return _Error(node, "cannot convert " + TypeName(value.type, m_program.structs) + " to " + TypeName(type, m_program.structs));
+}
+
+// ----------------------------------------------------------------------------
+
+bool
+CpuCodeGen::_ToFloat(const CpuNode* node, CpuValue& value)
+{
+    if (!IsBasic(value.type) || value.type.base == CPU_TYPE_BOOL) {
+        return _Error(node, "expected a float or int, not " + TypeName(value.type, m_program.structs));
+    }
+    value.type.base = CPU_TYPE_FLOAT;
+    return true;
+}
+
+// ----------------------------------------------------------------------------
+
+bool
+CpuCodeGen::_ToBoolScalar(const CpuNode* node, const CpuValue& value, int& reg)
+{
+    if (!IsScalar(value.type) || value.type.base != CPU_TYPE_BOOL) {
+        return _Error(node, "expected a bool, not " + TypeName(value.type, m_program.structs));
+    }
+    reg = value.registers[0];
+    return true;
+}
+
+// ----------------------------------------------------------------------------
+
+// into registers of its own, for values that must not follow a variable
+CpuValue
+CpuCodeGen::_Copy(const CpuValue& value)
+{
+    CpuValue copy = value;
+    for (size_t regIdx = 0; regIdx < value.registers.size(); regIdx++)
+    {
+        if (_IsConstant(value.registers[regIdx])) {
+            continue;
+        }
+        copy.registers[regIdx] = _AllocRegisters(1);
+        _EmitTo(STVRCPU_OP_MOV, copy.registers[regIdx], value.registers[regIdx]);
+    }
+    return copy;
+}
+
+// ----------------------------------------------------------------------------
+
+// The lanes of each element of a dynamically indexed array (the first
+// element takes out of range indices, there is no hit for it).
+std::vector<int>
+CpuCodeGen::_IndexHits(int indexRegister, size_t count)
+{
+    std::vector<int> hits(count, c_NoRegister);
+    for (size_t elementIdx = 1; elementIdx < count; elementIdx++) {
+        hits[elementIdx] = _Emit(STVRCPU_OP_EQ, indexRegister, _Constant(float(elementIdx)));
+    }
+    return hits;
+}
+
+// ----------------------------------------------------------------------------
+
+int
+CpuCodeGen::_SelectByHits(const std::vector<int>& hits, const std::vector<int>& candidates)
+{
+    int selected = candidates[0];
+    for (size_t candidateIdx = 1; candidateIdx < candidates.size(); candidateIdx++) {
+        selected = _Emit(STVRCPU_OP_SELECT, hits[candidateIdx], candidates[candidateIdx], selected);
+    }
+    return selected;
+}
+
+// ----------------------------------------------------------------------------
+
+bool
+CpuCodeGen::Run(STVRCpuKernel& kernel)
+{
+    _PushScope();
+
+    CpuVariable fragCoord;
+    fragCoord.type = MakeType(CPU_TYPE_FLOAT, 4);
+    fragCoord.maskVersion = 0;
+    fragCoord.readOnly = true;
+    fragCoord.samplerChannel = -1;
+    for (int component = 0; component < 4; component++)
+    {
+        m_fragCoordRegisters[component] = _AllocRegisters(1);
+        fragCoord.registers.push_back(m_fragCoordRegisters[component]);
+    }
+    _Declare("gl_FragCoord", fragCoord);
+
+    // black until the toy writes it
+    CpuVariable fragColor = fragCoord;
+    fragColor.readOnly = false;
+    fragColor.registers.clear();
+    for (int component = 0; component < 4; component++)
+    {
+        m_fragColorRegisters[component] = _AllocRegisters(1);
+        fragColor.registers.push_back(m_fragColorRegisters[component]);
+        _EmitTo(STVRCPU_OP_MOV, m_fragColorRegisters[component], _Constant(0.f));
+    }
+    _Declare("gl_FragColor", fragColor);
+
+    // global initializers run first, in order, as if at the top of main
+    FunctionContext globalContext;
+    globalContext.function = NULL;
+    globalContext.returnType = MakeType(CPU_TYPE_VOID);
+    globalContext.returnVersion = 0;
+    globalContext.liveMask = c_NoRegister;
+    globalContext.loopBase = 0;
+    m_functions.push_back(globalContext);
+
+    for (size_t globalIdx = 0; globalIdx < m_program.globals.size() && !m_failed; globalIdx++) {
+        _GenDeclaration(m_program.globals[globalIdx], true);
+    }
+
+    const CpuFunction* mainFunction = NULL;
+    for (size_t functionIdx = 0; functionIdx < m_program.functions.size(); functionIdx++)
+    {
+        const CpuFunction& function = *m_program.functions[functionIdx];
+        if (function.name == "main" && function.parameters.empty()) {
+            mainFunction = &function;
+        }
+    }
+
+    if (!m_failed && !mainFunction) {
+        std::cerr << "STVRCpuCompiler ERROR [ " << m_shaderName << " ]: no main function" << std::endl;
+        m_failed = true;
+    }
+
+    if (!m_failed) {
+        CpuValue unused;
+        _InlineFunction(NULL, *mainFunction, std::vector<CpuValue>(), unused);
+    }
+
+    return !m_failed && _Finish(kernel);
+}
+
+// ----------------------------------------------------------------------------
+
+bool
+CpuCodeGen::_Finish(STVRCpuKernel& kernel)
+{
+    // constants first, then the rest; unused operands read register 0
+    const int constantCount = int(m_constantBits.size());
+    for (size_t instructionIdx = 0; instructionIdx < m_code.size(); instructionIdx++)
+    {
+        STVRCpuInstruction& instruction = m_code[instructionIdx];
+        int* operands[4] = { &instruction.dst, &instruction.a, &instruction.b, &instruction.c };
+        for (int operandIdx = 0; operandIdx < 4; operandIdx++)
+        {
+            int& reg = *operands[operandIdx];
+            if (reg == c_NoRegister) {
+                reg = 0;
+            }
+            else if (_IsConstant(reg)) {
+                reg -= c_ConstantRegisterBase;
+            }
+            else {
+                reg += constantCount;
+            }
+        }
+    }
+
+    for (std::map<std::string, std::vector<int> >::iterator uniformIter = m_uniforms.begin();
+        uniformIter != m_uniforms.end();
+        uniformIter++)
+    {
+        for (size_t regIdx = 0; regIdx < uniformIter->second.size(); regIdx++) {
+            uniformIter->second[regIdx] += constantCount;
+        }
+        kernel.SetUniform(uniformIter->first, uniformIter->second);
+    }
+
+    for (int component = 0; component < 4; component++)
+    {
+        m_fragCoordRegisters[component] += constantCount;
+        m_fragColorRegisters[component] += constantCount;
+    }
+
+    kernel.SetCode(m_code);
+    kernel.SetConstants(m_constantBits);
+    kernel.SetRegisterCount(constantCount + m_registerCount);
+    kernel.SetFragCoordRegisters(m_fragCoordRegisters);
+    kernel.SetFragColorRegisters(m_fragColorRegisters);
+    return true;
+}
+
+// ----------------------------------------------------------------------------
+
+bool
+CpuCodeGen::_GenStatement(const CpuNode* node)
+{
+    switch (node->kind)
+    {
+    case CPU_NODE_BLOCK:
+        return _GenBlock(node, true);
+
+    case CPU_NODE_DECLARATION:
+        return _GenDeclaration(node, false);
+
+    case CPU_NODE_EXPRESSION:
+        {
+            CpuValue unused;
+            return _GenExpression(node->children[0], unused);
+        }
+
+    case CPU_NODE_IF:
+        return _GenIf(node);
+
+    case CPU_NODE_FOR:
+    case CPU_NODE_WHILE:
+    case CPU_NODE_DO:
+        return _GenLoop(node);
+
+    case CPU_NODE_RETURN:
+        return _GenReturn(node);
+
+    case CPU_NODE_BREAK:
+    case CPU_NODE_CONTINUE:
+        return _GenBreakOrContinue(node);
+
+    case CPU_NODE_DISCARD:
+        return _Error(node, "discard is not supported");
+
+    case CPU_NODE_EMPTY:
+        return true;
+
+    default:
+        return _Error(node, "expected a statement");
+    }
+}
+
+// ----------------------------------------------------------------------------
+
+// Temporaries live until the end of their statement, variables until the
+// end of their block.
+bool
+CpuCodeGen::_GenBlock(const CpuNode* node, bool ownScope)
+{
+    if (ownScope) {
+        _PushScope();
+    }
+
+    int blockTop = m_nextRegister;
+    bool succeeded = true;
+
+    for (size_t statementIdx = 0; statementIdx < node->children.size() && succeeded && !m_deadCode; statementIdx++)
+    {
+        const CpuNode* statement = node->children[statementIdx];
+        int statementTop = m_nextRegister;
+        succeeded = _GenStatement(statement);
+        if (statement->kind != CPU_NODE_DECLARATION) {
+            m_nextRegister = statementTop;
+        }
+    }
+
+    if (ownScope) {
+        _PopScope();
+    }
+    m_nextRegister = blockTop;
+    return succeeded;
+}
+
+// ----------------------------------------------------------------------------
+
+bool
+CpuCodeGen::_GenDeclaration(const CpuNode* node, bool isGlobal)
+{
+    for (size_t declaratorIdx = 0; declaratorIdx < node->children.size(); declaratorIdx++)
+    {
+        const CpuNode* declarator = node->children[declaratorIdx];
+        const CpuNode* initializer = declarator->children.empty() ? NULL : declarator->children[0];
+
+        CpuVariable variable;
+        variable.type = declarator->type;
+        variable.maskVersion = m_maskVersion;
+        variable.readOnly = declarator->isConst || declarator->isUniform;
+        variable.samplerChannel = -1;
+
+        if (IsSampler(variable.type)) {
+            const std::string& name = declarator->text;
+            if (!isGlobal || !declarator->isUniform || variable.type.arraySize != 0 ||
+                name.size() != 9 || name.compare(0, 8, "iChannel") != 0 || name[8] < '0' || name[8] > '3')
+            {
+                return _Error(declarator, "the only samplers are iChannel0 to iChannel3");
+            }
+            variable.samplerChannel = name[8] - '0';
+            _Declare(name, variable);
+            continue;
+        }
+
+        if (variable.type.base == CPU_TYPE_VOID) {
+            return _Error(declarator, "variables cannot be void");
+        }
+
+        if (declarator->isUniform) {
+            variable.registers.resize(TypeSlots(variable.type, m_program.structs));
+            for (size_t regIdx = 0; regIdx < variable.registers.size(); regIdx++) {
+                variable.registers[regIdx] = _AllocRegisters(1);
+            }
+            m_uniforms[declarator->text] = variable.registers;
+            _Declare(declarator->text, variable);
+            continue;
+        }
+
+        // the toy's own output takes gl_FragColor's registers
+        if (isGlobal && node->isOutput) {
+            if (variable.type != MakeType(CPU_TYPE_FLOAT, 4)) {
+                return _Error(declarator, "the output must be a vec4");
+            }
+            variable.registers = _FindVariable("gl_FragColor")->registers;
+            _Declare(declarator->text, variable);
+            continue;
+        }
+
+        int variableTop = m_nextRegister;
+        CpuValue initialValue;
+        bool initialized = false;
+
+        // Constants with constant initializers are the constant registers
+        // themselves.  Otherwise the initializer is worked out after the
+        // variable has its registers, so its temporaries can be freed,
+        // unless the initializer sizes the array.
+        if (initializer && (declarator->isConst || variable.type.arraySize < 0)) {
+            if (!_GenExpression(initializer, initialValue)) {
+                return false;
+            }
+            if (variable.type.arraySize < 0 && initialValue.type.arraySize > 0) {
+                variable.type.arraySize = initialValue.type.arraySize;
+            }
+            if (!_Convert(initializer, initialValue, variable.type, initialValue)) {
+                return false;
+            }
+            initialized = true;
+
+            if (declarator->isConst && _IsConstantValue(initialValue)) {
+                m_nextRegister = variableTop;
+                variable.registers = initialValue.registers;
+                _Declare(declarator->text, variable);
+                continue;
+            }
+        }
+
+        variable.registers.resize(TypeSlots(variable.type, m_program.structs));
+        for (size_t regIdx = 0; regIdx < variable.registers.size(); regIdx++) {
+            variable.registers[regIdx] = _AllocRegisters(1);
+        }
+
+        int temporariesTop = m_nextRegister;
+        bool initializedFirst = initialized;
+        if (initializer && !initialized) {
+            if (!_GenExpression(initializer, initialValue) || !_Convert(initializer, initialValue, variable.type, initialValue)) {
+                return false;
+            }
+            initialized = true;
+        }
+
+        // a new variable has no lanes to keep, so no select
+        for (size_t regIdx = 0; regIdx < variable.registers.size(); regIdx++) {
+            _EmitTo(STVRCPU_OP_MOV, variable.registers[regIdx], initialized ? initialValue.registers[regIdx] : _Constant(0.f));
+        }
+        if (!initializedFirst) {
+            m_nextRegister = temporariesTop;
+        }
+
+        // declared after the initializer, "float x = x;" reads the outer x
+        _Declare(declarator->text, variable);
+    }
+    return true;
+}
+
+// ----------------------------------------------------------------------------
+
+bool
+CpuCodeGen::_GenIf(const CpuNode* node)
+{
+    const CpuNode* thenStatement = node->children[1];
+    const CpuNode* elseStatement = node->children[2];
+
+    CpuValue condition;
+    int conditionReg;
+    if (!_GenExpression(node->children[0], condition) || !_ToBoolScalar(node->children[0], condition, conditionReg)) {
+        return false;
+    }
+
+    // #define switches end up here
+    if (_IsConstant(conditionReg)) {
+        const CpuNode* taken = _ConstantValue(conditionReg) ? thenStatement : elseStatement;
+        return taken ? _GenStatement(taken) : true;
+    }
+
+    int savedMask = m_mask;
+    int savedVersion = m_maskVersion;
+    int savedJumps = m_jumpCount;
+
+    // both masks up front: a return in the then branch narrows thenMask
+    int thenMask = _AllocRegisters(1);
+    if (m_mask == c_NoRegister) {
+        _EmitTo(STVRCPU_OP_MOV, thenMask, conditionReg);
+    }
+    else {
+        _EmitTo(STVRCPU_OP_AND, thenMask, m_mask, conditionReg);
+    }
+
+    int elseMask = c_NoRegister;
+    if (elseStatement) {
+        elseMask = _AllocRegisters(1);
+        if (m_mask == c_NoRegister) {
+            _EmitTo(STVRCPU_OP_NOT, elseMask, thenMask);
+        }
+        else {
+            _EmitTo(STVRCPU_OP_ANDNOT, elseMask, thenMask, m_mask);
+        }
+    }
+
+    size_t skipThen = _EmitJump(STVRCPU_OP_JMP_IF_NONE, thenMask);
+    m_mask = thenMask;
+    m_maskVersion = ++m_versionCount;
+    m_deadCode = false;
+    bool succeeded = _GenStatement(thenStatement);
+    bool thenDead = m_deadCode;
+    _PatchJump(skipThen);
+
+    bool elseDead = false;
+    if (succeeded && elseStatement) {
+        size_t skipElse = _EmitJump(STVRCPU_OP_JMP_IF_NONE, elseMask);
+        m_mask = elseMask;
+        m_maskVersion = ++m_versionCount;
+        m_deadCode = false;
+        succeeded = _GenStatement(elseStatement);
+        elseDead = m_deadCode;
+        _PatchJump(skipElse);
+    }
+
+    m_mask = savedMask;
+    m_maskVersion = savedVersion;
+    m_deadCode = elseStatement && thenDead && elseDead;
+
+    if (m_jumpCount != savedJumps && !m_deadCode) {
+        _NarrowAfterJumps();
+    }
+    return succeeded;
+}
+
+// ----------------------------------------------------------------------------
+
+// Lanes that left through a jump inside the statement just generated stop
+// running the rest of the enclosing block.
+void
+CpuCodeGen::_NarrowAfterJumps()
+{
+    const FunctionContext& function = m_functions.back();
+    int liveMask = (m_loops.size() > function.loopBase) ? m_loops.back().continueMask : function.liveMask;
+    if (liveMask == c_NoRegister) {
+        return;
+    }
+
+    if (m_mask == c_NoRegister) {
+        m_mask = liveMask;
+    }
+    else if (m_mask != liveMask) {
+        _EmitTo(STVRCPU_OP_AND, m_mask, m_mask, liveMask);
+    }
+    m_maskVersion = ++m_versionCount;
+}
+
+// ----------------------------------------------------------------------------
+
+// The loop runs until none of its lanes is left: the condition and every
+// break take lanes out of liveMask, every continue takes them out of
+// continueMask until the next iteration.
+bool
+CpuCodeGen::_GenLoop(const CpuNode* node)
+{
+    const CpuNode* init = NULL;
+    const CpuNode* condition = NULL;
+    const CpuNode* step = NULL;
+    const CpuNode* body = NULL;
+    bool testsAfterBody = false;
+
+    if (node->kind == CPU_NODE_FOR) {
+        init = node->children[0];
+        condition = node->children[1];
+        step = node->children[2];
+        body = node->children[3];
+    }
+    else if (node->kind == CPU_NODE_WHILE) {
+        condition = node->children[0];
+        body = node->children[1];
+    }
+    else {
+        body = node->children[0];
+        condition = node->children[1];
+        testsAfterBody = true;
+    }
+
+    _PushScope();
+    int loopTop = m_nextRegister;
+    if (init && !_GenStatement(init)) {
+        return false;
+    }
+    if (init && init->kind != CPU_NODE_DECLARATION) {
+        m_nextRegister = loopTop;
+    }
+
+    int savedMask = m_mask;
+    int savedVersion = m_maskVersion;
+    int savedJumps = m_jumpCount;
+    int savedReturns = m_returnCount;
+
+    LoopContext loop;
+    loop.liveMask = _AllocRegisters(1);
+    loop.continueMask = _AllocRegisters(1);
+    _EmitTo(STVRCPU_OP_MOV, loop.liveMask, _CurrentMask());
+    m_loops.push_back(loop);
+
+    size_t iterationStart = m_code.size();
+    size_t exitJump = 0;
+    bool succeeded = true;
+
+    m_mask = loop.liveMask;
+    m_maskVersion = ++m_versionCount;
+    if (!testsAfterBody) {
+        succeeded = _GenLoopCondition(condition, loop.liveMask, exitJump);
+    }
+
+    if (succeeded) {
+        _EmitTo(STVRCPU_OP_MOV, loop.continueMask, loop.liveMask);
+        m_mask = loop.continueMask;
+        m_maskVersion = ++m_versionCount;
+        m_deadCode = false;
+        succeeded = _GenStatement(body);
+        m_deadCode = false;
+    }
+
+    m_mask = loop.liveMask;
+    m_maskVersion = ++m_versionCount;
+    if (succeeded && testsAfterBody) {
+        succeeded = _GenLoopCondition(condition, loop.liveMask, exitJump);
+    }
+    if (succeeded && step) {
+        int stepTop = m_nextRegister;
+        CpuValue unused;
+        succeeded = _GenExpression(step, unused);
+        m_nextRegister = stepTop;
+    }
+
+    size_t backJump = _EmitJump(STVRCPU_OP_JMP, c_NoRegister);
+    m_code[backJump].imm = int(iterationStart);
+    _PatchJump(exitJump);
+
+    m_loops.pop_back();
+    m_mask = savedMask;
+    m_maskVersion = savedVersion;
+
+    // breaks and continues end with the loop, returns do not
+    m_jumpCount = savedJumps + (m_returnCount - savedReturns);
+    if (m_returnCount != savedReturns) {
+        _NarrowAfterJumps();
+    }
+
+    _PopScope();
+    m_nextRegister = loopTop;
+    return succeeded;
+}
+
+// ----------------------------------------------------------------------------
+
+bool
+CpuCodeGen::_GenLoopCondition(const CpuNode* condition, int liveMask, size_t& exitJump)
+{
+    if (condition) {
+        int conditionTop = m_nextRegister;
+        CpuValue conditionValue;
+        int conditionReg;
+        if (!_GenExpression(condition, conditionValue) || !_ToBoolScalar(condition, conditionValue, conditionReg)) {
+            return false;
+        }
+        if (!_IsConstant(conditionReg) || _ConstantValue(conditionReg) != c_AllLanesBits) {
+            _EmitTo(STVRCPU_OP_AND, liveMask, liveMask, conditionReg);
+        }
+        m_nextRegister = conditionTop;
+    }
+
+    exitJump = _EmitJump(STVRCPU_OP_JMP_IF_NONE, liveMask);
+    return true;
+}
+
+// ----------------------------------------------------------------------------
+
+bool
+CpuCodeGen::_GenReturn(const CpuNode* node)
+{
+    FunctionContext& function = m_functions.back();
+    if (!function.function) {
+        return _Error(node, "return outside a function");
+    }
+
+    if (!node->children.empty()) {
+        CpuValue returnValue;
+        if (function.returnType.base == CPU_TYPE_VOID) {
+            return _Error(node, "a void function cannot return a value");
+        }
+        if (!_GenExpression(node->children[0], returnValue) ||
+            !_Convert(node->children[0], returnValue, function.returnType, returnValue))
+        {
+            return false;
+        }
+
+        int storeMask = (function.returnVersion != m_maskVersion) ? m_mask : c_NoRegister;
+        for (size_t regIdx = 0; regIdx < function.returnRegisters.size(); regIdx++) {
+            _StoreRegister(function.returnRegisters[regIdx], returnValue.registers[regIdx], storeMask);
+        }
+    }
+    else if (function.returnType.base != CPU_TYPE_VOID) {
+        return _Error(node, "missing return value");
+    }
+
+    // the returning lanes are done with the function and its loops
+    if (function.liveMask != c_NoRegister && m_mask != function.liveMask) {
+        _EmitTo(STVRCPU_OP_ANDNOT, function.liveMask, m_mask, function.liveMask);
+        for (size_t loopIdx = function.loopBase; loopIdx < m_loops.size(); loopIdx++)
+        {
+            _EmitTo(STVRCPU_OP_ANDNOT, m_loops[loopIdx].liveMask, m_mask, m_loops[loopIdx].liveMask);
+            _EmitTo(STVRCPU_OP_ANDNOT, m_loops[loopIdx].continueMask, m_mask, m_loops[loopIdx].continueMask);
+        }
+    }
+
+    m_deadCode = true;
+    m_jumpCount++;
+    m_returnCount++;
+    return true;
+}
+
+// ----------------------------------------------------------------------------
+
+bool
+CpuCodeGen::_GenBreakOrContinue(const CpuNode* node)
+{
+    const FunctionContext& function = m_functions.back();
+    if (m_loops.size() <= function.loopBase) {
+        return _Error(node, (node->kind == CPU_NODE_BREAK) ? "break outside a loop" : "continue outside a loop");
+    }
+
+    LoopContext& loop = m_loops.back();
+    int mask = _CurrentMask();
+    if (node->kind == CPU_NODE_BREAK) {
+        _EmitTo(STVRCPU_OP_ANDNOT, loop.liveMask, mask, loop.liveMask);
+    }
+    _EmitTo(STVRCPU_OP_ANDNOT, loop.continueMask, mask, loop.continueMask);
+
+    m_deadCode = true;
+    m_jumpCount++;
+    return true;
+}
+
+// ----------------------------------------------------------------------------
+
+bool
+CpuCodeGen::_GenExpression(const CpuNode* node, CpuValue& value)
+{
+    switch (node->kind)
+    {
+    case CPU_NODE_NUMBER:
+        value = _ScalarValue(node->isFloat ? CPU_TYPE_FLOAT : CPU_TYPE_INT, _Constant(float(node->number)));
+        return true;
+
+    case CPU_NODE_BOOL:
+        value = _ScalarValue(CPU_TYPE_BOOL, _ConstantBits(node->number != 0. ? c_AllLanesBits : 0));
+        return true;
+
+    case CPU_NODE_IDENTIFIER:
+        {
+            const CpuVariable* variable = _FindVariable(node->text);
+            if (!variable) {
+                return _Error(node, "'" + node->text + "' is not declared");
+            }
+            value = _MakeValue(variable->type, variable->registers);
+            value.samplerChannel = variable->samplerChannel;
+            return true;
+        }
+
+    case CPU_NODE_UNARY:
+    case CPU_NODE_POSTFIX:
+        return _GenUnary(node, value);
+
+    case CPU_NODE_BINARY:
+        return _GenBinary(node, value);
+
+    case CPU_NODE_ASSIGN:
+        return _GenAssign(node, value);
+
+    case CPU_NODE_TERNARY:
+        return _GenTernary(node, value);
+
+    case CPU_NODE_CALL:
+        return _GenCall(node, value);
+
+    case CPU_NODE_CONSTRUCT:
+        return _GenConstruct(node, value);
+
+    case CPU_NODE_FIELD:
+        {
+            CpuValue base;
+            CpuType fieldType;
+            std::vector<int> slots;
+            if (!_GenExpression(node->children[0], base) || !_SelectField(node, base.type, fieldType, slots)) {
+                return false;
+            }
+
+            std::vector<int> registers;
+            for (size_t slotIdx = 0; slotIdx < slots.size(); slotIdx++) {
+                registers.push_back(base.registers[slots[slotIdx]]);
+            }
+            value = _MakeValue(fieldType, registers);
+            return true;
+        }
+
+    case CPU_NODE_INDEX:
+        {
+            CpuValue base;
+            CpuValue index;
+            CpuType elementType;
+            int elementCount, elementSlots;
+            if (!_GenExpression(node->children[0], base) || !_GenExpression(node->children[1], index) ||
+                !_IndexedElement(node, base.type, index, elementType, elementCount, elementSlots))
+            {
+                return false;
+            }
+
+            std::vector<int> registers(elementSlots);
+            int indexReg = index.registers[0];
+            if (_IsConstant(indexReg)) {
+                int elementIdx = int(BitsToFloat(_ConstantValue(indexReg)));
+                for (int slotIdx = 0; slotIdx < elementSlots; slotIdx++) {
+                    registers[slotIdx] = base.registers[elementIdx * elementSlots + slotIdx];
+                }
+            }
+            else {
+                std::vector<int> hits = _IndexHits(indexReg, size_t(elementCount));
+                for (int slotIdx = 0; slotIdx < elementSlots; slotIdx++)
+                {
+                    std::vector<int> candidates;
+                    for (int elementIdx = 0; elementIdx < elementCount; elementIdx++) {
+                        candidates.push_back(base.registers[elementIdx * elementSlots + slotIdx]);
+                    }
+                    registers[slotIdx] = _SelectByHits(hits, candidates);
+                }
+            }
+            value = _MakeValue(elementType, registers);
+            return true;
+        }
+
+    case CPU_NODE_SEQUENCE:
+        for (size_t childIdx = 0; childIdx < node->children.size(); childIdx++) {
+            if (!_GenExpression(node->children[childIdx], value)) {
+                return false;
+            }
+        }
+        return true;
+
+    default:
+        return _Error(node, "expected an expression");
+    }
+}
+
+// ----------------------------------------------------------------------------
+
+// The slots of a struct field or the components of a swizzle.
+bool
+CpuCodeGen::_SelectField(const CpuNode* node, const CpuType& baseType, CpuType& fieldType, std::vector<int>& slots)
+{
+    slots.clear();
+
+    if (baseType.base == CPU_TYPE_STRUCT && baseType.arraySize == 0) {
+        const CpuStruct& structDef = m_program.structs[baseType.structIdx];
+        int offset = 0;
+        for (size_t fieldIdx = 0; fieldIdx < structDef.fields.size(); fieldIdx++)
+        {
+            const CpuStructField& field = structDef.fields[fieldIdx];
+            int fieldSlots = TypeSlots(field.type, m_program.structs);
+            if (field.name == node->text) {
+                fieldType = field.type;
+                for (int slotIdx = 0; slotIdx < fieldSlots; slotIdx++) {
+                    slots.push_back(offset + slotIdx);
+                }
+                return true;
+            }
+            offset += fieldSlots;
+        }
+        return _Error(node, "no field '" + node->text + "' in " + structDef.name);
+    }
+
+    if (!IsScalar(baseType) && !IsVector(baseType)) {
+        return _Error(node, "cannot take '." + node->text + "' of " + TypeName(baseType, m_program.structs));
+    }
+
+    static const char* swizzleSets[] = { "xyzw", "rgba", "stpq" };
+    const std::string& swizzle = node->text;
+    for (int setIdx = 0; setIdx < 3 && slots.empty(); setIdx++)
+    {
+        for (size_t charIdx = 0; charIdx < swizzle.size(); charIdx++)
+        {
+            const char* component = strchr(swizzleSets[setIdx], swizzle[charIdx]);
+            if (!component || int(component - swizzleSets[setIdx]) >= baseType.rows) {
+                slots.clear();
+                break;
+            }
+            slots.push_back(int(component - swizzleSets[setIdx]));
+        }
+    }
+
+    if (slots.empty() || slots.size() > 4) {
+        return _Error(node, "bad swizzle '." + swizzle + "' of " + TypeName(baseType, m_program.structs));
+    }
+
+    fieldType = MakeType(baseType.base, int(slots.size()));
+    return true;
+}
+
+// ----------------------------------------------------------------------------
+
+bool
+CpuCodeGen::_IndexedElement(const CpuNode* node, const CpuType& baseType, const CpuValue& index,
+    CpuType& elementType, int& elementCount, int& elementSlots)
+{
+    if (!IsScalar(index.type) || index.type.base == CPU_TYPE_BOOL) {
+        return _Error(node, "indices must be int");
+    }
+
+    if (baseType.arraySize > 0) {
+        elementType = ElementType(baseType);
+        elementCount = baseType.arraySize;
+    }
+    else if (IsMatrix(baseType)) {
+        elementType = MakeType(CPU_TYPE_FLOAT, baseType.rows);
+        elementCount = baseType.columns;
+    }
+    else if (IsVector(baseType)) {
+        elementType = MakeType(baseType.base);
+        elementCount = baseType.rows;
+    }
+    else {
+        return _Error(node, "cannot index " + TypeName(baseType, m_program.structs));
+    }
+    elementSlots = TypeSlots(elementType, m_program.structs);
+
+    int indexReg = index.registers[0];
+    if (_IsConstant(indexReg)) {
+        float elementIdx = BitsToFloat(_ConstantValue(indexReg));
+        if (elementIdx < 0.f || elementIdx >= float(elementCount)) {
+            return _Error(node, "index out of range");
+        }
+    }
+    return true;
+}
+
+// ----------------------------------------------------------------------------
+
+bool
+CpuCodeGen::_GenLValue(const CpuNode* node, CpuLValue& lvalue)
+{
+    if (node->kind == CPU_NODE_IDENTIFIER) {
+        const CpuVariable* variable = _FindVariable(node->text);
+        if (!variable) {
+            return _Error(node, "'" + node->text + "' is not declared");
+        }
+        if (variable->readOnly || IsSampler(variable->type)) {
+            return _Error(node, "cannot assign to '" + node->text + "'");
+        }
+
+        lvalue.type = variable->type;
+        lvalue.candidates.assign(1, variable->registers);
+        lvalue.indexRegister = c_NoRegister;
+        lvalue.maskVersion = variable->maskVersion;
+        return true;
+    }
+
+    if (node->kind == CPU_NODE_FIELD) {
+        CpuType fieldType;
+        std::vector<int> slots;
+        if (!_GenLValue(node->children[0], lvalue) || !_SelectField(node, lvalue.type, fieldType, slots)) {
+            return false;
+        }
+
+        std::set<int> distinctSlots(slots.begin(), slots.end());
+        if (distinctSlots.size() != slots.size()) {
+            return _Error(node, "cannot assign to a swizzle that repeats a component");
+        }
+
+        for (size_t candidateIdx = 0; candidateIdx < lvalue.candidates.size(); candidateIdx++)
+        {
+            std::vector<int> registers;
+            for (size_t slotIdx = 0; slotIdx < slots.size(); slotIdx++) {
+                registers.push_back(lvalue.candidates[candidateIdx][slots[slotIdx]]);
+            }
+            lvalue.candidates[candidateIdx].swap(registers);
+        }
+        lvalue.type = fieldType;
+        return true;
+    }
+
+    if (node->kind == CPU_NODE_INDEX) {
+        CpuValue index;
+        CpuType elementType;
+        int elementCount, elementSlots;
+        if (!_GenLValue(node->children[0], lvalue) || !_GenExpression(node->children[1], index) ||
+            !_IndexedElement(node, lvalue.type, index, elementType, elementCount, elementSlots))
+        {
+            return false;
+        }
+
+        int indexReg = index.registers[0];
+        std::vector<std::vector<int> > candidates;
+        if (_IsConstant(indexReg)) {
+            int elementIdx = int(BitsToFloat(_ConstantValue(indexReg)));
+            for (size_t candidateIdx = 0; candidateIdx < lvalue.candidates.size(); candidateIdx++)
+            {
+                const std::vector<int>& registers = lvalue.candidates[candidateIdx];
+                candidates.push_back(std::vector<int>(registers.begin() + elementIdx * elementSlots,
+                    registers.begin() + (elementIdx + 1) * elementSlots));
+            }
+        }
+        else {
+            if (lvalue.indexRegister != c_NoRegister) {
+                return _Error(node, "only one non constant index per assignment");
+            }
+
+            const std::vector<int>& registers = lvalue.candidates[0];
+            for (int elementIdx = 0; elementIdx < elementCount; elementIdx++) {
+                candidates.push_back(std::vector<int>(registers.begin() + elementIdx * elementSlots,
+                    registers.begin() + (elementIdx + 1) * elementSlots));
+            }
+            lvalue.indexRegister = indexReg;
+        }
+
+        lvalue.candidates.swap(candidates);
+        lvalue.type = elementType;
+        return true;
+    }
+
+    return _Error(node, "cannot assign to this expression");
+}
+
+// ----------------------------------------------------------------------------
+
+bool
+CpuCodeGen::_Load(const CpuLValue& lvalue, CpuValue& value)
+{
+    if (lvalue.candidates.size() == 1) {
+        value = _MakeValue(lvalue.type, lvalue.candidates[0]);
+        return true;
+    }
+
+    std::vector<int> hits = _IndexHits(lvalue.indexRegister, lvalue.candidates.size());
+    std::vector<int> registers;
+    for (size_t slotIdx = 0; slotIdx < lvalue.candidates[0].size(); slotIdx++)
+    {
+        std::vector<int> candidates;
+        for (size_t candidateIdx = 0; candidateIdx < lvalue.candidates.size(); candidateIdx++) {
+            candidates.push_back(lvalue.candidates[candidateIdx][slotIdx]);
+        }
+        registers.push_back(_SelectByHits(hits, candidates));
+    }
+    value = _MakeValue(lvalue.type, registers);
+    return true;
+}
+
+// ----------------------------------------------------------------------------
+
+void
+CpuCodeGen::_Store(const CpuLValue& lvalue, const CpuValue& value)
+{
+    // a variable declared under the current mask has nothing to keep in the
+    // lanes the mask leaves out
+    int mask = (lvalue.maskVersion != m_maskVersion) ? m_mask : c_NoRegister;
+
+    // "v.xy = v.yx" must read both before writing either
+    std::set<int> targets;
+    for (size_t candidateIdx = 0; candidateIdx < lvalue.candidates.size(); candidateIdx++) {
+        targets.insert(lvalue.candidates[candidateIdx].begin(), lvalue.candidates[candidateIdx].end());
+    }
+
+    CpuValue source = value;
+    for (size_t regIdx = 0; regIdx < value.registers.size(); regIdx++)
+    {
+        if (targets.count(value.registers[regIdx]) &&
+            (lvalue.candidates.size() > 1 || lvalue.candidates[0][regIdx] != value.registers[regIdx]))
+        {
+            source = _Copy(value);
+            break;
+        }
+    }
+
+    if (lvalue.candidates.size() == 1) {
+        for (size_t regIdx = 0; regIdx < source.registers.size(); regIdx++) {
+            _StoreRegister(lvalue.candidates[0][regIdx], source.registers[regIdx], mask);
+        }
+        return;
+    }
+
+    for (size_t candidateIdx = 0; candidateIdx < lvalue.candidates.size(); candidateIdx++)
+    {
+        int hit = _Emit(STVRCPU_OP_EQ, lvalue.indexRegister, _Constant(float(candidateIdx)));
+        if (mask != c_NoRegister) {
+            hit = _Emit(STVRCPU_OP_AND, hit, mask);
+        }
+
+        const std::vector<int>& registers = lvalue.candidates[candidateIdx];
+        for (size_t regIdx = 0; regIdx < registers.size(); regIdx++) {
+            _EmitTo(STVRCPU_OP_SELECT, registers[regIdx], hit, source.registers[regIdx], registers[regIdx]);
+        }
+    }
+}
+
+// ----------------------------------------------------------------------------
+
+void
+CpuCodeGen::_StoreRegister(int dst, int src, int mask)
+{
+    if (mask == c_NoRegister) {
+        _EmitTo(STVRCPU_OP_MOV, dst, src);
+    }
+    else if (dst != src) {
+        _EmitTo(STVRCPU_OP_SELECT, dst, mask, src, dst);
+    }
+}
+
+// ----------------------------------------------------------------------------
+
+bool
+CpuCodeGen::_GenUnary(const CpuNode* node, CpuValue& value)
+{
+    const std::string& op = node->text;
+
+    if (op == "++" || op == "--") {
+        CpuLValue lvalue;
+        CpuValue current;
+        if (!_GenLValue(node->children[0], lvalue) || !_Load(lvalue, current)) {
+            return false;
+        }
+        if (!IsBasic(current.type) || current.type.base == CPU_TYPE_BOOL) {
+            return _Error(node, "cannot apply " + op + " to " + TypeName(current.type, m_program.structs));
+        }
+
+        // a postfix result is the value from before the store
+        if (node->kind == CPU_NODE_POSTFIX) {
+            current = _Copy(current);
+        }
+
+        CpuValue updated = current;
+        for (size_t regIdx = 0; regIdx < current.registers.size(); regIdx++) {
+            updated.registers[regIdx] = _Emit((op == "++") ? STVRCPU_OP_ADD : STVRCPU_OP_SUB, current.registers[regIdx], _Constant(1.f));
+        }
+        _Store(lvalue, updated);
+
+        value = (node->kind == CPU_NODE_POSTFIX) ? current : updated;
+        return true;
+    }
+
+    CpuValue operand;
+    if (!_GenExpression(node->children[0], operand)) {
+        return false;
+    }
+
+    if (op == "!") {
+        int operandReg;
+        if (!_ToBoolScalar(node, operand, operandReg)) {
+            return false;
+        }
+        value = _ScalarValue(CPU_TYPE_BOOL, _Emit(STVRCPU_OP_NOT, operandReg));
+        return true;
+    }
+
+    if (!IsBasic(operand.type) || operand.type.base == CPU_TYPE_BOOL) {
+        return _Error(node, "cannot apply " + op + " to " + TypeName(operand.type, m_program.structs));
+    }
+
+    value = operand;
+    if (op == "-") {
+        for (size_t regIdx = 0; regIdx < operand.registers.size(); regIdx++) {
+            value.registers[regIdx] = _Emit(STVRCPU_OP_NEG, operand.registers[regIdx]);
+        }
+    }
+    return true;
+}
+
+// ----------------------------------------------------------------------------
+
+bool
+CpuCodeGen::_GenBinary(const CpuNode* node, CpuValue& value)
+{
+    const std::string& op = node->text;
+
+    CpuValue lhs, rhs;
+    if (!_GenExpression(node->children[0], lhs) || !_GenExpression(node->children[1], rhs)) {
+        return false;
+    }
+
+    if (op == "&&" || op == "||" || op == "^^") {
+        int lhsReg, rhsReg;
+        if (!_ToBoolScalar(node->children[0], lhs, lhsReg) || !_ToBoolScalar(node->children[1], rhs, rhsReg)) {
+            return false;
+        }
+        int opCode = (op == "&&") ? STVRCPU_OP_AND : (op == "||") ? STVRCPU_OP_OR : STVRCPU_OP_XOR;
+        value = _ScalarValue(CPU_TYPE_BOOL, _Emit(opCode, lhsReg, rhsReg));
+        return true;
+    }
+
+    if (op == "<" || op == "<=" || op == ">" || op == ">=" || op == "==" || op == "!=") {
+        return _GenComparison(node, op, lhs, rhs, value);
+    }
+
+    return _GenArithmetic(node, op, lhs, rhs, value);
+}
+
+// ----------------------------------------------------------------------------
+
+bool
+CpuCodeGen::_GenArithmetic(const CpuNode* node, const std::string& op, CpuValue lhs, CpuValue rhs, CpuValue& value)
+{
+    if (!IsBasic(lhs.type) || !IsBasic(rhs.type) || lhs.type.base == CPU_TYPE_BOOL || rhs.type.base == CPU_TYPE_BOOL) {
+        return _Error(node, "cannot apply " + op + " to " + TypeName(lhs.type, m_program.structs) + " and " +
+            TypeName(rhs.type, m_program.structs));
+    }
+
+    CpuBaseType base = (lhs.type.base == CPU_TYPE_FLOAT || rhs.type.base == CPU_TYPE_FLOAT) ? CPU_TYPE_FLOAT : CPU_TYPE_INT;
+    lhs.type.base = rhs.type.base = base;
+
+    // linear algebra, matrices are column major and a vector is a row on
+    // the left, a column on the right
+    if (op == "*" && (IsMatrix(lhs.type) || IsMatrix(rhs.type)) && !IsScalar(lhs.type) && !IsScalar(rhs.type)) {
+        int lhsRows = IsVector(lhs.type) ? 1 : lhs.type.rows;
+        int lhsColumns = IsVector(lhs.type) ? lhs.type.rows : lhs.type.columns;
+        int rhsRows = rhs.type.rows;
+        int rhsColumns = rhs.type.columns;
+        if (lhsColumns != rhsRows) {
+            return _Error(node, "cannot multiply " + TypeName(lhs.type, m_program.structs) + " by " +
+                TypeName(rhs.type, m_program.structs));
+        }
+
+        std::vector<int> registers;
+        for (int column = 0; column < rhsColumns; column++)
+        {
+            for (int row = 0; row < lhsRows; row++)
+            {
+                int sum = _Emit(STVRCPU_OP_MUL, lhs.registers[row], rhs.registers[column * rhsRows]);
+                for (int k = 1; k < lhsColumns; k++) {
+                    sum = _Emit(STVRCPU_OP_MAD, lhs.registers[k * lhsRows + row], rhs.registers[column * rhsRows + k], sum);
+                }
+                registers.push_back(sum);
+            }
+        }
+
+        CpuType resultType = (lhsRows == 1) ? MakeType(CPU_TYPE_FLOAT, rhsColumns) :
+            (rhsColumns == 1) ? MakeType(CPU_TYPE_FLOAT, lhsRows) : MakeType(CPU_TYPE_FLOAT, lhsRows, rhsColumns);
+        value = _MakeValue(resultType, registers);
+        return true;
+    }
+
+    CpuType resultType;
+    if (IsScalar(lhs.type)) {
+        resultType = rhs.type;
+    }
+    else if (IsScalar(rhs.type) || lhs.type == rhs.type) {
+        resultType = lhs.type;
+    }
+    else {
+        return _Error(node, "cannot apply " + op + " to " + TypeName(lhs.type, m_program.structs) + " and " +
+            TypeName(rhs.type, m_program.structs));
+    }
+
+    int opCode = (op == "+") ? STVRCPU_OP_ADD : (op == "-") ? STVRCPU_OP_SUB : (op == "*") ? STVRCPU_OP_MUL :
+        (op == "/") ? STVRCPU_OP_DIV : STVRCPU_OP_MOD;
+
+    int componentCount = resultType.rows * resultType.columns;
+    std::vector<int> registers(componentCount);
+    for (int componentIdx = 0; componentIdx < componentCount; componentIdx++)
+    {
+        registers[componentIdx] = _Emit(opCode, _Component(lhs, componentIdx), _Component(rhs, componentIdx));
+        if (base == CPU_TYPE_INT && op == "/") {
+            registers[componentIdx] = _Emit(STVRCPU_OP_TRUNC, registers[componentIdx]);
+        }
+    }
+    value = _MakeValue(resultType, registers);
+    return true;
+}
+
+// ----------------------------------------------------------------------------
+
+bool
+CpuCodeGen::_GenComparison(const CpuNode* node, const std::string& op, CpuValue lhs, CpuValue rhs, CpuValue& value)
+{
+    // ints compare with floats as floats
+    if (lhs.type.base != rhs.type.base && lhs.type.base != CPU_TYPE_BOOL && rhs.type.base != CPU_TYPE_BOOL) {
+        lhs.type.base = rhs.type.base = CPU_TYPE_FLOAT;
+    }
+
+    if (op == "==" || op == "!=") {
+        if (lhs.type != rhs.type || IsSampler(lhs.type)) {
+            return _Error(node, "cannot compare " + TypeName(lhs.type, m_program.structs) + " and " +
+                TypeName(rhs.type, m_program.structs));
+        }
+
+        if (lhs.registers.size() == 1 && lhs.type.base != CPU_TYPE_BOOL) {
+            value = _ScalarValue(CPU_TYPE_BOOL, _Emit((op == "==") ? STVRCPU_OP_EQ : STVRCPU_OP_NE, lhs.registers[0], rhs.registers[0]));
+            return true;
+        }
+
+        // masks are NaNs, so bools compare by their bits
+        int allEqual = _ConstantBits(c_AllLanesBits);
+        for (size_t regIdx = 0; regIdx < lhs.registers.size(); regIdx++)
+        {
+            int equal = (lhs.type.base == CPU_TYPE_BOOL) ?
+                _Emit(STVRCPU_OP_NOT, _Emit(STVRCPU_OP_XOR, lhs.registers[regIdx], rhs.registers[regIdx])) :
+                _Emit(STVRCPU_OP_EQ, lhs.registers[regIdx], rhs.registers[regIdx]);
+            allEqual = _Emit(STVRCPU_OP_AND, allEqual, equal);
+        }
+        value = _ScalarValue(CPU_TYPE_BOOL, (op == "==") ? allEqual : _Emit(STVRCPU_OP_NOT, allEqual));
+        return true;
+    }
+
+    if (!IsScalar(lhs.type) || !IsScalar(rhs.type) || lhs.type.base == CPU_TYPE_BOOL || rhs.type.base == CPU_TYPE_BOOL) {
+        return _Error(node, "cannot apply " + op + " to " + TypeName(lhs.type, m_program.structs) + " and " +
+            TypeName(rhs.type, m_program.structs));
+    }
+
+    int opCode = (op == "<") ? STVRCPU_OP_LT : (op == "<=") ? STVRCPU_OP_LE : (op == ">") ? STVRCPU_OP_GT : STVRCPU_OP_GE;
+    value = _ScalarValue(CPU_TYPE_BOOL, _Emit(opCode, lhs.registers[0], rhs.registers[0]));
+    return true;
+}
+
+// ----------------------------------------------------------------------------
+
+bool
+CpuCodeGen::_GenAssign(const CpuNode* node, CpuValue& value)
+{
+    const std::string& op = node->text;
+    CpuLValue lvalue;
+    CpuValue rhs;
+
+    if (op == "=") {
+        if (!_GenExpression(node->children[1], rhs) || !_GenLValue(node->children[0], lvalue) ||
+            !_Convert(node, rhs, lvalue.type, value))
+        {
+            return false;
+        }
+        _Store(lvalue, value);
+        return true;
+    }
+
+    CpuValue current;
+    CpuValue result;
+    if (!_GenLValue(node->children[0], lvalue) || !_Load(lvalue, current) || !_GenExpression(node->children[1], rhs) ||
+        !_GenArithmetic(node, op.substr(0, 1), current, rhs, result) || !_Convert(node, result, lvalue.type, value))
+    {
+        return false;
+    }
+    _Store(lvalue, value);
+    return true;
+}
+
+// ----------------------------------------------------------------------------
+
+bool
+CpuCodeGen::_GenTernary(const CpuNode* node, CpuValue& value)
+{
+    CpuValue condition;
+    int conditionReg;
+    if (!_GenExpression(node->children[0], condition) || !_ToBoolScalar(node->children[0], condition, conditionReg)) {
+        return false;
+    }
+
+    if (_IsConstant(conditionReg)) {
+        return _GenExpression(node->children[_ConstantValue(conditionReg) ? 1 : 2], value);
+    }
+
+    // Both sides run for every lane.  Stores in them are masked like the
+    // branches of an if.
+    CpuValue ifTrue, ifFalse;
+    bool succeeded;
+    if (HasSideEffects(node->children[1]) || HasSideEffects(node->children[2])) {
+        int savedMask = m_mask;
+        int savedVersion = m_maskVersion;
+
+        m_mask = (savedMask == c_NoRegister) ? conditionReg : _Emit(STVRCPU_OP_AND, savedMask, conditionReg);
+        m_maskVersion = ++m_versionCount;
+        succeeded = _GenExpression(node->children[1], ifTrue);
+
+        m_mask = (savedMask == c_NoRegister) ? _Emit(STVRCPU_OP_NOT, conditionReg) : _Emit(STVRCPU_OP_ANDNOT, conditionReg, savedMask);
+        m_maskVersion = ++m_versionCount;
+        succeeded = succeeded && _GenExpression(node->children[2], ifFalse);
+
+        m_mask = savedMask;
+        m_maskVersion = savedVersion;
+    }
+    else {
+        succeeded = _GenExpression(node->children[1], ifTrue) && _GenExpression(node->children[2], ifFalse);
+    }
+    if (!succeeded) {
+        return false;
+    }
+
+    if (ifTrue.type != ifFalse.type) {
+        if (ifTrue.type.base == CPU_TYPE_INT) {
+            succeeded = _Convert(node, ifTrue, ifFalse.type, ifTrue);
+        }
+        else {
+            succeeded = _Convert(node, ifFalse, ifTrue.type, ifFalse);
+        }
+        if (!succeeded) {
+            return false;
+        }
+    }
+    if (IsSampler(ifTrue.type) || ifTrue.type.base == CPU_TYPE_VOID) {
+        return _Error(node, "cannot choose between " + TypeName(ifTrue.type, m_program.structs));
+    }
+
+    value = ifTrue;
+    for (size_t regIdx = 0; regIdx < ifTrue.registers.size(); regIdx++) {
+        value.registers[regIdx] = _Emit(STVRCPU_OP_SELECT, conditionReg, ifTrue.registers[regIdx], ifFalse.registers[regIdx]);
+    }
+    return true;
+}
+
+// ----------------------------------------------------------------------------
+
+bool
+CpuCodeGen::_GenConstruct(const CpuNode* node, CpuValue& value)
+{
+    const CpuType& type = node->type;
+
+    std::vector<CpuValue> arguments(node->children.size());
+    for (size_t argumentIdx = 0; argumentIdx < node->children.size(); argumentIdx++) {
+        if (!_GenExpression(node->children[argumentIdx], arguments[argumentIdx])) {
+            return false;
+        }
+    }
+
+    std::vector<int> registers;
+
+    // arrays and structs take one argument per element or field
+    if (type.arraySize > 0 || type.base == CPU_TYPE_STRUCT) {
+        std::vector<CpuType> memberTypes;
+        if (type.arraySize > 0) {
+            memberTypes.assign(type.arraySize, ElementType(type));
+        }
+        else {
+            const CpuStruct& structDef = m_program.structs[type.structIdx];
+            for (size_t fieldIdx = 0; fieldIdx < structDef.fields.size(); fieldIdx++) {
+                memberTypes.push_back(structDef.fields[fieldIdx].type);
+            }
+        }
+
+        if (arguments.size() != memberTypes.size()) {
+            return _Error(node, "wrong number of arguments to construct " + TypeName(type, m_program.structs));
+        }
+        for (size_t memberIdx = 0; memberIdx < memberTypes.size(); memberIdx++)
+        {
+            CpuValue member;
+            if (!_Convert(node->children[memberIdx], arguments[memberIdx], memberTypes[memberIdx], member)) {
+                return false;
+            }
+            registers.insert(registers.end(), member.registers.begin(), member.registers.end());
+        }
+        value = _MakeValue(type, registers);
+        return true;
+    }
+
+    if (!IsBasic(type) || arguments.empty()) {
+        return _Error(node, "cannot construct " + TypeName(type, m_program.structs));
+    }
+    for (size_t argumentIdx = 0; argumentIdx < arguments.size(); argumentIdx++) {
+        if (!IsBasic(arguments[argumentIdx].type)) {
+            return _Error(node, "cannot construct " + TypeName(type, m_program.structs) + " from " +
+                TypeName(arguments[argumentIdx].type, m_program.structs));
+        }
+    }
+
+    const int componentCount = type.rows * type.columns;
+    const CpuValue& first = arguments[0];
+
+    if (arguments.size() == 1 && IsScalar(first.type)) {
+        // a scalar fills a vector, or the diagonal of a matrix
+        int component = _ConvertComponent(first.registers[0], first.type.base, type.base);
+        for (int componentIdx = 0; componentIdx < componentCount; componentIdx++)
+        {
+            bool onDiagonal = (componentIdx / type.rows) == (componentIdx % type.rows);
+            registers.push_back((IsMatrix(type) && !onDiagonal) ? _Constant(0.f) : component);
+        }
+    }
+    else if (arguments.size() == 1 && IsMatrix(first.type) && IsMatrix(type)) {
+        // from a smaller matrix the rest is identity, a bigger one is cut
+        for (int column = 0; column < type.columns; column++)
+        {
+            for (int row = 0; row < type.rows; row++)
+            {
+                if (column < first.type.columns && row < first.type.rows) {
+                    registers.push_back(first.registers[column * first.type.rows + row]);
+                }
+                else {
+                    registers.push_back(_Constant((column == row) ? 1.f : 0.f));
+                }
+            }
+        }
+    }
+    else {
+        for (size_t argumentIdx = 0; argumentIdx < arguments.size() && int(registers.size()) < componentCount; argumentIdx++)
+        {
+            const CpuValue& argument = arguments[argumentIdx];
+            for (size_t regIdx = 0; regIdx < argument.registers.size() && int(registers.size()) < componentCount; regIdx++) {
+                registers.push_back(_ConvertComponent(argument.registers[regIdx], argument.type.base, type.base));
+            }
+        }
+        if (int(registers.size()) < componentCount) {
+            return _Error(node, "not enough components to construct " + TypeName(type, m_program.structs));
+        }
+    }
+
+    value = _MakeValue(type, registers);
+    return true;
+}
+
+// ----------------------------------------------------------------------------
+
+bool
+CpuCodeGen::_GenCall(const CpuNode* node, CpuValue& value)
+{
+    std::vector<CpuValue> arguments(node->children.size());
+    for (size_t argumentIdx = 0; argumentIdx < node->children.size(); argumentIdx++) {
+        if (!_GenExpression(node->children[argumentIdx], arguments[argumentIdx])) {
+            return false;
+        }
+    }
+
+    // the toy's functions first: an exact match, else one the arguments
+    // convert to
+    const CpuFunction* exactMatch = NULL;
+    const CpuFunction* convertedMatch = NULL;
+    bool nameFound = false;
+    for (size_t functionIdx = 0; functionIdx < m_program.functions.size(); functionIdx++)
+    {
+        const CpuFunction& function = *m_program.functions[functionIdx];
+        if (function.name != node->text) {
+            continue;
+        }
+        nameFound = true;
+        if (function.parameters.size() != arguments.size()) {
+            continue;
+        }
+
+        bool exact = true;
+        bool converts = true;
+        for (size_t argumentIdx = 0; argumentIdx < arguments.size(); argumentIdx++)
+        {
+            const CpuType& parameterType = function.parameters[argumentIdx].type;
+            CpuType argumentType = arguments[argumentIdx].type;
+            if (argumentType == parameterType) {
+                continue;
+            }
+            exact = false;
+            argumentType.base = CPU_TYPE_FLOAT;
+            converts = converts && arguments[argumentIdx].type.base == CPU_TYPE_INT && argumentType == parameterType &&
+                !function.parameters[argumentIdx].copiesOut;
+        }
+
+        if (exact && !exactMatch) {
+            exactMatch = &function;
+        }
+        else if (converts && !convertedMatch) {
+            convertedMatch = &function;
+        }
+    }
+
+    if (exactMatch || convertedMatch) {
+        return _InlineFunction(node, exactMatch ? *exactMatch : *convertedMatch, arguments, value);
+    }
+
+    bool builtinFound = false;
+    if (!_GenBuiltin(node, arguments, value, builtinFound)) {
+        return false;
+    }
+    if (builtinFound) {
+        return true;
+    }
+
+    std::string argumentTypes;
+    for (size_t argumentIdx = 0; argumentIdx < arguments.size(); argumentIdx++) {
+        argumentTypes += (argumentIdx ? ", " : "") + TypeName(arguments[argumentIdx].type, m_program.structs);
+    }
+    return _Error(node, nameFound ? "no " + node->text + " takes (" + argumentTypes + ")" :
+        "unknown function " + node->text + "(" + argumentTypes + ")");
+}
+
+// ----------------------------------------------------------------------------
+
+// Calls are inlined: the parameters become variables of a new frame, and the
+// return value registers are handed back.
+bool
+CpuCodeGen::_InlineFunction(const CpuNode* node, const CpuFunction& function, const std::vector<CpuValue>& arguments, CpuValue& value)
+{
+    if (m_inlining.count(&function)) {
+        return _Error(node, "recursion is not supported (" + function.name + ")");
+    }
+
+    FunctionContext context;
+    context.function = &function;
+    context.returnType = function.returnType;
+    context.returnRegisters.resize(TypeSlots(function.returnType, m_program.structs));
+    for (size_t regIdx = 0; regIdx < context.returnRegisters.size(); regIdx++) {
+        context.returnRegisters[regIdx] = _AllocRegisters(1);
+    }
+    context.returnVersion = m_maskVersion;
+    context.liveMask = c_NoRegister;
+    context.loopBase = m_loops.size();
+
+    int calleeTop = m_nextRegister;
+    size_t savedFrameStart = m_frameStart;
+    _PushScope();
+    m_frameStart = m_scopes.size() - 1;
+
+    std::vector<CpuVariable> parameters;
+    for (size_t parameterIdx = 0; parameterIdx < function.parameters.size(); parameterIdx++)
+    {
+        const CpuParameter& parameter = function.parameters[parameterIdx];
+        const CpuValue& argument = arguments[parameterIdx];
+
+        CpuVariable variable;
+        variable.type = parameter.type;
+        variable.maskVersion = m_maskVersion;
+        variable.readOnly = parameter.isConst;
+        variable.samplerChannel = -1;
+
+        if (IsSampler(parameter.type)) {
+            if (argument.samplerChannel < 0) {
+                return _Error(node, "samplers can only be passed on as they are");
+            }
+            variable.samplerChannel = argument.samplerChannel;
+            variable.readOnly = true;
+        }
+        else if (parameter.copiesIn && !parameter.copiesOut && !IsWrittenIn(parameter.name, function.body, m_program)) {
+            // never written, so the argument's registers will do
+            CpuValue converted;
+            if (!_Convert(node, argument, parameter.type, converted)) {
+                return false;
+            }
+            variable.registers = converted.registers;
+        }
+        else {
+            CpuValue converted;
+            if (parameter.copiesIn && !_Convert(node, argument, parameter.type, converted)) {
+                return false;
+            }
+            variable.registers.resize(TypeSlots(parameter.type, m_program.structs));
+            for (size_t regIdx = 0; regIdx < variable.registers.size(); regIdx++)
+            {
+                variable.registers[regIdx] = _AllocRegisters(1);
+                _EmitTo(STVRCPU_OP_MOV, variable.registers[regIdx], parameter.copiesIn ? converted.registers[regIdx] : _Constant(0.f));
+            }
+        }
+
+        parameters.push_back(variable);
+        if (!parameter.name.empty()) {
+            _Declare(parameter.name, variable);
+        }
+    }
+
+    int savedMask = m_mask;
+    int savedVersion = m_maskVersion;
+    int savedJumps = m_jumpCount;
+    int savedReturns = m_returnCount;
+
+    // returns inside branches need a mask of their own
+    if (HasNestedReturn(function.body, false)) {
+        context.liveMask = _AllocRegisters(1);
+        _EmitTo(STVRCPU_OP_MOV, context.liveMask, _CurrentMask());
+        m_mask = context.liveMask;
+        m_maskVersion = ++m_versionCount;
+    }
+
+    m_functions.push_back(context);
+    m_inlining.insert(&function);
+    bool succeeded = _GenBlock(function.body, true);
+    m_inlining.erase(&function);
+    m_functions.pop_back();
+
+    m_mask = savedMask;
+    m_maskVersion = savedVersion;
+    m_deadCode = false;
+    m_jumpCount = savedJumps;
+    m_returnCount = savedReturns;
+
+    _PopScope();
+    m_frameStart = savedFrameStart;
+
+    // out and inout parameters go back to the caller's variables
+    for (size_t parameterIdx = 0; parameterIdx < function.parameters.size() && succeeded; parameterIdx++)
+    {
+        const CpuParameter& parameter = function.parameters[parameterIdx];
+        if (!parameter.copiesOut) {
+            continue;
+        }
+
+        CpuLValue lvalue;
+        CpuValue result;
+        succeeded = _GenLValue(node->children[parameterIdx], lvalue) &&
+            _Convert(node->children[parameterIdx], _MakeValue(parameter.type, parameters[parameterIdx].registers), lvalue.type, result);
+        if (succeeded) {
+            _Store(lvalue, result);
+        }
+    }
+
+    m_nextRegister = calleeTop;
+    value = _MakeValue(function.returnType, context.returnRegisters);
+    return succeeded;
+}
+
+// ----------------------------------------------------------------------------
+
+// Built-ins that are one instruction per component.  INT as the result base
+// means int when every argument is int, float otherwise.
+struct CpuComponentBuiltin
+{
+    const char*     name;
+    size_t          argumentCount;
+    int             op;
+    CpuBaseType     resultBase;
+};
+
+static const CpuComponentBuiltin c_ComponentBuiltins[] =
+{
+    { "sin", 1, STVRCPU_OP_SIN, CPU_TYPE_FLOAT },
+    { "cos", 1, STVRCPU_OP_COS, CPU_TYPE_FLOAT },
+    { "tan", 1, STVRCPU_OP_TAN, CPU_TYPE_FLOAT },
+    { "asin", 1, STVRCPU_OP_ASIN, CPU_TYPE_FLOAT },
+    { "acos", 1, STVRCPU_OP_ACOS, CPU_TYPE_FLOAT },
+    { "atan", 1, STVRCPU_OP_ATAN, CPU_TYPE_FLOAT },
+    { "atan", 2, STVRCPU_OP_ATAN2, CPU_TYPE_FLOAT },
+    { "pow", 2, STVRCPU_OP_POW, CPU_TYPE_FLOAT },
+    { "exp", 1, STVRCPU_OP_EXP, CPU_TYPE_FLOAT },
+    { "log", 1, STVRCPU_OP_LOG, CPU_TYPE_FLOAT },
+    { "exp2", 1, STVRCPU_OP_EXP2, CPU_TYPE_FLOAT },
+    { "log2", 1, STVRCPU_OP_LOG2, CPU_TYPE_FLOAT },
+    { "sqrt", 1, STVRCPU_OP_SQRT, CPU_TYPE_FLOAT },
+    { "inversesqrt", 1, STVRCPU_OP_RSQRT, CPU_TYPE_FLOAT },
+    { "abs", 1, STVRCPU_OP_ABS, CPU_TYPE_INT },
+    { "sign", 1, STVRCPU_OP_SIGN, CPU_TYPE_INT },
+    { "floor", 1, STVRCPU_OP_FLOOR, CPU_TYPE_FLOAT },
+    { "ceil", 1, STVRCPU_OP_CEIL, CPU_TYPE_FLOAT },
+    { "fract", 1, STVRCPU_OP_FRACT, CPU_TYPE_FLOAT },
+    { "trunc", 1, STVRCPU_OP_TRUNC, CPU_TYPE_FLOAT },
+    { "round", 1, STVRCPU_OP_ROUND, CPU_TYPE_FLOAT },
+    { "roundEven", 1, STVRCPU_OP_ROUND, CPU_TYPE_FLOAT },
+    { "mod", 2, STVRCPU_OP_MOD, CPU_TYPE_INT },
+    { "min", 2, STVRCPU_OP_MIN, CPU_TYPE_INT },
+    { "max", 2, STVRCPU_OP_MAX, CPU_TYPE_INT },
+    { "step", 2, STVRCPU_OP_STEP, CPU_TYPE_FLOAT },
+    { "dFdx", 1, STVRCPU_OP_DFDX, CPU_TYPE_FLOAT },
+    { "dFdy", 1, STVRCPU_OP_DFDY, CPU_TYPE_FLOAT },
+    { "lessThan", 2, STVRCPU_OP_LT, CPU_TYPE_BOOL },
+    { "lessThanEqual", 2, STVRCPU_OP_LE, CPU_TYPE_BOOL },
+    { "greaterThan", 2, STVRCPU_OP_GT, CPU_TYPE_BOOL },
+    { "greaterThanEqual", 2, STVRCPU_OP_GE, CPU_TYPE_BOOL },
+    { "equal", 2, STVRCPU_OP_EQ, CPU_TYPE_BOOL },
+    { "notEqual", 2, STVRCPU_OP_NE, CPU_TYPE_BOOL },
+};
+
+// ----------------------------------------------------------------------------
+
+static std::vector<CpuValue>
+Arguments(const CpuValue& a, const CpuValue& b)
+{
+    std::vector<CpuValue> arguments;
+    arguments.push_back(a);
+    arguments.push_back(b);
+    return arguments;
+}
+
+// ----------------------------------------------------------------------------
+
+static std::vector<CpuValue>
+Arguments(const CpuValue& a, const CpuValue& b, const CpuValue& c)
+{
+    std::vector<CpuValue> arguments = Arguments(a, b);
+    arguments.push_back(c);
+    return arguments;
+}
+
+// ----------------------------------------------------------------------------
+
+bool
+CpuCodeGen::_GenComponentWise(const CpuNode* node, const std::vector<CpuValue>& arguments, int op, CpuBaseType resultBase, CpuValue& value)
+{
+    bool allInt = true;
+    int componentCount = 1;
+    for (size_t argumentIdx = 0; argumentIdx < arguments.size(); argumentIdx++)
+    {
+        const CpuType& type = arguments[argumentIdx].type;
+        if (!IsBasic(type) || IsMatrix(type) || type.base == CPU_TYPE_BOOL) {
+            return _Error(node, "cannot call " + node->text + " with " + TypeName(type, m_program.structs));
+        }
+        allInt = allInt && type.base == CPU_TYPE_INT;
+        componentCount = std::max(componentCount, type.rows);
+    }
+    for (size_t argumentIdx = 0; argumentIdx < arguments.size(); argumentIdx++)
+    {
+        int rows = arguments[argumentIdx].type.rows;
+        if (rows != 1 && rows != componentCount) {
+            return _Error(node, "mismatched vector sizes in " + node->text);
+        }
+    }
+
+    std::vector<int> registers(componentCount);
+    for (int componentIdx = 0; componentIdx < componentCount; componentIdx++)
+    {
+        registers[componentIdx] = _Emit(op, _Component(arguments[0], componentIdx),
+            (arguments.size() > 1) ? _Component(arguments[1], componentIdx) : c_NoRegister,
+            (arguments.size() > 2) ? _Component(arguments[2], componentIdx) : c_NoRegister);
+    }
+
+    if (resultBase == CPU_TYPE_INT && !allInt) {
+        resultBase = CPU_TYPE_FLOAT;
+    }
+    value = _MakeValue(MakeType(resultBase, componentCount), registers);
+    return true;
+}
+
+// ----------------------------------------------------------------------------
+
+bool
+CpuCodeGen::_GenBuiltin(const CpuNode* node, std::vector<CpuValue>& arguments, CpuValue& value, bool& found)
+{
+    const std::string& name = node->text;
+    const size_t argumentCount = arguments.size();
+    found = true;
+
+    if (name == "texture2D" || name == "texture2DLod" || name == "texture2DProj" || name == "texture2DProjLod" ||
+        name == "textureCube" || name == "textureCubeLod" || name == "texture" || name == "textureLod")
+    {
+        if (argumentCount < 2 || !IsSampler(arguments[0].type)) {
+            return _Error(node, name + " expects a sampler and coordinates");
+        }
+        bool cube = (arguments[0].type.base == CPU_TYPE_SAMPLER_CUBE);
+        if ((cube && name.find("2D") != std::string::npos) || (!cube && name.find("Cube") != std::string::npos)) {
+            return _Error(node, name + " cannot sample " + TypeName(arguments[0].type, m_program.structs));
+        }
+        return _GenTexture(node, arguments, cube, name.find("Proj") != std::string::npos, value);
+    }
+
+    for (size_t builtinIdx = 0; builtinIdx < sizeof(c_ComponentBuiltins) / sizeof(c_ComponentBuiltins[0]); builtinIdx++)
+    {
+        const CpuComponentBuiltin& builtin = c_ComponentBuiltins[builtinIdx];
+        if (name == builtin.name && argumentCount == builtin.argumentCount) {
+            return _GenComponentWise(node, arguments, builtin.op, builtin.resultBase, value);
+        }
+    }
+
+    const CpuValue zero = _ScalarValue(CPU_TYPE_FLOAT, _Constant(0.f));
+    const CpuValue one = _ScalarValue(CPU_TYPE_FLOAT, _Constant(1.f));
+
+    if ((name == "radians" || name == "degrees") && argumentCount == 1) {
+        CpuValue scale = _ScalarValue(CPU_TYPE_FLOAT, _Constant((name == "radians") ? 0.017453292519943295f : 57.295779513082321f));
+        return _GenComponentWise(node, Arguments(arguments[0], scale), STVRCPU_OP_MUL, CPU_TYPE_FLOAT, value);
+    }
+
+    if (name == "clamp" && argumentCount == 3) {
+        CpuValue low;
+        return _GenComponentWise(node, Arguments(arguments[0], arguments[1]), STVRCPU_OP_MAX, CPU_TYPE_INT, low) &&
+            _GenComponentWise(node, Arguments(low, arguments[2]), STVRCPU_OP_MIN, CPU_TYPE_INT, value);
+    }
+
+    if (name == "mix" && argumentCount == 3) {
+        if (arguments[2].type.base == CPU_TYPE_BOOL) {
+            // picks y where the selector is set
+            const CpuValue& selector = arguments[2];
+            CpuValue x, y;
+            if (!_Convert(node, arguments[0], MakeType(CPU_TYPE_FLOAT, selector.type.rows), x) ||
+                !_Convert(node, arguments[1], MakeType(CPU_TYPE_FLOAT, selector.type.rows), y))
+            {
+                return false;
+            }
+            value = x;
+            for (size_t regIdx = 0; regIdx < x.registers.size(); regIdx++) {
+                value.registers[regIdx] = _Emit(STVRCPU_OP_SELECT, selector.registers[regIdx], y.registers[regIdx], x.registers[regIdx]);
+            }
+            return true;
+        }
+
+        CpuValue difference;
+        return _GenComponentWise(node, Arguments(arguments[1], arguments[0]), STVRCPU_OP_SUB, CPU_TYPE_FLOAT, difference) &&
+            _GenComponentWise(node, Arguments(difference, arguments[2], arguments[0]), STVRCPU_OP_MAD, CPU_TYPE_FLOAT, value);
+    }
+
+    if (name == "smoothstep" && argumentCount == 3) {
+        CpuValue offset, range, t, square, falloff;
+        return _GenComponentWise(node, Arguments(arguments[2], arguments[0]), STVRCPU_OP_SUB, CPU_TYPE_FLOAT, offset) &&
+            _GenComponentWise(node, Arguments(arguments[1], arguments[0]), STVRCPU_OP_SUB, CPU_TYPE_FLOAT, range) &&
+            _GenComponentWise(node, Arguments(offset, range), STVRCPU_OP_DIV, CPU_TYPE_FLOAT, t) &&
+            _GenComponentWise(node, Arguments(t, zero), STVRCPU_OP_MAX, CPU_TYPE_FLOAT, t) &&
+            _GenComponentWise(node, Arguments(t, one), STVRCPU_OP_MIN, CPU_TYPE_FLOAT, t) &&
+            _GenComponentWise(node, Arguments(t, t), STVRCPU_OP_MUL, CPU_TYPE_FLOAT, square) &&
+            _GenComponentWise(node, Arguments(t, _ScalarValue(CPU_TYPE_FLOAT, _Constant(-2.f)), _ScalarValue(CPU_TYPE_FLOAT, _Constant(3.f))),
+                STVRCPU_OP_MAD, CPU_TYPE_FLOAT, falloff) &&
+            _GenComponentWise(node, Arguments(square, falloff), STVRCPU_OP_MUL, CPU_TYPE_FLOAT, value);
+    }
+
+    if (name == "fwidth" && argumentCount == 1) {
+        CpuValue dx, dy;
+        std::vector<CpuValue> argument(1);
+        argument[0] = arguments[0];
+        if (!_GenComponentWise(node, argument, STVRCPU_OP_DFDX, CPU_TYPE_FLOAT, dx) ||
+            !_GenComponentWise(node, argument, STVRCPU_OP_DFDY, CPU_TYPE_FLOAT, dy))
+        {
+            return false;
+        }
+        argument[0] = dx;
+        _GenComponentWise(node, argument, STVRCPU_OP_ABS, CPU_TYPE_FLOAT, dx);
+        argument[0] = dy;
+        _GenComponentWise(node, argument, STVRCPU_OP_ABS, CPU_TYPE_FLOAT, dy);
+        return _GenComponentWise(node, Arguments(dx, dy), STVRCPU_OP_ADD, CPU_TYPE_FLOAT, value);
+    }
+
+    if (name == "any" || name == "all" || name == "not") {
+        if (argumentCount != 1 || !IsVector(arguments[0].type) || arguments[0].type.base != CPU_TYPE_BOOL) {
+            return _Error(node, name + " expects a bvec");
+        }
+        const CpuValue& vector = arguments[0];
+        if (name == "not") {
+            value = vector;
+            for (size_t regIdx = 0; regIdx < vector.registers.size(); regIdx++) {
+                value.registers[regIdx] = _Emit(STVRCPU_OP_NOT, vector.registers[regIdx]);
+            }
+            return true;
+        }
+
+        int result = vector.registers[0];
+        for (size_t regIdx = 1; regIdx < vector.registers.size(); regIdx++) {
+            result = _Emit((name == "any") ? STVRCPU_OP_OR : STVRCPU_OP_AND, result, vector.registers[regIdx]);
+        }
+        value = _ScalarValue(CPU_TYPE_BOOL, result);
+        return true;
+    }
+
+    if (name == "matrixCompMult" || name == "transpose") {
+        if (argumentCount != ((name == "transpose") ? 1u : 2u) || !IsMatrix(arguments[0].type) ||
+            (argumentCount == 2 && arguments[0].type != arguments[1].type))
+        {
+            return _Error(node, name + " expects matrices");
+        }
+        const CpuType& type = arguments[0].type;
+        if (name == "transpose") {
+            std::vector<int> registers;
+            for (int column = 0; column < type.rows; column++) {
+                for (int row = 0; row < type.columns; row++) {
+                    registers.push_back(arguments[0].registers[row * type.rows + column]);
+                }
+            }
+            value = _MakeValue(MakeType(CPU_TYPE_FLOAT, type.columns, type.rows), registers);
+            return true;
+        }
+        value = arguments[0];
+        for (size_t regIdx = 0; regIdx < value.registers.size(); regIdx++) {
+            value.registers[regIdx] = _Emit(STVRCPU_OP_MUL, arguments[0].registers[regIdx], arguments[1].registers[regIdx]);
+        }
+        return true;
+    }
+
+    // the geometric functions work on float vectors of one size
+    if (name == "length" || name == "distance" || name == "dot" || name == "cross" || name == "normalize" ||
+        name == "faceforward" || name == "reflect" || name == "refract")
+    {
+        size_t vectorCount = (name == "refract") ? 2 : argumentCount;
+        for (size_t argumentIdx = 0; argumentIdx < argumentCount; argumentIdx++)
+        {
+            bool expectScalar = (argumentIdx >= vectorCount);
+            if (!_ToFloat(node, arguments[argumentIdx]) || IsMatrix(arguments[argumentIdx].type) ||
+                (expectScalar && !IsScalar(arguments[argumentIdx].type)) ||
+                (!expectScalar && arguments[argumentIdx].type != arguments[0].type))
+            {
+                return _Error(node, "cannot call " + name + " with " + TypeName(arguments[argumentIdx].type, m_program.structs));
+            }
+        }
+
+        const CpuValue& a = arguments[0];
+        if (name == "length" && argumentCount == 1) {
+            value = _ScalarValue(CPU_TYPE_FLOAT, (a.registers.size() == 1) ? _Emit(STVRCPU_OP_ABS, a.registers[0]) :
+                _Emit(STVRCPU_OP_SQRT, _Dot(a, a)));
+            return true;
+        }
+        if (name == "normalize" && argumentCount == 1) {
+            return _GenComponentWise(node, Arguments(a, _ScalarValue(CPU_TYPE_FLOAT, _Emit(STVRCPU_OP_RSQRT, _Dot(a, a)))),
+                STVRCPU_OP_MUL, CPU_TYPE_FLOAT, value);
+        }
+        if (name == "dot" && argumentCount == 2) {
+            value = _ScalarValue(CPU_TYPE_FLOAT, _Dot(a, arguments[1]));
+            return true;
+        }
+        if (name == "distance" && argumentCount == 2) {
+            CpuValue difference;
+            _GenComponentWise(node, Arguments(a, arguments[1]), STVRCPU_OP_SUB, CPU_TYPE_FLOAT, difference);
+            value = _ScalarValue(CPU_TYPE_FLOAT, _Emit(STVRCPU_OP_SQRT, _Dot(difference, difference)));
+            return true;
+        }
+        if (name == "cross" && argumentCount == 2 && a.registers.size() == 3) {
+            const std::vector<int>& u = a.registers;
+            const std::vector<int>& v = arguments[1].registers;
+            std::vector<int> registers(3);
+            for (int componentIdx = 0; componentIdx < 3; componentIdx++)
+            {
+                int next = (componentIdx + 1) % 3;
+                int last = (componentIdx + 2) % 3;
+                registers[componentIdx] = _Emit(STVRCPU_OP_SUB, _Emit(STVRCPU_OP_MUL, u[next], v[last]), _Emit(STVRCPU_OP_MUL, u[last], v[next]));
+            }
+            value = _MakeValue(a.type, registers);
+            return true;
+        }
+        if (name == "faceforward" && argumentCount == 3) {
+            int facing = _Emit(STVRCPU_OP_LT, _Dot(arguments[2], arguments[1]), zero.registers[0]);
+            value = a;
+            for (size_t regIdx = 0; regIdx < a.registers.size(); regIdx++) {
+                value.registers[regIdx] = _Emit(STVRCPU_OP_SELECT, facing, a.registers[regIdx], _Emit(STVRCPU_OP_NEG, a.registers[regIdx]));
+            }
+            return true;
+        }
+        if (name == "reflect" && argumentCount == 2) {
+            // I - 2 * dot(N, I) * N
+            const CpuValue& normal = arguments[1];
+            CpuValue scale = _ScalarValue(CPU_TYPE_FLOAT, _Emit(STVRCPU_OP_MUL, _Dot(normal, a), _Constant(-2.f)));
+            return _GenComponentWise(node, Arguments(normal, scale, a), STVRCPU_OP_MAD, CPU_TYPE_FLOAT, value);
+        }
+        if (name == "refract" && argumentCount == 3) {
+            // k = 1 - eta^2 * (1 - dot(N, I)^2), and no ray at all when k < 0
+            const CpuValue& normal = arguments[1];
+            int eta = arguments[2].registers[0];
+            int cosine = _Dot(normal, a);
+            int k = _Emit(STVRCPU_OP_SUB, _Constant(1.f), _Emit(STVRCPU_OP_MUL, _Emit(STVRCPU_OP_MUL, eta, eta),
+                _Emit(STVRCPU_OP_SUB, _Constant(1.f), _Emit(STVRCPU_OP_MUL, cosine, cosine))));
+            int scale = _Emit(STVRCPU_OP_MAD, eta, cosine, _Emit(STVRCPU_OP_SQRT, _Emit(STVRCPU_OP_MAX, k, _Constant(0.f))));
+            int refracts = _Emit(STVRCPU_OP_GE, k, _Constant(0.f));
+            value = a;
+            for (size_t regIdx = 0; regIdx < a.registers.size(); regIdx++)
+            {
+                int ray = _Emit(STVRCPU_OP_SUB, _Emit(STVRCPU_OP_MUL, eta, a.registers[regIdx]), _Emit(STVRCPU_OP_MUL, scale, normal.registers[regIdx]));
+                value.registers[regIdx] = _Emit(STVRCPU_OP_SELECT, refracts, ray, _Constant(0.f));
+            }
+            return true;
+        }
+        return _Error(node, "wrong number of arguments to " + name);
+    }
+
+    found = false;
+    return true;
+}
+
+// ----------------------------------------------------------------------------
+
+bool
+CpuCodeGen::_GenTexture(const CpuNode* node, const std::vector<CpuValue>& arguments, bool cube, bool projective, CpuValue& value)
+{
+    const CpuValue& coordinates = arguments[1];
+    int coordinateCount = cube ? 3 : 2;
+    bool validCoordinates = IsVector(coordinates.type) && coordinates.type.base != CPU_TYPE_BOOL &&
+        (projective ? (coordinates.type.rows == 3 || coordinates.type.rows == 4) : coordinates.type.rows == coordinateCount);
+    if (!validCoordinates) {
+        return _Error(node, "cannot sample with " + TypeName(coordinates.type, m_program.structs) + " coordinates");
+    }
+    if (arguments[0].samplerChannel < 0) {
+        return _Error(node, "unknown sampler");
+    }
+
+    // the bias or lod argument is dropped, the CPU textures have one level
+    int s = coordinates.registers[0];
+    int t = coordinates.registers[1];
+    if (projective) {
+        int q = coordinates.registers.back();
+        s = _Emit(STVRCPU_OP_DIV, s, q);
+        t = _Emit(STVRCPU_OP_DIV, t, q);
+    }
+
+    int dst = _AllocRegisters(4);
+    _EmitTo(cube ? STVRCPU_OP_TEXCUBE : STVRCPU_OP_TEX2D, dst, s, t, cube ? coordinates.registers[2] : c_NoRegister);
+    m_code.back().imm = arguments[0].samplerChannel;
+
+    std::vector<int> registers;
+    for (int componentIdx = 0; componentIdx < 4; componentIdx++) {
+        registers.push_back(dst + componentIdx);
+    }
+    value = _MakeValue(MakeType(CPU_TYPE_FLOAT, 4), registers);
+    return true;
+}
+
+// ----------------------------------------------------------------------------
+
+int
+CpuCodeGen::_Dot(const CpuValue& lhs, const CpuValue& rhs)
+{
+    int sum = _Emit(STVRCPU_OP_MUL, lhs.registers[0], rhs.registers[0]);
+    for (size_t regIdx = 1; regIdx < lhs.registers.size(); regIdx++) {
+        sum = _Emit(STVRCPU_OP_MAD, lhs.registers[regIdx], rhs.registers[regIdx], sum);
+    }
+    return sum;
+}
+
+// ''''''''''''''''''''''''''''''''''''''''''''''''''''''''''''''''''''''''''''
+// STVRCpuCompiler
+// ,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,
+
+STVRCpuCompiler::STVRCpuCompiler(const std::string& shaderName, const std::vector<std::string>& sourceStringNames) :
+m_shaderName(shaderName),
+m_sourceStringNames(sourceStringNames)
+{
+}
+
+// ----------------------------------------------------------------------------
+
+STVRCpuCompiler::~STVRCpuCompiler()
+{
+}
+
+// ----------------------------------------------------------------------------
+
+bool
+STVRCpuCompiler::Compile(const std::string& shaderSource, STVRCpuKernel& kernel)
+{
+    CpuTokenList tokens;
+    CpuPreprocessor preprocessor(m_shaderName, m_sourceStringNames);
+    if (!preprocessor.Run(shaderSource, tokens)) {
+        return false;
+    }
+
+    CpuProgram program;
+    CpuParser parser(tokens, m_shaderName, m_sourceStringNames, program);
+    if (!parser.Run()) {
+        return false;
+    }
+
+    CpuCodeGen codeGen(program, m_shaderName, m_sourceStringNames);
+    return codeGen.Run(kernel);
+}
@@ -0,0 +1,47 @@
+#pragma once
+
+#include "STVRCpuKernel.h"
+
+#include <string>
+#include <vector>
+
+//-----------------------------------------------------------------------------
+// Translates a toy into an STVRCpuKernel.  The input is the whole fragment
+// shader STVRFragmentShader assembles (uniform header, channel samplers, #line
+// directives and the expanded toy body), so the kernel sees exactly what the
+// GPU compiles.
+//
+// The subset is what GLSL 1.30 toys use: the preprocessor (#define with and
+// without arguments, #if/#ifdef/#else, #line), float, int and bool scalars and
+// vectors, square matrices, structs, one dimensional arrays, functions with
+// in/out/inout parameters and overloads, if/for/while/do with break, continue
+// and early returns, the ternary operator, and the common built-ins including
+// texture2D, textureCube and the derivatives.  Samplers can only be passed
+// straight through to functions, and discard is not supported.
+//
+// Every function call is inlined, and every branch becomes a lane mask plus a
+// jump over the code no lane of the group needs.  Errors go to std::cerr with
+// the file and line they refer to.
+
+class STVRCpuCompiler
+{
+public:
+
+    // - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+    // CONSTRO/DESTRO
+
+    // sourceStringNames turns the source string numbers of #line directives
+    // back into file names (see HBGLShader::GetSourceStringNames).
+    STVRCpuCompiler(const std::string& shaderName, const std::vector<std::string>& sourceStringNames);
+    ~STVRCpuCompiler();
+
+    // - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+    // MODIFIERS
+
+    bool Compile(const std::string& shaderSource, STVRCpuKernel& kernel);
+
+private:
+
+    std::string                 m_shaderName;
+    std::vector<std::string>    m_sourceStringNames;
+};
@@ -0,0 +1,458 @@
+#include "STVRCpuKernel.h"
+#include "STVRCpuTexture.h"
+
+#include <emmintrin.h>
+
+#include <cmath>
+#include <cstring>
+
+// ''''''''''''''''''''''''''''''''''''''''''''''''''''''''''''''''''''''''''''
+// STATIC FUNCTIONS
+// ,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,
+
+// A lane group is two SSE registers wide.
+#define STVRCPU_LANES_UNARY(expression) \
+    { \
+        __m128 lanes = _mm_load_ps(a); \
+        _mm_store_ps(dst, expression); \
+        lanes = _mm_load_ps(a + 4); \
+        _mm_store_ps(dst + 4, expression); \
+    }
+
+#define STVRCPU_LANES_BINARY(expression) \
+    { \
+        __m128 lhs = _mm_load_ps(a); \
+        __m128 rhs = _mm_load_ps(b); \
+        _mm_store_ps(dst, expression); \
+        lhs = _mm_load_ps(a + 4); \
+        rhs = _mm_load_ps(b + 4); \
+        _mm_store_ps(dst + 4, expression); \
+    }
+
+#define STVRCPU_LANES_SCALAR(expression) \
+    for (int lane = 0; lane < c_CpuLaneCount; lane++) { \
+        dst[lane] = expression; \
+    }
+
+// SSE2 has no floor.  Truncate, step down where that rounded up, and leave
+// anything too big to have a fraction alone.
+static inline __m128
+FloorLanes(__m128 lanes)
+{
+    const __m128 one = _mm_set1_ps(1.f);
+    const __m128 noFraction = _mm_set1_ps(8388608.f);
+    const __m128 signBits = _mm_set1_ps(-0.f);
+
+    __m128 truncated = _mm_cvtepi32_ps(_mm_cvttps_epi32(lanes));
+    __m128 floored = _mm_sub_ps(truncated, _mm_and_ps(_mm_cmpgt_ps(truncated, lanes), one));
+    __m128 small = _mm_cmplt_ps(_mm_andnot_ps(signBits, lanes), noFraction);
+    return _mm_or_ps(_mm_and_ps(small, floored), _mm_andnot_ps(small, lanes));
+}
+
+static inline __m128
+TruncLanes(__m128 lanes)
+{
+    const __m128 noFraction = _mm_set1_ps(8388608.f);
+    const __m128 signBits = _mm_set1_ps(-0.f);
+
+    __m128 truncated = _mm_cvtepi32_ps(_mm_cvttps_epi32(lanes));
+    __m128 small = _mm_cmplt_ps(_mm_andnot_ps(signBits, lanes), noFraction);
+    return _mm_or_ps(_mm_and_ps(small, truncated), _mm_andnot_ps(small, lanes));
+}
+
+static inline __m128
+SelectLanes(__m128 mask, __m128 lhs, __m128 rhs)
+{
+    return _mm_or_ps(_mm_and_ps(mask, lhs), _mm_andnot_ps(mask, rhs));
+}
+
+// ''''''''''''''''''''''''''''''''''''''''''''''''''''''''''''''''''''''''''''
+// STVRCpuKernel
+// ,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,
+
+STVRCpuKernel::STVRCpuKernel() :
+m_registerCount(0)
+{
+    for (int component = 0; component < 4; component++)
+    {
+        m_fragCoordRegisters[component] = 0;
+        m_fragColorRegisters[component] = 0;
+    }
+}
+
+// ----------------------------------------------------------------------------
+
+STVRCpuKernel::~STVRCpuKernel()
+{
+}
+
+// ----------------------------------------------------------------------------
+
+size_t
+STVRCpuKernel::GetInstructionCount() const
+{
+    return m_code.size();
+}
+
+// ----------------------------------------------------------------------------
+
+int
+STVRCpuKernel::GetRegisterCount() const
+{
+    return m_registerCount;
+}
+
+// ----------------------------------------------------------------------------
+
+const std::vector<int>*
+STVRCpuKernel::FindUniform(const std::string& uniformName) const
+{
+    UniformMap::const_iterator uniformIter = m_uniforms.find(uniformName);
+    if (uniformIter == m_uniforms.end()) {
+        return NULL;
+    }
+
+    return &uniformIter->second;
+}
+
+// ----------------------------------------------------------------------------
+
+const int*
+STVRCpuKernel::GetFragCoordRegisters() const
+{
+    return m_fragCoordRegisters;
+}
+
+// ----------------------------------------------------------------------------
+
+const int*
+STVRCpuKernel::GetFragColorRegisters() const
+{
+    return m_fragColorRegisters;
+}
+
+// ----------------------------------------------------------------------------
+
+void
+STVRCpuKernel::InitRegisters(float* registers) const
+{
+    for (size_t constantIdx = 0; constantIdx < m_constantBits.size(); constantIdx++)
+    {
+        float constantValue;
+        memcpy(&constantValue, &m_constantBits[constantIdx], sizeof(constantValue));
+
+        float* constantLanes = registers + constantIdx * c_CpuLaneCount;
+        for (int lane = 0; lane < c_CpuLaneCount; lane++) {
+            constantLanes[lane] = constantValue;
+        }
+    }
+}
+
+// ----------------------------------------------------------------------------
+
+void
+STVRCpuKernel::Execute(float* registers, const STVRCpuTexture* const channels[4]) const
+{
+    const __m128 one = _mm_set1_ps(1.f);
+    const __m128 zero = _mm_setzero_ps();
+    const __m128 signBits = _mm_set1_ps(-0.f);
+    const __m128 allBits = _mm_castsi128_ps(_mm_set1_epi32(-1));
+
+    const STVRCpuInstruction* code = m_code.empty() ? NULL : &m_code[0];
+    const size_t codeSize = m_code.size();
+    size_t pc = 0;
+
+    while (pc < codeSize)
+    {
+        const STVRCpuInstruction& instruction = code[pc++];
+
+        float* dst = registers + instruction.dst * c_CpuLaneCount;
+        const float* a = registers + instruction.a * c_CpuLaneCount;
+        const float* b = registers + instruction.b * c_CpuLaneCount;
+        const float* c = registers + instruction.c * c_CpuLaneCount;
+
+        switch (instruction.op)
+        {
+        case STVRCPU_OP_MOV:
+            STVRCPU_LANES_UNARY(lanes);
+            break;
+
+        case STVRCPU_OP_SELECT:
+            _mm_store_ps(dst, SelectLanes(_mm_load_ps(a), _mm_load_ps(b), _mm_load_ps(c)));
+            _mm_store_ps(dst + 4, SelectLanes(_mm_load_ps(a + 4), _mm_load_ps(b + 4), _mm_load_ps(c + 4)));
+            break;
+
+        case STVRCPU_OP_ADD:
+            STVRCPU_LANES_BINARY(_mm_add_ps(lhs, rhs));
+            break;
+
+        case STVRCPU_OP_SUB:
+            STVRCPU_LANES_BINARY(_mm_sub_ps(lhs, rhs));
+            break;
+
+        case STVRCPU_OP_MUL:
+            STVRCPU_LANES_BINARY(_mm_mul_ps(lhs, rhs));
+            break;
+
+        case STVRCPU_OP_DIV:
+            STVRCPU_LANES_BINARY(_mm_div_ps(lhs, rhs));
+            break;
+
+        case STVRCPU_OP_MAD:
+            _mm_store_ps(dst, _mm_add_ps(_mm_mul_ps(_mm_load_ps(a), _mm_load_ps(b)), _mm_load_ps(c)));
+            _mm_store_ps(dst + 4, _mm_add_ps(_mm_mul_ps(_mm_load_ps(a + 4), _mm_load_ps(b + 4)), _mm_load_ps(c + 4)));
+            break;
+
+        case STVRCPU_OP_MIN:
+            STVRCPU_LANES_BINARY(_mm_min_ps(lhs, rhs));
+            break;
+
+        case STVRCPU_OP_MAX:
+            STVRCPU_LANES_BINARY(_mm_max_ps(lhs, rhs));
+            break;
+
+        case STVRCPU_OP_NEG:
+            STVRCPU_LANES_UNARY(_mm_xor_ps(lanes, signBits));
+            break;
+
+        case STVRCPU_OP_ABS:
+            STVRCPU_LANES_UNARY(_mm_andnot_ps(signBits, lanes));
+            break;
+
+        case STVRCPU_OP_SIGN:
+            STVRCPU_LANES_UNARY(_mm_sub_ps(_mm_and_ps(_mm_cmpgt_ps(lanes, zero), one), _mm_and_ps(_mm_cmplt_ps(lanes, zero), one)));
+            break;
+
+        case STVRCPU_OP_FLOOR:
+            STVRCPU_LANES_UNARY(FloorLanes(lanes));
+            break;
+
+        case STVRCPU_OP_CEIL:
+            STVRCPU_LANES_UNARY(_mm_xor_ps(FloorLanes(_mm_xor_ps(lanes, signBits)), signBits));
+            break;
+
+        case STVRCPU_OP_FRACT:
+            STVRCPU_LANES_UNARY(_mm_sub_ps(lanes, FloorLanes(lanes)));
+            break;
+
+        case STVRCPU_OP_TRUNC:
+            STVRCPU_LANES_UNARY(TruncLanes(lanes));
+            break;
+
+        case STVRCPU_OP_ROUND:
+            STVRCPU_LANES_UNARY(FloorLanes(_mm_add_ps(lanes, _mm_set1_ps(.5f))));
+            break;
+
+        case STVRCPU_OP_MOD:
+            STVRCPU_LANES_BINARY(_mm_sub_ps(lhs, _mm_mul_ps(rhs, FloorLanes(_mm_div_ps(lhs, rhs)))));
+            break;
+
+        case STVRCPU_OP_STEP:
+            STVRCPU_LANES_BINARY(_mm_and_ps(_mm_cmpge_ps(rhs, lhs), one));
+            break;
+
+        case STVRCPU_OP_SQRT:
+            STVRCPU_LANES_UNARY(_mm_sqrt_ps(lanes));
+            break;
+
+        case STVRCPU_OP_RSQRT:
+            // not _mm_rsqrt_ps, its 12 bits show up in normals
+            STVRCPU_LANES_UNARY(_mm_div_ps(one, _mm_sqrt_ps(lanes)));
+            break;
+
+        case STVRCPU_OP_SIN:
+            STVRCPU_LANES_SCALAR(sinf(a[lane]));
+            break;
+
+        case STVRCPU_OP_COS:
+            STVRCPU_LANES_SCALAR(cosf(a[lane]));
+            break;
+
+        case STVRCPU_OP_TAN:
+            STVRCPU_LANES_SCALAR(tanf(a[lane]));
+            break;
+
+        case STVRCPU_OP_ASIN:
+            STVRCPU_LANES_SCALAR(asinf(a[lane]));
+            break;
+
+        case STVRCPU_OP_ACOS:
+            STVRCPU_LANES_SCALAR(acosf(a[lane]));
+            break;
+
+        case STVRCPU_OP_ATAN:
+            STVRCPU_LANES_SCALAR(atanf(a[lane]));
+            break;
+
+        case STVRCPU_OP_ATAN2:
+            STVRCPU_LANES_SCALAR(atan2f(a[lane], b[lane]));
+            break;
+
+        case STVRCPU_OP_POW:
+            STVRCPU_LANES_SCALAR(powf(a[lane], b[lane]));
+            break;
+
+        case STVRCPU_OP_EXP:
+            STVRCPU_LANES_SCALAR(expf(a[lane]));
+            break;
+
+        case STVRCPU_OP_LOG:
+            STVRCPU_LANES_SCALAR(logf(a[lane]));
+            break;
+
+        case STVRCPU_OP_EXP2:
+            STVRCPU_LANES_SCALAR(powf(2.f, a[lane]));
+            break;
+
+        case STVRCPU_OP_LOG2:
+            STVRCPU_LANES_SCALAR(logf(a[lane]) * 1.44269504f);
+            break;
+
+        case STVRCPU_OP_LT:
+            STVRCPU_LANES_BINARY(_mm_cmplt_ps(lhs, rhs));
+            break;
+
+        case STVRCPU_OP_LE:
+            STVRCPU_LANES_BINARY(_mm_cmple_ps(lhs, rhs));
+            break;
+
+        case STVRCPU_OP_GT:
+            STVRCPU_LANES_BINARY(_mm_cmpgt_ps(lhs, rhs));
+            break;
+
+        case STVRCPU_OP_GE:
+            STVRCPU_LANES_BINARY(_mm_cmpge_ps(lhs, rhs));
+            break;
+
+        case STVRCPU_OP_EQ:
+            STVRCPU_LANES_BINARY(_mm_cmpeq_ps(lhs, rhs));
+            break;
+
+        case STVRCPU_OP_NE:
+            STVRCPU_LANES_BINARY(_mm_cmpneq_ps(lhs, rhs));
+            break;
+
+        case STVRCPU_OP_AND:
+            STVRCPU_LANES_BINARY(_mm_and_ps(lhs, rhs));
+            break;
+
+        case STVRCPU_OP_OR:
+            STVRCPU_LANES_BINARY(_mm_or_ps(lhs, rhs));
+            break;
+
+        case STVRCPU_OP_XOR:
+            STVRCPU_LANES_BINARY(_mm_xor_ps(lhs, rhs));
+            break;
+
+        case STVRCPU_OP_ANDNOT:
+            STVRCPU_LANES_BINARY(_mm_andnot_ps(lhs, rhs));
+            break;
+
+        case STVRCPU_OP_NOT:
+            STVRCPU_LANES_UNARY(_mm_xor_ps(lanes, allBits));
+            break;
+
+        case STVRCPU_OP_MASK_TO_FLOAT:
+            STVRCPU_LANES_UNARY(_mm_and_ps(lanes, one));
+            break;
+
+        case STVRCPU_OP_DFDX:
+            // across each row of each quad
+            for (int quad = 0; quad < c_CpuLaneCount; quad += 4)
+            {
+                float topDelta = a[quad + 1] - a[quad];
+                float bottomDelta = a[quad + 3] - a[quad + 2];
+                dst[quad] = dst[quad + 1] = topDelta;
+                dst[quad + 2] = dst[quad + 3] = bottomDelta;
+            }
+            break;
+
+        case STVRCPU_OP_DFDY:
+            // up each column of each quad
+            for (int quad = 0; quad < c_CpuLaneCount; quad += 4)
+            {
+                float leftDelta = a[quad + 2] - a[quad];
+                float rightDelta = a[quad + 3] - a[quad + 1];
+                dst[quad] = dst[quad + 2] = leftDelta;
+                dst[quad + 1] = dst[quad + 3] = rightDelta;
+            }
+            break;
+
+        case STVRCPU_OP_TEX2D:
+            if (channels[instruction.imm]) {
+                channels[instruction.imm]->Sample2D(a, b, dst);
+            }
+            else {
+                memset(dst, 0, 4 * c_CpuLaneCount * sizeof(float));
+            }
+            break;
+
+        case STVRCPU_OP_TEXCUBE:
+            if (channels[instruction.imm]) {
+                channels[instruction.imm]->SampleCube(a, b, c, dst);
+            }
+            else {
+                memset(dst, 0, 4 * c_CpuLaneCount * sizeof(float));
+            }
+            break;
+
+        case STVRCPU_OP_JMP:
+            pc = size_t(instruction.imm);
+            break;
+
+        case STVRCPU_OP_JMP_IF_NONE:
+            if ((_mm_movemask_ps(_mm_load_ps(a)) | _mm_movemask_ps(_mm_load_ps(a + 4))) == 0) {
+                pc = size_t(instruction.imm);
+            }
+            break;
+        }
+    }
+}
+
+// ----------------------------------------------------------------------------
+
+void
+STVRCpuKernel::SetCode(const std::vector<STVRCpuInstruction>& code)
+{
+    m_code = code;
+}
+
+// ----------------------------------------------------------------------------
+
+void
+STVRCpuKernel::SetConstants(const std::vector<unsigned int>& constantBits)
+{
+    m_constantBits = constantBits;
+}
+
+// ----------------------------------------------------------------------------
+
+void
+STVRCpuKernel::SetRegisterCount(int registerCount)
+{
+    m_registerCount = registerCount;
+}
+
+// ----------------------------------------------------------------------------
+
+void
+STVRCpuKernel::SetUniform(const std::string& uniformName, const std::vector<int>& registers)
+{
+    m_uniforms[uniformName] = registers;
+}
+
+// ----------------------------------------------------------------------------
+
+void
+STVRCpuKernel::SetFragCoordRegisters(const int registers[4])
+{
+    memcpy(m_fragCoordRegisters, registers, sizeof(m_fragCoordRegisters));
+}
+
+// ----------------------------------------------------------------------------
+
+void
+STVRCpuKernel::SetFragColorRegisters(const int registers[4])
+{
+    memcpy(m_fragColorRegisters, registers, sizeof(m_fragColorRegisters));
+}
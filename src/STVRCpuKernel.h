@@ -0,0 +1,163 @@
+#pragma once
+
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+//-----------------------------------------------------------------------------
+// A kernel works on a lane group: a 4x2 block of pixels made of two 2x2 quads
+// side by side, so derivatives and texture LODs can be taken within a quad
+// the way GPUs take them.  Lane l is pixel (2 * (l / 4) + l % 2, (l % 4) / 2)
+// of the block, with y going up like gl_FragCoord.
+
+const int c_CpuLaneCount = 8;
+const int c_CpuLaneGroupWidth = 4;
+const int c_CpuLaneGroupHeight = 2;
+
+//-----------------------------------------------------------------------------
+// Every operand is a register of c_CpuLaneCount floats.  Bools are lane masks,
+// all bits set or none, and ints are floats holding whole numbers.
+
+enum STVRCpuOpCode
+{
+    STVRCPU_OP_MOV,             // dst = a
+    STVRCPU_OP_SELECT,          // dst = a ? b : c, a is a mask
+
+    STVRCPU_OP_ADD,
+    STVRCPU_OP_SUB,
+    STVRCPU_OP_MUL,
+    STVRCPU_OP_DIV,
+    STVRCPU_OP_MAD,             // dst = a * b + c
+    STVRCPU_OP_MIN,
+    STVRCPU_OP_MAX,
+    STVRCPU_OP_NEG,
+    STVRCPU_OP_ABS,
+    STVRCPU_OP_SIGN,
+    STVRCPU_OP_FLOOR,
+    STVRCPU_OP_CEIL,
+    STVRCPU_OP_FRACT,
+    STVRCPU_OP_TRUNC,
+    STVRCPU_OP_ROUND,
+    STVRCPU_OP_MOD,             // dst = a - b * floor(a / b)
+    STVRCPU_OP_STEP,            // dst = b < a ? 0 : 1
+    STVRCPU_OP_SQRT,
+    STVRCPU_OP_RSQRT,
+
+    STVRCPU_OP_SIN,
+    STVRCPU_OP_COS,
+    STVRCPU_OP_TAN,
+    STVRCPU_OP_ASIN,
+    STVRCPU_OP_ACOS,
+    STVRCPU_OP_ATAN,
+    STVRCPU_OP_ATAN2,           // dst = atan(a, b), a is y
+    STVRCPU_OP_POW,
+    STVRCPU_OP_EXP,
+    STVRCPU_OP_LOG,
+    STVRCPU_OP_EXP2,
+    STVRCPU_OP_LOG2,
+
+    STVRCPU_OP_LT,
+    STVRCPU_OP_LE,
+    STVRCPU_OP_GT,
+    STVRCPU_OP_GE,
+    STVRCPU_OP_EQ,
+    STVRCPU_OP_NE,
+    STVRCPU_OP_AND,
+    STVRCPU_OP_OR,
+    STVRCPU_OP_XOR,
+    STVRCPU_OP_ANDNOT,          // dst = ~a & b
+    STVRCPU_OP_NOT,
+    STVRCPU_OP_MASK_TO_FLOAT,   // dst = a ? 1 : 0
+
+    STVRCPU_OP_DFDX,
+    STVRCPU_OP_DFDY,
+
+    STVRCPU_OP_TEX2D,           // dst..dst+3 = texture2D(iChannel[imm], vec2(a, b))
+    STVRCPU_OP_TEXCUBE,         // dst..dst+3 = textureCube(iChannel[imm], vec3(a, b, c))
+
+    STVRCPU_OP_JMP,             // continue at instruction imm
+    STVRCPU_OP_JMP_IF_NONE,     // continue at imm when no lane of mask a is set
+
+    STVRCPU_OP_COUNT
+};
+
+struct STVRCpuInstruction
+{
+    int     op;
+    int     imm;
+    int     dst;
+    int     a;
+    int     b;
+    int     c;
+};
+
+class STVRCpuTexture;
+
+//-----------------------------------------------------------------------------
+// A toy translated for the CPU: a flat list of lane instructions with the
+// toy's control flow turned into jumps and lane masks, so a ray march loop
+// keeps going only for as long as any of its pixels still marches.  Functions
+// are inlined.  STVRCpuCompiler builds kernels, STVRCpuRenderer runs them.
+//
+// The register file is laid out as the constants first (set once by
+// InitRegisters), then the uniforms, then gl_FragCoord and everything else.
+
+class STVRCpuKernel
+{
+public:
+
+    // - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+    // CONSTRO/DESTRO
+
+    STVRCpuKernel();
+    ~STVRCpuKernel();
+
+    // - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+    // ACCESSORS
+
+    size_t GetInstructionCount() const;
+    int GetRegisterCount() const;
+
+    // The registers of a uniform, one per component and array elements one
+    // after the other; NULL if the toy never reads it.
+    const std::vector<int>* FindUniform(const std::string& uniformName) const;
+
+    const int* GetFragCoordRegisters() const;
+    const int* GetFragColorRegisters() const;
+
+    // Set the constants of a new register file of GetRegisterCount() *
+    // c_CpuLaneCount floats, aligned to 16 bytes.
+    void InitRegisters(float* registers) const;
+
+    // Run the toy over one lane group.  gl_FragCoord and the uniforms must be
+    // in registers, gl_FragColor is there afterwards.  channels may hold
+    // NULLs, which sample black.
+    void Execute(float* registers, const STVRCpuTexture* const channels[4]) const;
+
+    // - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+    // MODIFIERS
+
+    void SetCode(const std::vector<STVRCpuInstruction>& code);
+    void SetConstants(const std::vector<unsigned int>& constantBits);
+    void SetRegisterCount(int registerCount);
+    void SetUniform(const std::string& uniformName, const std::vector<int>& registers);
+    void SetFragCoordRegisters(const int registers[4]);
+    void SetFragColorRegisters(const int registers[4]);
+
+private:
+
+    typedef std::map<std::string, std::vector<int> > UniformMap;
+
+    std::vector<STVRCpuInstruction> m_code;
+
+    // bit patterns, masks are constants too
+    std::vector<unsigned int>       m_constantBits;
+
+    int                             m_registerCount;
+    UniformMap                      m_uniforms;
+    int                             m_fragCoordRegisters[4];
+    int                             m_fragColorRegisters[4];
+};
+
+typedef std::shared_ptr<STVRCpuKernel> STVRCpuKernelPtr;
@@ -0,0 +1,274 @@
+#include "STVRCpuRenderer.h"
+#include "STVRCpuCompiler.h"
+#include "STVRAssets.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <iostream>
+#include <thread>
+
+// ''''''''''''''''''''''''''''''''''''''''''''''''''''''''''''''''''''''''''''
+// STVRCpuRenderer
+// ,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,
+
+STVRCpuRenderer::STVRCpuRenderer() :
+m_threadCount(std::max(std::thread::hardware_concurrency(), 1u)),
+m_visibleTexels(NULL),
+m_lastRenderMillisecs(0.),
+m_lastMegapixelsPerSec(0.)
+{
+    for (int elementIdx = 0; elementIdx < 16; elementIdx++) {
+        m_cameraTransform[elementIdx] = (elementIdx % 5 == 0) ? 1.f : 0.f;
+    }
+}
+
+// ----------------------------------------------------------------------------
+
+STVRCpuRenderer::~STVRCpuRenderer()
+{
+
+}
+
+// ----------------------------------------------------------------------------
+
+bool
+STVRCpuRenderer::Load(const STVRFragmentShader& toy)
+{
+    if (!toy.GetSource() || !toy.GetSource()[0]) {
+        std::cerr << "STVRCpuRenderer ERROR [ " << toy.GetName() << " ]: the toy did not load" << std::endl;
+        return false;
+    }
+
+    STVRCpuCompiler compiler(toy.GetName(), toy.GetSourceStringNames());
+    if (!compiler.Compile(toy.GetSource(), m_kernel)) {
+        return false;
+    }
+
+    for (int inputChannel = 0; inputChannel < SHADERTOYVR_NUMCHANNELS; inputChannel++)
+    {
+        m_channels[inputChannel].reset();
+
+        ShaderToyVRInputChannel channel = static_cast<ShaderToyVRInputChannel>(inputChannel);
+        ShaderToyVRChannelType inputType = toy.GetInputType(channel);
+        if (inputType == SHADERTOYVR_UNKNOWN_TYPE) {
+            continue;
+        }
+
+        const STVRAsset* asset = STVRAssetRegistry::Get().Find(toy.GetInputAsset(channel));
+        if (!asset) {
+            std::cerr << "STVRCpuRenderer WARNING [ " << toy.GetName() << " ]: iChannel" << inputChannel <<
+                " is a stream or buffer, it reads black on the CPU" << std::endl;
+            continue;
+        }
+
+        STVRCpuTexturePtr texture(new STVRCpuTexture());
+        if (!texture->Load(*asset)) {
+            return false;
+        }
+        m_channels[inputChannel] = texture;
+    }
+
+    std::cout << "STVRCpuRenderer [ " << toy.GetName() << " ]: " << m_kernel.GetInstructionCount() << " instructions, " <<
+        m_kernel.GetRegisterCount() << " registers, " << m_threadCount << " threads" << std::endl;
+
+    return true;
+}
+
+// ----------------------------------------------------------------------------
+
+const STVRCpuKernel&
+STVRCpuRenderer::GetKernel() const
+{
+    return m_kernel;
+}
+
+// ----------------------------------------------------------------------------
+
+unsigned int
+STVRCpuRenderer::GetThreadCount() const
+{
+    return m_threadCount;
+}
+
+// ----------------------------------------------------------------------------
+
+double
+STVRCpuRenderer::GetLastRenderMillisecs() const
+{
+    return m_lastRenderMillisecs;
+}
+
+// ----------------------------------------------------------------------------
+
+double
+STVRCpuRenderer::GetLastMegapixelsPerSec() const
+{
+    return m_lastMegapixelsPerSec;
+}
+
+// ----------------------------------------------------------------------------
+
+void
+STVRCpuRenderer::SetCameraTransform(const float cameraTransform[16])
+{
+    std::copy(cameraTransform, cameraTransform + 16, m_cameraTransform);
+}
+
+// ----------------------------------------------------------------------------
+
+void
+STVRCpuRenderer::SetVisibleTexels(const std::vector<unsigned char>* visibleTexels)
+{
+    m_visibleTexels = visibleTexels;
+}
+
+// ----------------------------------------------------------------------------
+
+void
+STVRCpuRenderer::Render(int width, int height, float timeInSecs, std::vector<unsigned char>& rgba)
+{
+    rgba.assign(size_t(width) * height * 4, 0);
+
+    Frame frame;
+    frame.width = width;
+    frame.height = height;
+    frame.timeInSecs = timeInSecs;
+    frame.tilesAcross = (width + c_CpuTileSize - 1) / c_CpuTileSize;
+    frame.tileCount = frame.tilesAcross * ((height + c_CpuTileSize - 1) / c_CpuTileSize);
+    frame.nextTile = 0;
+    frame.pixels = rgba.empty() ? NULL : &rgba[0];
+    frame.visibleTexels = (m_visibleTexels && m_visibleTexels->size() == size_t(width) * height && !rgba.empty()) ?
+        &(*m_visibleTexels)[0] : NULL;
+
+    std::chrono::steady_clock::time_point startTime = std::chrono::steady_clock::now();
+
+    // the calling thread is one of the workers
+    std::vector<std::thread> workers;
+    for (unsigned int workerIdx = 1; workerIdx < m_threadCount; workerIdx++) {
+        workers.push_back(std::thread(&STVRCpuRenderer::_RenderTiles, this, &frame));
+    }
+    _RenderTiles(&frame);
+    for (size_t workerIdx = 0; workerIdx < workers.size(); workerIdx++) {
+        workers[workerIdx].join();
+    }
+
+    std::chrono::duration<double, std::milli> renderTime = std::chrono::steady_clock::now() - startTime;
+    m_lastRenderMillisecs = renderTime.count();
+    m_lastMegapixelsPerSec = (m_lastRenderMillisecs > 0.) ? double(width) * height / (m_lastRenderMillisecs * 1000.) : 0.;
+}
+
+// ----------------------------------------------------------------------------
+
+void
+STVRCpuRenderer::_RenderTiles(Frame* frame) const
+{
+    // the kernel wants its registers 16 byte aligned
+    std::vector<float> registerStorage(size_t(m_kernel.GetRegisterCount()) * c_CpuLaneCount + 4);
+    float* registers = &registerStorage[0];
+    registers += (4 - (reinterpret_cast<uintptr_t>(registers) / sizeof(float)) % 4) % 4;
+    m_kernel.InitRegisters(registers);
+
+    float resolution[2] = { float(frame->width), float(frame->height) };
+    float channelTimes[4] = { frame->timeInSecs, frame->timeInSecs, frame->timeInSecs, frame->timeInSecs };
+    float channelResolutions[4 * 3] = { 0.f };
+    float zeros[4] = { 0.f, 0.f, 0.f, 0.f };
+    float focalLength = 1.f;
+
+    const STVRCpuTexture* channels[SHADERTOYVR_NUMCHANNELS];
+    for (int inputChannel = 0; inputChannel < SHADERTOYVR_NUMCHANNELS; inputChannel++)
+    {
+        channels[inputChannel] = m_channels[inputChannel].get();
+        if (channels[inputChannel]) {
+            channelResolutions[inputChannel * 3] = float(channels[inputChannel]->GetWidth());
+            channelResolutions[inputChannel * 3 + 1] = float(channels[inputChannel]->GetHeight());
+        }
+    }
+
+    _SetUniform(registers, "iGlobalTime", &frame->timeInSecs, 1);
+    _SetUniform(registers, "iMouse", zeros, 2);
+    _SetUniform(registers, "iResolution", resolution, 2);
+    _SetUniform(registers, "iChannelTime", channelTimes, 4);
+    _SetUniform(registers, "iDate", zeros, 4);
+    _SetUniform(registers, "iSampleRate", zeros, 1);
+    _SetUniform(registers, "iChannelResolution", channelResolutions, 4 * 3);
+    _SetUniform(registers, "iCameraTransform", m_cameraTransform, 16);
+    _SetUniform(registers, "iFocalLength", &focalLength, 1);
+    _SetUniform(registers, "iPixelJitter", zeros, 2);
+
+    const int* fragCoord = m_kernel.GetFragCoordRegisters();
+    const int* fragColor = m_kernel.GetFragColorRegisters();
+    for (int lane = 0; lane < c_CpuLaneCount; lane++)
+    {
+        registers[fragCoord[2] * c_CpuLaneCount + lane] = .5f;
+        registers[fragCoord[3] * c_CpuLaneCount + lane] = 1.f;
+    }
+
+    for (int tileIdx = frame->nextTile++; tileIdx < frame->tileCount; tileIdx = frame->nextTile++)
+    {
+        int tileX = (tileIdx % frame->tilesAcross) * c_CpuTileSize;
+        int tileY = (tileIdx / frame->tilesAcross) * c_CpuTileSize;
+        int tileEndX = std::min(tileX + c_CpuTileSize, frame->width);
+        int tileEndY = std::min(tileY + c_CpuTileSize, frame->height);
+
+        for (int groupY = tileY; groupY < tileEndY; groupY += c_CpuLaneGroupHeight)
+        {
+            for (int groupX = tileX; groupX < tileEndX; groupX += c_CpuLaneGroupWidth)
+            {
+                // lanes past the edge of the image run but are not written
+                int pixelX[c_CpuLaneCount], pixelY[c_CpuLaneCount];
+                bool anyVisible = !frame->visibleTexels;
+                for (int lane = 0; lane < c_CpuLaneCount; lane++)
+                {
+                    pixelX[lane] = groupX + 2 * (lane / 4) + lane % 2;
+                    pixelY[lane] = groupY + (lane % 4) / 2;
+                    registers[fragCoord[0] * c_CpuLaneCount + lane] = pixelX[lane] + .5f;
+                    registers[fragCoord[1] * c_CpuLaneCount + lane] = pixelY[lane] + .5f;
+
+                    if (!anyVisible && pixelX[lane] < tileEndX && pixelY[lane] < tileEndY) {
+                        anyVisible = (frame->visibleTexels[size_t(pixelY[lane]) * frame->width + pixelX[lane]] != 0);
+                    }
+                }
+
+                // the lenses never show any of it
+                if (!anyVisible) {
+                    continue;
+                }
+
+                m_kernel.Execute(registers, channels);
+
+                for (int lane = 0; lane < c_CpuLaneCount; lane++)
+                {
+                    if (pixelX[lane] >= tileEndX || pixelY[lane] >= tileEndY) {
+                        continue;
+                    }
+
+                    unsigned char* pixel = frame->pixels + (size_t(pixelY[lane]) * frame->width + pixelX[lane]) * 4;
+                    for (int component = 0; component < 4; component++)
+                    {
+                        float value = registers[fragColor[component] * c_CpuLaneCount + lane];
+                        value = (value > 0.f) ? ((value < 1.f) ? value : 1.f) : 0.f;
+                        pixel[component] = static_cast<unsigned char>(value * 255.f + .5f);
+                    }
+                }
+            }
+        }
+    }
+}
+
+// ----------------------------------------------------------------------------
+
+void
+STVRCpuRenderer::_SetUniform(float* registers, const std::string& uniformName, const float* values, size_t valueCount) const
+{
+    // the toy may not read it, or only part of an array
+    const std::vector<int>* uniformRegisters = m_kernel.FindUniform(uniformName);
+    if (!uniformRegisters) {
+        return;
+    }
+
+    for (size_t valueIdx = 0; valueIdx < valueCount && valueIdx < uniformRegisters->size(); valueIdx++) {
+        std::fill(registers + (*uniformRegisters)[valueIdx] * c_CpuLaneCount,
+            registers + ((*uniformRegisters)[valueIdx] + 1) * c_CpuLaneCount, values[valueIdx]);
+    }
+}
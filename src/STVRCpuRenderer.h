@@ -0,0 +1,93 @@
+#pragma once
+
+#include "STVRCpuKernel.h"
+#include "STVRCpuTexture.h"
+#include "STVRShaders.h"
+
+#include <atomic>
+#include <memory>
+#include <string>
+#include <vector>
+
+//-----------------------------------------------------------------------------
+// Draws a toy's image pass on the CPU, for machines with no GPU.  The toy is
+// translated once by STVRCpuCompiler; each frame is cut into square tiles
+// that one worker thread per core takes from a shared counter, and a worker
+// runs the kernel over the lane groups of its tiles with a register file of
+// its own.
+//
+// The inputs are those of a flat screen with no headset: iMouse is zero,
+// iCameraTransform the identity (unless SetCameraTransform says otherwise)
+// and iFocalLength 1, with iDate and iSampleRate zero like the GPU path
+// leaves them.  Image and cubemap channels read the same assets as the GPU;
+// video, audio and buffer channels are black.
+
+const int c_CpuTileSize = 32;
+
+class STVRCpuRenderer
+{
+public:
+
+    // - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+    // CONSTRO/DESTRO
+
+    STVRCpuRenderer();
+    ~STVRCpuRenderer();
+
+    // Translate the toy and read its channel textures.  Needs no GL context.
+    bool Load(const STVRFragmentShader& toy);
+
+    // - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+    // ACCESSORS
+
+    const STVRCpuKernel& GetKernel() const;
+    unsigned int GetThreadCount() const;
+
+    // wall clock time of the last Render, and its throughput
+    double GetLastRenderMillisecs() const;
+    double GetLastMegapixelsPerSec() const;
+
+    // - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+    // MODIFIERS
+
+    // Column major, like glm and the iCameraTransform uniform.
+    void SetCameraTransform(const float cameraTransform[16]);
+
+    // width * height flags, bottom row first, zero where the pixel is never
+    // seen (STVRLensMask::GetVisibleTexels); lane groups with no visible
+    // pixel are skipped and left black.  NULL, or a size that doesn't match
+    // the frame, draws everything.  The flags are not copied.
+    void SetVisibleTexels(const std::vector<unsigned char>* visibleTexels);
+
+    // Draw one frame at timeInSecs into rgba, width * height pixels with the
+    // bottom row first like glReadPixels.
+    void Render(int width, int height, float timeInSecs, std::vector<unsigned char>& rgba);
+
+private:
+
+    struct Frame
+    {
+        int                 width;
+        int                 height;
+        float               timeInSecs;
+        int                 tilesAcross;
+        int                 tileCount;
+        std::atomic<int>    nextTile;
+        unsigned char*      pixels;
+        const unsigned char* visibleTexels;
+    };
+
+    void _RenderTiles(Frame* frame) const;
+    void _SetUniform(float* registers, const std::string& uniformName, const float* values, size_t valueCount) const;
+
+    STVRCpuKernel               m_kernel;
+    STVRCpuTexturePtr           m_channels[SHADERTOYVR_NUMCHANNELS];
+    unsigned int                m_threadCount;
+    float                       m_cameraTransform[16];
+    const std::vector<unsigned char>* m_visibleTexels;
+
+    double                      m_lastRenderMillisecs;
+    double                      m_lastMegapixelsPerSec;
+};
+
+typedef std::shared_ptr<STVRCpuRenderer> STVRCpuRendererPtr;
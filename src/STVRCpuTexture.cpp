@@ -0,0 +1,360 @@
+#include "STVRCpuTexture.h"
+#include "STVRCpuKernel.h"
+
+#include "SOIL.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <iostream>
+
+// ''''''''''''''''''''''''''''''''''''''''''''''''''''''''''''''''''''''''''''
+// STATIC FUNCTIONS
+// ,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,
+
+static int
+NextPowerOfTwo(int value)
+{
+    int powerOfTwo = 1;
+    while (powerOfTwo < value) {
+        powerOfTwo *= 2;
+    }
+
+    return powerOfTwo;
+}
+
+static inline int
+WrapTexelCoord(int coord, int size, bool repeat)
+{
+    if (repeat) {
+        coord %= size;
+        return coord < 0 ? coord + size : coord;
+    }
+
+    return coord < 0 ? 0 : (coord >= size ? size - 1 : coord);
+}
+
+// ''''''''''''''''''''''''''''''''''''''''''''''''''''''''''''''''''''''''''''
+// STVRCpuTexture
+// ,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,
+
+STVRCpuTexture::STVRCpuTexture() :
+m_cubeMap(false),
+m_repeat(true)
+{
+}
+
+// ----------------------------------------------------------------------------
+
+STVRCpuTexture::~STVRCpuTexture()
+{
+}
+
+// ----------------------------------------------------------------------------
+
+bool
+STVRCpuTexture::Load(const STVRAsset& asset)
+{
+    m_cubeMap = (asset.type == SHADERTOYVR_CUBEMAP_TEX);
+    m_repeat = (asset.loadFlags & SOIL_FLAG_TEXTURE_REPEATS) != 0;
+    m_faces.clear();
+
+    size_t faceCount = m_cubeMap ? 6 : 1;
+    if (asset.filePaths.size() != faceCount) {
+        std::cerr << "STVRCpuTexture ERROR [ " << asset.name << " ]: expected " << faceCount << " files" << std::endl;
+        return false;
+    }
+
+    m_faces.resize(faceCount);
+    for (size_t faceIdx = 0; faceIdx < faceCount; faceIdx++)
+    {
+        if (!_LoadImage(asset.filePaths[faceIdx], asset, m_faces[faceIdx])) {
+            m_faces.clear();
+            return false;
+        }
+    }
+
+    return true;
+}
+
+// ----------------------------------------------------------------------------
+
+bool
+STVRCpuTexture::_LoadImage(const std::string& filePath, const STVRAsset& asset, LevelChain& levels) const
+{
+    int width = 0;
+    int height = 0;
+    int channels = 0;
+    unsigned char* pixels = SOIL_load_image(filePath.c_str(), &width, &height, &channels, asset.forceChannels);
+    if (!pixels) {
+        std::cerr << "STVRCpuTexture ERROR [ " << asset.name << " ]: Could not load [ " << filePath << " ] : " << SOIL_last_result() << std::endl;
+        return false;
+    }
+
+    if (asset.forceChannels != SOIL_LOAD_AUTO) {
+        channels = asset.forceChannels;
+    }
+
+    Level topLevel;
+    topLevel.width = width;
+    topLevel.height = height;
+    topLevel.texels.resize(size_t(width) * size_t(height) * 4);
+
+    // expanded the way GL expands LUMINANCE, LUMINANCE_ALPHA and RGB
+    bool invertY = (asset.loadFlags & SOIL_FLAG_INVERT_Y) != 0;
+    for (int row = 0; row < height; row++)
+    {
+        const unsigned char* source = pixels + size_t(invertY ? height - 1 - row : row) * width * channels;
+        float* texel = &topLevel.texels[size_t(row) * width * 4];
+
+        for (int column = 0; column < width; column++, source += channels, texel += 4)
+        {
+            float luminance = source[0] / 255.f;
+            texel[0] = luminance;
+            texel[1] = channels >= 3 ? source[1] / 255.f : luminance;
+            texel[2] = channels >= 3 ? source[2] / 255.f : luminance;
+            texel[3] = channels == 2 ? source[1] / 255.f : (channels == 4 ? source[3] / 255.f : 1.f);
+        }
+    }
+
+    SOIL_free_image_data(pixels);
+
+    // SOIL scales textures up to a power of two before uploading them
+    if ((asset.loadFlags & SOIL_FLAG_POWER_OF_TWO) &&
+        (NextPowerOfTwo(width) != width || NextPowerOfTwo(height) != height))
+    {
+        Level scaledLevel;
+        scaledLevel.width = NextPowerOfTwo(width);
+        scaledLevel.height = NextPowerOfTwo(height);
+        scaledLevel.texels.resize(size_t(scaledLevel.width) * size_t(scaledLevel.height) * 4);
+
+        for (int row = 0; row < scaledLevel.height; row++)
+        {
+            for (int column = 0; column < scaledLevel.width; column++)
+            {
+                _SampleBilinear(topLevel,
+                    (column + .5f) / scaledLevel.width,
+                    (row + .5f) / scaledLevel.height,
+                    false,
+                    &scaledLevel.texels[(size_t(row) * scaledLevel.width + column) * 4]);
+            }
+        }
+
+        topLevel.width = scaledLevel.width;
+        topLevel.height = scaledLevel.height;
+        topLevel.texels.swap(scaledLevel.texels);
+    }
+
+    levels.clear();
+    levels.push_back(topLevel);
+
+    if (!(asset.loadFlags & SOIL_FLAG_MIPMAPS) || m_cubeMap) {
+        return true;
+    }
+
+    // box filtered, like SOIL's own mipmaps
+    while (levels.back().width > 1 || levels.back().height > 1)
+    {
+        const Level& parentLevel = levels.back();
+
+        Level childLevel;
+        childLevel.width = parentLevel.width > 1 ? parentLevel.width / 2 : 1;
+        childLevel.height = parentLevel.height > 1 ? parentLevel.height / 2 : 1;
+        childLevel.texels.resize(size_t(childLevel.width) * size_t(childLevel.height) * 4);
+
+        for (int row = 0; row < childLevel.height; row++)
+        {
+            int parentRows[2] = { row * 2, parentLevel.height > 1 ? row * 2 + 1 : row * 2 };
+            for (int column = 0; column < childLevel.width; column++)
+            {
+                int parentColumns[2] = { column * 2, parentLevel.width > 1 ? column * 2 + 1 : column * 2 };
+                float* texel = &childLevel.texels[(size_t(row) * childLevel.width + column) * 4];
+
+                for (int component = 0; component < 4; component++)
+                {
+                    float sum = 0.f;
+                    for (int rowIdx = 0; rowIdx < 2; rowIdx++) {
+                        for (int columnIdx = 0; columnIdx < 2; columnIdx++) {
+                            sum += parentLevel.texels[(size_t(parentRows[rowIdx]) * parentLevel.width + parentColumns[columnIdx]) * 4 + component];
+                        }
+                    }
+                    texel[component] = sum * .25f;
+                }
+            }
+        }
+
+        levels.push_back(childLevel);
+    }
+
+    return true;
+}
+
+// ----------------------------------------------------------------------------
+
+bool
+STVRCpuTexture::IsCubeMap() const
+{
+    return m_cubeMap;
+}
+
+// ----------------------------------------------------------------------------
+
+int
+STVRCpuTexture::GetWidth() const
+{
+    return m_faces.empty() ? 0 : m_faces[0][0].width;
+}
+
+// ----------------------------------------------------------------------------
+
+int
+STVRCpuTexture::GetHeight() const
+{
+    return m_faces.empty() ? 0 : m_faces[0][0].height;
+}
+
+// ----------------------------------------------------------------------------
+
+void
+STVRCpuTexture::_SampleBilinear(const Level& level, float s, float t, bool repeat, float texel[4]) const
+{
+    float x = s * level.width - .5f;
+    float y = t * level.height - .5f;
+    if (!(x > -1e6f && x < 1e6f) || !(y > -1e6f && y < 1e6f)) {
+        // NaNs and coordinates too far out to wrap sensibly
+        x = 0.f;
+        y = 0.f;
+    }
+
+    float floorX = floorf(x);
+    float floorY = floorf(y);
+    float fractX = x - floorX;
+    float fractY = y - floorY;
+
+    int column0 = WrapTexelCoord(int(floorX), level.width, repeat);
+    int column1 = WrapTexelCoord(int(floorX) + 1, level.width, repeat);
+    int row0 = WrapTexelCoord(int(floorY), level.height, repeat);
+    int row1 = WrapTexelCoord(int(floorY) + 1, level.height, repeat);
+
+    const float* texel00 = &level.texels[(size_t(row0) * level.width + column0) * 4];
+    const float* texel10 = &level.texels[(size_t(row0) * level.width + column1) * 4];
+    const float* texel01 = &level.texels[(size_t(row1) * level.width + column0) * 4];
+    const float* texel11 = &level.texels[(size_t(row1) * level.width + column1) * 4];
+
+    for (int component = 0; component < 4; component++)
+    {
+        float bottom = texel00[component] + (texel10[component] - texel00[component]) * fractX;
+        float top = texel01[component] + (texel11[component] - texel01[component]) * fractX;
+        texel[component] = bottom + (top - bottom) * fractY;
+    }
+}
+
+// ----------------------------------------------------------------------------
+
+void
+STVRCpuTexture::Sample2D(const float* s, const float* t, float* rgba) const
+{
+    if (m_faces.empty()) {
+        memset(rgba, 0, 4 * c_CpuLaneCount * sizeof(float));
+        return;
+    }
+
+    const LevelChain& levels = m_faces[0];
+    const float maxLod = float(levels.size() - 1);
+
+    for (int quad = 0; quad < c_CpuLaneCount; quad += 4)
+    {
+        // one LOD per quad from its first row and column
+        float lod = 0.f;
+        if (levels.size() > 1)
+        {
+            float width = float(levels[0].width);
+            float height = float(levels[0].height);
+            float dsdx = (s[quad + 1] - s[quad]) * width;
+            float dtdx = (t[quad + 1] - t[quad]) * height;
+            float dsdy = (s[quad + 2] - s[quad]) * width;
+            float dtdy = (t[quad + 2] - t[quad]) * height;
+            float rhoSquared = std::max(dsdx * dsdx + dtdx * dtdx, dsdy * dsdy + dtdy * dtdy);
+
+            lod = rhoSquared > 1.f ? .5f * log2f(rhoSquared) : 0.f;
+            lod = (lod < maxLod) ? lod : maxLod;
+        }
+
+        int level0 = int(lod);
+        int level1 = (level0 < int(maxLod)) ? level0 + 1 : level0;
+        float levelBlend = lod - float(level0);
+
+        for (int lane = quad; lane < quad + 4; lane++)
+        {
+            float texel[4];
+            _SampleBilinear(levels[level0], s[lane], t[lane], m_repeat, texel);
+
+            if (levelBlend > 0.f)
+            {
+                float coarseTexel[4];
+                _SampleBilinear(levels[level1], s[lane], t[lane], m_repeat, coarseTexel);
+                for (int component = 0; component < 4; component++) {
+                    texel[component] += (coarseTexel[component] - texel[component]) * levelBlend;
+                }
+            }
+
+            for (int component = 0; component < 4; component++) {
+                rgba[component * c_CpuLaneCount + lane] = texel[component];
+            }
+        }
+    }
+}
+
+// ----------------------------------------------------------------------------
+
+void
+STVRCpuTexture::SampleCube(const float* x, const float* y, const float* z, float* rgba) const
+{
+    if (m_faces.size() != 6) {
+        memset(rgba, 0, 4 * c_CpuLaneCount * sizeof(float));
+        return;
+    }
+
+    for (int lane = 0; lane < c_CpuLaneCount; lane++)
+    {
+        // the face selection table of the GL spec, faces in +x -x +y -y +z -z order
+        float absX = fabsf(x[lane]);
+        float absY = fabsf(y[lane]);
+        float absZ = fabsf(z[lane]);
+
+        int faceIdx = 0;
+        float sc = 0.f;
+        float tc = 0.f;
+        float ma = 1.f;
+
+        if (absX >= absY && absX >= absZ) {
+            faceIdx = x[lane] >= 0.f ? 0 : 1;
+            sc = x[lane] >= 0.f ? -z[lane] : z[lane];
+            tc = -y[lane];
+            ma = absX;
+        }
+        else if (absY >= absZ) {
+            faceIdx = y[lane] >= 0.f ? 2 : 3;
+            sc = x[lane];
+            tc = y[lane] >= 0.f ? z[lane] : -z[lane];
+            ma = absY;
+        }
+        else {
+            faceIdx = z[lane] >= 0.f ? 4 : 5;
+            sc = z[lane] >= 0.f ? x[lane] : -x[lane];
+            tc = -y[lane];
+            ma = absZ;
+        }
+
+        if (ma <= 0.f) {
+            ma = 1.f;
+        }
+
+        float texel[4];
+        _SampleBilinear(m_faces[faceIdx][0], .5f * (sc / ma + 1.f), .5f * (tc / ma + 1.f), false, texel);
+
+        for (int component = 0; component < 4; component++) {
+            rgba[component * c_CpuLaneCount + lane] = texel[component];
+        }
+    }
+}
@@ -0,0 +1,62 @@
+#pragma once
+
+#include "STVRAssets.h"
+
+#include <memory>
+#include <vector>
+
+//-----------------------------------------------------------------------------
+// A channel texture in memory for STVRCpuKernel, sampled the way the GPU path
+// uploads it: bilinear with a mip chain (trilinear, LOD from the quad
+// derivatives) when the asset asks for mipmaps, repeat or clamp as the asset
+// says, and the first image row at t = 0.  Cubemap faces are sampled
+// bilinearly from their top level.
+
+class STVRCpuTexture
+{
+public:
+
+    // - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+    // CONSTRO/DESTRO
+
+    STVRCpuTexture();
+    ~STVRCpuTexture();
+
+    // Read the asset's files.  Needs no GL context.
+    bool Load(const STVRAsset& asset);
+
+    // - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+    // ACCESSORS
+
+    bool IsCubeMap() const;
+    int GetWidth() const;
+    int GetHeight() const;
+
+    // Sample one lane group.  rgba gets c_CpuLaneCount reds, then as many
+    // greens, blues and alphas.
+    void Sample2D(const float* s, const float* t, float* rgba) const;
+    void SampleCube(const float* x, const float* y, const float* z, float* rgba) const;
+
+private:
+
+    struct Level
+    {
+        int                 width;
+        int                 height;
+
+        // RGBA, rows from t = 0 up
+        std::vector<float>  texels;
+    };
+
+    typedef std::vector<Level> LevelChain;
+
+    bool _LoadImage(const std::string& filePath, const STVRAsset& asset, LevelChain& levels) const;
+    void _SampleBilinear(const Level& level, float s, float t, bool repeat, float texel[4]) const;
+
+    // one chain for a 2D texture, six for a cubemap
+    std::vector<LevelChain>     m_faces;
+    bool                        m_cubeMap;
+    bool                        m_repeat;
+};
+
+typedef std::shared_ptr<STVRCpuTexture> STVRCpuTexturePtr;
@@ -0,0 +1,354 @@
+#include "STVRFramePacer.h"
+
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <thread>
+
+#if defined(_WIN32)
+#define NOMINMAX
+#include <Windows.h>
+#else
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+// ''''''''''''''''''''''''''''''''''''''''''''''''''''''''''''''''''''''''''''
+// STATIC FUNCTIONS
+// ,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,
+
+// a toy's frames aren't held back until it has this many GPU timings
+static const int c_MinGpuTimingCount = 8;
+
+// HBGLGpuTimer's default query ring; results this many spans late can still
+// belong to the toy before a reset, and program keys repeat across toys
+static const int c_GpuResultsInFlight = 8;
+
+// the margin for what the timings don't see (buffer passes, the driver, the
+// OS waking us late) doubles on a missed refresh and decays per frame made
+static const double c_MinMarginMillisecs = 1.0;
+static const double c_MaxMarginMillisecs = 8.0;
+static const double c_MarginDecayMillisecs = .01;
+
+// sleeping can overshoot by a millisecond or so, the end of a wait spins
+static const double c_SpinInSecs = .002;
+
+// SCHED_FIFO priority for SetRealtimeThread, above everything interactive
+// but below the kernel's own threads
+static const int c_RealtimePriority = 50;
+
+// ''''''''''''''''''''''''''''''''''''''''''''''''''''''''''''''''''''''''''''
+// STVRFramePacer
+// ,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,
+
+bool
+STVRFramePacer::SetRealtimeThread(int cpuIdx)
+{
+#if defined(_WIN32)
+    if (cpuIdx < 0 || cpuIdx >= int(sizeof(DWORD_PTR) * 8) ||
+        !SetThreadAffinityMask(GetCurrentThread(), DWORD_PTR(1) << cpuIdx))
+    {
+        std::cerr << "STVRFramePacer ERROR: cannot pin the render thread to CPU [ " << cpuIdx << " ]" << std::endl;
+        return false;
+    }
+    if (!SetThreadPriority(GetCurrentThread(), THREAD_PRIORITY_TIME_CRITICAL))
+    {
+        std::cerr << "STVRFramePacer ERROR: cannot raise the render thread's priority" << std::endl;
+        return false;
+    }
+#else
+    cpu_set_t cpuSet;
+    CPU_ZERO(&cpuSet);
+    if (cpuIdx < 0 || cpuIdx >= CPU_SETSIZE) {
+        std::cerr << "STVRFramePacer ERROR: cannot pin the render thread to CPU [ " << cpuIdx << " ]" << std::endl;
+        return false;
+    }
+    CPU_SET(cpuIdx, &cpuSet);
+    if (pthread_setaffinity_np(pthread_self(), sizeof(cpuSet), &cpuSet) != 0)
+    {
+        std::cerr << "STVRFramePacer ERROR: cannot pin the render thread to CPU [ " << cpuIdx << " ]" << std::endl;
+        return false;
+    }
+
+    // needs CAP_SYS_NICE or an rtprio limit
+    sched_param schedParam;
+    schedParam.sched_priority = c_RealtimePriority;
+    if (pthread_setschedparam(pthread_self(), SCHED_FIFO, &schedParam) != 0)
+    {
+        std::cerr << "STVRFramePacer ERROR: cannot give the render thread real-time priority" << std::endl;
+        return false;
+    }
+#endif
+    return true;
+}
+
+// ----------------------------------------------------------------------------
+
+STVRFramePacer::STVRFramePacer() :
+m_enabled(true),
+m_frameIndex(0),
+m_renderKeyIdx(0),
+m_gpuResultsToSkip(0),
+m_marginMillisecs(c_MinMarginMillisecs),
+m_predictedRenderMillisecs(0.),
+m_lastWaitMillisecs(0.),
+m_lastFrameEndInSecs(0.),
+m_lateFrameCount(0)
+{
+    for (int keyIdx = 0; keyIdx < c_RenderKeyCount; keyIdx++)
+    {
+        m_renderKeyTimings[keyIdx].renderKey = 0;
+        m_renderKeyTimings[keyIdx].lastUsedFrame = 0;
+        _ClearWindow(m_renderKeyTimings[keyIdx].gpuTimes);
+    }
+    _ClearWindow(m_cpuTimes);
+}
+
+// ----------------------------------------------------------------------------
+
+STVRFramePacer::~STVRFramePacer()
+{
+
+}
+
+// ----------------------------------------------------------------------------
+
+bool
+STVRFramePacer::IsEnabled() const
+{
+    return m_enabled;
+}
+
+// ----------------------------------------------------------------------------
+
+unsigned int
+STVRFramePacer::GetFrameIndex() const
+{
+    return m_frameIndex;
+}
+
+// ----------------------------------------------------------------------------
+
+double
+STVRFramePacer::GetPredictedRenderMillisecs() const
+{
+    return m_predictedRenderMillisecs;
+}
+
+// ----------------------------------------------------------------------------
+
+double
+STVRFramePacer::GetLastWaitMillisecs() const
+{
+    return m_lastWaitMillisecs;
+}
+
+// ----------------------------------------------------------------------------
+
+double
+STVRFramePacer::GetMarginMillisecs() const
+{
+    return m_marginMillisecs;
+}
+
+// ----------------------------------------------------------------------------
+
+unsigned long long
+STVRFramePacer::GetLateFrameCount() const
+{
+    return m_lateFrameCount;
+}
+
+// ----------------------------------------------------------------------------
+
+void
+STVRFramePacer::SetEnabled(bool enabled)
+{
+    m_enabled = enabled;
+}
+
+// ----------------------------------------------------------------------------
+
+void
+STVRFramePacer::ResetTimings()
+{
+    for (int keyIdx = 0; keyIdx < c_RenderKeyCount; keyIdx++)
+    {
+        m_renderKeyTimings[keyIdx].lastUsedFrame = 0;
+        _ClearWindow(m_renderKeyTimings[keyIdx].gpuTimes);
+    }
+    m_gpuResultsToSkip = c_GpuResultsInFlight;
+}
+
+// ----------------------------------------------------------------------------
+
+void
+STVRFramePacer::SetRenderKey(unsigned long long renderKey)
+{
+    if (renderKey == m_renderKeyTimings[m_renderKeyIdx].renderKey) {
+        return;
+    }
+
+    int keyIdx = _FindRenderKey(renderKey);
+    if (keyIdx < 0)
+    {
+        // take over the timings of the key drawn longest ago
+        keyIdx = 0;
+        for (int otherIdx = 1; otherIdx < c_RenderKeyCount; otherIdx++)
+        {
+            if (m_renderKeyTimings[otherIdx].lastUsedFrame < m_renderKeyTimings[keyIdx].lastUsedFrame) {
+                keyIdx = otherIdx;
+            }
+        }
+        m_renderKeyTimings[keyIdx].renderKey = renderKey;
+        _ClearWindow(m_renderKeyTimings[keyIdx].gpuTimes);
+    }
+
+    m_renderKeyIdx = keyIdx;
+    m_renderKeyTimings[keyIdx].lastUsedFrame = m_frameIndex;
+}
+
+// ----------------------------------------------------------------------------
+
+void
+STVRFramePacer::RecordGpuTime(unsigned long long renderKey, double millisecs)
+{
+    if (m_gpuResultsToSkip > 0)
+    {
+        m_gpuResultsToSkip--;
+        return;
+    }
+
+    // a key drawn a few frames ago still keeps its results for when it is
+    // drawn again
+    int keyIdx = _FindRenderKey(renderKey);
+    if (keyIdx >= 0) {
+        _AddToWindow(m_renderKeyTimings[keyIdx].gpuTimes, millisecs);
+    }
+}
+
+// ----------------------------------------------------------------------------
+
+void
+STVRFramePacer::RecordCpuTime(double millisecs)
+{
+    _AddToWindow(m_cpuTimes, millisecs);
+}
+
+// ----------------------------------------------------------------------------
+
+void
+STVRFramePacer::WaitForRenderStart(ovrHmd hmd)
+{
+    // Asking for the next frame index gets the timing BeginFrame will use:
+    // it runs from when the last EndFrame returned, however late we start.
+    m_frameIndex++;
+    ovrFrameTiming frameTiming = ovrHmd_GetFrameTiming(hmd, m_frameIndex);
+    double refreshInSecs = frameTiming.NextFrameSeconds - frameTiming.ThisFrameSeconds;
+
+    if (m_lastFrameEndInSecs > 0. && refreshInSecs > 0. &&
+        frameTiming.ThisFrameSeconds - m_lastFrameEndInSecs > 1.5 * refreshInSecs)
+    {
+        m_lateFrameCount++;
+
+        // only back off when starting late could have been the cause
+        if (m_lastWaitMillisecs > 0.) {
+            m_marginMillisecs = std::min(m_marginMillisecs * 2., c_MaxMarginMillisecs);
+        }
+    }
+    else
+    {
+        m_marginMillisecs = std::max(m_marginMillisecs - c_MarginDecayMillisecs, c_MinMarginMillisecs);
+    }
+    m_lastFrameEndInSecs = frameTiming.ThisFrameSeconds;
+
+    // The key is the last frame's, the scale this one draws at is picked
+    // after the wait.  It moves little from frame to frame, and when it
+    // drops the prediction only starts the frame early.
+    RenderKeyTimings& keyTimings = m_renderKeyTimings[m_renderKeyIdx];
+    keyTimings.lastUsedFrame = m_frameIndex;
+
+    m_predictedRenderMillisecs = 0.;
+    m_lastWaitMillisecs = 0.;
+    if (!m_enabled || keyTimings.gpuTimes.count < c_MinGpuTimingCount || m_cpuTimes.count == 0) {
+        return;
+    }
+
+    // the GPU timings are per eye, and the CPU submits before the GPU is done
+    m_predictedRenderMillisecs = _GetWindowMax(m_cpuTimes) + _GetWindowMax(keyTimings.gpuTimes) * ovrEye_Count + m_marginMillisecs;
+
+    double deadlineInSecs = (frameTiming.TimewarpPointSeconds > 0.) ?
+        frameTiming.TimewarpPointSeconds : frameTiming.NextFrameSeconds;
+    double nowInSecs = ovr_GetTimeInSeconds();
+    double startInSecs = deadlineInSecs - m_predictedRenderMillisecs / 1000.;
+
+    // never hold a frame back more than a refresh, whatever the timing says
+    if (refreshInSecs > 0.) {
+        startInSecs = std::min(startInSecs, nowInSecs + refreshInSecs);
+    }
+    if (startInSecs <= nowInSecs) {
+        return;
+    }
+
+    while (startInSecs - ovr_GetTimeInSeconds() > c_SpinInSecs) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    ovr_WaitTillTime(startInSecs);
+
+    m_lastWaitMillisecs = (ovr_GetTimeInSeconds() - nowInSecs) * 1000.;
+}
+
+// ----------------------------------------------------------------------------
+
+void
+STVRFramePacer::_ClearWindow(TimingWindow& window)
+{
+    window.count = 0;
+    window.nextIdx = 0;
+}
+
+// ----------------------------------------------------------------------------
+
+void
+STVRFramePacer::_AddToWindow(TimingWindow& window, double millisecs)
+{
+    window.millisecs[window.nextIdx] = millisecs;
+    window.nextIdx = (window.nextIdx + 1) % c_TimingWindowSize;
+    if (window.count < c_TimingWindowSize) {
+        window.count++;
+    }
+}
+
+// ----------------------------------------------------------------------------
+
+double
+STVRFramePacer::_GetWindowMax(const TimingWindow& window)
+{
+    double maxMillisecs = 0.;
+    for (int sampleIdx = 0; sampleIdx < window.count; sampleIdx++)
+    {
+        if (window.millisecs[sampleIdx] > maxMillisecs) {
+            maxMillisecs = window.millisecs[sampleIdx];
+        }
+    }
+    return maxMillisecs;
+}
+
+// ----------------------------------------------------------------------------
+
+int
+STVRFramePacer::_FindRenderKey(unsigned long long renderKey) const
+{
+    // the current key first, the others can share its value until they are
+    // taken over
+    if (m_renderKeyTimings[m_renderKeyIdx].renderKey == renderKey) {
+        return m_renderKeyIdx;
+    }
+    for (int keyIdx = 0; keyIdx < c_RenderKeyCount; keyIdx++)
+    {
+        if (m_renderKeyTimings[keyIdx].renderKey == renderKey && m_renderKeyTimings[keyIdx].lastUsedFrame > 0) {
+            return keyIdx;
+        }
+    }
+    return -1;
+}
@@ -0,0 +1,121 @@
+#pragma once
+
+#include "OVR_CAPI.h"
+
+//-----------------------------------------------------------------------------
+// Starts each frame as late as it can and still make timewarp.  With
+// timewarp on, LibOVR's distortion waits for the frame's timewarp point
+// (ovrFrameTiming::TimewarpPointSeconds) anyway, so a frame that starts
+// right after the last one's present renders early and then sits, and the
+// time and poses it sampled go stale while it does.  The pacer predicts how
+// long this toy takes to render from its recent timings (the slowest CPU
+// submit and the slowest GPU draw of the last few dozen frames, plus a
+// margin) and sleeps until that long before the timewarp point.
+//
+// When a frame it held back still misses its refresh the margin doubles,
+// and it shrinks back a little every frame that makes it.  Until a toy has
+// enough GPU timings it doesn't hold frames back at all.
+//
+// GPU timings are kept per render key, the program drawing the toy and the
+// scale it draws at, since a specialized program or a viewport shrunk while
+// the head turns takes a different time than the full size base program.
+// The last few keys keep their timings, so a head turn, which switches keys
+// and back, doesn't leave the pacer starting over without any.
+//
+// Everything is timed with ovr_GetTimeInSeconds, which is the clock the
+// app times frames and playback with too.  Render thread only.
+
+class STVRFramePacer
+{
+public:
+
+    // - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+    // PUBLIC STATIC
+
+    // Gives the calling thread real-time priority and pins it to one CPU,
+    // so it is neither preempted nor moved while it renders.
+    static bool SetRealtimeThread(int cpuIdx);
+
+    // - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+    // CONSTRO/DESTRO
+
+    STVRFramePacer();
+    ~STVRFramePacer();
+
+    // - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+    // ACCESSORS
+
+    bool IsEnabled() const;
+
+    // The frame WaitForRenderStart paced, for ovrHmd_BeginFrame.
+    unsigned int GetFrameIndex() const;
+
+    // What the last frame was expected to take, margin included.  Zero when
+    // it wasn't held back.
+    double GetPredictedRenderMillisecs() const;
+    double GetLastWaitMillisecs() const;
+    double GetMarginMillisecs() const;
+
+    // Frames that took more than 1.5 refreshes, held back or not.
+    unsigned long long GetLateFrameCount() const;
+
+    // - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+    // MODIFIERS
+
+    void SetEnabled(bool enabled);
+
+    // A different toy: forget the timings of the last one.
+    void ResetTimings();
+
+    // What draws the toy next, the program and the scale; only the GPU
+    // timings recorded under it predict the frames.
+    void SetRenderKey(unsigned long long renderKey);
+
+    // A finished HBGLGpuTimer span, one per eye, tagged with the render key
+    // it was drawn under.
+    void RecordGpuTime(unsigned long long renderKey, double millisecs);
+
+    // Drawing both eyes up to EndFrame.
+    void RecordCpuTime(double millisecs);
+
+    // Call before sampling the frame's time and poses.
+    void WaitForRenderStart(ovrHmd hmd);
+
+private:
+
+    static const int c_TimingWindowSize = 32;
+    static const int c_RenderKeyCount = 8;
+
+    struct TimingWindow
+    {
+        double      millisecs[c_TimingWindowSize];
+        int         count;
+        int         nextIdx;
+    };
+
+    struct RenderKeyTimings
+    {
+        unsigned long long      renderKey;
+        unsigned int            lastUsedFrame;
+        TimingWindow            gpuTimes;
+    };
+
+    static void _ClearWindow(TimingWindow& window);
+    static void _AddToWindow(TimingWindow& window, double millisecs);
+    static double _GetWindowMax(const TimingWindow& window);
+
+    // -1 if the key has no timings kept
+    int _FindRenderKey(unsigned long long renderKey) const;
+
+    bool                    m_enabled;
+    unsigned int            m_frameIndex;
+    int                     m_renderKeyIdx;
+    int                     m_gpuResultsToSkip;
+    RenderKeyTimings        m_renderKeyTimings[c_RenderKeyCount];
+    TimingWindow            m_cpuTimes;
+    double                  m_marginMillisecs;
+    double                  m_predictedRenderMillisecs;
+    double                  m_lastWaitMillisecs;
+    double                  m_lastFrameEndInSecs;
+    unsigned long long      m_lateFrameCount;
+};
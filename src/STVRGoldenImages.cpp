@@ -0,0 +1,303 @@
+#include "STVRGoldenImages.h"
+#include "HBGLUtils.h"
+
+#include "SOIL.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+
+// ''''''''''''''''''''''''''''''''''''''''''''''''''''''''''''''''''''''''''''
+// STATIC FUNCTIONS
+// ,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,
+
+// A frame passes when it is at least this close to its golden.  The slack is
+// for drivers, GPUs and the CPU fallback, which all round a little
+// differently.
+static const double c_GoldenMinPsnr = 35.;
+static const double c_GoldenMinSsim = .98;
+
+// differences are hard to see at their real size
+static const int c_DiffImageGain = 4;
+
+static const float c_GoldenTimesInSecs[] = { 0.f, 1.5f, 10.f };
+
+// straight ahead, turned and tilted, and stepped to the side and forward
+static const STVRGoldenPose c_GoldenPoses[] =
+{
+    { "ahead", 0.f, 0.f, { 0.f, 0.f, 0.f } },
+    { "turned", 60.f, -15.f, { 0.f, 0.f, 0.f } },
+    { "moved", 0.f, 0.f, { .5f, .25f, -1.f } }
+};
+
+// ----------------------------------------------------------------------------
+
+static float
+Luma(const unsigned char* pixel)
+{
+    return .299f * pixel[0] + .587f * pixel[1] + .114f * pixel[2];
+}
+
+// ''''''''''''''''''''''''''''''''''''''''''''''''''''''''''''''''''''''''''''
+// STVRGoldenImages
+// ,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,
+
+STVRImageDifference
+STVRGoldenImages::CompareImages(const unsigned char* expected, const unsigned char* actual, int width, int height)
+{
+    STVRImageDifference difference;
+
+    double squaredError = 0.;
+    size_t pixelCount = size_t(width) * height;
+    for (size_t pixelIdx = 0; pixelIdx < pixelCount; pixelIdx++)
+    {
+        for (int component = 0; component < 3; component++)
+        {
+            double error = double(expected[pixelIdx * 4 + component]) - actual[pixelIdx * 4 + component];
+            squaredError += error * error;
+        }
+    }
+    double meanSquaredError = squaredError / (pixelCount * 3);
+    difference.psnr = (meanSquaredError > 0.) ? std::min(10. * log10(255. * 255. / meanSquaredError), c_IdenticalPsnr) : c_IdenticalPsnr;
+
+    // 8x8 windows half overlapping, or one window over a smaller image
+    const double c1 = (.01 * 255.) * (.01 * 255.);
+    const double c2 = (.03 * 255.) * (.03 * 255.);
+    int windowWidth = std::min(width, 8);
+    int windowHeight = std::min(height, 8);
+    double ssimSum = 0.;
+    int windowCount = 0;
+
+    for (int windowY = 0; windowY + windowHeight <= height; windowY += std::max(windowHeight / 2, 1))
+    {
+        for (int windowX = 0; windowX + windowWidth <= width; windowX += std::max(windowWidth / 2, 1))
+        {
+            double sumExpected = 0., sumActual = 0.;
+            double sumExpected2 = 0., sumActual2 = 0., sumProduct = 0.;
+            for (int y = windowY; y < windowY + windowHeight; y++)
+            {
+                for (int x = windowX; x < windowX + windowWidth; x++)
+                {
+                    size_t offset = (size_t(y) * width + x) * 4;
+                    double lumaExpected = Luma(expected + offset);
+                    double lumaActual = Luma(actual + offset);
+                    sumExpected += lumaExpected;
+                    sumActual += lumaActual;
+                    sumExpected2 += lumaExpected * lumaExpected;
+                    sumActual2 += lumaActual * lumaActual;
+                    sumProduct += lumaExpected * lumaActual;
+                }
+            }
+
+            double sampleCount = double(windowWidth) * windowHeight;
+            double meanExpected = sumExpected / sampleCount;
+            double meanActual = sumActual / sampleCount;
+            double varianceExpected = sumExpected2 / sampleCount - meanExpected * meanExpected;
+            double varianceActual = sumActual2 / sampleCount - meanActual * meanActual;
+            double covariance = sumProduct / sampleCount - meanExpected * meanActual;
+
+            ssimSum += ((2. * meanExpected * meanActual + c1) * (2. * covariance + c2)) /
+                ((meanExpected * meanExpected + meanActual * meanActual + c1) * (varianceExpected + varianceActual + c2));
+            windowCount++;
+        }
+    }
+    difference.ssim = (windowCount > 0) ? ssimSum / windowCount : 1.;
+
+    return difference;
+}
+
+// ----------------------------------------------------------------------------
+
+size_t
+STVRGoldenImages::GetPoseCount()
+{
+    return sizeof(c_GoldenPoses) / sizeof(c_GoldenPoses[0]);
+}
+
+// ----------------------------------------------------------------------------
+
+const STVRGoldenPose&
+STVRGoldenImages::GetPose(size_t poseIdx)
+{
+    return c_GoldenPoses[poseIdx];
+}
+
+// ----------------------------------------------------------------------------
+
+size_t
+STVRGoldenImages::GetTimeCount()
+{
+    return sizeof(c_GoldenTimesInSecs) / sizeof(c_GoldenTimesInSecs[0]);
+}
+
+// ----------------------------------------------------------------------------
+
+float
+STVRGoldenImages::GetTimeInSecs(size_t timeIdx)
+{
+    return c_GoldenTimesInSecs[timeIdx];
+}
+
+// ----------------------------------------------------------------------------
+
+std::string
+STVRGoldenImages::GetCaseName(const std::string& toyPath, const std::string& label, float timeInSecs)
+{
+    std::string toyName = toyPath.substr(toyPath.find_last_of("/\\") + 1);
+    toyName = toyName.substr(0, toyName.find_last_of('.'));
+
+    char timeText[32];
+    snprintf(timeText, sizeof(timeText), "%.2f", timeInSecs);
+    return toyName + "." + label + "." + timeText;
+}
+
+// ----------------------------------------------------------------------------
+
+STVRGoldenImages::STVRGoldenImages(const std::string& goldenDirectory) :
+m_goldenDirectory(goldenDirectory),
+m_diffDirectory(goldenDirectory + "/diffs"),
+m_caseCount(0),
+m_failureCount(0)
+{
+}
+
+// ----------------------------------------------------------------------------
+
+STVRGoldenImages::~STVRGoldenImages()
+{
+
+}
+
+// ----------------------------------------------------------------------------
+
+int
+STVRGoldenImages::GetCaseCount() const
+{
+    return m_caseCount;
+}
+
+// ----------------------------------------------------------------------------
+
+int
+STVRGoldenImages::GetFailureCount() const
+{
+    return m_failureCount;
+}
+
+// ----------------------------------------------------------------------------
+
+bool
+STVRGoldenImages::Begin(bool updateGoldens)
+{
+    return HBGLUtils::MakeDirectory(m_goldenDirectory.c_str()) &&
+        (updateGoldens || HBGLUtils::MakeDirectory(m_diffDirectory.c_str()));
+}
+
+// ----------------------------------------------------------------------------
+
+bool
+STVRGoldenImages::CheckFrame(const std::string& caseName,
+    const std::vector<unsigned char>& frame,
+    int width,
+    int height,
+    double renderMillisecs,
+    bool updateGoldens)
+{
+    m_caseCount++;
+    std::string goldenPath = m_goldenDirectory + "/" + caseName + ".tga";
+
+    if (updateGoldens) {
+        bool stored = _SaveImage(goldenPath, width, height, frame);
+        std::cout << "STVRGoldenImages [ " << caseName << " ]: " << renderMillisecs << " ms, " <<
+            (stored ? "stored" : "NOT STORED") << std::endl;
+        if (!stored) {
+            m_failureCount++;
+        }
+        return stored;
+    }
+
+    std::vector<unsigned char> golden;
+    if (!_LoadImage(goldenPath, width, height, golden)) {
+        std::cout << "STVRGoldenImages [ " << caseName << " ]: " << renderMillisecs <<
+            " ms, FAILED, no golden of this size" << std::endl;
+        _SaveImage(m_diffDirectory + "/" + caseName + ".actual.tga", width, height, frame);
+        m_failureCount++;
+        return false;
+    }
+
+    STVRImageDifference difference = CompareImages(&golden[0], &frame[0], width, height);
+    bool passed = (difference.psnr >= c_GoldenMinPsnr && difference.ssim >= c_GoldenMinSsim);
+    std::cout << "STVRGoldenImages [ " << caseName << " ]: " << renderMillisecs << " ms, PSNR " <<
+        difference.psnr << " dB, SSIM " << difference.ssim << (passed ? ", ok" : ", FAILED") << std::endl;
+    if (passed) {
+        return true;
+    }
+
+    m_failureCount++;
+
+    std::vector<unsigned char> diffImage(frame.size());
+    for (size_t byteIdx = 0; byteIdx < frame.size(); byteIdx++)
+    {
+        int error = c_DiffImageGain * abs(int(frame[byteIdx]) - int(golden[byteIdx]));
+        diffImage[byteIdx] = (byteIdx % 4 == 3) ? 255 : static_cast<unsigned char>(std::min(error, 255));
+    }
+    _SaveImage(m_diffDirectory + "/" + caseName + ".actual.tga", width, height, frame);
+    _SaveImage(m_diffDirectory + "/" + caseName + ".diff.tga", width, height, diffImage);
+    return false;
+}
+
+// ----------------------------------------------------------------------------
+
+void
+STVRGoldenImages::AddFailure(const std::string& toyPath)
+{
+    std::cerr << "STVRGoldenImages ERROR [ " << toyPath << " ]: cannot draw the toy" << std::endl;
+    m_caseCount++;
+    m_failureCount++;
+}
+
+// ----------------------------------------------------------------------------
+
+bool
+STVRGoldenImages::_LoadImage(const std::string& imagePath, int expectedWidth, int expectedHeight, std::vector<unsigned char>& rgba) const
+{
+    int width, height, channels;
+    unsigned char* imageData = SOIL_load_image(imagePath.c_str(), &width, &height, &channels, SOIL_LOAD_RGBA);
+    if (!imageData) {
+        return false;
+    }
+
+    bool sizeMatches = (width == expectedWidth && height == expectedHeight);
+    if (sizeMatches) {
+        // files hold the top row first, frames the bottom row
+        size_t rowBytes = size_t(width) * 4;
+        rgba.resize(rowBytes * height);
+        for (int row = 0; row < height; row++) {
+            memcpy(&rgba[row * rowBytes], imageData + (height - 1 - row) * rowBytes, rowBytes);
+        }
+    }
+
+    SOIL_free_image_data(imageData);
+    return sizeMatches;
+}
+
+// ----------------------------------------------------------------------------
+
+bool
+STVRGoldenImages::_SaveImage(const std::string& imagePath, int width, int height, const std::vector<unsigned char>& rgba) const
+{
+    size_t rowBytes = size_t(width) * 4;
+    std::vector<unsigned char> flipped(rgba.size());
+    for (int row = 0; row < height; row++) {
+        memcpy(&flipped[row * rowBytes], &rgba[(height - 1 - row) * rowBytes], rowBytes);
+    }
+
+    if (!SOIL_save_image(imagePath.c_str(), SOIL_SAVE_TYPE_TGA, width, height, 4, &flipped[0])) {
+        std::cerr << "STVRGoldenImages ERROR: cannot write [ " << imagePath << " ]" << std::endl;
+        return false;
+    }
+    return true;
+}
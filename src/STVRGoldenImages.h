@@ -0,0 +1,104 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+//-----------------------------------------------------------------------------
+// How far a frame is from its golden.  PSNR is over RGB in dB (capped at
+// c_IdenticalPsnr for identical frames); SSIM is the mean structural
+// similarity of the luma over 8x8 windows, 1 for identical frames.
+
+const double c_IdenticalPsnr = 100.;
+
+struct STVRImageDifference
+{
+    double  psnr;
+    double  ssim;
+};
+
+//-----------------------------------------------------------------------------
+// A head pose a golden is drawn from: yaw about y after pitch about x, in
+// degrees, then the position in meters.
+
+struct STVRGoldenPose
+{
+    const char*     name;
+    float           yawDegrees;
+    float           pitchDegrees;
+    float           position[3];
+};
+
+//-----------------------------------------------------------------------------
+// Regression check for toys.  The app draws each toy at a fixed set of
+// iGlobalTime values and head poses (see GetPose and GetTimeInSecs), and
+// every frame is compared with the golden stored for it; a frame below
+// either threshold fails, and its render and an amplified difference image
+// are written next to the goldens (in a "diffs" folder) to look at.
+// Updating stores the frames as the new goldens instead.
+//
+// Goldens are TGA files named after their case, toy.pose.time.tga for the
+// plain ones.  Timing is reported with the differences, so a speedup and
+// what it did to the pixels show up together.
+
+class STVRGoldenImages
+{
+public:
+
+    // - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+    // PUBLIC STATIC
+
+    // rgba frames of the same size, in the same row order
+    static STVRImageDifference CompareImages(const unsigned char* expected, const unsigned char* actual, int width, int height);
+
+    static size_t GetPoseCount();
+    static const STVRGoldenPose& GetPose(size_t poseIdx);
+
+    static size_t GetTimeCount();
+    static float GetTimeInSecs(size_t timeIdx);
+
+    // toy.label.time, where toy is the file name of toyPath without its
+    // extension
+    static std::string GetCaseName(const std::string& toyPath, const std::string& label, float timeInSecs);
+
+    // - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+    // CONSTRO/DESTRO
+
+    explicit STVRGoldenImages(const std::string& goldenDirectory);
+    ~STVRGoldenImages();
+
+    // - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+    // ACCESSORS
+
+    int GetCaseCount() const;
+    int GetFailureCount() const;
+
+    // - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+    // MODIFIERS
+
+    // Create the golden and diff folders.  Returns false if they cannot be.
+    bool Begin(bool updateGoldens);
+
+    // Check the rgba frame of caseName, width x height and bottom row
+    // first, against its golden, or store it as the golden.  Returns false
+    // if the frame failed.
+    bool CheckFrame(const std::string& caseName,
+        const std::vector<unsigned char>& frame,
+        int width,
+        int height,
+        double renderMillisecs,
+        bool updateGoldens);
+
+    // Count a toy that could not be drawn at all as a failed case.
+    void AddFailure(const std::string& toyPath);
+
+private:
+
+    bool _LoadImage(const std::string& imagePath, int expectedWidth, int expectedHeight, std::vector<unsigned char>& rgba) const;
+    bool _SaveImage(const std::string& imagePath, int width, int height, const std::vector<unsigned char>& rgba) const;
+
+    std::string     m_goldenDirectory;
+    std::string     m_diffDirectory;
+
+    int             m_caseCount;
+    int             m_failureCount;
+};
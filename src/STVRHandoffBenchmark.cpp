@@ -0,0 +1,248 @@
+#include "STVRHandoffBenchmark.h"
+#include "HBGLTripleBuffer.h"
+
+#include "Kernel/OVR_Lockless.h"
+
+#include <atomic>
+#include <memory>
+#include <sstream>
+#include <thread>
+
+using namespace HBGLUtils;
+
+// ''''''''''''''''''''''''''''''''''''''''''''''''''''''''''''''''''''''''''''
+// STATIC FUNCTIONS
+// ,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,
+
+// about an ovrPoseStatef, and a toy's worth of uniforms
+static const int c_PoseValueCount = 22;
+static const int c_UniformValueCount = 256;
+
+// 0 is as fast as the producer can go
+static const int c_WriteIntervalsMicrosecs[] = { 0, 1000 };
+static const char* c_WriteIntervalNames[] = { "unthrottled", "1 kHz" };
+
+template <int ValueCount>
+struct BenchState
+{
+    unsigned int    values[ValueCount];
+};
+
+struct BenchResult
+{
+    double              writesPerSec;
+    double              readsPerSec;
+    double              freshReadsPerSec;
+    STVRBenchSpans      reads;
+    unsigned long long  tornReadCount;
+};
+
+// ----------------------------------------------------------------------------
+
+template <typename State>
+static void
+FillState(State& state, unsigned int sequence)
+{
+    for (size_t valueIdx = 0; valueIdx < sizeof(state.values) / sizeof(state.values[0]); valueIdx++) {
+        state.values[valueIdx] = sequence;
+    }
+}
+
+// ----------------------------------------------------------------------------
+
+template <typename State>
+static bool
+IsStateTorn(const State& state)
+{
+    for (size_t valueIdx = 1; valueIdx < sizeof(state.values) / sizeof(state.values[0]); valueIdx++) {
+        if (state.values[valueIdx] != state.values[0]) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// ----------------------------------------------------------------------------
+
+template <typename State>
+class TripleBufferHandoff
+{
+public:
+
+    static const char* GetName() { return "HBGLTripleBuffer"; }
+
+    TripleBufferHandoff() :
+    m_buffer(State())
+    {
+
+    }
+
+    void Write(unsigned int sequence)
+    {
+        FillState(m_buffer.GetWriteState(), sequence);
+        m_buffer.Publish();
+    }
+
+    void Read(State& state)
+    {
+        m_buffer.Consume();
+        state = m_buffer.GetReadState();
+    }
+
+private:
+
+    HBGLTripleBuffer<State>     m_buffer;
+};
+
+// ----------------------------------------------------------------------------
+
+template <typename State>
+class LocklessUpdaterHandoff
+{
+public:
+
+    static const char* GetName() { return "OVR::LocklessUpdater"; }
+
+    LocklessUpdaterHandoff()
+    {
+        // the slots start out uninitialized
+        Write(0);
+        Write(0);
+    }
+
+    void Write(unsigned int sequence)
+    {
+        State state;
+        FillState(state, sequence);
+        m_updater.SetState(state);
+    }
+
+    void Read(State& state)
+    {
+        state = m_updater.GetState();
+    }
+
+private:
+
+    OVR::LocklessUpdater<State, State>  m_updater;
+};
+
+// ----------------------------------------------------------------------------
+
+template <typename Handoff, typename State>
+static BenchResult
+RunCase(double seconds, int writeIntervalMicrosecs)
+{
+    std::unique_ptr<Handoff> handoff(new Handoff());
+    std::atomic<bool> stopProducer(false);
+    std::atomic<unsigned long long> writeCount(0);
+
+    std::thread producer([&]() {
+        unsigned int sequence = 0;
+        while (!stopProducer.load(std::memory_order_relaxed))
+        {
+            handoff->Write(++sequence);
+            writeCount.store(sequence, std::memory_order_relaxed);
+            if (writeIntervalMicrosecs > 0) {
+                std::this_thread::sleep_for(std::chrono::microseconds(writeIntervalMicrosecs));
+            }
+        }
+    });
+
+    BenchResult result;
+    result.tornReadCount = 0;
+    unsigned long long freshReadCount = 0;
+    unsigned int lastSequence = 0;
+
+    std::unique_ptr<State> state(new State());
+    STVRBenchClock::time_point startTime = STVRBenchClock::now();
+    STVRBenchClock::time_point endTime = startTime + std::chrono::microseconds((long long)(seconds * 1e6));
+    result.reads.Start();
+    while (result.reads.GetLapTime() < endTime)
+    {
+        handoff->Read(*state);
+        result.reads.Lap();
+
+        if (IsStateTorn(*state)) {
+            result.tornReadCount++;
+        }
+        else if (state->values[0] != lastSequence) {
+            lastSequence = state->values[0];
+            freshReadCount++;
+        }
+    }
+    double elapsedSecs = STVRBench::GetNanosecsSince(startTime) / 1e9;
+
+    stopProducer.store(true);
+    producer.join();
+
+    result.writesPerSec = double(writeCount.load()) / elapsedSecs;
+    result.readsPerSec = double(result.reads.GetCount()) / elapsedSecs;
+    result.freshReadsPerSec = double(freshReadCount) / elapsedSecs;
+    return result;
+}
+
+// ''''''''''''''''''''''''''''''''''''''''''''''''''''''''''''''''''''''''''''
+// STVRHandoffBenchmark
+// ,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,
+
+STVRHandoffBenchmark::STVRHandoffBenchmark(double secondsPerCase) :
+STVRBench("STVRHandoffBenchmark"),
+m_secondsPerCase(secondsPerCase)
+{
+
+}
+
+// ----------------------------------------------------------------------------
+
+STVRHandoffBenchmark::~STVRHandoffBenchmark()
+{
+
+}
+
+// ----------------------------------------------------------------------------
+
+void
+STVRHandoffBenchmark::_RunCases(std::ostream& out)
+{
+    _BeginLine(out) << m_secondsPerCase << " s per case, " << std::thread::hardware_concurrency() <<
+        " hardware threads" << std::endl;
+
+    _RunState<c_PoseValueCount>(out, "pose");
+    _RunState<c_UniformValueCount>(out, "uniforms");
+}
+
+// ----------------------------------------------------------------------------
+
+template <typename Handoff, typename State>
+void
+STVRHandoffBenchmark::_RunCase(std::ostream& out, const char* stateName, int intervalIdx)
+{
+    BenchResult result = RunCase<Handoff, State>(m_secondsPerCase, c_WriteIntervalsMicrosecs[intervalIdx]);
+
+    std::ostringstream caseName;
+    caseName << stateName << ", " << Handoff::GetName() << ", " << c_WriteIntervalNames[intervalIdx];
+
+    _BeginLine(out, caseName.str()) << result.writesPerSec / 1e6 << " M writes/s, " << result.readsPerSec / 1e6 <<
+        " M reads/s (" << result.freshReadsPerSec / 1e6 << " M fresh), read mean " << result.reads.GetMeanNanosecs() <<
+        " ns, worst " << result.reads.GetWorstNanosecs() / 1000. << " us, " << result.tornReadCount << " torn" << std::endl;
+
+    if (result.tornReadCount > 0) {
+        _Fail(caseName.str(), "reads were torn");
+    }
+}
+
+// ----------------------------------------------------------------------------
+
+template <int ValueCount>
+void
+STVRHandoffBenchmark::_RunState(std::ostream& out, const char* stateName)
+{
+    typedef BenchState<ValueCount> State;
+
+    for (int intervalIdx = 0; intervalIdx < int(sizeof(c_WriteIntervalsMicrosecs) / sizeof(c_WriteIntervalsMicrosecs[0])); intervalIdx++)
+    {
+        _RunCase<LocklessUpdaterHandoff<State>, State>(out, stateName, intervalIdx);
+        _RunCase<TripleBufferHandoff<State>, State>(out, stateName, intervalIdx);
+    }
+}
@@ -0,0 +1,40 @@
+#pragma once
+
+#include "STVRBench.h"
+
+//-----------------------------------------------------------------------------
+// Contention microbenchmark for handing state between two threads, comparing
+// HBGLTripleBuffer with the seqlock LibOVR uses for its poses,
+// OVR::LocklessUpdater.  A producer publishes as fast as it can (and again at
+// a tracker's 1 kHz) while a consumer reads as fast as it can, for a head
+// pose sized state and a block of uniforms.  Every state is filled with its
+// sequence number, so a read that mixes two states is counted as torn.
+//
+// For each case it reports the writes and reads per second, how many reads
+// saw something new, the mean and worst read time, and the torn reads (which
+// must be zero for both, a torn read fails the run).
+
+class STVRHandoffBenchmark : public STVRBench
+{
+public:
+
+    // - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+    // CONSTRO/DESTRO
+
+    explicit STVRHandoffBenchmark(double secondsPerCase);
+    ~STVRHandoffBenchmark();
+
+protected:
+
+    void _RunCases(std::ostream& out) override;
+
+private:
+
+    template <typename Handoff, typename State>
+    void _RunCase(std::ostream& out, const char* stateName, int intervalIdx);
+
+    template <int ValueCount>
+    void _RunState(std::ostream& out, const char* stateName);
+
+    double      m_secondsPerCase;
+};
@@ -0,0 +1,243 @@
+#include "STVRJsonBenchmark.h"
+
+#include "OVR_JSON.h"
+#include "Kernel/OVR_Allocator.h"
+#include "HBGLUtils.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+// ''''''''''''''''''''''''''''''''''''''''''''''''''''''''''''''''''''''''''''
+// STATIC FUNCTIONS
+// ,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,
+
+// a machine or two's worth of users, and a kiosk that has seen many
+static const int c_SmallProfileUserCount = 4;
+static const int c_LargeProfileUserCount = 2000;
+
+//-----------------------------------------------------------------------------
+// LibOVR isn't initialized for --bench, so its allocations land here, which
+// also counts them.
+
+class CountingAllocator : public OVR::Allocator
+{
+public:
+
+    CountingAllocator() :
+    m_allocCount(0)
+    {
+
+    }
+
+    void* Alloc(size_t size) override
+    {
+        m_allocCount++;
+        return malloc(size ? size : 1);
+    }
+
+    void* Realloc(void* p, size_t newSize) override
+    {
+        m_allocCount++;
+        return realloc(p, newSize ? newSize : 1);
+    }
+
+    void Free(void* p) override
+    {
+        free(p);
+    }
+
+    unsigned long long GetAllocCount() const
+    {
+        return m_allocCount;
+    }
+
+private:
+
+    unsigned long long  m_allocCount;
+};
+
+static CountingAllocator s_countingAllocator;
+
+// ----------------------------------------------------------------------------
+
+// A ProfileManager database: the users, then each one's values for a DK2.
+static std::string
+MakeProfileText(int userCount)
+{
+    std::string text = "{\n\t\"Oculus Profile Version\":\t2,\n\t\"CurrentProfile\":\t\"user0\",\n\t\"Users\":\t[";
+
+    char entry[1024];
+    for (int userIdx = 0; userIdx < userCount; userIdx++)
+    {
+        snprintf(entry, sizeof(entry), "%s{\n\t\t\t\"User\":\t\"user%d\",\n\t\t\t\"Name\":\t\"Player %d\"\n\t\t}",
+            userIdx ? ", " : "", userIdx, userIdx);
+        text += entry;
+    }
+
+    text += "],\n\t\"TaggedData\":\t[";
+    for (int userIdx = 0; userIdx < userCount; userIdx++)
+    {
+        snprintf(entry, sizeof(entry),
+            "%s{\n\t\t\t\"tags\":\t[{\n\t\t\t\t\t\"User\":\t\"user%d\"\n\t\t\t\t}, {\n\t\t\t\t\t\"Product\":\t\"DK2\"\n\t\t\t\t}],\n"
+            "\t\t\t\"vals\":\t{\n\t\t\t\t\"EyeCup\":\t\"A\",\n\t\t\t\t\"EyeReliefDial\":\t%d,\n\t\t\t\t\"IPD\":\t0.06%d,\n"
+            "\t\t\t\t\"PlayerHeight\":\t1.778,\n\t\t\t\t\"EyeHeight\":\t1.675,\n\t\t\t\t\"Gender\":\t\"Unknown\",\n"
+            "\t\t\t\t\"EyeToNoseDist\":\t[0.032, 0.032],\n\t\t\t\t\"NeckEyeDistance\":\t[0.0805, 0.075],\n"
+            "\t\t\t\t\"MaxEyeToPlateDist\":\t[0.03765, 0.03765],\n\t\t\t\t\"CustomEyeRender\":\tfalse,\n"
+            "\t\t\t\t\"Name\":\t\"Player \\\"%d\\\"\"\n\t\t\t}\n\t\t}",
+            userIdx ? ", " : "", userIdx, userIdx % 10, userIdx % 10, userIdx);
+        text += entry;
+    }
+    text += "]\n}\n";
+
+    return text;
+}
+
+// ----------------------------------------------------------------------------
+
+static bool
+ReadText(const std::string& path, std::string& text)
+{
+    FILE* file = fopen(path.c_str(), "rb");
+    if (!file) {
+        return false;
+    }
+
+    char buffer[4096];
+    size_t readSize = 0;
+    while ((readSize = fread(buffer, 1, sizeof(buffer), file)) > 0) {
+        text.append(buffer, readSize);
+    }
+    fclose(file);
+    return true;
+}
+
+
+// ''''''''''''''''''''''''''''''''''''''''''''''''''''''''''''''''''''''''''''
+// STVRJsonBenchmark
+// ,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,
+
+STVRJsonBenchmark::STVRJsonBenchmark(const std::string& profilePath, int repeatCount) :
+STVRBench("STVRJsonBenchmark"),
+m_profilePath(profilePath),
+m_repeatCount(repeatCount > 0 ? repeatCount : 1)
+{
+
+}
+
+// ----------------------------------------------------------------------------
+
+STVRJsonBenchmark::~STVRJsonBenchmark()
+{
+
+}
+
+// ----------------------------------------------------------------------------
+
+void
+STVRJsonBenchmark::_RunCases(std::ostream& out)
+{
+    bool installedAllocator = false;
+    if (!OVR::Allocator::GetInstance()) {
+        OVR::Allocator::setInstance(&s_countingAllocator);
+        installedAllocator = true;
+    }
+
+    _RunCase(out, "small profile", MakeProfileText(c_SmallProfileUserCount));
+    _RunCase(out, "large profile", MakeProfileText(c_LargeProfileUserCount));
+
+    if (!m_profilePath.empty())
+    {
+        std::string text;
+        if (ReadText(m_profilePath, text)) {
+            _RunCase(out, m_profilePath, text);
+        }
+        else {
+            _Fail(m_profilePath, "cannot read");
+        }
+    }
+
+    if (installedAllocator) {
+        OVR::Allocator::setInstance(NULL);
+    }
+}
+
+// ----------------------------------------------------------------------------
+
+void
+STVRJsonBenchmark::_RunCase(std::ostream& out, const std::string& caseName, const std::string& text)
+{
+    const char* parseError = NULL;
+    OVR::JSONDocument document;
+    OVR::Ptr<OVR::JSON> tree = *OVR::JSON::ParseBuffer(text.c_str(), int(text.size()), &parseError);
+    if (!tree || !document.Parse(text.c_str(), int(text.size()), &parseError))
+    {
+        _Fail(caseName, parseError ? parseError : "cannot parse");
+        return;
+    }
+    if (document.GetRoot()->GetItemCount() != tree->GetItemCount())
+    {
+        _Fail(caseName, "the document and the tree differ");
+        return;
+    }
+
+    // parsing, each way
+    unsigned long long allocCount = s_countingAllocator.GetAllocCount();
+    double documentNanosecs = STVRBench::TimeNanosecs(m_repeatCount, [&text]() {
+        OVR::JSONDocument timedDocument;
+        return timedDocument.Parse(text.c_str(), int(text.size()));
+    });
+    unsigned long long documentAllocCount = (s_countingAllocator.GetAllocCount() - allocCount) / m_repeatCount;
+
+    allocCount = s_countingAllocator.GetAllocCount();
+    double treeNanosecs = STVRBench::TimeNanosecs(m_repeatCount, [&text]() {
+        OVR::JSON* timedTree = OVR::JSON::ParseBuffer(text.c_str(), int(text.size()));
+        int itemCount = timedTree->GetItemCount();
+        timedTree->Release();
+        return itemCount;
+    });
+    unsigned long long treeAllocCount = (s_countingAllocator.GetAllocCount() - allocCount) / m_repeatCount;
+
+    // looking up every member of every user's values, the way a profile is read
+    unsigned documentLookupCount = 0;
+    double documentFound = 0.;
+    STVRBenchClock::time_point startTime = STVRBenchClock::now();
+    const OVR::JSONValue* taggedData = document.GetRoot()->GetItemByName("TaggedData");
+    for (const OVR::JSONValue* tagged = taggedData ? taggedData->GetFirstItem() : NULL; tagged; tagged = tagged->pNext)
+    {
+        const OVR::JSONValue* vals = tagged->GetItemByName("vals");
+        for (const OVR::JSONValue* val = vals ? vals->GetFirstItem() : NULL; val; val = val->pNext)
+        {
+            documentFound += vals->GetItemByName(val->Name)->dValue;
+            documentLookupCount++;
+        }
+    }
+    double documentLookupNanosecs = STVRBench::GetNanosecsSince(startTime);
+
+    double treeFound = 0.;
+    startTime = STVRBenchClock::now();
+    OVR::JSON* treeTaggedData = tree->GetItemByName("TaggedData");
+    for (OVR::JSON* tagged = treeTaggedData ? treeTaggedData->GetFirstItem() : NULL; tagged; tagged = treeTaggedData->GetNextItem(tagged))
+    {
+        OVR::JSON* vals = tagged->GetItemByName("vals");
+        for (OVR::JSON* val = vals ? vals->GetFirstItem() : NULL; val; val = vals->GetNextItem(val))
+        {
+            treeFound += vals->GetItemByName(val->Name)->dValue;
+        }
+    }
+    double treeLookupNanosecs = STVRBench::GetNanosecsSince(startTime);
+
+    _BeginLine(out, caseName) << text.size() / 1024 << " KB, " << document.GetValueCount() << " values" << std::endl;
+    out << "    JSONDocument: parse " << documentNanosecs / 1000. << " us, " << documentAllocCount << " allocations, " <<
+        document.GetArenaSize() / 1024 << " KB arena" << std::endl;
+    out << "    JSON tree:    parse " << treeNanosecs / 1000. << " us, " << treeAllocCount << " allocations" << std::endl;
+    if (documentLookupCount > 0)
+    {
+        out << "    " << documentLookupCount << " lookups by name: JSONDocument " << documentLookupNanosecs / 1000. <<
+            " us, JSON tree " << treeLookupNanosecs / 1000. << " us" << std::endl;
+    }
+
+    if (documentFound != treeFound) {
+        _Fail(caseName, "the document and the tree read different values");
+    }
+}
@@ -0,0 +1,37 @@
+#pragma once
+
+#include "STVRBench.h"
+
+//-----------------------------------------------------------------------------
+// Parse benchmark for LibOVR's JSON, which reads the user profiles when the
+// headset is set up.  Each case parses the same text into an arena
+// OVR::JSONDocument and into the refcounted OVR::JSON tree ProfileManager
+// keeps, timing both and counting their allocations, then times looking up
+// every member of the profile values by name in each.
+//
+// The cases are profile databases of a few and of many users, made up on the
+// spot, and optionally a real file (--bench-json FILE).  A case fails if it
+// doesn't parse or the two parsers disagree on what they read.
+
+class STVRJsonBenchmark : public STVRBench
+{
+public:
+
+    // - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+    // CONSTRO/DESTRO
+
+    // profilePath may be empty
+    STVRJsonBenchmark(const std::string& profilePath, int repeatCount);
+    ~STVRJsonBenchmark();
+
+protected:
+
+    void _RunCases(std::ostream& out) override;
+
+private:
+
+    void _RunCase(std::ostream& out, const std::string& caseName, const std::string& text);
+
+    std::string     m_profilePath;
+    int             m_repeatCount;
+};
@@ -0,0 +1,349 @@
+#include "STVRLensMask.h"
+#include "HBGLUtils.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <iostream>
+
+// ''''''''''''''''''''''''''''''''''''''''''''''''''''''''''''''''''''''''''''
+// STATIC FUNCTIONS
+// ,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,
+
+// Timewarp turns the mesh's lookups by however far the head turned since the
+// frame was predicted, a degree or two; on a DK2 eye texture 2% of the width
+// is about two degrees.
+static const float c_TimewarpMarginFraction = .02f;
+
+// Mesh triangles clamped against the edge of the screen are exactly flat, the
+// smallest real ones are around 1e-4.
+static const float c_MinScreenArea = 1e-9f;
+
+// ''''''''''''''''''''''''''''''''''''''''''''''''''''''''''''''''''''''''''''
+// STVRLensMask
+// ,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,
+
+STVRLensMask::STVRLensMask() :
+m_distortionCaps(0),
+m_width(0),
+m_height(0),
+m_hiddenFraction(0.f),
+m_hiddenVerticesUploaded(false)
+{
+    memset(&m_fov, 0, sizeof(m_fov));
+}
+
+// ----------------------------------------------------------------------------
+
+STVRLensMask::~STVRLensMask()
+{
+
+}
+
+// ----------------------------------------------------------------------------
+
+bool
+STVRLensMask::Build(ovrHmd hmd, ovrEyeType eye, const ovrFovPort& fov, int width, int height, unsigned int distortionCaps)
+{
+    if (width == m_width && height == m_height && distortionCaps == m_distortionCaps &&
+        memcmp(&fov, &m_fov, sizeof(fov)) == 0) {
+        return true;
+    }
+
+    // until the mesh says otherwise, everything is visible
+    m_width = 0;
+    m_height = 0;
+    m_visibleTexels.clear();
+    m_hiddenFraction = 0.f;
+    m_hiddenVertices.clear();
+    m_hiddenVerticesUploaded = false;
+
+    ovrDistortionMesh mesh;
+    if (!ovrHmd_CreateDistortionMesh(hmd, eye, fov, distortionCaps, &mesh)) {
+        std::cerr << "STVRLensMask ERROR [ eye " << eye << " ]: LibOVR made no distortion mesh" << std::endl;
+        return false;
+    }
+
+    ovrSizei textureSize = { width, height };
+    ovrRecti viewport = { { 0, 0 }, textureSize };
+    ovrVector2f uvScaleOffset[2];
+    ovrHmd_GetRenderScaleAndOffset(fov, textureSize, viewport, uvScaleOffset);
+
+    // the GL distortion renderer reads the eye texture upside down unless
+    // told the input is flipped already
+    if (!(distortionCaps & ovrDistortionCap_FlipInput)) {
+        uvScaleOffset[0].y = -uvScaleOffset[0].y;
+        uvScaleOffset[1].y = 1.f - uvScaleOffset[1].y;
+    }
+
+    m_width = width;
+    m_height = height;
+    m_visibleTexels.assign(size_t(width) * height, 0);
+    float margin = .5f;
+    if (distortionCaps & ovrDistortionCap_TimeWarp) {
+        margin += c_TimewarpMarginFraction * std::max(width, height);
+    }
+
+    // the round lens inside the box LibOVR sizes the field of view from
+    ovrFovPort lensFov = ovrHmd_GetLensFov(hmd, eye);
+    float lensCenter[2] = { .5f * (lensFov.RightTan - lensFov.LeftTan), .5f * (lensFov.DownTan - lensFov.UpTan) };
+    float lensRadius[2] = { .5f * (lensFov.RightTan + lensFov.LeftTan), .5f * (lensFov.DownTan + lensFov.UpTan) };
+
+    int channelCount = (distortionCaps & ovrDistortionCap_Chromatic) ? 3 : 1;
+    for (unsigned int index = 0; index + 2 < mesh.IndexCount; index += 3)
+    {
+        const ovrDistortionVertex* corners[3] = {
+            &mesh.pVertexData[mesh.pIndexData[index]],
+            &mesh.pVertexData[mesh.pIndexData[index + 1]],
+            &mesh.pVertexData[mesh.pIndexData[index + 2]]
+        };
+
+        const ovrVector2f& p0 = corners[0]->ScreenPosNDC;
+        const ovrVector2f& p1 = corners[1]->ScreenPosNDC;
+        const ovrVector2f& p2 = corners[2]->ScreenPosNDC;
+        float screenArea = (p1.x - p0.x) * (p2.y - p0.y) - (p2.x - p0.x) * (p1.y - p0.y);
+        if (fabsf(screenArea) < c_MinScreenArea) {
+            continue;
+        }
+
+        if ((distortionCaps & ovrDistortionCap_Vignette) &&
+            corners[0]->VignetteFactor <= 0.f && corners[1]->VignetteFactor <= 0.f && corners[2]->VignetteFactor <= 0.f) {
+            continue;
+        }
+
+        // Green is where the eye looks.  The rim can cut across a triangle
+        // with all three corners outside the lens, but never further from
+        // all of them than its longest edge.
+        float longestEdge = 0.f;
+        for (int edge = 0; edge < 3; edge++)
+        {
+            const ovrVector2f& from = corners[edge]->TanEyeAnglesG;
+            const ovrVector2f& to = corners[(edge + 1) % 3]->TanEyeAnglesG;
+            longestEdge = std::max(longestEdge, sqrtf((to.x - from.x) * (to.x - from.x) + (to.y - from.y) * (to.y - from.y)));
+        }
+
+        bool throughLens = false;
+        for (int corner = 0; corner < 3 && !throughLens; corner++)
+        {
+            float x = (corners[corner]->TanEyeAnglesG.x - lensCenter[0]) / (lensRadius[0] + longestEdge);
+            float y = (corners[corner]->TanEyeAnglesG.y - lensCenter[1]) / (lensRadius[1] + longestEdge);
+            throughLens = (x * x + y * y <= 1.f);
+        }
+        if (!throughLens) {
+            continue;
+        }
+
+        // without chromatic aberration correction only green is sampled
+        for (int channel = 0; channel < channelCount; channel++)
+        {
+            float texels[3][2];
+            for (int corner = 0; corner < 3; corner++)
+            {
+                const ovrVector2f& tanEyeAngles = (channelCount == 1 || channel == 1) ? corners[corner]->TanEyeAnglesG :
+                    ((channel == 0) ? corners[corner]->TanEyeAnglesR : corners[corner]->TanEyeAnglesB);
+                texels[corner][0] = (tanEyeAngles.x * uvScaleOffset[0].x + uvScaleOffset[1].x) * width;
+                texels[corner][1] = (tanEyeAngles.y * uvScaleOffset[0].y + uvScaleOffset[1].y) * height;
+            }
+            _MarkTriangle(texels, margin);
+        }
+    }
+
+    ovrHmd_DestroyDistortionMesh(&mesh);
+
+    m_fov = fov;
+    m_distortionCaps = distortionCaps;
+    _MakeHiddenSpans();
+
+    std::cout << "STVRLensMask [ eye " << eye << " ]: " << width << " x " << height << ", " <<
+        m_hiddenFraction * 100.f << "% of the pixels never reach the lens" << std::endl;
+
+    return true;
+}
+
+// ----------------------------------------------------------------------------
+
+void
+STVRLensMask::Clear()
+{
+    m_hiddenVertexBuffer.reset();
+    m_hiddenVerticesUploaded = false;
+}
+
+// ----------------------------------------------------------------------------
+
+int
+STVRLensMask::GetWidth() const
+{
+    return m_width;
+}
+
+// ----------------------------------------------------------------------------
+
+int
+STVRLensMask::GetHeight() const
+{
+    return m_height;
+}
+
+// ----------------------------------------------------------------------------
+
+float
+STVRLensMask::GetHiddenFraction() const
+{
+    return m_hiddenFraction;
+}
+
+// ----------------------------------------------------------------------------
+
+const std::vector<unsigned char>&
+STVRLensMask::GetVisibleTexels() const
+{
+    return m_visibleTexels;
+}
+
+// ----------------------------------------------------------------------------
+
+void
+STVRLensMask::DrawHiddenIntoStencil()
+{
+    if (m_hiddenVertices.empty()) {
+        return;
+    }
+
+    if (!m_hiddenVerticesUploaded)
+    {
+        if (!m_hiddenVertexBuffer) {
+            m_hiddenVertexBuffer = HBGLBufferResourcePtr(new HBGLBufferResource());
+            m_hiddenVertexBuffer->Generate();
+        }
+        glBindBuffer(GL_ARRAY_BUFFER, m_hiddenVertexBuffer->GetIndex());
+        glBufferData(GL_ARRAY_BUFFER, m_hiddenVertices.size() * sizeof(GLfloat), &m_hiddenVertices[0], GL_STATIC_DRAW);
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+        m_hiddenVerticesUploaded = true;
+    }
+
+    glPushAttrib(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT | GL_STENCIL_BUFFER_BIT | GL_ENABLE_BIT);
+
+    glUseProgram(0);
+    glColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
+    glDepthMask(GL_FALSE);
+    glDisable(GL_DEPTH_TEST);
+    glDisable(GL_CULL_FACE);
+    glEnable(GL_STENCIL_TEST);
+    glStencilMask(1);
+    glStencilFunc(GL_ALWAYS, 1, 1);
+    glStencilOp(GL_KEEP, GL_KEEP, GL_REPLACE);
+
+    glMatrixMode(GL_PROJECTION);
+    glPushMatrix();
+    glLoadIdentity();
+    glMatrixMode(GL_MODELVIEW);
+    glPushMatrix();
+    glLoadIdentity();
+
+    glBindBuffer(GL_ARRAY_BUFFER, m_hiddenVertexBuffer->GetIndex());
+    glEnableClientState(GL_VERTEX_ARRAY);
+    glVertexPointer(2, GL_FLOAT, 0, 0);
+    glDrawArrays(GL_TRIANGLES, 0, GLsizei(m_hiddenVertices.size() / 2));
+    glDisableClientState(GL_VERTEX_ARRAY);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+    glMatrixMode(GL_PROJECTION);
+    glPopMatrix();
+    glMatrixMode(GL_MODELVIEW);
+    glPopMatrix();
+
+    glPopAttrib();
+    HB_CHECK_GL_ERROR();
+}
+
+// ----------------------------------------------------------------------------
+
+// Mark every texel whose square, grown by margin, overlaps the triangle.
+// Texels are wrapped back into the texture like GL_REPEAT wraps lookups.
+void
+STVRLensMask::_MarkTriangle(const float texels[3][2], float margin)
+{
+    float minX = std::min(std::min(texels[0][0], texels[1][0]), texels[2][0]) - margin;
+    float maxX = std::max(std::max(texels[0][0], texels[1][0]), texels[2][0]) + margin;
+    float minY = std::min(std::min(texels[0][1], texels[1][1]), texels[2][1]) - margin;
+    float maxY = std::max(std::max(texels[0][1], texels[1][1]), texels[2][1]) + margin;
+
+    // the mesh never wraps more than once around; don't let a bad one hang us
+    int startX = std::max(int(floorf(minX)), -m_width);
+    int endX = std::min(int(floorf(maxX)), 2 * m_width - 1);
+    int startY = std::max(int(floorf(minY)), -m_height);
+    int endY = std::min(int(floorf(maxY)), 2 * m_height - 1);
+
+    // edge functions, positive inside whichever way the triangle winds
+    float area = (texels[1][0] - texels[0][0]) * (texels[2][1] - texels[0][1]) -
+        (texels[2][0] - texels[0][0]) * (texels[1][1] - texels[0][1]);
+    float winding = (area < 0.f) ? -1.f : 1.f;
+    float edgeX[3], edgeY[3], edgeConstant[3];
+    for (int edge = 0; edge < 3; edge++)
+    {
+        const float* from = texels[edge];
+        const float* to = texels[(edge + 1) % 3];
+        edgeX[edge] = -(to[1] - from[1]) * winding;
+        edgeY[edge] = (to[0] - from[0]) * winding;
+        edgeConstant[edge] = -(edgeX[edge] * from[0] + edgeY[edge] * from[1]);
+    }
+
+    for (int y = startY; y <= endY; y++)
+    {
+        unsigned char* row = &m_visibleTexels[size_t(((y % m_height) + m_height) % m_height) * m_width];
+        for (int x = startX; x <= endX; x++)
+        {
+            // a flat triangle keeps its whole bounding box
+            bool overlaps = true;
+            for (int edge = 0; edge < 3 && overlaps && area != 0.f; edge++)
+            {
+                // the corner of the grown square furthest inside this edge
+                float cornerX = (edgeX[edge] > 0.f) ? x + 1.f + margin : x - margin;
+                float cornerY = (edgeY[edge] > 0.f) ? y + 1.f + margin : y - margin;
+                overlaps = (edgeX[edge] * cornerX + edgeY[edge] * cornerY + edgeConstant[edge] >= 0.f);
+            }
+
+            if (overlaps) {
+                row[((x % m_width) + m_width) % m_width] = 1;
+            }
+        }
+    }
+}
+
+// ----------------------------------------------------------------------------
+
+void
+STVRLensMask::_MakeHiddenSpans()
+{
+    size_t hiddenTexels = 0;
+    for (int y = 0; y < m_height; y++)
+    {
+        const unsigned char* row = &m_visibleTexels[size_t(y) * m_width];
+        for (int x = 0; x < m_width; )
+        {
+            if (row[x]) {
+                x++;
+                continue;
+            }
+
+            int spanStart = x;
+            while (x < m_width && !row[x]) {
+                x++;
+            }
+            hiddenTexels += x - spanStart;
+
+            GLfloat left = 2.f * spanStart / m_width - 1.f;
+            GLfloat right = 2.f * x / m_width - 1.f;
+            GLfloat bottom = 2.f * y / m_height - 1.f;
+            GLfloat top = 2.f * (y + 1) / m_height - 1.f;
+            const GLfloat span[12] = {
+                left, bottom, right, bottom, right, top,
+                right, top, left, top, left, bottom
+            };
+            m_hiddenVertices.insert(m_hiddenVertices.end(), span, span + 12);
+        }
+    }
+
+    m_hiddenFraction = float(hiddenTexels) / (float(m_width) * m_height);
+}
@@ -0,0 +1,88 @@
+#pragma once
+
+#include "HBGLResourceWrappers.h"
+
+#include "OVR_CAPI.h"
+
+#include <GL/glew.h>
+
+#include <memory>
+#include <vector>
+
+using namespace HBGLUtils;
+
+//-----------------------------------------------------------------------------
+// Which pixels of an eye texture ever reach the eye.  LibOVR sizes the field
+// of view from a box around the round lens (ovrHmd_GetLensFov), clamped to
+// the screen, so the corners of the texture are drawn on the screen but
+// hidden by the rim of the lens.  The distortion mesh triangles the lens
+// lets through are drawn in eye texture space (all three chroma channels,
+// with GL_REPEAT wrapping like the eye textures) and every texel one of them
+// touches is visible.  Triangles the mesh squashes flat against the edge of
+// the screen, or that the vignette fades to black, see nothing.
+//
+// The rest is drawn into the stencil buffer before the toy, which then skips
+// those pixels without running the shader.  With timewarp the mesh samples a
+// little outside where it would without, so the visible area is grown by a
+// margin to keep the edge of the view from showing the cleared black.
+//
+// Build needs no GL context, so the CPU renderer can skip the same pixels.
+
+class STVRLensMask
+{
+public:
+
+    // - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+    // CONSTRO/DESTRO
+
+    STVRLensMask();
+    ~STVRLensMask();
+
+    // Work out the mask for an eye texture of width x height rendered with
+    // fov, all of it the render viewport.  Does nothing if the mask is already
+    // for these; returns false (and masks nothing) if LibOVR made no mesh.
+    bool Build(ovrHmd hmd, ovrEyeType eye, const ovrFovPort& fov, int width, int height, unsigned int distortionCaps);
+
+    // Forget the GL buffer; call with the context still current.
+    void Clear();
+
+    // - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+    // ACCESSORS
+
+    int GetWidth() const;
+    int GetHeight() const;
+
+    // fraction of the eye texture's pixels that are never seen
+    float GetHiddenFraction() const;
+
+    // width * height flags, bottom row first, non zero where visible
+    const std::vector<unsigned char>& GetVisibleTexels() const;
+
+    // - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+    // MODIFIERS
+
+    // Set the stencil to 1 under every hidden pixel of the bound eye
+    // framebuffer, leaving colour and depth alone.  Draw the toy with
+    // glStencilFunc(GL_EQUAL, 0, 1) afterwards.
+    void DrawHiddenIntoStencil();
+
+private:
+
+    void _MarkTriangle(const float texels[3][2], float margin);
+    void _MakeHiddenSpans();
+
+    ovrFovPort                  m_fov;
+    unsigned int                m_distortionCaps;
+    int                         m_width;
+    int                         m_height;
+
+    std::vector<unsigned char>  m_visibleTexels;
+    float                       m_hiddenFraction;
+
+    // two triangles per run of hidden pixels in a row, in NDC
+    std::vector<GLfloat>        m_hiddenVertices;
+    HBGLBufferResourcePtr       m_hiddenVertexBuffer;
+    bool                        m_hiddenVerticesUploaded;
+};
+
+typedef std::shared_ptr<STVRLensMask> STVRLensMaskPtr;
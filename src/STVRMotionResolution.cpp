@@ -0,0 +1,158 @@
+#include "STVRMotionResolution.h"
+
+#include <algorithm>
+#include <cmath>
+
+// ''''''''''''''''''''''''''''''''''''''''''''''''''''''''''''''''''''''''''''
+// STATIC FUNCTIONS
+// ,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,
+
+// A brisk look around starts past the start speed, a snap turn reaches the
+// full speed.
+static const float c_DefaultStartDegreesPerSec = 30.f;
+static const float c_DefaultFullDegreesPerSec = 150.f;
+static const float c_DefaultMinScale = .5f;
+static const float c_DefaultRestoreSecs = .3f;
+
+static const float c_DegreesPerRadian = 57.2957795f;
+
+// a hitch shouldn't restore the whole scale in one frame
+static const double c_MaxRestoreStepInSecs = .05;
+
+static const float c_ScaleBucketsPerUnit = 8.f;
+
+// ''''''''''''''''''''''''''''''''''''''''''''''''''''''''''''''''''''''''''''
+// STVRMotionResolution
+// ,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,
+
+STVRMotionResolution::STVRMotionResolution() :
+m_enabled(true),
+m_startDegreesPerSec(c_DefaultStartDegreesPerSec),
+m_fullDegreesPerSec(c_DefaultFullDegreesPerSec),
+m_minScale(c_DefaultMinScale),
+m_restoreSecs(c_DefaultRestoreSecs),
+m_scale(1.f),
+m_degreesPerSec(0.f),
+m_lastUpdateInSecs(0.)
+{
+
+}
+
+// ----------------------------------------------------------------------------
+
+STVRMotionResolution::~STVRMotionResolution()
+{
+
+}
+
+// ----------------------------------------------------------------------------
+
+bool
+STVRMotionResolution::IsEnabled() const
+{
+    return m_enabled;
+}
+
+// ----------------------------------------------------------------------------
+
+float
+STVRMotionResolution::GetScale() const
+{
+    return m_scale;
+}
+
+// ----------------------------------------------------------------------------
+
+unsigned int
+STVRMotionResolution::GetScaleBucket() const
+{
+    // any scale short of full size is a bucket of its own, however close
+    return (unsigned int) std::ceil((1.f - m_scale) * c_ScaleBucketsPerUnit);
+}
+
+// ----------------------------------------------------------------------------
+
+float
+STVRMotionResolution::GetDegreesPerSec() const
+{
+    return m_degreesPerSec;
+}
+
+// ----------------------------------------------------------------------------
+
+ovrRecti
+STVRMotionResolution::GetRenderViewport(const ovrSizei& textureSize) const
+{
+    ovrRecti viewport;
+    viewport.Size.w = std::max(int(textureSize.w * m_scale + .5f), 1);
+    viewport.Size.h = std::max(int(textureSize.h * m_scale + .5f), 1);
+
+    // Without ovrDistortionCap_FlipInput LibOVR flips the viewport's rows
+    // to sample GL's bottom up textures, so the rows GL fills first are the
+    // last ones in LibOVR's terms.
+    viewport.Pos.x = 0;
+    viewport.Pos.y = textureSize.h - viewport.Size.h;
+    return viewport;
+}
+
+// ----------------------------------------------------------------------------
+
+void
+STVRMotionResolution::SetEnabled(bool enabled)
+{
+    m_enabled = enabled;
+}
+
+// ----------------------------------------------------------------------------
+
+bool
+STVRMotionResolution::SetCurve(float startDegreesPerSec, float fullDegreesPerSec, float minScale, float restoreSecs)
+{
+    if (!(startDegreesPerSec >= 0.f && startDegreesPerSec < fullDegreesPerSec &&
+        minScale > 0.f && minScale <= 1.f && restoreSecs >= 0.f))
+    {
+        return false;
+    }
+
+    m_startDegreesPerSec = startDegreesPerSec;
+    m_fullDegreesPerSec = fullDegreesPerSec;
+    m_minScale = minScale;
+    m_restoreSecs = restoreSecs;
+    return true;
+}
+
+// ----------------------------------------------------------------------------
+
+float
+STVRMotionResolution::Update(const ovrVector3f& angularVelocity, double nowInSecs)
+{
+    m_degreesPerSec = c_DegreesPerRadian * std::sqrt(angularVelocity.x * angularVelocity.x +
+        angularVelocity.y * angularVelocity.y + angularVelocity.z * angularVelocity.z);
+
+    float targetScale = m_enabled ? _GetCurveScale(m_degreesPerSec) : 1.f;
+    double elapsedSecs = std::min(nowInSecs - m_lastUpdateInSecs, c_MaxRestoreStepInSecs);
+    m_lastUpdateInSecs = nowInSecs;
+
+    // down at once, back up at a steady rate
+    if (targetScale <= m_scale || m_restoreSecs <= 0.f || !m_enabled) {
+        m_scale = targetScale;
+    }
+    else if (elapsedSecs > 0.) {
+        float restoreStep = float((1. - m_minScale) * elapsedSecs / m_restoreSecs);
+        m_scale = std::min(m_scale + restoreStep, targetScale);
+    }
+    return m_scale;
+}
+
+// ----------------------------------------------------------------------------
+
+float
+STVRMotionResolution::_GetCurveScale(float degreesPerSec) const
+{
+    float t = (degreesPerSec - m_startDegreesPerSec) / (m_fullDegreesPerSec - m_startDegreesPerSec);
+    t = std::min(std::max(t, 0.f), 1.f);
+
+    // eases in and out, so neither end of the curve has a visible kink
+    t = t * t * (3.f - 2.f * t);
+    return 1.f - (1.f - m_minScale) * t;
+}
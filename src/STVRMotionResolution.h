@@ -0,0 +1,77 @@
+#pragma once
+
+#include "OVR_CAPI.h"
+
+//-----------------------------------------------------------------------------
+// Renders fewer pixels while the head turns fast.  Nobody sees detail in the
+// middle of a quick turn, yet that is when a heavy toy drops frames, since
+// timewarp can't hide a miss while the view is moving.  The scale of each
+// eye's viewport follows a curve of the head's angular speed (from
+// ovrTrackingState::HeadPose): full size up to a start speed, easing down to
+// a minimum scale at a full speed.
+//
+// The scale drops as soon as the head speeds up, so the headroom is there
+// on the very frame it is needed, and grows back over a restore time once
+// the head settles so the detail fades in instead of popping.
+//
+// Only the eye texture's RenderViewport shrinks; the texture keeps its size
+// and LibOVR's distortion samples the smaller viewport, so nothing is
+// reallocated as the scale moves.
+
+class STVRMotionResolution
+{
+public:
+
+    // - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+    // CONSTRO/DESTRO
+
+    STVRMotionResolution();
+    ~STVRMotionResolution();
+
+    // - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+    // ACCESSORS
+
+    bool IsEnabled() const;
+
+    // Of each side of the viewport, 1 is the whole eye texture.
+    float GetScale() const;
+
+    // The scale in steps of an eighth, 0 at full size, for telling apart
+    // timings taken at different scales.
+    unsigned int GetScaleBucket() const;
+
+    // The head's angular speed the scale was last picked for.
+    float GetDegreesPerSec() const;
+
+    // The part of an eye texture to render this frame.  GL draws it from the
+    // texture's bottom left corner (glViewport(0, 0, w, h)), which is what
+    // the rectangle says in LibOVR's top down terms.
+    ovrRecti GetRenderViewport(const ovrSizei& textureSize) const;
+
+    // - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+    // MODIFIERS
+
+    void SetEnabled(bool enabled);
+
+    // Speeds in degrees per second.  Returns false, keeping the current
+    // curve, unless 0 <= startSpeed < fullSpeed, 0 < minScale <= 1 and
+    // restoreSecs >= 0.
+    bool SetCurve(float startDegreesPerSec, float fullDegreesPerSec, float minScale, float restoreSecs);
+
+    // Pick this frame's scale from the head's angular velocity (radians per
+    // second) and the frame's time (ovr_GetTimeInSeconds).
+    float Update(const ovrVector3f& angularVelocity, double nowInSecs);
+
+private:
+
+    float _GetCurveScale(float degreesPerSec) const;
+
+    bool        m_enabled;
+    float       m_startDegreesPerSec;
+    float       m_fullDegreesPerSec;
+    float       m_minScale;
+    float       m_restoreSecs;
+    float       m_scale;
+    float       m_degreesPerSec;
+    double      m_lastUpdateInSecs;
+};
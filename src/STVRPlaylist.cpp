@@ -0,0 +1,278 @@
+#include "STVRPlaylist.h"
+#include "HBGLMappedFile.h"
+#include "HBGLUtils.h"
+
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+
+// ''''''''''''''''''''''''''''''''''''''''''''''''''''''''''''''''''''''''''''
+// STVRPlaylist
+// ,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,
+
+STVRPlaylist::STVRPlaylist() :
+m_currentIndex(0),
+m_secondsPerToy(0.f),
+m_gpuBudgetBytes(256 * 1024 * 1024)
+{
+}
+
+// ----------------------------------------------------------------------------
+
+STVRPlaylist::~STVRPlaylist()
+{
+}
+
+// ----------------------------------------------------------------------------
+
+bool
+STVRPlaylist::Load(const std::string& playlistPath)
+{
+    std::string realPlaylistPath = HBGLUtils::GetRealFilePath(playlistPath.c_str());
+
+    HBGLMappedFile playlistFile;
+    if (realPlaylistPath.empty() || !playlistFile.Open(realPlaylistPath)) {
+        std::cerr << "STVRPlaylist ERROR: Could not load playlist [ " << playlistPath << " ] " << std::endl;
+        return false;
+    }
+
+    // toys are relative to the playlist
+    std::string playlistDirectory;
+    size_t separatorPos = realPlaylistPath.find_last_of("/\\");
+    if (separatorPos != std::string::npos) {
+        playlistDirectory = realPlaylistPath.substr(0, separatorPos + 1);
+    }
+
+    m_toyPaths.clear();
+    m_currentIndex = 0;
+
+    const char* playlistData = playlistFile.GetData();
+    const char* playlistEnd = playlistData + playlistFile.GetSize();
+    const char* lineStart = playlistData;
+    unsigned int lineNumber = 1;
+
+    while (lineStart < playlistEnd)
+    {
+        const char* nextLine;
+        const char* lineEnd = HBGLUtils::FindLineEnd(lineStart, playlistEnd, nextLine);
+
+        const char* commentStart = HBGLUtils::FindLineComment(lineStart, lineEnd);
+
+        std::string playlistLine = HBGLUtils::TrimToken(lineStart, commentStart);
+        size_t equalsPos = playlistLine.find('=');
+
+        if (playlistLine.empty()) {
+            // blank or comment
+        }
+        else if (equalsPos != std::string::npos)
+        {
+            std::string settingName = HBGLUtils::TrimToken(playlistLine.c_str(), playlistLine.c_str() + equalsPos);
+            std::string settingValue = playlistLine.substr(equalsPos + 1);
+            double value = atof(settingValue.c_str());
+
+            if (settingName == "SecondsPerToy" && value >= 0.) {
+                m_secondsPerToy = float(value);
+            }
+            else if (settingName == "GpuBudgetMB" && value > 0.) {
+                m_gpuBudgetBytes = size_t(value * 1024. * 1024.);
+            }
+            else {
+                std::cerr << "STVRPlaylist ERROR: skipping line " << lineNumber << " of [ " << realPlaylistPath << " ] " << std::endl;
+            }
+        }
+        else
+        {
+            std::string toyPath = playlistLine;
+            if (toyPath[0] != '/' && toyPath.find(':') == std::string::npos) {
+                toyPath = playlistDirectory + toyPath;
+            }
+
+            std::string realToyPath = HBGLUtils::GetRealFilePath(toyPath.c_str());
+            if (realToyPath.empty()) {
+                std::cerr << "STVRPlaylist ERROR: skipping missing toy [ " << toyPath << " ] on line " << lineNumber << std::endl;
+            }
+            else {
+                m_toyPaths.push_back(realToyPath);
+            }
+        }
+
+        lineStart = nextLine;
+        lineNumber++;
+    }
+
+    if (m_toyPaths.empty()) {
+        std::cerr << "STVRPlaylist ERROR: no toys in [ " << realPlaylistPath << " ] " << std::endl;
+        return false;
+    }
+
+    std::cout << "STVRPlaylist: " << m_toyPaths.size() << " toys in [ " << realPlaylistPath << " ] " << std::endl;
+    return true;
+}
+
+// ----------------------------------------------------------------------------
+
+size_t
+STVRPlaylist::GetToyCount() const
+{
+    return m_toyPaths.size();
+}
+
+// ----------------------------------------------------------------------------
+
+const std::string&
+STVRPlaylist::GetToyPath(size_t toyIdx) const
+{
+    return m_toyPaths[toyIdx];
+}
+
+// ----------------------------------------------------------------------------
+
+size_t
+STVRPlaylist::GetCurrentIndex() const
+{
+    return m_currentIndex;
+}
+
+// ----------------------------------------------------------------------------
+
+size_t
+STVRPlaylist::GetStepIndex(int step) const
+{
+    if (m_toyPaths.empty()) {
+        return 0;
+    }
+
+    long long toyCount = (long long) m_toyPaths.size();
+    long long toyIdx = ((long long) m_currentIndex + step) % toyCount;
+    return size_t(toyIdx < 0 ? toyIdx + toyCount : toyIdx);
+}
+
+// ----------------------------------------------------------------------------
+
+float
+STVRPlaylist::GetSecondsPerToy() const
+{
+    return m_secondsPerToy;
+}
+
+// ----------------------------------------------------------------------------
+
+size_t
+STVRPlaylist::GetGpuBudgetBytes() const
+{
+    return m_gpuBudgetBytes;
+}
+
+// ----------------------------------------------------------------------------
+
+size_t
+STVRPlaylist::GetResidentBytes() const
+{
+    size_t residentBytes = 0;
+    for (ResidentToyList::const_iterator toyIter = m_residentToys.begin();
+        toyIter != m_residentToys.end();
+        toyIter++)
+    {
+        residentBytes += (*toyIter)->gpuBytes;
+    }
+
+    return residentBytes;
+}
+
+// ----------------------------------------------------------------------------
+
+size_t
+STVRPlaylist::GetResidentCount() const
+{
+    return m_residentToys.size();
+}
+
+// ----------------------------------------------------------------------------
+
+void
+STVRPlaylist::SetCurrentIndex(size_t toyIdx)
+{
+    if (toyIdx < m_toyPaths.size()) {
+        m_currentIndex = toyIdx;
+    }
+}
+
+// ----------------------------------------------------------------------------
+
+STVRResidentToyPtr
+STVRPlaylist::FindResident(const std::string& toyPath)
+{
+    for (ResidentToyList::iterator toyIter = m_residentToys.begin();
+        toyIter != m_residentToys.end();
+        toyIter++)
+    {
+        if ((*toyIter)->toyPath == toyPath) {
+            m_residentToys.splice(m_residentToys.begin(), m_residentToys, toyIter);
+            return m_residentToys.front();
+        }
+    }
+
+    return STVRResidentToyPtr();
+}
+
+// ----------------------------------------------------------------------------
+
+void
+STVRPlaylist::InsertResident(const STVRResidentToyPtr& residentToy)
+{
+    if (!residentToy) {
+        return;
+    }
+
+    RemoveResident(residentToy->toyPath);
+    m_residentToys.push_front(residentToy);
+}
+
+// ----------------------------------------------------------------------------
+
+void
+STVRPlaylist::RemoveResident(const std::string& toyPath)
+{
+    for (ResidentToyList::iterator toyIter = m_residentToys.begin();
+        toyIter != m_residentToys.end();
+        toyIter++)
+    {
+        if ((*toyIter)->toyPath == toyPath) {
+            m_residentToys.erase(toyIter);
+            return;
+        }
+    }
+}
+
+// ----------------------------------------------------------------------------
+
+void
+STVRPlaylist::EvictToBudget(const std::string& keptPath)
+{
+    size_t residentBytes = GetResidentBytes();
+
+    ResidentToyList::iterator toyIter = m_residentToys.end();
+    while (residentBytes > m_gpuBudgetBytes && toyIter != m_residentToys.begin())
+    {
+        toyIter--;
+
+        const STVRResidentToy& residentToy = **toyIter;
+        if (residentToy.toyPath == keptPath) {
+            continue;
+        }
+
+        std::cout << "STVRPlaylist: evicting [ " << residentToy.toyPath << " ] ("
+            << residentToy.gpuBytes / (1024 * 1024) << " MB)" << std::endl;
+
+        residentBytes -= residentToy.gpuBytes;
+        toyIter = m_residentToys.erase(toyIter);
+    }
+}
+
+// ----------------------------------------------------------------------------
+
+void
+STVRPlaylist::ClearResident()
+{
+    m_residentToys.clear();
+}
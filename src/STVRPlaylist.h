@@ -0,0 +1,118 @@
+#pragma once
+
+#include "STVRShaders.h"
+#include "STVRBufferPasses.h"
+#include "HBGLResourceWrappers.h"
+
+#include <GL/glew.h>
+
+#include <list>
+#include <memory>
+#include <string>
+#include <vector>
+
+using namespace HBGLUtils;
+
+//-----------------------------------------------------------------------------
+// Everything a toy needs to start drawing the frame it is switched to: the
+// linked (and warmed up) image program, its buffer passes and its channel
+// textures.  Video and audio channels are not kept, they are opened again
+// when the toy is switched to.
+
+struct STVRResidentToy
+{
+    std::string                 toyPath;
+    HBGLShaderProgramPtr        program;
+    STVRBufferPassesPtr         bufferPasses;
+    HBGLTextureResourcePtr      channelTextures[SHADERTOYVR_NUMCHANNELS];
+    GLfloat                     channelResolutions[SHADERTOYVR_NUMCHANNELS][3];
+
+    // GetFileStamp of the toy file when it was built, a resident toy whose
+    // file changed since is stale
+    long long                   modifiedTime;
+    long long                   fileSize;
+
+    // estimated, see ShaderToyVREstimateToyGpuBytes
+    size_t                      gpuBytes;
+};
+
+typedef std::shared_ptr<STVRResidentToy> STVRResidentToyPtr;
+
+//-----------------------------------------------------------------------------
+// A list of toys to rotate through, and the toys kept resident on the GPU so
+// switching between them takes a pointer swap instead of a restart.
+//
+// A playlist file lists one toy per line, relative to the playlist, with //
+// comments and two optional settings:
+//
+//     SecondsPerToy = 120      // kiosk mode, 0 (the default) only switches on keys
+//     GpuBudgetMB = 512        // toys kept resident are evicted to stay under this
+//     shadertoy-clouds.fs
+//     shadertoy-voxels.fs
+//
+// The budget covers the toys kept resident besides the one that is drawing,
+// which is held by the app rather than the playlist.  They are kept most
+// recently used first; when their estimated GPU memory goes over the budget
+// the least recently used ones are dropped, but never the one that is up
+// next.
+
+class STVRPlaylist
+{
+public:
+
+    // - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+    // CONSTRO/DESTRO
+
+    STVRPlaylist();
+    ~STVRPlaylist();
+
+    bool Load(const std::string& playlistPath);
+
+    // - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+    // ACCESSORS
+
+    size_t GetToyCount() const;
+    const std::string& GetToyPath(size_t toyIdx) const;
+    size_t GetCurrentIndex() const;
+
+    // The toy step places away from the current one, wrapping around.
+    size_t GetStepIndex(int step) const;
+
+    float GetSecondsPerToy() const;
+    size_t GetGpuBudgetBytes() const;
+    size_t GetResidentBytes() const;
+    size_t GetResidentCount() const;
+
+    // - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+    // MODIFIERS
+
+    void SetCurrentIndex(size_t toyIdx);
+
+    // Returns null on a miss.  A hit becomes the most recently used toy.
+    STVRResidentToyPtr FindResident(const std::string& toyPath);
+
+    // Add or replace the resident toy with residentToy's path and make it
+    // the most recently used.
+    void InsertResident(const STVRResidentToyPtr& residentToy);
+
+    void RemoveResident(const std::string& toyPath);
+
+    // Drop least recently used toys until the rest fit the budget.  The toy
+    // at keptPath is never dropped.
+    void EvictToBudget(const std::string& keptPath);
+
+    // Release every resident toy.  Call with the context still current.
+    void ClearResident();
+
+private:
+
+    typedef std::list<STVRResidentToyPtr> ResidentToyList;
+
+    std::vector<std::string>    m_toyPaths;
+    size_t                      m_currentIndex;
+    float                       m_secondsPerToy;
+    size_t                      m_gpuBudgetBytes;
+
+    // most recently used first
+    ResidentToyList             m_residentToys;
+};
@@ -0,0 +1,125 @@
+#include "STVRPropertyBenchmark.h"
+
+#include "OVR_CAPI.h"
+#include "CAPI/CAPI_HMDProperties.h"
+#include "Kernel/OVR_Std.h"
+#include "Service/Service_NetSessionCommon.h"
+
+using namespace OVR::CAPI;
+using namespace OVR::Service;
+
+// ''''''''''''''''''''''''''''''''''''''''''''''''''''''''''''''''''''''''''''
+// STATIC FUNCTIONS
+// ,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,
+
+// one of each kind ovrHmd_GetFloatArray reads: HMDState's own, the
+// service's, a profile value and a prefixed one for the service
+static const char* c_PropertyNames[] = { "DK2Latency", "NeckModelVector3f", "IPD", "server:LoggingMask" };
+
+// the names HMDState::getFloatArray answered itself, in the order it
+// compared them
+static const char* c_FloatArrayNames[] = { "ScreenSize", "DistortionClearColor", "DK2Latency" };
+static const HMDPropertyId c_FloatArrayIds[] = { HMDProperty_ScreenSize, HMDProperty_DistortionClearColor, HMDProperty_DK2Latency };
+
+// where HMDState::getFloatArray gets a property from, past its own ids
+static const unsigned c_FromService = 100;
+static const unsigned c_FromProfile = 101;
+
+// ----------------------------------------------------------------------------
+
+// What HMDState::getFloatArray did before the table: compare the name with
+// each one it answers, then ask NetSessionCommon::IsServiceProperty, which
+// compares it with each of the service's names for the getter.
+static unsigned
+GetSourceByComparing(const char* name)
+{
+    for (size_t nameIdx = 0; nameIdx < sizeof(c_FloatArrayNames) / sizeof(c_FloatArrayNames[0]); nameIdx++)
+    {
+        if (OVR::OVR_strcmp(name, c_FloatArrayNames[nameIdx]) == 0) {
+            return c_FloatArrayIds[nameIdx];
+        }
+    }
+    return NetSessionCommon::IsServiceProperty(NetSessionCommon::EGetNumberValues, name) ? c_FromService : c_FromProfile;
+}
+
+// ----------------------------------------------------------------------------
+
+// What it does now, with the name already looked up.
+static unsigned
+GetSource(const HMDProperty* property, const char* name)
+{
+    for (size_t idIdx = 0; property && idIdx < sizeof(c_FloatArrayIds) / sizeof(c_FloatArrayIds[0]); idIdx++)
+    {
+        if (property->Id == c_FloatArrayIds[idIdx]) {
+            return property->Id;
+        }
+    }
+
+    bool fromService = property ? property->IsServiceProperty(NetSessionCommon::EGetNumberValues) :
+        NetSessionCommon::HasBypassPrefix(name);
+    return fromService ? c_FromService : c_FromProfile;
+}
+
+// ----------------------------------------------------------------------------
+
+static unsigned
+GetSourceFromTable(const char* name)
+{
+    return GetSource(HMDPropertyTable::Find(name), name);
+}
+
+// ''''''''''''''''''''''''''''''''''''''''''''''''''''''''''''''''''''''''''''
+// STVRPropertyBenchmark
+// ,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,
+
+STVRPropertyBenchmark::STVRPropertyBenchmark(int lookupCount) :
+STVRBench("STVRPropertyBenchmark"),
+m_lookupCount(lookupCount > 0 ? lookupCount : 1)
+{
+
+}
+
+// ----------------------------------------------------------------------------
+
+STVRPropertyBenchmark::~STVRPropertyBenchmark()
+{
+
+}
+
+// ----------------------------------------------------------------------------
+
+void
+STVRPropertyBenchmark::_RunCases(std::ostream& out)
+{
+    _BeginLine(out) << HMDPropertyTable::GetCount() << " interned names, " << m_lookupCount << " lookups per case" << std::endl;
+
+    for (size_t nameIdx = 0; nameIdx < sizeof(c_PropertyNames) / sizeof(c_PropertyNames[0]); nameIdx++)
+    {
+        const char* name = c_PropertyNames[nameIdx];
+
+        // the key the telemetry keeps, what ovrHmd_GetFloatArrayByKey reads
+        ovrPropertyKey key = ovrHmd_GetPropertyKey(name);
+        const HMDProperty* property = (const HMDProperty*)key;
+        if (GetSourceFromTable(name) != GetSourceByComparing(name) ||
+            (property && GetSource(property, property->Name) != GetSourceByComparing(name)))
+        {
+            _Fail(name, "the table and the string compares disagree");
+            continue;
+        }
+
+        double comparingNanosecs = STVRBench::TimeNanosecs(m_lookupCount, [name]() { return GetSourceByComparing(name); });
+        double tableNanosecs = STVRBench::TimeNanosecs(m_lookupCount, [name]() { return GetSourceFromTable(name); });
+
+        _BeginLine(out, name) << "string compares " << comparingNanosecs << " ns, table " << tableNanosecs << " ns";
+        if (property)
+        {
+            double keyNanosecs = STVRBench::TimeNanosecs(m_lookupCount, [property]() { return GetSource(property, property->Name); });
+            out << ", key " << keyNanosecs << " ns";
+        }
+        else
+        {
+            out << ", not interned";
+        }
+        out << std::endl;
+    }
+}
@@ -0,0 +1,34 @@
+#pragma once
+
+#include "STVRBench.h"
+
+//-----------------------------------------------------------------------------
+// Lookup benchmark for the HMD property names LibOVR interns, which
+// ovrHmd_GetFloatArray and friends look up on every call.  For a few names
+// of each kind (answered by HMDState, handled by the service, left to the
+// profile, and sent to the service with the "server:" prefix) it times
+// working out where ovrHmd_GetFloatArray reads the property from three ways:
+// the way HMDState did before the table, comparing the name with its own
+// names and then NetSessionCommon::IsServiceProperty's white-list; one
+// hashed lookup in OVR::CAPI::HMDPropertyTable; and an interned key from
+// ovrHmd_GetPropertyKey, which the telemetry keeps for DK2Latency.  A name
+// the old and the new path disagree about fails the run.
+
+class STVRPropertyBenchmark : public STVRBench
+{
+public:
+
+    // - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+    // CONSTRO/DESTRO
+
+    explicit STVRPropertyBenchmark(int lookupCount);
+    ~STVRPropertyBenchmark();
+
+protected:
+
+    void _RunCases(std::ostream& out) override;
+
+private:
+
+    int     m_lookupCount;
+};
@@ -0,0 +1,445 @@
+#include "STVRShaderReloader.h"
+#include "STVRAssets.h"
+#include "STVRShaders.h"
+#include "HBGLResourceWrappers.h"
+#include "HBGLUtils.h"
+
+#include <iostream>
+
+// the warm up target only needs to exist, its contents are thrown away
+static const GLsizei c_WarmUpTargetSize = 16;
+
+// ''''''''''''''''''''''''''''''''''''''''''''''''''''''''''''''''''''''''''''
+// STVRShaderReloader
+// ,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,
+
+STVRShaderReloader::STVRShaderReloader() :
+m_sharedWindow(NULL),
+m_stopWorker(false),
+m_requestedVariantKey(0),
+m_finishedVariantKey(0)
+{
+    m_reloading.store(false);
+    m_reloadFinished.store(false);
+    m_buildingVariant.store(false);
+    m_variantFinished.store(false);
+    m_prefetching.store(false);
+    m_prefetchFinished.store(false);
+}
+
+// ----------------------------------------------------------------------------
+
+STVRShaderReloader::~STVRShaderReloader()
+{
+    Shutdown();
+}
+
+// ----------------------------------------------------------------------------
+
+bool
+STVRShaderReloader::Init(GLFWwindow* mainWindow, const std::string& binaryCacheDirectory)
+{
+    if (m_sharedWindow) {
+        return true;
+    }
+
+    m_binaryCacheDirectory = binaryCacheDirectory;
+
+    // The shared context inherits the rest of the hints the main window was
+    // made with, so it has the same version and profile.
+    glfwWindowHint(GLFW_VISIBLE, GL_FALSE);
+    m_sharedWindow = glfwCreateWindow(c_WarmUpTargetSize, c_WarmUpTargetSize, "ShaderToyVR Reloader", NULL, mainWindow);
+    glfwWindowHint(GLFW_VISIBLE, GL_TRUE);
+
+    glfwMakeContextCurrent(mainWindow);
+
+    if (!m_sharedWindow) {
+        std::cerr << "STVRShaderReloader ERROR: could not create a shared GL context, reloading is disabled" << std::endl;
+        return false;
+    }
+
+    m_stopWorker = false;
+    m_worker = std::thread(&STVRShaderReloader::WorkerLoop, this);
+
+    return true;
+}
+
+// ----------------------------------------------------------------------------
+
+void
+STVRShaderReloader::Shutdown()
+{
+    if (!m_sharedWindow) {
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(m_requestMutex);
+        m_stopWorker = true;
+    }
+    m_requestCondition.notify_all();
+
+    if (m_worker.joinable()) {
+        m_worker.join();
+    }
+
+    // a program nobody took was built in the shared context, so it can be
+    // released from whichever context is current now
+    m_finishedReload.reset();
+    m_finishedVariant.reset();
+    m_requestedVariant.reset();
+    m_finishedPrefetch.reset();
+
+    glfwDestroyWindow(m_sharedWindow);
+    m_sharedWindow = NULL;
+}
+
+// ----------------------------------------------------------------------------
+
+bool
+STVRShaderReloader::IsReloading() const
+{
+    return m_reloading.load();
+}
+
+// ----------------------------------------------------------------------------
+
+bool
+STVRShaderReloader::IsBuildingVariant() const
+{
+    return m_buildingVariant.load();
+}
+
+// ----------------------------------------------------------------------------
+
+bool
+STVRShaderReloader::IsPrefetching() const
+{
+    return m_prefetching.load();
+}
+
+// ----------------------------------------------------------------------------
+
+bool
+STVRShaderReloader::RequestReload(const std::string& fragShaderPath)
+{
+    if (!m_sharedWindow || m_reloading.load()) {
+        return false;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(m_requestMutex);
+        m_requestedPath = fragShaderPath;
+        m_reloading.store(true);
+    }
+    m_requestCondition.notify_one();
+
+    return true;
+}
+
+// ----------------------------------------------------------------------------
+
+bool
+STVRShaderReloader::TakeFinishedReload(STVRResidentToyPtr& residentToy)
+{
+    if (!m_reloadFinished.load(std::memory_order_acquire)) {
+        return false;
+    }
+
+    // the worker only holds this lock long enough to publish its result
+    std::lock_guard<std::mutex> lock(m_requestMutex);
+    residentToy = m_finishedReload;
+    m_finishedReload.reset();
+    m_reloadFinished.store(false);
+    m_reloading.store(false);
+
+    return true;
+}
+
+// ----------------------------------------------------------------------------
+
+bool
+STVRShaderReloader::RequestVariant(const HBGLShaderPtr& fragShader, unsigned long long variantKey)
+{
+    if (!m_sharedWindow || m_buildingVariant.load()) {
+        return false;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(m_requestMutex);
+        m_requestedVariant = fragShader;
+        m_requestedVariantKey = variantKey;
+        m_buildingVariant.store(true);
+    }
+    m_requestCondition.notify_one();
+
+    return true;
+}
+
+// ----------------------------------------------------------------------------
+
+bool
+STVRShaderReloader::TakeFinishedVariant(unsigned long long& variantKey, HBGLShaderProgramPtr& program)
+{
+    if (!m_variantFinished.load(std::memory_order_acquire)) {
+        return false;
+    }
+
+    std::lock_guard<std::mutex> lock(m_requestMutex);
+    variantKey = m_finishedVariantKey;
+    program = m_finishedVariant;
+    m_finishedVariant.reset();
+    m_variantFinished.store(false);
+    m_buildingVariant.store(false);
+
+    return true;
+}
+
+// ----------------------------------------------------------------------------
+
+bool
+STVRShaderReloader::RequestPrefetch(const std::string& fragShaderPath)
+{
+    if (!m_sharedWindow || m_prefetching.load()) {
+        return false;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(m_requestMutex);
+        m_requestedPrefetchPath = fragShaderPath;
+        m_prefetching.store(true);
+    }
+    m_requestCondition.notify_one();
+
+    return true;
+}
+
+// ----------------------------------------------------------------------------
+
+bool
+STVRShaderReloader::TakeFinishedPrefetch(STVRResidentToyPtr& residentToy)
+{
+    if (!m_prefetchFinished.load(std::memory_order_acquire)) {
+        return false;
+    }
+
+    std::lock_guard<std::mutex> lock(m_requestMutex);
+    residentToy = m_finishedPrefetch;
+    m_finishedPrefetch.reset();
+    m_prefetchFinished.store(false);
+    m_prefetching.store(false);
+
+    return true;
+}
+
+// ----------------------------------------------------------------------------
+
+void
+STVRShaderReloader::WorkerLoop()
+{
+    glfwMakeContextCurrent(m_sharedWindow);
+
+    for (;;)
+    {
+        std::string fragShaderPath;
+        std::string prefetchPath;
+        HBGLShaderPtr variantShader;
+        unsigned long long variantKey = 0;
+        {
+            std::unique_lock<std::mutex> lock(m_requestMutex);
+            while (!m_stopWorker && m_requestedPath.empty() && !m_requestedVariant && m_requestedPrefetchPath.empty()) {
+                m_requestCondition.wait(lock);
+            }
+
+            if (m_stopWorker) {
+                break;
+            }
+
+            if (!m_requestedPath.empty()) {
+                fragShaderPath.swap(m_requestedPath);
+            }
+            else if (m_requestedVariant) {
+                variantShader.swap(m_requestedVariant);
+                variantKey = m_requestedVariantKey;
+            }
+            else {
+                prefetchPath.swap(m_requestedPrefetchPath);
+            }
+        }
+
+        // the toy is parsed here too, and a reloaded one's images decoded, so
+        // reading them never blocks a frame
+        HBGLShaderProgramPtr program;
+        STVRResidentToyPtr residentToy;
+        if (variantShader) {
+            program = BuildProgram(variantShader, "specialized variant");
+        }
+        else if (!prefetchPath.empty()) {
+            residentToy = BuildResidentToy(prefetchPath, "prefetched toy");
+        }
+        else {
+            residentToy = BuildResidentToy(fragShaderPath, "shader");
+        }
+
+        // make sure every command that built the program has executed before
+        // another context starts using it
+        glFinish();
+
+        std::lock_guard<std::mutex> lock(m_requestMutex);
+        if (variantShader) {
+            m_finishedVariant = program;
+            m_finishedVariantKey = variantKey;
+            m_variantFinished.store(true, std::memory_order_release);
+        }
+        else if (!prefetchPath.empty()) {
+            m_finishedPrefetch = residentToy;
+            m_prefetchFinished.store(true, std::memory_order_release);
+        }
+        else {
+            m_finishedReload = residentToy;
+            m_reloadFinished.store(true, std::memory_order_release);
+        }
+    }
+
+    glfwMakeContextCurrent(NULL);
+}
+
+// ----------------------------------------------------------------------------
+
+HBGLShaderProgramPtr
+STVRShaderReloader::BuildProgram(HBGLShaderPtr& fragShader, const char* buildDescription)
+{
+    HBGLShaderProgramPtr program(new HBGLShaderProgram("ShaderToyVR Screen Quad Shader Program"));
+    program->SetBinaryCacheDirectory(m_binaryCacheDirectory);
+
+    HBGLShaderPtr vertShader(new STVRVertexShader());
+
+    // keep the attribute locations identical to the program being replaced
+    GLint reservedIndex;
+    bool result = program->LoadAndCompileShaders(vertShader, fragShader);
+    program->ReserveAttribLocation("position", &reservedIndex);
+    program->ReserveAttribLocation("texcoord", &reservedIndex);
+    result = result && program->LinkShaders();
+
+    if (!result) {
+        std::cerr << "STVRShaderReloader ERROR: [ " << fragShader->GetName() << " ] " << buildDescription << " did not build (see above), keeping the current shader" << std::endl;
+        return HBGLShaderProgramPtr();
+    }
+
+    WarmUpProgram(*program);
+
+    std::cout << "STVRShaderReloader: [ " << fragShader->GetName() << " ] " << buildDescription << " rebuilt" << std::endl;
+    return program;
+}
+
+// ----------------------------------------------------------------------------
+
+STVRBufferPassesPtr
+STVRShaderReloader::BuildBufferPasses(const HBGLShaderPtr& fragShader)
+{
+    // a pass that does not build reads back black, as it does at startup
+    STVRBufferPassesPtr bufferPasses(new STVRBufferPasses());
+    bufferPasses->Load(static_cast<const STVRFragmentShader*>(&*fragShader), m_binaryCacheDirectory);
+    bufferPasses->AcquireChannelTextures();
+
+    for (int bufferPass = 0; bufferPass < SHADERTOYVR_NUMBUFFERPASSES; bufferPass++)
+    {
+        HBGLShaderProgramPtr passProgram = bufferPasses->GetPassProgram(static_cast<ShaderToyVRBufferPass>(bufferPass));
+        if (passProgram) {
+            WarmUpProgram(*passProgram);
+        }
+    }
+
+    return bufferPasses;
+}
+
+// ----------------------------------------------------------------------------
+
+STVRResidentToyPtr
+STVRShaderReloader::BuildResidentToy(const std::string& fragShaderPath, const char* buildDescription)
+{
+    STVRResidentToyPtr residentToy(new STVRResidentToy());
+    residentToy->toyPath = fragShaderPath;
+    residentToy->gpuBytes = 0;
+
+    // stamped before it is read, so an edit made while it builds makes it
+    // stale rather than getting lost
+    residentToy->modifiedTime = 0;
+    residentToy->fileSize = 0;
+    GetFileStamp(fragShaderPath.c_str(), residentToy->modifiedTime, residentToy->fileSize);
+
+    for (int channelIdx = 0; channelIdx < SHADERTOYVR_NUMCHANNELS; channelIdx++)
+    {
+        residentToy->channelTextures[channelIdx] = HBGLTextureResourcePtr(new HBGLTextureResource());
+        residentToy->channelResolutions[channelIdx][0] = 0.f;
+        residentToy->channelResolutions[channelIdx][1] = 0.f;
+        residentToy->channelResolutions[channelIdx][2] = 0.f;
+    }
+
+    HBGLShaderPtr fragShader(new STVRFragmentShader(fragShaderPath));
+    residentToy->program = BuildProgram(fragShader, buildDescription);
+    if (!residentToy->program) {
+        return residentToy;
+    }
+
+    residentToy->bufferPasses = BuildBufferPasses(fragShader);
+    STVRAssetRegistry::Get().AcquireChannelTextures(static_cast<const STVRFragmentShader*>(&*fragShader),
+        residentToy->channelTextures,
+        residentToy->channelResolutions);
+
+    return residentToy;
+}
+
+// ----------------------------------------------------------------------------
+
+void
+STVRShaderReloader::WarmUpProgram(HBGLShaderProgram& program)
+{
+    // Many drivers finish compiling only when a program is first drawn with,
+    // so draw one small quad here instead of on the first headset frame.
+    HBGLTextureResource colorTexture;
+    colorTexture.Generate();
+    glBindTexture(GL_TEXTURE_2D, colorTexture.GetIndex());
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, c_WarmUpTargetSize, c_WarmUpTargetSize, 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+    glBindTexture(GL_TEXTURE_2D, 0);
+
+    // frame buffers are not shared between contexts, so this one is local
+    HBGLFrameBufferResource frameBuffer;
+    frameBuffer.Generate();
+    glBindFramebuffer(GL_FRAMEBUFFER, frameBuffer.GetIndex());
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, colorTexture.GetIndex(), 0);
+    HB_CHECK_GL_ERROR();
+
+    GLfloat quadVertices[6][4] =
+    {
+        { -1.0f, 1.0f, 0.0f, 1.0f },
+        { 1.0f, 1.0f, 1.0f, 1.0f },
+        { 1.0f, -1.0f, 1.0f, 0.0f },
+
+        { 1.0f, -1.0f, 1.0f, 0.0f },
+        { -1.0f, -1.0f, 0.0f, 0.0f },
+        { -1.0f, 1.0f, 0.0f, 1.0f }
+    };
+
+    HBGLBufferResource quadBuffer;
+    quadBuffer.Generate();
+    glBindBuffer(GL_ARRAY_BUFFER, quadBuffer.GetIndex());
+    glBufferData(GL_ARRAY_BUFFER, sizeof(quadVertices), &quadVertices[0], GL_STATIC_DRAW);
+
+    program.EnableVertexAttrib("position", 2, GL_FLOAT, GL_FALSE, 4 * sizeof(GLfloat), 0);
+    program.EnableVertexAttrib("texcoord", 2, GL_FLOAT, GL_FALSE, 4 * sizeof(GLfloat), (void*)(2 * sizeof(GLfloat)));
+
+    program.ShadersBegin();
+    program.SetUniform2f("iResolution", GLfloat(c_WarmUpTargetSize), GLfloat(c_WarmUpTargetSize));
+
+    glViewport(0, 0, c_WarmUpTargetSize, c_WarmUpTargetSize);
+    glDisable(GL_DEPTH_TEST);
+    glDrawArrays(GL_TRIANGLES, 0, 6);
+    program.ShadersEnd();
+
+    program.DisableVertexAttrib("position");
+    program.DisableVertexAttrib("texcoord");
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    HB_CHECK_GL_ERROR();
+}
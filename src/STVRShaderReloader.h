@@ -0,0 +1,127 @@
+#pragma once
+
+#include "HBGLShaders.h"
+#include "STVRBufferPasses.h"
+#include "STVRPlaylist.h"
+
+#include <GL/glew.h>
+#include <GLFW/glfw3.h>
+
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <string>
+#include <thread>
+
+using namespace HBGLUtils;
+
+//-----------------------------------------------------------------------------
+// Rebuilds the shadertoy program in the background so editing a toy never
+// stalls the headset.  The reloader owns a hidden GLFW window whose context
+// shares objects with the main window; a worker thread keeps that context
+// current, parses the toy, compiles and links a brand new program and its
+// buffer passes, uploads its channel textures, and then draws with each
+// program once into a small offscreen target so the driver finishes any
+// deferred compilation before they are handed over.  The render thread polls
+// for the result between frames and swaps it in, so the old toy keeps drawing
+// until the new one is completely ready.  If the toy does not compile the
+// errors go to the console and the old program stays.
+//
+// The same worker also builds specialized variants of the current toy (see
+// STVRShaderVariantCache) and prefetches the next toy of a playlist, passes,
+// channel textures and all, so switching to it costs the render thread no
+// more than a pointer swap.  A pending reload always goes first, since a
+// variant of a toy that is about to be replaced is wasted work, and
+// prefetches go last.
+
+class STVRShaderReloader
+{
+public:
+
+    // - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+    // CONSTRO/DESTRO
+
+    STVRShaderReloader();
+    ~STVRShaderReloader();
+
+    // Create the shared context and start the worker.  Call on the main
+    // thread (GLFW only creates windows there) with mainWindow's context
+    // current; it is current again when this returns.
+    bool Init(GLFWwindow* mainWindow, const std::string& binaryCacheDirectory);
+
+    // Stop the worker and destroy the shared context.  Call before
+    // glfwTerminate.
+    void Shutdown();
+
+    // - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+    // ACCESSORS
+
+    bool IsReloading() const;
+    bool IsBuildingVariant() const;
+    bool IsPrefetching() const;
+
+    // - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+    // MODIFIERS
+
+    // Queue a rebuild of the toy at fragShaderPath.  Returns false if the
+    // reloader is not running or a rebuild is already in flight.
+    bool RequestReload(const std::string& fragShaderPath);
+
+    // Never blocks on the worker.  Returns true once per finished rebuild;
+    // residentToy has the new, linked and warmed up program, or a null one
+    // if the rebuild failed, along with its built passes and its image and
+    // cubemap channel textures.  Stream channels are not opened.
+    bool TakeFinishedReload(STVRResidentToyPtr& residentToy);
+
+    // Queue a build of fragShader, an already assembled (specialized)
+    // STVRFragmentShader.  variantKey is handed back with the result so the
+    // caller can tell which variant finished.  Returns false if the reloader
+    // is not running or a variant is already in flight.
+    bool RequestVariant(const HBGLShaderPtr& fragShader, unsigned long long variantKey);
+
+    // Same as TakeFinishedReload, for variants.
+    bool TakeFinishedVariant(unsigned long long& variantKey, HBGLShaderProgramPtr& program);
+
+    // Queue a build of another toy, one that is not drawing yet.  Returns
+    // false if the reloader is not running or a prefetch is already in
+    // flight.
+    bool RequestPrefetch(const std::string& fragShaderPath);
+
+    // Same as TakeFinishedReload, for prefetches.  residentToy has the path
+    // the prefetch was requested with and the file stamp the toy had when it
+    // was read, either way; its gpuBytes are not estimated.
+    bool TakeFinishedPrefetch(STVRResidentToyPtr& residentToy);
+
+private:
+
+    void WorkerLoop();
+    HBGLShaderProgramPtr BuildProgram(HBGLShaderPtr& fragShader, const char* buildDescription);
+    STVRBufferPassesPtr BuildBufferPasses(const HBGLShaderPtr& fragShader);
+    STVRResidentToyPtr BuildResidentToy(const std::string& fragShaderPath, const char* buildDescription);
+    void WarmUpProgram(HBGLShaderProgram& program);
+
+    GLFWwindow*                 m_sharedWindow;
+    std::string                 m_binaryCacheDirectory;
+
+    std::thread                 m_worker;
+    std::mutex                  m_requestMutex;
+    std::condition_variable     m_requestCondition;
+    std::string                 m_requestedPath;
+    bool                        m_stopWorker;
+
+    std::atomic<bool>           m_reloading;
+    std::atomic<bool>           m_reloadFinished;
+    STVRResidentToyPtr          m_finishedReload;
+
+    HBGLShaderPtr               m_requestedVariant;
+    unsigned long long          m_requestedVariantKey;
+    std::atomic<bool>           m_buildingVariant;
+    std::atomic<bool>           m_variantFinished;
+    HBGLShaderProgramPtr        m_finishedVariant;
+    unsigned long long          m_finishedVariantKey;
+
+    std::string                 m_requestedPrefetchPath;
+    std::atomic<bool>           m_prefetching;
+    std::atomic<bool>           m_prefetchFinished;
+    STVRResidentToyPtr          m_finishedPrefetch;
+};
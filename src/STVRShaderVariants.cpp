@@ -0,0 +1,182 @@
+#include "STVRShaderVariants.h"
+#include "HBGLUtils.h"
+
+#include <cstring>
+
+// ''''''''''''''''''''''''''''''''''''''''''''''''''''''''''''''''''''''''''''
+// STVRShaderVariantCache
+// ,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,
+
+STVRShaderVariantCache::STVRShaderVariantCache(size_t capacity) :
+m_capacity(capacity < 1 ? 1 : capacity),
+m_baseSourceHash(c_FNV1aOffsetBasis)
+{
+}
+
+// ----------------------------------------------------------------------------
+
+STVRShaderVariantCache::~STVRShaderVariantCache()
+{
+}
+
+// ----------------------------------------------------------------------------
+
+unsigned long long
+STVRShaderVariantCache::GetVariantKey(const STVRShaderConstants& constants) const
+{
+    // the constants are all floats, so there is no padding to hash
+    unsigned long long variantKey = HashFNV1a(&constants, sizeof(constants), m_baseSourceHash) & 0x00FFFFFFFFFFFFFFULL;
+    return variantKey ? variantKey : 1;
+}
+
+// ----------------------------------------------------------------------------
+
+double
+STVRShaderVariantCache::GetAverageGpuTime(unsigned long long variantKey) const
+{
+    VariantTimingMap::const_iterator timingIter = m_timings.find(variantKey);
+    if (timingIter == m_timings.end() || timingIter->second.sampleCount == 0) {
+        return 0.;
+    }
+
+    return timingIter->second.totalMillisecs / timingIter->second.sampleCount;
+}
+
+// ----------------------------------------------------------------------------
+
+void
+STVRShaderVariantCache::PrintReport(std::ostream& outStream) const
+{
+    double baseMillisecs = GetAverageGpuTime(0);
+
+    outStream << "STVRShaderVariantCache: toy GPU time per eye" << std::endl;
+    outStream << "    base program: " << baseMillisecs << " ms" << std::endl;
+
+    for (VariantTimingMap::const_iterator timingIter = m_timings.begin();
+        timingIter != m_timings.end();
+        timingIter++)
+    {
+        if (timingIter->first == 0 || timingIter->second.sampleCount == 0) {
+            continue;
+        }
+
+        const STVRShaderConstants& constants = timingIter->second.constants;
+        double variantMillisecs = GetAverageGpuTime(timingIter->first);
+
+        outStream << "    variant " << constants.resolution[0] << "x" << constants.resolution[1]
+            << " focal " << constants.focalLength
+            << ": " << variantMillisecs << " ms";
+
+        if (baseMillisecs > 0. && variantMillisecs > 0.) {
+            outStream << " (" << baseMillisecs / variantMillisecs << "x)";
+        }
+
+        outStream << std::endl;
+    }
+}
+
+// ----------------------------------------------------------------------------
+
+void
+STVRShaderVariantCache::Reset(const HBGLShaderProgramPtr& baseProgram)
+{
+    m_baseProgram = baseProgram;
+    m_variants.clear();
+    m_timings.clear();
+
+    m_baseSourceHash = c_FNV1aOffsetBasis;
+    if (m_baseProgram && m_baseProgram->GetFragmentShader()) {
+        const GLchar* baseSource = m_baseProgram->GetFragmentShader()->GetSource();
+        if (baseSource) {
+            m_baseSourceHash = HashFNV1a(baseSource, strlen(baseSource));
+        }
+    }
+}
+
+// ----------------------------------------------------------------------------
+
+HBGLShaderPtr
+STVRShaderVariantCache::MakeVariantShader(const STVRShaderConstants& constants) const
+{
+    if (!m_baseProgram) {
+        return HBGLShaderPtr();
+    }
+
+    // FRAGILE: same cast as everywhere else that reads the toy's inputs
+    HBGLShaderPtr baseShaderPtr = m_baseProgram->GetFragmentShader();
+    const STVRFragmentShader* baseShader = static_cast<STVRFragmentShader*>(&*baseShaderPtr);
+
+    return HBGLShaderPtr(new STVRFragmentShader(*baseShader, constants));
+}
+
+// ----------------------------------------------------------------------------
+
+HBGLShaderProgramPtr
+STVRShaderVariantCache::Find(unsigned long long variantKey)
+{
+    for (VariantList::iterator variantIter = m_variants.begin();
+        variantIter != m_variants.end();
+        variantIter++)
+    {
+        if (variantIter->variantKey == variantKey) {
+            m_variants.splice(m_variants.begin(), m_variants, variantIter);
+            return m_variants.front().program;
+        }
+    }
+
+    return HBGLShaderProgramPtr();
+}
+
+// ----------------------------------------------------------------------------
+
+void
+STVRShaderVariantCache::Insert(unsigned long long variantKey,
+    const STVRShaderConstants& constants,
+    const HBGLShaderProgramPtr& program)
+{
+    if (Find(variantKey)) {
+        m_variants.front().program = program;
+        return;
+    }
+
+    if (m_variants.size() >= m_capacity) {
+        m_variants.pop_back();
+    }
+
+    Variant variant;
+    variant.variantKey = variantKey;
+    variant.program = program;
+    m_variants.push_front(variant);
+
+    // timings outlive eviction so the report still covers every variant used
+    if (m_timings.find(variantKey) == m_timings.end()) {
+        VariantTiming& timing = m_timings[variantKey];
+        timing.constants = constants;
+        timing.totalMillisecs = 0.;
+        timing.sampleCount = 0;
+    }
+}
+
+// ----------------------------------------------------------------------------
+
+void
+STVRShaderVariantCache::RecordGpuTime(unsigned long long variantKey, double millisecs)
+{
+    VariantTimingMap::iterator timingIter = m_timings.find(variantKey);
+    if (timingIter == m_timings.end())
+    {
+        // results for variants of an older toy can still arrive after a Reset
+        if (variantKey != 0) {
+            return;
+        }
+
+        VariantTiming& timing = m_timings[0];
+        memset(&timing.constants, 0, sizeof(timing.constants));
+        timing.totalMillisecs = 0.;
+        timing.sampleCount = 0;
+        timingIter = m_timings.find(0);
+    }
+
+    timingIter->second.totalMillisecs += millisecs;
+    timingIter->second.sampleCount++;
+}
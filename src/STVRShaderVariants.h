@@ -0,0 +1,94 @@
+#pragma once
+
+#include "STVRShaders.h"
+
+#include <iostream>
+#include <list>
+#include <map>
+
+using namespace HBGLUtils;
+
+//-----------------------------------------------------------------------------
+// Keeps the most recently used specialized variants of the current toy.  A
+// variant is the toy with an STVRShaderConstants set baked in (see the
+// specializing STVRFragmentShader constructor); it is keyed by a hash of the
+// base toy's source and the constants, so variants of an older edit of the
+// toy can never be mistaken for variants of the current one.  Going back to
+// constants that were used recently (stepping the focal length up and back
+// down, say) finds the variant here instead of compiling it again.
+//
+// The cache also keeps the GPU time measured for the base program and for
+// each variant, so the benefit of specializing can be reported.
+
+class STVRShaderVariantCache
+{
+public:
+
+    // - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+    // CONSTRO/DESTRO
+
+    STVRShaderVariantCache(size_t capacity = 4);
+    ~STVRShaderVariantCache();
+
+    // - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+    // ACCESSORS
+
+    // 0 is never returned, callers use it to mean the base program.  The
+    // top byte is always clear, so callers can tag a key with more.
+    unsigned long long GetVariantKey(const STVRShaderConstants& constants) const;
+
+    // Average GPU time of the program with this key, 0 if it was never
+    // measured.
+    double GetAverageGpuTime(unsigned long long variantKey) const;
+
+    // Print the average GPU time of the base program and of every variant
+    // measured since the last Reset, with the speedup of each variant.
+    void PrintReport(std::ostream& outStream) const;
+
+    // - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+    // MODIFIERS
+
+    // Drop every variant (and its timings) and start specializing
+    // baseProgram.
+    void Reset(const HBGLShaderProgramPtr& baseProgram);
+
+    // The fragment shader a variant with these constants is built from.
+    HBGLShaderPtr MakeVariantShader(const STVRShaderConstants& constants) const;
+
+    // Returns null on a miss.  A hit becomes the most recently used variant.
+    HBGLShaderProgramPtr Find(unsigned long long variantKey);
+
+    // Add a finished variant, evicting the least recently used one if the
+    // cache is full.
+    void Insert(unsigned long long variantKey,
+        const STVRShaderConstants& constants,
+        const HBGLShaderProgramPtr& program);
+
+    void RecordGpuTime(unsigned long long variantKey, double millisecs);
+
+private:
+
+    struct Variant {
+        unsigned long long      variantKey;
+        HBGLShaderProgramPtr    program;
+    };
+
+    struct VariantTiming {
+        STVRShaderConstants     constants;
+        double                  totalMillisecs;
+        unsigned int            sampleCount;
+    };
+
+    typedef std::list<Variant> VariantList;
+    typedef std::map<unsigned long long, VariantTiming> VariantTimingMap;
+
+    size_t                      m_capacity;
+    HBGLShaderProgramPtr        m_baseProgram;
+    unsigned long long          m_baseSourceHash;
+
+    // most recently used first
+    VariantList                 m_variants;
+
+    // 0 holds the base program
+    VariantTimingMap            m_timings;
+};
@@ -1,6 +1,9 @@
 
 #include "STVRShaders.h"
 #include "HBGLUtils.h"
+#include "HBGLMappedFile.h"
+#include "HBGLSourceCache.h"
+#include "STVRAssets.h"
 
 #include <string>
 #include <cstring>
@@ -11,6 +14,55 @@
 // STATIC FUNCTIONS
 // ,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,
 
+// Print value as a GLSL float literal.  %g drops the decimal point from
+// whole numbers, which GLSL 1.30 would then read as an int.
+static std::string
+GLSLFloatLiteral(float value)
+{
+    char literal[32];
+    snprintf(literal, sizeof(literal), "%.9g", value);
+
+    std::string literalString(literal);
+    if (!strpbrk(literal, ".eEn")) {
+        literalString += ".0";
+    }
+
+    return literalString;
+}
+
+// Header keys and values lose the whitespace and the unnecessary semicolons
+// around them.
+static const char* c_HeaderTrimChars = " \t\r;";
+
+static bool
+IsIdentifierChar(char c)
+{
+    return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9') || c == '_';
+}
+
+// Shade at gl_FragCoord plus iPixelJitter, so frames that are averaged into
+// one image (see STVRStillFrames) each sample a different spot of the pixel.
+// Only whole words after bodyStart change, and every line stays on its line.
+static void
+JitterFragCoord(std::string& source, size_t bodyStart)
+{
+    static const std::string fragCoord("gl_FragCoord");
+    static const std::string jitteredFragCoord("(gl_FragCoord + vec4(iPixelJitter, 0.0, 0.0))");
+
+    size_t wordStart = source.find(fragCoord, bodyStart);
+    while (wordStart != std::string::npos)
+    {
+        size_t wordEnd = wordStart + fragCoord.length();
+        if ((wordStart == 0 || !IsIdentifierChar(source[wordStart - 1])) &&
+            (wordEnd == source.length() || !IsIdentifierChar(source[wordEnd])))
+        {
+            source.replace(wordStart, fragCoord.length(), jitteredFragCoord);
+            wordEnd = wordStart + jitteredFragCoord.length();
+        }
+        wordStart = source.find(fragCoord, wordEnd);
+    }
+}
+
 // ''''''''''''''''''''''''''''''''''''''''''''''''''''''''''''''''''''''''''''
 // STVRVertexShader 
 // ,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,
@@ -87,9 +139,46 @@ static const char* STVRFragmentShaderHeader =
 "uniform vec2      iResolution;\n"
 "uniform float     iChannelTime[4];\n"
 "uniform vec4      iDate;\n"
+"uniform float     iSampleRate;\n"
 "uniform vec3      iChannelResolution[4];\n"
 "uniform mat4      iCameraTransform;\n"
-"uniform float     iFocalLength;\n\n";
+"uniform float     iFocalLength;\n"
+"uniform vec2      iPixelJitter;\n\n";
+
+// Same declarations, in the same order and on the same lines, as
+// STVRFragmentShaderHeader, so compile errors in a specialized shader point
+// at the same toy lines.  Arguments: iMouse, iResolution, iSampleRate,
+// iChannelResolution, iFocalLength.
+static const char* STVRSpecializedFragmentShaderHeader =
+"#version 130\n"
+
+"uniform float     iGlobalTime;\n"
+"const vec2        iMouse = %s;\n"
+"const vec2        iResolution = %s;\n"
+"uniform float     iChannelTime[4];\n"
+"uniform vec4      iDate;\n"
+"const float       iSampleRate = %s;\n"
+"const vec3        iChannelResolution[4] = %s;\n"
+"uniform mat4      iCameraTransform;\n"
+"const float       iFocalLength = %s;\n"
+"uniform vec2      iPixelJitter;\n\n";
+
+struct STVRChannelTypeName
+{
+    const char*             typeName;
+    ShaderToyVRChannelType  type;
+};
+
+static const STVRChannelTypeName STVRChannelTypeNames[] = {
+    { "image_sequence", SHADERTOYVR_IMAGE_SEQUENCE_VIDEO },
+    { "raw_video", SHADERTOYVR_RAW_VIDEO },
+    { "audio", SHADERTOYVR_AUDIO_FILE },
+    { "audio_capture", SHADERTOYVR_AUDIO_CAPTURE },
+    { "buffer_a", SHADERTOYVR_BUFFER_A },
+    { "buffer_b", SHADERTOYVR_BUFFER_B },
+    { "buffer_c", SHADERTOYVR_BUFFER_C },
+    { "buffer_d", SHADERTOYVR_BUFFER_D }
+};
 
 static const char* STVRFragmentShaderChannelHeader[4] = {
     "uniform %s iChannel0;\n"
@@ -103,13 +192,75 @@ static const char* STVRFragmentShaderChannelHeader[4] = {
 
 STVRFragmentShader::STVRFragmentShader(const std::string& filePath) : 
 HBGLFragmentShader(""), 
-m_screenPercentage(1.f)
+m_screenPercentage(1.f),
+m_streamRingDepth(3),
+m_isSpecialized(false)
 {
     LoadFile(filePath);
 }
 
 // ----------------------------------------------------------------------------
 
+STVRFragmentShader::STVRFragmentShader(const STVRFragmentShader& baseShader, const STVRShaderConstants& constants) :
+HBGLFragmentShader(""),
+m_shaderInputs(baseShader.m_shaderInputs),
+m_shaderInputSources(baseShader.m_shaderInputSources),
+m_shaderInputAssets(baseShader.m_shaderInputAssets),
+m_shaderInputFrameRates(baseShader.m_shaderInputFrameRates),
+m_bufferPassSources(baseShader.m_bufferPassSources),
+m_bufferPassScales(baseShader.m_bufferPassScales),
+m_bufferPassOnce(baseShader.m_bufferPassOnce),
+m_screenPercentage(baseShader.m_screenPercentage),
+m_streamRingDepth(baseShader.m_streamRingDepth),
+m_isSpecialized(true)
+{
+    m_shaderName = baseShader.m_shaderName;
+    m_shaderFilePath = baseShader.m_shaderFilePath;
+    m_sourceStringNames = baseShader.GetSourceStringNames();
+
+    // Everything after the uniform header (the channel samplers and the toy
+    // itself) is copied over untouched.
+    const GLchar* baseSource = baseShader.GetSource();
+    size_t baseHeaderLength = strlen(STVRFragmentShaderHeader);
+    if (!baseSource || baseShader.m_isSpecialized || strncmp(baseSource, STVRFragmentShaderHeader, baseHeaderLength) != 0) {
+        std::cerr << "STVRFragmentShader ERROR [ " << this->GetName() << " ]: can only specialize a successfully loaded toy" << std::endl;
+        m_shaderSource = new GLchar[1];
+        m_shaderSource[0] = 0;
+        return;
+    }
+
+    std::string channelResolutions = "vec3[4](";
+    for (int channelIdx = 0; channelIdx < 4; channelIdx++)
+    {
+        const GLfloat* channelResolution = constants.channelResolutions[channelIdx];
+        channelResolutions += "vec3(" + GLSLFloatLiteral(channelResolution[0]) + ", " +
+            GLSLFloatLiteral(channelResolution[1]) + ", " +
+            GLSLFloatLiteral(channelResolution[2]) + (channelIdx < 3 ? "), " : "))");
+    }
+
+    std::string resolution = "vec2(" + GLSLFloatLiteral(constants.resolution[0]) + ", " +
+        GLSLFloatLiteral(constants.resolution[1]) + ")";
+
+    std::string specializedHeader(strlen(STVRSpecializedFragmentShaderHeader) + resolution.length() +
+        channelResolutions.length() + 128, 0);
+    int headerLength = snprintf(&specializedHeader[0], specializedHeader.size(), STVRSpecializedFragmentShaderHeader,
+        "vec2(0.0, 0.0)",
+        resolution.c_str(),
+        GLSLFloatLiteral(constants.sampleRate).c_str(),
+        channelResolutions.c_str(),
+        GLSLFloatLiteral(constants.focalLength).c_str());
+    specializedHeader.resize(headerLength);
+
+    const GLchar* baseBody = baseSource + baseHeaderLength;
+    size_t bodyLength = strlen(baseBody);
+
+    m_shaderSource = new GLchar[specializedHeader.length() + bodyLength + 1];
+    memcpy(m_shaderSource, specializedHeader.c_str(), specializedHeader.length());
+    memcpy(m_shaderSource + specializedHeader.length(), baseBody, bodyLength + 1);
+}
+
+// ----------------------------------------------------------------------------
+
 STVRFragmentShader::~STVRFragmentShader()
 {
 
@@ -121,95 +272,18 @@ bool
 STVRFragmentShader::ConvertStringToInputType(const char* inputTypeString,
 ShaderToyVRChannelType& outputType) const
 {
-    if (strcmp(inputTypeString, "noise_rgb_256") == 0) {
-        outputType = SHADERTOYVR_RGB_NOISE_256x256_TEX;
-        return true;
-    }
-    if (strcmp(inputTypeString, "noise_r_256") == 0) {
-        outputType = SHADERTOYVR_R_NOISE_256x256_TEX;
-        return true;
-    }
-    if (strcmp(inputTypeString, "noise_rgb_64") == 0) {
-        outputType = SHADERTOYVR_RGB_NOISE_64x64_TEX;
-        return true;
-    }
-    if (strcmp(inputTypeString, "noise_r_64") == 0) {
-        outputType = SHADERTOYVR_R_NOISE_64x64_TEX;
-        return true;
-    }
-    if (strcmp(inputTypeString, "noise_r_8") == 0) {
-        outputType = SHADERTOYVR_R_NOISE_8x8_TEX;
-        return true;
-    }
-    if (strcmp(inputTypeString, "stone_tiles") == 0) {
-        outputType = SHADERTOYVR_STONE_TILES_TEX;
-        return true;
-    }
-    if (strcmp(inputTypeString, "old_birch") == 0) {
-        outputType = SHADERTOYVR_OLD_BIRCH_TEX;
-        return true;
-    }
-    if (strcmp(inputTypeString, "rusted_metal") == 0) {
-        outputType = SHADERTOYVR_RUSTED_METAL_TEX;
-        return true;
-    }
-    if (strcmp(inputTypeString, "deepsky_pattern") == 0) {
-        outputType = SHADERTOYVR_DEEPSKY_PATTERN_TEX;
-        return true;
-    }
-    if (strcmp(inputTypeString, "london_street") == 0) {
-        outputType = SHADERTOYVR_LONDON_STREET_TEX;
-        return true;
-    }
-    if (strcmp(inputTypeString, "finished_wood") == 0) {
-        outputType = SHADERTOYVR_FINISHED_WOOD_TEX;
-        return true;
-    }
-    if (strcmp(inputTypeString, "bark_and_lichen") == 0) {
-        outputType = SHADERTOYVR_BARK_AND_LICHEN_TEX;
-        return true;
-    }
-
-    if (strcmp(inputTypeString, "colored_rocks") == 0) {
-        outputType = SHADERTOYVR_COLORED_ROCKS_TEX;
-        return true;
-    }
-    if (strcmp(inputTypeString, "cloth_weave") == 0) {
-        outputType = SHADERTOYVR_CLOTH_WEAVE_TEX;
-        return true;
-    }
-    if (strcmp(inputTypeString, "animal_print") == 0) {
-        outputType = SHADERTOYVR_ANIMAL_PRINT_TEX;
-        return true;
-    }
-    if (strcmp(inputTypeString, "nyan_cat") == 0) {
-        outputType = SHADERTOYVR_NYAN_CAT_TEX;
-        return true;
-    }
-
-    if (strcmp(inputTypeString, "uffizi_gallery_512") == 0) {
-        outputType = SHADERTOYVR_UFFIZI_GALLERY_512_CUBEMAP;
-        return true;
-    }
-    if (strcmp(inputTypeString, "uffizi_gallery_64") == 0) {
-        outputType = SHADERTOYVR_UFFIZI_GALLERY_64_CUBEMAP;
-        return true;
-    }
-    if (strcmp(inputTypeString, "st_peters_256") == 0) {
-        outputType = SHADERTOYVR_ST_PETERS_256_CUBEMAP;
-        return true;
-    }
-    if (strcmp(inputTypeString, "st_peters_64") == 0) {
-        outputType = SHADERTOYVR_ST_PETERS_64_CUBEMAP;
-        return true;
-    }
-    if (strcmp(inputTypeString, "grove_512") == 0) {
-        outputType = SHADERTOYVR_GROVE_512_CUBEMAP;
-        return true;
+    // streams and buffers are built in, textures come from the manifest
+    for (size_t typeIdx = 0; typeIdx < sizeof(STVRChannelTypeNames) / sizeof(STVRChannelTypeNames[0]); typeIdx++)
+    {
+        if (strcmp(inputTypeString, STVRChannelTypeNames[typeIdx].typeName) == 0) {
+            outputType = STVRChannelTypeNames[typeIdx].type;
+            return true;
+        }
     }
 
-    if (strcmp(inputTypeString, "grove_64") == 0) {
-        outputType = SHADERTOYVR_GROVE_64_CUBEMAP;
+    const STVRAsset* asset = STVRAssetRegistry::Get().Find(inputTypeString);
+    if (asset) {
+        outputType = asset->type;
         return true;
     }
 
@@ -268,17 +342,121 @@ STVRFragmentShader::GetInputType(ShaderToyVRInputChannel inputChannel) const
 bool
 STVRFragmentShader::Is2DTexInput(ShaderToyVRChannelType inputType) const
 {
-    if (inputType == SHADERTOYVR_UFFIZI_GALLERY_512_CUBEMAP ||
-        inputType == SHADERTOYVR_UFFIZI_GALLERY_64_CUBEMAP ||
-        inputType == SHADERTOYVR_ST_PETERS_256_CUBEMAP ||
-        inputType == SHADERTOYVR_ST_PETERS_64_CUBEMAP ||
-        inputType == SHADERTOYVR_GROVE_512_CUBEMAP ||
-        inputType == SHADERTOYVR_GROVE_64_CUBEMAP)
-    {
+    return inputType != SHADERTOYVR_CUBEMAP_TEX;
+}
+
+// ----------------------------------------------------------------------------
+
+bool
+STVRFragmentShader::IsStreamInput(ShaderToyVRChannelType inputType) const
+{
+    return (inputType == SHADERTOYVR_IMAGE_SEQUENCE_VIDEO ||
+        inputType == SHADERTOYVR_RAW_VIDEO ||
+        inputType == SHADERTOYVR_AUDIO_FILE ||
+        inputType == SHADERTOYVR_AUDIO_CAPTURE);
+}
+
+// ----------------------------------------------------------------------------
+
+bool
+STVRFragmentShader::IsBufferInput(ShaderToyVRChannelType inputType) const
+{
+    return (inputType == SHADERTOYVR_BUFFER_A ||
+        inputType == SHADERTOYVR_BUFFER_B ||
+        inputType == SHADERTOYVR_BUFFER_C ||
+        inputType == SHADERTOYVR_BUFFER_D);
+}
+
+// ----------------------------------------------------------------------------
+
+ShaderToyVRBufferPass
+STVRFragmentShader::GetInputBufferPass(ShaderToyVRChannelType inputType) const
+{
+    return static_cast<ShaderToyVRBufferPass>(inputType - SHADERTOYVR_BUFFER_A);
+}
+
+// ----------------------------------------------------------------------------
+
+const std::string&
+STVRFragmentShader::GetBufferPassSource(ShaderToyVRBufferPass bufferPass) const
+{
+    static const std::string emptySource;
+
+    ShaderToyVRBufferSourceMap::const_iterator sourceIter = m_bufferPassSources.find(bufferPass);
+    if (sourceIter == m_bufferPassSources.end()) {
+        return emptySource;
+    }
+
+    return sourceIter->second;
+}
+
+// ----------------------------------------------------------------------------
+
+float
+STVRFragmentShader::GetBufferPassScale(ShaderToyVRBufferPass bufferPass) const
+{
+    ShaderToyVRBufferScaleMap::const_iterator scaleIter = m_bufferPassScales.find(bufferPass);
+    if (scaleIter == m_bufferPassScales.end()) {
+        return 1.f;
+    }
+
+    return scaleIter->second;
+}
+
+// ----------------------------------------------------------------------------
+
+bool
+STVRFragmentShader::IsBufferPassRenderedOnce(ShaderToyVRBufferPass bufferPass) const
+{
+    ShaderToyVRBufferOnceMap::const_iterator onceIter = m_bufferPassOnce.find(bufferPass);
+    if (onceIter == m_bufferPassOnce.end()) {
         return false;
     }
 
-    return true;
+    return onceIter->second;
+}
+
+// ----------------------------------------------------------------------------
+
+const std::string&
+STVRFragmentShader::GetInputSource(ShaderToyVRInputChannel inputChannel) const
+{
+    static const std::string emptySource;
+
+    ShaderToyVRInputSourceMap::const_iterator sourceIter = m_shaderInputSources.find(inputChannel);
+    if (sourceIter == m_shaderInputSources.end()) {
+        return emptySource;
+    }
+
+    return sourceIter->second;
+}
+
+// ----------------------------------------------------------------------------
+
+const std::string&
+STVRFragmentShader::GetInputAsset(ShaderToyVRInputChannel inputChannel) const
+{
+    static const std::string emptyAsset;
+
+    ShaderToyVRInputSourceMap::const_iterator assetIter = m_shaderInputAssets.find(inputChannel);
+    if (assetIter == m_shaderInputAssets.end()) {
+        return emptyAsset;
+    }
+
+    return assetIter->second;
+}
+
+// ----------------------------------------------------------------------------
+
+float
+STVRFragmentShader::GetInputFrameRate(ShaderToyVRInputChannel inputChannel) const
+{
+    ShaderToyVRInputRateMap::const_iterator rateIter = m_shaderInputFrameRates.find(inputChannel);
+    if (rateIter == m_shaderInputFrameRates.end()) {
+        return 0.f;
+    }
+
+    return rateIter->second;
 }
 
 // ----------------------------------------------------------------------------
@@ -291,6 +469,22 @@ STVRFragmentShader::GetScreenPercentageResolution() const
 
 // ----------------------------------------------------------------------------
 
+unsigned int
+STVRFragmentShader::GetStreamRingDepth() const
+{
+    return m_streamRingDepth;
+}
+
+// ----------------------------------------------------------------------------
+
+bool
+STVRFragmentShader::IsSpecialized() const
+{
+    return m_isSpecialized;
+}
+
+// ----------------------------------------------------------------------------
+
 bool
 STVRFragmentShader::ConvertKeyAndValue(const char* inputKey, const char* inputValue)
 {
@@ -301,6 +495,40 @@ STVRFragmentShader::ConvertKeyAndValue(const char* inputKey, const char* inputVa
         m_screenPercentage = static_cast<float>(atof(inputValue));
 
     }
+    else if (strcmp(inputKey, "StreamRingDepth") == 0)
+    {
+        // a ring needs at least one slot being uploaded and one being decoded
+        int ringDepth = atoi(inputValue);
+        m_streamRingDepth = static_cast<unsigned int>(ringDepth < 2 ? 2 : ringDepth);
+    }
+    else if (strlen(inputKey) > 6 && strncmp(inputKey, "Buffer", 6) == 0)
+    {
+        return ConvertBufferKeyAndValue(inputKey, inputValue);
+    }
+    else if (strlen(inputKey) > 9 && strncmp(inputKey, "iChannel", 8) == 0)
+    {
+        // per channel properties, e.g. iChannel0Source or iChannel0FrameRate
+        char channelString[10];
+        memcpy(channelString, inputKey, 9);
+        channelString[9] = 0;
+
+        ShaderToyVRInputChannel inputChannel;
+        if (!ConvertStringToInputChannel(channelString, inputChannel)) {
+            return false;
+        }
+
+        const char* propertyString = &inputKey[9];
+        if (strcmp(propertyString, "Source") == 0) {
+            m_shaderInputSources[inputChannel] = inputValue;
+        }
+        else if (strcmp(propertyString, "FrameRate") == 0) {
+            m_shaderInputFrameRates[inputChannel] = static_cast<float>(atof(inputValue));
+        }
+        else {
+            std::cerr << "STVRFragmentShader ERROR [ " << this->GetName() << " ]: unknown channel property: " << inputKey << std::endl;
+            return false;
+        }
+    }
     else
     {
         ShaderToyVRChannelType inputType;
@@ -315,170 +543,141 @@ STVRFragmentShader::ConvertKeyAndValue(const char* inputKey, const char* inputVa
         }
 
         m_shaderInputs[inputChannel] = inputType;
+
+        if (inputType == SHADERTOYVR_IMAGE_TEX || inputType == SHADERTOYVR_CUBEMAP_TEX) {
+            m_shaderInputAssets[inputChannel] = inputValue;
+        }
+        else {
+            m_shaderInputAssets.erase(inputChannel);
+        }
     }
 
     return true;
 }
 
+// ----------------------------------------------------------------------------
+
 bool
-STVRFragmentShader::LoadFile(const std::string& filePath)
+STVRFragmentShader::ConvertBufferKeyAndValue(const char* inputKey, const char* inputValue)
 {
+    // BufferA, BufferAScale or BufferAOnce
+    char passLetter = inputKey[6];
+    if (passLetter < 'A' || passLetter > 'D') {
+        std::cerr << "STVRFragmentShader ERROR [ " << this->GetName() << " ]: cannot parse buffer pass: " << inputKey << std::endl;
+        return false;
+    }
 
-    m_shaderName = filePath;
-    std::string realFilePath = HBGLUtils::GetRealFilePath(filePath.c_str());
-
-    FILE * shaderFile; 
-    fopen_s(&shaderFile, realFilePath.c_str(), "r");    
+    ShaderToyVRBufferPass bufferPass = static_cast<ShaderToyVRBufferPass>(passLetter - 'A');
+    const char* propertyString = &inputKey[7];
 
-    if (!shaderFile) {
-        std::cerr << "STVRFragmentShader ERROR [ " << this->GetName() << " ]: Could not load file [ " << filePath << " ] " << std::endl;
+    if (propertyString[0] == 0) {
+        m_bufferPassSources[bufferPass] = inputValue;
+    }
+    else if (strcmp(propertyString, "Scale") == 0) {
+        // a buffer scaled to nothing would never render anything
+        float passScale = static_cast<float>(atof(inputValue));
+        m_bufferPassScales[bufferPass] = passScale < .05f ? .05f : passScale;
+    }
+    else if (strcmp(propertyString, "Once") == 0) {
+        m_bufferPassOnce[bufferPass] = (atoi(inputValue) != 0);
+    }
+    else {
+        std::cerr << "STVRFragmentShader ERROR [ " << this->GetName() << " ]: unknown buffer property: " << inputKey << std::endl;
         return false;
     }
 
-    if (m_shaderSource != 0) // there is already a source loaded, free it!
-    {
-        delete[] m_shaderSource;
-    }
+    return true;
+}
 
-    unsigned long bufferSize = HBGLShader::GetFileEndPosition(shaderFile);
-    bufferSize += strlen(STVRFragmentShaderHeader);
+// ----------------------------------------------------------------------------
 
-    // We are allocating more space then we will need based on overall file length,
-    // but we will 0 terminate the buffer once we've parsed and constructed the 
-    // entire shader.
-    m_shaderSource = (GLchar*) new char[bufferSize + 1];
+bool
+STVRFragmentShader::LoadFile(const std::string& filePath)
+{
+
+    m_shaderName = filePath;
+    std::string realFilePath = HBGLUtils::GetRealFilePath(filePath.c_str());
 
-    if (m_shaderSource == 0) {
-        std::cerr << "STVRFragmentShader ERROR [ " << this->GetName() << " ]: Unable to allocate memory to keep shader source in memory [ " << realFilePath << " ] " << std::endl;
-        fclose(shaderFile);
+    HBGLMappedFile shaderFile;
+    if (realFilePath.empty() || !shaderFile.Open(realFilePath)) {
+        std::cerr << "STVRFragmentShader ERROR [ " << this->GetName() << " ]: Could not load file [ " << filePath << " ] " << std::endl;
         return false;
     }
 
-    int fileError = 0;
+    const char* fileData = shaderFile.GetData();
+    const char* fileEnd = fileData + shaderFile.GetSize();
+
+    // Single pass over the mapped file.  Each header line is a key = value
+    // pair, with // starting a comment, up to the line that begins with a
+    // colon.  Everything after that line is the body of the shader.
     bool readingHeader = true;
-    bool newline = true;
-    bool ignoreline = false;
-    bool readingInputKey = true;
-    unsigned long shaderCharIdx = 0;
-    char inputKey[64]; unsigned short inputKeyCharIdx = 0;
-    char inputValue[64]; unsigned short inputValueCharIdx = 0;
-
-    // embarrassingly fragile parser of the simple shadertoy file format with
-    // input definitions above.
-    while (!feof(shaderFile) && !(fileError = ferror(shaderFile))) 
+    const char* lineStart = fileData;
+    unsigned int lineNumber = 1;
+
+    while (lineStart < fileEnd)
     {
-        char currChar = fgetc(shaderFile);
-        if (currChar == EOF) {
+        const char* nextLine;
+        const char* lineEnd = HBGLUtils::FindLineEnd(lineStart, fileEnd, nextLine);
+
+        if (*lineStart == ':') {
+            readingHeader = false;
+            lineStart = nextLine;
+            lineNumber++;
             break;
         }
 
-        if (readingHeader) {
-
-            if (newline && currChar == ':') 
-            {
-                readingHeader = false;
-                memcpy(&m_shaderSource[0], STVRFragmentShaderHeader, strlen(STVRFragmentShaderHeader));                
-                shaderCharIdx += strlen(STVRFragmentShaderHeader);
-
-                for (ShaderToyVRInputMap::const_iterator inputIter = m_shaderInputs.begin();
-                    inputIter != m_shaderInputs.end();
-                    inputIter++)
-                {
-                    const char* inputHeaderTemplate = STVRFragmentShaderChannelHeader[inputIter->first];
-
-                    char inputHeader[64];
-                    //sprintf_s(inputHeader, inputHeaderTemplate, Is2DTexInput(inputIter->second) ? "sampler2D" : "samplerCube");
-                    sprintf_s(inputHeader, inputHeaderTemplate, Is2DTexInput(inputIter->second) ? "sampler2D" : "samplerCube");
-                    memcpy(&m_shaderSource[shaderCharIdx], inputHeader, strlen(inputHeader));
-                    shaderCharIdx += strlen(inputHeader);
-                }
-
-                // flush characters until the end of the line and then continue reading the body
-                // of the shader
-                while ((currChar = fgetc(shaderFile)) != '\n') {}
-                continue;
-
-            }
-
-            if (currChar == '\n')
-            {
-                newline = true;
-                readingInputKey = true;
-                if (inputKeyCharIdx && inputKeyCharIdx)
-                {
-                    inputKey[inputKeyCharIdx] = 0;
-                    inputValue[inputValueCharIdx] = 0;
-                    if (!ConvertKeyAndValue(inputKey, inputValue)) {
-                        break;
-                    }
-                }
-
-                inputKeyCharIdx = 0;
-                inputValueCharIdx = 0;
-                ignoreline = false;
-                continue;
-            }
-
-            if ((currChar == ' ') || (currChar == ';')) {
-                // ignore whitespace and unnecessary semicolons
-                continue;
-            }
-
-            if (currChar == '/') {
-                char nextChar = fgetc(shaderFile);
-                if (nextChar == '/') {
-                    ignoreline = true;
-                    continue;
-                }
-            }
-
-            if (ignoreline) {
-                continue;
-            }
-
-            if (currChar == '=') {
-                readingInputKey = false;
-                continue;
-            }
-
-            if (readingInputKey) {
-                inputKey[inputKeyCharIdx++] = currChar;
-            }
-            else {
-                inputValue[inputValueCharIdx++] = currChar;
-            }
-
-        } 
-        else 
-        {
-            // reading body of shader
-            m_shaderSource[shaderCharIdx++] = currChar;
+        const char* commentStart = HBGLUtils::FindLineComment(lineStart, lineEnd);
+
+        const char* equalsChar = static_cast<const char*>(memchr(lineStart, '=', commentStart - lineStart));
+        std::string inputKey = HBGLUtils::TrimToken(lineStart, equalsChar ? equalsChar : commentStart, c_HeaderTrimChars);
+        std::string inputValue = equalsChar ? HBGLUtils::TrimToken(equalsChar + 1, commentStart, c_HeaderTrimChars) : std::string();
+
+        if (!inputKey.empty() && !ConvertKeyAndValue(inputKey.c_str(), inputValue.c_str())) {
+            break;
         }
-    }
 
-    // 0 terminate the shader source
-    m_shaderSource[shaderCharIdx] = 0;
+        lineStart = nextLine;
+        lineNumber++;
+    }
 
     if (readingHeader) {
         std::cerr << "STVRFragmentShader ERROR [ " << this->GetName() << " ]: did not match the expected format " << \
             " [ " << realFilePath << " ] There needs to be 2 valid sections to the shader file separated by a line that " << \
             "begins with a colon." << std::endl;
         // the shader was invalid, make it an empty string
-        m_shaderSource[0] = 0;
-        fclose(shaderFile);
+        HBGLShader::LoadSource("");
         return false;
     }
 
-    if (fileError > 0) {
-        std::cerr << "STVRFragmentShader ERROR [ " << this->GetName() << " ]: parsing ShaderToy fragment shader [ " << realFilePath << " ] Error: " << fileError << std::endl;
-        // the shader was invalid, make it an empty string
-        m_shaderSource[0] = 0;
-        fclose(shaderFile);
+    std::string shaderSource(STVRFragmentShaderHeader);
+
+    for (ShaderToyVRInputMap::const_iterator inputIter = m_shaderInputs.begin();
+        inputIter != m_shaderInputs.end();
+        inputIter++)
+    {
+        const char* inputHeaderTemplate = STVRFragmentShaderChannelHeader[inputIter->first];
+
+        char inputHeader[64];
+        snprintf(inputHeader, sizeof(inputHeader), inputHeaderTemplate, Is2DTexInput(inputIter->second) ? "sampler2D" : "samplerCube");
+        shaderSource += inputHeader;
+    }
+
+    // compile errors in the body report the line in the toy file
+    HBGLSourceCache::AppendLineDirective(shaderSource, lineNumber, 0);
+    size_t bodyStart = shaderSource.length();
+
+    m_sourceStringNames.assign(1, realFilePath);
+    if (!HBGLSourceCache::Get().ExpandIncludes(lineStart, fileEnd - lineStart, realFilePath, lineNumber,
+        shaderSource, m_sourceStringNames))
+    {
+        std::cerr << "STVRFragmentShader ERROR [ " << this->GetName() << " ]: Could not expand the includes of [ " << realFilePath << " ] " << std::endl;
+        HBGLShader::LoadSource("");
         return false;
     }
 
-    fclose(shaderFile);
+    JitterFragCoord(shaderSource, bodyStart);
 
+    HBGLShader::LoadSource(shaderSource);
     m_shaderFilePath = realFilePath;
 
     return true;
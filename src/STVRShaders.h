@@ -39,10 +39,32 @@ private:
 // code that should be copy and pasted from Shadertoyr
 // Example syntax:
 
-// iChannel0 = noise_256x256_TEX
-// iChannel1 = noise_8x8
+// iChannel0 = noise_rgb_256
+// iChannel1 = grove_64
+// iChannel2 = image_sequence
+// iChannel2Source = ../resources/video/clip
+// iChannel2FrameRate = 30
+// iChannel3 = audio
+// iChannel3Source = ../resources/audio/track.wav
+// StreamRingDepth = 4
 // ScreenPercentage = .5f;
 
+// Image and cubemap channels name an asset from the STVRAssetRegistry
+// manifest; the channel then has type SHADERTOYVR_IMAGE_TEX or
+// SHADERTOYVR_CUBEMAP_TEX and GetInputAsset gives the name.
+
+// Multipass toys declare up to four buffer passes, each a file in this same
+// format.  Any pass (including the buffer itself, for feedback) reads a
+// buffer's output with iChannel# = buffer_a .. buffer_d.  BufferAScale sizes
+// the buffer relative to the eye texture, and BufferAOnce = 1 renders it only
+// once (for lookup tables that never change).
+
+// BufferA = ../glshaders/shadertoy_buffer_a.fs
+// BufferAScale = .5
+// BufferB = ../glshaders/shadertoy_lut.fs
+// BufferBOnce = 1
+// iChannel0 = buffer_a
+
 // ::::::::::::::::::::::::::::::::::::::::::::::::::::
 
 // void main(void) 
@@ -53,28 +75,16 @@ private:
 // }
 
 enum ShaderToyVRChannelType {
-    SHADERTOYVR_RGB_NOISE_256x256_TEX = 0,
-    SHADERTOYVR_R_NOISE_256x256_TEX,
-    SHADERTOYVR_RGB_NOISE_64x64_TEX,
-    SHADERTOYVR_R_NOISE_64x64_TEX,
-    SHADERTOYVR_R_NOISE_8x8_TEX,
-    SHADERTOYVR_STONE_TILES_TEX,
-    SHADERTOYVR_OLD_BIRCH_TEX,
-    SHADERTOYVR_RUSTED_METAL_TEX,
-    SHADERTOYVR_DEEPSKY_PATTERN_TEX,
-    SHADERTOYVR_LONDON_STREET_TEX,
-    SHADERTOYVR_FINISHED_WOOD_TEX,
-    SHADERTOYVR_BARK_AND_LICHEN_TEX,
-    SHADERTOYVR_COLORED_ROCKS_TEX,
-    SHADERTOYVR_CLOTH_WEAVE_TEX,
-    SHADERTOYVR_ANIMAL_PRINT_TEX,
-    SHADERTOYVR_NYAN_CAT_TEX,
-    SHADERTOYVR_UFFIZI_GALLERY_512_CUBEMAP,
-    SHADERTOYVR_UFFIZI_GALLERY_64_CUBEMAP,
-    SHADERTOYVR_ST_PETERS_256_CUBEMAP,
-    SHADERTOYVR_ST_PETERS_64_CUBEMAP,
-    SHADERTOYVR_GROVE_512_CUBEMAP,
-    SHADERTOYVR_GROVE_64_CUBEMAP,
+    SHADERTOYVR_IMAGE_TEX = 0,
+    SHADERTOYVR_CUBEMAP_TEX,
+    SHADERTOYVR_IMAGE_SEQUENCE_VIDEO,
+    SHADERTOYVR_RAW_VIDEO,
+    SHADERTOYVR_AUDIO_FILE,
+    SHADERTOYVR_AUDIO_CAPTURE,
+    SHADERTOYVR_BUFFER_A,
+    SHADERTOYVR_BUFFER_B,
+    SHADERTOYVR_BUFFER_C,
+    SHADERTOYVR_BUFFER_D,
     SHADERTOYVR_UNKNOWN_TYPE
 
 };
@@ -87,7 +97,34 @@ enum ShaderToyVRInputChannel {
     SHADERTOYVR_NUMCHANNELS
 };
 
+enum ShaderToyVRBufferPass {
+    SHADERTOYVR_BUFFER_PASS_A = 0,
+    SHADERTOYVR_BUFFER_PASS_B,
+    SHADERTOYVR_BUFFER_PASS_C,
+    SHADERTOYVR_BUFFER_PASS_D,
+    SHADERTOYVR_NUMBUFFERPASSES
+};
+
 typedef std::map<ShaderToyVRInputChannel, ShaderToyVRChannelType> ShaderToyVRInputMap;
+typedef std::map<ShaderToyVRInputChannel, std::string> ShaderToyVRInputSourceMap;
+typedef std::map<ShaderToyVRInputChannel, float> ShaderToyVRInputRateMap;
+typedef std::map<ShaderToyVRBufferPass, std::string> ShaderToyVRBufferSourceMap;
+typedef std::map<ShaderToyVRBufferPass, float> ShaderToyVRBufferScaleMap;
+typedef std::map<ShaderToyVRBufferPass, bool> ShaderToyVRBufferOnceMap;
+
+//-----------------------------------------------------------------------------
+// Inputs that stay the same for long stretches of a session.  A specialized
+// fragment shader declares them as constants instead of uniforms so the
+// compiler can fold the math (and unroll the loops) that depends on them.
+// iMouse is always zero and is baked in by every specialized shader.
+
+struct STVRShaderConstants
+{
+    GLfloat     resolution[2];
+    GLfloat     channelResolutions[4][3];
+    GLfloat     focalLength;
+    GLfloat     sampleRate;
+};
 
 
 class  STVRFragmentShader : public HBGLFragmentShader
@@ -95,6 +132,11 @@ class  STVRFragmentShader : public HBGLFragmentShader
 public:
 
     STVRFragmentShader(const std::string& filePath);
+
+    // A copy of baseShader with the inputs in constants baked into the
+    // source.  baseShader must have loaded successfully.
+    STVRFragmentShader(const STVRFragmentShader& baseShader, const STVRShaderConstants& constants);
+
     ~STVRFragmentShader();
 
     // LoadFile parses the syntax mentioned above, 
@@ -105,8 +147,31 @@ public:
 
     ShaderToyVRChannelType GetInputType(ShaderToyVRInputChannel inputChannel) const;
 
+    // Streamed inputs (video and audio) read from the path given by the
+    // iChannel#Source key.  Video plays back at iChannel#FrameRate frames per
+    // second (0 means use the rate stored in the source itself).
+    const std::string& GetInputSource(ShaderToyVRInputChannel inputChannel) const;
+
+    // The registry asset an image or cubemap channel reads, empty otherwise.
+    const std::string& GetInputAsset(ShaderToyVRInputChannel inputChannel) const;
+    float GetInputFrameRate(ShaderToyVRInputChannel inputChannel) const;
+
     bool Is2DTexInput(ShaderToyVRChannelType inputType) const;
+    bool IsStreamInput(ShaderToyVRChannelType inputType) const;
+    bool IsBufferInput(ShaderToyVRChannelType inputType) const;
+
+    // The buffer pass a buffer_a .. buffer_d input reads from.  Only valid
+    // when IsBufferInput(inputType).
+    ShaderToyVRBufferPass GetInputBufferPass(ShaderToyVRChannelType inputType) const;
+
+    // Buffer pass declarations.  A pass with an empty source is not used.
+    const std::string& GetBufferPassSource(ShaderToyVRBufferPass bufferPass) const;
+    float GetBufferPassScale(ShaderToyVRBufferPass bufferPass) const;
+    bool IsBufferPassRenderedOnce(ShaderToyVRBufferPass bufferPass) const;
+
     float GetScreenPercentageResolution() const;
+    unsigned int GetStreamRingDepth() const;
+    bool IsSpecialized() const;
 
 protected:
 
@@ -119,8 +184,19 @@ protected:
     bool ConvertStringToInputChannel(const char* inputChannelString,
         ShaderToyVRInputChannel& inputChannel) const;
 
+    bool ConvertBufferKeyAndValue(const char* inputKey,
+        const char* inputValue);
+
     ShaderToyVRInputMap m_shaderInputs;
+    ShaderToyVRInputSourceMap m_shaderInputSources;
+    ShaderToyVRInputSourceMap m_shaderInputAssets;
+    ShaderToyVRInputRateMap m_shaderInputFrameRates;
+    ShaderToyVRBufferSourceMap m_bufferPassSources;
+    ShaderToyVRBufferScaleMap m_bufferPassScales;
+    ShaderToyVRBufferOnceMap m_bufferPassOnce;
     float m_screenPercentage;
+    unsigned int m_streamRingDepth;
+    bool m_isSpecialized;
 };
 
 //-----------------------------------------------------------------------------
@@ -0,0 +1,332 @@
+#include "STVRStillFrames.h"
+#include "HBGLUtils.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+// ''''''''''''''''''''''''''''''''''''''''''''''''''''''''''''''''''''''''''''
+// STATIC FUNCTIONS
+// ,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,
+
+// A head resting in a DK2 wobbles by a few hundredths of a degree and a
+// fraction of a millimeter.  Timewarp hides the turn, the shift is too small
+// to show parallax.
+static const float c_StillRadians = .1f * 3.14159265f / 180.f;
+static const float c_StillMeters = .001f;
+
+// 16 samples leave the steps of an edge at 1/16 of the difference, which is
+// as far as an 8 bit eye texture can tell them apart anyway.
+static const unsigned int c_ConvergedSampleCount = 16;
+
+// ----------------------------------------------------------------------------
+
+// The index'th point of the Halton sequence in base, in [0, 1).  Any run of
+// it covers the interval evenly, so a history that stops early still has
+// samples all over the pixel.
+static float
+Halton(unsigned int index, unsigned int base)
+{
+    float result = 0.f;
+    float fraction = 1.f / float(base);
+    while (index > 0)
+    {
+        result += fraction * float(index % base);
+        index /= base;
+        fraction /= float(base);
+    }
+    return result;
+}
+
+// ''''''''''''''''''''''''''''''''''''''''''''''''''''''''''''''''''''''''''''
+// STVRStillFrames
+// ,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,
+
+STVRStillFrames::STVRStillFrames() :
+m_enabled(true),
+m_anchored(false),
+m_accumulating(false),
+m_sampleCount(0)
+{
+    memset(m_anchorPoses, 0, sizeof(m_anchorPoses));
+    memset(&m_anchorScene, 0, sizeof(m_anchorScene));
+
+    for (int eye = 0; eye < c_NumEyes; eye++)
+    {
+        m_histories[eye].width = 0;
+        m_histories[eye].height = 0;
+    }
+}
+
+// ----------------------------------------------------------------------------
+
+STVRStillFrames::~STVRStillFrames()
+{
+
+}
+
+// ----------------------------------------------------------------------------
+
+bool
+STVRStillFrames::IsEnabled() const
+{
+    return m_enabled;
+}
+
+// ----------------------------------------------------------------------------
+
+unsigned int
+STVRStillFrames::GetSampleCount() const
+{
+    return m_sampleCount;
+}
+
+// ----------------------------------------------------------------------------
+
+bool
+STVRStillFrames::IsAccumulating() const
+{
+    return m_accumulating;
+}
+
+// ----------------------------------------------------------------------------
+
+bool
+STVRStillFrames::IsConverged() const
+{
+    return m_anchored && !m_accumulating && m_sampleCount >= c_ConvergedSampleCount;
+}
+
+// ----------------------------------------------------------------------------
+
+void
+STVRStillFrames::GetPixelJitter(float jitter[2]) const
+{
+    if (!m_accumulating)
+    {
+        jitter[0] = 0.f;
+        jitter[1] = 0.f;
+        return;
+    }
+
+    jitter[0] = Halton(m_sampleCount, 2) - .5f;
+    jitter[1] = Halton(m_sampleCount, 3) - .5f;
+}
+
+// ----------------------------------------------------------------------------
+
+void
+STVRStillFrames::SetEnabled(bool enabled)
+{
+    m_enabled = enabled;
+    Reset();
+}
+
+// ----------------------------------------------------------------------------
+
+void
+STVRStillFrames::Reset()
+{
+    m_anchored = false;
+    m_accumulating = false;
+    m_sampleCount = 0;
+}
+
+// ----------------------------------------------------------------------------
+
+void
+STVRStillFrames::Resize(int eye, GLsizei width, GLsizei height)
+{
+    Reset();
+
+    EyeHistory& history = m_histories[eye];
+    if (history.texture && width == history.width && height == history.height) {
+        return;
+    }
+
+    if (!history.texture)
+    {
+        history.texture = HBGLTextureResourcePtr(new HBGLTextureResource());
+        history.texture->Generate();
+        history.frameBuffer = HBGLFrameBufferResourcePtr(new HBGLFrameBufferResource());
+        history.frameBuffer->Generate();
+    }
+
+    // half floats, so the running average doesn't round away the samples
+    // that come late in it
+    glBindTexture(GL_TEXTURE_2D, history.texture->GetIndex());
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA16F, width, height, 0, GL_RGBA, GL_FLOAT, NULL);
+    glBindTexture(GL_TEXTURE_2D, 0);
+
+    glBindFramebuffer(GL_FRAMEBUFFER, history.frameBuffer->GetIndex());
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, history.texture->GetIndex(), 0);
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+    HB_CHECK_GL_ERROR();
+
+    history.width = width;
+    history.height = height;
+}
+
+// ----------------------------------------------------------------------------
+
+void
+STVRStillFrames::Update(ovrPosef eyePoses[2], bool inputsStill, const STVRStillScene& scene)
+{
+    m_accumulating = false;
+
+    if (!m_enabled || !inputsStill)
+    {
+        Reset();
+        return;
+    }
+
+    // drawn as usual from its own pose, the next frame starts the history
+    if (!m_anchored || !_IsSameScene(scene) || !_IsNearAnchor(eyePoses))
+    {
+        m_anchored = true;
+        m_sampleCount = 0;
+        memcpy(m_anchorPoses, eyePoses, sizeof(m_anchorPoses));
+        m_anchorScene = scene;
+        return;
+    }
+
+    memcpy(eyePoses, m_anchorPoses, sizeof(m_anchorPoses));
+
+    if (m_sampleCount < c_ConvergedSampleCount)
+    {
+        m_accumulating = true;
+        m_sampleCount++;
+    }
+}
+
+// ----------------------------------------------------------------------------
+
+void
+STVRStillFrames::AddSample(int eye, GLuint eyeTexture, GLsizei width, GLsizei height)
+{
+    const EyeHistory& history = m_histories[eye];
+    if (!history.frameBuffer || width > history.width || height > history.height) {
+        return;
+    }
+
+    glBindFramebuffer(GL_FRAMEBUFFER, history.frameBuffer->GetIndex());
+
+    glPushAttrib(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT | GL_STENCIL_BUFFER_BIT | GL_ENABLE_BIT |
+        GL_TEXTURE_BIT | GL_VIEWPORT_BIT);
+
+    glViewport(0, 0, width, height);
+    glUseProgram(0);
+    glDisable(GL_DEPTH_TEST);
+    glDisable(GL_STENCIL_TEST);
+    glDisable(GL_CULL_FACE);
+
+    // The n'th sample weighs 1/n, which keeps the history the plain mean of
+    // every sample so far.  The first one is written without blending: the
+    // history is never cleared, and a NaN left in it would survive a weight
+    // of 0.
+    if (m_sampleCount > 1)
+    {
+        glEnable(GL_BLEND);
+        glBlendColor(0.f, 0.f, 0.f, 1.f / float(m_sampleCount));
+        glBlendFunc(GL_CONSTANT_ALPHA, GL_ONE_MINUS_CONSTANT_ALPHA);
+    }
+    else
+    {
+        glDisable(GL_BLEND);
+    }
+
+    glActiveTexture(GL_TEXTURE0);
+    glEnable(GL_TEXTURE_2D);
+    glBindTexture(GL_TEXTURE_2D, eyeTexture);
+    glTexEnvi(GL_TEXTURE_ENV, GL_TEXTURE_ENV_MODE, GL_REPLACE);
+
+    glMatrixMode(GL_PROJECTION);
+    glPushMatrix();
+    glLoadIdentity();
+    glMatrixMode(GL_MODELVIEW);
+    glPushMatrix();
+    glLoadIdentity();
+
+    // the history is sized like the eye texture, of which only the
+    // viewport holds this frame
+    float maxU = float(width) / float(history.width);
+    float maxV = float(height) / float(history.height);
+
+    glBegin(GL_QUADS);
+    glTexCoord2f(0.f, 0.f);     glVertex2f(-1.f, -1.f);
+    glTexCoord2f(maxU, 0.f);    glVertex2f(1.f, -1.f);
+    glTexCoord2f(maxU, maxV);   glVertex2f(1.f, 1.f);
+    glTexCoord2f(0.f, maxV);    glVertex2f(-1.f, 1.f);
+    glEnd();
+
+    glMatrixMode(GL_PROJECTION);
+    glPopMatrix();
+    glMatrixMode(GL_MODELVIEW);
+    glPopMatrix();
+
+    glBindTexture(GL_TEXTURE_2D, 0);
+    glPopAttrib();
+}
+
+// ----------------------------------------------------------------------------
+
+void
+STVRStillFrames::CopyToEye(int eye, GLuint eyeFrameBuffer, GLsizei width, GLsizei height)
+{
+    const EyeHistory& history = m_histories[eye];
+    if (!history.frameBuffer || width > history.width || height > history.height) {
+        return;
+    }
+
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, history.frameBuffer->GetIndex());
+    glBindFramebuffer(GL_DRAW_FRAMEBUFFER, eyeFrameBuffer);
+    glBlitFramebuffer(0, 0, width, height, 0, 0, width, height, GL_COLOR_BUFFER_BIT, GL_NEAREST);
+    glBindFramebuffer(GL_FRAMEBUFFER, eyeFrameBuffer);
+}
+
+// ----------------------------------------------------------------------------
+
+bool
+STVRStillFrames::_IsSameScene(const STVRStillScene& scene) const
+{
+    if (scene.program != m_anchorScene.program ||
+        scene.playTimeInSecs != m_anchorScene.playTimeInSecs ||
+        scene.focalLength != m_anchorScene.focalLength ||
+        scene.stereoView != m_anchorScene.stereoView ||
+        scene.lensMask != m_anchorScene.lensMask)
+    {
+        return false;
+    }
+
+    return memcmp(scene.channelTextures, m_anchorScene.channelTextures, sizeof(scene.channelTextures)) == 0 &&
+        memcmp(scene.viewportSizes, m_anchorScene.viewportSizes, sizeof(scene.viewportSizes)) == 0;
+}
+
+// ----------------------------------------------------------------------------
+
+bool
+STVRStillFrames::_IsNearAnchor(const ovrPosef eyePoses[2]) const
+{
+    for (int eye = 0; eye < c_NumEyes; eye++)
+    {
+        const ovrQuatf& q0 = m_anchorPoses[eye].Orientation;
+        const ovrQuatf& q1 = eyePoses[eye].Orientation;
+        float cosHalfAngle = std::min(std::fabs(q0.x * q1.x + q0.y * q1.y + q0.z * q1.z + q0.w * q1.w), 1.f);
+        if (2.f * std::acos(cosHalfAngle) > c_StillRadians) {
+            return false;
+        }
+
+        const ovrVector3f& p0 = m_anchorPoses[eye].Position;
+        const ovrVector3f& p1 = eyePoses[eye].Position;
+        float dx = p1.x - p0.x;
+        float dy = p1.y - p0.y;
+        float dz = p1.z - p0.z;
+        if (dx * dx + dy * dy + dz * dz > c_StillMeters * c_StillMeters) {
+            return false;
+        }
+    }
+    return true;
+}
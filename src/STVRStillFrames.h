@@ -0,0 +1,114 @@
+#pragma once
+
+#include "HBGLResourceWrappers.h"
+
+#include "OVR_CAPI.h"
+
+#include <GL/glew.h>
+
+using namespace HBGLUtils;
+
+//-----------------------------------------------------------------------------
+// Everything but the head pose that decides what the toy draws.  Two frames
+// with the same scene and the same pose draw the same image.
+
+struct STVRStillScene
+{
+    const void*     program;                // the toy program drawing
+    float           playTimeInSecs;         // 0 when the toy doesn't read it
+    float           focalLength;
+    GLuint          channelTextures[4];
+    GLsizei         viewportSizes[2][2];
+    bool            stereoView;
+    bool            lensMask;
+};
+
+//-----------------------------------------------------------------------------
+// Turns frames that would draw the same image into a supersampled one.
+// While the headset is nearly still and nothing else the toy reads changes,
+// each frame draws the toy from the pose the stillness began at, shading a
+// different spot inside every pixel (iPixelJitter), and averages it into a
+// floating point history of the eye.  Once the history has enough samples
+// the toy isn't drawn at all: the history is copied to the eye and the GPU
+// idles.  Timewarp turns the held pose to wherever the head drifted.
+//
+// The first frame at a new pose is drawn as usual; moving costs nothing
+// extra.  Render thread only, with the GL context current.
+
+class STVRStillFrames
+{
+public:
+
+    // - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+    // CONSTRO/DESTRO
+
+    STVRStillFrames();
+    ~STVRStillFrames();
+
+    // - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+    // ACCESSORS
+
+    bool IsEnabled() const;
+
+    // Frames averaged into the history, counting this one.  0 while the
+    // head or the toy moves.
+    unsigned int GetSampleCount() const;
+
+    // Draw the toy into the eye as usual (at GetPixelJitter), then AddSample
+    // and CopyToEye.
+    bool IsAccumulating() const;
+
+    // The history has all the samples it takes: don't draw the toy, just
+    // CopyToEye.
+    bool IsConverged() const;
+
+    // This frame's iPixelJitter, in pixels.  Zero unless accumulating.
+    void GetPixelJitter(float jitter[2]) const;
+
+    // - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+    // MODIFIERS
+
+    void SetEnabled(bool enabled);
+
+    // Start over from the next frame.
+    void Reset();
+
+    // Size eye's history like its eye texture.  Starts over.
+    void Resize(int eye, GLsizei width, GLsizei height);
+
+    // Once a frame, before drawing either eye.  inputsStill says no clock or
+    // stream the toy reads is moving.  While the head stays near the pose
+    // the history began at, eyePoses is set back to that pose, so the toy
+    // draws, and timewarp corrects from, the same view every frame.
+    void Update(ovrPosef eyePoses[2], bool inputsStill, const STVRStillScene& scene);
+
+    // Average the lower left width x height of eyeTexture, which holds this
+    // frame's sample, into eye's history.  Leaves the history bound.
+    void AddSample(int eye, GLuint eyeTexture, GLsizei width, GLsizei height);
+
+    // Copy the lower left width x height of eye's history into
+    // eyeFrameBuffer, and leave that bound.
+    void CopyToEye(int eye, GLuint eyeFrameBuffer, GLsizei width, GLsizei height);
+
+private:
+
+    static const int c_NumEyes = 2;
+
+    struct EyeHistory {
+        HBGLTextureResourcePtr      texture;
+        HBGLFrameBufferResourcePtr  frameBuffer;
+        GLsizei                     width;
+        GLsizei                     height;
+    };
+
+    bool _IsSameScene(const STVRStillScene& scene) const;
+    bool _IsNearAnchor(const ovrPosef eyePoses[2]) const;
+
+    bool                    m_enabled;
+    bool                    m_anchored;
+    bool                    m_accumulating;
+    unsigned int            m_sampleCount;
+    ovrPosef                m_anchorPoses[c_NumEyes];
+    STVRStillScene          m_anchorScene;
+    EyeHistory              m_histories[c_NumEyes];
+};
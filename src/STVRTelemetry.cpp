@@ -0,0 +1,262 @@
+#include "STVRTelemetry.h"
+
+#include <chrono>
+#include <cstring>
+#include <iostream>
+
+// ''''''''''''''''''''''''''''''''''''''''''''''''''''''''''''''''''''''''''''
+// STATIC FUNCTIONS
+// ,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,
+
+static const char c_TelemetryMagic[8] = { 'S', 'T', 'V', 'R', 'T', 'L', 'M', '\0' };
+static const unsigned int c_TelemetryVersion = 5;
+
+// a minute of frames at 75 Hz, the writer empties it every quarter second
+static const size_t c_TelemetryRingCapacity = 4096;
+static const int c_TelemetryFlushIntervalMillisecs = 250;
+
+struct STVRTelemetryHeader
+{
+    char            magic[8];
+    unsigned int    version;
+    unsigned int    recordSize;
+};
+
+// ''''''''''''''''''''''''''''''''''''''''''''''''''''''''''''''''''''''''''''
+// STVRTelemetry
+// ,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,
+
+bool
+STVRTelemetry::ConvertToCsv(const std::string& logPath, const std::string& csvPath)
+{
+    FILE* logFile = fopen(logPath.c_str(), "rb");
+    if (!logFile) {
+        std::cerr << "STVRTelemetry ERROR: cannot read [ " << logPath << " ]" << std::endl;
+        return false;
+    }
+
+    STVRTelemetryHeader header;
+    if (fread(&header, sizeof(header), 1, logFile) != 1 || memcmp(header.magic, c_TelemetryMagic, sizeof(c_TelemetryMagic)) != 0 ||
+        header.version != c_TelemetryVersion || header.recordSize != sizeof(Record)) {
+        std::cerr << "STVRTelemetry ERROR [ " << logPath << " ]: not a telemetry log of this version" << std::endl;
+        fclose(logFile);
+        return false;
+    }
+
+    FILE* csvFile = fopen(csvPath.c_str(), "w");
+    if (!csvFile) {
+        std::cerr << "STVRTelemetry ERROR: cannot write [ " << csvPath << " ]" << std::endl;
+        fclose(logFile);
+        return false;
+    }
+
+    fprintf(csvFile, "frame,start_s,toy,frame_ms,cpu_ms,toy_gpu_ms,late_start_ms,predicted_render_ms,"
+        "latency_render_ms,latency_timewarp_ms,latency_post_present_ms,"
+        "screen_percentage,render_scale,play_time_s,dropped,hmd_connected,orientation_tracked,position_tracked,camera_connected,"
+        "toy_specialized,lens_mask,head_qx,head_qy,head_qz,head_qw,head_x,head_y,head_z,head_angular_speed,"
+        "heap_allocs,heap_alloc_bytes,still_samples,still_reused\n");
+
+    std::string toyName;
+    unsigned long long frameCount = 0;
+    unsigned long long droppedCount = 0;
+    Record record;
+    while (fread(&record, sizeof(record), 1, logFile) == 1)
+    {
+        if (record.kind == RECORD_TOY) {
+            record.toyName[sizeof(record.toyName) - 1] = '\0';
+            toyName = record.toyName;
+            continue;
+        }
+        if (record.kind != RECORD_FRAME) {
+            continue;
+        }
+
+        const STVRFrameTelemetry& frame = record.frame;
+        fprintf(csvFile, "%u,%.6f,%s,%.3f,%.3f,%.3f,%.3f,%.3f,%.3f,%.3f,%.3f,%.2f,%.3f,%.3f,%d,%d,%d,%d,%d,%d,%d,%.5f,%.5f,%.5f,%.5f,%.4f,%.4f,%.4f,%.4f,%u,%u,%u,%d\n",
+            frame.frameIndex, frame.frameStartInSecs, toyName.c_str(), frame.frameMillisecs, frame.cpuMillisecs, frame.toyGpuMillisecs,
+            frame.lateStartMillisecs, frame.predictedRenderMillisecs,
+            frame.latencyRenderMillisecs, frame.latencyTimewarpMillisecs, frame.latencyPostPresentMillisecs,
+            frame.screenPercentage, frame.renderScale, frame.playTimeInSecs,
+            (frame.flags & STVR_FRAME_DROPPED) ? 1 : 0, (frame.flags & STVR_FRAME_HMD_CONNECTED) ? 1 : 0,
+            (frame.flags & STVR_FRAME_ORIENTATION_TRACKED) ? 1 : 0, (frame.flags & STVR_FRAME_POSITION_TRACKED) ? 1 : 0,
+            (frame.flags & STVR_FRAME_CAMERA_CONNECTED) ? 1 : 0, (frame.flags & STVR_FRAME_TOY_SPECIALIZED) ? 1 : 0,
+            (frame.flags & STVR_FRAME_LENS_MASK) ? 1 : 0,
+            frame.headOrientation[0], frame.headOrientation[1], frame.headOrientation[2], frame.headOrientation[3],
+            frame.headPosition[0], frame.headPosition[1], frame.headPosition[2], frame.headAngularSpeed,
+            frame.heapAllocCount, frame.heapAllocBytes,
+            frame.stillSampleCount, (frame.flags & STVR_FRAME_STILL_CONVERGED) ? 1 : 0);
+
+        frameCount++;
+        if (frame.flags & STVR_FRAME_DROPPED) {
+            droppedCount++;
+        }
+    }
+
+    fclose(logFile);
+    bool written = (fclose(csvFile) == 0);
+
+    std::cout << "STVRTelemetry [ " << logPath << " ]: " << frameCount << " frames, " << droppedCount << " dropped, written to [ " <<
+        csvPath << " ]" << std::endl;
+
+    return written;
+}
+
+// ----------------------------------------------------------------------------
+
+STVRTelemetry::STVRTelemetry() :
+m_ring(c_TelemetryRingCapacity),
+m_logFile(NULL)
+{
+    m_stopWriter.store(false);
+    m_writtenCount.store(0);
+    m_lostCount.store(0);
+}
+
+// ----------------------------------------------------------------------------
+
+STVRTelemetry::~STVRTelemetry()
+{
+    Stop();
+}
+
+// ----------------------------------------------------------------------------
+
+bool
+STVRTelemetry::Start(const std::string& logPath)
+{
+    Stop();
+
+    m_logFile = fopen(logPath.c_str(), "wb");
+    if (!m_logFile) {
+        std::cerr << "STVRTelemetry ERROR: cannot write [ " << logPath << " ]" << std::endl;
+        return false;
+    }
+
+    STVRTelemetryHeader header;
+    memcpy(header.magic, c_TelemetryMagic, sizeof(c_TelemetryMagic));
+    header.version = c_TelemetryVersion;
+    header.recordSize = sizeof(Record);
+    fwrite(&header, sizeof(header), 1, m_logFile);
+
+    m_logPath = logPath;
+    m_writeBatch.resize(m_ring.GetCapacity());
+    m_writtenCount.store(0);
+    m_lostCount.store(0);
+    m_stopWriter.store(false);
+    m_writer = std::thread(&STVRTelemetry::_WriterLoop, this);
+
+    std::cout << "STVRTelemetry: recording to [ " << logPath << " ]" << std::endl;
+    return true;
+}
+
+// ----------------------------------------------------------------------------
+
+void
+STVRTelemetry::Stop()
+{
+    if (!m_logFile) {
+        return;
+    }
+
+    m_stopWriter.store(true);
+    if (m_writer.joinable()) {
+        m_writer.join();
+    }
+
+    // anything pushed while the writer was finishing up
+    _WriteQueued();
+    fclose(m_logFile);
+    m_logFile = NULL;
+
+    std::cout << "STVRTelemetry [ " << m_logPath << " ]: " << m_writtenCount.load() << " records written, " <<
+        m_lostCount.load() << " lost" << std::endl;
+}
+
+// ----------------------------------------------------------------------------
+
+bool
+STVRTelemetry::IsRecording() const
+{
+    return m_logFile != NULL;
+}
+
+// ----------------------------------------------------------------------------
+
+unsigned long long
+STVRTelemetry::GetWrittenCount() const
+{
+    return m_writtenCount.load();
+}
+
+// ----------------------------------------------------------------------------
+
+unsigned long long
+STVRTelemetry::GetLostCount() const
+{
+    return m_lostCount.load();
+}
+
+// ----------------------------------------------------------------------------
+
+void
+STVRTelemetry::RecordToy(const std::string& toyName)
+{
+    Record record;
+    memset(&record, 0, sizeof(record));
+    record.kind = RECORD_TOY;
+    strncpy(record.toyName, toyName.c_str(), sizeof(record.toyName) - 1);
+    _Push(record);
+}
+
+// ----------------------------------------------------------------------------
+
+void
+STVRTelemetry::RecordFrame(const STVRFrameTelemetry& frame)
+{
+    Record record;
+    record.kind = RECORD_FRAME;
+    record.frame = frame;
+    _Push(record);
+}
+
+// ----------------------------------------------------------------------------
+
+void
+STVRTelemetry::_Push(const Record& record)
+{
+    if (!m_logFile) {
+        return;
+    }
+
+    if (!m_ring.Push(record)) {
+        m_lostCount.fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+// ----------------------------------------------------------------------------
+
+void
+STVRTelemetry::_WriterLoop()
+{
+    while (!m_stopWriter.load())
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(c_TelemetryFlushIntervalMillisecs));
+        _WriteQueued();
+        fflush(m_logFile);
+    }
+}
+
+// ----------------------------------------------------------------------------
+
+void
+STVRTelemetry::_WriteQueued()
+{
+    size_t recordCount = m_ring.Pop(&m_writeBatch[0], m_writeBatch.size());
+    if (recordCount == 0) {
+        return;
+    }
+
+    size_t writtenCount = fwrite(&m_writeBatch[0], sizeof(Record), recordCount, m_logFile);
+    m_writtenCount.fetch_add(writtenCount, std::memory_order_relaxed);
+    m_lostCount.fetch_add(recordCount - writtenCount, std::memory_order_relaxed);
+}
@@ -0,0 +1,134 @@
+#pragma once
+
+#include "HBGLSpscRing.h"
+
+#include <atomic>
+#include <cstdio>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace HBGLUtils;
+
+//-----------------------------------------------------------------------------
+// What one frame in the headset looked like.  Latencies are LibOVR's own
+// measurements ("DK2Latency"), zero when it has none.
+
+enum STVRFrameFlag
+{
+    STVR_FRAME_DROPPED              = 1 << 0,   // took more than 1.5 refreshes
+    STVR_FRAME_HMD_CONNECTED        = 1 << 1,
+    STVR_FRAME_ORIENTATION_TRACKED  = 1 << 2,
+    STVR_FRAME_POSITION_TRACKED     = 1 << 3,
+    STVR_FRAME_CAMERA_CONNECTED     = 1 << 4,
+    STVR_FRAME_TOY_SPECIALIZED      = 1 << 5,
+    STVR_FRAME_LENS_MASK            = 1 << 6,
+    STVR_FRAME_STILL_CONVERGED      = 1 << 7    // reused a still history, the toy wasn't drawn
+};
+
+struct STVRFrameTelemetry
+{
+    double          frameStartInSecs;       // ovr_GetTimeInSeconds
+    unsigned int    frameIndex;
+    unsigned int    flags;                  // STVRFrameFlag
+    float           frameMillisecs;         // since the previous frame started
+    float           cpuMillisecs;           // drawing both eyes, up to EndFrame
+    float           toyGpuMillisecs;        // latest result of the toy GPU timer
+    float           lateStartMillisecs;     // STVRFramePacer held the frame back this long
+    float           predictedRenderMillisecs;   // and expected it to take this long
+    float           latencyRenderMillisecs;
+    float           latencyTimewarpMillisecs;
+    float           latencyPostPresentMillisecs;
+    float           screenPercentage;
+    float           renderScale;            // of the eye viewports, see STVRMotionResolution
+    float           playTimeInSecs;
+    float           headOrientation[4];     // quaternion x, y, z, w
+    float           headPosition[3];        // meters
+    float           headAngularSpeed;       // radians per second
+    unsigned int    heapAllocCount;         // on the render thread, see STVRTrackingAllocator
+    unsigned int    heapAllocBytes;
+    unsigned int    stillSampleCount;       // see STVRStillFrames
+};
+
+//-----------------------------------------------------------------------------
+// Records a session frame by frame, cheaply enough to leave on for a whole
+// kiosk day.  The render thread only copies a record into a lock free ring;
+// a writer thread wakes a few times a second and appends everything queued
+// to a binary log.  If the writer ever falls a whole ring behind, records
+// are counted as lost rather than making the frame wait.
+//
+// The log is a header and then fixed size records, either a frame or the
+// name of the toy the frames after it belong to.  ConvertToCsv turns it into
+// one row per frame with the toy's name on each.
+
+class STVRTelemetry
+{
+public:
+
+    // - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+    // PUBLIC STATIC
+
+    static bool ConvertToCsv(const std::string& logPath, const std::string& csvPath);
+
+    // - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+    // CONSTRO/DESTRO
+
+    STVRTelemetry();
+    ~STVRTelemetry();
+
+    // Create (or truncate) logPath and start the writer.
+    bool Start(const std::string& logPath);
+
+    // Write out whatever is still queued and close the log.
+    void Stop();
+
+    // - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+    // ACCESSORS
+
+    bool IsRecording() const;
+
+    unsigned long long GetWrittenCount() const;
+    unsigned long long GetLostCount() const;
+
+    // - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+    // MODIFIERS
+
+    // Render thread only.  Frames recorded after this belong to toyName.
+    void RecordToy(const std::string& toyName);
+    void RecordFrame(const STVRFrameTelemetry& frame);
+
+private:
+
+    enum RecordKind
+    {
+        RECORD_FRAME = 1,
+        RECORD_TOY = 2
+    };
+
+    struct Record
+    {
+        unsigned int                kind;
+        union
+        {
+            STVRFrameTelemetry      frame;
+            char                    toyName[sizeof(STVRFrameTelemetry)];
+        };
+    };
+
+    void _Push(const Record& record);
+    void _WriterLoop();
+    void _WriteQueued();
+
+    HBGLSpscRing<Record>            m_ring;
+    std::vector<Record>             m_writeBatch;
+    std::string                     m_logPath;
+    FILE*                           m_logFile;
+
+    std::thread                     m_writer;
+    std::atomic<bool>               m_stopWriter;
+    std::atomic<unsigned long long> m_writtenCount;
+    std::atomic<unsigned long long> m_lostCount;
+};
+
+typedef std::shared_ptr<STVRTelemetry> STVRTelemetryPtr;
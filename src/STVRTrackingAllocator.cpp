@@ -0,0 +1,221 @@
+#include "STVRTrackingAllocator.h"
+
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+#if defined(_MSC_VER)
+#define STVR_THREAD_LOCAL __declspec(thread)
+#else
+#define STVR_THREAD_LOCAL __thread
+#endif
+
+// ''''''''''''''''''''''''''''''''''''''''''''''''''''''''''''''''''''''''''''
+// STATIC FUNCTIONS
+// ,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,
+
+// operator new runs before main and on every thread, so the counters are
+// plain zero initialized statics that need no constructing.
+struct AtomicAllocCounts
+{
+    std::atomic<unsigned long long>     allocCount;
+    std::atomic<unsigned long long>     allocBytes;
+};
+
+static AtomicAllocCounts                s_totalCounts[STVR_ALLOC_TAG_COUNT];
+static AtomicAllocCounts                s_frameCounts[STVR_ALLOC_TAG_COUNT];
+static STVRFrameAllocStats              s_lastFrame;
+
+// only ever touched by the render thread, so not atomic
+static STVRAllocCounts                  s_frameThreadCounts;
+
+static STVR_THREAD_LOCAL int            s_threadTag;        // STVRAllocTag
+static STVR_THREAD_LOCAL bool           s_isFrameThread;
+
+static const char* c_AllocTagNames[STVR_ALLOC_TAG_COUNT] = { "App", "LibOVR", "Reload" };
+
+// ----------------------------------------------------------------------------
+
+static void
+CountAlloc(STVRAllocTag tag, size_t size)
+{
+    s_totalCounts[tag].allocCount.fetch_add(1, std::memory_order_relaxed);
+    s_totalCounts[tag].allocBytes.fetch_add(size, std::memory_order_relaxed);
+    s_frameCounts[tag].allocCount.fetch_add(1, std::memory_order_relaxed);
+    s_frameCounts[tag].allocBytes.fetch_add(size, std::memory_order_relaxed);
+
+    if (s_isFrameThread) {
+        s_frameThreadCounts.allocCount++;
+        s_frameThreadCounts.allocBytes += size;
+    }
+}
+
+// ''''''''''''''''''''''''''''''''''''''''''''''''''''''''''''''''''''''''''''
+// operator new/delete
+// ,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,
+
+// Replacing these counts every C++ allocation in the executable.  The memory
+// is still malloc's, so anything freed elsewhere with free or the runtime's
+// own delete is freed the same way.
+
+void*
+operator new(size_t size)
+{
+    CountAlloc(STVRAllocTag(s_threadTag), size);
+
+    void* p = malloc(size ? size : 1);
+    if (!p) {
+        throw std::bad_alloc();
+    }
+    return p;
+}
+
+// ----------------------------------------------------------------------------
+
+void*
+operator new[](size_t size)
+{
+    return operator new(size);
+}
+
+// ----------------------------------------------------------------------------
+
+void
+operator delete(void* p) throw()
+{
+    free(p);
+}
+
+// ----------------------------------------------------------------------------
+
+void
+operator delete[](void* p) throw()
+{
+    free(p);
+}
+
+// ''''''''''''''''''''''''''''''''''''''''''''''''''''''''''''''''''''''''''''
+// STVRTrackingAllocator
+// ,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,
+
+const char*
+STVRTrackingAllocator::GetTagName(STVRAllocTag tag)
+{
+    return (tag >= 0 && tag < STVR_ALLOC_TAG_COUNT) ? c_AllocTagNames[tag] : "Unknown";
+}
+
+// ----------------------------------------------------------------------------
+
+void
+STVRTrackingAllocator::BeginFrame()
+{
+    s_isFrameThread = true;
+
+    for (int tagIdx = 0; tagIdx < STVR_ALLOC_TAG_COUNT; tagIdx++)
+    {
+        s_lastFrame.tagCounts[tagIdx].allocCount = s_frameCounts[tagIdx].allocCount.exchange(0, std::memory_order_relaxed);
+        s_lastFrame.tagCounts[tagIdx].allocBytes = s_frameCounts[tagIdx].allocBytes.exchange(0, std::memory_order_relaxed);
+    }
+
+    s_lastFrame.frameThreadCounts = s_frameThreadCounts;
+    s_frameThreadCounts.allocCount = 0;
+    s_frameThreadCounts.allocBytes = 0;
+}
+
+// ----------------------------------------------------------------------------
+
+const STVRFrameAllocStats&
+STVRTrackingAllocator::GetLastFrame()
+{
+    return s_lastFrame;
+}
+
+// ----------------------------------------------------------------------------
+
+STVRAllocCounts
+STVRTrackingAllocator::GetFrameThreadCounts()
+{
+    return s_frameThreadCounts;
+}
+
+// ----------------------------------------------------------------------------
+
+void
+STVRTrackingAllocator::PrintReport(std::ostream& out)
+{
+    for (int tagIdx = 0; tagIdx < STVR_ALLOC_TAG_COUNT; tagIdx++)
+    {
+        out << "STVRTrackingAllocator [ " << c_AllocTagNames[tagIdx] << " ]: " <<
+            s_totalCounts[tagIdx].allocCount.load() << " allocations, " <<
+            s_totalCounts[tagIdx].allocBytes.load() / 1024 << " KB" << std::endl;
+    }
+}
+
+// ----------------------------------------------------------------------------
+
+STVRTrackingAllocator::STVRTrackingAllocator()
+{
+
+}
+
+// ----------------------------------------------------------------------------
+
+STVRTrackingAllocator::~STVRTrackingAllocator()
+{
+
+}
+
+// ----------------------------------------------------------------------------
+
+void*
+STVRTrackingAllocator::Alloc(size_t size)
+{
+    CountAlloc(STVR_ALLOC_LIBOVR, size);
+    return malloc(size);
+}
+
+// ----------------------------------------------------------------------------
+
+void*
+STVRTrackingAllocator::AllocDebug(size_t size, const char* file, unsigned line)
+{
+    OVR_UNUSED2(file, line);
+    return Alloc(size);
+}
+
+// ----------------------------------------------------------------------------
+
+void*
+STVRTrackingAllocator::Realloc(void* p, size_t newSize)
+{
+    // may move, so it counts as allocating the new size
+    if (newSize > 0) {
+        CountAlloc(STVR_ALLOC_LIBOVR, newSize);
+    }
+    return realloc(p, newSize);
+}
+
+// ----------------------------------------------------------------------------
+
+void
+STVRTrackingAllocator::Free(void* p)
+{
+    free(p);
+}
+
+// ''''''''''''''''''''''''''''''''''''''''''''''''''''''''''''''''''''''''''''
+// STVRAllocTagScope
+// ,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,
+
+STVRAllocTagScope::STVRAllocTagScope(STVRAllocTag tag) :
+m_outerTag(STVRAllocTag(s_threadTag))
+{
+    s_threadTag = tag;
+}
+
+// ----------------------------------------------------------------------------
+
+STVRAllocTagScope::~STVRAllocTagScope()
+{
+    s_threadTag = m_outerTag;
+}
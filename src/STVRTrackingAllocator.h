@@ -0,0 +1,98 @@
+#pragma once
+
+#include "Kernel/OVR_Allocator.h"
+
+#include <iostream>
+
+//-----------------------------------------------------------------------------
+// What a heap allocation was for.  LibOVR's allocations come through
+// OVR::Allocator and are always LIBOVR.  The app's come through operator new
+// and take the tag of the innermost STVRAllocTagScope on their thread, APP
+// outside of any.
+
+enum STVRAllocTag
+{
+    STVR_ALLOC_APP = 0,
+    STVR_ALLOC_LIBOVR,
+    STVR_ALLOC_RELOAD,      // loading toys, and whatever a key press asks for
+    STVR_ALLOC_TAG_COUNT
+};
+
+struct STVRAllocCounts
+{
+    unsigned long long      allocCount;
+    unsigned long long      allocBytes;
+};
+
+// Everything allocated from one BeginFrame to the next.
+struct STVRFrameAllocStats
+{
+    STVRAllocCounts         tagCounts[STVR_ALLOC_TAG_COUNT];    // on any thread
+    STVRAllocCounts         frameThreadCounts;                  // on the thread calling BeginFrame
+};
+
+//-----------------------------------------------------------------------------
+// Counts every heap allocation the process makes, by tag and by frame,
+// without changing where the memory comes from: it all still goes to malloc.
+// Installed as LibOVR's OVR::Allocator (pass it to OVR::System::Init before
+// ovr_Initialize), and the global operator new it replaces counts the rest.
+// Only allocations are counted, not frees, so the numbers are how much
+// allocating went on rather than how much is live.
+//
+// The counters are process wide and atomic, since LibOVR and the streams
+// allocate on their own threads.  The render thread calls BeginFrame once a
+// frame; a steady frame should leave frameThreadCounts at zero.
+
+class STVRTrackingAllocator : public OVR::Allocator
+{
+public:
+
+    // - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+    // PUBLIC STATIC
+
+    static const char* GetTagName(STVRAllocTag tag);
+
+    // Render thread only.  Closes the frame so far (see GetLastFrame) and
+    // starts counting the next.
+    static void BeginFrame();
+
+    static const STVRFrameAllocStats& GetLastFrame();
+
+    // What the render thread has allocated since BeginFrame.
+    static STVRAllocCounts GetFrameThreadCounts();
+
+    // Totals since the process started, one line per tag.
+    static void PrintReport(std::ostream& out);
+
+    // - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+    // CONSTRO/DESTRO
+
+    STVRTrackingAllocator();
+    virtual ~STVRTrackingAllocator();
+
+    // - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+    // OVR::Allocator
+
+    virtual void* Alloc(size_t size);
+    virtual void* AllocDebug(size_t size, const char* file, unsigned line);
+    virtual void* Realloc(void* p, size_t newSize);
+    virtual void Free(void* p);
+};
+
+//-----------------------------------------------------------------------------
+// Tags what operator new allocates on this thread until it goes out of scope.
+
+class STVRAllocTagScope
+{
+public:
+
+    explicit STVRAllocTagScope(STVRAllocTag tag);
+    ~STVRAllocTagScope();
+
+private:
+
+    STVRAllocTagScope(const STVRAllocTagScope&);
+    STVRAllocTagScope& operator=(const STVRAllocTagScope&);
+
+    STVRAllocTag    m_outerTag;
+};
@@ -32,6 +32,7 @@
 
 #include <iostream>
 #include <cstdlib>
+#include <cstring>
 #include <cmath>
 #include <algorithm>
 
@@ -44,13 +45,37 @@
 #include "HBGLStats.h"
 #include "HBGLShaders.h"
 #include "STVRShaders.h"
+#include "STVRChannelStreams.h"
+#include "STVRAudioStream.h"
+#include "STVRShaderReloader.h"
+#include "STVRShaderVariants.h"
+#include "STVRBufferPasses.h"
+#include "STVRAssets.h"
+#include "STVRPlaylist.h"
+#include "STVRCpuRenderer.h"
+#include "STVRGoldenImages.h"
+#include "STVRLensMask.h"
+#include "STVRTelemetry.h"
+#include "STVRTrackingAllocator.h"
+#include "STVRFramePacer.h"
+#include "STVRMotionResolution.h"
+#include "STVRStillFrames.h"
+#include "STVRCommandQueueBenchmark.h"
+#include "STVRHandoffBenchmark.h"
+#include "STVRJsonBenchmark.h"
+#include "STVRPropertyBenchmark.h"
 #include "HBGLUtils.h"
 #include "HBGLResourceWrappers.h"
+#include "HBGLFileWatcher.h"
+#include "HBGLGpuTimer.h"
+#include "HBGLFrameArena.h"
 
 // OUTSIDE DEPENDENCIES
 
 #include "OVR.h"
 #include "OVR_CAPI_GL.h"
+#include "Kernel/OVR_System.h"
+
 #include "SOIL.h"
 
 #include "glm/glm.hpp"
@@ -70,7 +95,18 @@ using namespace HBGLUtils;
 #define BUFFER_OFFSET(i) ((char *)NULL + (i))
 
 const bool c_DebugMode = true;
-const bool c_DebugModeRelink = false;
+
+// Rebuild the toy and reload its channel sources whenever they are saved
+const bool c_WatchToyFiles = true;
+
+// Bake inputs that rarely change (resolution, focal length, ...) into a
+// specialized build of the toy once they have held still for a moment.
+const bool c_SpecializeToyUniforms = true;
+const float c_VariantSettleInSecs = .5f;
+
+// GPU times are tagged with the variant key and, in the top byte that
+// variant keys leave clear, the motion resolution scale they were drawn at
+const int c_RenderKeyScaleShift = 56;
 
 const bool c_DebugWindowed = false;
 
@@ -80,6 +116,65 @@ const int c_SphGridNumLongSpans = 32;
 const int c_DefaultWindowWidth = 1920;
 const int c_DefaultWindowHeight = 1080;
 
+// Linked shader programs are cached here so relaunching skips GLSL compilation
+const char* c_ProgramBinaryCacheDir = "../cache";
+
+// LibOVR keeps the lens distortion meshes here, so configuring rendering reads
+// them back instead of solving the inverse distortion for every vertex
+const char* c_DistortionMeshCacheDir = "../cache";
+
+// how the headset distorts the eye textures; the lens masks are built for it
+const unsigned int c_OVRDistortionCaps = ovrDistortionCap_TimeWarp | ovrDistortionCap_Chromatic | ovrDistortionCap_Vignette;
+
+// TODO: make file searching better!
+// The toy to draw when there is no --playlist
+const char* c_ShaderToyFilePath = "../glshaders/shadertoy.fs";
+
+// names toys can use for image and cubemap channels
+const char* c_AssetManifestPath = "../resources/assets.manifest";
+
+// --cpu draws this many frames at this size, 1/60th of a second apart
+const int c_CpuDefaultWidth = 640;
+const int c_CpuDefaultHeight = 360;
+const int c_CpuDefaultFrameCount = 1;
+const float c_CpuFrameStepInSecs = 1.f / 60.f;
+
+// --golden checks every toy found here, at this size unless --cpu-size says
+// otherwise; the goldens in ../goldens are this size
+const char* c_GoldenToyDirectory = "../glshaders";
+const int c_GoldenDefaultWidth = 96;
+const int c_GoldenDefaultHeight = 54;
+
+// its scaled case turns the head this fast, enough for motion resolution to
+// reach its smallest scale, and its still case stops waiting for the still
+// frames to converge after this many frames
+const float c_GoldenTurnRadiansPerSec = 4.f;
+const int c_GoldenMaxStillFrames = 32;
+
+// the tracking camera's field of view when there is no headset to ask; it
+// sets the focal scale of iCameraTransform
+const float c_DebugCameraFovInRadians = 1.9f;
+
+// --bench runs each thread handoff case for this long
+const double c_BenchSecondsPerCase = 2.0;
+
+// and parses each JSON case this many times
+const int c_BenchJsonRepeatCount = 50;
+
+// and looks up each HMD property name this many times
+const int c_BenchPropertyLookupCount = 1000000;
+
+// and pushes this many commands through each command queue case
+const int c_BenchQueueCommandCount = 1000000;
+
+// Per frame scratch (overlay text and the like), reset as each frame begins
+const size_t c_FrameArenaSize = 64 * 1024;
+
+// A frame that loaded or reloaded anything allocates, and so do the next few
+// while LibOVR and the driver settle; after that a frame that allocates on
+// the render thread is a regression worth a warning.
+const unsigned int c_HeapCheckSettleFrames = 90;
+
 const GLuint c_ChannelTextures[4] = { GL_TEXTURE0, GL_TEXTURE1, GL_TEXTURE2, GL_TEXTURE3 };
 
 // ========================================================================
@@ -88,12 +183,13 @@ const GLuint c_ChannelTextures[4] = { GL_TEXTURE0, GL_TEXTURE1, GL_TEXTURE2, GL_
 
 static GLFWwindow* g_GLFWWindow;
 
+// Every time here is ovr_GetTimeInSeconds, the clock LibOVR times frames with
 static uint                           g_FrameNumber = 0;
-static float                          g_TimebaseInSecs = 0.0f;
+static double                         g_TimebaseInSecs = 0.0;
 static float                          g_FramesPerSecond = 0.0f;
 
 static float                          g_PlaybackTimeInSecs = 0.0f;
-static float                          g_PlaybackResetInSecs = 0.0f;
+static double                         g_PlaybackResetInSecs = 0.0;
 static bool                           g_Playing = true;
 
 static bool                           g_DisplaySphereGrid = false;
@@ -106,16 +202,52 @@ static uint                           g_NumSphereGridIndices;
 static HBGLBufferResourcePtr          g_ScreenQuadVertexVBOID;
 static HBGLShaderProgramPtr           g_SphereGridShaderProgram;
 static HBGLShaderProgramPtr           g_ScreenQuadShaderProgram;
+static HBGLShaderProgramPtr           g_ActiveToyProgram;
+static STVRBufferPassesPtr            g_BufferPasses(new STVRBufferPasses());
+static std::string                    g_ShaderToyFilePath = c_ShaderToyFilePath;
+
+static STVRPlaylist                   g_Playlist;
+static bool                           g_ToySwitchPending = false;
+static size_t                         g_PendingToyIndex = 0;
+static int                            g_PendingToyStep = 1;
+static std::vector<STVRResidentToyPtr> g_FailedToys;
 
 static HBGLOverlayStatsPtr            g_OverlayStats;
+static STVRShaderReloader             g_ShaderReloader;
+static HBGLFileWatcher                g_FileWatcher;
+static bool                           g_ShaderReloadPending = false;
+static STVRShaderVariantCache         g_ShaderVariants;
+static unsigned long long             g_ActiveVariantKey = 0;
+static unsigned long long             g_WantedVariantKey = 0;
+static double                         g_WantedVariantSinceInSecs = 0.0;
+static unsigned long long             g_FailedVariantKey = 0;
+static STVRShaderConstants            g_BuildingVariantConstants;
+static HBGLGpuTimerPtr                g_ToyGpuTimer;
+static float                          g_ToyGpuMillisecs = 0.f;
+
+static STVRTrackingAllocator          g_TrackingAllocator;
+static HBGLFrameArena                 g_FrameArena(c_FrameArenaSize);
+static STVRFramePacer                 g_FramePacer;
+static STVRMotionResolution           g_MotionResolution;
+static STVRStillFrames                g_StillFrames;
+static unsigned int                   g_HeapSteadyFrameCount = 0;
+static unsigned long long             g_HeapAllocatingFrameCount = 0;
+
+static STVRTelemetry                  g_Telemetry;
+static unsigned int                   g_TelemetryFrameIndex = 0;
+static double                         g_TelemetryFrameStartInSecs = 0.0;
+static std::string                    g_TelemetryToyPath;
+static ovrPropertyKey                 g_DK2LatencyKey = NULL;
 
 static HBGLTextureResourcePtr         g_ChannelTextures[4];
+static STVRChannelStreamPtr           g_ChannelStreams[4];
 static GLfloat                        g_ChannelTimes[4] = { 0.f, 0.f, 0.f, 0.f };
 static GLfloat                        g_ChannelResolutions[4][3] = { { 0.f, 0.f, 0.f },
                                                                      { 0.f, 0.f, 0.f },
                                                                      { 0.f, 0.f, 0.f },
                                                                      { 0.f, 0.f, 0.f } };
 static glm::vec4                      g_Date;
+static GLfloat                        g_SampleRate = 0.f;
 
 static ovrHmd		                  g_HMD;
 static ovrGLTexture                   g_EyeTextures[2];
@@ -126,7 +258,10 @@ static float                          g_FocalLengthScalar = 1.f;
 static HBGLFrameBufferResourcePtr	  g_OVRFrameBuffer[2];
 static HBGLTextureResourcePtr         g_OVRColorTexture[2];
 static HBGLRenderBufferResourcePtr    g_OVRDepthTexture[2];
+static STVRLensMask                   g_OVRLensMask[2];
+static bool                           g_OVRLensMaskEnabled = true;
 static GLsizei                        g_OVRTextureSize[2][2];
+static GLsizei                        g_OVRViewportSize[2][2];   // what this frame renders of the texture
 static glm::mat4                      g_OVRCamPerspective[2];
 static glm::vec3                      g_OVRCamOffset[2];
 static bool                           g_OVRStereoView;
@@ -140,7 +275,11 @@ static glm::mat4                      g_WalkPosition;
 // ========================================================================
 
 void ShaderToyVRResetOVRPosition();
+void ShaderToyVRResetWorldTimer();
 void ShaderToyVRErrorAndQuit();
+int ShaderToyVRRenderOnCpu(int width, int height, int frameCount, const std::string& outputDirectory);
+int ShaderToyVRRenderHmdOnCpu(int frameCount, const std::string& outputDirectory);
+int ShaderToyVRRunGoldens(int width, int height, const std::string& goldenDirectory, bool updateGoldens);
 
 // ========================================================================
 // MATH UTILITIES
@@ -192,6 +331,33 @@ namespace std
 // GL INIT
 // ========================================================================
 
+// The image pass of the toy at toyPath, compiled and linked.  Null if it
+// did not build.
+HBGLShaderProgramPtr
+ShaderToyVRBuildToyProgram(const std::string& toyPath)
+{
+    HBGLShaderProgramPtr program(new HBGLShaderProgram("ShaderToyVR Screen Quad Shader Program"));
+    program->SetBinaryCacheDirectory(c_ProgramBinaryCacheDir);
+
+    HBGLShaderPtr stvrVertShader = HBGLShaderPtr(new STVRVertexShader());
+    HBGLShaderPtr stvrFragShader = HBGLShaderPtr(new STVRFragmentShader(toyPath));
+    if (!program->LoadAndCompileShaders(stvrVertShader, stvrFragShader))
+    {
+        return HBGLShaderProgramPtr();
+    }
+
+    GLint reservedIndex;
+    program->ReserveAttribLocation("position", &reservedIndex);
+    program->ReserveAttribLocation("texcoord", &reservedIndex);
+
+    // with the binary cache on, compile errors only show up here
+    if (!program->LinkShaders())
+    {
+        return HBGLShaderProgramPtr();
+    }
+    return program;
+}
+
 void
 ShaderToyVRInitShaderSystem()
 {
@@ -201,6 +367,7 @@ ShaderToyVRInitShaderSystem()
 
         HBGLShaderProgram* shprog = new HBGLShaderProgram("ShaderToyVR Sphere Grid Shader Program");
         g_SphereGridShaderProgram = HBGLShaderProgramPtr(shprog); // should flush any existing reference in the construction
+        g_SphereGridShaderProgram->SetBinaryCacheDirectory(c_ProgramBinaryCacheDir);
 
         STVRDebugGridVertexShader* vshader = new STVRDebugGridVertexShader();
         HBGLShaderPtr stvrDebugGridVertShader = HBGLShaderPtr(vshader);
@@ -220,28 +387,24 @@ ShaderToyVRInitShaderSystem()
 
     {
 
-        // TODO: allow for reloading of the shader
-
-        HBGLShaderProgram* shprog = new HBGLShaderProgram("ShaderToyVR Screen Quad Shader Program");
-        g_ScreenQuadShaderProgram = HBGLShaderProgramPtr(shprog); // should flush any existing reference in the construction
-
-        STVRVertexShader* vshader = new STVRVertexShader();
-        HBGLShaderPtr stvrVertShader = HBGLShaderPtr(vshader);
+        // toys look up their channel textures while they are parsed
+        STVRAssetRegistry::Get().LoadManifest(c_AssetManifestPath);
 
-        // TODO: make file searching better!
-        STVRFragmentShader* fshader = new STVRFragmentShader("../glshaders/shadertoy.fs");
-        HBGLShaderPtr stvrFragShader = HBGLShaderPtr(fshader);
-
-        if (!g_ScreenQuadShaderProgram->LoadAndCompileShaders(stvrVertShader, stvrFragShader))
+        g_ScreenQuadShaderProgram = ShaderToyVRBuildToyProgram(g_ShaderToyFilePath);
+        if (!g_ScreenQuadShaderProgram)
         {
-            std::cerr << "Aborting since there was no valid shadertoy shader." << std::endl;
+            std::cerr << "Aborting since the shadertoy shader did not compile and link." << std::endl;
             ShaderToyVRErrorAndQuit();
         }
 
-        GLint reservedIndex;
-        g_ScreenQuadShaderProgram->ReserveAttribLocation("position", &reservedIndex);
-        g_ScreenQuadShaderProgram->ReserveAttribLocation("texcoord", &reservedIndex);
-        g_ScreenQuadShaderProgram->LinkShaders();
+        g_ActiveToyProgram = g_ScreenQuadShaderProgram;
+        g_ShaderVariants.Reset(g_ScreenQuadShaderProgram);
+
+        // FRAGILE: consider re-implementing GetFragmentShader as a virtual function that
+        // returns an already cast STVRFragmentShaderPtr.
+        HBGLShaderPtr fragShaderPtr = g_ScreenQuadShaderProgram->GetFragmentShader();
+        const STVRFragmentShader* stvrFragShader = static_cast<STVRFragmentShader*>(&*fragShaderPtr);
+        g_BufferPasses->Load(stvrFragShader, c_ProgramBinaryCacheDir);
     }   
 
     // -------------------------------------------------
@@ -360,332 +523,817 @@ ShaderToyVRGenSphereGridBuffers()
 // ========================================================================
 
 bool
-ShaderToyVRGenImageTexture(ShaderToyVRChannelType textureType, HBGLTextureResourcePtr& textureResource)
+ShaderToyVRGenChannelStream(const STVRFragmentShader* stvrFragShader, 
+                            ShaderToyVRInputChannel inputChannel, 
+                            STVRChannelStreamPtr& channelStream)
 {
+    ShaderToyVRChannelType inputType = stvrFragShader->GetInputType(inputChannel);
+    const std::string& sourcePath = stvrFragShader->GetInputSource(inputChannel);
+
+    // the capture stand in synthesizes its audio, everything else reads a file
+    if (sourcePath.empty() && inputType != SHADERTOYVR_AUDIO_CAPTURE)
+    {
+        std::cerr << "ShaderToyVR ERROR: streamed channel [ " << inputChannel << " ] needs an iChannel" << inputChannel << "Source" << std::endl;
+        return false;
+    }
 
-    textureResource->Generate();
-    GLuint texID = textureResource->GetIndex();
+    char streamName[16];
+    sprintf(streamName, "iChannel%i", inputChannel);
 
-    // TODO: Make better file finding logic
-    if (textureType == SHADERTOYVR_RGB_NOISE_256x256_TEX)
+    if (inputType == SHADERTOYVR_AUDIO_FILE)
+    {
+        channelStream = STVRChannelStreamPtr(new STVRAudioStream(streamName, new STVRWavAudioSource()));
+    }
+    else if (inputType == SHADERTOYVR_AUDIO_CAPTURE)
+    {
+        channelStream = STVRChannelStreamPtr(new STVRAudioStream(streamName, new STVRCaptureStandInSource()));
+    }
+    else
     {
-        texID = SOIL_load_OGL_texture("../resources/tex16.png", 3, texID, SOIL_FLAG_POWER_OF_TWO | SOIL_FLAG_MIPMAPS | SOIL_FLAG_TEXTURE_REPEATS);
+        STVRVideoFrameSource* frameSource = NULL;
+        if (inputType == SHADERTOYVR_IMAGE_SEQUENCE_VIDEO)
+        {
+            frameSource = new STVRImageSequenceSource();
+        }
+        else if (inputType == SHADERTOYVR_RAW_VIDEO)
+        {
+            frameSource = new STVRRawVideoSource();
+        }
+        else
+        {
+            std::cerr << "ShaderToyVR ERROR: unknown stream type [ " << inputType << " ] " << std::endl;
+            return false;
+        }
+
+        STVRVideoStream* videoStream = new STVRVideoStream(streamName,
+            frameSource,
+            stvrFragShader->GetStreamRingDepth(),
+            stvrFragShader->GetInputFrameRate(inputChannel));
+        channelStream = STVRChannelStreamPtr(videoStream);
     }
 
-    else if (textureType == SHADERTOYVR_R_NOISE_256x256_TEX)
+    if (!channelStream->Open(sourcePath))
     {
-        texID = SOIL_load_OGL_texture("../resources/tex12.png", 3, texID, SOIL_FLAG_POWER_OF_TWO | SOIL_FLAG_MIPMAPS | SOIL_FLAG_TEXTURE_REPEATS);
+        std::cerr << "ShaderToyVR ERROR: failed to open stream [ " << sourcePath << " ] for channel [ " << inputChannel << " ] " << std::endl;
+        channelStream.reset();
+        return false;
     }
 
-    else if (textureType == SHADERTOYVR_RGB_NOISE_64x64_TEX)
+    return true;
+}
+
+void
+ShaderToyVRLoadChannelStream(const STVRFragmentShader* stvrFragShader, ShaderToyVRInputChannel inputChannel)
+{
+    if (!ShaderToyVRGenChannelStream(stvrFragShader, inputChannel, g_ChannelStreams[inputChannel]))
     {
-        texID = SOIL_load_OGL_texture("../resources/tex11.png", 3, texID, SOIL_FLAG_POWER_OF_TWO | SOIL_FLAG_MIPMAPS | SOIL_FLAG_TEXTURE_REPEATS);
+        return;
     }
 
-    else if (textureType == SHADERTOYVR_R_NOISE_64x64_TEX)
+    // streams allocate their own texture, so swap it in for the placeholder
+    g_ChannelTextures[inputChannel] = g_ChannelStreams[inputChannel]->GetTexture();
+
+    const GLfloat* streamResolution = g_ChannelStreams[inputChannel]->GetResolution();
+    g_ChannelResolutions[inputChannel][0] = streamResolution[0];
+    g_ChannelResolutions[inputChannel][1] = streamResolution[1];
+
+    // iSampleRate is a single uniform, so the first audio channel sets it
+    if (g_SampleRate == 0.f)
     {
-        texID = SOIL_load_OGL_texture("../resources/tex10.png", 3, texID, SOIL_FLAG_POWER_OF_TWO | SOIL_FLAG_MIPMAPS | SOIL_FLAG_TEXTURE_REPEATS);
+        g_SampleRate = g_ChannelStreams[inputChannel]->GetSampleRate();
     }
+}
 
-    else if(textureType == SHADERTOYVR_R_NOISE_8x8_TEX)
+// Drop every channel's stream and texture, ready to load another toy's.
+void
+ShaderToyVRResetChannels()
+{
+    for (uint inputChannel = uint(SHADERTOYVR_CHANNEL_0); inputChannel < SHADERTOYVR_NUMCHANNELS; inputChannel++)
     {
-        texID = SOIL_load_OGL_texture("../resources/tex15.png", 3, texID, SOIL_FLAG_POWER_OF_TWO | SOIL_FLAG_MIPMAPS | SOIL_FLAG_TEXTURE_REPEATS);
+        g_ChannelStreams[inputChannel].reset();
+        g_ChannelTextures[inputChannel] = HBGLTextureResourcePtr(new HBGLTextureResource());
+        g_ChannelResolutions[inputChannel][0] = 0.f;
+        g_ChannelResolutions[inputChannel][1] = 0.f;
+        g_ChannelResolutions[inputChannel][2] = 0.f;
     }
+    g_SampleRate = 0.f;
+}
+
+void
+ShaderToyVRLoadResources()
+{
+    // FRAGILE: consider re-implementing GetFragmentShader as a virtual function that
+    // returns an already cast STVRFragmentShaderPtr.
+    HBGLShaderPtr fragShaderPtr = g_ScreenQuadShaderProgram->GetFragmentShader();
+    const STVRFragmentShader* stvrFragShader = static_cast<STVRFragmentShader*>(&*fragShaderPtr);
 
-    else if (textureType == SHADERTOYVR_STONE_TILES_TEX)
+    for (uint inputChannel = uint(SHADERTOYVR_CHANNEL_0); inputChannel < SHADERTOYVR_NUMCHANNELS; inputChannel++)
     {
-        texID = SOIL_load_OGL_texture("../resources/tex00.jpg", 3, texID, SOIL_FLAG_POWER_OF_TWO | SOIL_FLAG_MIPMAPS | SOIL_FLAG_TEXTURE_REPEATS);
+        ShaderToyVRChannelType inputType = stvrFragShader->GetInputType(static_cast<ShaderToyVRInputChannel>(inputChannel));
+
+        // buffer channels are bound per eye from g_BufferPasses when the
+        // image pass draws
+        if (inputType != SHADERTOYVR_UNKNOWN_TYPE && stvrFragShader->IsStreamInput(inputType))
+        {
+            ShaderToyVRLoadChannelStream(stvrFragShader, static_cast<ShaderToyVRInputChannel>(inputChannel));
+        }
     }
 
-    else if (textureType == SHADERTOYVR_OLD_BIRCH_TEX)
+    STVRAssetRegistry::Get().AcquireChannelTextures(stvrFragShader, g_ChannelTextures, g_ChannelResolutions);
+    g_BufferPasses->AcquireChannelTextures();
+}
+
+// Drop every channel's stream and texture for residentToy's, which are
+// already uploaded, and open its streams.
+void
+ShaderToyVRTakeResidentChannels(const STVRResidentToy& residentToy)
+{
+    for (uint inputChannel = uint(SHADERTOYVR_CHANNEL_0); inputChannel < SHADERTOYVR_NUMCHANNELS; inputChannel++)
     {
-        texID = SOIL_load_OGL_texture("../resources/tex01.jpg", 3, texID, SOIL_FLAG_POWER_OF_TWO | SOIL_FLAG_MIPMAPS | SOIL_FLAG_TEXTURE_REPEATS);
+        g_ChannelStreams[inputChannel].reset();
+        g_ChannelTextures[inputChannel] = residentToy.channelTextures[inputChannel];
+        memcpy(g_ChannelResolutions[inputChannel], residentToy.channelResolutions[inputChannel], sizeof(g_ChannelResolutions[inputChannel]));
     }
+    g_SampleRate = 0.f;
 
-    else if (textureType == SHADERTOYVR_RUSTED_METAL_TEX)
+    // Streams are opened again rather than kept resident; a decoder thread
+    // and its ring for every toy in the playlist costs more than the open.
+    HBGLShaderPtr fragShaderPtr = residentToy.program->GetFragmentShader();
+    const STVRFragmentShader* stvrFragShader = static_cast<STVRFragmentShader*>(&*fragShaderPtr);
+    for (uint inputChannel = uint(SHADERTOYVR_CHANNEL_0); inputChannel < SHADERTOYVR_NUMCHANNELS; inputChannel++)
     {
-        texID = SOIL_load_OGL_texture("../resources/tex02.jpg", 3, texID, SOIL_FLAG_POWER_OF_TWO | SOIL_FLAG_MIPMAPS | SOIL_FLAG_TEXTURE_REPEATS);
+        ShaderToyVRChannelType inputType = stvrFragShader->GetInputType(static_cast<ShaderToyVRInputChannel>(inputChannel));
+        if (inputType != SHADERTOYVR_UNKNOWN_TYPE && stvrFragShader->IsStreamInput(inputType))
+        {
+            ShaderToyVRLoadChannelStream(stvrFragShader, static_cast<ShaderToyVRInputChannel>(inputChannel));
+        }
     }
+}
+
+// ========================================================================
+// SHADER RELOAD
+// ========================================================================
+
+void
+ShaderToyVRReloadShader()
+{
+    // picked up by ShaderToyVRUpdateShaderReload as soon as the reloader is free
+    g_ShaderReloadPending = true;
+}
 
-    else if (textureType == SHADERTOYVR_DEEPSKY_PATTERN_TEX)
+void
+ShaderToyVRGetToyFiles(std::vector<std::string>& toyFiles)
+{
+    // the toy, its buffer passes, and every library any of them includes
+    toyFiles.push_back(g_ShaderToyFilePath);
+
+    const std::vector<std::string>& sourceStringNames = g_ScreenQuadShaderProgram->GetFragmentShader()->GetSourceStringNames();
+    if (sourceStringNames.size() > 1)
     {
-        texID = SOIL_load_OGL_texture("../resources/tex03.jpg", 3, texID, SOIL_FLAG_POWER_OF_TWO | SOIL_FLAG_MIPMAPS | SOIL_FLAG_TEXTURE_REPEATS);
+        toyFiles.insert(toyFiles.end(), sourceStringNames.begin() + 1, sourceStringNames.end());
     }
 
-    else if (textureType == SHADERTOYVR_LONDON_STREET_TEX)
+    g_BufferPasses->GetSourceFiles(toyFiles);
+
+    std::sort(toyFiles.begin(), toyFiles.end());
+    toyFiles.erase(std::unique(toyFiles.begin(), toyFiles.end()), toyFiles.end());
+}
+
+void
+ShaderToyVRWatchToyFiles()
+{
+    if (!c_WatchToyFiles)
     {
-        texID = SOIL_load_OGL_texture("../resources/tex04.jpg", 3, texID, SOIL_FLAG_POWER_OF_TWO | SOIL_FLAG_MIPMAPS | SOIL_FLAG_TEXTURE_REPEATS);
+        return;
     }
 
-    else if (textureType == SHADERTOYVR_FINISHED_WOOD_TEX)
+    HBGLShaderPtr fragShaderPtr = g_ScreenQuadShaderProgram->GetFragmentShader();
+    const STVRFragmentShader* stvrFragShader = static_cast<STVRFragmentShader*>(&*fragShaderPtr);
+
+    std::vector<std::string> watchedFiles;
+    ShaderToyVRGetToyFiles(watchedFiles);
+
+    for (uint inputChannel = uint(SHADERTOYVR_CHANNEL_0); inputChannel < SHADERTOYVR_NUMCHANNELS; inputChannel++)
     {
-        texID = SOIL_load_OGL_texture("../resources/tex05.jpg", 3, texID, SOIL_FLAG_POWER_OF_TWO | SOIL_FLAG_MIPMAPS | SOIL_FLAG_TEXTURE_REPEATS);
+        const std::string& sourcePath = stvrFragShader->GetInputSource(static_cast<ShaderToyVRInputChannel>(inputChannel));
+        if (!sourcePath.empty())
+        {
+            watchedFiles.push_back(sourcePath);
+        }
     }
 
-    else if (textureType == SHADERTOYVR_BARK_AND_LICHEN_TEX)
+    g_FileWatcher.SetWatchedFiles(watchedFiles);
+}
+
+void
+ShaderToyVRHandleFileChanges()
+{
+    // a single atomic load on frames where nothing was saved
+    if (!g_FileWatcher.HasChanges())
     {
-        texID = SOIL_load_OGL_texture("../resources/tex06.jpg", 3, texID, SOIL_FLAG_POWER_OF_TWO | SOIL_FLAG_MIPMAPS | SOIL_FLAG_TEXTURE_REPEATS);
+        return;
     }
 
-    else if (textureType == SHADERTOYVR_COLORED_ROCKS_TEX)
+    STVRAllocTagScope reloadScope(STVR_ALLOC_RELOAD);
+    std::vector<std::string> changedFiles;
+    if (!g_FileWatcher.TakeChanges(changedFiles))
     {
-        texID = SOIL_load_OGL_texture("../resources/tex07.jpg", 3, texID, SOIL_FLAG_POWER_OF_TWO | SOIL_FLAG_MIPMAPS | SOIL_FLAG_TEXTURE_REPEATS);
+        return;
     }
 
-    else if (textureType == SHADERTOYVR_CLOTH_WEAVE_TEX)
+    HBGLShaderPtr fragShaderPtr = g_ScreenQuadShaderProgram->GetFragmentShader();
+    const STVRFragmentShader* stvrFragShader = static_cast<STVRFragmentShader*>(&*fragShaderPtr);
+
+    for (size_t fileIdx = 0; fileIdx < changedFiles.size(); fileIdx++)
     {
-        texID = SOIL_load_OGL_texture("../resources/tex08.jpg", 3, texID, SOIL_FLAG_POWER_OF_TWO | SOIL_FLAG_MIPMAPS | SOIL_FLAG_TEXTURE_REPEATS);
+        const std::string& changedFile = changedFiles[fileIdx];
+
+        // buffer passes and includes are rebuilt along with the toy that
+        // uses them
+        std::vector<std::string> toyFiles;
+        ShaderToyVRGetToyFiles(toyFiles);
+        if (std::find(toyFiles.begin(), toyFiles.end(), changedFile) != toyFiles.end())
+        {
+            ShaderToyVRReloadShader();
+            continue;
+        }
+
+        // a changed source only restarts the channels that read it
+        for (uint inputChannel = uint(SHADERTOYVR_CHANNEL_0); inputChannel < SHADERTOYVR_NUMCHANNELS; inputChannel++)
+        {
+            ShaderToyVRInputChannel channel = static_cast<ShaderToyVRInputChannel>(inputChannel);
+            if (g_ChannelStreams[inputChannel] && stvrFragShader->GetInputSource(channel) == changedFile)
+            {
+                std::cout << "ShaderToyVR: reloading [ " << changedFile << " ] for channel [ " << inputChannel << " ] " << std::endl;
+                g_ChannelStreams[inputChannel].reset();
+                g_ChannelTextures[inputChannel] = HBGLTextureResourcePtr(new HBGLTextureResource());
+                ShaderToyVRLoadChannelStream(stvrFragShader, channel);
+            }
+        }
     }
+}
 
-    else if (textureType == SHADERTOYVR_ANIMAL_PRINT_TEX)
+bool
+ShaderToyVRChannelInputsMatch(const STVRFragmentShader* lhs, const STVRFragmentShader* rhs)
+{
+    for (uint inputChannel = uint(SHADERTOYVR_CHANNEL_0); inputChannel < SHADERTOYVR_NUMCHANNELS; inputChannel++)
     {
-        texID = SOIL_load_OGL_texture("../resources/tex09.jpg", 3, texID, SOIL_FLAG_POWER_OF_TWO | SOIL_FLAG_MIPMAPS | SOIL_FLAG_TEXTURE_REPEATS);
+        ShaderToyVRInputChannel channel = static_cast<ShaderToyVRInputChannel>(inputChannel);
+        if (lhs->GetInputType(channel) != rhs->GetInputType(channel) ||
+            lhs->GetInputSource(channel) != rhs->GetInputSource(channel) ||
+            lhs->GetInputAsset(channel) != rhs->GetInputAsset(channel) ||
+            lhs->GetInputFrameRate(channel) != rhs->GetInputFrameRate(channel))
+        {
+            return false;
+        }
     }
 
-    else if (textureType == SHADERTOYVR_NYAN_CAT_TEX)
+    return lhs->GetStreamRingDepth() == rhs->GetStreamRingDepth();
+}
+
+void
+ShaderToyVRUpdateShaderReload()
+{
+    if (g_ShaderReloadPending)
     {
-        texID = SOIL_load_OGL_texture("../resources/tex14.png", 3, texID, SOIL_FLAG_POWER_OF_TWO | SOIL_FLAG_MIPMAPS | SOIL_FLAG_TEXTURE_REPEATS);
+        STVRAllocTagScope reloadScope(STVR_ALLOC_RELOAD);
+        if (g_ShaderReloader.RequestReload(g_ShaderToyFilePath))
+        {
+            std::cout << "ShaderToyVR: rebuilding [ " << g_ShaderToyFilePath << " ] in the background" << std::endl;
+            g_ShaderReloadPending = false;
+        }
     }
 
-    else {
-        std::cerr << "ShaderToyVR ERROR: unknown image texture type [ " << textureType << " ] " << std::endl;
-        texID = 0;
+    // Called between frames.  Only a program that linked and survived its
+    // warm up draw ever gets here, built buffer passes and channel textures
+    // and all, so the swap itself is just pointers.
+    STVRResidentToyPtr reloadedToy;
+    if (!g_ShaderReloader.TakeFinishedReload(reloadedToy) || !reloadedToy->program)
+    {
+        return;
+    }
+
+    STVRAllocTagScope reloadScope(STVR_ALLOC_RELOAD);
+    HBGLShaderPtr oldFragShaderPtr = g_ScreenQuadShaderProgram->GetFragmentShader();
+    HBGLShaderPtr newFragShaderPtr = reloadedToy->program->GetFragmentShader();
+    bool inputsMatch = ShaderToyVRChannelInputsMatch(static_cast<STVRFragmentShader*>(&*oldFragShaderPtr),
+        static_cast<STVRFragmentShader*>(&*newFragShaderPtr));
+
+    g_ScreenQuadShaderProgram = reloadedToy->program;
+
+    // variants of the old toy are useless now, start over from the new one
+    g_ActiveToyProgram = g_ScreenQuadShaderProgram;
+    g_ActiveVariantKey = 0;
+    g_WantedVariantKey = 0;
+    g_FailedVariantKey = 0;
+    g_ShaderVariants.Reset(g_ScreenQuadShaderProgram);
+    g_FramePacer.SetRenderKey(0);
+    g_FramePacer.ResetTimings();
+
+    // The new toy and its passes got their textures on the reloader while
+    // the old ones were still alive, so an asset both of them read is shared
+    // rather than freed and uploaded again.
+    g_BufferPasses = reloadedToy->bufferPasses;
+
+    // Editing the toy body keeps the channels, streams and all, as they are.
+    // Changing the header takes the new toy's textures, but its video and
+    // audio channels are still opened here at swap time, as they are when
+    // switching toys.
+    if (!inputsMatch)
+    {
+        ShaderToyVRTakeResidentChannels(*reloadedToy);
     }
 
-    if (texID == 0)
+    ShaderToyVRWatchToyFiles();
+}
+
+// ========================================================================
+// SHADER VARIANTS
+// ========================================================================
+
+bool
+ShaderToyVRGatherShaderConstants(STVRShaderConstants& constants)
+{
+    // both eyes draw with the same program, so a baked resolution has to
+    // suit both of them
+    if (g_OVRTextureSize[0][0] != g_OVRTextureSize[1][0] ||
+        g_OVRTextureSize[0][1] != g_OVRTextureSize[1][1])
     {
+        return false;
+    }
 
-        std::cerr << "ShaderToyVR ERROR: failed to read in image texture type [ " << textureType << " ] " << std::endl;
-        std::cerr << "Possible texture read error: " << SOIL_last_result() << std::endl;
+    // nor can it follow a viewport that shrinks while the head turns
+    if (g_MotionResolution.GetScale() < 1.f)
+    {
         return false;
     }
 
-    std::cout << SOIL_last_result() << std::endl;
+    constants.resolution[0] = (GLfloat) g_OVRTextureSize[0][0];
+    constants.resolution[1] = (GLfloat) g_OVRTextureSize[0][1];
+    memcpy(constants.channelResolutions, g_ChannelResolutions, sizeof(constants.channelResolutions));
+    constants.focalLength = g_FocalLengthScalar;
+    constants.sampleRate = g_SampleRate;
 
-    HB_CHECK_GL_ERROR();
     return true;
 }
 
-bool
-ShaderToyVRGenCubeMapTexture(ShaderToyVRChannelType textureType, HBGLTextureResourcePtr& textureResource)
+unsigned long long
+ShaderToyVRGetRenderKey()
 {
-    textureResource->Generate();
-    GLuint texID = textureResource->GetIndex();
+    return g_ActiveVariantKey | ((unsigned long long) g_MotionResolution.GetScaleBucket() << c_RenderKeyScaleShift);
+}
+
+void
+ShaderToyVRActivateToyProgram(unsigned long long variantKey, const HBGLShaderProgramPtr& program)
+{
+    g_ActiveVariantKey = variantKey;
+    g_ActiveToyProgram = program;
+    g_FramePacer.SetRenderKey(ShaderToyVRGetRenderKey());
+}
 
-    // TODO: Make better file finding logic
-    if (textureType == SHADERTOYVR_UFFIZI_GALLERY_512_CUBEMAP)
+void
+ShaderToyVRUpdateShaderVariant()
+{
+    // GPU times come back a few frames late, tagged with the program that
+    // was drawing at the time and the scale it drew at.  Variants are only
+    // compared at full size.
+    unsigned long long timedKey = 0;
+    double timedMillisecs = 0.;
+    while (g_ToyGpuTimer && g_ToyGpuTimer->TakeResult(timedKey, timedMillisecs))
     {
-        texID = SOIL_load_OGL_cubemap(
-            "../resources/cube00_0.jpg",
-            "../resources/cube00_1.jpg",
-            "../resources/cube00_2.jpg",
-            "../resources/cube00_3.jpg",
-            "../resources/cube00_4.jpg",
-            "../resources/cube00_5.jpg",
-            3, texID, SOIL_FLAG_POWER_OF_TWO | SOIL_FLAG_MIPMAPS | SOIL_FLAG_TEXTURE_REPEATS);
+        if ((timedKey >> c_RenderKeyScaleShift) == 0) {
+            g_ShaderVariants.RecordGpuTime(timedKey, timedMillisecs);
+        }
+        g_FramePacer.RecordGpuTime(timedKey, timedMillisecs);
+        g_ToyGpuMillisecs = (float) timedMillisecs;
     }
 
-    else if (textureType == SHADERTOYVR_UFFIZI_GALLERY_64_CUBEMAP)
+    HBGLShaderProgramPtr variantProgram;
+    unsigned long long variantKey = 0;
+    if (g_ShaderReloader.TakeFinishedVariant(variantKey, variantProgram))
     {
-        texID = SOIL_load_OGL_cubemap(
-            "../resources/cube01_0.png",
-            "../resources/cube01_1.png", 
-            "../resources/cube01_2.png",
-            "../resources/cube01_3.png",
-            "../resources/cube01_4.png",
-            "../resources/cube01_5.png",
-            3, texID, SOIL_FLAG_POWER_OF_TWO | SOIL_FLAG_MIPMAPS | SOIL_FLAG_TEXTURE_REPEATS);
+        STVRAllocTagScope reloadScope(STVR_ALLOC_RELOAD);
+        if (variantProgram)
+        {
+            g_ShaderVariants.Insert(variantKey, g_BuildingVariantConstants, variantProgram);
+        }
+        else
+        {
+            // don't keep rebuilding a variant that does not compile
+            g_FailedVariantKey = variantKey;
+        }
     }
 
-    else if (textureType == SHADERTOYVR_ST_PETERS_256_CUBEMAP)
+    if (!c_SpecializeToyUniforms)
     {
-        texID = SOIL_load_OGL_cubemap(
-            "../resources/cube02_0.jpg",
-            "../resources/cube02_1.jpg", 
-            "../resources/cube02_2.jpg",
-            "../resources/cube02_3.jpg",
-            "../resources/cube02_4.jpg",
-            "../resources/cube02_5.jpg",
-            3, texID, SOIL_FLAG_POWER_OF_TWO | SOIL_FLAG_MIPMAPS | SOIL_FLAG_TEXTURE_REPEATS);
+        return;
     }
 
-    else if (textureType == SHADERTOYVR_ST_PETERS_64_CUBEMAP)
+    STVRShaderConstants constants;
+    unsigned long long wantedKey = 0;
+    if (ShaderToyVRGatherShaderConstants(constants))
     {
-        texID = SOIL_load_OGL_cubemap(
-            "../resources/cube03_0.png",
-            "../resources/cube03_1.png", 
-            "../resources/cube03_2.png",
-            "../resources/cube03_3.png",
-            "../resources/cube03_4.png",
-            "../resources/cube03_5.png",
-            3, texID, SOIL_FLAG_POWER_OF_TWO | SOIL_FLAG_MIPMAPS | SOIL_FLAG_TEXTURE_REPEATS);
+        wantedKey = g_ShaderVariants.GetVariantKey(constants);
     }
 
-    else if (textureType == SHADERTOYVR_GROVE_512_CUBEMAP)
+    if (wantedKey == g_ActiveVariantKey)
     {
-        texID = SOIL_load_OGL_cubemap(
-            "../resources/cube04_0.png",
-            "../resources/cube04_1.png", 
-            "../resources/cube04_2.png",
-            "../resources/cube04_3.png",
-            "../resources/cube04_4.png",
-            "../resources/cube04_5.png",
-            3, texID, SOIL_FLAG_POWER_OF_TWO | SOIL_FLAG_MIPMAPS | SOIL_FLAG_TEXTURE_REPEATS);
+        return;
     }
 
-    else if (textureType == SHADERTOYVR_GROVE_64_CUBEMAP)
+    // A variant drawing with stale constants would be wrong, not just slow,
+    // so fall back to the base program until the right variant exists.
+    HBGLShaderProgramPtr cachedProgram = wantedKey ? g_ShaderVariants.Find(wantedKey) : HBGLShaderProgramPtr();
+    if (cachedProgram || wantedKey == 0)
     {
-        texID = SOIL_load_OGL_cubemap(
-            "../resources/cube05_0.png",
-            "../resources/cube05_1.png",
-            "../resources/cube05_2.png",
-            "../resources/cube05_3.png",
-            "../resources/cube05_4.png",
-            "../resources/cube05_5.png",
-            3, texID, SOIL_FLAG_POWER_OF_TWO | SOIL_FLAG_MIPMAPS | SOIL_FLAG_TEXTURE_REPEATS);
+        ShaderToyVRActivateToyProgram(wantedKey, cachedProgram ? cachedProgram : g_ScreenQuadShaderProgram);
+        return;
     }
 
-
-    else {
-        std::cerr << "ShaderToyVR ERROR: unknown cubemap texture type [ " << textureType << " ] " << std::endl;
-        texID = 0;
+    if (g_ActiveVariantKey != 0)
+    {
+        ShaderToyVRActivateToyProgram(0, g_ScreenQuadShaderProgram);
     }
 
-    if (texID == 0)
+    // wait for the constants to settle (the focal length keys repeat) before
+    // spending a compile on them
+    double nowInSecs = ovr_GetTimeInSeconds();
+    if (wantedKey != g_WantedVariantKey)
     {
-        std::cerr << "ShaderToyVR ERROR: failed to read in cubemap texture type [ " << textureType << " ] " << std::endl;
-        std::cerr << "Possible texture read error: " << SOIL_last_result() << std::endl;
-        return false;
+        g_WantedVariantKey = wantedKey;
+        g_WantedVariantSinceInSecs = nowInSecs;
+        return;
     }
 
-    std::cout << SOIL_last_result() << std::endl;
-
-    HB_CHECK_GL_ERROR();
+    if (nowInSecs - g_WantedVariantSinceInSecs < c_VariantSettleInSecs ||
+        wantedKey == g_FailedVariantKey ||
+        g_ShaderReloadPending ||
+        g_ShaderReloader.IsReloading() ||
+        g_ShaderReloader.IsBuildingVariant())
+    {
+        return;
+    }
 
-    return true;
+    STVRAllocTagScope reloadScope(STVR_ALLOC_RELOAD);
+    if (g_ShaderReloader.RequestVariant(g_ShaderVariants.MakeVariantShader(constants), wantedKey))
+    {
+        g_BuildingVariantConstants = constants;
+    }
 }
 
-void
-ShaderToyVRLoadResources()
+// ========================================================================
+// PLAYLIST
+// ========================================================================
+
+size_t
+ShaderToyVREstimateToyGpuBytes(const STVRResidentToy& residentToy)
 {
-    // TODO: Allow for reloading resources when the shader is reloaded on the fly
+    // Only what grows with the toy: channel textures and pass targets.  An
+    // asset shared with other resident toys is counted for each of them,
+    // which errs on the side of evicting early.
+    size_t gpuBytes = 0;
 
-    // FRAGILE: consider re-implementing GetFragmentShader as a virtual function that
-    // returns an already cast STVRFragmentShaderPtr.
-    HBGLShaderPtr fragShaderPtr = g_ScreenQuadShaderProgram->GetFragmentShader();
+    HBGLShaderPtr fragShaderPtr = residentToy.program->GetFragmentShader();
     const STVRFragmentShader* stvrFragShader = static_cast<STVRFragmentShader*>(&*fragShaderPtr);
-
     for (uint inputChannel = uint(SHADERTOYVR_CHANNEL_0); inputChannel < SHADERTOYVR_NUMCHANNELS; inputChannel++)
     {
-        ShaderToyVRChannelType inputType = stvrFragShader->GetInputType(static_cast<ShaderToyVRInputChannel>(inputChannel));
+        gpuBytes += STVRAssetRegistry::Get().GetTextureBytes(stvrFragShader->GetInputAsset(static_cast<ShaderToyVRInputChannel>(inputChannel)));
+    }
 
-        if (inputType == SHADERTOYVR_UNKNOWN_TYPE)
+    size_t livePasses = 0;
+    for (uint bufferPass = uint(SHADERTOYVR_BUFFER_PASS_A); bufferPass < SHADERTOYVR_NUMBUFFERPASSES; bufferPass++)
+    {
+        const STVRFragmentShader* passShader = residentToy.bufferPasses->GetPassShader(static_cast<ShaderToyVRBufferPass>(bufferPass));
+        if (!passShader)
         {
             continue;
         }
 
-        else if (inputType == SHADERTOYVR_RGB_NOISE_256x256_TEX ||
-            inputType == SHADERTOYVR_R_NOISE_256x256_TEX ||
-            inputType == SHADERTOYVR_RGB_NOISE_64x64_TEX ||
-            inputType == SHADERTOYVR_R_NOISE_64x64_TEX ||
-            inputType == SHADERTOYVR_R_NOISE_8x8_TEX ||
-            inputType == SHADERTOYVR_STONE_TILES_TEX ||
-            inputType == SHADERTOYVR_OLD_BIRCH_TEX ||
-            inputType == SHADERTOYVR_RUSTED_METAL_TEX ||
-            inputType == SHADERTOYVR_DEEPSKY_PATTERN_TEX ||
-            inputType == SHADERTOYVR_LONDON_STREET_TEX ||
-            inputType == SHADERTOYVR_FINISHED_WOOD_TEX ||
-            inputType == SHADERTOYVR_BARK_AND_LICHEN_TEX ||
-            inputType == SHADERTOYVR_COLORED_ROCKS_TEX ||
-            inputType == SHADERTOYVR_CLOTH_WEAVE_TEX ||
-            inputType == SHADERTOYVR_ANIMAL_PRINT_TEX ||
-            inputType == SHADERTOYVR_NYAN_CAT_TEX)
+        livePasses++;
+        for (uint inputChannel = uint(SHADERTOYVR_CHANNEL_0); inputChannel < SHADERTOYVR_NUMCHANNELS; inputChannel++)
         {
-            ShaderToyVRGenImageTexture(inputType, g_ChannelTextures[inputChannel]);
+            gpuBytes += STVRAssetRegistry::Get().GetTextureBytes(passShader->GetInputAsset(static_cast<ShaderToyVRInputChannel>(inputChannel)));
         }
+    }
+
+    // pass targets are only allocated when the toy first draws, until then
+    // assume two full size RGBA32F targets per eye
+    size_t targetBytes = residentToy.bufferPasses->GetGpuBytes();
+    if (targetBytes == 0)
+    {
+        size_t eyeBytes = size_t(g_OVRTextureSize[0][0]) * size_t(g_OVRTextureSize[0][1]) * 4 * sizeof(GLfloat);
+        targetBytes = livePasses * 2 * 2 * eyeBytes;
+    }
 
-        else if (inputType == SHADERTOYVR_UFFIZI_GALLERY_512_CUBEMAP ||
-            inputType == SHADERTOYVR_UFFIZI_GALLERY_64_CUBEMAP ||
-            inputType == SHADERTOYVR_ST_PETERS_256_CUBEMAP ||
-            inputType == SHADERTOYVR_ST_PETERS_64_CUBEMAP ||
-            inputType == SHADERTOYVR_GROVE_512_CUBEMAP ||
-            inputType == SHADERTOYVR_GROVE_64_CUBEMAP)
+    return gpuBytes + targetBytes;
+}
+
+bool
+ShaderToyVRIsResidentToyCurrent(const STVRResidentToy& residentToy)
+{
+    long long modifiedTime = 0;
+    long long fileSize = 0;
+    return GetFileStamp(residentToy.toyPath.c_str(), modifiedTime, fileSize) &&
+        modifiedTime == residentToy.modifiedTime &&
+        fileSize == residentToy.fileSize;
+}
+
+bool
+ShaderToyVRIsFailedToy(const std::string& toyPath)
+{
+    for (std::vector<STVRResidentToyPtr>::iterator failedIter = g_FailedToys.begin(); failedIter != g_FailedToys.end(); ++failedIter)
+    {
+        if ((*failedIter)->toyPath != toyPath)
         {
-            ShaderToyVRGenCubeMapTexture(inputType, g_ChannelTextures[inputChannel]);
+            continue;
         }
 
-        if (g_ChannelTextures[inputChannel])
+        // saved since it failed, so it gets another go
+        if (!ShaderToyVRIsResidentToyCurrent(**failedIter))
         {
-            GLint width = 0, height = 0;
-            glGetTexLevelParameteriv(GL_TEXTURE_2D, 0, GL_TEXTURE_WIDTH, &width);
-            glGetTexLevelParameteriv(GL_TEXTURE_2D, 0, GL_TEXTURE_HEIGHT, &height);
-            HB_CHECK_GL_ERROR();
-            g_ChannelResolutions[inputChannel][0] = (float)width;
-            g_ChannelResolutions[inputChannel][1] = (float)height;
+            g_FailedToys.erase(failedIter);
+            return false;
         }
+
+        return true;
     }
-}
 
-// ========================================================================
-// OVR MANAGEMENT
-// ========================================================================
+    return false;
+}
 
 void
-ShaderToyVRInitOVR()
+ShaderToyVRStashCurrentToy()
 {
-    ovr_Initialize();
+    // the specialized variants are not kept, they are rebuilt once the toy
+    // has been back for a moment
+    STVRResidentToyPtr residentToy(new STVRResidentToy());
+    residentToy->toyPath = g_ShaderToyFilePath;
+    residentToy->program = g_ScreenQuadShaderProgram;
+    residentToy->bufferPasses = g_BufferPasses;
+    residentToy->modifiedTime = 0;
+    residentToy->fileSize = 0;
+    GetFileStamp(g_ShaderToyFilePath.c_str(), residentToy->modifiedTime, residentToy->fileSize);
 
-    g_HMD = ovrHmd_Create(0);
-    if (g_HMD != nullptr)
-    {
-        g_OVRPositionalCamTanHalfFov[0] = tan(g_HMD->CameraFrustumHFovInRadians * .5f);
-        g_OVRPositionalCamTanHalfFov[1] = tan(g_HMD->CameraFrustumVFovInRadians * .5f);
-    }
-    else
+    HBGLShaderPtr fragShaderPtr = g_ScreenQuadShaderProgram->GetFragmentShader();
+    const STVRFragmentShader* stvrFragShader = static_cast<STVRFragmentShader*>(&*fragShaderPtr);
+
+    for (uint inputChannel = uint(SHADERTOYVR_CHANNEL_0); inputChannel < SHADERTOYVR_NUMCHANNELS; inputChannel++)
     {
-        g_HMD = ovrHmd_CreateDebug(ovrHmd_DK2);
-        std::cerr << "ShaderToyVR ERROR: Could not find an HMD device.  Creating debug version." << std::endl;
+        // streams are closed, their textures go with them
+        ShaderToyVRChannelType inputType = stvrFragShader->GetInputType(static_cast<ShaderToyVRInputChannel>(inputChannel));
+        bool streamed = (inputType != SHADERTOYVR_UNKNOWN_TYPE && stvrFragShader->IsStreamInput(inputType));
 
-        g_OVRPositionalCamTanHalfFov[0] = tan(1.9 * .5f);
-        g_OVRPositionalCamTanHalfFov[1] = tan(1.9 * .5f);
+        residentToy->channelTextures[inputChannel] = streamed ? HBGLTextureResourcePtr(new HBGLTextureResource()) : g_ChannelTextures[inputChannel];
+        for (int component = 0; component < 3; component++)
+        {
+            residentToy->channelResolutions[inputChannel][component] = streamed ? 0.f : g_ChannelResolutions[inputChannel][component];
+        }
     }
 
-    ovrHmd_SetEnabledCaps(g_HMD, 
-        ovrHmdCap_LowPersistence | 
-        ovrHmdCap_DynamicPrediction);
+    residentToy->gpuBytes = ShaderToyVREstimateToyGpuBytes(*residentToy);
+    g_Playlist.InsertResident(residentToy);
+}
 
-    ovrHmd_ConfigureTracking(g_HMD, 
-        ovrTrackingCap_Orientation | 
-        ovrTrackingCap_MagYawCorrection | 
-        ovrTrackingCap_Position, 
-        0);
+void
+ShaderToyVRSwitchToResidentToy(size_t toyIdx, const STVRResidentToyPtr& residentToy)
+{
+    std::cout << "ShaderToyVR: switching to [ " << residentToy->toyPath << " ] " << std::endl;
+
+    ShaderToyVRStashCurrentToy();
+
+    // The toy that draws is held here, not by the playlist, so reloads can
+    // replace its program and passes without leaving a stale copy behind.
+    g_Playlist.RemoveResident(residentToy->toyPath);
+    g_Playlist.SetCurrentIndex(toyIdx);
+
+    g_ShaderToyFilePath = residentToy->toyPath;
+    g_ScreenQuadShaderProgram = residentToy->program;
+    g_ActiveToyProgram = g_ScreenQuadShaderProgram;
+    g_ActiveVariantKey = 0;
+    g_WantedVariantKey = 0;
+    g_FailedVariantKey = 0;
+    g_ShaderVariants.Reset(g_ScreenQuadShaderProgram);
+    g_FramePacer.SetRenderKey(0);
+    g_FramePacer.ResetTimings();
+    g_ShaderReloadPending = false;
+
+    g_BufferPasses = residentToy->bufferPasses;
+    ShaderToyVRTakeResidentChannels(*residentToy);
+
+    ShaderToyVRWatchToyFiles();
+    ShaderToyVRResetWorldTimer();
 
-    g_OVRStereoView = true;
+    g_Playlist.EvictToBudget(g_Playlist.GetToyPath(g_Playlist.GetStepIndex(1)));
 }
 
 void
-ShaderToyVRCloseOVR()
+ShaderToyVRStepPlaylist(int step)
 {
-    ovrHmd_Destroy(g_HMD);
-    ovr_Shutdown();
+    if (g_Playlist.GetToyCount() == 0)
+    {
+        return;
+    }
+
+    // picked up by ShaderToyVRUpdatePlaylist once the toy is resident
+    g_PendingToyIndex = g_Playlist.GetStepIndex(step);
+    g_PendingToyStep = (step < 0) ? -1 : 1;
+    g_ToySwitchPending = true;
 }
 
 void
-ShaderToyVRGenOVRTextures(const ovrEyeType& eye)
+ShaderToyVRUpdatePlaylist()
 {
+    if (g_Playlist.GetToyCount() == 0)
+    {
+        return;
+    }
 
-    ovrTextureHeader& eyeTextureHeader = g_EyeTextures[eye].OGL.Header;
-    eyeTextureHeader.TextureSize = ovrHmd_GetFovTextureSize(g_HMD, eye, g_HMD->DefaultEyeFov[eye], g_ScreenPercentage);
-    eyeTextureHeader.RenderViewport.Size = eyeTextureHeader.TextureSize;
-    eyeTextureHeader.RenderViewport.Pos.x = 0;
-    eyeTextureHeader.RenderViewport.Pos.y = 0;
-    eyeTextureHeader.API = ovrRenderAPI_OpenGL;
-
-    glBindTexture(GL_TEXTURE_2D, g_OVRColorTexture[eye]->GetIndex());
+    // The reloader built the whole toy, passes and textures included, so
+    // all that is left here is bookkeeping.
+    STVRResidentToyPtr prefetchedToy;
+    if (g_ShaderReloader.TakeFinishedPrefetch(prefetchedToy))
+    {
+        STVRAllocTagScope reloadScope(STVR_ALLOC_RELOAD);
+        if (prefetchedToy->program)
+        {
+            prefetchedToy->gpuBytes = ShaderToyVREstimateToyGpuBytes(*prefetchedToy);
+            g_Playlist.InsertResident(prefetchedToy);
+            g_Playlist.EvictToBudget(prefetchedToy->toyPath);
+        }
+        else
+        {
+            std::cerr << "ShaderToyVR ERROR: skipping [ " << prefetchedToy->toyPath << " ] in the playlist until it is saved again, it did not build" << std::endl;
+            g_FailedToys.push_back(prefetchedToy);
+        }
+    }
+
+    // kiosk mode
+    if (!g_ToySwitchPending &&
+        g_Playlist.GetSecondsPerToy() > 0.f &&
+        g_PlaybackTimeInSecs >= g_Playlist.GetSecondsPerToy())
+    {
+        ShaderToyVRStepPlaylist(1);
+    }
+
+    // step over toys that do not build, in whichever direction was asked for
+    size_t toyCount = g_Playlist.GetToyCount();
+    for (size_t skippedCount = 0; g_ToySwitchPending && skippedCount < toyCount; skippedCount++)
+    {
+        if (!ShaderToyVRIsFailedToy(g_Playlist.GetToyPath(g_PendingToyIndex)))
+        {
+            break;
+        }
+
+        g_PendingToyIndex = (g_PendingToyIndex + toyCount + g_PendingToyStep) % toyCount;
+    }
+
+    if (g_ToySwitchPending && g_PendingToyIndex == g_Playlist.GetCurrentIndex())
+    {
+        g_ToySwitchPending = false;
+    }
+
+    size_t nextIdx = g_ToySwitchPending ? g_PendingToyIndex : g_Playlist.GetStepIndex(1);
+    const std::string& nextPath = g_Playlist.GetToyPath(nextIdx);
+    if (nextPath == g_ShaderToyFilePath || ShaderToyVRIsFailedToy(nextPath))
+    {
+        return;
+    }
+
+    // a toy edited since it was built is built again
+    STVRResidentToyPtr nextToy = g_Playlist.FindResident(nextPath);
+    if (nextToy && !ShaderToyVRIsResidentToyCurrent(*nextToy))
+    {
+        g_Playlist.RemoveResident(nextPath);
+        nextToy.reset();
+    }
+
+    // a reload in flight belongs to the toy that is drawing now
+    if (g_ToySwitchPending && nextToy && !g_ShaderReloader.IsReloading())
+    {
+        STVRAllocTagScope reloadScope(STVR_ALLOC_RELOAD);
+        g_ToySwitchPending = false;
+        ShaderToyVRSwitchToResidentToy(nextIdx, nextToy);
+        return;
+    }
+
+    if (!nextToy && !g_ShaderReloader.IsPrefetching())
+    {
+        STVRAllocTagScope reloadScope(STVR_ALLOC_RELOAD);
+        if (g_ShaderReloader.RequestPrefetch(nextPath))
+        {
+            std::cout << "ShaderToyVR: prefetching [ " << nextPath << " ] in the background" << std::endl;
+        }
+    }
+}
+
+// ========================================================================
+// OVR MANAGEMENT
+// ========================================================================
+
+void
+ShaderToyVRInitOVR()
+{
+    // Initializing the system ourselves installs our allocator, so LibOVR's
+    // heap use is counted with the app's
+    OVR::System::Init(OVR::Log::ConfigureDefaultLog(OVR::LogMask_All), &g_TrackingAllocator);
+    ovr_Initialize();
+
+    g_HMD = ovrHmd_Create(0);
+    if (g_HMD != nullptr)
+    {
+        g_OVRPositionalCamTanHalfFov[0] = tan(g_HMD->CameraFrustumHFovInRadians * .5f);
+        g_OVRPositionalCamTanHalfFov[1] = tan(g_HMD->CameraFrustumVFovInRadians * .5f);
+    }
+    else
+    {
+        g_HMD = ovrHmd_CreateDebug(ovrHmd_DK2);
+        std::cerr << "ShaderToyVR ERROR: Could not find an HMD device.  Creating debug version." << std::endl;
+
+        g_OVRPositionalCamTanHalfFov[0] = tan(c_DebugCameraFovInRadians * .5f);
+        g_OVRPositionalCamTanHalfFov[1] = tan(c_DebugCameraFovInRadians * .5f);
+    }
+
+    if (HBGLUtils::MakeDirectory(c_DistortionMeshCacheDir)) {
+        ovrHmd_SetString(g_HMD, OVR_KEY_DISTORTION_MESH_CACHE_DIR, c_DistortionMeshCacheDir);
+    }
+
+    // the telemetry reads it every frame, so skip looking up its name each time
+    g_DK2LatencyKey = ovrHmd_GetPropertyKey("DK2Latency");
+
+    ovrHmd_SetEnabledCaps(g_HMD, 
+        ovrHmdCap_LowPersistence | 
+        ovrHmdCap_DynamicPrediction);
+
+    ovrHmd_ConfigureTracking(g_HMD, 
+        ovrTrackingCap_Orientation | 
+        ovrTrackingCap_MagYawCorrection | 
+        ovrTrackingCap_Position, 
+        0);
+
+    g_OVRStereoView = true;
+}
+
+void
+ShaderToyVRCloseOVR()
+{
+    ovrHmd_Destroy(g_HMD);
+    ovr_Shutdown();
+
+    // ovr_Shutdown leaves a system it didn't initialize alone
+    OVR::System::Destroy();
+}
+
+// The framebuffer an eye draws into, a color texture and a depth and
+// stencil renderbuffer, without storage until ShaderToyVRSizeEyeTarget.
+void
+ShaderToyVRGenEyeTarget(const ovrEyeType& eye)
+{
+    HBGLFrameBufferResource* fbr = new HBGLFrameBufferResource();
+    g_OVRFrameBuffer[eye] = HBGLFrameBufferResourcePtr(fbr);
+    g_OVRFrameBuffer[eye]->Generate();
+
+    HBGLTextureResource* tr = new HBGLTextureResource();
+    g_OVRColorTexture[eye] = HBGLTextureResourcePtr(tr);
+    g_OVRColorTexture[eye]->Generate();
+
+    HBGLRenderBufferResource* rbr = new HBGLRenderBufferResource();
+    g_OVRDepthTexture[eye] = HBGLRenderBufferResourcePtr(rbr);
+    g_OVRDepthTexture[eye]->Generate();
+
+    glBindTexture(GL_TEXTURE_2D, g_OVRColorTexture[eye]->GetIndex());
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+
+    HB_CHECK_GL_ERROR();
+
+    glBindTexture(GL_TEXTURE_2D, 0);
+
+    glBindFramebuffer(GL_FRAMEBUFFER, g_OVRFrameBuffer[eye]->GetIndex());
+
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, g_OVRColorTexture[eye]->GetIndex(), 0);
+
+    // the stencil holds the lens mask, so the renderbuffer has to be
+    // attached to the eye framebuffer rather than the default one
+    glBindRenderbuffer(GL_RENDERBUFFER, g_OVRDepthTexture[eye]->GetIndex());
+
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_RENDERBUFFER, g_OVRDepthTexture[eye]->GetIndex());
+
+    glBindRenderbuffer(GL_RENDERBUFFER, 0);
+
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+}
+
+// Size eye's target, still frame history and viewport width x height.
+void
+ShaderToyVRSizeEyeTarget(const ovrEyeType& eye, GLsizei width, GLsizei height)
+{
+    glBindTexture(GL_TEXTURE_2D, g_OVRColorTexture[eye]->GetIndex());
 
     glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB,
-        eyeTextureHeader.TextureSize.w,
-        eyeTextureHeader.TextureSize.h, 0,
+        width,
+        height, 0,
         GL_RGB,
         GL_UNSIGNED_BYTE,
         NULL);
@@ -694,18 +1342,41 @@ ShaderToyVRGenOVRTextures(const ovrEyeType& eye)
 
     glBindTexture(GL_TEXTURE_2D, 0);
 
-    g_OVRTextureSize[eye][0] = eyeTextureHeader.TextureSize.w;
-    g_OVRTextureSize[eye][1] = eyeTextureHeader.TextureSize.h;
+    g_OVRTextureSize[eye][0] = width;
+    g_OVRTextureSize[eye][1] = height;
+    g_OVRViewportSize[eye][0] = width;
+    g_OVRViewportSize[eye][1] = height;
+    g_StillFrames.Resize(eye, width, height);
 
     glBindRenderbuffer(GL_RENDERBUFFER, g_OVRDepthTexture[eye]->GetIndex());
 
-    glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24,
-        eyeTextureHeader.TextureSize.w,
-        eyeTextureHeader.TextureSize.h);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH24_STENCIL8,
+        width,
+        height);
 
     glBindRenderbuffer(GL_RENDERBUFFER, 0);
 }
 
+void
+ShaderToyVRGenOVRTextures(const ovrEyeType& eye)
+{
+
+    ovrTextureHeader& eyeTextureHeader = g_EyeTextures[eye].OGL.Header;
+    eyeTextureHeader.TextureSize = ovrHmd_GetFovTextureSize(g_HMD, eye, g_HMD->DefaultEyeFov[eye], g_ScreenPercentage);
+    eyeTextureHeader.RenderViewport.Size = eyeTextureHeader.TextureSize;
+    eyeTextureHeader.RenderViewport.Pos.x = 0;
+    eyeTextureHeader.RenderViewport.Pos.y = 0;
+    eyeTextureHeader.API = ovrRenderAPI_OpenGL;
+
+    ShaderToyVRSizeEyeTarget(eye, eyeTextureHeader.TextureSize.w, eyeTextureHeader.TextureSize.h);
+
+    // what the lenses can see moves with the texture size
+    g_OVRLensMask[eye].Build(g_HMD, eye, g_HMD->DefaultEyeFov[eye],
+        eyeTextureHeader.TextureSize.w,
+        eyeTextureHeader.TextureSize.h,
+        c_OVRDistortionCaps);
+}
+
 void
 ShaderToyVRInitOVRGLSystem()
 {
@@ -735,39 +1406,7 @@ ShaderToyVRInitOVRGLSystem()
 
         eyeFovPorts[eye] = g_HMD->DefaultEyeFov[eye];
 
-        HBGLFrameBufferResource* fbr = new HBGLFrameBufferResource();
-        g_OVRFrameBuffer[eye] = HBGLFrameBufferResourcePtr(fbr);
-        g_OVRFrameBuffer[eye]->Generate();
-
-        HBGLTextureResource* tr = new HBGLTextureResource();
-        g_OVRColorTexture[eye] = HBGLTextureResourcePtr(tr);
-        g_OVRColorTexture[eye]->Generate();
-
-        HBGLRenderBufferResource* rbr = new HBGLRenderBufferResource();
-        g_OVRDepthTexture[eye] = HBGLRenderBufferResourcePtr(rbr);
-        g_OVRDepthTexture[eye]->Generate();
-
-        glBindTexture(GL_TEXTURE_2D, g_OVRColorTexture[eye]->GetIndex());
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-
-        HB_CHECK_GL_ERROR();
-
-        glBindTexture(GL_TEXTURE_2D, 0);
-
-        glBindFramebuffer(GL_FRAMEBUFFER, g_OVRFrameBuffer[eye]->GetIndex());
-
-        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, g_OVRColorTexture[eye]->GetIndex(), 0);
-
-        glBindFramebuffer(GL_FRAMEBUFFER, 0);
-
-        glBindRenderbuffer(GL_RENDERBUFFER, g_OVRDepthTexture[eye]->GetIndex());
-
-        glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, g_OVRDepthTexture[eye]->GetIndex());
-
-        glBindRenderbuffer(GL_RENDERBUFFER, 0);
+        ShaderToyVRGenEyeTarget(eye);
 
         g_EyeTextures[eye].OGL.TexId = g_OVRFrameBuffer[eye]->GetIndex();
 
@@ -782,14 +1421,10 @@ ShaderToyVRInitOVRGLSystem()
     cfg.OGL.Window = glfwGetWin32Window(g_GLFWWindow);
     cfg.OGL.DC = wglGetCurrentDC();
 
-    int distortionCaps = ovrDistortionCap_TimeWarp |
-        ovrDistortionCap_Chromatic |
-        ovrDistortionCap_Vignette;
-
     ovrEyeRenderDesc eyeRenderDescs[2];
     int configResult = ovrHmd_ConfigureRendering(g_HMD, 
         &cfg.Config, 
-        distortionCaps, 
+        c_OVRDistortionCaps, 
         eyeFovPorts, 
         eyeRenderDescs);
 
@@ -812,6 +1447,36 @@ ShaderToyVRResetOVRPosition()
     }
 }
 
+// The modelview of eye with the head at eyePoseOVR
+glm::mat4
+ShaderToyVREyeModelview(const ovrEyeType& eye, const ovrPosef& eyePoseOVR)
+{
+    glm::mat4 eyePose = FromOvrPoseToMat(eyePoseOVR);
+    glm::mat4 modelview_mat;
+    if (g_OVRStereoView) {
+        modelview_mat = glm::translate(modelview_mat, g_OVRCamOffset[eye]);
+    }
+    return modelview_mat * glm::inverse(eyePose);
+}
+
+// The iCameraTransform of an eye drawn with modelview_mat
+glm::mat4
+ShaderToyVRCameraTransformFromModelview(const glm::mat4& modelview_mat)
+{
+    glm::mat4 camXform = glm::inverse(modelview_mat);
+
+    float fovScale = g_OVRPositionalCamTanHalfFov[1];
+    camXform[0] = glm::normalize(camXform[0]);
+    camXform[1] = glm::normalize(camXform[1]);
+    camXform[2] = fovScale * glm::normalize(camXform[2]);
+
+    // Have the z-axis be negative down the look direction.
+    // This is consistent with how positional data is tracked.
+    // Closer to camera is more negative.  We'll need to conform
+    // to this convention in the shadertoy shaders.
+    return glm::scale(camXform, glm::vec3(1.f, 1.f, -1.f));
+}
+
 // ========================================================================
 // DRAW CALLS
 // ========================================================================
@@ -871,21 +1536,17 @@ void
 ShaderToyVRDrawScreenQuad(const ovrEyeType& eye)
 {
     glBindBuffer(GL_ARRAY_BUFFER, g_ScreenQuadVertexVBOID->GetIndex());
-    
-    if (c_DebugMode && c_DebugModeRelink) {
-        g_ScreenQuadShaderProgram->ReloadLinkedShaders();
-    }
 
-    g_ScreenQuadShaderProgram->EnableVertexAttrib("position", 2, GL_FLOAT, GL_FALSE, 4 * sizeof(GLfloat), 0);
-    g_ScreenQuadShaderProgram->EnableVertexAttrib("texcoord", 2, GL_FLOAT, GL_FALSE, 4 * sizeof(GLfloat), (void*)(2 * sizeof(GLfloat)));
+    g_ActiveToyProgram->EnableVertexAttrib("position", 2, GL_FLOAT, GL_FALSE, 4 * sizeof(GLfloat), 0);
+    g_ActiveToyProgram->EnableVertexAttrib("texcoord", 2, GL_FLOAT, GL_FALSE, 4 * sizeof(GLfloat), (void*)(2 * sizeof(GLfloat)));
 
-    if (g_ScreenQuadShaderProgram) {
-        g_ScreenQuadShaderProgram->ShadersBegin();
+    if (g_ActiveToyProgram) {
+        g_ActiveToyProgram->ShadersBegin();
     }
 
     // FRAGILE: consider re-implementing GetFragmentShader as a virtual function that
     // returns an already cast STVRFragmentShaderPtr.
-    HBGLShaderPtr fragShaderPtr = g_ScreenQuadShaderProgram->GetFragmentShader();
+    HBGLShaderPtr fragShaderPtr = g_ActiveToyProgram->GetFragmentShader();
     const STVRFragmentShader* stvrFragShader = static_cast<STVRFragmentShader*>(&*fragShaderPtr);
 
     // TODO: Lots of stuff happens per eye that can be shared.  Clean up later
@@ -899,54 +1560,85 @@ ShaderToyVRDrawScreenQuad(const ovrEyeType& eye)
         inputChannel < SHADERTOYVR_NUMCHANNELS; 
         inputChannel++)
     {
+        ShaderToyVRChannelType inputType = stvrFragShader->GetInputType(static_cast<ShaderToyVRInputChannel>(inputChannel));
         GLuint texID = g_ChannelTextures[inputChannel]->GetIndex();
+
+        // buffer outputs flip every frame and differ per eye
+        if (stvrFragShader->IsBufferInput(inputType))
+        {
+            ShaderToyVRBufferPass bufferPass = stvrFragShader->GetInputBufferPass(inputType);
+            texID = g_BufferPasses->GetOutputTexture(eye, bufferPass);
+            g_BufferPasses->GetOutputSize(eye, bufferPass, g_ChannelResolutions[inputChannel]);
+        }
+
         if (texID > 0)
         {
-            ShaderToyVRChannelType inputType = stvrFragShader->GetInputType(static_cast<ShaderToyVRInputChannel>(inputChannel));
             glActiveTexture(c_ChannelTextures[inputChannel]);
             glBindTexture(stvrFragShader->Is2DTexInput(inputType) ? GL_TEXTURE_2D : GL_TEXTURE_CUBE_MAP, texID);
 
             char channelBuffer[10];
             sprintf(channelBuffer, "iChannel%i", inputChannel);
 
-            g_ScreenQuadShaderProgram->SetUniform1i(channelBuffer, inputChannel);
+            g_ActiveToyProgram->SetUniform1i(channelBuffer, inputChannel);
         }
 
     }
 
-    g_ScreenQuadShaderProgram->SetUniform1f("iGlobalTime", g_PlaybackTimeInSecs);
+    g_ActiveToyProgram->SetUniform1f("iGlobalTime", g_PlaybackTimeInSecs);
+
+    g_ActiveToyProgram->SetUniform2f("iResolution", 
+                                                (GLfloat) g_OVRViewportSize[eye][0],
+                                                (GLfloat) g_OVRViewportSize[eye][1]);
 
-    g_ScreenQuadShaderProgram->SetUniform2f("iResolution", 
-                                                (GLfloat) g_OVRTextureSize[eye][0],
-                                                (GLfloat) g_OVRTextureSize[eye][1]);
+    // where in its pixel each fragment shades, see STVRStillFrames
+    GLfloat pixelJitter[2];
+    g_StillFrames.GetPixelJitter(pixelJitter);
+    g_ActiveToyProgram->SetUniform2f("iPixelJitter", pixelJitter[0], pixelJitter[1]);
 
-    g_ScreenQuadShaderProgram->SetUniform3fv("iChannelResolution", 4, &g_ChannelResolutions[0][0]);
-    g_ScreenQuadShaderProgram->SetUniform4f("iDate", g_Date.x, g_Date.y, g_Date.z, g_Date.w);
+    g_ActiveToyProgram->SetUniform3fv("iChannelResolution", 4, &g_ChannelResolutions[0][0]);
+    g_ActiveToyProgram->SetUniform4f("iDate", g_Date.x, g_Date.y, g_Date.z, g_Date.w);
 
-    // ChannelTime is not yet supported
-    g_ScreenQuadShaderProgram->SetUniform1fv("iChannelTime", 4, &g_ChannelTimes[0]);
+    // each stream's own clock, the playback time for every other channel
+    g_ActiveToyProgram->SetUniform1fv("iChannelTime", 4, &g_ChannelTimes[0]);
+
+    // A specialized variant has the inputs below baked in as constants, so
+    // setting them quietly does nothing.
 
     // Mouse is disabled
     // TODO: instead of mouse, allow the user to use a joystick or WASD controls.
-    g_ScreenQuadShaderProgram->SetUniform4f("iMouse", 0.f, 0.f, 0.f, 0.f);
+    g_ActiveToyProgram->SetUniform2f("iMouse", 0.f, 0.f);
 
-    // Sample rate is not supported
-    g_ScreenQuadShaderProgram->SetUniform1f("iSampleRate", 0.f);
+    // Sample rate of the first audio channel, 0 if the toy has none
+    g_ActiveToyProgram->SetUniform1f("iSampleRate", g_SampleRate);
     
-    g_ScreenQuadShaderProgram->SetUniformMatrix4fv("iCameraTransform", 1, GL_FALSE, glm::value_ptr(g_OVRCameraTransform[eye]));
+    g_ActiveToyProgram->SetUniformMatrix4fv("iCameraTransform", 1, GL_FALSE, glm::value_ptr(g_OVRCameraTransform[eye]));
 
-    g_ScreenQuadShaderProgram->SetUniform1f("iFocalLength", g_FocalLengthScalar);
+    g_ActiveToyProgram->SetUniform1f("iFocalLength", g_FocalLengthScalar);
 
     glDisable(GL_DEPTH_TEST);
     glPolygonMode(GL_FRONT, GL_FILL);
+
+    // pixels the lenses never show are 1 in the stencil
+    if (g_OVRLensMaskEnabled) {
+        glEnable(GL_STENCIL_TEST);
+        glStencilFunc(GL_EQUAL, 0, 1);
+        glStencilOp(GL_KEEP, GL_KEEP, GL_KEEP);
+    }
+
+    bool timingToy = g_ToyGpuTimer->Begin(ShaderToyVRGetRenderKey());
     glDrawArrays(GL_TRIANGLES, 0, 6);
+    if (timingToy) {
+        g_ToyGpuTimer->End();
+    }
+
+    glDisable(GL_STENCIL_TEST);
 
-    if (g_ScreenQuadShaderProgram) {
-        g_ScreenQuadShaderProgram->ShadersEnd();
+    if (g_ActiveToyProgram) {
+        g_ActiveToyProgram->ShadersEnd();
     }
 
-    g_ScreenQuadShaderProgram->DisableVertexAttrib("position");
-    g_ScreenQuadShaderProgram->DisableVertexAttrib("texcoord");
+    g_ActiveToyProgram->DisableVertexAttrib("position");
+    g_ActiveToyProgram->DisableVertexAttrib("texcoord");
 
     glBindBuffer(GL_ARRAY_BUFFER, 0);
     glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
@@ -961,10 +1653,6 @@ ShaderToyVRDrawSphereGrid(const glm::mat4& mvp_mat)
     glBindBuffer(GL_ARRAY_BUFFER, g_SphereGridVertexVBOID->GetIndex());
     glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, g_SphereGridIndexIBOID->GetIndex());
 
-    if (c_DebugMode && c_DebugModeRelink && g_SphereGridShaderProgram) {
-        g_SphereGridShaderProgram->ReloadLinkedShaders();
-    }
-
     // TODO: convert to glVertexAttribPointer
     // For some reason, converting to 150 core is not working
 
@@ -1016,14 +1704,47 @@ ShaderToyVRDrawSphereGrid(const glm::mat4& mvp_mat)
 // ========================================================================
 
 void
-ShaderToyVRRenderScene(const ovrEyeType& eye)
+ShaderToyVRRunBufferPasses(const ovrEyeType& eye)
+{
+    if (!g_BufferPasses->HasPasses())
+    {
+        return;
+    }
+
+    STVRPassInputs passInputs;
+    passInputs.globalTime = g_PlaybackTimeInSecs;
+    passInputs.date[0] = g_Date.x;
+    passInputs.date[1] = g_Date.y;
+    passInputs.date[2] = g_Date.z;
+    passInputs.date[3] = g_Date.w;
+    passInputs.sampleRate = g_SampleRate;
+    memcpy(passInputs.cameraTransform, glm::value_ptr(g_OVRCameraTransform[eye]), sizeof(passInputs.cameraTransform));
+    passInputs.focalLength = g_FocalLengthScalar;
+
+    // Sized by the whole eye texture, not this frame's viewport: resizing
+    // the targets as the head moves would reallocate them and lose what
+    // feedback passes have drawn.
+    g_BufferPasses->Execute(eye, g_OVRTextureSize[eye][0], g_OVRTextureSize[eye][1], passInputs);
+
+    // the passes leave their own targets behind, so go back to the eye
+    glBindFramebuffer(GL_FRAMEBUFFER, g_OVRFrameBuffer[eye]->GetIndex());
+    glViewport(0, 0, g_OVRViewportSize[eye][0], g_OVRViewportSize[eye][1]);
+    glEnable(GL_DEPTH_TEST);
+    glEnable(GL_BLEND);
+}
+
+// -------------------------------------------------------------------------
+
+void
+ShaderToyVRRenderScene(const ovrEyeType& eye, const ovrPosef& eyePoseOVR)
 {
 
-    glViewport(0, 0, g_OVRTextureSize[eye][0], g_OVRTextureSize[eye][1]);
+    glViewport(0, 0, g_OVRViewportSize[eye][0], g_OVRViewportSize[eye][1]);
 
     glClearColor(0.0f, 0.0f, 0.0f, 0.0f);
     glClearDepth(1.0f);
-    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+    glClearStencil(0);
+    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT | GL_STENCIL_BUFFER_BIT);
 
     glEnable(GL_DEPTH_TEST);
     glDepthFunc(GL_LESS);
@@ -1048,34 +1769,36 @@ ShaderToyVRRenderScene(const ovrEyeType& eye)
     glMatrixMode(GL_MODELVIEW);
 
     glLoadIdentity();
-    glm::mat4 eyePose = FromOvrPoseToMat(ovrHmd_GetHmdPosePerEye(g_HMD, eye));
-    glm::mat4 modelview_mat;
-    if (g_OVRStereoView) {
-        modelview_mat = glm::translate(modelview_mat, g_OVRCamOffset[eye]);
-    }
-    modelview_mat = modelview_mat * glm::inverse(eyePose);
+    glm::mat4 modelview_mat = ShaderToyVREyeModelview(eye, eyePoseOVR);
 
     glMultMatrixf(glm::value_ptr(modelview_mat));
 
-    glm::mat4 camXform = glm::inverse(modelview_mat);
-
-    float fovScale = g_OVRPositionalCamTanHalfFov[1];
-    camXform[0] = glm::normalize(camXform[0]);
-    camXform[1] = glm::normalize(camXform[1]);
-    camXform[2] = fovScale * glm::normalize(camXform[2]);
-
-    // Have the z-axis be negative down the look direction.
-    // This is consistent with how positional data is tracked.
-    // Closer to camera is more negative.  We'll need to conform
-    // to this convention in the shadertoy shaders.
-    camXform = glm::scale(camXform, glm::vec3(1.f, 1.f, -1.f));
-    g_OVRCameraTransform[eye] = camXform;
+    g_OVRCameraTransform[eye] = ShaderToyVRCameraTransformFromModelview(modelview_mat);
 
     glm::mat4 modelviewproj_mat = proj_mat * modelview_mat;
 
     glPushMatrix();
 
-    ShaderToyVRDrawScreenQuad(eye);
+    // a converged history is what the toy would draw, only better
+    if (!g_StillFrames.IsConverged())
+    {
+        ShaderToyVRRunBufferPasses(eye);
+
+        if (g_OVRLensMaskEnabled) {
+            g_OVRLensMask[eye].DrawHiddenIntoStencil();
+        }
+
+        ShaderToyVRDrawScreenQuad(eye);
+
+        if (g_StillFrames.IsAccumulating()) {
+            g_StillFrames.AddSample(eye, g_OVRColorTexture[eye]->GetIndex(), g_OVRViewportSize[eye][0], g_OVRViewportSize[eye][1]);
+        }
+    }
+
+    // the grid, camera and overlay go on top, they aren't averaged
+    if (g_StillFrames.IsAccumulating() || g_StillFrames.IsConverged()) {
+        g_StillFrames.CopyToEye(eye, g_OVRFrameBuffer[eye]->GetIndex(), g_OVRViewportSize[eye][0], g_OVRViewportSize[eye][1]);
+    }
 
     if (g_DisplaySphereGrid) {
         ShaderToyVRDrawSphereGrid(modelviewproj_mat);
@@ -1088,87 +1811,290 @@ ShaderToyVRRenderScene(const ovrEyeType& eye)
     glPopMatrix();
 
     g_OverlayStats->UpdateData("FPS", g_FramesPerSecond);
+    g_OverlayStats->UpdateData("Toy GPU (ms)", g_ToyGpuMillisecs);
+    g_OverlayStats->UpdateData("Lens Mask Saved (%)", g_OVRLensMaskEnabled ? g_OVRLensMask[eye].GetHiddenFraction() * 100.f : 0.f);
+    g_OverlayStats->UpdateData("Toy Specialized", g_ActiveVariantKey ? 1.f : 0.f);
     g_OverlayStats->UpdateData("Play Time (seconds)", (float)g_PlaybackTimeInSecs);
+    g_OverlayStats->UpdateData("Heap Allocs", (float)STVRTrackingAllocator::GetLastFrame().frameThreadCounts.allocCount);
+    g_OverlayStats->UpdateData("Late Start (ms)", (float)g_FramePacer.GetLastWaitMillisecs());
+    g_OverlayStats->UpdateData("Head Speed (deg/s)", g_MotionResolution.GetDegreesPerSec());
+    g_OverlayStats->UpdateData("Motion Scale (%)", g_MotionResolution.GetScale() * 100.f);
+    g_OverlayStats->UpdateData("Still Samples", (float)g_StillFrames.GetSampleCount());
 
     if (g_DisplayOverlay) {
-        g_OverlayStats->DrawOverlay(g_OVRTextureSize[eye][0], g_OVRTextureSize[eye][1]);
+        g_OverlayStats->DrawOverlay(g_OVRViewportSize[eye][0], g_OVRViewportSize[eye][1], g_FrameArena);
     }
 }
 
 // -------------------------------------------------------------------------
 
 void
-ShaderToyVRDraw(void)
+ShaderToyVRRecordTelemetry(const ovrTrackingState& ts, const ovrFrameTiming& frameTiming, double frameStartInSecs, double cpuMillisecs)
 {
-
-
-    // TODO: HMD sensor information sent to overlay display
-    ovrTrackingState ts = ovrHmd_GetTrackingState(g_HMD, ovr_GetTimeInSeconds());
-    if (ts.StatusFlags & (ovrStatus_OrientationTracked))
+    if (g_TelemetryToyPath != g_ShaderToyFilePath)
     {
-        ovrPosef pose = ts.HeadPose.ThePose;
-        float eyeYaw = 0.f;
-        float eyePitch = 0.f;
-        float eyeRoll = 0.f;
+        g_TelemetryToyPath = g_ShaderToyFilePath;
+        std::string toyName = g_TelemetryToyPath.substr(g_TelemetryToyPath.find_last_of("/\\") + 1);
+        g_Telemetry.RecordToy(toyName.substr(0, toyName.find_last_of('.')));
+    }
 
-        Quatf quatOrientation(pose.Orientation.x, pose.Orientation.y, pose.Orientation.z, pose.Orientation.w);
-        quatOrientation.GetEulerAngles<Axis_Y, Axis_X, Axis_Z>(&eyeYaw, &eyePitch, &eyeRoll);
+    STVRFrameTelemetry frame;
+    memset(&frame, 0, sizeof(frame));
+    frame.frameStartInSecs = frameStartInSecs;
+    frame.frameIndex = g_TelemetryFrameIndex++;
 
-        if (ts.StatusFlags & (ovrStatus_PositionTracked)) 
-        {
-            g_OverlayStats->UpdateData("Eye X", pose.Position.x);
-            g_OverlayStats->UpdateData("Eye Y", pose.Position.y);
-            g_OverlayStats->UpdateData("Eye Z", pose.Position.z);
-        }
-        else 
-        {
-            g_OverlayStats->UpdateData("Eye X", 0.f);
-            g_OverlayStats->UpdateData("Eye Y", 0.f);
-            g_OverlayStats->UpdateData("Eye Z", 0.f);
+    // DeltaSeconds is clamped, so measure from the last frame ourselves
+    if (g_TelemetryFrameStartInSecs > 0.0)
+    {
+        double frameSecs = frameStartInSecs - g_TelemetryFrameStartInSecs;
+        double refreshSecs = frameTiming.NextFrameSeconds - frameTiming.ThisFrameSeconds;
+        frame.frameMillisecs = float(frameSecs * 1000.0);
+        if (refreshSecs > 0.0 && frameSecs > 1.5 * refreshSecs) {
+            frame.flags |= STVR_FRAME_DROPPED;
         }
-
-        g_OverlayStats->UpdateData("Eye Yaw", eyeYaw);
-        g_OverlayStats->UpdateData("Eye Pitch", eyePitch);
-        g_OverlayStats->UpdateData("Eye Roll", eyeRoll);
     }
+    g_TelemetryFrameStartInSecs = frameStartInSecs;
 
-    ovrHmd_BeginFrame(g_HMD, g_FrameNumber);
+    frame.cpuMillisecs = float(cpuMillisecs);
+    frame.toyGpuMillisecs = g_ToyGpuMillisecs;
+    frame.lateStartMillisecs = float(g_FramePacer.GetLastWaitMillisecs());
+    frame.predictedRenderMillisecs = float(g_FramePacer.GetPredictedRenderMillisecs());
 
-    static ovrPosef eyePoses[2];
-    for (int i = 0; i < 2; i++)
+    // LibOVR's own latency tester, only a DK2 has one
+    float latencies[3] = { 0.f, 0.f, 0.f };
+    if (ovrHmd_GetFloatArrayByKey(g_HMD, g_DK2LatencyKey, latencies, 3) == 3)
     {
-        ovrEyeType eye = g_HMD->EyeRenderOrder[i];
-        eyePoses[eye] = ovrHmd_GetHmdPosePerEye(g_HMD, eye);
-
-        glBindFramebuffer(GL_FRAMEBUFFER, g_OVRFrameBuffer[eye]->GetIndex());
-
-        ShaderToyVRRenderScene(eye);
-    }
-
-    ovrTexture textures[2] = { g_EyeTextures[0].Texture, g_EyeTextures[1].Texture };
-    ovrHmd_EndFrame(g_HMD, eyePoses, textures);
+        frame.latencyRenderMillisecs = latencies[0] * 1000.f;
+        frame.latencyTimewarpMillisecs = latencies[1] * 1000.f;
+        frame.latencyPostPresentMillisecs = latencies[2] * 1000.f;
+    }
+
+    frame.screenPercentage = g_ScreenPercentage;
+    frame.renderScale = g_MotionResolution.GetScale();
+    frame.playTimeInSecs = g_PlaybackTimeInSecs;
+
+    if (ts.StatusFlags & ovrStatus_HmdConnected) { frame.flags |= STVR_FRAME_HMD_CONNECTED; }
+    if (ts.StatusFlags & ovrStatus_OrientationTracked) { frame.flags |= STVR_FRAME_ORIENTATION_TRACKED; }
+    if (ts.StatusFlags & ovrStatus_PositionTracked) { frame.flags |= STVR_FRAME_POSITION_TRACKED; }
+    if (ts.StatusFlags & ovrStatus_PositionConnected) { frame.flags |= STVR_FRAME_CAMERA_CONNECTED; }
+    if (g_ActiveVariantKey) { frame.flags |= STVR_FRAME_TOY_SPECIALIZED; }
+    if (g_OVRLensMaskEnabled) { frame.flags |= STVR_FRAME_LENS_MASK; }
+    if (g_StillFrames.IsConverged()) { frame.flags |= STVR_FRAME_STILL_CONVERGED; }
+
+    const ovrPoseStatef& headPose = ts.HeadPose;
+    frame.headOrientation[0] = headPose.ThePose.Orientation.x;
+    frame.headOrientation[1] = headPose.ThePose.Orientation.y;
+    frame.headOrientation[2] = headPose.ThePose.Orientation.z;
+    frame.headOrientation[3] = headPose.ThePose.Orientation.w;
+    frame.headPosition[0] = headPose.ThePose.Position.x;
+    frame.headPosition[1] = headPose.ThePose.Position.y;
+    frame.headPosition[2] = headPose.ThePose.Position.z;
+    frame.headAngularSpeed = Vector3f(headPose.AngularVelocity).Length();
+
+    // everything but polling events, which is tagged as a reload anyway
+    STVRAllocCounts heapCounts = STVRTrackingAllocator::GetFrameThreadCounts();
+    frame.heapAllocCount = (unsigned int)heapCounts.allocCount;
+    frame.heapAllocBytes = (unsigned int)heapCounts.allocBytes;
+    frame.stillSampleCount = g_StillFrames.GetSampleCount();
+
+    g_Telemetry.RecordFrame(frame);
 }
 
-// ========================================================================
-// KEYSTROKE CALLBACKS
-// ========================================================================
+// -------------------------------------------------------------------------
 
+// Shrinks what each eye renders of its texture while the head turns fast.
+// LibOVR reads RenderViewport at EndFrame, so the textures stay as they are.
 void
-ShaderToyVRUpdateOVRScreenPercentage(float delta)
+ShaderToyVRUpdateEyeViewports(const ovrTrackingState& ts, double nowInSecs)
 {
+    g_MotionResolution.Update(ts.HeadPose.AngularVelocity, nowInSecs);
 
-    g_ScreenPercentage = std::clamp(g_ScreenPercentage + delta, .2f, 2.0f);
-    std::cout << "Screen Percentage: " << g_ScreenPercentage << std::endl;
+    // a specialized toy has the full size baked in as iResolution
+    if (g_MotionResolution.GetScale() < 1.f && g_ActiveVariantKey != 0)
+    {
+        ShaderToyVRActivateToyProgram(0, g_ScreenQuadShaderProgram);
+    }
+    g_FramePacer.SetRenderKey(ShaderToyVRGetRenderKey());
 
     for (ovrEyeType eye = ovrEyeType::ovrEye_Left;
         eye < ovrEyeType::ovrEye_Count;
         eye = static_cast<ovrEyeType>(eye + 1))
     {
-        ShaderToyVRGenOVRTextures(eye);
+        ovrTextureHeader& eyeTextureHeader = g_EyeTextures[eye].OGL.Header;
+        eyeTextureHeader.RenderViewport = g_MotionResolution.GetRenderViewport(eyeTextureHeader.TextureSize);
+        g_OVRViewportSize[eye][0] = eyeTextureHeader.RenderViewport.Size.w;
+        g_OVRViewportSize[eye][1] = eyeTextureHeader.RenderViewport.Size.h;
     }
 }
 
-void
+// -------------------------------------------------------------------------
+
+// What the toy draws besides the head pose, for STVRStillFrames.  Which
+// inputs a toy reads is asked of the GL compiler: a uniform the toy never
+// reads has no location.  Returns false for a toy that changes by itself.
+bool
+ShaderToyVRGatherStillScene(STVRStillScene& scene)
+{
+    // feedback passes change every frame, streams bring new frames
+    if (g_BufferPasses->HasPasses()) {
+        return false;
+    }
+    for (uint inputChannel = uint(SHADERTOYVR_CHANNEL_0); inputChannel < SHADERTOYVR_NUMCHANNELS; inputChannel++)
+    {
+        if (g_ChannelStreams[inputChannel]) {
+            return false;
+        }
+    }
+
+    GLint location = -1;
+    if (g_ActiveToyProgram->GetUniformLocation("iDate", &location)) {
+        return false;
+    }
+    bool readsTime = g_ActiveToyProgram->GetUniformLocation("iGlobalTime", &location) ||
+        g_ActiveToyProgram->GetUniformLocation("iChannelTime", &location);
+    if (readsTime && g_Playing) {
+        return false;
+    }
+
+    memset(&scene, 0, sizeof(scene));
+    scene.program = &*g_ActiveToyProgram;
+    scene.playTimeInSecs = readsTime ? g_PlaybackTimeInSecs : 0.f;
+    scene.focalLength = g_FocalLengthScalar;
+    for (uint inputChannel = uint(SHADERTOYVR_CHANNEL_0); inputChannel < SHADERTOYVR_NUMCHANNELS; inputChannel++)
+    {
+        scene.channelTextures[inputChannel] = g_ChannelTextures[inputChannel]->GetIndex();
+    }
+    memcpy(scene.viewportSizes, g_OVRViewportSize, sizeof(scene.viewportSizes));
+    scene.stereoView = g_OVRStereoView;
+    scene.lensMask = g_OVRLensMaskEnabled;
+    return true;
+}
+
+// -------------------------------------------------------------------------
+
+void
+ShaderToyVRDraw(void)
+{
+
+
+    // TODO: HMD sensor information sent to overlay display
+    ovrTrackingState ts = ovrHmd_GetTrackingState(g_HMD, ovr_GetTimeInSeconds());
+    if (ts.StatusFlags & (ovrStatus_OrientationTracked))
+    {
+        ovrPosef pose = ts.HeadPose.ThePose;
+        float eyeYaw = 0.f;
+        float eyePitch = 0.f;
+        float eyeRoll = 0.f;
+
+        Quatf quatOrientation(pose.Orientation.x, pose.Orientation.y, pose.Orientation.z, pose.Orientation.w);
+        quatOrientation.GetEulerAngles<Axis_Y, Axis_X, Axis_Z>(&eyeYaw, &eyePitch, &eyeRoll);
+
+        if (ts.StatusFlags & (ovrStatus_PositionTracked)) 
+        {
+            g_OverlayStats->UpdateData("Eye X", pose.Position.x);
+            g_OverlayStats->UpdateData("Eye Y", pose.Position.y);
+            g_OverlayStats->UpdateData("Eye Z", pose.Position.z);
+        }
+        else 
+        {
+            g_OverlayStats->UpdateData("Eye X", 0.f);
+            g_OverlayStats->UpdateData("Eye Y", 0.f);
+            g_OverlayStats->UpdateData("Eye Z", 0.f);
+        }
+
+        g_OverlayStats->UpdateData("Eye Yaw", eyeYaw);
+        g_OverlayStats->UpdateData("Eye Pitch", eyePitch);
+        g_OverlayStats->UpdateData("Eye Roll", eyeRoll);
+    }
+
+    double frameStartInSecs = ovr_GetTimeInSeconds();
+    g_FrameArena.Reset();
+    ovrFrameTiming frameTiming = ovrHmd_BeginFrame(g_HMD, g_FramePacer.GetFrameIndex());
+    ShaderToyVRUpdateEyeViewports(ts, frameStartInSecs);
+
+    // Both poses are taken before drawing, so a still head can draw them
+    // from where the stillness began; EndFrame gets the poses drawn from
+    // and timewarp corrects for any drift.
+    static ovrPosef eyePoses[2];
+    for (int i = 0; i < 2; i++)
+    {
+        ovrEyeType eye = g_HMD->EyeRenderOrder[i];
+        eyePoses[eye] = ovrHmd_GetHmdPosePerEye(g_HMD, eye);
+    }
+
+    STVRStillScene stillScene;
+    bool inputsStill = ShaderToyVRGatherStillScene(stillScene);
+    g_StillFrames.Update(eyePoses, inputsStill, stillScene);
+
+    for (int i = 0; i < 2; i++)
+    {
+        ovrEyeType eye = g_HMD->EyeRenderOrder[i];
+
+        glBindFramebuffer(GL_FRAMEBUFFER, g_OVRFrameBuffer[eye]->GetIndex());
+
+        ShaderToyVRRenderScene(eye, eyePoses[eye]);
+    }
+
+    ovrTexture textures[2] = { g_EyeTextures[0].Texture, g_EyeTextures[1].Texture };
+    double cpuMillisecs = (ovr_GetTimeInSeconds() - frameStartInSecs) * 1000.0;
+    g_FramePacer.RecordCpuTime(cpuMillisecs);
+    ovrHmd_EndFrame(g_HMD, eyePoses, textures);
+
+    if (g_Telemetry.IsRecording())
+    {
+        ShaderToyVRRecordTelemetry(ts, frameTiming, frameStartInSecs, cpuMillisecs);
+    }
+}
+
+// -------------------------------------------------------------------------
+
+// Closes the allocation counts of the frame just drawn, and warns the first
+// time a steady frame allocated on the render thread.
+void
+ShaderToyVRCheckHeapAllocs()
+{
+    STVRTrackingAllocator::BeginFrame();
+    const STVRFrameAllocStats& lastFrame = STVRTrackingAllocator::GetLastFrame();
+
+    if (lastFrame.tagCounts[STVR_ALLOC_RELOAD].allocCount > 0)
+    {
+        g_HeapSteadyFrameCount = 0;
+        return;
+    }
+    if (g_HeapSteadyFrameCount < c_HeapCheckSettleFrames)
+    {
+        g_HeapSteadyFrameCount++;
+        return;
+    }
+
+    if (lastFrame.frameThreadCounts.allocCount > 0 && g_HeapAllocatingFrameCount++ == 0)
+    {
+        std::cerr << "ShaderToyVR WARNING: a steady frame made [ " << lastFrame.frameThreadCounts.allocCount <<
+            " ] heap allocations ( " << lastFrame.frameThreadCounts.allocBytes << " bytes ) on the render thread, LibOVR made [ " <<
+            lastFrame.tagCounts[STVR_ALLOC_LIBOVR].allocCount << " ] of all threads' allocations" << std::endl;
+    }
+}
+
+// ========================================================================
+// KEYSTROKE CALLBACKS
+// ========================================================================
+
+void
+ShaderToyVRUpdateOVRScreenPercentage(float delta)
+{
+
+    g_ScreenPercentage = std::clamp(g_ScreenPercentage + delta, .2f, 2.0f);
+    std::cout << "Screen Percentage: " << g_ScreenPercentage << std::endl;
+
+    for (ovrEyeType eye = ovrEyeType::ovrEye_Left;
+        eye < ovrEyeType::ovrEye_Count;
+        eye = static_cast<ovrEyeType>(eye + 1))
+    {
+        ShaderToyVRGenOVRTextures(eye);
+    }
+}
+
+void
 ShaderToyVRUpdateFocalLengthScalar(float delta)
 {
 
@@ -1196,6 +2122,7 @@ ShaderToyVRToggleDisplayOverlay()
     g_DisplayOverlay = !g_DisplayOverlay;
     if (!g_DisplayOverlay) {
         std::cout << "Hiding Overlay" << std::endl;
+        g_ShaderVariants.PrintReport(std::cout);
     } else {
         std::cout << "Showing Overlay" << std::endl;
     }
@@ -1228,6 +2155,70 @@ ShaderToyVRToggleDisplayPositionalCam()
 
 }
 
+void
+ShaderToyVRToggleLensMask()
+{
+    g_OVRLensMaskEnabled = !g_OVRLensMaskEnabled;
+    if (!g_OVRLensMaskEnabled) {
+        std::cout << "Drawing Every Eye Pixel" << std::endl;
+    }
+    else {
+        std::cout << "Skipping Eye Pixels Hidden By The Lenses" << std::endl;
+    }
+
+}
+
+void
+ShaderToyVRToggleFramePacing()
+{
+    g_FramePacer.SetEnabled(!g_FramePacer.IsEnabled());
+    if (g_FramePacer.IsEnabled()) {
+        std::cout << "Starting Frames As Late As Timewarp Allows" << std::endl;
+    }
+    else {
+        std::cout << "Starting Frames Right Away" << std::endl;
+    }
+}
+
+void
+ShaderToyVRToggleMotionResolution()
+{
+    g_MotionResolution.SetEnabled(!g_MotionResolution.IsEnabled());
+    if (g_MotionResolution.IsEnabled()) {
+        std::cout << "Lowering Resolution While The Head Turns" << std::endl;
+    }
+    else {
+        std::cout << "Keeping Full Resolution While The Head Turns" << std::endl;
+    }
+}
+
+void
+ShaderToyVRToggleStillFrames()
+{
+    g_StillFrames.SetEnabled(!g_StillFrames.IsEnabled());
+    if (g_StillFrames.IsEnabled()) {
+        std::cout << "Supersampling And Reusing Still Frames" << std::endl;
+    }
+    else {
+        std::cout << "Drawing Every Frame" << std::endl;
+    }
+}
+
+void
+ShaderToyVRTogglePlaying()
+{
+    g_Playing = !g_Playing;
+    if (g_Playing)
+    {
+        // carry on from the time it was paused at
+        g_PlaybackResetInSecs = ovr_GetTimeInSeconds() - g_PlaybackTimeInSecs;
+        std::cout << "Playing" << std::endl;
+    }
+    else {
+        std::cout << "Paused" << std::endl;
+    }
+}
+
 void 
 ShaderToyVRGLFWErrorCallback(int error, const char* description)
 {
@@ -1241,12 +2232,11 @@ ShaderToyVRGLFWKeyCallback(GLFWwindow* window, int key, int scancode, int action
     // TODO: Implement adaptive ScreenPercentage mode (keyed by p) - adjust ScreenPercentage until FPS is
     // acceptable
 
-    // TODO: Implement ability to reload shaders and resources on the fly (keyed by o)
-
-    // TODO: Implement SpaceBar to play and pause experiences
-
     // TODO: Implement WASD keys to fly with look direction
 
+    // anything a key asks for may load or rebuild
+    STVRAllocTagScope reloadScope(STVR_ALLOC_RELOAD);
+
     if ((key == GLFW_KEY_ESCAPE || key == GLFW_KEY_Q) && action == GLFW_PRESS)
     {
         glfwSetWindowShouldClose(window, GL_TRUE);
@@ -1272,11 +2262,41 @@ ShaderToyVRGLFWKeyCallback(GLFWwindow* window, int key, int scancode, int action
         ShaderToyVRToggleDisplayPositionalCam();
     }
 
+    if (key == GLFW_KEY_H && action == GLFW_PRESS)
+    {
+        ShaderToyVRToggleLensMask();
+    }
+
+    if (key == GLFW_KEY_L && action == GLFW_PRESS)
+    {
+        ShaderToyVRToggleFramePacing();
+    }
+
+    if (key == GLFW_KEY_V && action == GLFW_PRESS)
+    {
+        ShaderToyVRToggleMotionResolution();
+    }
+
+    if (key == GLFW_KEY_F && action == GLFW_PRESS)
+    {
+        ShaderToyVRToggleStillFrames();
+    }
+
+    if (key == GLFW_KEY_SPACE && action == GLFW_PRESS)
+    {
+        ShaderToyVRTogglePlaying();
+    }
+
     if (key == GLFW_KEY_R && action == GLFW_PRESS)
     {
         ShaderToyVRResetOVRPosition();
     }
 
+    if (key == GLFW_KEY_O && action == GLFW_PRESS)
+    {
+        ShaderToyVRReloadShader();
+    }
+
     if (key == GLFW_KEY_MINUS && action == GLFW_PRESS)
     {
         ShaderToyVRUpdateOVRScreenPercentage(-.1f);
@@ -1295,6 +2315,16 @@ ShaderToyVRGLFWKeyCallback(GLFWwindow* window, int key, int scancode, int action
     {
         ShaderToyVRUpdateFocalLengthScalar(.1f);
     }
+
+    if (key == GLFW_KEY_N && action == GLFW_PRESS)
+    {
+        ShaderToyVRStepPlaylist(1);
+    }
+
+    if (key == GLFW_KEY_B && action == GLFW_PRESS)
+    {
+        ShaderToyVRStepPlaylist(-1);
+    }
 }
 
 // ========================================================================
@@ -1303,31 +2333,42 @@ ShaderToyVRGLFWKeyCallback(GLFWwindow* window, int key, int scancode, int action
 
 void
 ShaderToyVRResetWorldTimer() {
-    g_PlaybackResetInSecs = (float)glfwGetTime();
+    g_PlaybackResetInSecs = ovr_GetTimeInSeconds();
+
+    // a paused toy doesn't update the play time until it plays again
+    g_PlaybackTimeInSecs = 0.f;
 }
 
 void
 ShaderToyVRUpdateTime()
 {
+    double nowInSecs = ovr_GetTimeInSeconds();
     g_FrameNumber++;
     
-    if (g_PlaybackTimeInSecs - g_TimebaseInSecs > 1.0f)
+    // counted on the clock, not the playback time, which stops when paused
+    if (nowInSecs - g_TimebaseInSecs > 1.0)
     {
-        g_FramesPerSecond = g_FrameNumber / (g_PlaybackTimeInSecs - g_TimebaseInSecs);
-        g_TimebaseInSecs = g_PlaybackTimeInSecs;
+        g_FramesPerSecond = float(g_FrameNumber / (nowInSecs - g_TimebaseInSecs));
+        g_TimebaseInSecs = nowInSecs;
         g_FrameNumber = 0;
     }
 
     if (g_Playing)
     {
-        g_PlaybackTimeInSecs = (float)ovr_GetTimeInSeconds() - g_PlaybackResetInSecs;
+        // the difference is taken in double, a float of the clock itself
+        // would only resolve a few milliseconds after a day of uptime
+        g_PlaybackTimeInSecs = float(nowInSecs - g_PlaybackResetInSecs);
     }
 
-    // Channel times are not supported until we have video or music
-    g_ChannelTimes[0] = g_PlaybackTimeInSecs;
-    g_ChannelTimes[1] = g_PlaybackTimeInSecs;
-    g_ChannelTimes[2] = g_PlaybackTimeInSecs;
-    g_ChannelTimes[3] = g_PlaybackTimeInSecs;
+    // Streamed channels report their own clock (see ShaderToyVRUpdateChannelStreams),
+    // every other channel just follows the playback time.
+    for (uint inputChannel = uint(SHADERTOYVR_CHANNEL_0); inputChannel < SHADERTOYVR_NUMCHANNELS; inputChannel++)
+    {
+        if (!g_ChannelStreams[inputChannel])
+        {
+            g_ChannelTimes[inputChannel] = g_PlaybackTimeInSecs;
+        }
+    }
 
     SYSTEMTIME sysTime;
     GetLocalTime(&sysTime);
@@ -1338,6 +2379,23 @@ ShaderToyVRUpdateTime()
 
 }
 
+void
+ShaderToyVRUpdateChannelStreams()
+{
+    // Streams only swap in frames that their worker threads have already
+    // decoded or analysed, so this never waits on disk, decode or audio.  This
+    // runs once per frame before either eye is drawn, so each stream uploads
+    // at most once and both eyes see the same texture.
+    for (uint inputChannel = uint(SHADERTOYVR_CHANNEL_0); inputChannel < SHADERTOYVR_NUMCHANNELS; inputChannel++)
+    {
+        if (g_ChannelStreams[inputChannel])
+        {
+            g_ChannelStreams[inputChannel]->Update(g_PlaybackTimeInSecs);
+            g_ChannelTimes[inputChannel] = g_ChannelStreams[inputChannel]->GetChannelTime();
+        }
+    }
+}
+
 void
 ShaderToyVRSetupViewWindow()
 {
@@ -1403,12 +2461,541 @@ ShaderToyVRSetupViewWindow()
 
 }
 
+// ========================================================================
+// CPU RENDERING
+// ========================================================================
+
+// Headless mode for machines with no GPU: draw each toy (every toy of the
+// playlist, or the one toy) with STVRCpuRenderer, report its throughput and
+// write the frames to outputDirectory as TGA files if one is given.  Needs no
+// window, GL context or headset.
+std::vector<std::string>
+ShaderToyVRGetCpuToyPaths()
+{
+    std::vector<std::string> toyPaths;
+    for (size_t toyIdx = 0; toyIdx < g_Playlist.GetToyCount(); toyIdx++) {
+        toyPaths.push_back(g_Playlist.GetToyPath(toyIdx));
+    }
+    if (toyPaths.empty()) {
+        toyPaths.push_back(g_ShaderToyFilePath);
+    }
+    return toyPaths;
+}
+
+int
+ShaderToyVRRenderOnCpu(int width, int height, int frameCount, const std::string& outputDirectory)
+{
+    // toys look up their channel textures while they are parsed
+    STVRAssetRegistry::Get().LoadManifest(c_AssetManifestPath);
+
+    std::vector<std::string> toyPaths = ShaderToyVRGetCpuToyPaths();
+
+    int exitCode = EXIT_SUCCESS;
+    std::vector<unsigned char> rgba;
+    std::vector<unsigned char> flipped(size_t(width) * height * 4);
+
+    for (size_t toyIdx = 0; toyIdx < toyPaths.size(); toyIdx++)
+    {
+        STVRFragmentShader toy(toyPaths[toyIdx]);
+        STVRCpuRenderer renderer;
+        if (!renderer.Load(toy)) {
+            std::cerr << "ShaderToyVR ERROR: cannot draw [ " << toyPaths[toyIdx] << " ] on the CPU" << std::endl;
+            exitCode = EXIT_FAILURE;
+            continue;
+        }
+
+        std::string toyName = toyPaths[toyIdx].substr(toyPaths[toyIdx].find_last_of("/\\") + 1);
+        toyName = toyName.substr(0, toyName.find_last_of('.'));
+
+        double totalMillisecs = 0.;
+        for (int frameIdx = 0; frameIdx < frameCount; frameIdx++)
+        {
+            renderer.Render(width, height, frameIdx * c_CpuFrameStepInSecs, rgba);
+            totalMillisecs += renderer.GetLastRenderMillisecs();
+
+            if (outputDirectory.empty()) {
+                continue;
+            }
+
+            // SOIL writes the top row first
+            size_t rowBytes = size_t(width) * 4;
+            for (int row = 0; row < height; row++) {
+                memcpy(&flipped[row * rowBytes], &rgba[(height - 1 - row) * rowBytes], rowBytes);
+            }
+
+            char frameSuffix[32];
+            snprintf(frameSuffix, sizeof(frameSuffix), ".%04d.tga", frameIdx);
+            std::string framePath = outputDirectory + "/" + toyName + frameSuffix;
+            if (!SOIL_save_image(framePath.c_str(), SOIL_SAVE_TYPE_TGA, width, height, 4, &flipped[0])) {
+                std::cerr << "ShaderToyVR ERROR: cannot write [ " << framePath << " ]" << std::endl;
+                exitCode = EXIT_FAILURE;
+            }
+        }
+
+        double averageMillisecs = totalMillisecs / frameCount;
+        std::cout << "ShaderToyVR CPU [ " << toyName << " ]: " << width << " x " << height << ", " << frameCount <<
+            " frames, " << averageMillisecs << " ms per frame, " <<
+            (double(width) * height / (averageMillisecs * 1000.)) << " Mpix/s" << std::endl;
+    }
+
+    return exitCode;
+}
+
+// Headless view through the headset: draw both eyes of each toy with
+// STVRCpuRenderer at the size and from the camera the GPU path would use
+// (with the head at the origin), then distort the pair into the frame the
+// headset shows with LibOVR's CPU distortion.  Timewarp is left out, there
+// is no pose to warp to.  Frames go to outputDirectory as toy.hmd.NNNN.tga.
+// Falls back on a debug DK2 like the GPU path when no headset is found.
+int
+ShaderToyVRRenderHmdOnCpu(int frameCount, const std::string& outputDirectory)
+{
+    STVRAssetRegistry::Get().LoadManifest(c_AssetManifestPath);
+    ShaderToyVRInitOVR();
+
+    ovrSizei eyeSizes[2];
+    ovrFovPort eyeFovPorts[2];
+    glm::mat4 eyeCameraTransforms[2];
+    for (int eye = 0; eye < ovrEye_Count; eye++)
+    {
+        eyeFovPorts[eye] = g_HMD->DefaultEyeFov[eye];
+        eyeSizes[eye] = ovrHmd_GetFovTextureSize(g_HMD, static_cast<ovrEyeType>(eye), eyeFovPorts[eye], g_ScreenPercentage);
+
+        ovrEyeRenderDesc eyeRenderDesc = ovrHmd_GetRenderDesc(g_HMD, static_cast<ovrEyeType>(eye), eyeFovPorts[eye]);
+        eyeCameraTransforms[eye] = ShaderToyVRCameraTransformFromModelview(
+            glm::translate(glm::mat4(), FromOvrVecToVec(eyeRenderDesc.HmdToEyeViewOffset)));
+    }
+
+    // the GPU path's caps, less timewarp; the eye textures are sampled nearest
+    const unsigned int distortionCaps = ovrDistortionCap_Chromatic | ovrDistortionCap_Vignette;
+    int frameWidth = g_HMD->Resolution.w;
+    int frameHeight = g_HMD->Resolution.h;
+
+    STVRLensMask lensMasks[2];
+    for (int eye = 0; eye < ovrEye_Count; eye++) {
+        lensMasks[eye].Build(g_HMD, static_cast<ovrEyeType>(eye), eyeFovPorts[eye], eyeSizes[eye].w, eyeSizes[eye].h, distortionCaps);
+    }
+
+    int exitCode = EXIT_SUCCESS;
+    std::vector<std::string> toyPaths = ShaderToyVRGetCpuToyPaths();
+    std::vector<unsigned char> eyeImages[2];
+    std::vector<unsigned char> frame(size_t(frameWidth) * frameHeight * 4);
+    std::vector<unsigned char> flipped(frame.size());
+
+    for (size_t toyIdx = 0; toyIdx < toyPaths.size(); toyIdx++)
+    {
+        STVRFragmentShader toy(toyPaths[toyIdx]);
+        STVRCpuRenderer renderer;
+        if (!renderer.Load(toy)) {
+            std::cerr << "ShaderToyVR ERROR: cannot draw [ " << toyPaths[toyIdx] << " ] on the CPU" << std::endl;
+            exitCode = EXIT_FAILURE;
+            continue;
+        }
+
+        std::string toyName = toyPaths[toyIdx].substr(toyPaths[toyIdx].find_last_of("/\\") + 1);
+        toyName = toyName.substr(0, toyName.find_last_of('.'));
+
+        double toyMillisecs = 0.;
+        double distortionMillisecs = 0.;
+        for (int frameIdx = 0; frameIdx < frameCount; frameIdx++)
+        {
+            for (int eye = 0; eye < ovrEye_Count; eye++)
+            {
+                renderer.SetCameraTransform(glm::value_ptr(eyeCameraTransforms[eye]));
+                renderer.SetVisibleTexels(&lensMasks[eye].GetVisibleTexels());
+                renderer.Render(eyeSizes[eye].w, eyeSizes[eye].h, frameIdx * c_CpuFrameStepInSecs, eyeImages[eye]);
+                toyMillisecs += renderer.GetLastRenderMillisecs();
+            }
+
+            const unsigned char* eyePixels[2] = { &eyeImages[0][0], &eyeImages[1][0] };
+            double startTimeInSecs = ovr_GetTimeInSeconds();
+            ovrHmd_DistortEyeImagesOnCpu(g_HMD, eyeFovPorts, eyePixels, eyeSizes, distortionCaps, 0, &frame[0]);
+            distortionMillisecs += (ovr_GetTimeInSeconds() - startTimeInSecs) * 1000.;
+
+            if (outputDirectory.empty()) {
+                continue;
+            }
+
+            // SOIL writes the top row first
+            size_t rowBytes = size_t(frameWidth) * 4;
+            for (int row = 0; row < frameHeight; row++) {
+                memcpy(&flipped[row * rowBytes], &frame[(frameHeight - 1 - row) * rowBytes], rowBytes);
+            }
+
+            char frameSuffix[32];
+            snprintf(frameSuffix, sizeof(frameSuffix), ".hmd.%04d.tga", frameIdx);
+            std::string framePath = outputDirectory + "/" + toyName + frameSuffix;
+            if (!SOIL_save_image(framePath.c_str(), SOIL_SAVE_TYPE_TGA, frameWidth, frameHeight, 4, &flipped[0])) {
+                std::cerr << "ShaderToyVR ERROR: cannot write [ " << framePath << " ]" << std::endl;
+                exitCode = EXIT_FAILURE;
+            }
+        }
+
+        std::cout << "ShaderToyVR CPU HMD [ " << toyName << " ]: eyes " << eyeSizes[0].w << " x " << eyeSizes[0].h <<
+            ", frame " << frameWidth << " x " << frameHeight << ", " << frameCount << " frames, " <<
+            toyMillisecs / frameCount << " ms toy and " << distortionMillisecs / frameCount << " ms distortion per frame, " <<
+            (lensMasks[0].GetHiddenFraction() + lensMasks[1].GetHiddenFraction()) * 50.f << "% of the toy's pixels skipped" << std::endl;
+    }
+
+    ShaderToyVRCloseOVR();
+    return exitCode;
+}
+
+// ========================================================================
+// GOLDEN IMAGES
+// ========================================================================
+
+// The head pose of a golden case, as the headset would report it
+ovrPosef
+ShaderToyVRMakeGoldenPose(const STVRGoldenPose& goldenPose)
+{
+    Quatf yaw(Vector3f(0.f, 1.f, 0.f), DegreeToRad(goldenPose.yawDegrees));
+    Quatf pitch(Vector3f(1.f, 0.f, 0.f), DegreeToRad(goldenPose.pitchDegrees));
+
+    ovrPosef pose;
+    pose.Orientation = yaw * pitch;
+    pose.Position.x = goldenPose.position[0];
+    pose.Position.y = goldenPose.position[1];
+    pose.Position.z = goldenPose.position[2];
+    return pose;
+}
+
+// A hidden window for its context and one eye target width x height, set up
+// the way ShaderToyVRInitOVRGLSystem sets up an eye.  Returns false when
+// there is no GL to draw with.
+bool
+ShaderToyVRInitGoldenGL(int width, int height)
+{
+    glfwSetErrorCallback(ShaderToyVRGLFWErrorCallback);
+    if (!glfwInit()) {
+        return false;
+    }
+
+    glfwWindowHint(GLFW_VISIBLE, GL_FALSE);
+    g_GLFWWindow = glfwCreateWindow(width, height, "ShaderToyVR Goldens", NULL, NULL);
+    glfwWindowHint(GLFW_VISIBLE, GL_TRUE);
+    if (!g_GLFWWindow) {
+        glfwTerminate();
+        return false;
+    }
+    glfwMakeContextCurrent(g_GLFWWindow);
+
+    glewExperimental = GL_TRUE;
+    GLenum err = glewInit();
+    if (GLEW_OK != err)
+    {
+        std::cerr << "ShaderToy GLEW Error: [ " << err << " ] ::" << glewGetErrorString(err) << std::endl;
+        glfwDestroyWindow(g_GLFWWindow);
+        g_GLFWWindow = NULL;
+        glfwTerminate();
+        return false;
+    }
+
+    g_OverlayStats = HBGLOverlayStatsPtr(new HBGLOverlayStats());
+    g_ToyGpuTimer = HBGLGpuTimerPtr(new HBGLGpuTimer());
+
+    ShaderToyVRGenEyeTarget(ovrEye_Left);
+    ShaderToyVRSizeEyeTarget(ovrEye_Left, width, height);
+    ShaderToyVRGenScreenQuadBuffers();
+    return true;
+}
+
+void
+ShaderToyVRCloseGoldenGL()
+{
+    ShaderToyVRResetChannels();
+    g_BufferPasses->Clear();
+    g_ActiveToyProgram.reset();
+    g_ScreenQuadShaderProgram.reset();
+    g_ToyGpuTimer->Release();
+
+    glfwDestroyWindow(g_GLFWWindow);
+    g_GLFWWindow = NULL;
+    glfwTerminate();
+}
+
+// Make the toy at toyPath the one ShaderToyVRRenderScene draws.
+bool
+ShaderToyVRLoadGoldenToy(const std::string& toyPath)
+{
+    HBGLShaderProgramPtr program = ShaderToyVRBuildToyProgram(toyPath);
+    if (!program) {
+        return false;
+    }
+
+    g_ScreenQuadShaderProgram = program;
+    g_ActiveToyProgram = program;
+    g_ActiveVariantKey = 0;
+
+    // FRAGILE: consider re-implementing GetFragmentShader as a virtual function that
+    // returns an already cast STVRFragmentShaderPtr.
+    HBGLShaderPtr fragShaderPtr = program->GetFragmentShader();
+    const STVRFragmentShader* stvrFragShader = static_cast<STVRFragmentShader*>(&*fragShaderPtr);
+    g_BufferPasses = STVRBufferPassesPtr(new STVRBufferPasses());
+    if (!g_BufferPasses->Load(stvrFragShader, c_ProgramBinaryCacheDir)) {
+        return false;
+    }
+
+    ShaderToyVRResetChannels();
+    ShaderToyVRLoadResources();
+    return true;
+}
+
+// Draw the left eye at pose and timeInSecs as ShaderToyVRDraw would, and
+// read back the viewport it drew.  A steady frame that allocates on the
+// heap is counted like one of the app's.  Returns the milliseconds it took.
+double
+ShaderToyVRRenderGoldenFrame(const ovrPosef& pose, float timeInSecs, bool steady, std::vector<unsigned char>& frame)
+{
+    double startInSecs = glfwGetTime();
+    STVRTrackingAllocator::BeginFrame();
+    g_PlaybackTimeInSecs = timeInSecs;
+
+    ovrPosef eyePoses[2] = { pose, pose };
+    STVRStillScene stillScene;
+    bool inputsStill = ShaderToyVRGatherStillScene(stillScene);
+    g_StillFrames.Update(eyePoses, inputsStill, stillScene);
+
+    glBindFramebuffer(GL_FRAMEBUFFER, g_OVRFrameBuffer[ovrEye_Left]->GetIndex());
+    ShaderToyVRRenderScene(ovrEye_Left, eyePoses[ovrEye_Left]);
+
+    STVRAllocCounts drawCounts = STVRTrackingAllocator::GetFrameThreadCounts();
+    if (steady && drawCounts.allocCount > 0)
+    {
+        std::cerr << "ShaderToyVR GOLDEN: a steady frame made [ " << drawCounts.allocCount << " ] heap allocations ( " <<
+            drawCounts.allocBytes << " bytes ) on the render thread" << std::endl;
+        g_HeapAllocatingFrameCount++;
+    }
+
+    GLsizei width = g_OVRViewportSize[ovrEye_Left][0];
+    GLsizei height = g_OVRViewportSize[ovrEye_Left][1];
+    frame.resize(size_t(width) * height * 4);
+
+    glBindFramebuffer(GL_FRAMEBUFFER, g_OVRFrameBuffer[ovrEye_Left]->GetIndex());
+    glPixelStorei(GL_PACK_ALIGNMENT, 1);
+    glReadPixels(0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE, &frame[0]);
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+    return (glfwGetTime() - startInSecs) * 1000.;
+}
+
+// Every pose and time of the toy through the GL path, then what the
+// headset draws mid turn at motion resolution's smallest scale ("scaled")
+// and once a still head's frames have converged ("still").  With
+// checkAllocs, every frame but the toy's first is a steady one.
+bool
+ShaderToyVRRunGoldenToyOnGpu(const std::string& toyPath, STVRGoldenImages& goldens, bool updateGoldens, bool checkAllocs)
+{
+    if (!ShaderToyVRLoadGoldenToy(toyPath)) {
+        goldens.AddFailure(toyPath);
+        return false;
+    }
+
+    GLsizei width = g_OVRTextureSize[ovrEye_Left][0];
+    GLsizei height = g_OVRTextureSize[ovrEye_Left][1];
+    bool toyPassed = true;
+    std::vector<unsigned char> frame;
+
+    for (size_t poseIdx = 0; poseIdx < STVRGoldenImages::GetPoseCount(); poseIdx++)
+    {
+        const STVRGoldenPose& goldenPose = STVRGoldenImages::GetPose(poseIdx);
+        ovrPosef pose = ShaderToyVRMakeGoldenPose(goldenPose);
+
+        for (size_t timeIdx = 0; timeIdx < STVRGoldenImages::GetTimeCount(); timeIdx++)
+        {
+            float timeInSecs = STVRGoldenImages::GetTimeInSecs(timeIdx);
+
+            // a plain frame, not the second sample of the last case's pose
+            g_StillFrames.Reset();
+            bool steady = checkAllocs && (poseIdx > 0 || timeIdx > 0);
+            double millisecs = ShaderToyVRRenderGoldenFrame(pose, timeInSecs, steady, frame);
+            toyPassed = goldens.CheckFrame(STVRGoldenImages::GetCaseName(toyPath, goldenPose.name, timeInSecs),
+                frame, width, height, millisecs, updateGoldens) && toyPassed;
+        }
+    }
+
+    ovrPosef aheadPose = ShaderToyVRMakeGoldenPose(STVRGoldenImages::GetPose(0));
+    float timeInSecs = STVRGoldenImages::GetTimeInSecs(1);
+
+    STVRMotionResolution turningResolution;
+    ovrVector3f fastTurn = { 0.f, c_GoldenTurnRadiansPerSec, 0.f };
+    turningResolution.Update(fastTurn, 0.);
+    ovrSizei textureSize = { width, height };
+    ovrRecti viewport = turningResolution.GetRenderViewport(textureSize);
+
+    g_OVRViewportSize[ovrEye_Left][0] = viewport.Size.w;
+    g_OVRViewportSize[ovrEye_Left][1] = viewport.Size.h;
+    g_StillFrames.Reset();
+    double millisecs = ShaderToyVRRenderGoldenFrame(aheadPose, timeInSecs, checkAllocs, frame);
+    toyPassed = goldens.CheckFrame(STVRGoldenImages::GetCaseName(toyPath, "scaled", timeInSecs),
+        frame, viewport.Size.w, viewport.Size.h, millisecs, updateGoldens) && toyPassed;
+    g_OVRViewportSize[ovrEye_Left][0] = width;
+    g_OVRViewportSize[ovrEye_Left][1] = height;
+
+    // a toy that never holds still (it reads iDate, or has feedback passes)
+    // checks its plain frame here
+    g_StillFrames.Reset();
+    millisecs = ShaderToyVRRenderGoldenFrame(aheadPose, timeInSecs, checkAllocs, frame);
+    for (int frameIdx = 1; frameIdx < c_GoldenMaxStillFrames && !g_StillFrames.IsConverged(); frameIdx++)
+    {
+        millisecs += ShaderToyVRRenderGoldenFrame(aheadPose, timeInSecs, checkAllocs, frame);
+        if (g_StillFrames.GetSampleCount() == 0) {
+            break;
+        }
+    }
+    toyPassed = goldens.CheckFrame(STVRGoldenImages::GetCaseName(toyPath, "still", timeInSecs),
+        frame, width, height, millisecs, updateGoldens) && toyPassed;
+
+    return toyPassed;
+}
+
+// Every pose and time of the toy through STVRCpuRenderer, from the camera
+// the GL path would use.  The scaled and still cases need GL.
+bool
+ShaderToyVRRunGoldenToyOnCpu(const std::string& toyPath, int width, int height, STVRGoldenImages& goldens, bool updateGoldens)
+{
+    STVRFragmentShader toy(toyPath);
+    STVRCpuRenderer renderer;
+    if (!renderer.Load(toy)) {
+        goldens.AddFailure(toyPath);
+        return false;
+    }
+
+    bool toyPassed = true;
+    std::vector<unsigned char> frame;
+
+    for (size_t poseIdx = 0; poseIdx < STVRGoldenImages::GetPoseCount(); poseIdx++)
+    {
+        const STVRGoldenPose& goldenPose = STVRGoldenImages::GetPose(poseIdx);
+        glm::mat4 cameraTransform = ShaderToyVRCameraTransformFromModelview(
+            ShaderToyVREyeModelview(ovrEye_Left, ShaderToyVRMakeGoldenPose(goldenPose)));
+        renderer.SetCameraTransform(glm::value_ptr(cameraTransform));
+
+        for (size_t timeIdx = 0; timeIdx < STVRGoldenImages::GetTimeCount(); timeIdx++)
+        {
+            float timeInSecs = STVRGoldenImages::GetTimeInSecs(timeIdx);
+            renderer.Render(width, height, timeInSecs, frame);
+            toyPassed = goldens.CheckFrame(STVRGoldenImages::GetCaseName(toyPath, goldenPose.name, timeInSecs),
+                frame, width, height, renderer.GetLastRenderMillisecs(), updateGoldens) && toyPassed;
+        }
+    }
+
+    return toyPassed;
+}
+
+// Regression check: draw every toy of c_GoldenToyDirectory at the fixed
+// times and poses of STVRGoldenImages and compare the frames with the
+// goldens in goldenDirectory, or store them as the new goldens.  Draws
+// through the same GL path as the headset, one eye on its own, in a hidden
+// window; without GL it falls back on the CPU renderer and the goldens in
+// goldenDirectory/cpu.  Fails if any frame does, or if a steady GL frame
+// allocated on the heap.
+int
+ShaderToyVRRunGoldens(int width, int height, const std::string& goldenDirectory, bool updateGoldens)
+{
+    STVRAssetRegistry::Get().LoadManifest(c_AssetManifestPath);
+
+    std::vector<std::string> fileNames;
+    if (!HBGLUtils::ListDirectory(c_GoldenToyDirectory, fileNames)) {
+        std::cerr << "ShaderToyVR ERROR: cannot list the toys in [ " << c_GoldenToyDirectory << " ]" << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    // The camera math of a debug headset with nothing drawn over the toy.
+    // The goldens set the play time themselves, and a paused toy can hold
+    // still long enough to converge.
+    g_OVRStereoView = false;
+    g_OVRLensMaskEnabled = false;
+    g_Playing = false;
+    g_OVRPositionalCamTanHalfFov[0] = tan(c_DebugCameraFovInRadians * .5f);
+    g_OVRPositionalCamTanHalfFov[1] = tan(c_DebugCameraFovInRadians * .5f);
+
+    bool onGpu = ShaderToyVRInitGoldenGL(width, height);
+    if (!onGpu) {
+        std::cerr << "ShaderToyVR GOLDEN: no GL context, drawing on the CPU without the scaled and still cases" << std::endl;
+    }
+
+    // The CPU renderer rounds, filters textures and takes derivatives its
+    // own way, so its frames have goldens of their own.
+    std::string caseDirectory = onGpu ? goldenDirectory : goldenDirectory + "/cpu";
+    STVRGoldenImages goldens(caseDirectory);
+    if (!HBGLUtils::MakeDirectory(goldenDirectory.c_str()) || !goldens.Begin(updateGoldens)) {
+        std::cerr << "ShaderToyVR ERROR: cannot make the golden folders in [ " << caseDirectory << " ]" << std::endl;
+        if (onGpu) {
+            ShaderToyVRCloseGoldenGL();
+        }
+        return EXIT_FAILURE;
+    }
+
+    int toyCount = 0;
+    int failedToyCount = 0;
+    for (size_t fileIdx = 0; fileIdx < fileNames.size(); fileIdx++)
+    {
+        const std::string& fileName = fileNames[fileIdx];
+        if (fileName.size() < 3 || fileName.compare(fileName.size() - 3, 3, ".fs") != 0) {
+            continue;
+        }
+
+        // The first toy settles the driver: it builds what the scaled and
+        // still frames need the first time they draw, and may allocate
+        // doing so, like the app's first frames.
+        bool checkAllocs = (toyCount > 0);
+        toyCount++;
+        std::string toyPath = std::string(c_GoldenToyDirectory) + "/" + fileName;
+        bool toyPassed = onGpu ?
+            ShaderToyVRRunGoldenToyOnGpu(toyPath, goldens, updateGoldens, checkAllocs) :
+            ShaderToyVRRunGoldenToyOnCpu(toyPath, width, height, goldens, updateGoldens);
+        if (!toyPassed) {
+            failedToyCount++;
+        }
+    }
+
+    if (onGpu) {
+        ShaderToyVRCloseGoldenGL();
+    }
+
+    std::cout << "ShaderToyVR GOLDEN: " << toyCount << " toys, " << goldens.GetCaseCount() << " frames, " <<
+        goldens.GetFailureCount() << " failed in " << failedToyCount << " toys, " <<
+        g_HeapAllocatingFrameCount << " steady frames allocated" << std::endl;
+
+    return (goldens.GetFailureCount() == 0 && g_HeapAllocatingFrameCount == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
 // ========================================================================
 // SHUTDOWN
 // ========================================================================
 
 void ShaderToyVRShutdown()
 {
+    // streams join their worker threads and release GL buffers, so they go
+    // while the context is still alive
+    for (uint inputChannel = uint(SHADERTOYVR_CHANNEL_0); inputChannel < SHADERTOYVR_NUMCHANNELS; inputChannel++)
+    {
+        g_ChannelStreams[inputChannel].reset();
+    }
+
+    g_FileWatcher.Stop();
+    g_Telemetry.Stop();
+    g_Playlist.ClearResident();
+    g_BufferPasses->Clear();
+    g_OVRLensMask[ovrEye_Left].Clear();
+    g_OVRLensMask[ovrEye_Right].Clear();
+
+    if (g_ToyGpuTimer) {
+        g_ShaderVariants.PrintReport(std::cout);
+        g_ToyGpuTimer->Release();
+    }
+
+    STVRTrackingAllocator::PrintReport(std::cout);
+    std::cout << "ShaderToyVR: [ " << g_HeapAllocatingFrameCount << " ] steady frames allocated, the frame arena peaked at [ " <<
+        g_FrameArena.GetHighWaterSize() << " ] of [ " << g_FrameArena.GetCapacity() << " ] bytes and overflowed [ " <<
+        g_FrameArena.GetOverflowCount() << " ] times" << std::endl;
+    std::cout << "ShaderToyVR: [ " << g_FramePacer.GetLateFrameCount() << " ] frames missed their refresh, the late start margin ended at [ " <<
+        g_FramePacer.GetMarginMillisecs() << " ] ms" << std::endl;
+
+    // the reloader owns a hidden window, so it has to go before GLFW does
+    g_ShaderReloader.Shutdown();
+
     ShaderToyVRCloseOVR();
     glfwTerminate();
     HB_CHECK_GL_ERROR();
@@ -1439,6 +3026,137 @@ main(int argc, char** argv){
     // TODO: rudimentary argument parsing
     // TODO: Get working on a mac!
 
+    bool renderOnCpu = false;
+    bool renderHmdOnCpu = false;
+    int cpuWidth = c_CpuDefaultWidth;
+    int cpuHeight = c_CpuDefaultHeight;
+    int cpuFrameCount = c_CpuDefaultFrameCount;
+    bool cpuSizeGiven = false;
+    std::string cpuOutputDirectory;
+    std::string goldenDirectory;
+    bool updateGoldens = false;
+    std::string telemetryLogPath;
+    int realtimeCpu = -1;
+    bool runBenchmark = false;
+    std::string benchJsonPath;
+
+    for (int argIdx = 1; argIdx < argc; argIdx++)
+    {
+        if (strcmp(argv[argIdx], "--cpu") == 0)
+        {
+            renderOnCpu = true;
+        }
+        else if (strcmp(argv[argIdx], "--cpu-hmd") == 0)
+        {
+            renderHmdOnCpu = true;
+        }
+        else if (argIdx + 1 < argc && strcmp(argv[argIdx], "--cpu-size") == 0)
+        {
+            if (sscanf(argv[++argIdx], "%dx%d", &cpuWidth, &cpuHeight) != 2 || cpuWidth <= 0 || cpuHeight <= 0)
+            {
+                std::cerr << "ShaderToyVR ERROR: --cpu-size wants WIDTHxHEIGHT, not " << argv[argIdx] << std::endl;
+                return EXIT_FAILURE;
+            }
+            cpuSizeGiven = true;
+        }
+        else if (argIdx + 1 < argc && strcmp(argv[argIdx], "--cpu-frames") == 0)
+        {
+            cpuFrameCount = std::max(atoi(argv[++argIdx]), 1);
+        }
+        else if (argIdx + 1 < argc && strcmp(argv[argIdx], "--cpu-out") == 0)
+        {
+            cpuOutputDirectory = argv[++argIdx];
+        }
+        else if (argIdx + 1 < argc && strcmp(argv[argIdx], "--golden") == 0)
+        {
+            goldenDirectory = argv[++argIdx];
+        }
+        else if (strcmp(argv[argIdx], "--golden-update") == 0)
+        {
+            updateGoldens = true;
+        }
+        else if (strcmp(argv[argIdx], "--bench") == 0)
+        {
+            runBenchmark = true;
+        }
+        else if (argIdx + 1 < argc && strcmp(argv[argIdx], "--bench-json") == 0)
+        {
+            runBenchmark = true;
+            benchJsonPath = argv[++argIdx];
+        }
+        else if (argIdx + 1 < argc && strcmp(argv[argIdx], "--telemetry") == 0)
+        {
+            telemetryLogPath = argv[++argIdx];
+        }
+        else if (strcmp(argv[argIdx], "--no-late-start") == 0)
+        {
+            g_FramePacer.SetEnabled(false);
+        }
+        else if (strcmp(argv[argIdx], "--no-still-frames") == 0)
+        {
+            g_StillFrames.SetEnabled(false);
+        }
+        else if (strcmp(argv[argIdx], "--no-motion-resolution") == 0)
+        {
+            g_MotionResolution.SetEnabled(false);
+        }
+        else if (argIdx + 1 < argc && strcmp(argv[argIdx], "--motion-resolution") == 0)
+        {
+            float startSpeed = 0.f;
+            float fullSpeed = 0.f;
+            float minScale = 0.f;
+            float restoreSecs = 0.f;
+            if (sscanf(argv[++argIdx], "%f,%f,%f,%f", &startSpeed, &fullSpeed, &minScale, &restoreSecs) != 4 ||
+                !g_MotionResolution.SetCurve(startSpeed, fullSpeed, minScale, restoreSecs))
+            {
+                std::cerr << "ShaderToyVR ERROR: --motion-resolution wants START,FULL,MINSCALE,RESTORESECS, not " << argv[argIdx] << std::endl;
+                return EXIT_FAILURE;
+            }
+        }
+        else if (argIdx + 1 < argc && strcmp(argv[argIdx], "--realtime-cpu") == 0)
+        {
+            realtimeCpu = atoi(argv[++argIdx]);
+        }
+        else if (argIdx + 2 < argc && strcmp(argv[argIdx], "--telemetry-csv") == 0)
+        {
+            // no window or GL, just turn a log into something a spreadsheet reads
+            bool converted = STVRTelemetry::ConvertToCsv(argv[argIdx + 1], argv[argIdx + 2]);
+            return converted ? EXIT_SUCCESS : EXIT_FAILURE;
+        }
+        else if (argIdx + 1 < argc && strcmp(argv[argIdx], "--playlist") == 0 && g_Playlist.Load(argv[argIdx + 1]))
+        {
+            g_ShaderToyFilePath = g_Playlist.GetToyPath(0);
+        }
+    }
+
+    // no window or GL at all
+    if (runBenchmark)
+    {
+        STVRHandoffBenchmark handoffBenchmark(c_BenchSecondsPerCase);
+        STVRJsonBenchmark jsonBenchmark(benchJsonPath, c_BenchJsonRepeatCount);
+        STVRPropertyBenchmark propertyBenchmark(c_BenchPropertyLookupCount);
+        STVRCommandQueueBenchmark commandQueueBenchmark(c_BenchQueueCommandCount);
+        bool passed = handoffBenchmark.Run(std::cout);
+        passed = jsonBenchmark.Run(std::cout) && passed;
+        passed = propertyBenchmark.Run(std::cout) && passed;
+        passed = commandQueueBenchmark.Run(std::cout) && passed;
+        return passed ? EXIT_SUCCESS : EXIT_FAILURE;
+    }
+    if (!goldenDirectory.empty())
+    {
+        return ShaderToyVRRunGoldens(cpuSizeGiven ? cpuWidth : c_GoldenDefaultWidth,
+            cpuSizeGiven ? cpuHeight : c_GoldenDefaultHeight,
+            goldenDirectory, updateGoldens);
+    }
+    if (renderHmdOnCpu)
+    {
+        return ShaderToyVRRenderHmdOnCpu(cpuFrameCount, cpuOutputDirectory);
+    }
+    if (renderOnCpu)
+    {
+        return ShaderToyVRRenderOnCpu(cpuWidth, cpuHeight, cpuFrameCount, cpuOutputDirectory);
+    }
+
 #ifdef __MACOSX__
     glfwWindowHint (GLFW_CONTEXT_VERSION_MAJOR, 4);
     glfwWindowHint (GLFW_CONTEXT_VERSION_MINOR, 1);
@@ -1465,14 +3183,22 @@ main(int argc, char** argv){
     }
 
     g_OverlayStats = HBGLOverlayStatsPtr(new HBGLOverlayStats());
+    g_ToyGpuTimer = HBGLGpuTimerPtr(new HBGLGpuTimer());
 
     ShaderToyVRInitShaderSystem();
+    g_ShaderReloader.Init(g_GLFWWindow, c_ProgramBinaryCacheDir);
 
     ShaderToyVRInitOVR();
     ShaderToyVRInitOVRGLSystem();
 
     ShaderToyVRLoadResources();
 
+    ShaderToyVRWatchToyFiles();
+    if (c_WatchToyFiles)
+    {
+        g_FileWatcher.Start();
+    }
+
     ovrHmd_AttachToWindow(g_HMD, glfwGetWin32Window(g_GLFWWindow), nullptr, nullptr);
 
     ShaderToyVRGenSphereGridBuffers();
@@ -1481,14 +3207,47 @@ main(int argc, char** argv){
     ShaderToyVRResetWorldTimer();
 
     g_OverlayStats->AddDataKey("FPS", g_FramesPerSecond, 4);
+    g_OverlayStats->AddDataKey("Toy GPU (ms)", g_ToyGpuMillisecs, 4);
+    g_OverlayStats->AddDataKey("Lens Mask Saved (%)", 0.f, 4);
+    g_OverlayStats->AddDataKey("Toy Specialized", 0.f);
+    g_OverlayStats->AddDataKey("Heap Allocs", 0.f);
+    g_OverlayStats->AddDataKey("Late Start (ms)", 0.f, 4);
+    g_OverlayStats->AddDataKey("Head Speed (deg/s)", 0.f, 4);
+    g_OverlayStats->AddDataKey("Motion Scale (%)", 100.f, 4);
+    g_OverlayStats->AddDataKey("Still Samples", 0.f);
     //g_OverlayStats->AddDataKey("Play Time (seconds)", (float) g_PlaybackTimeInSecs);
 
     // TODO - so annoying!
     ovrHmd_DismissHSWDisplay(g_HMD);
 
+    if (!telemetryLogPath.empty())
+    {
+        g_Telemetry.Start(telemetryLogPath);
+    }
+
+    // the render thread is this one, and GLFW wants events polled on it too
+    if (realtimeCpu >= 0)
+    {
+        STVRFramePacer::SetRealtimeThread(realtimeCpu);
+    }
+
     while (!glfwWindowShouldClose(g_GLFWWindow))
     {
+        ShaderToyVRCheckHeapAllocs();
+
+        // each of these tags only the loading it actually does, a frame
+        // with nothing to load is a steady one
+        ShaderToyVRHandleFileChanges();
+        ShaderToyVRUpdateShaderReload();
+        ShaderToyVRUpdateShaderVariant();
+        ShaderToyVRUpdatePlaylist();
+
+        // sleep off the time the frame would otherwise spend waiting for
+        // timewarp, before the frame's time and poses are sampled
+        g_FramePacer.WaitForRenderStart(g_HMD);
+
         ShaderToyVRUpdateTime();
+        ShaderToyVRUpdateChannelStreams();
         ShaderToyVRDraw();
         glfwPollEvents();
     }
@@ -0,0 +1,137 @@
+/************************************************************************************
+
+Filename    :   CAPI_HMDProperties.cpp
+Content     :   Interned names of the properties HMDState answers
+Created     :   October 19, 2026
+
+Copyright   :   Copyright 2014 Oculus VR, LLC All Rights reserved.
+
+Licensed under the Oculus VR Rift SDK License Version 3.2 (the "License");
+you may not use the Oculus VR Rift SDK except in compliance with the License,
+which is provided at the time of installation or download, or which
+otherwise accompanies this software in either electronic or hard copy form.
+
+You may obtain a copy of the License at
+
+http://www.oculusvr.com/licenses/LICENSE-3.2
+
+Unless required by applicable law or agreed to in writing, the Oculus VR SDK
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+************************************************************************************/
+
+#include "CAPI_HMDProperties.h"
+#include "../OVR_CAPI_Keys.h"
+#include "../Kernel/OVR_Std.h"
+#include "../Service/Service_NetSessionCommon.h"
+
+namespace OVR { namespace CAPI {
+
+using namespace OVR::Service;
+
+
+//-------------------------------------------------------------------------------------
+// ***** HMDPropertyTable
+
+HMDProperty HMDPropertyTable::Slots[HMDPropertyTable::Capacity];
+unsigned    HMDPropertyTable::Count = 0;
+
+uint32_t HMDPropertyTable::Hash(const char* name)
+{
+    uint32_t hash = 2166136261u;
+    for (const unsigned char* p = (const unsigned char*)name; *p; p++)
+    {
+        hash ^= *p;
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+const HMDProperty* HMDPropertyTable::Find(const char* name)
+{
+    if (name == NULL)
+        return NULL;
+
+    uint32_t hash = Hash(name);
+
+    // Linear probing; the table is never more than half full, so an empty
+    // slot always ends the search
+    for (unsigned i = hash & (Capacity - 1); Slots[i].Name; i = (i + 1) & (Capacity - 1))
+    {
+        if (Slots[i].Hash == hash)
+        {
+            // Hashes are unique among the interned names, so this is the only
+            // name it can be
+            return (OVR_strcmp(Slots[i].Name, name) == 0) ? &Slots[i] : NULL;
+        }
+    }
+
+    return NULL;
+}
+
+const HMDProperty* HMDPropertyTable::Register(const char* name, HMDPropertyId id, unsigned serviceMask)
+{
+    uint32_t hash = Hash(name);
+
+    unsigned i = hash & (Capacity - 1);
+    for (; Slots[i].Name; i = (i + 1) & (Capacity - 1))
+    {
+        if (Slots[i].Hash != hash)
+            continue;
+
+        if (OVR_strcmp(Slots[i].Name, name) != 0)
+        {
+            OVR_ASSERT_M(false, "HMD property names collide, rename one or change the hash");
+            return NULL;
+        }
+
+        if (id != HMDProperty_None)
+            Slots[i].Id = id;
+        Slots[i].ServiceMask |= serviceMask;
+        return &Slots[i];
+    }
+
+    if ((Count + 1) * 2 > Capacity)
+    {
+        OVR_ASSERT_M(false, "HMD property table is full, raise HMDPropertyTable::Capacity");
+        return NULL;
+    }
+
+    Slots[i].Name        = name;
+    Slots[i].Hash        = hash;
+    Slots[i].Id          = id;
+    Slots[i].ServiceMask = serviceMask;
+    Count++;
+    return &Slots[i];
+}
+
+
+//-------------------------------------------------------------------------------------
+// The names are interned while the library loads, before any HMD exists.
+
+static struct HMDPropertyTableInit
+{
+    HMDPropertyTableInit()
+    {
+        HMDPropertyTable::Register("LensSeparation",                  HMDProperty_LensSeparation, 0);
+        HMDPropertyTable::Register("VsyncToNextVsync",                HMDProperty_VsyncToNextVsync, 0);
+        HMDPropertyTable::Register("PixelPersistence",                HMDProperty_PixelPersistence, 0);
+        HMDPropertyTable::Register("ScreenSize",                      HMDProperty_ScreenSize, 0);
+        HMDPropertyTable::Register("DistortionClearColor",            HMDProperty_DistortionClearColor, 0);
+        HMDPropertyTable::Register("DK2Latency",                      HMDProperty_DK2Latency, 0);
+        HMDPropertyTable::Register(OVR_KEY_DISTORTION_MESH_CACHE_DIR, HMDProperty_DistortionMeshCacheDir, 0);
+
+        for (int e = 0; e < NetSessionCommon::ENumTypes; e++)
+        {
+            const char** names = NetSessionCommon::GetServiceKeyNames((NetSessionCommon::EGetterSetters)e);
+            for (int i = 0; names[i]; i++)
+                HMDPropertyTable::Register(names[i], HMDProperty_None, 1u << e);
+        }
+    }
+} TheHMDPropertyTableInit;
+
+
+}} // namespace OVR::CAPI
@@ -0,0 +1,108 @@
+/************************************************************************************
+
+Filename    :   CAPI_HMDProperties.h
+Content     :   Interned names of the properties HMDState answers
+Created     :   October 19, 2026
+
+Copyright   :   Copyright 2014 Oculus VR, LLC All Rights reserved.
+
+Licensed under the Oculus VR Rift SDK License Version 3.2 (the "License");
+you may not use the Oculus VR Rift SDK except in compliance with the License,
+which is provided at the time of installation or download, or which
+otherwise accompanies this software in either electronic or hard copy form.
+
+You may obtain a copy of the License at
+
+http://www.oculusvr.com/licenses/LICENSE-3.2
+
+Unless required by applicable law or agreed to in writing, the Oculus VR SDK
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+************************************************************************************/
+
+#ifndef OVR_CAPI_HMDProperties_h
+#define OVR_CAPI_HMDProperties_h
+
+#include "../Kernel/OVR_Types.h"
+
+namespace OVR { namespace CAPI {
+
+
+//-------------------------------------------------------------------------------------
+// ***** HMDProperty
+
+// Properties HMDState answers itself instead of passing them to the service
+// or the profile.
+enum HMDPropertyId
+{
+    HMDProperty_None,
+    HMDProperty_LensSeparation,
+    HMDProperty_VsyncToNextVsync,
+    HMDProperty_PixelPersistence,
+    HMDProperty_ScreenSize,
+    HMDProperty_DistortionClearColor,
+    HMDProperty_DK2Latency,
+    HMDProperty_DistortionMeshCacheDir
+};
+
+// A property name interned in HMDPropertyTable.  Interned names are never
+// freed or moved, so a pointer to one is a key that compares by address.
+struct HMDProperty
+{
+    const char*     Name;
+    uint32_t        Hash;
+    HMDPropertyId   Id;
+    unsigned        ServiceMask;    // bit e set if the service handles it for NetSessionCommon::EGetterSetters e
+
+    bool            IsServiceProperty(int getterSetter) const
+    {
+        return (ServiceMask & (1u << getterSetter)) != 0;
+    }
+};
+
+
+//-------------------------------------------------------------------------------------
+// ***** HMDPropertyTable
+
+// Every property name HMDState or the service handles, interned into one flat
+// open-addressing table when the library loads.  Looking up a name hashes it
+// once and usually probes a single slot, confirming with one string compare,
+// instead of comparing it against each name HMDState knows and then each of
+// the service's lists.  A name that isn't in the table is a profile value, or
+// goes to the service through the "server:" prefix.
+//
+// Registration refuses a name whose hash another name already has, so a hash
+// match identifies the one name that could be there.  VS2013 has no
+// constexpr, so the names are hashed by a static initializer rather than by
+// the compiler; nothing looks them up before then.
+class HMDPropertyTable
+{
+public:
+    enum { Capacity = 64 };     // a power of two, kept at most half full
+
+    // FNV-1a
+    static uint32_t             Hash(const char* name);
+
+    // The interned property for name, NULL if there isn't one.
+    static const HMDProperty*   Find(const char* name);
+
+    // Interns name, adding id and serviceMask to what it had if it was there
+    // already.  Fails if the table is full or another name has the same hash.
+    static const HMDProperty*   Register(const char* name, HMDPropertyId id, unsigned serviceMask);
+
+    // For walking every slot; unused slots have a NULL Name.
+    static const HMDProperty&   GetSlot(unsigned index)     { return Slots[index & (Capacity - 1)]; }
+    static unsigned             GetCount()                  { return Count; }
+
+private:
+    static HMDProperty          Slots[Capacity];
+    static unsigned             Count;
+};
+
+
+}} // namespace OVR::CAPI
+
+#endif // OVR_CAPI_HMDProperties_h
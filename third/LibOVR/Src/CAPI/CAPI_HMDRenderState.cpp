@@ -124,6 +124,13 @@ ovrSizei HMDRenderState::GetFOVTextureSize(int eye, ovrFovPort fov, float pixels
     return CalculateIdealPixelSize(seye, Distortion[eye], fov, pixelsPerDisplayPixel);
 }
 
+ovrFovPort HMDRenderState::GetLensFov(int eye) const
+{
+    OVR_ASSERT((unsigned)eye < 2);
+    StereoEye seye = (eye == ovrEye_Left) ? StereoEye_Left : StereoEye_Right;
+    return CalculateLensFovFromHmdInfo(seye, RenderInfo, OVR_DEFAULT_EXTRA_EYE_ROTATION);
+}
+
 ovrEyeRenderDesc HMDRenderState::CalcRenderDesc(ovrEyeType eyeType, const ovrFovPort& fov) const
 {    
     const HmdRenderInfo&   hmdri = RenderInfo;
@@ -49,6 +49,7 @@ struct HMDRenderState
     // Utility query functions.
     ovrHmdDesc          GetDesc() const;
     ovrSizei            GetFOVTextureSize(int eye, ovrFovPort fov, float pixelsPerDisplayPixel) const;
+    ovrFovPort          GetLensFov(int eye) const;
     ovrEyeRenderDesc    CalcRenderDesc(ovrEyeType eyeType, const ovrFovPort& fov) const;
 
     HMDInfo                 OurHMDInfo;
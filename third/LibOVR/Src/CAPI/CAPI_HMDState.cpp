@@ -25,6 +25,7 @@ limitations under the License.
 ************************************************************************************/
 
 #include "CAPI_HMDState.h"
+#include "CAPI_HMDProperties.h"
 #include "../OVR_Profile.h"
 #include "../Service/Service_NetClient.h"
 #ifdef OVR_OS_WIN32
@@ -421,9 +422,24 @@ unsigned HMDState::SetEnabledHmdCaps()
 // need to keep a white-list of keys.  This is also way cool because it allows us to add
 // new settings keys from outside CAPI that can modify internal server data.
 
+// Same as NetSessionCommon::IsServiceProperty, with the white-list already looked
+// up in HMDPropertyTable.
+static bool IsServiceProperty(NetSessionCommon::EGetterSetters e, const char* propertyName,
+                              const HMDProperty* property)
+{
+    return property ? property->IsServiceProperty(e) : NetSessionCommon::HasBypassPrefix(propertyName);
+}
+
+static HMDPropertyId GetPropertyId(const HMDProperty* property)
+{
+    return property ? property->Id : HMDProperty_None;
+}
+
 bool HMDState::getBoolValue(const char* propertyName, bool defaultVal)
 {
-    if (NetSessionCommon::IsServiceProperty(NetSessionCommon::EGetBoolValue, propertyName))
+    const HMDProperty* property = HMDPropertyTable::Find(propertyName);
+
+    if (IsServiceProperty(NetSessionCommon::EGetBoolValue, propertyName, property))
     {
        return NetClient::GetInstance()->GetBoolValue(GetNetId(), propertyName, defaultVal);
     }
@@ -436,7 +452,9 @@ bool HMDState::getBoolValue(const char* propertyName, bool defaultVal)
 
 bool HMDState::setBoolValue(const char* propertyName, bool value)
 {
-	if (NetSessionCommon::IsServiceProperty(NetSessionCommon::ESetBoolValue, propertyName))
+    const HMDProperty* property = HMDPropertyTable::Find(propertyName);
+
+	if (IsServiceProperty(NetSessionCommon::ESetBoolValue, propertyName, property))
 	{
 		return NetClient::GetInstance()->SetBoolValue(GetNetId(), propertyName, value);
 	}
@@ -446,7 +464,9 @@ bool HMDState::setBoolValue(const char* propertyName, bool value)
 
 int HMDState::getIntValue(const char* propertyName, int defaultVal)
 {
-    if (NetSessionCommon::IsServiceProperty(NetSessionCommon::EGetIntValue, propertyName))
+    const HMDProperty* property = HMDPropertyTable::Find(propertyName);
+
+    if (IsServiceProperty(NetSessionCommon::EGetIntValue, propertyName, property))
     {
         return NetClient::GetInstance()->GetIntValue(GetNetId(), propertyName, defaultVal);
     }
@@ -459,7 +479,9 @@ int HMDState::getIntValue(const char* propertyName, int defaultVal)
 
 bool HMDState::setIntValue(const char* propertyName, int value)
 {
-	if (NetSessionCommon::IsServiceProperty(NetSessionCommon::ESetIntValue, propertyName))
+    const HMDProperty* property = HMDPropertyTable::Find(propertyName);
+
+	if (IsServiceProperty(NetSessionCommon::ESetIntValue, propertyName, property))
 	{
 		return NetClient::GetInstance()->SetIntValue(GetNetId(), propertyName, value);
 	}
@@ -469,19 +491,22 @@ bool HMDState::setIntValue(const char* propertyName, int value)
 
 float HMDState::getFloatValue(const char* propertyName, float defaultVal)
 {
-    if (OVR_strcmp(propertyName, "LensSeparation") == 0)
+    const HMDProperty* property = HMDPropertyTable::Find(propertyName);
+    HMDPropertyId      id = GetPropertyId(property);
+
+    if (id == HMDProperty_LensSeparation)
     {
         return OurHMDInfo.LensSeparationInMeters;
     }
-    else if (OVR_strcmp(propertyName, "VsyncToNextVsync") == 0) 
+    else if (id == HMDProperty_VsyncToNextVsync) 
     {
         return OurHMDInfo.Shutter.VsyncToNextVsync;
     }
-    else if (OVR_strcmp(propertyName, "PixelPersistence") == 0) 
+    else if (id == HMDProperty_PixelPersistence) 
     {
         return OurHMDInfo.Shutter.PixelPersistence;
     }
-    else if (NetSessionCommon::IsServiceProperty(NetSessionCommon::EGetNumberValue, propertyName))
+    else if (IsServiceProperty(NetSessionCommon::EGetNumberValue, propertyName, property))
     {
        return (float)NetClient::GetInstance()->GetNumberValue(GetNetId(), propertyName, defaultVal);
     }
@@ -495,7 +520,9 @@ float HMDState::getFloatValue(const char* propertyName, float defaultVal)
 
 bool HMDState::setFloatValue(const char* propertyName, float value)
 {
-	if (NetSessionCommon::IsServiceProperty(NetSessionCommon::ESetNumberValue, propertyName))
+    const HMDProperty* property = HMDPropertyTable::Find(propertyName);
+
+	if (IsServiceProperty(NetSessionCommon::ESetNumberValue, propertyName, property))
 	{
 		return NetClient::GetInstance()->SetNumberValue(GetNetId(), propertyName, value);
 	}
@@ -513,20 +540,27 @@ static unsigned CopyFloatArrayWithLimit(float dest[], unsigned destSize,
 }
 
 unsigned HMDState::getFloatArray(const char* propertyName, float values[], unsigned arraySize)
+{
+    return getFloatArray(HMDPropertyTable::Find(propertyName), propertyName, values, arraySize);
+}
+
+unsigned HMDState::getFloatArray(const HMDProperty* property, const char* propertyName, float values[], unsigned arraySize)
 {
 	if (arraySize)
 	{
-		if (OVR_strcmp(propertyName, "ScreenSize") == 0)
+        HMDPropertyId      id = GetPropertyId(property);
+
+		if (id == HMDProperty_ScreenSize)
 		{
 			float data[2] = { OurHMDInfo.ScreenSizeInMeters.w, OurHMDInfo.ScreenSizeInMeters.h };
 
             return CopyFloatArrayWithLimit(values, arraySize, data, 2);
 		}
-        else if (OVR_strcmp(propertyName, "DistortionClearColor") == 0)
+        else if (id == HMDProperty_DistortionClearColor)
         {
             return CopyFloatArrayWithLimit(values, arraySize, RenderState.ClearColor, 4);
         }
-        else if (OVR_strcmp(propertyName, "DK2Latency") == 0)
+        else if (id == HMDProperty_DK2Latency)
         {
             if (OurHMDInfo.HmdType != HmdType_DK2)
             {
@@ -546,7 +580,7 @@ unsigned HMDState::getFloatArray(const char* propertyName, float values[], unsig
 
             return CopyFloatArrayWithLimit(values, arraySize, m.data, 3);
         }
-        else if (NetSessionCommon::IsServiceProperty(NetSessionCommon::EGetNumberValues, propertyName))
+        else if (IsServiceProperty(NetSessionCommon::EGetNumberValues, propertyName, property))
         {
             // Convert floats to doubles
             double* da = new double[arraySize];
@@ -585,13 +619,15 @@ bool HMDState::setFloatArray(const char* propertyName, float values[], unsigned
         return false;
     }
     
-    if (OVR_strcmp(propertyName, "DistortionClearColor") == 0)
+    const HMDProperty* property = HMDPropertyTable::Find(propertyName);
+
+    if (GetPropertyId(property) == HMDProperty_DistortionClearColor)
     {
         CopyFloatArrayWithLimit(RenderState.ClearColor, 4, values, arraySize);
         return true;
     }
 
-	if (NetSessionCommon::IsServiceProperty(NetSessionCommon::ESetNumberValues, propertyName))
+	if (IsServiceProperty(NetSessionCommon::ESetNumberValues, propertyName, property))
 	{
 		double* da = new double[arraySize];
 		for (int i = 0; i < (int)arraySize; ++i)
@@ -611,7 +647,14 @@ bool HMDState::setFloatArray(const char* propertyName, float values[], unsigned
 
 const char* HMDState::getString(const char* propertyName, const char* defaultVal)
 {
-    if (NetSessionCommon::IsServiceProperty(NetSessionCommon::EGetStringValue, propertyName))
+    const HMDProperty* property = HMDPropertyTable::Find(propertyName);
+
+    if (GetPropertyId(property) == HMDProperty_DistortionMeshCacheDir)
+    {
+        return DistortionMeshCacheDir.IsEmpty() ? defaultVal : DistortionMeshCacheDir.ToCStr();
+    }
+
+    if (IsServiceProperty(NetSessionCommon::EGetStringValue, propertyName, property))
     {
         return NetClient::GetInstance()->GetStringValue(GetNetId(), propertyName, defaultVal);
     }
@@ -630,7 +673,15 @@ const char* HMDState::getString(const char* propertyName, const char* defaultVal
 
 bool HMDState::setString(const char* propertyName, const char* value)
 {
-	if (NetSessionCommon::IsServiceProperty(NetSessionCommon::ESetStringValue, propertyName))
+    const HMDProperty* property = HMDPropertyTable::Find(propertyName);
+
+    if (GetPropertyId(property) == HMDProperty_DistortionMeshCacheDir)
+    {
+        DistortionMeshCacheDir = value ? value : "";
+        return true;
+    }
+
+	if (IsServiceProperty(NetSessionCommon::ESetStringValue, propertyName, property))
 	{
 		return NetClient::GetInstance()->SetStringValue(GetNetId(), propertyName, value);
 	}
@@ -794,11 +845,12 @@ ovrBool ovrHmd_CreateDistortionMeshInternal( ovrHmdStruct *  hmd,
     int triangleCount = 0;
     int vertexCount = 0;
 
-    DistortionMeshCreate((DistortionMeshVertexData**)&meshData->pVertexData,
-                         (uint16_t**)&meshData->pIndexData,
-                          &vertexCount, &triangleCount,
-                          (stereoEye == StereoEye_Right),
-                          hmdri, distortion, eyeToSourceNDC);
+    DistortionMeshCreateCached((DistortionMeshVertexData**)&meshData->pVertexData,
+                               (uint16_t**)&meshData->pIndexData,
+                                &vertexCount, &triangleCount,
+                                (stereoEye == StereoEye_Right),
+                                hmdri, distortion, eyeToSourceNDC,
+                                hmds->DistortionMeshCacheDir.ToCStr());
 
     if (meshData->pVertexData)
     {
@@ -812,5 +864,38 @@ ovrBool ovrHmd_CreateDistortionMeshInternal( ovrHmdStruct *  hmd,
 }
 
 
+void ovrHmd_DistortEyeImagesOnCpuInternal( ovrHmdStruct * hmd, const ovrFovPort eyeFov[2],
+                                           const unsigned char* const eyeImages[2], const ovrSizei eyeImageSizes[2],
+                                           unsigned int distortionCaps, ovrBool linearFilter,
+                                           unsigned char* frame )
+{
+    HMDState* hmds = (HMDState*)hmd;
+    const HmdRenderInfo& hmdri = hmds->RenderState.RenderInfo;
+
+    for (int eyeNum = 0; eyeNum < 2; eyeNum++)
+    {
+        Sizei                 eyeImageSize(eyeImageSizes[eyeNum].w, eyeImageSizes[eyeNum].h);
+        ScaleAndOffset2D      eyeToSourceNDC = CreateNDCScaleAndOffsetFromFov(eyeFov[eyeNum]);
+        ScaleAndOffset2D      eyeToSourceUV  = CreateUVScaleAndOffsetfromNDCScaleandOffset(
+                                                   eyeToSourceNDC, Recti(Vector2i(0), eyeImageSize), eyeImageSize);
+
+        // The GL renderer's convention: unflipped eye images have their first row at the bottom.
+        if (!(distortionCaps & ovrDistortionCap_FlipInput))
+        {
+            eyeToSourceUV.Scale.y  = -eyeToSourceUV.Scale.y;
+            eyeToSourceUV.Offset.y = 1.0f - eyeToSourceUV.Offset.y;
+        }
+
+        DistortionRenderCpu(frame, hmdri.ResolutionInPixels,
+                            eyeImages[eyeNum], eyeImageSize,
+                            (eyeNum == ovrEye_Right), hmdri, hmds->RenderState.Distortion[eyeNum],
+                            eyeToSourceNDC, eyeToSourceUV,
+                            (distortionCaps & ovrDistortionCap_Chromatic) != 0,
+                            (distortionCaps & ovrDistortionCap_Vignette) != 0,
+                            linearFilter != 0);
+    }
+}
+
+
 
 }} // namespace OVR::CAPI
@@ -46,6 +46,8 @@ struct ovrHmdStruct { };
 
 namespace OVR { namespace CAPI {
 
+struct HMDProperty;
+
 
 using namespace OVR::Util::Render;
 using namespace OVR::Service;
@@ -210,6 +212,8 @@ public:
     float    getFloatValue(const char* propertyName, float defaultVal);
     bool     setFloatValue(const char* propertyName, float value);
 	unsigned getFloatArray(const char* propertyName, float values[], unsigned arraySize);
+    // property is propertyName looked up in HMDPropertyTable already, NULL if it isn't there.
+    unsigned getFloatArray(const HMDProperty* property, const char* propertyName, float values[], unsigned arraySize);
     bool     setFloatArray(const char* propertyName, float values[], unsigned arraySize);
     const char* getString(const char* propertyName, const char* defaultVal);
     bool        setString(const char* propertyName, const char* value);
@@ -272,6 +276,9 @@ public:
 
     // Last cached value returned by ovrHmd_GetString/ovrHmd_GetStringArray.
     char                    LastGetStringValue[256];
+
+    // Folder distortion meshes are cached in, empty to always rebuild them.
+    String                  DistortionMeshCacheDir;
    
     // Debug flag set after ovrHmd_ConfigureRendering succeeds.
     bool                    RenderingConfigured;
@@ -296,6 +303,11 @@ ovrBool ovrHmd_CreateDistortionMeshInternal( ovrHmdStruct *  hmd,
                                              ovrDistortionMesh *meshData,
 											 float overrideEyeReliefIfNonZero=0 );
 
+void ovrHmd_DistortEyeImagesOnCpuInternal( ovrHmdStruct * hmd, const ovrFovPort eyeFov[2],
+                                           const unsigned char* const eyeImages[2], const ovrSizei eyeImageSizes[2],
+                                           unsigned int distortionCaps, ovrBool linearFilter,
+                                           unsigned char* frame );
+
 
 
 
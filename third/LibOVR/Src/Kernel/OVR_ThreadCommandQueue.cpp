@@ -26,119 +26,124 @@ limitations under the License.
 
 #include "OVR_ThreadCommandQueue.h"
 
+#if defined(OVR_OS_LINUX)
+#include <errno.h>
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <time.h>
+#include <unistd.h>
+#endif
+
 namespace OVR {
 
 
 //------------------------------------------------------------------------
-// ***** CircularBuffer
-
-// CircularBuffer is a FIFO buffer implemented in a single block of memory,
-// which allows writing and reading variable-size data chucks. Write fails
-// if buffer is full.
-
-class CircularBuffer
+// ***** WakeWord
+
+// WakeWord puts threads to sleep until another thread changes a condition
+// they are waiting on, without the changing thread paying for a lock or a
+// system call when nobody is asleep. A waiter calls PrepareWait, re-checks
+// its condition, then either gives up or calls CommitWait with the key it
+// got. The thread that makes the condition true calls NotifyAll afterwards.
+//
+// The low bit of the word is set by waiters and cleared by the NotifyAll
+// that wakes them, which also moves the word on so a waiter that has yet to
+// sleep doesn't. Only the first NotifyAll after a thread starts waiting does
+// any more than read the word.
+//
+// On Linux waiters sleep on a futex on the word itself. Elsewhere they use a
+// wait condition, whose mutex is only taken when someone is asleep.
+
+class WakeWord
 {
     enum {
-        AlignSize = 16,
-        AlignMask = AlignSize - 1
+        WaitingBit = 1,
+        WordStep   = 2
     };
 
-    uint8_t*  pBuffer;
-    size_t  Size;
-    size_t  Tail;   // Byte offset of next item to be popped.
-    size_t  Head;   // Byte offset of where next push will take place.
-    size_t  End;    // When Head < Tail, this is used instead of Size.    
-
-    inline size_t roundUpSize(size_t size)
-    { return (size + AlignMask) & ~(size_t)AlignMask; }
+    AtomicInt<uint32_t> Word;
+#if !defined(OVR_OS_LINUX)
+    Mutex               WaitMutex;
+    WaitCondition       WaitCond;
+#endif
 
 public:
+    WakeWord() : Word(0) { }
 
-    CircularBuffer(size_t size)
-        : Size(size), Tail(0), Head(0), End(0)
+    uint32_t PrepareWait()
     {
-        pBuffer = (uint8_t*)OVR_ALLOC_ALIGNED(roundUpSize(size), AlignSize);
-    }
-    ~CircularBuffer()
-    {
-        // For ThreadCommands, we must consume everything before shutdown.
-        OVR_ASSERT(IsEmpty());
-        OVR_FREE_ALIGNED(pBuffer);
+        // The compare-and-set is a full barrier, so either the caller's
+        // re-check sees the condition or the NotifyAll after it sees the bit.
+        for (;;)
+        {
+            uint32_t word = Word.Load_Acquire();
+            if ((word & WaitingBit) || Word.CompareAndSet_Sync(word, word | WaitingBit))
+                return word | WaitingBit;
+        }
     }
 
-    bool    IsEmpty() const { return (Head == Tail); }
+    // Sleeps unless the word has moved on from key; may return spuriously.
+    void CommitWait(uint32_t key, unsigned delay);
 
-    // Allocates a state block of specified size and advances pointers,
-    // returning 0 if buffer is full.
-    uint8_t*  Write(size_t size);
+    void NotifyAll()
+    {
+        for (;;)
+        {
+            uint32_t word = Word.Load_Acquire();
+            if (!(word & WaitingBit))
+                return;
+            if (Word.CompareAndSet_Sync(word, (word & ~(uint32_t)WaitingBit) + WordStep))
+                break;
+        }
+        wakeAll();
+    }
 
-    // Returns a pointer to next available data block; 0 if none available.
-    uint8_t*  ReadBegin()
-    { return (Head != Tail) ? (pBuffer + Tail) : 0; }
-    // Consumes data of specified size; this must match size passed to Write.
-    void    ReadEnd(size_t size);
+private:
+    void wakeAll();
 };
 
+#if defined(OVR_OS_LINUX)
 
-// Allocates a state block of specified size and advances pointers,
-// returning 0 if buffer is full.
-uint8_t* CircularBuffer::Write(size_t size)
+void WakeWord::CommitWait(uint32_t key, unsigned delay)
 {
-    uint8_t* p = 0;
-
-    size = roundUpSize(size);
-    // Since this is circular buffer, always allow at least one item.
-    OVR_ASSERT(size < Size/2);
-
-    if (Head >= Tail)
+    timespec  timeout;
+    timespec* ptimeout = 0;
+    if (delay != OVR_WAIT_INFINITE)
     {
-        OVR_ASSERT(End == 0);
-        
-        if (size <= (Size - Head))
-        {
-            p    = pBuffer + Head;
-            Head += size;
-        }
-        else if (size < Tail)
-        {
-            p    = pBuffer;
-            End  = Head;
-            Head = size;
-            OVR_ASSERT(Head != Tail);
-        }
+        timeout.tv_sec  = delay / 1000;
+        timeout.tv_nsec = (delay % 1000) * 1000000;
+        ptimeout        = &timeout;
     }
-    else
-    {
-        OVR_ASSERT(End != 0);
 
-        if ((Tail - Head) > size)
-        {
-            p    = pBuffer + Head;
-            Head += size;
-            OVR_ASSERT(Head != Tail);
-        }
-    }
+    // The kernel re-reads the word before sleeping, so a NotifyAll between
+    // PrepareWait and here just makes this return at once.
+    syscall(SYS_futex, (int*)&Word.Value, FUTEX_WAIT_PRIVATE, (int)key, ptimeout, 0, 0);
+}
 
-    return p;
+void WakeWord::wakeAll()
+{
+    syscall(SYS_futex, (int*)&Word.Value, FUTEX_WAKE_PRIVATE, INT_MAX, 0, 0, 0);
 }
 
-void CircularBuffer::ReadEnd(size_t size)
+#else
+
+void WakeWord::CommitWait(uint32_t key, unsigned delay)
 {
-    OVR_ASSERT(Head != Tail);
-    size = roundUpSize(size);
-    
-    Tail += size;        
-    if (Tail == End)
-    {
-        Tail = End = 0;
-    }
-    else if (Tail == Head)
-    {        
-        OVR_ASSERT(End == 0);
-        Tail = Head = 0;
-    }
+    Mutex::Locker lock(&WaitMutex);
+    if (Word.Load_Acquire() == key)
+        WaitCond.Wait(&WaitMutex, delay);
 }
 
+void WakeWord::wakeAll()
+{
+    // A waiter holds the mutex from checking the word until it is inside
+    // Wait, so taking it here orders the notify after the wait began.
+    Mutex::Locker lock(&WaitMutex);
+    WaitCond.NotifyAll();
+}
+
+#endif
+
 
 //-------------------------------------------------------------------------------------
 // ***** ThreadCommand
@@ -178,22 +183,17 @@ class ThreadCommandQueueImpl : public NewOverrideBase
 {
     typedef ThreadCommand::NotifyEvent NotifyEvent;
     friend class ThreadCommandQueue;
+    friend class ThreadCommand::NotifyEvent;
     
 public:
 
-    ThreadCommandQueueImpl(ThreadCommandQueue* queue) :
-		pQueue(queue),
-		ExitEnqueued(false),
-		ExitProcessed(false),
-		CommandBuffer(2048),
-		PullThreadId(0)
-    {
-    }
+    ThreadCommandQueueImpl(ThreadCommandQueue* queue);
     ~ThreadCommandQueueImpl();
 
 
     bool PushCommand(const ThreadCommand& command);
     bool PopCommand(ThreadCommand::PopBuffer* popBuffer);
+    bool WaitForCommand(unsigned delay);
 
 
     // ExitCommand is used by notify us that Thread is shutting down.
@@ -206,47 +206,80 @@ public:
 
         virtual void Execute() const
         {
-            Lock::Locker lock(&pImpl->QueueLock);
-            pImpl->ExitProcessed = true;
+            pImpl->ExitProcessed.Store_Release(1);
         }
         virtual ThreadCommand* CopyConstruct(void* p) const 
         { return Construct<ExitCommand>(p, *this); }
     };
 
+private:
+
+    // The ring is Capacity slots, each holding one command in place. Positions
+    // count up by 2 and wrap; the low bit of EnqueuePos is set by the exit
+    // command's claim, closing the queue in the same compare-and-set.
+    //
+    // A slot's Sequence says whose turn it is: equal to a position when the
+    // producer claiming that position may write it, position + 2 once the
+    // command is published, and position + 2 * Capacity once the consumer is
+    // done with it, making it the next lap's. Wrapping is harmless as long as
+    // positions are only compared by their signed difference.
+    enum {
+        Capacity            = 64,
+        CapacityMask        = Capacity - 1,
+        ProducerWakeBatch   = Capacity / 4,
+        PositionStep        = 2,
+        ClosedBit           = 1,
+        SlotAlignSize       = 16,
+        CacheLineSize       = 64
+    };
 
-    NotifyEvent* AllocNotifyEvent_NTS()
+    struct Slot
     {
-        NotifyEvent* p = AvailableEvents.GetFirst();
-
-        if (!AvailableEvents.IsNull(p))
-            p->RemoveNode();        
-        else
-            p = new NotifyEvent;
-        return p;
-    }
+        uint8_t             Buffer[ThreadCommand::MaxCommandSize];
+        AtomicInt<uint32_t> Sequence;
+        uint8_t             Pad[SlotAlignSize - sizeof(uint32_t)];
+    };
 
-    void         FreeNotifyEvent_NTS(NotifyEvent* p)
+    enum ClaimResult
     {
-        AvailableEvents.PushBack(p);
-    }
+        Claim_Ok,
+        Claim_Full,
+        Claim_Closed
+    };
 
-    void        FreeNotifyEvents_NTS()
-    {
-        while(!AvailableEvents.IsEmpty())
-        {
-            NotifyEvent* p = AvailableEvents.GetFirst();
-            p->RemoveNode();
-            delete p;
-        }
-    }
+    Slot* getSlot(uint32_t pos) const
+    { return &pSlots[(pos / PositionStep) & CapacityMask]; }
+
+    static int32_t positionDiff(uint32_t a, uint32_t b)
+    { return (int32_t)(a - b); }
+
+    ClaimResult claimSlot(bool exitFlag, uint32_t* ppos);
+    bool        isFull() const;
+    bool        isCommandReady() const;
+    void        notifyConsumer();
 
     ThreadCommandQueue* pQueue;
-    Lock                QueueLock;
-    volatile bool       ExitEnqueued;
-    volatile bool       ExitProcessed;
-    List<NotifyEvent>   AvailableEvents;
-    List<NotifyEvent>   BlockedProducers;
-    CircularBuffer      CommandBuffer;
+    Slot*               pSlots;
+
+    // Producers only; kept off the consumer's cache line.
+    AtomicInt<uint32_t> EnqueuePos;
+    uint8_t             EnqueuePad[CacheLineSize];
+
+    // Consumer only.
+    uint32_t            DequeuePos;
+    uint8_t             DequeuePad[CacheLineSize];
+
+    // Set by a consumer that found the queue empty, and cleared by the first
+    // producer to notice. NotifyLock is only taken on those two transitions,
+    // which is what the OnPopEmpty/OnPushNonEmpty hooks are called under.
+    AtomicInt<uint32_t> ConsumerIdle;
+    Lock                NotifyLock;
+
+    WakeWord            ConsumerWake;       // WaitForCommand
+    WakeWord            ProducerWake;       // Producers blocked on a full ring
+    WakeWord            CompletionWake;     // PushCallAndWait callers
+
+    AtomicInt<uint32_t> ExitProcessed;
 
 	// The pull thread id is set to the last thread that pulled commands.
 	// Since this thread command queue is designed for a single thread,
@@ -256,71 +289,130 @@ public:
 	OVR::ThreadId		PullThreadId;
 };
 
+ThreadCommandQueueImpl::ThreadCommandQueueImpl(ThreadCommandQueue* queue) :
+    pQueue(queue),
+    pSlots(0),
+    EnqueuePos(0),
+    DequeuePos(0),
+    ConsumerIdle(0),
+    ExitProcessed(0),
+    PullThreadId(0)
+{
+    OVR_COMPILER_ASSERT((sizeof(Slot) % SlotAlignSize) == 0);
+
+    pSlots = (Slot*)OVR_ALLOC_ALIGNED(sizeof(Slot) * Capacity, SlotAlignSize);
+    for (uint32_t i = 0; i < Capacity; i++)
+    {
+        Construct<Slot>(&pSlots[i]);
+        pSlots[i].Sequence.Store_Release(i * PositionStep);
+    }
+}
+
 ThreadCommandQueueImpl::~ThreadCommandQueueImpl()
 {
-    Lock::Locker lock(&QueueLock);
-    OVR_ASSERT(BlockedProducers.IsEmpty());
-    FreeNotifyEvents_NTS();
+    // For ThreadCommands, we must consume everything before shutdown.
+    OVR_ASSERT(!isCommandReady());
+    OVR_FREE_ALIGNED(pSlots);
 }
 
-bool ThreadCommandQueueImpl::PushCommand(const ThreadCommand& command)
+// Claims the slot at the end of the ring, storing its position in *ppos.
+ThreadCommandQueueImpl::ClaimResult ThreadCommandQueueImpl::claimSlot(bool exitFlag, uint32_t* ppos)
 {
-	if (command.NeedsWait() && PullThreadId == OVR::GetCurrentThreadId())
-	{
-		command.Execute();
-		return true;
-	}
+    uint32_t pos = EnqueuePos.Load_Acquire();
 
-    ThreadCommand::NotifyEvent* completeEvent = 0;
-    ThreadCommand::NotifyEvent* queueAvailableEvent = 0;
+    for (;;)
+    {
+        // Don't allow any commands after PushExitCommand() is called.
+        if (pos & ClosedBit)
+            return Claim_Closed;
 
-    // Repeat  writing command into buffer until it is available.    
-	for (;;) {
-        { // Lock Scope
-            Lock::Locker lock(&QueueLock);
+        int32_t diff = positionDiff(getSlot(pos)->Sequence.Load_Acquire(), pos);
+        if (diff < 0)
+            return Claim_Full;
 
-            if (queueAvailableEvent) {
-                FreeNotifyEvent_NTS(queueAvailableEvent);
-                queueAvailableEvent = 0;
+        if (diff == 0)
+        {
+            uint32_t next = (pos + PositionStep) | (exitFlag ? (uint32_t)ClosedBit : 0);
+            if (EnqueuePos.CompareAndSet_Sync(pos, next))
+            {
+                *ppos = pos;
+                return Claim_Ok;
             }
+        }
 
-            // Don't allow any commands after PushExitCommand() is called.
-			if (ExitEnqueued && !command.ExitFlag) {
-				return false;
-			}
-
-            bool bufferWasEmpty = CommandBuffer.IsEmpty();
-            uint8_t* buffer = CommandBuffer.Write(command.GetSize());
+        // Another producer got there first.
+        pos = EnqueuePos.Load_Acquire();
+    }
+}
 
-			if (buffer) {
-                ThreadCommand* c = command.CopyConstruct(buffer);
+bool ThreadCommandQueueImpl::isFull() const
+{
+    uint32_t pos = EnqueuePos.Load_Acquire();
+    return !(pos & ClosedBit) &&
+           positionDiff(getSlot(pos)->Sequence.Load_Acquire(), pos) < 0;
+}
 
-				if (c->NeedsWait()) {
-					completeEvent = c->pEvent = AllocNotifyEvent_NTS();
-				}
+bool ThreadCommandQueueImpl::isCommandReady() const
+{
+    return getSlot(DequeuePos)->Sequence.Load_Acquire() == DequeuePos + PositionStep;
+}
 
-				// Signal-waker consumer when we add data to buffer.
-				if (bufferWasEmpty) {
-					pQueue->OnPushNonEmpty_Locked();
-				}
+void ThreadCommandQueueImpl::notifyConsumer()
+{
+    // The publish before this was a full barrier, so either this sees the
+    // consumer's idle flag or the consumer's re-check sees the command.
+    if (ConsumerIdle.Load_Acquire() != 0)
+    {
+        Lock::Locker lock(&NotifyLock);
+        if (ConsumerIdle.Exchange_NoSync(0) != 0) {
+            pQueue->OnPushNonEmpty_Locked();
+        }
+    }
+    ConsumerWake.NotifyAll();
+}
 
-				break;
-            }
+bool ThreadCommandQueueImpl::PushCommand(const ThreadCommand& command)
+{
+	if (command.NeedsWait() && PullThreadId == OVR::GetCurrentThreadId())
+	{
+		command.Execute();
+		return true;
+	}
 
-            queueAvailableEvent = AllocNotifyEvent_NTS();
-            BlockedProducers.PushBack(queueAvailableEvent);
-        } // Lock Scope
+    OVR_ASSERT(command.GetSize() <= ThreadCommand::MaxCommandSize);
 
-        queueAvailableEvent->Wait();
+    // Repeat claiming a slot until one is available.    
+    uint32_t pos = 0;
+	for (;;) {
+        ClaimResult result = claimSlot(command.ExitFlag, &pos);
+        if (result == Claim_Ok)
+            break;
+        if (result == Claim_Closed)
+            return false;
+
+        uint32_t key = ProducerWake.PrepareWait();
+        if (isFull())
+            ProducerWake.CommitWait(key, OVR_WAIT_INFINITE);
     } // Intentional infinite loop
 
-    // Command was enqueued, wait if necessary.
-    if (completeEvent) {
-        completeEvent->Wait();
-        Lock::Locker lock(&QueueLock);
-        FreeNotifyEvent_NTS(completeEvent);
+    // Once published the consumer may run and pop the command at any time,
+    // so everything needed afterwards is taken from the caller's copy.
+    bool        needsWait = command.NeedsWait();
+    NotifyEvent completeEvent(this);
+
+    Slot*          slot = getSlot(pos);
+    ThreadCommand* c    = command.CopyConstruct(slot->Buffer);
+    if (needsWait) {
+        c->pEvent = &completeEvent;
     }
+    slot->Sequence.Exchange_Sync(pos + PositionStep);
+
+    notifyConsumer();
 
+    // Command was enqueued, wait if necessary.
+    if (needsWait) {
+        completeEvent.Wait();
+    }
     return true;
 }
 
@@ -330,29 +422,72 @@ bool ThreadCommandQueueImpl::PopCommand(ThreadCommand::PopBuffer* popBuffer)
 {    
 	PullThreadId = OVR::GetCurrentThreadId();
 
-	Lock::Locker lock(&QueueLock);
-
-    uint8_t* buffer = CommandBuffer.ReadBegin();
-    if (!buffer)
+    if (!isCommandReady())
     {
-        // Notify thread while in lock scope, enabling initialization of wait.
-        pQueue->OnPopEmpty_Locked();
-        return false;
+        Lock::Locker lock(&NotifyLock);
+
+        // Going idle before the re-check pairs with notifyConsumer, so a
+        // command published in between is either seen here or notified.
+        ConsumerIdle.Exchange_Sync(1);
+        if (!isCommandReady())
+        {
+            // Notify thread while in lock scope, enabling initialization of wait.
+            pQueue->OnPopEmpty_Locked();
+            return false;
+        }
+        ConsumerIdle.Exchange_NoSync(0);
     }
 
-    popBuffer->InitFromBuffer(buffer);
-    CommandBuffer.ReadEnd(popBuffer->GetSize());
+    Slot* slot = getSlot(DequeuePos);
+    popBuffer->InitFromBuffer(slot->Buffer);
 
-    if (!BlockedProducers.IsEmpty())
-    {
-        ThreadCommand::NotifyEvent* queueAvailableEvent = BlockedProducers.GetFirst();
-        queueAvailableEvent->RemoveNode();
-        queueAvailableEvent->PulseEvent();
-        // Event is freed later by waiter.
-    }    
+    // The command now lives in popBuffer; hand the slot to the next lap.
+    slot->Sequence.Exchange_Sync(DequeuePos + PositionStep * Capacity);
+    DequeuePos += PositionStep;
+
+    // Producers blocked on a full ring are let go a batch of slots at a time,
+    // rather than each waking to fill one slot and sleep again, and whenever
+    // the ring runs dry (which also frees any that lost to the exit command).
+    if (((DequeuePos / PositionStep) & (ProducerWakeBatch - 1)) == 0 || !isCommandReady())
+        ProducerWake.NotifyAll();
     return true;
 }
 
+bool ThreadCommandQueueImpl::WaitForCommand(unsigned delay)
+{
+    if (isCommandReady())
+        return true;
+
+    uint32_t key = ConsumerWake.PrepareWait();
+    if (isCommandReady())
+        return true;
+    ConsumerWake.CommitWait(key, delay);
+    return isCommandReady();
+}
+
+
+//-------------------------------------------------------------------------------------
+
+void ThreadCommand::NotifyEvent::Wait()
+{
+    while (Done.Load_Acquire() == 0)
+    {
+        WakeWord& wake = pQueueImpl->CompletionWake;
+        uint32_t  key  = wake.PrepareWait();
+        if (Done.Load_Acquire() == 0)
+            wake.CommitWait(key, OVR_WAIT_INFINITE);
+    }
+}
+
+void ThreadCommand::NotifyEvent::PulseEvent()
+{
+    // The waiter may return, and this event go out of scope, as soon as Done
+    // is set, so the queue is looked up first.
+    ThreadCommandQueueImpl* queueImpl = pQueueImpl;
+    Done.Exchange_Sync(1);
+    queueImpl->CompletionWake.NotifyAll();
+}
+
 
 //-------------------------------------------------------------------------------------
 
@@ -375,26 +510,25 @@ bool ThreadCommandQueue::PopCommand(ThreadCommand::PopBuffer* popBuffer)
     return pImpl->PopCommand(popBuffer);
 }
 
+bool ThreadCommandQueue::WaitForCommand(unsigned delay)
+{
+    return pImpl->WaitForCommand(delay);
+}
+
 void ThreadCommandQueue::PushExitCommand(bool wait)
 {
     // Exit is processed in two stages:
-    //  - First, ExitEnqueued flag is set to block further commands from queuing up.
+    //  - First, claiming the exit command's slot closes the queue, so no
+    //    further commands queue up behind it. A second exit is refused too.
     //  - Second, the actual exit call is processed on the consumer thread, flushing
     //    any prior commands.
     //    IsExiting() only returns true after exit has flushed.
-    {
-        Lock::Locker lock(&pImpl->QueueLock);
-        if (pImpl->ExitEnqueued)
-            return;
-        pImpl->ExitEnqueued = true;
-    }
-
     PushCommand(ThreadCommandQueueImpl::ExitCommand(pImpl, wait));
 }
 
 bool ThreadCommandQueue::IsExiting() const
 {
-    return pImpl->ExitProcessed;
+    return pImpl->ExitProcessed.Load_Acquire() != 0;
 }
 
 
@@ -29,7 +29,6 @@ limitations under the License.
 #define OVR_ThreadCommandQueue_h
 
 #include "../Kernel/OVR_Types.h"
-#include "../Kernel/OVR_List.h"
 #include "../Kernel/OVR_Atomic.h"
 #include "../Kernel/OVR_Threads.h"
 
@@ -46,23 +45,29 @@ class ThreadCommandQueue;
 class ThreadCommand
 {
 public:    
+    // Largest command a queue can hold; commands are copy-constructed in place
+    // into fixed size slots of this many bytes.
+    enum { MaxCommandSize = 256 };
+
     // NotifyEvent is used by ThreadCommandQueue::PushCallAndWait to notify the
-    // calling (producer)  thread when command is completed or queue slot is available.
-    class NotifyEvent : public ListNode<NotifyEvent>, public NewOverrideBase
+    // calling (producer) thread when command is completed. It lives on the
+    // producer's stack for the length of the call, so waiting allocates nothing.
+    class NotifyEvent
     {
-        Event E;
+        AtomicInt<uint32_t>             Done;
+        class ThreadCommandQueueImpl*   pQueueImpl;
     public:   
-        NotifyEvent() { }
+        NotifyEvent(ThreadCommandQueueImpl* queueImpl) : Done(0), pQueueImpl(queueImpl) { }
 
-        void Wait()        { E.Wait(); }
-        void PulseEvent()  { E.PulseEvent(); }
+        void Wait();
+        void PulseEvent();
     };
 
     // ThreadCommand::PopBuffer is temporary storage for a command popped off
     // by ThreadCommandQueue::PopCommand. 
     class PopBuffer
     {
-        enum { MaxSize = 256 };
+        enum { MaxSize = MaxCommandSize };
 
         size_t Size;
         union {            
@@ -220,6 +225,14 @@ public:
 // serviced by a single consumer thread. Commands are added to the queue with PushCall
 // and removed with PopCall; they are processed in FIFO order. Multiple producer threads
 // are supported and will be blocked if internal data buffer is full.
+//
+// The buffer is a bounded multi-producer, single-consumer ring of fixed size slots
+// that commands are constructed in place in. Producers claim a slot with one
+// compare-and-set, and locks are only taken when the queue runs empty, so pushing
+// never allocates and never waits on the consumer unless the ring is full. Threads
+// that do have to wait (a full ring, a waiting PushCall, WaitForCommand) sleep on a
+// futex on Linux and a wait condition elsewhere, and are only woken when someone is
+// asleep.
 
 class ThreadCommandQueue
 {
@@ -244,9 +257,15 @@ public:
     // Returns 'true' once ExitCommand has been processed, so the thread can shut down.
     bool IsExiting() const;
 
+    // Consumer thread only. Sleeps until a command may be available or delay
+    // milliseconds pass; returns 'true' if one is. For consumers that don't
+    // wait through the notifications below.
+    bool WaitForCommand(unsigned delay = OVR_WAIT_INFINITE);
+
 
     // These two virtual functions serve as notifications for derived
-    // thread waiting.    
+    // thread waiting. They are called with an internal lock held, which orders
+    // a pop finding the queue empty before the push that next fills it.
     virtual void OnPushNonEmpty_Locked() { }
     virtual void OnPopEmpty_Locked()     { }
 
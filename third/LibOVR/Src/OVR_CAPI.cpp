@@ -33,6 +33,7 @@ limitations under the License.
 #include "../Include/OVR_Version.h"
 
 #include "CAPI/CAPI_HMDState.h"
+#include "CAPI/CAPI_HMDProperties.h"
 #include "CAPI/CAPI_FrameTimeManager.h"
 
 #include "Service/Service_NetClient.h"
@@ -575,6 +576,15 @@ OVR_EXPORT ovrSizei ovrHmd_GetFovTextureSize(ovrHmd hmddesc, ovrEyeType eye, ovr
     return hmds->RenderState.GetFOVTextureSize(eye, fov, pixelsPerDisplayPixel);
 }
 
+OVR_EXPORT ovrFovPort ovrHmd_GetLensFov(ovrHmd hmddesc, ovrEyeType eye)
+{
+    ovrHmdStruct *  hmd = hmddesc->Handle;
+    if (!hmd) return hmddesc->DefaultEyeFov[eye];
+
+    HMDState* hmds = (HMDState*)hmd;
+    return hmds->RenderState.GetLensFov(eye);
+}
+
 
 //-------------------------------------------------------------------------------------
 
@@ -935,6 +945,20 @@ OVR_EXPORT ovrBool ovrHmd_CreateDistortionMesh( ovrHmd hmddesc,
 
 
 
+OVR_EXPORT void ovrHmd_DistortEyeImagesOnCpu( ovrHmd hmddesc, const ovrFovPort eyeFov[2],
+                                              const unsigned char* const eyeImages[2], const ovrSizei eyeImageSizes[2],
+                                              unsigned int distortionCaps, ovrBool linearFilter,
+                                              unsigned char* frame )
+{
+    if (!hmddesc || !eyeImages || !frame)
+        return;
+
+    // Lives next to ovrHmd_CreateDistortionMeshInternal, for the same reasons.
+    ovrHmd_DistortEyeImagesOnCpuInternal( hmddesc->Handle, eyeFov, eyeImages, eyeImageSizes,
+                                          distortionCaps, linearFilter, frame );
+}
+
+
 // Frees distortion mesh allocated by ovrHmd_GenerateDistortionMesh. meshData elements
 // are set to null and 0s after the call.
 OVR_EXPORT void ovrHmd_DestroyDistortionMesh(ovrDistortionMesh* meshData)
@@ -1198,6 +1222,32 @@ OVR_EXPORT unsigned int ovrHmd_GetFloatArray(ovrHmd hmddesc,
     return 0;
 }
 
+OVR_EXPORT ovrPropertyKey ovrHmd_GetPropertyKey(const char* propertyName)
+{
+    OVR_ASSERT(propertyName);
+    return (ovrPropertyKey)HMDPropertyTable::Find(propertyName);
+}
+
+OVR_EXPORT unsigned int ovrHmd_GetFloatArrayByKey(ovrHmd hmddesc,
+                                                  ovrPropertyKey key,
+                                                  float values[],
+                                                  unsigned int arraySize)
+{
+    OVR_ASSERT(hmddesc);
+    if (hmddesc && key)
+    {
+        HMDState* hmds = (HMDState*)hmddesc->Handle;
+        OVR_ASSERT(hmds);
+        if (hmds)
+        {
+            const HMDProperty* property = (const HMDProperty*)key;
+            return hmds->getFloatArray(property, property->Name, values, arraySize);
+        }
+    }
+
+    return 0;
+}
+
 // Modify float[] property; false if property doesn't exist or is readonly.
 OVR_EXPORT ovrBool ovrHmd_SetFloatArray(ovrHmd hmddesc,
                                         const char* propertyName,
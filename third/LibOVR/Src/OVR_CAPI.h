@@ -606,6 +606,12 @@ OVR_EXPORT ovrTrackingState ovrHmd_GetTrackingState(ovrHmd hmd, double absTime);
 OVR_EXPORT ovrSizei ovrHmd_GetFovTextureSize(ovrHmd hmd, ovrEyeType eye, ovrFovPort fov,
                                              float pixelsPerDisplayPixel);
 
+/// The cone each eye sees the screen through its lens, as the box around it: DefaultEyeFov
+/// before it is clamped to the physical screen. The lens is round, so directions outside the
+/// ellipse inscribed in this box are hidden by its rim; the corners of an eye texture rendered
+/// with DefaultEyeFov reach the screen but not the eye.
+OVR_EXPORT ovrFovPort ovrHmd_GetLensFov(ovrHmd hmd, ovrEyeType eye);
+
 //-------------------------------------------------------------------------------------
 // *****  Rendering API Thread Safety
 
@@ -753,6 +759,18 @@ OVR_EXPORT ovrBool ovrHmd_CreateDistortionMeshDebug( ovrHmd hmddesc,
 												     float debugEyeReliefOverrideInMetres);
 
 
+/// Distorts two rendered eye images into the frame the headset would show, on the CPU, the way
+/// the GL distortion renderer does with the same distortionCaps (Chromatic, Vignette, FlipInput),
+/// but with no timewarp. It is for headless tests and tools; every pixel gets an exact lens solve,
+/// so it differs from the mesh in the last bit where triangles interpolate a curve.
+/// Eye images are tightly packed RGBA8, each rendered with the whole image as its viewport and
+/// with the bottom row first unless FlipInput is set. frame is RGBA8 of hmd->Resolution, bottom
+/// row first like glReadPixels.
+OVR_EXPORT void     ovrHmd_DistortEyeImagesOnCpu( ovrHmd hmd, const ovrFovPort eyeFov[2],
+                                                  const unsigned char* const eyeImages[2], const ovrSizei eyeImageSizes[2],
+                                                  unsigned int distortionCaps, ovrBool linearFilter,
+                                                  unsigned char* frame );
+
 /// Used to free the distortion mesh allocated by ovrHmd_GenerateDistortionMesh. meshData elements
 /// are set to null and zeroes after the call.
 OVR_EXPORT void     ovrHmd_DestroyDistortionMesh( ovrDistortionMesh* meshData );
@@ -916,6 +934,18 @@ OVR_EXPORT unsigned int ovrHmd_GetFloatArray(ovrHmd hmd, const char* propertyNam
 OVR_EXPORT ovrBool      ovrHmd_SetFloatArray(ovrHmd hmd, const char* propertyName,
                                              float values[], unsigned int arraySize);
 
+/// A property name LibOVR has interned, so getting the property by its key skips
+/// looking the name up on every call.
+typedef const struct ovrPropertyKey_* ovrPropertyKey;
+
+/// Look a property's key up once, for the ...ByKey getters. Returns NULL for names
+/// LibOVR doesn't intern (profile values and "server:" names), which are read by name.
+OVR_EXPORT ovrPropertyKey ovrHmd_GetPropertyKey(const char* propertyName);
+
+/// ovrHmd_GetFloatArray for an interned name. Returns 0 for a NULL key.
+OVR_EXPORT unsigned int ovrHmd_GetFloatArrayByKey(ovrHmd hmd, ovrPropertyKey key,
+                                                  float values[], unsigned int arraySize);
+
 /// Get string property. Returns first element if property is a string array.
 /// Returns defaultValue if property doesn't exist.
 /// String memory is guaranteed to exist until next call to GetString or GetStringArray, or HMD is destroyed.
@@ -39,6 +39,7 @@ limitations under the License.
 #define OVR_KEY_EYE_CUP                     "EyeCup"            // char[16]
 #define OVR_KEY_CUSTOM_EYE_RENDER           "CustomEyeRender"   // bool
 #define OVR_KEY_CAMERA_POSITION				"CenteredFromWorld" // double[7]
+#define OVR_KEY_DISTORTION_MESH_CACHE_DIR   "DistortionMeshCacheDir" // string, set before ovrHmd_ConfigureRendering
 
 // Default measurements empirically determined at Oculus to make us happy
 // The neck model numbers were derived as an average of the male and female averages from ANSUR-88
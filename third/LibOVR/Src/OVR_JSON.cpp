@@ -59,11 +59,22 @@ limitations under the License.
 #include "OVR_JSON.h"
 #include "Kernel/OVR_SysFile.h"
 #include "Kernel/OVR_Log.h"
+#include "Kernel/OVR_Alg.h"
 
 #ifdef OVR_OS_LINUX
 #include <locale.h>
 #endif
 
+#if defined(OVR_CPU_X86) || defined(OVR_CPU_X86_64)
+    #include <emmintrin.h>
+    #if defined(OVR_CC_MSVC)
+        #include <intrin.h>
+    #endif
+    #define OVR_JSON_SCAN_SSE2 1
+#else
+    #define OVR_JSON_SCAN_SSE2 0
+#endif
+
 namespace OVR {
 
 
@@ -124,14 +135,6 @@ static char* PrintNumber(double d)
 // Parse the input text into an un-escaped cstring, and populate item.
 static const unsigned char firstByteMark[7] = { 0x00, 0x00, 0xC0, 0xE0, 0xF0, 0xF8, 0xFC };
 
-// Helper to assign error sting and return 0.
-const char* AssignError(const char** perror, const char *errorMessage)
-{
-    if (perror)
-        *perror = errorMessage;
-    return 0;
-}
-
 //-----------------------------------------------------------------------------
 // ***** JSON Node class
 
@@ -151,236 +154,6 @@ JSON::~JSON()
     }
 }
 
-//-----------------------------------------------------------------------------
-// Parse the input text to generate a number, and populate the result into item
-// Returns the text position after the parsed number
-const char* JSON::parseNumber(const char *num)
-{
-    const char* num_start = num;
-    double      n=0, scale=0;
-    int         subscale     = 0,
-                signsubscale = 1;
-    bool positiveSign = true;
-    char localeSeparator = '.';
-
-#ifdef OVR_OS_LINUX
-    // We should switch to a locale aware parsing function, such as atof. We
-    // will probably want to go farther and enforce the 'C' locale on all JSON
-    // output/input.
-    struct lconv* localeConv = localeconv();
-    localeSeparator = localeConv->decimal_point[0];
-#endif
-
-    // Could use sscanf for this?
-    if (*num == '-')
-    {
-        positiveSign = false;
-        num++;	// Has sign?
-    }
-    if (*num == '0')
-    {
-        num++;			// is zero
-    }
-
-    if (*num>='1' && *num<='9')	
-    {
-        do
-        {
-            n = (n*10.0) + (*num++ - '0');
-        }
-        while (*num>='0' && *num<='9');	// Number?
-    }
-
-    if ((*num=='.' || *num==localeSeparator) && num[1]>='0' && num[1]<='9')
-    {
-        num++;
-        do
-        {
-            n=(n*10.0)+(*num++ -'0');
-            scale--;
-        }
-        while (*num>='0' && *num<='9');  // Fractional part?
-    }
-
-	if (*num=='e' || *num=='E')		// Exponent?
-	{
-        num++;
-        if (*num == '+')
-        {
-            num++;
-        }
-        else if (*num=='-')
-        {
-            signsubscale=-1;
-            num++;		// With sign?
-        }
-
-        while (*num >= '0' && *num <= '9')
-        {
-            subscale = (subscale * 10) + (*num++ - '0');	// Number?
-        }
-	}
-
-    // Number = +/- number.fraction * 10^+/- exponent
-    n *= pow(10.0, (scale + subscale*signsubscale));
-
-    if (!positiveSign)
-    {
-        n = -n;
-    }
-
-    // Assign parsed value.
-    Type = JSON_Number;
-    dValue = n;
-    Value.AssignString(num_start, num - num_start);
-
-	return num;
-}
-
-// Parses a hex string up to the specified number of digits.
-// Returns the first character after the string.
-const char* ParseHex(unsigned* val, unsigned digits, const char* str)
-{
-    *val = 0;
-
-    for(unsigned digitCount = 0; digitCount < digits; digitCount++, str++)
-    {
-        unsigned v = *str;
-
-        if ((v >= '0') && (v <= '9'))
-            v -= '0';
-        else if ((v >= 'a') && (v <= 'f'))
-            v = 10 + v - 'a';
-        else if ((v >= 'A') && (v <= 'F'))
-            v = 10 + v - 'A';
-        else
-            break;
-
-        *val = *val * 16 + v;
-    }
-
-    return str;
-}
-
-//-----------------------------------------------------------------------------
-// Parses the input text into a string item and returns the text position after
-// the parsed string
-const char* JSON::parseString(const char* str, const char** perror)
-{
-	const char* ptr = str+1;
-    const char* p;
-    char*       ptr2;
-    char*       out;
-    int         len=0;
-    unsigned    uc, uc2;
-	
-    if (*str!='\"')
-    {
-        return AssignError(perror, "Syntax Error: Missing quote");
-    }
-	
-	while (*ptr!='\"' && *ptr && ++len)
-    {   
-        if (*ptr++ == '\\') ptr++;	// Skip escaped quotes.
-    }
-	
-    // This is how long we need for the string, roughly.
-	out=(char*)OVR_ALLOC(len+1);
-	if (!out)
-        return 0;
-	
-	ptr = str+1;
-    ptr2= out;
-
-	while (*ptr!='\"' && *ptr)
-	{
-		if (*ptr!='\\')
-        {
-            *ptr2++ = *ptr++;
-        }
-		else
-		{
-			ptr++;
-			switch (*ptr)
-			{
-				case 'b': *ptr2++ = '\b';	break;
-				case 'f': *ptr2++ = '\f';	break;
-				case 'n': *ptr2++ = '\n';	break;
-				case 'r': *ptr2++ = '\r';	break;
-				case 't': *ptr2++ = '\t';	break;
-
-                // Transcode utf16 to utf8.
-                case 'u':
-
-                    // Get the unicode char.
-                    p = ParseHex(&uc, 4, ptr + 1);
-                    if (ptr != p)
-                        ptr = p - 1;
-
-					if ((uc>=0xDC00 && uc<=0xDFFF) || uc==0)
-                        break;	// Check for invalid.
-
-                    // UTF16 surrogate pairs.
-					if (uc>=0xD800 && uc<=0xDBFF)
-					{
-						if (ptr[1]!='\\' || ptr[2]!='u')
-                            break;	// Missing second-half of surrogate.
-
-                        p= ParseHex(&uc2, 4, ptr + 3);
-                        if (ptr != p)
-                            ptr = p - 1;
-                        
-						if (uc2<0xDC00 || uc2>0xDFFF)
-                            break;	// Invalid second-half of surrogate.
-
-						uc = 0x10000 + (((uc&0x3FF)<<10) | (uc2&0x3FF));
-					}
-
-					len=4;
-                    
-                    if (uc<0x80)
-                        len=1;
-                    else if (uc<0x800)
-                        len=2;
-                    else if (uc<0x10000)
-                        len=3;
-                    
-                    ptr2+=len;
-					
-					switch (len)
-                    {
-						case 4: *--ptr2 =((uc | 0x80) & 0xBF); uc >>= 6;
-							//no break, fall through
-						case 3: *--ptr2 =((uc | 0x80) & 0xBF); uc >>= 6;
-							//no break
-						case 2: *--ptr2 =((uc | 0x80) & 0xBF); uc >>= 6;
-							//no break
-						case 1: *--ptr2 = (char)(uc | firstByteMark[len]);
-							//no break
-					}
-					ptr2+=len;
-					break;
-
-                default:
-                    *ptr2++ = *ptr;
-                    break;
-			}
-			ptr++;
-		}
-	}
-
-	*ptr2 = 0;
-	if (*ptr=='\"')
-        ptr++;
-	
-    // Make a copy of the string 
-    Value=out;
-    OVR_FREE(out);
-	Type=JSON_String;
-
-	return ptr;
-}
-
 //-----------------------------------------------------------------------------
 // Render the string provided to an escaped version that can be printed.
 char* PrintString(const char* str)
@@ -442,106 +215,6 @@ char* PrintString(const char* str)
 	return out;
 }
 
-//-----------------------------------------------------------------------------
-// Utility to jump whitespace and cr/lf
-static const char* skip(const char* in)
-{
-    while (in && *in && (unsigned char)*in<=' ') 
-        in++; 
-    return in;
-}
-
-//-----------------------------------------------------------------------------
-// Parses the supplied buffer of JSON text and returns a JSON object tree
-// The returned object must be Released after use
-JSON* JSON::Parse(const char* buff, const char** perror)
-{
-    const char* end = 0;
-	JSON*       json = new JSON();
-	
-	if (!json)
-    {
-        AssignError(perror, "Error: Failed to allocate memory");
-        return 0;
-    }
- 
-	end = json->parseValue(skip(buff), perror);
-	if (!end)
-    {
-        json->Release();
-        return NULL;
-    }	// parse failure. ep is set.
-
-    return json;
-}
-
-//-----------------------------------------------------------------------------
-// This version works for buffers that are not null terminated strings.
-JSON* JSON::ParseBuffer(const char *buff, int len, const char** perror)
-{
-	// Our JSON parser does not support length-based parsing,
-	// so ensure it is null-terminated.
-	char *termStr = new char[len + 1];
-	memcpy(termStr, buff, len);
-	termStr[len] = '\0';
-
-	JSON *objJson = Parse(termStr, perror);
-
-	delete[]termStr;
-
-	return objJson;
-}
-
-//-----------------------------------------------------------------------------
-// Parser core - when encountering text, process appropriately.
-const char* JSON::parseValue(const char* buff, const char** perror)
-{
-    if (perror)
-        *perror = 0;
-
-	if (!buff)
-        return NULL;	// Fail on null.
-
-	if (!strncmp(buff,"null",4))
-    {
-        Type = JSON_Null;
-        return buff+4;
-    }
-	if (!strncmp(buff,"false",5))
-    { 
-        Type   = JSON_Bool;
-        Value  = "false";
-        dValue = 0.;
-        return buff+5;
-    }
-	if (!strncmp(buff,"true",4))
-    {
-        Type   = JSON_Bool;
-        Value  = "true";
-        dValue = 1.;
-        return buff + 4;
-    }
-	if (*buff=='\"')
-    {
-        return parseString(buff, perror);
-    }
-	if (*buff=='-' || (*buff>='0' && *buff<='9'))
-    { 
-        return parseNumber(buff);
-    }
-	if (*buff=='[')
-    { 
-        return parseArray(buff, perror);
-    }
-	if (*buff=='{')
-    {
-        return parseObject(buff, perror);
-    }
-
-    return AssignError(perror, "Syntax Error: Invalid syntax");
-}
-
-
 //-----------------------------------------------------------------------------
 // Render a value to text. 
 char* JSON::PrintValue(int depth, bool fmt)
@@ -566,51 +239,6 @@ char* JSON::PrintValue(int depth, bool fmt)
 	return out;
 }
 
-//-----------------------------------------------------------------------------
-// Build an array object from input text and returns the text position after
-// the parsed array
-const char* JSON::parseArray(const char* buff, const char** perror)
-{
-	JSON *child;
-	if (*buff!='[')
-    {
-        return AssignError(perror, "Syntax Error: Missing opening bracket");
-    }
-
-	Type=JSON_Array;
-	buff=skip(buff+1);
-	
-    if (*buff==']')
-        return buff+1;	// empty array.
-
-    child = new JSON();
-	if (!child)
-        return 0;		 // memory fail
-    Children.PushBack(child);
-	
-    buff=skip(child->parseValue(skip(buff), perror));	// skip any spacing, get the buff. 
-	if (!buff)
-        return 0;
-
-	while (*buff==',')
-	{
-		JSON *new_item = new JSON();
-		if (!new_item)
-            return AssignError(perror, "Error: Failed to allocate memory");
-		
-        Children.PushBack(new_item);
-
-		buff=skip(new_item->parseValue(skip(buff+1), perror));
-		if (!buff)
-            return AssignError(perror, "Error: Failed to allocate memory");
-	}
-
-	if (*buff==']')
-        return buff+1;	// end of array
-
-    return AssignError(perror, "Syntax Error: Missing ending bracket");
-}
-
 //-----------------------------------------------------------------------------
 // Render an array to text.  The returned text must be freed
 char* JSON::PrintArray(int depth, bool fmt)
@@ -696,79 +324,14 @@ char* JSON::PrintArray(int depth, bool fmt)
 }
 
 //-----------------------------------------------------------------------------
-// Build an object from the supplied text and returns the text position after
-// the parsed object
-const char* JSON::parseObject(const char* buff, const char** perror)
+// Render an object to text.  The returned string must be freed
+char* JSON::PrintObject(int depth, bool fmt)
 {
-	if (*buff!='{')
-    {
-        return AssignError(perror, "Syntax Error: Missing opening brace");
-    }
-	
-	Type=JSON_Object;
-	buff=skip(buff+1);
-	if (*buff=='}')
-        return buff+1;	// empty array.
-	
-    JSON* child = new JSON();
-    Children.PushBack(child);
-
-	buff=skip(child->parseString(skip(buff), perror));
-	if (!buff) 
-        return 0;
-	child->Name = child->Value;
-    child->Value.Clear();
-	
-    if (*buff!=':')
-    {
-        return AssignError(perror, "Syntax Error: Missing colon");
-    }
-
-	buff=skip(child->parseValue(skip(buff+1), perror));	// skip any spacing, get the value.
-	if (!buff)
-        return 0;
-	
-	while (*buff==',')
-	{
-        child = new JSON();
-		if (!child)
-            return 0; // memory fail
-		
-        Children.PushBack(child);
-
-		buff=skip(child->parseString(skip(buff+1), perror));
-		if (!buff)
-            return 0;
-		
-        child->Name=child->Value;
-        child->Value.Clear();
-		
-        if (*buff!=':')
-        {
-            return AssignError(perror, "Syntax Error: Missing colon");
-        }	// fail!
-		
-        // Skip any spacing, get the value.
-        buff=skip(child->parseValue(skip(buff+1), perror));
-		if (!buff)
-            return 0;
-	}
-	
-	if (*buff=='}')
-        return buff+1;	// end of array 
-	
-    return AssignError(perror, "Syntax Error: Missing closing brace");
-}
-
-//-----------------------------------------------------------------------------
-// Render an object to text.  The returned string must be freed
-char* JSON::PrintObject(int depth, bool fmt)
-{
-	char**   entries = 0, **names = 0;
-	char*    out = 0;
-    char*    ptr, *ret, *str;
-    intptr_t len = 7, i = 0, j;
-    bool     fail = false;
+	char**   entries = 0, **names = 0;
+	char*    out = 0;
+    char*    ptr, *ret, *str;
+    intptr_t len = 7, i = 0, j;
+    bool     fail = false;
 	
     // Count the number of entries.
     int numentries = GetItemCount();
@@ -1228,34 +791,64 @@ JSON* JSON::Copy()
 }
 
 //-----------------------------------------------------------------------------
-// Loads and parses the given JSON file pathname and returns a JSON object tree.
-// The returned object must be Released after use.
-JSON* JSON::Load(const char* path, const char** perror)
+// Creates a JSON tree with the contents of a JSONDocument value
+JSON* JSON::CreateFromValue(const JSONValue* value)
 {
-    SysFile f;
-    if (!f.Open(path, File::Open_Read, File::Mode_Read))
+    JSON* item = new JSON(value->Type);
+    if (!item)
+        return 0;
+
+    if (value->NameLength)
+        item->Name.AssignString(value->Name, value->NameLength);
+    if (value->ValueLength)
+        item->Value.AssignString(value->Value, value->ValueLength);
+    item->dValue = value->dValue;
+
+    for (const JSONValue* child = value->pFirstChild; child; child = child->pNext)
     {
-        AssignError(perror, "Failed to open file");
-        return NULL;
+        JSON* childItem = CreateFromValue(child);
+        if (childItem)
+            item->Children.PushBack(childItem);
     }
 
-    int    len   = f.GetLength();
-    uint8_t* buff  = (uint8_t*)OVR_ALLOC(len + 1);
-    int    bytes = f.Read(buff, len);
-    f.Close();
+    return item;
+}
 
-    if (bytes == 0 || bytes != len)
-    {
-        OVR_FREE(buff);
+//-----------------------------------------------------------------------------
+// Parses the supplied buffer of JSON text and returns a JSON object tree
+// The returned object must be Released after use
+JSON* JSON::Parse(const char* buff, const char** perror)
+{
+    if (perror)
+        *perror = 0;
+
+    if (!buff)
         return NULL;
-    }
 
-	// Ensure the result is null-terminated since Parse() expects null-terminated input.
-	buff[len] = '\0';
+    return ParseBuffer(buff, (int)OVR_strlen(buff), perror);
+}
 
-    JSON* json = JSON::Parse((char*)buff, perror);
-    OVR_FREE(buff);
-    return json;
+//-----------------------------------------------------------------------------
+// This version works for buffers that are not null terminated strings.
+JSON* JSON::ParseBuffer(const char *buff, int len, const char** perror)
+{
+    JSONDocument document;
+    if (!document.Parse(buff, len, perror))
+        return NULL;
+
+    return CreateFromValue(document.GetRoot());
+}
+
+//-----------------------------------------------------------------------------
+// Loads and parses the given JSON file pathname and returns a JSON object tree.
+// The returned object must be Released after use.
+JSON* JSON::Load(const char* path, const char** perror)
+{
+    JSONDocument document;
+    if (!document.Load(path, perror))
+        return NULL;
+
+    return CreateFromValue(document.GetRoot());
 }
 
 //-----------------------------------------------------------------------------
@@ -1284,4 +877,716 @@ bool JSON::Save(const char* path)
 }
 
 
+//-----------------------------------------------------------------------------
+// ***** JSONValue
+
+static inline unsigned JSONHashName(const char* name, size_t len)
+{
+    // FNV-1a
+    unsigned hash = 2166136261u;
+    for (size_t i = 0; i < len; i++)
+    {
+        hash ^= (unsigned char)name[i];
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+static inline bool JSONNameEquals(const JSONValue* item, const char* name, size_t len, unsigned hash)
+{
+    return item->NameHash == hash && item->NameLength == len && memcmp(item->Name, name, len) == 0;
+}
+
+const JSONValue* JSONValue::GetItemByIndex(unsigned index) const
+{
+    const JSONValue* child = pFirstChild;
+    while (child && index--)
+    {
+        child = child->pNext;
+    }
+    return child;
+}
+
+// Returns the child item with the given name or NULL if not found.
+// Like JSON, the first of several items with the same name is found.
+const JSONValue* JSONValue::GetItemByName(const char* name) const
+{
+    size_t   len  = OVR_strlen(name);
+    unsigned hash = JSONHashName(name, len);
+
+    if (pChildIndex)
+    {
+        for (unsigned slot = hash & ChildIndexMask; pChildIndex[slot]; slot = (slot + 1) & ChildIndexMask)
+        {
+            if (JSONNameEquals(pChildIndex[slot], name, len, hash))
+                return pChildIndex[slot];
+        }
+        return 0;
+    }
+
+    for (const JSONValue* child = pFirstChild; child; child = child->pNext)
+    {
+        if (JSONNameEquals(child, name, len, hash))
+            return child;
+    }
+    return 0;
+}
+
+double JSONValue::GetNumberByName(const char* name, double defValue) const
+{
+    const JSONValue* item = GetItemByName(name);
+    return (item && item->Type == JSON_Number) ? item->dValue : defValue;
+}
+
+int JSONValue::GetIntByName(const char* name, int defValue) const
+{
+    const JSONValue* item = GetItemByName(name);
+    return (item && item->Type == JSON_Number) ? (int)item->dValue : defValue;
+}
+
+bool JSONValue::GetBoolByName(const char* name, bool defValue) const
+{
+    const JSONValue* item = GetItemByName(name);
+    return (item && item->Type == JSON_Bool) ? ((int)item->dValue != 0) : defValue;
+}
+
+const char* JSONValue::GetStringByName(const char* name, const char* defValue) const
+{
+    const JSONValue* item = GetItemByName(name);
+    return (item && item->Type == JSON_String) ? item->Value : defValue;
+}
+
+
+//-----------------------------------------------------------------------------
+// ***** JSONDocument
+
+// Zero bytes after the text, so a 16 byte scan that starts before the end
+// never reads past the arena.
+static const int      JSONTextPadding   = 16;
+
+// Objects with at least this many items get a hash index.
+static const unsigned JSONIndexMinItems = 8;
+
+static const size_t   JSONMinBlockSize  = 16 * 1024;
+static const size_t   JSONMaxBlockSize  = 1024 * 1024;
+
+// Keeps block data 16 byte aligned.
+static const size_t   JSONBlockHeaderSize = 32;
+
+static char* AssignParseError(const char** perror, const char* errorMessage)
+{
+    if (perror)
+        *perror = errorMessage;
+    return 0;
+}
+
+#if OVR_JSON_SCAN_SSE2
+static inline unsigned JSONLowestBit(unsigned mask)
+{
+#if defined(OVR_CC_MSVC)
+    unsigned long index;
+    _BitScanForward(&index, mask);
+    return (unsigned)index;
+#else
+    return (unsigned)__builtin_ctz(mask);
+#endif
+}
+#endif
+
+// Returns the first byte that isn't whitespace. As in the cJSON parser this
+// came from, whitespace is every byte from 1 up to and including ' '.
+static inline char* JSONSkipSpace(char* in)
+{
+    // Most runs are a newline and a few tabs, or nothing at all, so look at
+    // one byte before going wide.
+    if ((unsigned char)(*in - 1) >= ' ')
+        return in;
+
+#if OVR_JSON_SCAN_SSE2
+    const __m128i space = _mm_set1_epi8(' ');
+    const __m128i zero  = _mm_setzero_si128();
+    for (;;)
+    {
+        __m128i bytes   = _mm_loadu_si128((const __m128i*)in);
+        __m128i isSpace = _mm_andnot_si128(_mm_cmpeq_epi8(bytes, zero),
+                                           _mm_cmpeq_epi8(_mm_max_epu8(bytes, space), space));
+        unsigned other  = ~(unsigned)_mm_movemask_epi8(isSpace) & 0xFFFF;
+        if (other)
+            return in + JSONLowestBit(other);
+        in += 16;
+    }
+#else
+    while (*in && (unsigned char)*in <= ' ')
+        in++;
+    return in;
+#endif
+}
+
+// Returns the first quote, backslash or end of text at or after ptr.
+static inline char* JSONFindStringSpecial(char* ptr)
+{
+#if OVR_JSON_SCAN_SSE2
+    const __m128i quote     = _mm_set1_epi8('\"');
+    const __m128i backslash = _mm_set1_epi8('\\');
+    const __m128i zero      = _mm_setzero_si128();
+    for (;;)
+    {
+        __m128i  bytes   = _mm_loadu_si128((const __m128i*)ptr);
+        __m128i  special = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(bytes, quote),
+                                                     _mm_cmpeq_epi8(bytes, backslash)),
+                                        _mm_cmpeq_epi8(bytes, zero));
+        unsigned mask    = (unsigned)_mm_movemask_epi8(special);
+        if (mask)
+            return ptr + JSONLowestBit(mask);
+        ptr += 16;
+    }
+#else
+    while (*ptr != '\"' && *ptr != '\\' && *ptr)
+        ptr++;
+    return ptr;
+#endif
+}
+
+// Parses a hex string up to the specified number of digits.
+// Returns the first character after the string.
+static const char* ParseHex(unsigned* val, unsigned digits, const char* str)
+{
+    *val = 0;
+
+    for(unsigned digitCount = 0; digitCount < digits; digitCount++, str++)
+    {
+        unsigned v = *str;
+
+        if ((v >= '0') && (v <= '9'))
+            v -= '0';
+        else if ((v >= 'a') && (v <= 'f'))
+            v = 10 + v - 'a';
+        else if ((v >= 'A') && (v <= 'F'))
+            v = 10 + v - 'A';
+        else
+            break;
+
+        *val = *val * 16 + v;
+    }
+
+    return str;
+}
+
+JSONDocument::JSONDocument() :
+    pBlocks(0), pRoot(0), ValueCount(0), BlockCount(0), ArenaSize(0)
+{
+}
+
+JSONDocument::~JSONDocument()
+{
+    Clear();
+}
+
+void JSONDocument::Clear()
+{
+    while (pBlocks)
+    {
+        ArenaBlock* next = pBlocks->pNext;
+        OVR_FREE(pBlocks);
+        pBlocks = next;
+    }
+
+    pRoot      = 0;
+    ValueCount = 0;
+    BlockCount = 0;
+    ArenaSize  = 0;
+}
+
+//-----------------------------------------------------------------------------
+// Parses the supplied buffer of JSON text into the document
+bool JSONDocument::Parse(const char* buff, int len, const char** perror)
+{
+    Clear();
+    if (perror)
+        *perror = 0;
+
+    if (!buff || len < 0)
+        return false;
+
+    char* text = allocText(len);
+    if (!text)
+    {
+        AssignParseError(perror, "Error: Failed to allocate memory");
+        return false;
+    }
+    memcpy(text, buff, len);
+
+    return parseText(text, perror);
+}
+
+//-----------------------------------------------------------------------------
+// Loads the given JSON file straight into the arena and parses it there
+bool JSONDocument::Load(const char* path, const char** perror)
+{
+    Clear();
+    if (perror)
+        *perror = 0;
+
+    SysFile f;
+    if (!f.Open(path, File::Open_Read, File::Mode_Read))
+    {
+        AssignParseError(perror, "Failed to open file");
+        return false;
+    }
+
+    int   len   = f.GetLength();
+    char* text  = allocText(len);
+    int   bytes = text ? f.Read((uint8_t*)text, len) : 0;
+    f.Close();
+
+    if (bytes == 0 || bytes != len)
+    {
+        Clear();
+        return false;
+    }
+
+    return parseText(text, perror);
+}
+
+void* JSONDocument::allocArena(size_t size)
+{
+    size = (size + 7) & ~(size_t)7;
+
+    if (!pBlocks || pBlocks->Size - pBlocks->Used < size)
+    {
+        // Grow with the document, so a big one takes few blocks.
+        size_t blockSize = Alg::Min(Alg::Max(JSONMinBlockSize, ArenaSize), JSONMaxBlockSize);
+        blockSize = Alg::Max(blockSize, size);
+
+        ArenaBlock* block = (ArenaBlock*)OVR_ALLOC(JSONBlockHeaderSize + blockSize);
+        if (!block)
+            return 0;
+
+        block->pNext = pBlocks;
+        block->Size  = blockSize;
+        block->Used  = 0;
+        pBlocks      = block;
+        BlockCount++;
+        ArenaSize   += blockSize;
+    }
+
+    void* p = (char*)pBlocks + JSONBlockHeaderSize + pBlocks->Used;
+    pBlocks->Used += size;
+    return p;
+}
+
+char* JSONDocument::allocText(int len)
+{
+    char* text = (char*)allocArena((size_t)len + JSONTextPadding);
+    if (text)
+        memset(text + len, 0, JSONTextPadding);
+    return text;
+}
+
+JSONValue* JSONDocument::newValue()
+{
+    JSONValue* value = (JSONValue*)allocArena(sizeof(JSONValue));
+    if (!value)
+        return 0;
+
+    value->Type           = JSON_None;
+    value->Name           = "";
+    value->NameLength     = 0;
+    value->NameHash       = JSONHashName("", 0);
+    value->Value          = "";
+    value->ValueLength    = 0;
+    value->dValue         = 0.;
+    value->pFirstChild    = 0;
+    value->pNext          = 0;
+    value->ChildCount     = 0;
+    value->ChildIndexMask = 0;
+    value->pChildIndex    = 0;
+    ValueCount++;
+    return value;
+}
+
+bool JSONDocument::parseText(char* text, const char** perror)
+{
+    JSONValue* root = newValue();
+    if (!root)
+    {
+        AssignParseError(perror, "Error: Failed to allocate memory");
+        return false;
+    }
+
+    if (!parseValue(root, JSONSkipSpace(text), perror))
+    {
+        Clear();
+        return false;
+    }
+
+    pRoot = root;
+    return true;
+}
+
+//-----------------------------------------------------------------------------
+// Parser core - when encountering text, process appropriately.
+char* JSONDocument::parseValue(JSONValue* value, char* buff, const char** perror)
+{
+	if (!strncmp(buff,"null",4))
+    {
+        value->Type = JSON_Null;
+        return buff+4;
+    }
+	if (!strncmp(buff,"false",5))
+    { 
+        value->Type        = JSON_Bool;
+        value->Value       = "false";
+        value->ValueLength = 5;
+        value->dValue      = 0.;
+        return buff+5;
+    }
+	if (!strncmp(buff,"true",4))
+    {
+        value->Type        = JSON_Bool;
+        value->Value       = "true";
+        value->ValueLength = 4;
+        value->dValue      = 1.;
+        return buff + 4;
+    }
+	if (*buff=='\"')
+    {
+        value->Type = JSON_String;
+        return parseString(buff, &value->Value, &value->ValueLength, perror);
+    }
+	if (*buff=='-' || (*buff>='0' && *buff<='9'))
+    { 
+        return parseNumber(value, buff);
+    }
+	if (*buff=='[')
+    { 
+        return parseArray(value, buff, perror);
+    }
+	if (*buff=='{')
+    {
+        return parseObject(value, buff, perror);
+    }
+
+    return AssignParseError(perror, "Syntax Error: Invalid syntax");
+}
+
+//-----------------------------------------------------------------------------
+// Parse the input text to generate a number, and populate the result into value
+// Returns the text position after the parsed number
+char* JSONDocument::parseNumber(JSONValue* value, char* num)
+{
+    char*       num_start = num;
+    double      n=0, scale=0;
+    int         subscale     = 0,
+                signsubscale = 1;
+    bool positiveSign = true;
+    char localeSeparator = '.';
+
+#ifdef OVR_OS_LINUX
+    // We should switch to a locale aware parsing function, such as atof. We
+    // will probably want to go farther and enforce the 'C' locale on all JSON
+    // output/input.
+    struct lconv* localeConv = localeconv();
+    localeSeparator = localeConv->decimal_point[0];
+#endif
+
+    if (*num == '-')
+    {
+        positiveSign = false;
+        num++;	// Has sign?
+    }
+    if (*num == '0')
+    {
+        num++;			// is zero
+    }
+
+    if (*num>='1' && *num<='9')	
+    {
+        do
+        {
+            n = (n*10.0) + (*num++ - '0');
+        }
+        while (*num>='0' && *num<='9');	// Number?
+    }
+
+    if ((*num=='.' || *num==localeSeparator) && num[1]>='0' && num[1]<='9')
+    {
+        num++;
+        do
+        {
+            n=(n*10.0)+(*num++ -'0');
+            scale--;
+        }
+        while (*num>='0' && *num<='9');  // Fractional part?
+    }
+
+	if (*num=='e' || *num=='E')		// Exponent?
+	{
+        num++;
+        if (*num == '+')
+        {
+            num++;
+        }
+        else if (*num=='-')
+        {
+            signsubscale=-1;
+            num++;		// With sign?
+        }
+
+        while (*num >= '0' && *num <= '9')
+        {
+            subscale = (subscale * 10) + (*num++ - '0');	// Number?
+        }
+	}
+
+    // Number = +/- number.fraction * 10^+/- exponent
+    n *= pow(10.0, (scale + subscale*signsubscale));
+
+    if (!positiveSign)
+    {
+        n = -n;
+    }
+
+    // The text is kept as well, like JSON does. It can't be terminated in
+    // place without clobbering what follows, so it gets a copy.
+    unsigned len  = (unsigned)(num - num_start);
+    char*    text = (char*)allocArena(len + 1);
+    if (text)
+    {
+        memcpy(text, num_start, len);
+        text[len] = 0;
+        value->Value       = text;
+        value->ValueLength = len;
+    }
+
+    value->Type   = JSON_Number;
+    value->dValue = n;
+	return num;
+}
+
+//-----------------------------------------------------------------------------
+// Unescapes the string at str where it lies and terminates it, returning the
+// text position after it. Unescaped text is never longer than the escaped
+// text, so writing never overtakes reading.
+char* JSONDocument::parseString(char* str, const char** pstring, unsigned* plength, const char** perror)
+{
+    if (*str!='\"')
+    {
+        return AssignParseError(perror, "Syntax Error: Missing quote");
+    }
+
+    char*       begin = str + 1;
+    char*       ptr   = JSONFindStringSpecial(begin);
+    char*       ptr2  = ptr;
+    const char* p;
+    unsigned    uc, uc2;
+    int         len;
+
+    while (*ptr == '\\' && ptr[1])
+    {
+        ptr++;
+        switch (*ptr)
+        {
+            case 'b': *ptr2++ = '\b';	break;
+            case 'f': *ptr2++ = '\f';	break;
+            case 'n': *ptr2++ = '\n';	break;
+            case 'r': *ptr2++ = '\r';	break;
+            case 't': *ptr2++ = '\t';	break;
+
+            // Transcode utf16 to utf8.
+            case 'u':
+
+                // Get the unicode char.
+                p = ParseHex(&uc, 4, ptr + 1);
+                if (ptr != p)
+                    ptr = (char*)p - 1;
+
+                if ((uc>=0xDC00 && uc<=0xDFFF) || uc==0)
+                    break;	// Check for invalid.
+
+                // UTF16 surrogate pairs.
+                if (uc>=0xD800 && uc<=0xDBFF)
+                {
+                    if (ptr[1]!='\\' || ptr[2]!='u')
+                        break;	// Missing second-half of surrogate.
+
+                    p= ParseHex(&uc2, 4, ptr + 3);
+                    if (ptr != p)
+                        ptr = (char*)p - 1;
+                    
+                    if (uc2<0xDC00 || uc2>0xDFFF)
+                        break;	// Invalid second-half of surrogate.
+
+                    uc = 0x10000 + (((uc&0x3FF)<<10) | (uc2&0x3FF));
+                }
+
+                len=4;
+                
+                if (uc<0x80)
+                    len=1;
+                else if (uc<0x800)
+                    len=2;
+                else if (uc<0x10000)
+                    len=3;
+                
+                ptr2+=len;
+                
+                switch (len)
+                {
+                    case 4: *--ptr2 =((uc | 0x80) & 0xBF); uc >>= 6;
+                        //no break, fall through
+                    case 3: *--ptr2 =((uc | 0x80) & 0xBF); uc >>= 6;
+                        //no break
+                    case 2: *--ptr2 =((uc | 0x80) & 0xBF); uc >>= 6;
+                        //no break
+                    case 1: *--ptr2 = (char)(uc | firstByteMark[len]);
+                        //no break
+                }
+                ptr2+=len;
+                break;
+
+            default:
+                *ptr2++ = *ptr;
+                break;
+        }
+        ptr++;
+
+        // Move the plain run up to the next escape or the end.
+        char* next = JSONFindStringSpecial(ptr);
+        memmove(ptr2, ptr, next - ptr);
+        ptr2 += next - ptr;
+        ptr   = next;
+    }
+
+    // A string that runs off the end of the text ends there, as it always has.
+    char* end = (*ptr == '\"') ? ptr + 1 : ptr + OVR_strlen(ptr);
+    *ptr2 = 0;
+
+    *pstring = begin;
+    *plength = (unsigned)(ptr2 - begin);
+    return end;
+}
+
+//-----------------------------------------------------------------------------
+// Build an array value from input text and returns the text position after
+// the parsed array
+char* JSONDocument::parseArray(JSONValue* value, char* buff, const char** perror)
+{
+	value->Type = JSON_Array;
+	buff = JSONSkipSpace(buff+1);
+	
+    if (*buff==']')
+        return buff+1;	// empty array.
+
+    JSONValue** plink = &value->pFirstChild;
+    for (;;)
+    {
+        JSONValue* child = newValue();
+        if (!child)
+            return AssignParseError(perror, "Error: Failed to allocate memory");
+
+        *plink = child;
+        plink  = &child->pNext;
+        value->ChildCount++;
+
+        buff = parseValue(child, JSONSkipSpace(buff), perror);
+        if (!buff)
+            return 0;
+
+        buff = JSONSkipSpace(buff);
+        if (*buff!=',')
+            break;
+        buff++;
+    }
+
+	if (*buff==']')
+        return buff+1;	// end of array
+
+    return AssignParseError(perror, "Syntax Error: Missing ending bracket");
+}
+
+//-----------------------------------------------------------------------------
+// Build an object value from the supplied text and returns the text position
+// after the parsed object
+char* JSONDocument::parseObject(JSONValue* value, char* buff, const char** perror)
+{
+	value->Type = JSON_Object;
+	buff = JSONSkipSpace(buff+1);
+
+	if (*buff=='}')
+        return buff+1;	// empty object.
+
+    JSONValue** plink = &value->pFirstChild;
+    for (;;)
+    {
+        JSONValue* child = newValue();
+        if (!child)
+            return AssignParseError(perror, "Error: Failed to allocate memory");
+
+        *plink = child;
+        plink  = &child->pNext;
+        value->ChildCount++;
+
+        buff = parseString(JSONSkipSpace(buff), &child->Name, &child->NameLength, perror);
+        if (!buff)
+            return 0;
+        child->NameHash = JSONHashName(child->Name, child->NameLength);
+
+        buff = JSONSkipSpace(buff);
+        if (*buff!=':')
+            return AssignParseError(perror, "Syntax Error: Missing colon");
+
+        // Skip any spacing, get the value.
+        buff = parseValue(child, JSONSkipSpace(buff+1), perror);
+        if (!buff)
+            return 0;
+
+        buff = JSONSkipSpace(buff);
+        if (*buff!=',')
+            break;
+        buff++;
+    }
+
+	if (*buff=='}')
+    {
+        if (value->ChildCount >= JSONIndexMinItems)
+            indexObject(value);
+        return buff+1;	// end of object
+    }
+
+    return AssignParseError(perror, "Syntax Error: Missing closing brace");
+}
+
+//-----------------------------------------------------------------------------
+// Builds the open addressing hash index of an object's items
+void JSONDocument::indexObject(JSONValue* value)
+{
+    unsigned size = 16;
+    while (size < value->ChildCount * 2)
+        size <<= 1;
+
+    JSONValue** index = (JSONValue**)allocArena(size * sizeof(JSONValue*));
+    if (!index)
+        return;     // lookups walk the list instead
+    memset(index, 0, size * sizeof(JSONValue*));
+
+    for (JSONValue* child = value->pFirstChild; child; child = child->pNext)
+    {
+        unsigned slot      = child->NameHash & (size - 1);
+        bool     duplicate = false;
+        while (index[slot] && !duplicate)
+        {
+            // Keep the first of several items with the same name.
+            duplicate = JSONNameEquals(index[slot], child->Name, child->NameLength, child->NameHash);
+            slot      = (slot + 1) & (size - 1);
+        }
+        if (!duplicate)
+            index[slot] = child;
+    }
+
+    value->pChildIndex    = index;
+    value->ChildIndexMask = size - 1;
+}
+
+
 } // namespace OVR
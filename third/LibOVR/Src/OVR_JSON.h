@@ -48,6 +48,45 @@ enum JSONItemType
     JSON_Object    = 6
 };
 
+//-----------------------------------------------------------------------------
+// ***** JSONValue
+
+// Read-only node of a JSONDocument. Nodes, names and strings all live in the
+// document's arena and stay valid until the document is cleared or destroyed.
+// Objects with many members carry a hash index of them, so looking a member up
+// by name doesn't walk the list.
+
+struct JSONValue
+{
+    JSONItemType    Type;
+    const char*     Name;           // Name part of the {Name, Value} pair in a parent object, "" otherwise.
+    unsigned        NameLength;
+    unsigned        NameHash;
+    const char*     Value;          // Strings, and the text of numbers and bools; "" otherwise.
+    unsigned        ValueLength;
+    double          dValue;
+
+    JSONValue*      pFirstChild;
+    JSONValue*      pNext;
+    unsigned        ChildCount;
+    unsigned        ChildIndexMask; // Size of pChildIndex minus one.
+    JSONValue**     pChildIndex;    // Null if the value has no index.
+
+    bool                HasItems() const                            { return pFirstChild != 0; }
+    const JSONValue*    GetFirstItem() const                        { return pFirstChild; }
+    const JSONValue*    GetNextItem(const JSONValue* item) const    { return item->pNext; }
+    unsigned            GetItemCount() const                        { return ChildCount; }
+    const JSONValue*    GetItemByIndex(unsigned index) const;
+    const JSONValue*    GetItemByName(const char* name) const;
+
+    // Accessors by name
+    double              GetNumberByName(const char* name, double defValue = 0.0) const;
+    int                 GetIntByName(const char* name, int defValue = 0) const;
+    bool                GetBoolByName(const char* name, bool defValue = false) const;
+    const char*         GetStringByName(const char* name, const char* defValue = "") const;
+};
+
+
 //-----------------------------------------------------------------------------
 // ***** JSON
 
@@ -79,8 +118,13 @@ public:
     static JSON*    CreateInt(int num);
     static JSON*    CreateString(const char *s);
 
+    // Creates a new JSON tree that is a copy of a JSONDocument value.
+    static JSON*    CreateFromValue(const JSONValue* value);
+
     // Creates a new JSON object from parsing string.
     // Returns null pointer and fills in *perror in case of parse error.
+    // Parsing goes through a JSONDocument; use one directly to read JSON
+    // without building a tree of refcounted nodes.
     static JSON*    Parse(const char* buff, const char** perror = 0);
 
 	// This version works for buffers that are not null terminated strings.
@@ -147,19 +191,82 @@ public:
 protected:
     JSON(JSONItemType itemType = JSON_Object);
 
-    // JSON Parsing helper functions.
-    const char*     parseValue(const char *buff, const char** perror);
-    const char*     parseNumber(const char *num);
-    const char*     parseArray(const char* value, const char** perror);
-    const char*     parseObject(const char* value, const char** perror);
-    const char*     parseString(const char* str, const char** perror);
-
     char*           PrintValue(int depth, bool fmt);
     char*           PrintObject(int depth, bool fmt);
     char*           PrintArray(int depth, bool fmt);
 };
 
 
+//-----------------------------------------------------------------------------
+// ***** JSONDocument
+
+// JSONDocument parses JSON text into a tree of read-only JSONValues. Unlike
+// JSON, which allocates every node and string on its own, the text is copied
+// once into an arena, strings are unescaped and terminated where they lie in
+// that copy, and the nodes are carved out of the same arena, so a document
+// costs a handful of allocations however large it is. Whitespace and strings
+// are scanned 16 bytes at a time with SSE2 where available.
+//
+// Use JSON::CreateFromValue to get an editable JSON tree from it.
+
+class JSONDocument : public NewOverrideBase
+{
+public:
+    JSONDocument();
+    ~JSONDocument();
+
+    // Parses len bytes of JSON text, which need not be null terminated,
+    // replacing what was parsed before.
+    // Returns false and fills in *perror in case of parse error.
+    bool                Parse(const char* buff, int len, const char** perror = 0);
+
+    // Loads and parses a JSON file.
+    // Returns false and fills in *perror on fail.
+    bool                Load(const char* path, const char** perror = 0);
+
+    // Frees the arena; values from the document are invalid afterwards.
+    void                Clear();
+
+    // The top level value, or null if nothing was parsed.
+    const JSONValue*    GetRoot() const         { return pRoot; }
+
+    // Arena statistics, for profiling.
+    unsigned            GetValueCount() const   { return ValueCount; }
+    unsigned            GetBlockCount() const   { return BlockCount; }
+    size_t              GetArenaSize() const    { return ArenaSize; }
+
+private:
+    struct ArenaBlock
+    {
+        ArenaBlock*     pNext;
+        size_t          Size;
+        size_t          Used;
+    };
+
+    // Not copyable, values point into the arena.
+    JSONDocument(const JSONDocument&);
+    void operator=(const JSONDocument&);
+
+    void*               allocArena(size_t size);
+    char*               allocText(int len);
+    JSONValue*          newValue();
+    bool                parseText(char* text, const char** perror);
+
+    char*               parseValue(JSONValue* value, char* buff, const char** perror);
+    char*               parseNumber(JSONValue* value, char* num);
+    char*               parseString(char* str, const char** pstring, unsigned* plength, const char** perror);
+    char*               parseArray(JSONValue* value, char* buff, const char** perror);
+    char*               parseObject(JSONValue* value, char* buff, const char** perror);
+    void                indexObject(JSONValue* value);
+
+    ArenaBlock*         pBlocks;
+    JSONValue*          pRoot;
+    unsigned            ValueCount;
+    unsigned            BlockCount;
+    size_t              ArenaSize;
+};
+
+
 }
 
 #endif
@@ -35,7 +35,10 @@ limitations under the License.
 #include "OVR_JSON.h"
 #include "Kernel/OVR_SysFile.h"
 #include "Kernel/OVR_Allocator.h"
+#include "Kernel/OVR_CRC32.h"
+#include "Kernel/OVR_Alg.h"
 #include "OVR_Stereo.h"
+#include <time.h>
 
 #ifdef OVR_OS_WIN32
 #define WIN32_LEAN_AND_MEAN
@@ -45,10 +48,12 @@ limitations under the License.
 // Nothing, thanks.
 #else
 #include <dirent.h>
+#include <fcntl.h>
+#include <sys/mman.h>
 #include <sys/stat.h>
+#include <unistd.h>
 
 #ifdef OVR_OS_LINUX
-#include <unistd.h>
 #include <pwd.h>
 #endif
 
@@ -1032,15 +1037,22 @@ bool ProfileManager::SetTaggedProfile(const char** tag_names, const char** tags,
 //-----------------------------------------------------------------------------
 Profile* ProfileManager::GetDefaultUserProfile(const ProfileDeviceKey& deviceKey)
 {
+    Lock::Locker lockScope(&ProfileLock);
+
+    Profile* profile = LoadProfileSnapshot(deviceKey);
+    if (profile)
+        return profile;
+
     const char* userName = GetDefaultUser(deviceKey);
 
-    Profile* profile = GetProfile(deviceKey, userName);
+    profile = GetProfile(deviceKey, userName);
 
     if (!profile)
     {
         profile = GetDefaultProfile(deviceKey.HmdType);
     }
 
+    SaveProfileSnapshot(deviceKey, profile);
     return profile;
 }
 
@@ -1082,6 +1094,423 @@ Profile* ProfileManager::GetProfile(const ProfileDeviceKey& deviceKey, const cha
     return profile;
 }
 
+//-----------------------------------------------------------------------------
+String ProfileManager::GetSnapshotPath()
+{
+    return BasePath + "/ProfileSnapshot.bin";
+}
+
+// The files a default user profile is resolved from
+void ProfileManager::GetSnapshotSources(String* sources)
+{
+    sources[0] = GetProfilePath();
+    sources[1] = BasePath + "/Profiles.json";   // legacy profiles, read when there is no database
+    sources[2] = BasePath + "/Devices.json";
+}
+
+static String GetSnapshotKey(const ProfileDeviceKey& deviceKey)
+{
+    char buffer[64];
+    OVR_sprintf(buffer, sizeof(buffer), "%d|%d|%u|", deviceKey.Valid ? 1 : 0, (int)deviceKey.HmdType, deviceKey.ProductId);
+
+    String key = buffer;
+    key += deviceKey.ProductName;
+    key += "|";
+    key += deviceKey.PrintedSerial;
+    return key;
+}
+
+Profile* ProfileManager::LoadProfileSnapshot(const ProfileDeviceKey& deviceKey)
+{
+    // Unsaved changes aren't in the files the snapshot is checked against
+    if (Changed || BasePath.IsEmpty())
+        return NULL;
+
+    String sources[ProfileSnapshot::SourceCount];
+    GetSnapshotSources(sources);
+
+    ProfileSnapshot* snapshot = ProfileSnapshot::Open(GetSnapshotPath(), GetSnapshotKey(deviceKey), sources);
+    if (snapshot == NULL)
+        return NULL;
+
+    Profile* profile = CreateProfile();
+    profile->pSnapshot = *snapshot;
+    return profile;
+}
+
+void ProfileManager::SaveProfileSnapshot(const ProfileDeviceKey& deviceKey, const Profile* profile)
+{
+    if (Changed || BasePath.IsEmpty() || profile == NULL)
+        return;
+
+    String sources[ProfileSnapshot::SourceCount];
+    GetSnapshotSources(sources);
+
+    // Failing to write it only costs the next launch a parse
+    ProfileSnapshot::Save(GetSnapshotPath(), GetSnapshotKey(deviceKey), sources, profile);
+}
+
+
+//-----------------------------------------------------------------------------
+// ***** ProfileSnapshot
+
+#define PROFILE_SNAPSHOT_MAGIC   "OVRSnap"
+#define PROFILE_SNAPSHOT_VERSION 1
+
+// A snapshot file is this header, the Entry table sorted by name, the numbers
+// of every array and then all of the strings.
+struct ProfileSnapshotSource
+{
+    int64_t     ModifyTime;
+    int64_t     FileSize;
+    uint32_t    CRC;
+    uint32_t    Exists;
+};
+
+struct ProfileSnapshotHeader
+{
+    char                    Magic[8];
+    uint32_t                Version;
+    uint32_t                FileSize;
+    uint32_t                PayloadCRC;     // of everything after the header
+    uint32_t                EntryCount;
+    uint32_t                KeyOffset;      // the device key it was resolved for
+    uint32_t                Pad;
+    int64_t                 WriteTime;
+    ProfileSnapshotSource   Sources[ProfileSnapshot::SourceCount];
+};
+
+static bool HashSourceFile(const String& path, uint32_t* crc)
+{
+    SysFile file;
+    if (!file.Open(path, File::Open_Read | File::Open_Buffered))
+        return false;
+
+    // CRC32_Calculate complements its result, so undo that to carry on
+    uint8_t  buffer[16384];
+    uint32_t accumulator = 0;
+    int      read_size;
+    while ((read_size = file.Read(buffer, sizeof(buffer))) > 0)
+        accumulator = ~CRC32_Calculate(buffer, read_size, accumulator);
+
+    *crc = ~accumulator;
+    return true;
+}
+
+static void StampSourceFile(ProfileSnapshotSource* stamp, const String& path)
+{
+    memset(stamp, 0, sizeof(ProfileSnapshotSource));
+
+    FileStat stat;
+    if (SysFile::GetFileStat(&stat, path) && HashSourceFile(path, &stamp->CRC))
+    {
+        stamp->ModifyTime = stat.ModifyTime;
+        stamp->FileSize = stat.FileSize;
+        stamp->Exists = 1;
+    }
+}
+
+static bool IsSourceFileUnchanged(const ProfileSnapshotSource& stamp, const String& path, int64_t write_time, bool* hashed)
+{
+    FileStat stat;
+    bool exists = SysFile::GetFileStat(&stat, path);
+    if (!exists || !stamp.Exists)
+        return exists == (stamp.Exists != 0);
+
+    if (stat.FileSize != stamp.FileSize)
+        return false;
+
+    // A file last modified before the snapshot was written can't have changed
+    // since without moving its modification time.  Anything else is hashed,
+    // since a second is all the resolution some file systems keep.
+    if (stat.ModifyTime == stamp.ModifyTime && stamp.ModifyTime < write_time)
+        return true;
+
+    uint32_t crc = 0;
+    *hashed = true;
+    return HashSourceFile(path, &crc) && crc == stamp.CRC;
+}
+
+static bool ReplaceFile(const String& from_path, const String& to_path)
+{
+#if defined(OVR_OS_WIN32)
+    WCHAR wfrom[MAX_PATH];
+    WCHAR wto[MAX_PATH];
+    if (UTF8Util::GetLength(from_path.ToCStr()) >= MAX_PATH || UTF8Util::GetLength(to_path.ToCStr()) >= MAX_PATH)
+        return false;
+    UTF8Util::DecodeString(wfrom, from_path.ToCStr());
+    UTF8Util::DecodeString(wto, to_path.ToCStr());
+
+    return MoveFileExW(wfrom, wto, MOVEFILE_REPLACE_EXISTING) != 0;
+#elif defined(OVR_OS_MS)
+    OVR_UNUSED2(from_path, to_path);
+    return false;
+#else
+    return rename(from_path.ToCStr(), to_path.ToCStr()) == 0;
+#endif
+}
+
+// Written to the side and moved over, so another process mapping the old
+// snapshot never sees it half written
+static bool WriteSnapshotFile(const String& path, const uint8_t* data, size_t data_size)
+{
+    String temp_path = path + ".tmp";
+    bool   written = false;
+    {
+        SysFile file;
+        if (file.Open(temp_path, File::Open_Write | File::Open_Create | File::Open_Truncate, File::Mode_ReadWrite))
+        {
+            written = (file.Write(data, (int)data_size) == (int)data_size);
+            written = file.Close() && written;
+        }
+    }
+
+    return written && ReplaceFile(temp_path, path);
+}
+
+static bool SnapshotNameLess(JSON* a, JSON* b)
+{
+    return OVR_strcmp(a->Name, b->Name) < 0;
+}
+
+ProfileSnapshot::~ProfileSnapshot()
+{
+    if (pData == NULL)
+        return;
+
+#if defined(OVR_OS_WIN32)
+    UnmapViewOfFile(pData);
+#elif !defined(OVR_OS_MS)
+    munmap((void*)pData, DataSize);
+#endif
+}
+
+// Maps the whole file read-only.  The view outlives the handles used to make it.
+bool ProfileSnapshot::map(const String& path)
+{
+#if defined(OVR_OS_WIN32)
+    WCHAR wpath[MAX_PATH];
+    if (UTF8Util::GetLength(path.ToCStr()) >= MAX_PATH)
+        return false;
+    UTF8Util::DecodeString(wpath, path.ToCStr());
+
+    HANDLE file = CreateFileW(wpath, GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_DELETE, NULL,
+                              OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (file == INVALID_HANDLE_VALUE)
+        return false;
+
+    LARGE_INTEGER size;
+    HANDLE mapping = NULL;
+    if (GetFileSizeEx(file, &size) && size.QuadPart > 0 && size.QuadPart < 0x7fffffff)
+    {
+        mapping = CreateFileMappingW(file, NULL, PAGE_READONLY, 0, 0, NULL);
+        if (mapping)
+        {
+            pData = (const uint8_t*)MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+            DataSize = pData ? (size_t)size.QuadPart : 0;
+            CloseHandle(mapping);
+        }
+    }
+    CloseHandle(file);
+
+#elif defined(OVR_OS_MS)
+    OVR_UNUSED(path);
+
+#else
+    int file = open(path.ToCStr(), O_RDONLY);
+    if (file < 0)
+        return false;
+
+    struct stat file_stat;
+    if (fstat(file, &file_stat) == 0 && file_stat.st_size > 0 && file_stat.st_size < 0x7fffffff)
+    {
+        void* data = mmap(NULL, (size_t)file_stat.st_size, PROT_READ, MAP_PRIVATE, file, 0);
+        if (data != MAP_FAILED)
+        {
+            pData = (const uint8_t*)data;
+            DataSize = (size_t)file_stat.st_size;
+        }
+    }
+    close(file);
+#endif
+
+    return pData != NULL;
+}
+
+bool ProfileSnapshot::validate(const String& deviceKey, const String* sources, bool* hashed)
+{
+    if (DataSize < sizeof(ProfileSnapshotHeader))
+        return false;
+
+    const ProfileSnapshotHeader* header = (const ProfileSnapshotHeader*)pData;
+    if (memcmp(header->Magic, PROFILE_SNAPSHOT_MAGIC, sizeof(header->Magic)) != 0 ||
+        header->Version != PROFILE_SNAPSHOT_VERSION ||
+        header->FileSize != DataSize ||
+        header->KeyOffset >= DataSize ||
+        header->EntryCount > (DataSize - sizeof(ProfileSnapshotHeader)) / sizeof(Entry))
+        return false;
+
+    // Catches a snapshot cut short by a crash while it was written
+    const uint8_t* payload = pData + sizeof(ProfileSnapshotHeader);
+    if (CRC32_Calculate(payload, (int)(DataSize - sizeof(ProfileSnapshotHeader))) != header->PayloadCRC)
+        return false;
+
+    if (deviceKey != (const char*)(pData + header->KeyOffset))
+        return false;
+
+    for (int i=0; i<SourceCount; i++)
+    {
+        if (!IsSourceFileUnchanged(header->Sources[i], sources[i], header->WriteTime, hashed))
+            return false;
+    }
+
+    pEntries = (const Entry*)payload;
+    EntryCount = header->EntryCount;
+    return true;
+}
+
+ProfileSnapshot* ProfileSnapshot::Open(const String& path, const String& deviceKey, const String* sources)
+{
+    ProfileSnapshot* snapshot = new ProfileSnapshot();
+    bool             hashed = false;
+    if (!snapshot->map(path) || !snapshot->validate(deviceKey, sources, &hashed))
+    {
+        snapshot->Release();
+        return NULL;
+    }
+
+    // A source was only touched, so stamp it again rather than hash it on
+    // every launch from now on
+    if (hashed)
+        snapshot->restamp(path, sources);
+
+    return snapshot;
+}
+
+bool ProfileSnapshot::restamp(const String& path, const String* sources)
+{
+    uint8_t* data = (uint8_t*)OVR_ALLOC(DataSize);
+    if (data == NULL)
+        return false;
+    memcpy(data, pData, DataSize);
+
+    ProfileSnapshotHeader* header = (ProfileSnapshotHeader*)data;
+    header->WriteTime = (int64_t)time(NULL);
+    for (int i=0; i<SourceCount; i++)
+        StampSourceFile(&header->Sources[i], sources[i]);
+
+    bool saved = WriteSnapshotFile(path, data, DataSize);
+    OVR_FREE(data);
+    return saved;
+}
+
+bool ProfileSnapshot::Save(const String& path, const String& deviceKey, const String* sources, const Profile* profile)
+{
+    ProfileSnapshotHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.Magic, PROFILE_SNAPSHOT_MAGIC, sizeof(header.Magic));
+    header.Version = PROFILE_SNAPSHOT_VERSION;
+    header.WriteTime = (int64_t)time(NULL);
+    for (int i=0; i<SourceCount; i++)
+        StampSourceFile(&header.Sources[i], sources[i]);
+
+    // Values can hold values ValMap has since replaced, keep the ones in use
+    Array<JSON*> values;
+    for (unsigned int i=0; i<profile->Values.GetSize(); i++)
+    {
+        JSON* value = NULL;
+        if (profile->ValMap.Get(profile->Values[i]->Name, &value) && value == profile->Values[i])
+            values.PushBack(value);
+    }
+    Alg::QuickSort(values, SnapshotNameLess);
+
+    // Size everything up front so it can all go into a single buffer
+    size_t numbers_size = 0;
+    size_t strings_size = deviceKey.GetSize() + 1;
+    for (unsigned int i=0; i<values.GetSize(); i++)
+    {
+        if (values[i]->Type == JSON_Array)
+            numbers_size += values[i]->GetArraySize() * sizeof(double);
+        strings_size += values[i]->Name.GetSize() + 1 + values[i]->Value.GetSize() + 1;
+    }
+
+    size_t entries_offset = sizeof(ProfileSnapshotHeader);
+    size_t numbers_offset = entries_offset + values.GetSize() * sizeof(Entry);
+    size_t strings_offset = numbers_offset + numbers_size;
+    size_t data_size = strings_offset + strings_size;
+
+    uint8_t* data = (uint8_t*)OVR_ALLOC(data_size);
+    if (data == NULL)
+        return false;
+    memset(data, 0, data_size);
+
+    Entry*   entries = (Entry*)(data + entries_offset);
+    double*  numbers = (double*)(data + numbers_offset);
+    size_t   string_cursor = strings_offset;
+
+    header.KeyOffset = (uint32_t)string_cursor;
+    memcpy(data + string_cursor, deviceKey.ToCStr(), deviceKey.GetSize());
+    string_cursor += deviceKey.GetSize() + 1;
+
+    for (unsigned int i=0; i<values.GetSize(); i++)
+    {
+        JSON*  value = values[i];
+        Entry& entry = entries[i];
+
+        entry.Number = value->dValue;
+        entry.Type = (uint32_t)value->Type;
+
+        entry.NameOffset = (uint32_t)string_cursor;
+        memcpy(data + string_cursor, value->Name.ToCStr(), value->Name.GetSize());
+        string_cursor += value->Name.GetSize() + 1;
+
+        entry.ValueOffset = (uint32_t)string_cursor;
+        memcpy(data + string_cursor, value->Value.ToCStr(), value->Value.GetSize());
+        string_cursor += value->Value.GetSize() + 1;
+
+        entry.NumbersOffset = (uint32_t)((uint8_t*)numbers - data);
+        if (value->Type == JSON_Array)
+        {
+            // The getters stop at the first item that isn't a number
+            entry.ArraySize = (uint32_t)value->GetArraySize();
+            for (JSON* item = value->GetFirstItem(); item && item->Type == JSON_Number; item = value->GetNextItem(item))
+                numbers[entry.NumberCount++] = item->dValue;
+            numbers += entry.ArraySize;
+        }
+    }
+
+    header.EntryCount = (uint32_t)values.GetSize();
+    header.FileSize = (uint32_t)data_size;
+    header.PayloadCRC = CRC32_Calculate(data + sizeof(ProfileSnapshotHeader), (int)(data_size - sizeof(ProfileSnapshotHeader)));
+    memcpy(data, &header, sizeof(header));
+
+    bool saved = WriteSnapshotFile(path, data, data_size);
+    OVR_FREE(data);
+    return saved;
+}
+
+const ProfileSnapshot::Entry* ProfileSnapshot::FindEntry(const char* key) const
+{
+    if (key == NULL)
+        return NULL;
+
+    uint32_t lower = 0;
+    uint32_t upper = EntryCount;
+    while (lower < upper)
+    {
+        uint32_t middle = (lower + upper) / 2;
+        int      order = OVR_strcmp((const char*)(pData + pEntries[middle].NameOffset), key);
+        if (order == 0)
+            return pEntries + middle;
+        else if (order < 0)
+            lower = middle + 1;
+        else
+            upper = middle;
+    }
+
+    return NULL;
+}
+
 
 //-----------------------------------------------------------------------------
 // ***** Profile
@@ -1299,15 +1728,31 @@ bool Profile::LoadProfile(JSON* root,
 }
 
 
+//-----------------------------------------------------------------------------
+// Returns the snapshot's entry for key, unless the profile has its own value
+const ProfileSnapshot::Entry* Profile::findSnapshotEntry(const char* key) const
+{
+    if (pSnapshot == NULL || key == NULL || ValMap.Get(key) != NULL)
+        return NULL;
+
+    return pSnapshot->FindEntry(key);
+}
+
 //-----------------------------------------------------------------------------
 char* Profile::GetValue(const char* key, char* val, int val_length) const
 {
     JSON* value = NULL;
+    const ProfileSnapshot::Entry* entry = NULL;
     if (ValMap.Get(key, &value))
     {
         OVR_strcpy(val, val_length, value->Value.ToCStr());
         return val;
     }
+    else if ((entry = findSnapshotEntry(key)) != NULL)
+    {
+        OVR_strcpy(val, val_length, pSnapshot->GetValueString(entry));
+        return val;
+    }
     else
     {
         val[0] = 0;
@@ -1321,11 +1766,17 @@ const char* Profile::GetValue(const char* key)
     // Non-reentrant query.  The returned buffer can only be used until the next call
     // to GetValue()
     JSON* value = NULL;
+    const ProfileSnapshot::Entry* entry = NULL;
     if (ValMap.Get(key, &value))
     {
         TempVal = value->Value;
         return TempVal.ToCStr();
     }
+    else if ((entry = findSnapshotEntry(key)) != NULL)
+    {
+        TempVal = pSnapshot->GetValueString(entry);
+        return TempVal.ToCStr();
+    }
     else
     {
         return NULL;
@@ -1336,6 +1787,7 @@ const char* Profile::GetValue(const char* key)
 int Profile::GetNumValues(const char* key) const
 {
     JSON* value = NULL;
+    const ProfileSnapshot::Entry* entry = NULL;
     if (ValMap.Get(key, &value))
     {  
         if (value->Type == JSON_Array)
@@ -1343,6 +1795,13 @@ int Profile::GetNumValues(const char* key) const
         else
             return 1;
     }
+    else if ((entry = findSnapshotEntry(key)) != NULL)
+    {
+        if (entry->Type == JSON_Array)
+            return (int)entry->ArraySize;
+        else
+            return 1;
+    }
     else
         return 0;        
 }
@@ -1351,8 +1810,11 @@ int Profile::GetNumValues(const char* key) const
 bool Profile::GetBoolValue(const char* key, bool default_val) const
 {
     JSON* value = NULL;
+    const ProfileSnapshot::Entry* entry = NULL;
     if (ValMap.Get(key, &value) && value->Type == JSON_Bool)
         return (value->dValue != 0);
+    else if ((entry = findSnapshotEntry(key)) != NULL && entry->Type == JSON_Bool)
+        return (entry->Number != 0);
     else
         return default_val;
 }
@@ -1361,8 +1823,11 @@ bool Profile::GetBoolValue(const char* key, bool default_val) const
 int Profile::GetIntValue(const char* key, int default_val) const
 {
     JSON* value = NULL;
+    const ProfileSnapshot::Entry* entry = NULL;
     if (ValMap.Get(key, &value) && value->Type == JSON_Number)
         return (int)(value->dValue);
+    else if ((entry = findSnapshotEntry(key)) != NULL && entry->Type == JSON_Number)
+        return (int)(entry->Number);
     else
         return default_val;
 }
@@ -1371,8 +1836,11 @@ int Profile::GetIntValue(const char* key, int default_val) const
 float Profile::GetFloatValue(const char* key, float default_val) const
 {
     JSON* value = NULL;
+    const ProfileSnapshot::Entry* entry = NULL;
     if (ValMap.Get(key, &value) && value->Type == JSON_Number)
         return (float)(value->dValue);
+    else if ((entry = findSnapshotEntry(key)) != NULL && entry->Type == JSON_Number)
+        return (float)(entry->Number);
     else
         return default_val;
 }
@@ -1381,6 +1849,7 @@ float Profile::GetFloatValue(const char* key, float default_val) const
 int Profile::GetFloatValues(const char* key, float* values, int num_vals) const
 {
     JSON* value = NULL;
+    const ProfileSnapshot::Entry* entry = NULL;
     if (ValMap.Get(key, &value) && value->Type == JSON_Array)
     {
         int val_count = Alg::Min(value->GetArraySize(), num_vals);
@@ -1399,6 +1868,15 @@ int Profile::GetFloatValues(const char* key, float* values, int num_vals) const
 
         return count;
     }
+    else if ((entry = findSnapshotEntry(key)) != NULL && entry->Type == JSON_Array)
+    {
+        int val_count = Alg::Min((int)entry->NumberCount, num_vals);
+        const double* numbers = pSnapshot->GetNumbers(entry);
+        for (int i=0; i<val_count; i++)
+            values[i] = (float)numbers[i];
+
+        return val_count;
+    }
     else
     {
         return 0;
@@ -1409,8 +1887,11 @@ int Profile::GetFloatValues(const char* key, float* values, int num_vals) const
 double Profile::GetDoubleValue(const char* key, double default_val) const
 {
     JSON* value = NULL;
+    const ProfileSnapshot::Entry* entry = NULL;
     if (ValMap.Get(key, &value) && value->Type == JSON_Number)
         return value->dValue;
+    else if ((entry = findSnapshotEntry(key)) != NULL && entry->Type == JSON_Number)
+        return entry->Number;
     else
         return default_val;
 }
@@ -1419,6 +1900,7 @@ double Profile::GetDoubleValue(const char* key, double default_val) const
 int Profile::GetDoubleValues(const char* key, double* values, int num_vals) const
 {
     JSON* value = NULL;
+    const ProfileSnapshot::Entry* entry = NULL;
     if (ValMap.Get(key, &value) && value->Type == JSON_Array)
     {
         int val_count = Alg::Min(value->GetArraySize(), num_vals);
@@ -1437,6 +1919,12 @@ int Profile::GetDoubleValues(const char* key, double* values, int num_vals) cons
 
         return count;
     }
+    else if ((entry = findSnapshotEntry(key)) != NULL && entry->Type == JSON_Array)
+    {
+        int val_count = Alg::Min((int)entry->NumberCount, num_vals);
+        memcpy(values, pSnapshot->GetNumbers(entry), val_count * sizeof(double));
+        return val_count;
+    }
     return 0;
 }
 
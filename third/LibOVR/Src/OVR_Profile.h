@@ -45,6 +45,7 @@ namespace OVR {
 
 class HMDInfo; // Opaque forward declaration
 class Profile;
+class ProfileSnapshot;
 class JSON;
 
 
@@ -141,6 +142,71 @@ protected:
     void                LoadCache(bool create);
     void                LoadV1Profiles(JSON* v1);
     const char*         GetDefaultUser(const char* product, const char* serial);
+
+    // Snapshots of the default user profile for a device, see ProfileSnapshot
+    String              GetSnapshotPath();
+    void                GetSnapshotSources(String* sources);
+    Profile*            LoadProfileSnapshot(const ProfileDeviceKey& deviceKey);
+    void                SaveProfileSnapshot(const ProfileDeviceKey& deviceKey, const Profile* profile);
+};
+
+
+//-------------------------------------------------------------------
+// ***** ProfileSnapshot
+
+// Resolving the default user profile for a device means parsing the whole
+// profile database and walking all of its tagged data, so its cost grows with
+// every user and device the machine has seen.  The resolved values are instead
+// written to a flat binary snapshot next to the database, with their names
+// sorted, and later launches map that file and answer lookups with a binary
+// search, without parsing or allocating anything.
+//
+// The snapshot records the device key it was resolved for along with the size,
+// modification time and CRC of each file it was resolved from.  It is
+// rejected when the key differs or any source changed: a source whose size and
+// modification time match, and that was last modified before the snapshot was
+// written, is taken as unchanged, otherwise its contents are hashed again.
+class ProfileSnapshot : public RefCountBase<ProfileSnapshot>
+{
+public:
+    enum { SourceCount = 3 };
+
+    // One value, as stored in the file.  Offsets are from the start of the file.
+    struct Entry
+    {
+        double      Number;         // dValue of numbers and bools
+        uint32_t    NameOffset;
+        uint32_t    ValueOffset;    // the JSON Value string, "" for arrays
+        uint32_t    NumbersOffset;  // NumberCount doubles for arrays
+        uint32_t    Type;           // JSONItemType
+        uint32_t    ArraySize;
+        uint32_t    NumberCount;    // leading numbers of the array
+    };
+
+    ~ProfileSnapshot();
+
+    // Maps the snapshot at path, returning NULL unless it is intact, was written
+    // for deviceKey and none of the SourceCount sources changed since.
+    static ProfileSnapshot* Open(const String& path, const String& deviceKey, const String* sources);
+
+    // Flattens every value of profile into a snapshot at path.
+    static bool         Save(const String& path, const String& deviceKey, const String* sources, const Profile* profile);
+
+    const Entry*        FindEntry(const char* key) const;
+    const char*         GetValueString(const Entry* entry) const  { return (const char*)(pData + entry->ValueOffset); }
+    const double*       GetNumbers(const Entry* entry) const      { return (const double*)(pData + entry->NumbersOffset); }
+
+private:
+    ProfileSnapshot() : pData(NULL), DataSize(0), pEntries(NULL), EntryCount(0) { }
+
+    bool                map(const String& path);
+    bool                validate(const String& deviceKey, const String* sources, bool* hashed);
+    bool                restamp(const String& path, const String* sources);
+
+    const uint8_t*      pData;
+    size_t              DataSize;
+    const Entry*        pEntries;
+    uint32_t            EntryCount;
 };
 
 
@@ -157,6 +223,8 @@ protected:
     OVR::Array<JSON*>   Values;  
     OVR::String         TempVal;
     String              BasePath;
+    // Values loaded from a snapshot; anything in ValMap takes precedence
+    Ptr<ProfileSnapshot> pSnapshot;
 
 public:
     ~Profile();
@@ -190,6 +258,7 @@ protected:
 	}
     
     void                SetValue(JSON* val);
+    const ProfileSnapshot::Entry* findSnapshotEntry(const char* key) const;
 
 	static bool         LoadProfile(const ProfileDeviceKey& deviceKey,
                                     const char* user,
@@ -211,6 +280,7 @@ protected:
 
     friend class ProfileManager;
     friend class WProfileManager;
+    friend class ProfileSnapshot;
 };
 
 // This path should be passed into the ProfileManager
@@ -29,6 +29,13 @@ limitations under the License.
 #include "Kernel/OVR_Log.h"
 #include "Kernel/OVR_Alg.h"
 
+#if defined(OVR_CPU_X86) || defined(OVR_CPU_X86_64)
+    #include <emmintrin.h>
+    #define OVR_STEREO_BATCH_SSE2 1
+#else
+    #define OVR_STEREO_BATCH_SSE2 0
+#endif
+
 //To allow custom distortion to be introduced to CatMulSpline.
 float (*CustomDistortion)(float) = NULL;
 float (*CustomDistortionInv)(float) = NULL;
@@ -165,6 +172,89 @@ float EvalCatmullRom10Spline ( float const *K, float scaledVal )
 }
 
 
+// Batched work is done through stack buffers of this many values.
+static const int BatchChunkSize = 64;
+
+// The end points and tangents of every segment of the spline, exactly as the switch in
+// EvalCatmullRom10Spline picks them, so a batch can look them up instead of branching.
+struct CatmullRom10Segments
+{
+    float P0[LensConfig::NumCoefficients];
+    float M0[LensConfig::NumCoefficients];
+    float P1[LensConfig::NumCoefficients];
+    float M1[LensConfig::NumCoefficients];
+
+    CatmullRom10Segments ( float const *K )
+    {
+        int const NumSegments = LensConfig::NumCoefficients;
+
+        P0[0] = 1.0f;
+        M0[0] =        ( K[1] - K[0] );
+        P1[0] = K[1];
+        M1[0] = 0.5f * ( K[2] - K[0] );
+        for ( int k = 1; k < NumSegments-2; k++ )
+        {
+            P0[k] = K[k  ];
+            M0[k] = 0.5f * ( K[k+1] - K[k-1] );
+            P1[k] = K[k+1];
+            M1[k] = 0.5f * ( K[k+2] - K[k  ] );
+        }
+        P0[NumSegments-2] = K[NumSegments-2];
+        M0[NumSegments-2] = 0.5f * ( K[NumSegments-1] - K[NumSegments-2] );
+        P1[NumSegments-2] = K[NumSegments-1];
+        M1[NumSegments-2] = K[NumSegments-1] - K[NumSegments-2];
+        P0[NumSegments-1] = K[NumSegments-1];
+        M0[NumSegments-1] = K[NumSegments-1] - K[NumSegments-2];
+        P1[NumSegments-1] = P0[NumSegments-1] + M0[NumSegments-1];
+        M1[NumSegments-1] = M0[NumSegments-1];
+    }
+};
+
+void EvalCatmullRom10SplineBatch ( float const *K, float const *scaledVal, float *result, int count )
+{
+    int i = 0;
+
+#if OVR_STEREO_BATCH_SSE2
+    int const NumSegments = LensConfig::NumCoefficients;
+    CatmullRom10Segments segments ( K );
+
+    const __m128 zero        = _mm_setzero_ps();
+    const __m128 one         = _mm_set1_ps ( 1.0f );
+    const __m128 two         = _mm_set1_ps ( 2.0f );
+    const __m128 lastSegment = _mm_set1_ps ( (float)(NumSegments-1) );
+
+    for ( ; i + 4 <= count; i += 4 )
+    {
+        __m128 val = _mm_loadu_ps ( scaledVal + i );
+        // Clamping first makes truncation the same as floorf, and keeps it in int range.
+        __m128 valFloor = _mm_max_ps ( zero, _mm_min_ps ( lastSegment, val ) );
+        __m128i k4 = _mm_cvttps_epi32 ( valFloor );
+        valFloor = _mm_cvtepi32_ps ( k4 );
+        __m128 t   = _mm_sub_ps ( val, valFloor );
+        __m128 omt = _mm_sub_ps ( one, t );
+
+        int k[4];
+        _mm_storeu_si128 ( (__m128i*)k, k4 );
+        __m128 p0 = _mm_setr_ps ( segments.P0[k[0]], segments.P0[k[1]], segments.P0[k[2]], segments.P0[k[3]] );
+        __m128 m0 = _mm_setr_ps ( segments.M0[k[0]], segments.M0[k[1]], segments.M0[k[2]], segments.M0[k[3]] );
+        __m128 p1 = _mm_setr_ps ( segments.P1[k[0]], segments.P1[k[1]], segments.P1[k[2]], segments.P1[k[3]] );
+        __m128 m1 = _mm_setr_ps ( segments.M1[k[0]], segments.M1[k[1]], segments.M1[k[2]], segments.M1[k[3]] );
+
+        __m128 res0 = _mm_add_ps ( _mm_mul_ps ( p0, _mm_add_ps ( one, _mm_mul_ps ( two, t ) ) ), _mm_mul_ps ( m0, t ) );
+        __m128 res1 = _mm_sub_ps ( _mm_mul_ps ( p1, _mm_add_ps ( one, _mm_mul_ps ( two, omt ) ) ), _mm_mul_ps ( m1, omt ) );
+        __m128 res  = _mm_add_ps ( _mm_mul_ps ( _mm_mul_ps ( res0, omt ), omt ),
+                                   _mm_mul_ps ( _mm_mul_ps ( res1, t   ), t   ) );
+        _mm_storeu_ps ( result + i, res );
+    }
+#endif
+
+    for ( ; i < count; i++ )
+    {
+        result[i] = EvalCatmullRom10Spline ( K, scaledVal[i] );
+    }
+}
+
+
 
 
 // Converts a Profile eyecup string into an eyecup enumeration
@@ -280,6 +370,158 @@ float LensConfig::DistortionFnInverse(float r) const
     return s;
 }
 
+void LensConfig::DistortionFnScaleRadiusSquaredBatch ( float const *rsq, float *scale, int count ) const
+{
+    if ( ( Eqn != Distortion_CatmullRom10 ) || CustomDistortion )
+    {
+        // The polynomials are cheap enough as they are, and the override takes one value at a time.
+        for ( int i = 0; i < count; i++ )
+        {
+            scale[i] = DistortionFnScaleRadiusSquared ( rsq[i] );
+        }
+        return;
+    }
+
+    const int NumSegments = LensConfig::NumCoefficients;
+    float scaledRsq[BatchChunkSize];
+    for ( int first = 0; first < count; first += BatchChunkSize )
+    {
+        int chunkCount = Alg::Min ( BatchChunkSize, count - first );
+        for ( int i = 0; i < chunkCount; i++ )
+        {
+            scaledRsq[i] = (float)(NumSegments-1) * rsq[first+i] / ( MaxR * MaxR );
+        }
+        EvalCatmullRom10SplineBatch ( K, scaledRsq, scale + first, chunkCount );
+    }
+}
+
+void LensConfig::DistortionFnScaleRadiusSquaredChromaBatch ( float const *rsq,
+                                                             float *scaleR, float *scaleG, float *scaleB,
+                                                             int count ) const
+{
+    DistortionFnScaleRadiusSquaredBatch ( rsq, scaleG, count );
+    for ( int i = 0; i < count; i++ )
+    {
+        scaleR[i] = scaleG[i] * ( 1.0f + ChromaticAberration[0] + rsq[i] * ChromaticAberration[1] );
+        scaleB[i] = scaleG[i] * ( 1.0f + ChromaticAberration[2] + rsq[i] * ChromaticAberration[3] );
+    }
+}
+
+
+void LensInverseTable::Build ( LensConfig const &lens, float maxR )
+{
+    MaxR     = maxR;
+    RScale   = 0.0f;
+    NumValid = 0;
+    if ( !( maxR > 0.0f ) )
+    {
+        return;
+    }
+    RScale   = (float)(NumSamples-1) / maxR;
+    InvR[0]  = 0.0f;
+    NumValid = 1;
+
+    // Walk the forward function a little past where it reaches maxR, a few steps per
+    // table entry, and invert it piecewise linearly onto the evenly spaced table radii.
+    const int NumSteps = NumSamples * 4;
+    float sStep = lens.DistortionFnInverse ( maxR ) * 1.05f / (float)NumSteps;
+    float sPrev = 0.0f;
+    float rPrev = 0.0f;
+
+    float s[BatchChunkSize], rsq[BatchChunkSize], scale[BatchChunkSize];
+    for ( int firstStep = 1; firstStep <= NumSteps; firstStep += BatchChunkSize )
+    {
+        int chunkCount = Alg::Min ( BatchChunkSize, NumSteps + 1 - firstStep );
+        for ( int i = 0; i < chunkCount; i++ )
+        {
+            s[i]   = sStep * (float)( firstStep + i );
+            rsq[i] = s[i] * s[i];
+        }
+        lens.DistortionFnScaleRadiusSquaredBatch ( rsq, scale, chunkCount );
+
+        for ( int i = 0; i < chunkCount; i++ )
+        {
+            float r = s[i] * scale[i];
+            if ( !( r > rPrev ) )
+            {
+                // Not monotonic from here on - leave the rest to the iterative solve.
+                return;
+            }
+            while ( ( NumValid < NumSamples ) && ( (float)NumValid <= r * RScale ) )
+            {
+                float rTable = (float)NumValid / RScale;
+                InvR[NumValid] = sPrev + ( s[i] - sPrev ) * ( ( rTable - rPrev ) / ( r - rPrev ) );
+                NumValid++;
+            }
+            if ( NumValid == NumSamples )
+            {
+                return;
+            }
+            sPrev = s[i];
+            rPrev = r;
+        }
+    }
+}
+
+float LensInverseTable::DistortionFnInverse ( LensConfig const &lens, float r ) const
+{
+    float index = r * RScale;
+    if ( !( index >= 0.0f ) || !( index < (float)(NumValid-1) ) )
+    {
+        return lens.DistortionFnInverse ( r );
+    }
+    int   i = (int)index;
+    float f = index - (float)i;
+    return InvR[i] + ( InvR[i+1] - InvR[i] ) * f;
+}
+
+void LensInverseTable::DistortionFnInverseBatch ( LensConfig const &lens, float const *r, float *result, int count ) const
+{
+    int i = 0;
+
+#if OVR_STEREO_BATCH_SSE2
+    if ( NumValid >= 2 )
+    {
+        const __m128 zero     = _mm_setzero_ps();
+        const __m128 rScale   = _mm_set1_ps ( RScale );
+        const __m128 lastLerp = _mm_set1_ps ( (float)(NumValid-1) );
+
+        for ( ; i + 4 <= count; i += 4 )
+        {
+            __m128 index   = _mm_mul_ps ( _mm_loadu_ps ( r + i ), rScale );
+            __m128 inTable = _mm_and_ps ( _mm_cmpge_ps ( index, zero ), _mm_cmplt_ps ( index, lastLerp ) );
+            // Out of table lanes still look up something valid, then get redone below.
+            index = _mm_and_ps ( index, inTable );
+            __m128i i4 = _mm_cvttps_epi32 ( index );
+            __m128  f  = _mm_sub_ps ( index, _mm_cvtepi32_ps ( i4 ) );
+
+            int k[4];
+            _mm_storeu_si128 ( (__m128i*)k, i4 );
+            __m128 lo = _mm_setr_ps ( InvR[k[0]  ], InvR[k[1]  ], InvR[k[2]  ], InvR[k[3]  ] );
+            __m128 hi = _mm_setr_ps ( InvR[k[0]+1], InvR[k[1]+1], InvR[k[2]+1], InvR[k[3]+1] );
+            _mm_storeu_ps ( result + i, _mm_add_ps ( lo, _mm_mul_ps ( _mm_sub_ps ( hi, lo ), f ) ) );
+
+            int inTableMask = _mm_movemask_ps ( inTable );
+            if ( inTableMask != 0xf )
+            {
+                for ( int lane = 0; lane < 4; lane++ )
+                {
+                    if ( !( inTableMask & ( 1 << lane ) ) )
+                    {
+                        result[i+lane] = lens.DistortionFnInverse ( r[i+lane] );
+                    }
+                }
+            }
+        }
+    }
+#endif
+
+    for ( ; i < count; i++ )
+    {
+        result[i] = DistortionFnInverse ( lens, r[i] );
+    }
+}
+
 
 
 float LensConfig::DistortionFnInverseApprox(float r) const
@@ -1435,7 +1677,20 @@ FovPort CalculateFovFromHmdInfo ( StereoEye eyeType,
                                   HmdRenderInfo const &hmd,
                                   float extraEyeRotationInRadians /*= 0.0f*/ )
 {
-    FovPort fovPort;
+    FovPort fovPort = CalculateLensFovFromHmdInfo ( eyeType, hmd, extraEyeRotationInRadians );
+
+    // clamp to the screen
+    fovPort = ClampToPhysicalScreenFov ( eyeType, distortion, fovPort );
+       
+    return fovPort;
+}
+
+
+
+FovPort CalculateLensFovFromHmdInfo ( StereoEye eyeType,
+                                      HmdRenderInfo const &hmd,
+                                      float extraEyeRotationInRadians /*= 0.0f*/ )
+{
     float eyeReliefInMeters;
     float offsetToRightInMeters;
     if ( eyeType == StereoEye_Right )
@@ -1455,16 +1710,11 @@ FovPort CalculateFovFromHmdInfo ( StereoEye eyeType,
     eyeReliefInMeters = Alg::Max(eyeReliefInMeters, 0.006f);
 
     // Central view.
-    fovPort = CalculateFovFromEyePosition ( eyeReliefInMeters,
-                                            offsetToRightInMeters,
-                                            0.0f,
-                                            hmd.LensDiameterInMeters,
-                                            extraEyeRotationInRadians );
-
-    // clamp to the screen
-    fovPort = ClampToPhysicalScreenFov ( eyeType, distortion, fovPort );
-       
-    return fovPort;
+    return CalculateFovFromEyePosition ( eyeReliefInMeters,
+                                         offsetToRightInMeters,
+                                         0.0f,
+                                         hmd.LensDiameterInMeters,
+                                         extraEyeRotationInRadians );
 }
 
 
@@ -1862,6 +2112,67 @@ Vector2f TransformRendertargetNDCToTanFovSpace( const ScaleAndOffset2D &eyeToSou
 }
 
 
+//-----------------------------------------------------------------------------------
+// Batched versions of the mappings above.
+
+void TransformScreenNDCToTanFovSpaceChromaBatch ( Vector2f *resultR, Vector2f *resultG, Vector2f *resultB,
+                                                  DistortionRenderDesc const &distortion,
+                                                  Vector2f const *framebufferNDC, int count )
+{
+    Vector2f tanEyeAngleDistorted[BatchChunkSize];
+    float    radiusSquared[BatchChunkSize];
+    float    scaleR[BatchChunkSize], scaleG[BatchChunkSize], scaleB[BatchChunkSize];
+
+    for ( int first = 0; first < count; first += BatchChunkSize )
+    {
+        int chunkCount = Alg::Min ( BatchChunkSize, count - first );
+        for ( int i = 0; i < chunkCount; i++ )
+        {
+            tanEyeAngleDistorted[i].x = ( framebufferNDC[first+i].x - distortion.LensCenter.x ) * distortion.TanEyeAngleScale.x;
+            tanEyeAngleDistorted[i].y = ( framebufferNDC[first+i].y - distortion.LensCenter.y ) * distortion.TanEyeAngleScale.y;
+            radiusSquared[i] = ( tanEyeAngleDistorted[i].x * tanEyeAngleDistorted[i].x )
+                             + ( tanEyeAngleDistorted[i].y * tanEyeAngleDistorted[i].y );
+        }
+        distortion.Lens.DistortionFnScaleRadiusSquaredChromaBatch ( radiusSquared, scaleR, scaleG, scaleB, chunkCount );
+        for ( int i = 0; i < chunkCount; i++ )
+        {
+            resultR[first+i] = tanEyeAngleDistorted[i] * scaleR[i];
+            resultG[first+i] = tanEyeAngleDistorted[i] * scaleG[i];
+            resultB[first+i] = tanEyeAngleDistorted[i] * scaleB[i];
+        }
+    }
+}
+
+void TransformTanFovSpaceToScreenNDCBatch ( Vector2f *framebufferNDC,
+                                            DistortionRenderDesc const &distortion,
+                                            LensInverseTable const &inverseTable,
+                                            Vector2f const *tanEyeAngle, int count )
+{
+    float tanEyeAngleRadius[BatchChunkSize];
+    float tanEyeAngleDistortedRadius[BatchChunkSize];
+
+    for ( int first = 0; first < count; first += BatchChunkSize )
+    {
+        int chunkCount = Alg::Min ( BatchChunkSize, count - first );
+        for ( int i = 0; i < chunkCount; i++ )
+        {
+            tanEyeAngleRadius[i] = tanEyeAngle[first+i].Length();
+        }
+        inverseTable.DistortionFnInverseBatch ( distortion.Lens, tanEyeAngleRadius, tanEyeAngleDistortedRadius, chunkCount );
+        for ( int i = 0; i < chunkCount; i++ )
+        {
+            Vector2f tanEyeAngleDistorted = tanEyeAngle[first+i];
+            if ( tanEyeAngleRadius[i] > 0.0f )
+            {
+                tanEyeAngleDistorted = tanEyeAngleDistorted * ( tanEyeAngleDistortedRadius[i] / tanEyeAngleRadius[i] );
+            }
+            framebufferNDC[first+i].x = ( tanEyeAngleDistorted.x / distortion.TanEyeAngleScale.x ) + distortion.LensCenter.x;
+            framebufferNDC[first+i].y = ( tanEyeAngleDistorted.y / distortion.TanEyeAngleScale.y ) + distortion.LensCenter.y;
+        }
+    }
+}
+
+
 
 } //namespace OVR
 
@@ -202,6 +202,14 @@ struct LensConfig
         return r * DistortionFnScaleRadiusSquared ( r * r );
     }
 
+    // Batched versions of the two above, for count values at a time. They give the same
+    // results as calling the single-value versions on each element, but use SIMD where available.
+    // The output arrays must not overlap rsq.
+    void DistortionFnScaleRadiusSquaredBatch ( float const *rsq, float *scale, int count ) const;
+    void DistortionFnScaleRadiusSquaredChromaBatch ( float const *rsq,
+                                                     float *scaleR, float *scaleG, float *scaleB,
+                                                     int count ) const;
+
     // DistortionFnInverse computes the inverse of the distortion function on an argument.
     float DistortionFnInverse(float r) const;
 
@@ -235,6 +243,39 @@ struct LensConfig
 };
 
 
+// Evaluates the lens spline on count values at once. See EvalCatmullRom10Spline.
+void EvalCatmullRom10SplineBatch ( float const *K, float const *scaledVal, float *result, int count );
+
+
+// A lookup table of LensConfig::DistortionFnInverse, for when a great many radii have to be
+// inverted against one lens (distortion meshes, CPU distortion, lookup textures).
+// Build() walks the forward function once; lookups then interpolate linearly between
+// NumSamples evenly spaced radii from 0 to MaxR. Radii beyond that, or beyond where the lens
+// stops being monotonic, fall back to the iterative LensConfig::DistortionFnInverse.
+struct LensInverseTable
+{
+    enum { NumSamples = 1024 };
+
+    LensInverseTable()
+      : MaxR(0.0f)
+      , RScale(0.0f)
+      , NumValid(0)
+    {
+    }
+
+    void  Build ( LensConfig const &lens, float maxR );
+
+    float DistortionFnInverse ( LensConfig const &lens, float r ) const;
+    // The output array must not overlap r.
+    void  DistortionFnInverseBatch ( LensConfig const &lens, float const *r, float *result, int count ) const;
+
+    float   MaxR;
+    float   RScale;                 // (NumSamples-1) / MaxR
+    int     NumValid;               // Entries of InvR that can be interpolated between.
+    float   InvR[NumSamples];       // InvR[i] is the distorted radius that DistortionFn maps to i / RScale.
+};
+
+
 // For internal use - storing and loading lens config data
 
 // Returns true on success.
@@ -584,6 +625,13 @@ FovPort             CalculateFovFromHmdInfo ( StereoEye eyeType,
                                               HmdRenderInfo const &hmd,
                                               float extraEyeRotationInRadians = OVR_DEFAULT_EXTRA_EYE_ROTATION );
 
+// The box around the lens that CalculateFovFromHmdInfo starts from, before it is clamped to the
+// screen. The lens is round, so directions outside the ellipse inscribed in the box are hidden
+// by its rim.
+FovPort             CalculateLensFovFromHmdInfo ( StereoEye eyeType,
+                                                  HmdRenderInfo const &hmd,
+                                                  float extraEyeRotationInRadians = OVR_DEFAULT_EXTRA_EYE_ROTATION );
+
 FovPort             GetPhysicalScreenFov ( StereoEye eyeType, DistortionRenderDesc const &distortion );
 
 FovPort             ClampToPhysicalScreenFov ( StereoEye eyeType, DistortionRenderDesc const &distortion,
@@ -664,6 +712,16 @@ Vector2f TransformTanFovSpaceToScreenNDC( DistortionRenderDesc const &distortion
 Vector2f TransformRendertargetNDCToTanFovSpace( const ScaleAndOffset2D &eyeToSourceNDC,
                                                 const Vector2f &textureNDC );
 
+// Batched versions, for count points at a time. The reverse mapping inverts the lens through
+// inverseTable, which must have been built from distortion.Lens.
+void TransformScreenNDCToTanFovSpaceChromaBatch ( Vector2f *resultR, Vector2f *resultG, Vector2f *resultB,
+                                                  DistortionRenderDesc const &distortion,
+                                                  Vector2f const *framebufferNDC, int count );
+void TransformTanFovSpaceToScreenNDCBatch ( Vector2f *framebufferNDC,
+                                            DistortionRenderDesc const &distortion,
+                                            LensInverseTable const &inverseTable,
+                                            Vector2f const *tanEyeAngle, int count );
+
 // Handy wrappers.
 inline Vector2f TransformTanFovSpaceToRendertargetTexUV ( StereoEyeParams const &eyeParams,
                                                           Vector2f const &tanEyeAngle )
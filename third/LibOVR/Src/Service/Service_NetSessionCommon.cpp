@@ -339,5 +339,17 @@ bool NetSessionCommon::IsServiceProperty(EGetterSetters e, const char* key)
     return false;
 }
 
+bool NetSessionCommon::HasBypassPrefix(const char* key)
+{
+    return strncmp(key, BypassPrefix, strlen(BypassPrefix)) == 0;
+}
+
+const char** NetSessionCommon::GetServiceKeyNames(EGetterSetters e)
+{
+    static const char* NoKeyNames[] = { 0 };
+
+    return (e >= 0 && e < ENumTypes) ? KeyNames[e] : NoKeyNames;
+}
+
 
 }} // namespace OVR::Service
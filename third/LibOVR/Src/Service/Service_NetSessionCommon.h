@@ -130,6 +130,11 @@ public:
     static const char* FilterKeyPrefix(const char* key);
     static bool IsServiceProperty(EGetterSetters e, const char* key);
 
+    // True if key starts with the prefix that sends any key to the service
+    static bool HasBypassPrefix(const char* key);
+    // The NULL terminated keys the service handles for e without the prefix
+    static const char** GetServiceKeyNames(EGetterSetters e);
+
 protected:
     bool                Terminated; // Thread termination flag
     Net::Session*       pSession;   // Networking session
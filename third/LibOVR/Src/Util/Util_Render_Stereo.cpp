@@ -25,6 +25,12 @@ limitations under the License.
 *************************************************************************************/
 
 #include "Util_Render_Stereo.h"
+#include "../Kernel/OVR_CRC32.h"
+#include "../Kernel/OVR_Log.h"
+#include "../Kernel/OVR_SysFile.h"
+#include "../Kernel/OVR_Threads.h"
+
+#include <stdio.h>
 
 namespace OVR { namespace Util { namespace Render {
 
@@ -789,13 +795,59 @@ static const int DMA_GridSizeLog2   = 6;
 static const int DMA_GridSize       = 1<<DMA_GridSizeLog2;
 static const int DMA_NumVertsPerEye = (DMA_GridSize+1)*(DMA_GridSize+1);
 static const int DMA_NumTrisPerEye  = (DMA_GridSize)*(DMA_GridSize)*2;
+// Every vertex solves the inverse distortion, so rows are shared out between this many threads at most.
+static const int DMA_MaxThreads     = 8;
 
 
 
-DistortionMeshVertexData DistortionMeshMakeVertex ( Vector2f screenNDC,
-                                                    bool rightEye,
-                                                    const HmdRenderInfo &hmdRenderInfo,
-                                                    const DistortionRenderDesc &distortion, const ScaleAndOffset2D &eyeToSourceNDC )
+// The fade-to-black at the edges of the view. The furthest out texture coordinate is the
+// blue channel's, because of chromatic aberration (true of any standard lens).
+static float DistortionMeshShade ( Vector2f screenNDC, Vector2f tanEyeAnglesB,
+                                   bool rightEye,
+                                   const HmdRenderInfo &hmdRenderInfo, const ScaleAndOffset2D &eyeToSourceNDC )
+{
+    // When does the fade-to-black edge start? Chosen heuristically.
+    float fadeOutBorderFractionTexture = 0.1f;
+    float fadeOutBorderFractionTextureInnerEdge = 0.1f;
+    float fadeOutBorderFractionScreen = 0.1f;
+    float fadeOutFloor = 0.6f;        // the floor controls how much black is in the fade region
+
+    if (hmdRenderInfo.HmdType == HmdType_DK1)
+    {
+        fadeOutBorderFractionTexture = 0.3f;
+        fadeOutBorderFractionTextureInnerEdge = 0.075f;
+        fadeOutBorderFractionScreen = 0.075f;
+        fadeOutFloor = 0.25f;
+    }
+
+    // Fade out at texture edges.
+    Vector2f sourceTexCoordBlueNDC = TransformTanFovSpaceToRendertargetNDC ( eyeToSourceNDC, tanEyeAnglesB );
+	if (rightEye)
+	{
+		// The inner edge of the eye texture is usually much more magnified, because it's right against the middle of the screen, not the FOV edge.
+		// So we want a different scaling factor for that. This code flips the texture NDC so that +1.0 is the inner edge
+		sourceTexCoordBlueNDC.x = -sourceTexCoordBlueNDC.x;
+	}
+    float edgeFadeIn               = ( 1.0f / fadeOutBorderFractionTextureInnerEdge ) * ( 1.0f - sourceTexCoordBlueNDC.x )  ;   // Inner
+    edgeFadeIn       = Alg::Min ( edgeFadeIn, ( 1.0f / fadeOutBorderFractionTexture ) * ( 1.0f + sourceTexCoordBlueNDC.x ) );   // Outer
+    edgeFadeIn       = Alg::Min ( edgeFadeIn, ( 1.0f / fadeOutBorderFractionTexture ) * ( 1.0f - sourceTexCoordBlueNDC.y ) );   // Upper
+    edgeFadeIn       = Alg::Min ( edgeFadeIn, ( 1.0f / fadeOutBorderFractionTexture ) * ( 1.0f + sourceTexCoordBlueNDC.y ) );   // Lower
+
+    // Also fade out at screen edges. Since this is in pixel space, no need to do inner specially.
+    float edgeFadeInScreen = ( 1.0f / fadeOutBorderFractionScreen ) *
+                             ( 1.0f - Alg::Max ( Alg::Abs ( screenNDC.x ), Alg::Abs ( screenNDC.y ) ) );
+    edgeFadeIn = Alg::Min ( edgeFadeInScreen, edgeFadeIn ) + fadeOutFloor;
+
+	// Note - this is NOT clamped negatively.
+	// For rendering methods that interpolate over a coarse grid, we need the values to go negative for correct intersection with zero.
+    return Alg::Min ( edgeFadeIn, 1.0f );
+}
+
+static DistortionMeshVertexData DistortionMeshMakeVertexFromTanEyeAngles ( Vector2f screenNDC,
+                                                                           Vector2f tanEyeAnglesR, Vector2f tanEyeAnglesG, Vector2f tanEyeAnglesB,
+                                                                           bool rightEye,
+                                                                           const HmdRenderInfo &hmdRenderInfo,
+                                                                           const ScaleAndOffset2D &eyeToSourceNDC )
 {
     DistortionMeshVertexData result;
 
@@ -805,10 +857,6 @@ DistortionMeshVertexData DistortionMeshMakeVertex ( Vector2f screenNDC,
         xOffset = 1.0f;
     }
 
-    Vector2f tanEyeAnglesR, tanEyeAnglesG, tanEyeAnglesB;
-    TransformScreenNDCToTanFovSpaceChroma ( &tanEyeAnglesR, &tanEyeAnglesG, &tanEyeAnglesB,
-                                            distortion, screenNDC );
-
 	result.TanEyeAnglesR = tanEyeAnglesR;
 	result.TanEyeAnglesG = tanEyeAnglesG;
 	result.TanEyeAnglesB = tanEyeAnglesB;
@@ -842,46 +890,100 @@ DistortionMeshVertexData DistortionMeshMakeVertex ( Vector2f screenNDC,
     default: OVR_ASSERT ( false ); break;
     }
 
-    // When does the fade-to-black edge start? Chosen heuristically.
-    float fadeOutBorderFractionTexture = 0.1f;
-    float fadeOutBorderFractionTextureInnerEdge = 0.1f;
-    float fadeOutBorderFractionScreen = 0.1f;
-    float fadeOutFloor = 0.6f;        // the floor controls how much black is in the fade region
+    result.Shade = DistortionMeshShade ( screenNDC, tanEyeAnglesB, rightEye, hmdRenderInfo, eyeToSourceNDC );
+    result.ScreenPosNDC.x = 0.5f * screenNDC.x - 0.5f + xOffset;
+    result.ScreenPosNDC.y = -screenNDC.y;
 
-    if (hmdRenderInfo.HmdType == HmdType_DK1)
+    return result;
+}
+
+DistortionMeshVertexData DistortionMeshMakeVertex ( Vector2f screenNDC,
+                                                    bool rightEye,
+                                                    const HmdRenderInfo &hmdRenderInfo,
+                                                    const DistortionRenderDesc &distortion, const ScaleAndOffset2D &eyeToSourceNDC )
+{
+    Vector2f tanEyeAnglesR, tanEyeAnglesG, tanEyeAnglesB;
+    TransformScreenNDCToTanFovSpaceChroma ( &tanEyeAnglesR, &tanEyeAnglesG, &tanEyeAnglesB,
+                                            distortion, screenNDC );
+
+    return DistortionMeshMakeVertexFromTanEyeAngles ( screenNDC, tanEyeAnglesR, tanEyeAnglesG, tanEyeAnglesB,
+                                                      rightEye, hmdRenderInfo, eyeToSourceNDC );
+}
+
+// The largest tan angle radius any part of the eye's source image is at, which is as far
+// as meshes and CPU distortion have to invert the lens.
+static float DistortionMaxTanEyeAngleRadius ( const ScaleAndOffset2D &eyeToSourceNDC )
+{
+    float maxRadius = 0.0f;
+    for ( int corner = 0; corner < 4; corner++ )
     {
-        fadeOutBorderFractionTexture = 0.3f;
-        fadeOutBorderFractionTextureInnerEdge = 0.075f;
-        fadeOutBorderFractionScreen = 0.075f;
-        fadeOutFloor = 0.25f;
+        Vector2f cornerNDC ( ( corner & 1 ) ? 1.0f : -1.0f, ( corner & 2 ) ? 1.0f : -1.0f );
+        maxRadius = Alg::Max ( maxRadius, TransformRendertargetNDCToTanFovSpace ( eyeToSourceNDC, cornerNDC ).Length() );
     }
+    return maxRadius;
+}
 
-    // Fade out at texture edges.
-    // The furthest out will be the blue channel, because of chromatic aberration (true of any standard lens)
-    Vector2f sourceTexCoordBlueNDC = TransformTanFovSpaceToRendertargetNDC ( eyeToSourceNDC, tanEyeAnglesB );
-	if (rightEye)
-	{
-		// The inner edge of the eye texture is usually much more magnified, because it's right against the middle of the screen, not the FOV edge.
-		// So we want a different scaling factor for that. This code flips the texture NDC so that +1.0 is the inner edge
-		sourceTexCoordBlueNDC.x = -sourceTexCoordBlueNDC.x;
-	}
-    float edgeFadeIn               = ( 1.0f / fadeOutBorderFractionTextureInnerEdge ) * ( 1.0f - sourceTexCoordBlueNDC.x )  ;   // Inner
-    edgeFadeIn       = Alg::Min ( edgeFadeIn, ( 1.0f / fadeOutBorderFractionTexture ) * ( 1.0f + sourceTexCoordBlueNDC.x ) );   // Outer
-    edgeFadeIn       = Alg::Min ( edgeFadeIn, ( 1.0f / fadeOutBorderFractionTexture ) * ( 1.0f - sourceTexCoordBlueNDC.y ) );   // Upper
-    edgeFadeIn       = Alg::Min ( edgeFadeIn, ( 1.0f / fadeOutBorderFractionTexture ) * ( 1.0f + sourceTexCoordBlueNDC.y ) );   // Lower
 
-    // Also fade out at screen edges. Since this is in pixel space, no need to do inner specially.
-    float edgeFadeInScreen = ( 1.0f / fadeOutBorderFractionScreen ) *
-                             ( 1.0f - Alg::Max ( Alg::Abs ( screenNDC.x ), Alg::Abs ( screenNDC.y ) ) );
-    edgeFadeIn = Alg::Min ( edgeFadeInScreen, edgeFadeIn ) + fadeOutFloor;
+// A band of rows of the mesh, made by one thread.
+struct DistortionMeshRowJob
+{
+    DistortionMeshVertexData   *pVertices;
+    int                         FirstRow;
+    int                         EndRow;
+    bool                        RightEye;
+    const HmdRenderInfo        *pHmdRenderInfo;
+    const DistortionRenderDesc *pDistortion;
+    const ScaleAndOffset2D     *pEyeToSourceNDC;
+    const LensInverseTable     *pInverseTable;
+};
 
-	// Note - this is NOT clamped negatively.
-	// For rendering methods that interpolate over a coarse grid, we need the values to go negative for correct intersection with zero.
-    result.Shade = Alg::Min ( edgeFadeIn, 1.0f );
-    result.ScreenPosNDC.x = 0.5f * screenNDC.x - 0.5f + xOffset;
-    result.ScreenPosNDC.y = -screenNDC.y;
+// Each stage runs over a whole row before the next one starts, so a row is a batch of
+// independent points for the batched lens functions.
+static void DistortionMeshMakeRows ( const DistortionMeshRowJob &job )
+{
+    Vector2f tanEyeAngle[DMA_GridSize+1];
+    Vector2f screenNDC[DMA_GridSize+1];
+    Vector2f tanEyeAnglesR[DMA_GridSize+1], tanEyeAnglesG[DMA_GridSize+1], tanEyeAnglesB[DMA_GridSize+1];
 
-    return result;
+    for ( int y = job.FirstRow; y < job.EndRow; y++ )
+    {
+        for ( int x = 0; x <= DMA_GridSize; x++ )
+        {
+            Vector2f sourceCoordNDC;
+            // NDC texture coords [-1,+1]
+            sourceCoordNDC.x = 2.0f * ( (float)x / (float)DMA_GridSize ) - 1.0f;
+            sourceCoordNDC.y = 2.0f * ( (float)y / (float)DMA_GridSize ) - 1.0f;
+            tanEyeAngle[x] = TransformRendertargetNDCToTanFovSpace ( *job.pEyeToSourceNDC, sourceCoordNDC );
+        }
+
+        // Find the corresponding screen positions.
+        // Note - this does not have to be precise - we're just trying to match the mesh tessellation
+        // with the shape of the distortion to minimise the number of trianlges needed.
+        TransformTanFovSpaceToScreenNDCBatch ( screenNDC, *job.pDistortion, *job.pInverseTable, tanEyeAngle, DMA_GridSize+1 );
+        for ( int x = 0; x <= DMA_GridSize; x++ )
+        {
+            // ...but don't let verts overlap to the other eye.
+            screenNDC[x].x = Alg::Max ( -1.0f, Alg::Min ( screenNDC[x].x, 1.0f ) );
+            screenNDC[x].y = Alg::Max ( -1.0f, Alg::Min ( screenNDC[x].y, 1.0f ) );
+        }
+
+        // From those screen positions, generate the vertices.
+        TransformScreenNDCToTanFovSpaceChromaBatch ( tanEyeAnglesR, tanEyeAnglesG, tanEyeAnglesB,
+                                                     *job.pDistortion, screenNDC, DMA_GridSize+1 );
+        DistortionMeshVertexData* pcurVert = job.pVertices + y * (DMA_GridSize+1);
+        for ( int x = 0; x <= DMA_GridSize; x++ )
+        {
+            *pcurVert++ = DistortionMeshMakeVertexFromTanEyeAngles ( screenNDC[x], tanEyeAnglesR[x], tanEyeAnglesG[x], tanEyeAnglesB[x],
+                                                                     job.RightEye, *job.pHmdRenderInfo, *job.pEyeToSourceNDC );
+        }
+    }
+}
+
+static int DistortionMeshRowThreadFn ( Thread *pthread, void *h )
+{
+    OVR_UNUSED1 ( pthread );
+    DistortionMeshMakeRows ( *(const DistortionMeshRowJob*)h );
+    return 0;
 }
 
 
@@ -943,31 +1045,44 @@ void DistortionMeshCreate( DistortionMeshVertexData **ppVertices, uint16_t **ppT
 
     // Populate vertex buffer info
 
-    // First pass - build up raw vertex data.
-    DistortionMeshVertexData* pcurVert = *ppVertices;
+    // Every vertex inverts the lens, so do it through a table.
+    LensInverseTable inverseTable;
+    inverseTable.Build ( distortion.Lens, DistortionMaxTanEyeAngleRadius ( eyeToSourceNDC ) * 1.01f );
 
-    for ( int y = 0; y <= DMA_GridSize; y++ )
+    // First pass - build up raw vertex data, a band of rows per thread.
+    // The calling thread takes the first band itself.
+    int threadCount = Alg::Max ( 1, Alg::Min ( Thread::GetCPUCount(), DMA_MaxThreads ) );
+    DistortionMeshRowJob jobs[DMA_MaxThreads];
+    Ptr<Thread> threads[DMA_MaxThreads];
+    for ( int jobNum = 0; jobNum < threadCount; jobNum++ )
     {
-        for ( int x = 0; x <= DMA_GridSize; x++ )
+        DistortionMeshRowJob &job = jobs[jobNum];
+        job.pVertices       = *ppVertices;
+        job.FirstRow        = ( (DMA_GridSize+1) * jobNum ) / threadCount;
+        job.EndRow          = ( (DMA_GridSize+1) * ( jobNum + 1 ) ) / threadCount;
+        job.RightEye        = rightEye;
+        job.pHmdRenderInfo  = &hmdRenderInfo;
+        job.pDistortion     = &distortion;
+        job.pEyeToSourceNDC = &eyeToSourceNDC;
+        job.pInverseTable   = &inverseTable;
+
+        if ( jobNum > 0 )
         {
-
-            Vector2f sourceCoordNDC;
-            // NDC texture coords [-1,+1]
-            sourceCoordNDC.x = 2.0f * ( (float)x / (float)DMA_GridSize ) - 1.0f;
-            sourceCoordNDC.y = 2.0f * ( (float)y / (float)DMA_GridSize ) - 1.0f;
-            Vector2f tanEyeAngle = TransformRendertargetNDCToTanFovSpace ( eyeToSourceNDC, sourceCoordNDC );
-
-            // Find a corresponding screen position.
-            // Note - this function does not have to be precise - we're just trying to match the mesh tessellation
-            // with the shape of the distortion to minimise the number of trianlges needed.
-            Vector2f screenNDC = TransformTanFovSpaceToScreenNDC ( distortion, tanEyeAngle, false );
-            // ...but don't let verts overlap to the other eye.
-            screenNDC.x = Alg::Max ( -1.0f, Alg::Min ( screenNDC.x, 1.0f ) );
-            screenNDC.y = Alg::Max ( -1.0f, Alg::Min ( screenNDC.y, 1.0f ) );
-
-            // From those screen positions, generate the vertex.
-            *pcurVert = DistortionMeshMakeVertex ( screenNDC, rightEye, hmdRenderInfo, distortion, eyeToSourceNDC );
-            pcurVert++;
+            threads[jobNum] = *new Thread ( DistortionMeshRowThreadFn, &job );
+            if ( !threads[jobNum]->Start() )
+            {
+                // No thread to spare - just do it here.
+                threads[jobNum].Clear();
+                DistortionMeshMakeRows ( job );
+            }
+        }
+    }
+    DistortionMeshMakeRows ( jobs[0] );
+    for ( int jobNum = 1; jobNum < threadCount; jobNum++ )
+    {
+        if ( threads[jobNum] )
+        {
+            threads[jobNum]->Join();
         }
     }
 
@@ -1041,6 +1156,341 @@ void DistortionMeshCreate( DistortionMeshVertexData **ppVertices, uint16_t **ppT
     }
 }
 
+
+//-----------------------------------------------------------------------------------
+// *****  Distortion Mesh Cache
+
+static const uint32_t DMA_CacheMagic    = 0x4D44564F;   // "OVDM"
+// Bump whenever DistortionMeshCreate would make a different mesh from the same inputs.
+static const uint32_t DMA_CacheVersion  = 2;
+
+// Everything the mesh depends on. The eye relief of the profile is already folded into
+// the lens config. All fields are 4 bytes, so there is no padding to hash.
+struct DistortionMeshCacheKey
+{
+    uint32_t    Magic;
+    uint32_t    Version;
+    int32_t     GridSizeLog2;
+    int32_t     RightEye;
+    int32_t     HmdType;
+    int32_t     ShutterType;
+    int32_t     LensEqn;
+    float       LensK[LensConfig::NumCoefficients];
+    float       LensMaxR;
+    float       LensMetersPerTanAngleAtCenter;
+    float       LensChromaticAberration[4];
+    float       LensCenter[2];
+    float       TanEyeAngleScale[2];
+    float       EyeToSourceNDC[4];
+};
+
+static void DistortionMeshMakeCacheKey ( DistortionMeshCacheKey *pkey, bool rightEye,
+                                         const HmdRenderInfo &hmdRenderInfo,
+                                         const DistortionRenderDesc &distortion, const ScaleAndOffset2D &eyeToSourceNDC )
+{
+    memset ( pkey, 0, sizeof(*pkey) );
+    pkey->Magic         = DMA_CacheMagic;
+    pkey->Version       = DMA_CacheVersion;
+    pkey->GridSizeLog2  = DMA_GridSizeLog2;
+    pkey->RightEye      = rightEye ? 1 : 0;
+    pkey->HmdType       = (int32_t)hmdRenderInfo.HmdType;
+    pkey->ShutterType   = (int32_t)hmdRenderInfo.Shutter.Type;
+    pkey->LensEqn       = (int32_t)distortion.Lens.Eqn;
+    memcpy ( pkey->LensK, distortion.Lens.K, sizeof(pkey->LensK) );
+    pkey->LensMaxR      = distortion.Lens.MaxR;
+    pkey->LensMetersPerTanAngleAtCenter = distortion.Lens.MetersPerTanAngleAtCenter;
+    memcpy ( pkey->LensChromaticAberration, distortion.Lens.ChromaticAberration, sizeof(pkey->LensChromaticAberration) );
+    pkey->LensCenter[0]         = distortion.LensCenter.x;
+    pkey->LensCenter[1]         = distortion.LensCenter.y;
+    pkey->TanEyeAngleScale[0]   = distortion.TanEyeAngleScale.x;
+    pkey->TanEyeAngleScale[1]   = distortion.TanEyeAngleScale.y;
+    pkey->EyeToSourceNDC[0]     = eyeToSourceNDC.Scale.x;
+    pkey->EyeToSourceNDC[1]     = eyeToSourceNDC.Scale.y;
+    pkey->EyeToSourceNDC[2]     = eyeToSourceNDC.Offset.x;
+    pkey->EyeToSourceNDC[3]     = eyeToSourceNDC.Offset.y;
+}
+
+// The file is the key, then the vertices and the indices. The whole key is compared on
+// load, so a CRC collision in the file name only costs a rebuild.
+static bool DistortionMeshLoadCached ( const String &path, const DistortionMeshCacheKey &key,
+                                       DistortionMeshVertexData *pVertices, uint16_t *pTriangleListIndices )
+{
+    SysFile f;
+    if ( !f.Open ( path, File::Open_Read, File::Mode_Read ) )
+    {
+        return false;
+    }
+
+    const int vertexBytes = (int)sizeof(DistortionMeshVertexData) * DMA_NumVertsPerEye;
+    const int indexBytes  = (int)sizeof(uint16_t) * DMA_NumTrisPerEye * 3;
+    DistortionMeshCacheKey fileKey;
+    bool loaded = ( f.GetLength() == (int)sizeof(fileKey) + vertexBytes + indexBytes ) &&
+                  ( f.Read ( (uint8_t*)&fileKey, sizeof(fileKey) ) == (int)sizeof(fileKey) ) &&
+                  ( memcmp ( &fileKey, &key, sizeof(key) ) == 0 ) &&
+                  ( f.Read ( (uint8_t*)pVertices, vertexBytes ) == vertexBytes ) &&
+                  ( f.Read ( (uint8_t*)pTriangleListIndices, indexBytes ) == indexBytes );
+    f.Close();
+    return loaded;
+}
+
+// Written next to the final name and then swapped in, so a second process starting up
+// never loads a half written mesh, and a crash mid write leaves no file behind.
+static void DistortionMeshSaveCached ( const String &path, const DistortionMeshCacheKey &key,
+                                       const DistortionMeshVertexData *pVertices, const uint16_t *pTriangleListIndices )
+{
+    String tempPath ( path );
+    tempPath += ".tmp";
+
+    SysFile f;
+    if ( !f.Open ( tempPath, File::Open_Write | File::Open_Create | File::Open_Truncate, File::Mode_ReadWrite ) )
+    {
+        LogError ( "{ERR-101} [DistortionMeshCache] Cannot write %s", tempPath.ToCStr() );
+        return;
+    }
+
+    const int vertexBytes = (int)sizeof(DistortionMeshVertexData) * DMA_NumVertsPerEye;
+    const int indexBytes  = (int)sizeof(uint16_t) * DMA_NumTrisPerEye * 3;
+    bool written = ( f.Write ( (const uint8_t*)&key, sizeof(key) ) == (int)sizeof(key) ) &&
+                   ( f.Write ( (const uint8_t*)pVertices, vertexBytes ) == vertexBytes ) &&
+                   ( f.Write ( (const uint8_t*)pTriangleListIndices, indexBytes ) == indexBytes );
+    written = f.Close() && written;
+
+    // rename does not replace an existing file on Windows
+    remove ( path.ToCStr() );
+    if ( !written || rename ( tempPath.ToCStr(), path.ToCStr() ) != 0 )
+    {
+        LogError ( "{ERR-101} [DistortionMeshCache] Cannot write %s", path.ToCStr() );
+        remove ( tempPath.ToCStr() );
+    }
+}
+
+void DistortionMeshCreateCached( DistortionMeshVertexData **ppVertices, uint16_t **ppTriangleListIndices,
+                                 int *pNumVertices, int *pNumTriangles,
+                                 bool rightEye,
+                                 const HmdRenderInfo &hmdRenderInfo,
+                                 const DistortionRenderDesc &distortion, const ScaleAndOffset2D &eyeToSourceNDC,
+                                 const char *cacheDir )
+{
+    if ( !cacheDir || !cacheDir[0] )
+    {
+        DistortionMeshCreate ( ppVertices, ppTriangleListIndices, pNumVertices, pNumTriangles,
+                               rightEye, hmdRenderInfo, distortion, eyeToSourceNDC );
+        return;
+    }
+
+    DistortionMeshCacheKey key;
+    DistortionMeshMakeCacheKey ( &key, rightEye, hmdRenderInfo, distortion, eyeToSourceNDC );
+
+    char fileName[64];
+    OVR_sprintf ( fileName, sizeof(fileName), "/DistortionMesh_%08x.bin", CRC32_Calculate ( &key, sizeof(key) ) );
+    String path ( cacheDir );
+    path += fileName;
+
+    *ppVertices = (DistortionMeshVertexData*)
+                      OVR_ALLOC( sizeof(DistortionMeshVertexData) * DMA_NumVertsPerEye );
+    *ppTriangleListIndices  = (uint16_t*) OVR_ALLOC( sizeof(uint16_t) * DMA_NumTrisPerEye * 3 );
+
+    if ( *ppVertices && *ppTriangleListIndices &&
+         DistortionMeshLoadCached ( path, key, *ppVertices, *ppTriangleListIndices ) )
+    {
+        *pNumVertices  = DMA_NumVertsPerEye;
+        *pNumTriangles = DMA_NumTrisPerEye;
+        return;
+    }
+
+    if ( *ppVertices )
+    {
+        OVR_FREE(*ppVertices);
+    }
+    if ( *ppTriangleListIndices )
+    {
+        OVR_FREE(*ppTriangleListIndices);
+    }
+
+    DistortionMeshCreate ( ppVertices, ppTriangleListIndices, pNumVertices, pNumTriangles,
+                           rightEye, hmdRenderInfo, distortion, eyeToSourceNDC );
+    if ( *ppVertices )
+    {
+        DistortionMeshSaveCached ( path, key, *ppVertices, *ppTriangleListIndices );
+    }
+}
+
+
+//-----------------------------------------------------------------------------------
+// *****  CPU Distortion Rendering
+
+// Pixels of a row go through the lens functions this many at a time.
+static const int DCR_ChunkSize = 64;
+
+// A band of rows of one eye's half of the frame, drawn by one thread.
+struct DistortionCpuRowJob
+{
+    uint8_t                    *pFrame;
+    Sizei                       FrameSize;
+    const uint8_t              *pEyeImage;
+    Sizei                       EyeImageSize;
+    int                         FirstRow;
+    int                         EndRow;
+    bool                        RightEye;
+    const HmdRenderInfo        *pHmdRenderInfo;
+    const DistortionRenderDesc *pDistortion;
+    const ScaleAndOffset2D     *pEyeToSourceNDC;
+    const ScaleAndOffset2D     *pEyeToSourceUV;
+    bool                        Chromatic;
+    bool                        Vignette;
+    bool                        LinearFilter;
+};
+
+static inline int DistortionCpuWrap ( int i, int size )
+{
+    i %= size;
+    return ( i < 0 ) ? i + size : i;
+}
+
+// One channel of the eye image at uv, with repeat wrapping.
+static float DistortionCpuSample ( const DistortionCpuRowJob &job, Vector2f uv, int channel )
+{
+    const int w = job.EyeImageSize.w;
+    const int h = job.EyeImageSize.h;
+    const uint8_t *pImage = job.pEyeImage;
+
+    if ( !job.LinearFilter )
+    {
+        int x = DistortionCpuWrap ( (int)floorf ( uv.x * (float)w ), w );
+        int y = DistortionCpuWrap ( (int)floorf ( uv.y * (float)h ), h );
+        return (float)pImage[ ( y * w + x ) * 4 + channel ];
+    }
+
+    float fx = uv.x * (float)w - 0.5f;
+    float fy = uv.y * (float)h - 0.5f;
+    float fx0 = floorf ( fx );
+    float fy0 = floorf ( fy );
+    float tx = fx - fx0;
+    float ty = fy - fy0;
+    int x0 = DistortionCpuWrap ( (int)fx0, w );
+    int y0 = DistortionCpuWrap ( (int)fy0, h );
+    int x1 = ( x0 + 1 < w ) ? x0 + 1 : 0;
+    int y1 = ( y0 + 1 < h ) ? y0 + 1 : 0;
+
+    float top    = (float)pImage[ ( y0 * w + x0 ) * 4 + channel ] * ( 1.0f - tx ) + (float)pImage[ ( y0 * w + x1 ) * 4 + channel ] * tx;
+    float bottom = (float)pImage[ ( y1 * w + x0 ) * 4 + channel ] * ( 1.0f - tx ) + (float)pImage[ ( y1 * w + x1 ) * 4 + channel ] * tx;
+    return top * ( 1.0f - ty ) + bottom * ty;
+}
+
+static void DistortionCpuMakeRows ( const DistortionCpuRowJob &job )
+{
+    Vector2f screenNDC[DCR_ChunkSize];
+    Vector2f tanEyeAnglesR[DCR_ChunkSize], tanEyeAnglesG[DCR_ChunkSize], tanEyeAnglesB[DCR_ChunkSize];
+
+    // Same placement as the mesh's ScreenPosNDC: each eye has half the frame, and rows run
+    // bottom to top as screen NDC y goes from +1 to -1.
+    int   firstColumn = job.RightEye ? job.FrameSize.w / 2 : 0;
+    int   endColumn   = job.RightEye ? job.FrameSize.w : job.FrameSize.w / 2;
+    float xOffset     = job.RightEye ? 1.0f : 0.0f;
+
+    for ( int y = job.FirstRow; y < job.EndRow; y++ )
+    {
+        float clipY = -1.0f + 2.0f * ( ( (float)y + 0.5f ) / (float)job.FrameSize.h );
+        uint8_t *pRow = job.pFrame + ( (size_t)y * job.FrameSize.w ) * 4;
+
+        for ( int firstX = firstColumn; firstX < endColumn; firstX += DCR_ChunkSize )
+        {
+            int chunkCount = Alg::Min ( DCR_ChunkSize, endColumn - firstX );
+            for ( int i = 0; i < chunkCount; i++ )
+            {
+                float clipX = -1.0f + 2.0f * ( ( (float)( firstX + i ) + 0.5f ) / (float)job.FrameSize.w );
+                screenNDC[i].x = 2.0f * ( clipX + 0.5f - xOffset );
+                screenNDC[i].y = -clipY;
+            }
+            TransformScreenNDCToTanFovSpaceChromaBatch ( tanEyeAnglesR, tanEyeAnglesG, tanEyeAnglesB,
+                                                         *job.pDistortion, screenNDC, chunkCount );
+
+            for ( int i = 0; i < chunkCount; i++ )
+            {
+                float shade = 1.0f;
+                if ( job.Vignette )
+                {
+                    shade = DistortionMeshShade ( screenNDC[i], tanEyeAnglesB[i], job.RightEye,
+                                                  *job.pHmdRenderInfo, *job.pEyeToSourceNDC );
+                    shade = Alg::Max ( 0.0f, shade );
+                }
+
+                Vector2f uvG = TransformTanFovSpaceToRendertargetTexUV ( *job.pEyeToSourceUV, tanEyeAnglesG[i] );
+                Vector2f uvR = job.Chromatic ? TransformTanFovSpaceToRendertargetTexUV ( *job.pEyeToSourceUV, tanEyeAnglesR[i] ) : uvG;
+                Vector2f uvB = job.Chromatic ? TransformTanFovSpaceToRendertargetTexUV ( *job.pEyeToSourceUV, tanEyeAnglesB[i] ) : uvG;
+
+                uint8_t *pPixel = pRow + ( firstX + i ) * 4;
+                pPixel[0] = (uint8_t)( DistortionCpuSample ( job, uvR, 0 ) * shade + 0.5f );
+                pPixel[1] = (uint8_t)( DistortionCpuSample ( job, uvG, 1 ) * shade + 0.5f );
+                pPixel[2] = (uint8_t)( DistortionCpuSample ( job, uvB, 2 ) * shade + 0.5f );
+                pPixel[3] = 255;
+            }
+        }
+    }
+}
+
+static int DistortionCpuRowThreadFn ( Thread *pthread, void *h )
+{
+    OVR_UNUSED1 ( pthread );
+    DistortionCpuMakeRows ( *(const DistortionCpuRowJob*)h );
+    return 0;
+}
+
+void DistortionRenderCpu ( uint8_t *pFrame, Sizei const &frameSize,
+                           const uint8_t *pEyeImage, Sizei const &eyeImageSize,
+                           bool rightEye,
+                           const HmdRenderInfo &hmdRenderInfo,
+                           const DistortionRenderDesc &distortion,
+                           const ScaleAndOffset2D &eyeToSourceNDC, const ScaleAndOffset2D &eyeToSourceUV,
+                           bool chromatic, bool vignette, bool linearFilter )
+{
+    if ( !pFrame || !pEyeImage || frameSize.w < 2 || frameSize.h < 1 || eyeImageSize.w < 1 || eyeImageSize.h < 1 )
+    {
+        return;
+    }
+
+    // A band of rows per thread, the calling thread taking the first, as for meshes.
+    int threadCount = Alg::Max ( 1, Alg::Min ( Thread::GetCPUCount(), DMA_MaxThreads ) );
+    DistortionCpuRowJob jobs[DMA_MaxThreads];
+    Ptr<Thread> threads[DMA_MaxThreads];
+    for ( int jobNum = 0; jobNum < threadCount; jobNum++ )
+    {
+        DistortionCpuRowJob &job = jobs[jobNum];
+        job.pFrame          = pFrame;
+        job.FrameSize       = frameSize;
+        job.pEyeImage       = pEyeImage;
+        job.EyeImageSize    = eyeImageSize;
+        job.FirstRow        = ( frameSize.h * jobNum ) / threadCount;
+        job.EndRow          = ( frameSize.h * ( jobNum + 1 ) ) / threadCount;
+        job.RightEye        = rightEye;
+        job.pHmdRenderInfo  = &hmdRenderInfo;
+        job.pDistortion     = &distortion;
+        job.pEyeToSourceNDC = &eyeToSourceNDC;
+        job.pEyeToSourceUV  = &eyeToSourceUV;
+        job.Chromatic       = chromatic;
+        job.Vignette        = vignette;
+        job.LinearFilter    = linearFilter;
+
+        if ( jobNum > 0 )
+        {
+            threads[jobNum] = *new Thread ( DistortionCpuRowThreadFn, &job );
+            if ( !threads[jobNum]->Start() )
+            {
+                threads[jobNum].Clear();
+                DistortionCpuMakeRows ( job );
+            }
+        }
+    }
+    DistortionCpuMakeRows ( jobs[0] );
+    for ( int jobNum = 1; jobNum < threadCount; jobNum++ )
+    {
+        if ( threads[jobNum] )
+        {
+            threads[jobNum]->Join();
+        }
+    }
+}
+
 //-----------------------------------------------------------------------------------
 // *****  Heightmap Mesh Rendering
 
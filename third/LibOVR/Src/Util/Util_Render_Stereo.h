@@ -346,9 +346,36 @@ void DistortionMeshCreate( DistortionMeshVertexData **ppVertices, uint16_t **ppT
                            const HmdRenderInfo &hmdRenderInfo, 
                            const DistortionRenderDesc &distortion, const ScaleAndOffset2D &eyeToSourceNDC );
 
+// As above, but first looks in cacheDir for a mesh made from the same lens, eye relief and
+// viewport, and stores the mesh there if it had to be made. An empty cacheDir skips the cache.
+void DistortionMeshCreateCached( DistortionMeshVertexData **ppVertices, uint16_t **ppTriangleListIndices,
+                                 int *pNumVertices, int *pNumTriangles,
+                                 bool rightEye,
+                                 const HmdRenderInfo &hmdRenderInfo,
+                                 const DistortionRenderDesc &distortion, const ScaleAndOffset2D &eyeToSourceNDC,
+                                 const char *cacheDir );
+
 void DistortionMeshDestroy ( DistortionMeshVertexData *pVertices, uint16_t *pTriangleMeshIndices );
 
 
+//-----------------------------------------------------------------------------------
+// *****  CPU Distortion Rendering
+//
+
+// Distorts one eye's rendered image into its half of the frame on the CPU, as the distortion
+// mesh and shader would on the GPU - except that every pixel gets its own lens solve rather than
+// one per mesh vertex interpolated across triangles, and timewarp is not applied.
+// Both images are tightly packed RGBA8. eyeToSourceUV maps to UVs whose v runs along the rows of
+// the eye image in memory order; frame rows are stored in GL order, bottom row first.
+void DistortionRenderCpu ( uint8_t *pFrame, Sizei const &frameSize,
+                           const uint8_t *pEyeImage, Sizei const &eyeImageSize,
+                           bool rightEye,
+                           const HmdRenderInfo &hmdRenderInfo,
+                           const DistortionRenderDesc &distortion,
+                           const ScaleAndOffset2D &eyeToSourceNDC, const ScaleAndOffset2D &eyeToSourceUV,
+                           bool chromatic, bool vignette, bool linearFilter );
+
+
 //-----------------------------------------------------------------------------------
 // *****  Heightmap Mesh Rendering
 //